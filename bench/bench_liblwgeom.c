@@ -0,0 +1,1220 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+/*
+ * Microbenchmarks for the liblwgeom hot paths.
+ *
+ * The corpus is generated from a fixed seed so that two runs (or two
+ * releases of the library) always work on byte-identical inputs. Every
+ * case reports nanoseconds per operation, bytes and calls handed to the
+ * liblwgeom allocator per operation and throughput, as one JSON document
+ * on stdout. Allocations are not counted (null) for the threaded cases.
+ *
+ * Usage: bench_liblwgeom [--min-time SECONDS] [--scale N] [--filter TEXT]
+ *                        [--cpu-level scalar|sse2|sse4.2|avx2|avx512|neon]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "liblwgeom_internal.h"
+#include "lwgeom_geos.h"
+#include "gserialized2.h"
+#include "lwtree.h"
+#include "lwgeodetic_tree.h"
+#include "lwhrtree.h"
+#include "lwknn.h"
+
+#define BENCH_SEED 20231208
+#define BENCH_MIN_ITERATIONS 3
+#define BENCH_MAX_ITERATIONS 100000000
+
+/**********************************************************************
+ * Allocation accounting
+ */
+
+/* Every block carries its size in a header, so that realloc growth can be
+ * charged to the operation that caused it. Kept 16 bytes for alignment. */
+#define BENCH_ALLOC_HDR 16
+
+/* Plain counters: accounting is switched off while a case runs threads,
+ * the flag itself only changes between cases */
+static int bench_alloc_enabled = LW_TRUE;
+static uint64_t bench_alloc_bytes = 0;
+static uint64_t bench_alloc_calls = 0;
+
+static void *
+bench_allocator(size_t size)
+{
+	char *mem = malloc(size + BENCH_ALLOC_HDR);
+	if (!mem)
+		return NULL;
+	*((size_t *)mem) = size;
+	if (bench_alloc_enabled)
+	{
+		bench_alloc_bytes += size;
+		bench_alloc_calls++;
+	}
+	return mem + BENCH_ALLOC_HDR;
+}
+
+static void *
+bench_reallocator(void *mem, size_t size)
+{
+	char *hdr;
+	size_t oldsize;
+	if (!mem)
+		return bench_allocator(size);
+	hdr = (char *)mem - BENCH_ALLOC_HDR;
+	oldsize = *((size_t *)hdr);
+	hdr = realloc(hdr, size + BENCH_ALLOC_HDR);
+	if (!hdr)
+		return NULL;
+	*((size_t *)hdr) = size;
+	if (bench_alloc_enabled)
+	{
+		if (size > oldsize)
+			bench_alloc_bytes += size - oldsize;
+		bench_alloc_calls++;
+	}
+	return hdr + BENCH_ALLOC_HDR;
+}
+
+static void
+bench_freeor(void *mem)
+{
+	if (mem)
+		free((char *)mem - BENCH_ALLOC_HDR);
+}
+
+/**********************************************************************
+ * Timing
+ */
+
+static double
+bench_now_ns(void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER freq = {0};
+	LARGE_INTEGER now;
+	if (!freq.QuadPart)
+		QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return (double)now.QuadPart * 1e9 / (double)freq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#endif
+}
+
+/**********************************************************************
+ * Reproducible corpus
+ */
+
+static uint64_t bench_rand_state = BENCH_SEED;
+
+/* 64-bit LCG (Knuth MMIX constants), returns a double in [0,1) */
+static double
+bench_rand(void)
+{
+	bench_rand_state = bench_rand_state * 6364136223846793005ULL + 1442695040888963407ULL;
+	return (double)(bench_rand_state >> 11) / 9007199254740992.0;
+}
+
+/* Minimal growable text buffer, to keep the generator independent from
+ * the library code under test */
+typedef struct
+{
+	char *str;
+	size_t len;
+	size_t capacity;
+} BENCH_TEXT;
+
+static void
+bench_text_append(BENCH_TEXT *t, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+	for (;;)
+	{
+		size_t avail = t->capacity - t->len;
+		va_start(ap, fmt);
+		n = vsnprintf(t->str + t->len, avail, fmt, ap);
+		va_end(ap);
+		if (n >= 0 && (size_t)n < avail)
+		{
+			t->len += n;
+			return;
+		}
+		t->capacity = t->capacity * 2 + (n > 0 ? n : 64);
+		t->str = realloc(t->str, t->capacity);
+	}
+}
+
+static void
+bench_text_coord(BENCH_TEXT *t, double x, double y)
+{
+	bench_text_append(t, "%.9f %.9f", x, y);
+}
+
+/* Closed star-shaped ring around (cx,cy): radii vary but angles increase
+ * monotonically, so the ring is always simple */
+static void
+bench_text_ring(BENCH_TEXT *t, double cx, double cy, double rmin, double rmax, int npoints, int clockwise)
+{
+	int i;
+	double x0 = 0, y0 = 0;
+	bench_text_append(t, "(");
+	for (i = 0; i < npoints; i++)
+	{
+		double a = 2.0 * M_PI * i / npoints * (clockwise ? -1.0 : 1.0);
+		double r = rmin + (rmax - rmin) * bench_rand();
+		double x = cx + r * cos(a);
+		double y = cy + r * sin(a);
+		if (i == 0)
+		{
+			x0 = x;
+			y0 = y;
+		}
+		bench_text_coord(t, x, y);
+		bench_text_append(t, ",");
+	}
+	bench_text_coord(t, x0, y0);
+	bench_text_append(t, ")");
+}
+
+static char *
+bench_corpus_point(int scale)
+{
+	BENCH_TEXT t = {NULL, 0, 0};
+	(void)scale;
+	bench_text_append(&t, "SRID=4326;POINT(");
+	bench_text_coord(&t, -120 + 240 * bench_rand(), -60 + 120 * bench_rand());
+	bench_text_append(&t, ")");
+	return t.str;
+}
+
+/* Random walk, like a GPS track or a dense coastline */
+static char *
+bench_corpus_long_line(int scale)
+{
+	BENCH_TEXT t = {NULL, 0, 0};
+	int i, n = 100000 * scale;
+	double x = -10, y = 40;
+	bench_text_append(&t, "SRID=4326;LINESTRING(");
+	for (i = 0; i < n; i++)
+	{
+		x += (bench_rand() - 0.45) * 0.001;
+		y += (bench_rand() - 0.5) * 0.001;
+		if (i)
+			bench_text_append(&t, ",");
+		bench_text_coord(&t, x, y);
+	}
+	bench_text_append(&t, ")");
+	return t.str;
+}
+
+/* Grid of non-overlapping polygons with one hole each */
+static char *
+bench_corpus_big_multipolygon(int scale)
+{
+	BENCH_TEXT t = {NULL, 0, 0};
+	int i, j, side = 8 * scale;
+	double radius = 0.4;
+	bench_text_append(&t, "SRID=4326;MULTIPOLYGON(");
+	for (i = 0; i < side; i++)
+	{
+		for (j = 0; j < side; j++)
+		{
+			double cx = 2.5 * radius * i;
+			double cy = 2.5 * radius * j;
+			if (i || j)
+				bench_text_append(&t, ",");
+			bench_text_append(&t, "(");
+			bench_text_ring(&t, cx, cy, 0.6 * radius, radius, 2048, 0);
+			bench_text_append(&t, ",");
+			bench_text_ring(&t, cx, cy, 0.3 * radius, 0.3 * radius, 256, 1);
+			bench_text_append(&t, ")");
+		}
+	}
+	bench_text_append(&t, ")");
+	return t.str;
+}
+
+/* Curve polygon made of a chain of circular arcs closed by a straight edge */
+static char *
+bench_corpus_curves(int scale)
+{
+	BENCH_TEXT t = {NULL, 0, 0};
+	int i, n = 1024 * scale;
+	double radius = 5.0;
+	bench_text_append(&t, "SRID=4326;CURVEPOLYGON(COMPOUNDCURVE(CIRCULARSTRING(");
+	for (i = 0; i <= 2 * n; i++)
+	{
+		double a = M_PI * i / (2 * n);
+		double r = radius * (1.0 + 0.05 * (i % 2 ? bench_rand() : 0.0));
+		if (i)
+			bench_text_append(&t, ",");
+		bench_text_coord(&t, 10 + r * cos(a), 45 + r * sin(a));
+	}
+	bench_text_append(&t, "),(");
+	bench_text_coord(&t, 10 - radius, 45);
+	bench_text_append(&t, ",");
+	bench_text_coord(&t, 10 + radius, 45);
+	bench_text_append(&t, ")))");
+	return t.str;
+}
+
+typedef struct
+{
+	const char *name;
+	char *(*generate)(int scale);
+
+	/* Derived representations of the same geometry */
+	char *wkt;
+	size_t wkt_size;
+	char *geojson; /* As a one feature collection */
+	size_t geojson_size;
+	lwvarlena_t *geobuf; /* Same */
+	size_t geobuf_size;
+	LWGEOM *geom;
+	lwvarlena_t *wkb;
+	size_t wkb_size;
+	GSERIALIZED *gser;
+	size_t gser_size;
+	LWGEOM *probe;
+	LWGEOM *clip;
+	LWGEOM *work;
+	LWGEOM *geog; /* Same geometry as a geography */
+	GBOX *boxes;  /* One per vertex, for the indexes */
+	uint64_t num_boxes;
+	LWHRTREE *hrtree;
+	LWGEOM **points; /* One per vertex, for the kNN index */
+	LWKNN *knn;
+	uint8_t *fgb; /* The vertices as an indexed FlatGeobuf */
+	size_t fgb_size;
+	int has_arc;
+} BENCH_CORPUS;
+
+static BENCH_CORPUS bench_corpus[] = {
+	{"point", bench_corpus_point, NULL, 0, NULL, 0, NULL, 0, NULL, NULL, 0, NULL, 0, NULL, NULL, NULL, NULL, NULL, 0, NULL, NULL, NULL, NULL, 0, 0},
+	{"long_line", bench_corpus_long_line, NULL, 0, NULL, 0, NULL, 0, NULL, NULL, 0, NULL, 0, NULL, NULL, NULL, NULL, NULL, 0, NULL, NULL, NULL, NULL, 0, 0},
+	{"big_multipolygon", bench_corpus_big_multipolygon, NULL, 0, NULL, 0, NULL, 0, NULL, NULL, 0, NULL, 0, NULL, NULL, NULL, NULL, NULL, 0, NULL, NULL, NULL, NULL, 0, 0},
+	{"curves", bench_corpus_curves, NULL, 0, NULL, 0, NULL, 0, NULL, NULL, 0, NULL, 0, NULL, NULL, NULL, NULL, NULL, 0, NULL, NULL, NULL, NULL, 0, 0}};
+
+#define BENCH_NUM_CORPUS (sizeof(bench_corpus) / sizeof(bench_corpus[0]))
+
+/* FlatGeobuf sink growing a malloc buffer */
+typedef struct
+{
+	uint8_t *buf;
+	size_t size;
+	size_t capacity;
+} BENCH_FGB_SINK;
+
+static int
+bench_fgb_sink(const uint8_t *bytes, size_t size, void *data)
+{
+	BENCH_FGB_SINK *sink = data;
+	if (sink->size + size > sink->capacity)
+	{
+		while (sink->size + size > sink->capacity)
+			sink->capacity = sink->capacity ? 2 * sink->capacity : 65536;
+		sink->buf = realloc(sink->buf, sink->capacity);
+	}
+	memcpy(sink->buf + sink->size, bytes, size);
+	sink->size += size;
+	return LW_SUCCESS;
+}
+
+/* One feature per vertex, as for GeoJSON */
+static void
+bench_fgb_write(BENCH_CORPUS *c, BENCH_FGB_SINK *sink)
+{
+	LWFLATGEOBUF_WRITER *writer = lwflatgeobuf_writer_create(bench_fgb_sink, sink, c->name, c->geom->srid, LW_FALSE, LW_FALSE, 16);
+	LWPROPERTY property;
+	uint64_t j;
+
+	memset(&property, 0, sizeof(property));
+	property.key = "name";
+	property.type = LWPROPERTY_STRING;
+	property.string_value = "vertex";
+	for (j = 0; j < c->num_boxes; j++)
+		lwflatgeobuf_writer_feature(writer, c->points[j], &property, 1);
+	lwflatgeobuf_writer_finish(writer);
+	lwflatgeobuf_writer_free(writer);
+}
+
+static void
+bench_corpus_prepare(BENCH_CORPUS *c, int scale)
+{
+	GBOX box;
+	char clip_wkt[256];
+	LWPOINTITERATOR *it;
+	POINT4D pt;
+	lwvarlena_t *geojson;
+	size_t geojson_size;
+	LWGEOBUF_WRITER *geobuf;
+	LWPROPERTY property;
+	uint64_t i;
+
+	c->wkt = c->generate(scale);
+	c->wkt_size = strlen(c->wkt);
+	c->geom = lwgeom_from_wkt(c->wkt, LW_PARSER_CHECK_NONE);
+	if (!c->geom)
+	{
+		fprintf(stderr, "unable to parse corpus geometry '%s'\n", c->name);
+		exit(1);
+	}
+	lwgeom_add_bbox(c->geom);
+	c->has_arc = lwgeom_has_arc(c->geom);
+	c->wkb = lwgeom_to_wkb_varlena(c->geom, WKB_EXTENDED);
+	c->wkb_size = LWSIZE_GET(c->wkb->size) - LWVARHDRSZ;
+	c->gser = gserialized2_from_lwgeom(c->geom, &c->gser_size);
+	c->work = lwgeom_clone_deep(c->geom);
+	if (!c->has_arc)
+	{
+		c->geog = lwgeom_clone_deep(c->geom);
+		lwgeom_drop_bbox(c->geog);
+		lwgeom_set_geodetic(c->geog, LW_TRUE);
+		lwgeom_add_bbox(c->geog);
+
+		geojson = lwgeom_to_geojson(c->geom, NULL, OUT_DEFAULT_DECIMAL_DIGITS, 0);
+		geojson_size = LWSIZE_GET(geojson->size) - LWVARHDRSZ;
+		c->geojson = malloc(geojson_size + 128);
+		c->geojson_size = snprintf(c->geojson,
+					   geojson_size + 128,
+					   "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\","
+					   "\"properties\":{\"name\":\"%s\"},\"geometry\":%.*s}]}",
+					   c->name,
+					   (int)geojson_size,
+					   geojson->data);
+		lwfree(geojson);
+
+		geobuf = lwgeobuf_writer_create(OUT_DEFAULT_DECIMAL_DIGITS, FLAGS_GET_Z(c->geom->flags));
+		memset(&property, 0, sizeof(property));
+		property.key = "name";
+		property.type = LWPROPERTY_STRING;
+		property.string_value = c->name;
+		lwgeobuf_writer_feature(geobuf, c->geom, &property, 1);
+		c->geobuf = lwgeobuf_writer_finish(geobuf);
+		c->geobuf_size = LWSIZE_GET(c->geobuf->size) - LWVARHDRSZ;
+		lwgeobuf_writer_free(geobuf);
+	}
+
+	/* Vertex boxes and their index */
+	c->boxes = malloc(lwgeom_count_vertices(c->geom) * sizeof(GBOX));
+	c->num_boxes = 0;
+	it = lwpointiterator_create(c->geom);
+	while (lwpointiterator_next(it, &pt))
+	{
+		GBOX *b = &c->boxes[c->num_boxes++];
+		memset(b, 0, sizeof(GBOX));
+		b->xmin = b->xmax = pt.x;
+		b->ymin = b->ymax = pt.y;
+	}
+	lwpointiterator_destroy(it);
+	c->hrtree = lwhrtree_create(c->boxes, c->num_boxes, 0);
+	c->points = malloc(c->num_boxes * sizeof(LWGEOM *));
+	for (i = 0; i < c->num_boxes; i++)
+		c->points[i] = lwpoint_as_lwgeom(lwpoint_make2d(c->geom->srid, c->boxes[i].xmin, c->boxes[i].ymin));
+	c->knn = lwknn_create((const LWGEOM **)c->points, c->num_boxes);
+	{
+		BENCH_FGB_SINK sink = {NULL, 0, 0};
+		bench_fgb_write(c, &sink);
+		c->fgb = sink.buf;
+		c->fgb_size = sink.size;
+	}
+
+	/* Probe point outside of the geometry, for distance */
+	lwgeom_calculate_gbox(c->geom, &box);
+	c->probe = (LWGEOM *)lwpoint_make2d(c->geom->srid, box.xmax + 1.0, box.ymax + 1.0);
+
+	/* Clip box covering the lower left quarter, for overlay */
+	snprintf(clip_wkt,
+		 sizeof(clip_wkt),
+		 "SRID=%d;POLYGON((%.9f %.9f,%.9f %.9f,%.9f %.9f,%.9f %.9f,%.9f %.9f))",
+		 c->geom->srid,
+		 box.xmin - 1, box.ymin - 1,
+		 (box.xmin + box.xmax) / 2, box.ymin - 1,
+		 (box.xmin + box.xmax) / 2, (box.ymin + box.ymax) / 2,
+		 box.xmin - 1, (box.ymin + box.ymax) / 2,
+		 box.xmin - 1, box.ymin - 1);
+	c->clip = lwgeom_from_wkt(clip_wkt, LW_PARSER_CHECK_NONE);
+}
+
+static void
+bench_corpus_release(BENCH_CORPUS *c)
+{
+	uint64_t i;
+
+	lwgeom_free(c->geom);
+	lwgeom_free(c->probe);
+	lwgeom_free(c->clip);
+	lwgeom_free(c->work);
+	lwgeom_free(c->geog);
+	lwhrtree_free(c->hrtree);
+	lwknn_free(c->knn);
+	for (i = 0; i < c->num_boxes; i++)
+		lwgeom_free(c->points[i]);
+	free(c->points);
+	free(c->boxes);
+	lwfree(c->wkb);
+	lwfree(c->gser);
+	free(c->wkt);
+	free(c->geojson);
+	lwfree(c->geobuf);
+	free(c->fgb);
+}
+
+/**********************************************************************
+ * Cases
+ */
+
+static LWPROJ *bench_pj_fwd = NULL;
+static LWPROJ *bench_pj_inv = NULL;
+static LWARENA *bench_arena = NULL;
+static SPHEROID bench_spheroid;
+
+typedef struct
+{
+	const char *name;
+	/* Returns LW_FALSE when the case does not apply to the input */
+	int (*applies)(const BENCH_CORPUS *c);
+	void (*run)(BENCH_CORPUS *c, uint64_t iteration);
+	/* Bytes of input or output handled per operation, for throughput */
+	size_t (*bytes)(const BENCH_CORPUS *c);
+	/* LW_TRUE when the case runs worker threads, no allocation figures then */
+	int threaded;
+} BENCH_CASE;
+
+static int bench_always(const BENCH_CORPUS *c) { (void)c; return LW_TRUE; }
+static int bench_linear(const BENCH_CORPUS *c) { return !c->has_arc; }
+static int bench_transform_ok(const BENCH_CORPUS *c) { (void)c; return bench_pj_fwd && bench_pj_inv; }
+static int bench_areal(const BENCH_CORPUS *c) { return lwgeom_dimension(c->geom) == 2 && !c->has_arc; }
+
+static size_t bench_wkt_bytes(const BENCH_CORPUS *c) { return c->wkt_size; }
+static size_t bench_geojson_bytes(const BENCH_CORPUS *c) { return c->geojson_size; }
+static size_t bench_geobuf_bytes(const BENCH_CORPUS *c) { return c->geobuf_size; }
+static size_t bench_fgb_bytes(const BENCH_CORPUS *c) { return c->fgb_size; }
+static size_t bench_wkb_bytes(const BENCH_CORPUS *c) { return c->wkb_size; }
+static size_t bench_gser_bytes(const BENCH_CORPUS *c) { return c->gser_size; }
+static size_t bench_boxes_bytes(const BENCH_CORPUS *c) { return c->num_boxes * sizeof(GBOX); }
+
+static void
+bench_run_calculate_gbox(BENCH_CORPUS *c, uint64_t i)
+{
+	GBOX box;
+	lwgeom_calculate_gbox_cartesian(c->geom, &box);
+}
+
+static void
+bench_run_wkb_in(BENCH_CORPUS *c, uint64_t i)
+{
+	lwgeom_free(lwgeom_from_wkb((uint8_t *)c->wkb->data, c->wkb_size, LW_PARSER_CHECK_NONE));
+}
+
+static void
+bench_run_wkt_in(BENCH_CORPUS *c, uint64_t i)
+{
+	lwgeom_free(lwgeom_from_wkt(c->wkt, LW_PARSER_CHECK_NONE));
+}
+
+static int
+bench_geojson_feature(LWGEOM *geom, const char *properties, size_t properties_size, void *data)
+{
+	lwgeom_free(geom);
+	return LW_TRUE;
+}
+
+/* Pushed in chunks, as read from a file */
+static void
+bench_run_geojson_reader(BENCH_CORPUS *c, uint64_t i)
+{
+	LWGEOJSON_READER *reader = lwgeojson_reader_create(bench_geojson_feature, NULL);
+	size_t offset, size;
+
+	for (offset = 0; offset < c->geojson_size; offset += size)
+	{
+		size = FP_MIN(c->geojson_size - offset, 65536);
+		lwgeojson_reader_push(reader, c->geojson + offset, size);
+	}
+	lwgeojson_reader_finish(reader);
+	lwgeojson_reader_free(reader);
+}
+
+static void
+bench_run_wkb_out(BENCH_CORPUS *c, uint64_t i)
+{
+	lwfree(lwgeom_to_wkb_buffer(c->geom, WKB_EXTENDED));
+}
+
+static void
+bench_run_wkt_out(BENCH_CORPUS *c, uint64_t i)
+{
+	size_t size;
+	lwfree(lwgeom_to_wkt(c->geom, WKT_EXTENDED, OUT_DEFAULT_DECIMAL_DIGITS, &size));
+}
+
+static void
+bench_run_geojson_out(BENCH_CORPUS *c, uint64_t i)
+{
+	lwfree(lwgeom_to_geojson(c->geom, NULL, OUT_DEFAULT_DECIMAL_DIGITS, 0));
+}
+
+static int
+bench_geojson_sink(const char *text, size_t size, void *data)
+{
+	*(size_t *)data += size;
+	return LW_SUCCESS;
+}
+
+/* One feature per vertex, as a feature server writes them */
+static void
+bench_run_geojson_writer(BENCH_CORPUS *c, uint64_t i)
+{
+	size_t size = 0;
+	LWGEOJSON_WRITER *writer = lwgeojson_writer_create(bench_geojson_sink, &size, NULL, OUT_DEFAULT_DECIMAL_DIGITS, 0);
+	uint64_t j;
+
+	for (j = 0; j < c->num_boxes; j++)
+		lwgeojson_writer_feature(writer, c->points[j], "{\"name\":\"vertex\"}", 17);
+	lwgeojson_writer_finish(writer);
+	lwgeojson_writer_free(writer);
+}
+
+/* Into a tile over the clip box, with a couple of properties */
+static void
+bench_run_mvt(BENCH_CORPUS *c, uint64_t i)
+{
+	LWMVT_LAYER *layer = lwmvt_layer_create("bench", 4096);
+	LWPROPERTY properties[2];
+	LWGEOM *geom = lwgeom_to_mvt_geom(c->geom, lwgeom_get_bbox(c->clip), 4096, 256, LW_TRUE);
+
+	memset(properties, 0, sizeof(properties));
+	properties[0].key = "name";
+	properties[0].type = LWPROPERTY_STRING;
+	properties[0].string_value = c->name;
+	properties[1].key = "iteration";
+	properties[1].type = LWPROPERTY_INT;
+	properties[1].int_value = (int64_t)i;
+	if (geom)
+	{
+		lwmvt_layer_add_feature(layer, geom, properties, 2, &i);
+		lwgeom_free(geom);
+	}
+	lwfree(lwmvt_encode(&layer, 1));
+	lwmvt_layer_free(layer);
+}
+
+static void
+bench_run_geobuf_out(BENCH_CORPUS *c, uint64_t i)
+{
+	lwfree(lwgeom_to_geobuf(c->geom, OUT_DEFAULT_DECIMAL_DIGITS));
+}
+
+static int
+bench_geobuf_feature(LWGEOM *geom, const LWPROPERTY *properties, uint32_t nproperties, void *data)
+{
+	lwgeom_free(geom);
+	return LW_TRUE;
+}
+
+static void
+bench_run_geobuf_reader(BENCH_CORPUS *c, uint64_t i)
+{
+	LWGEOBUF_READER *reader = lwgeobuf_reader_create(bench_geobuf_feature, NULL);
+	size_t offset, size;
+
+	for (offset = 0; offset < c->geobuf_size; offset += size)
+	{
+		size = FP_MIN(c->geobuf_size - offset, 65536);
+		lwgeobuf_reader_push(reader, (uint8_t *)c->geobuf->data + offset, size);
+	}
+	lwgeobuf_reader_finish(reader);
+	lwgeobuf_reader_free(reader);
+}
+
+/* One feature per vertex, as for GeoJSON */
+static void
+bench_run_geobuf_writer(BENCH_CORPUS *c, uint64_t i)
+{
+	LWGEOBUF_WRITER *writer = lwgeobuf_writer_create(OUT_DEFAULT_DECIMAL_DIGITS, LW_FALSE);
+	LWPROPERTY property;
+	uint64_t j;
+
+	memset(&property, 0, sizeof(property));
+	property.key = "name";
+	property.type = LWPROPERTY_STRING;
+	property.string_value = "vertex";
+	for (j = 0; j < c->num_boxes; j++)
+		lwgeobuf_writer_feature(writer, c->points[j], &property, 1);
+	lwfree(lwgeobuf_writer_finish(writer));
+	lwgeobuf_writer_free(writer);
+}
+
+static void
+bench_run_twkb_out(BENCH_CORPUS *c, uint64_t i)
+{
+	lwfree(lwgeom_to_twkb(c->geom, TWKB_BBOX | TWKB_SIZE, 5, 0, 0));
+}
+
+/* One geometry per vertex with its id, as shipped to clients */
+static void
+bench_run_twkb_batch(BENCH_CORPUS *c, uint64_t i)
+{
+	int64_t *ids = lwalloc(c->num_boxes * sizeof(int64_t));
+	uint64_t j;
+
+	for (j = 0; j < c->num_boxes; j++)
+		ids[j] = (int64_t)j;
+	lwfree(lwgeom_to_twkb_batch((const LWGEOM **)c->points, c->num_boxes, ids, TWKB_BBOX | TWKB_SIZE, 5, 0, 0));
+	lwfree(ids);
+}
+
+static void
+bench_run_flatgeobuf_writer(BENCH_CORPUS *c, uint64_t i)
+{
+	BENCH_FGB_SINK sink = {NULL, 0, 0};
+	bench_fgb_write(c, &sink);
+	free(sink.buf);
+}
+
+static int
+bench_fgb_feature(LWGEOM *geom, const LWPROPERTY *properties, uint32_t nproperties, void *data)
+{
+	(*(uint64_t *)data)++;
+	lwgeom_free(geom);
+	return LW_TRUE;
+}
+
+static void
+bench_run_gserialized_out(BENCH_CORPUS *c, uint64_t i)
+{
+	size_t size;
+	lwfree(gserialized2_from_lwgeom(c->geom, &size));
+}
+
+static void
+bench_run_gserialized_in(BENCH_CORPUS *c, uint64_t i)
+{
+	lwgeom_free(lwgeom_from_gserialized2(c->gser));
+}
+
+static void
+bench_run_gserialized_view(BENCH_CORPUS *c, uint64_t i)
+{
+	lwgeom_free(lwgeom_from_gserialized_view(c->gser));
+}
+
+static void
+bench_run_gserialized_arena(BENCH_CORPUS *c, uint64_t i)
+{
+	LWARENA_SCOPE scope;
+	lwarena_push(bench_arena, &scope);
+	lwgeom_free(lwgeom_from_gserialized2(c->gser));
+	lwarena_pop(&scope);
+}
+
+static void
+bench_run_mindistance2d(BENCH_CORPUS *c, uint64_t i)
+{
+	volatile double d = lwgeom_mindistance2d(c->geom, c->probe);
+	(void)d;
+}
+
+static void
+bench_run_rect_tree_distance(BENCH_CORPUS *c, uint64_t i)
+{
+	volatile double d = lwgeom_rect_tree_distance(c->geom, c->probe, 0.0);
+	(void)d;
+}
+
+static void
+bench_run_distance_spheroid(BENCH_CORPUS *c, uint64_t i)
+{
+	volatile double d = lwgeom_distance_spheroid(c->geog, c->probe, &bench_spheroid, 0.0);
+	(void)d;
+}
+
+static void
+bench_run_distance_spheroid_tree(BENCH_CORPUS *c, uint64_t i)
+{
+	volatile double d = lwgeom_distance_spheroid_tree(c->geog, c->probe, &bench_spheroid, 0.0);
+	(void)d;
+}
+
+/* Alternate forward and inverse so the working copy stays in range */
+static void
+bench_run_transform(BENCH_CORPUS *c, uint64_t i)
+{
+	lwgeom_transform(c->work, (i % 2) ? bench_pj_inv : bench_pj_fwd);
+}
+
+static void
+bench_run_transform_parallel(BENCH_CORPUS *c, uint64_t i)
+{
+	lwgeom_transform_parallel(c->work, (i % 2) ? bench_pj_inv : bench_pj_fwd, 0);
+}
+
+static void
+bench_run_transform_from_str(BENCH_CORPUS *c, uint64_t i)
+{
+	if (i % 2)
+		lwgeom_transform_from_str(c->work, "EPSG:3857", "EPSG:4326");
+	else
+		lwgeom_transform_from_str(c->work, "EPSG:4326", "EPSG:3857");
+}
+
+static void
+bench_run_geos_roundtrip(BENCH_CORPUS *c, uint64_t i)
+{
+	lwgeom_free(lwgeom_geos_noop(c->geom));
+}
+
+/* Point probes spread over the box of the geometry */
+static LWPOINT *
+bench_box_probe(const BENCH_CORPUS *c, uint64_t i)
+{
+	const GBOX *box = c->geom->bbox;
+	double fx = (double)(i % 64) / 64.0, fy = (double)((i / 64) % 64) / 64.0;
+	return lwpoint_make2d(c->geom->srid,
+			      box->xmin + fx * (box->xmax - box->xmin),
+			      box->ymin + fy * (box->ymax - box->ymin));
+}
+
+static void
+bench_run_prepared_intersects(BENCH_CORPUS *c, uint64_t i)
+{
+	LWPOINT *pt = bench_box_probe(c, i);
+	volatile int r = lwgeom_prepared_intersects(c->geom, lwpoint_as_lwgeom(pt));
+	(void)r;
+	lwpoint_free(pt);
+}
+
+static void
+bench_run_covers_sphere(BENCH_CORPUS *c, uint64_t i)
+{
+	LWPOINT *pt = bench_box_probe(c, i);
+	volatile int r = lwgeom_covers_lwgeom_sphere(c->geog, lwpoint_as_lwgeom(pt));
+	(void)r;
+	lwpoint_free(pt);
+}
+
+static void
+bench_run_covers_sphere_tree(BENCH_CORPUS *c, uint64_t i)
+{
+	LWPOINT *pt = bench_box_probe(c, i);
+	volatile int r = lwgeom_covers_point_sphere_tree(c->geog, lwpoint_as_lwgeom(pt));
+	(void)r;
+	lwpoint_free(pt);
+}
+
+static void
+bench_run_hrtree_create(BENCH_CORPUS *c, uint64_t i)
+{
+	lwhrtree_free(lwhrtree_create(c->boxes, c->num_boxes, 0));
+}
+
+/* Windows of 1/16th of the extent, spread over the box of the geometry */
+static void
+bench_run_hrtree_query(BENCH_CORPUS *c, uint64_t i)
+{
+	LWPOINT *pt = bench_box_probe(c, i);
+	const GBOX *box = c->geom->bbox;
+	GBOX query;
+	volatile uint64_t n;
+	memset(&query, 0, sizeof(GBOX));
+	query.xmin = lwpoint_get_x(pt);
+	query.ymin = lwpoint_get_y(pt);
+	query.xmax = query.xmin + (box->xmax - box->xmin) / 16.0;
+	query.ymax = query.ymin + (box->ymax - box->ymin) / 16.0;
+	n = lwhrtree_query_visit(c->hrtree, &query, NULL, NULL);
+	(void)n;
+	lwpoint_free(pt);
+}
+
+/* Opens the file in place and reads the vertices in a window of 1/16th of the extent */
+static void
+bench_run_flatgeobuf_query(BENCH_CORPUS *c, uint64_t i)
+{
+	LWPOINT *pt = bench_box_probe(c, i);
+	const GBOX *box = c->geom->bbox;
+	LWFLATGEOBUF *fgb = lwflatgeobuf_open(c->fgb, c->fgb_size);
+	GBOX query;
+	uint64_t n = 0;
+	memset(&query, 0, sizeof(GBOX));
+	query.xmin = lwpoint_get_x(pt);
+	query.ymin = lwpoint_get_y(pt);
+	query.xmax = query.xmin + (box->xmax - box->xmin) / 16.0;
+	query.ymax = query.ymin + (box->ymax - box->ymin) / 16.0;
+	lwflatgeobuf_query(fgb, &query, bench_fgb_feature, &n);
+	lwflatgeobuf_close(fgb);
+	lwpoint_free(pt);
+}
+
+/* Ten vertices nearest to probes spread over the box of the geometry */
+static void
+bench_run_knn_search(BENCH_CORPUS *c, uint64_t i)
+{
+	LWPOINT *pt = bench_box_probe(c, i);
+	LWKNN_RESULT results[10];
+	volatile uint32_t n = lwknn_search(c->knn, lwpoint_as_lwgeom(pt), 10, -1.0, results);
+	(void)n;
+	lwpoint_free(pt);
+}
+
+static int
+bench_join_count(uint32_t ia, uint32_t ib, void *data)
+{
+	(*(uint64_t *)data)++;
+	return LW_TRUE;
+}
+
+/* Parts of the geometry against its own vertices */
+static void
+bench_run_spatial_join(BENCH_CORPUS *c, uint64_t i)
+{
+	const LWGEOM **parts = (const LWGEOM **)&c->geom;
+	uint32_t nparts = 1;
+	volatile uint64_t pairs = 0;
+	if (lwgeom_is_collection(c->geom))
+	{
+		parts = (const LWGEOM **)lwgeom_as_lwcollection(c->geom)->geoms;
+		nparts = lwgeom_as_lwcollection(c->geom)->ngeoms;
+	}
+	lwgeom_spatial_join(parts,
+			    nparts,
+			    (const LWGEOM **)c->points,
+			    c->num_boxes,
+			    LW_JOIN_INTERSECTS,
+			    0.0,
+			    bench_join_count,
+			    (void *)&pairs);
+}
+
+/* DBSCAN of the vertices, eps a thousandth of the extent */
+static void
+bench_run_dbscan(BENCH_CORPUS *c, uint64_t i, uint32_t min_points, int parallel)
+{
+	const GBOX *box = c->geom->bbox;
+	double eps = ((box->xmax - box->xmin) + (box->ymax - box->ymin)) / 2000.0;
+	UNIONFIND *uf = UF_create(c->num_boxes);
+	char *in_a_cluster = NULL;
+	if (parallel)
+		union_dbscan_parallel(c->points, c->num_boxes, uf, eps, min_points, &in_a_cluster, 0);
+	else
+		union_dbscan(c->points, c->num_boxes, uf, eps, min_points, &in_a_cluster);
+	lwfree(in_a_cluster);
+	UF_destroy(uf);
+}
+
+static void
+bench_run_union_dbscan(BENCH_CORPUS *c, uint64_t i)
+{
+	bench_run_dbscan(c, i, 4, LW_FALSE);
+}
+
+static void
+bench_run_union_dbscan_parallel(BENCH_CORPUS *c, uint64_t i)
+{
+	bench_run_dbscan(c, i, 4, LW_TRUE);
+}
+
+/* Within distance clustering of points, on the grid */
+static void
+bench_run_union_dbscan_minpoints_1(BENCH_CORPUS *c, uint64_t i)
+{
+	bench_run_dbscan(c, i, 1, LW_FALSE);
+}
+
+/* Same, with worker threads */
+static void
+bench_run_union_dbscan_minpoints_1_parallel(BENCH_CORPUS *c, uint64_t i)
+{
+	bench_run_dbscan(c, i, 1, LW_TRUE);
+}
+
+/* K-means of the vertices into 64 clusters */
+static void
+bench_run_kmeans(BENCH_CORPUS *c, uint64_t i, uint32_t nthreads)
+{
+	uint32_t k = c->num_boxes < 64 ? (uint32_t)c->num_boxes : 64;
+	lwfree(lwgeom_cluster_kmeans_parallel((const LWGEOM **)c->points, c->num_boxes, k, 0.0, nthreads));
+}
+
+static void
+bench_run_cluster_kmeans(BENCH_CORPUS *c, uint64_t i)
+{
+	bench_run_kmeans(c, i, 1);
+}
+
+static void
+bench_run_cluster_kmeans_parallel(BENCH_CORPUS *c, uint64_t i)
+{
+	bench_run_kmeans(c, i, 0);
+}
+
+static void
+bench_run_geos_centroid(BENCH_CORPUS *c, uint64_t i)
+{
+	lwgeom_free(lwgeom_centroid(c->geom));
+}
+
+static void
+bench_run_geos_intersection(BENCH_CORPUS *c, uint64_t i)
+{
+	lwgeom_free(lwgeom_intersection(c->geom, c->clip));
+}
+
+static void
+bench_run_geos_unaryunion(BENCH_CORPUS *c, uint64_t i)
+{
+	lwgeom_free(lwgeom_unaryunion(c->geom));
+}
+
+static const BENCH_CASE bench_cases[] = {
+	{"lwgeom_calculate_gbox_cartesian", bench_always, bench_run_calculate_gbox, bench_gser_bytes},
+	{"lwgeom_from_wkb", bench_always, bench_run_wkb_in, bench_wkb_bytes},
+	{"lwgeom_from_wkt", bench_always, bench_run_wkt_in, bench_wkt_bytes},
+	{"lwgeom_to_wkb_buffer", bench_always, bench_run_wkb_out, bench_wkb_bytes},
+	{"lwgeom_to_wkt", bench_always, bench_run_wkt_out, bench_wkt_bytes},
+	{"lwgeom_to_geojson", bench_linear, bench_run_geojson_out, bench_wkt_bytes},
+	{"lwgeojson_reader", bench_linear, bench_run_geojson_reader, bench_geojson_bytes},
+	{"lwgeojson_writer", bench_always, bench_run_geojson_writer, bench_boxes_bytes},
+	{"lwgeom_to_mvt", bench_always, bench_run_mvt, bench_gser_bytes},
+	{"lwgeom_to_geobuf", bench_linear, bench_run_geobuf_out, bench_geobuf_bytes},
+	{"lwgeobuf_reader", bench_linear, bench_run_geobuf_reader, bench_geobuf_bytes},
+	{"lwgeobuf_writer", bench_always, bench_run_geobuf_writer, bench_boxes_bytes},
+	{"lwgeom_to_twkb", bench_linear, bench_run_twkb_out, bench_wkb_bytes},
+	{"lwgeom_to_twkb_batch", bench_always, bench_run_twkb_batch, bench_boxes_bytes},
+	{"lwflatgeobuf_writer", bench_always, bench_run_flatgeobuf_writer, bench_boxes_bytes},
+	{"lwflatgeobuf_query", bench_always, bench_run_flatgeobuf_query, bench_fgb_bytes},
+	{"gserialized2_from_lwgeom", bench_always, bench_run_gserialized_out, bench_gser_bytes},
+	{"lwgeom_from_gserialized2", bench_always, bench_run_gserialized_in, bench_gser_bytes},
+	{"lwgeom_from_gserialized_view", bench_always, bench_run_gserialized_view, bench_gser_bytes},
+	{"lwgeom_from_gserialized2_arena", bench_always, bench_run_gserialized_arena, bench_gser_bytes},
+	{"lwgeom_mindistance2d", bench_always, bench_run_mindistance2d, bench_gser_bytes},
+	{"lwgeom_rect_tree_distance", bench_always, bench_run_rect_tree_distance, bench_gser_bytes},
+	{"lwgeom_distance_spheroid", bench_linear, bench_run_distance_spheroid, bench_gser_bytes},
+	{"lwgeom_distance_spheroid_tree", bench_linear, bench_run_distance_spheroid_tree, bench_gser_bytes},
+	{"lwgeom_transform", bench_transform_ok, bench_run_transform, bench_gser_bytes},
+	{"lwgeom_transform_parallel", bench_transform_ok, bench_run_transform_parallel, bench_gser_bytes, LW_TRUE},
+	{"lwgeom_transform_from_str", bench_transform_ok, bench_run_transform_from_str, bench_gser_bytes},
+	{"lwgeom_geos_noop", bench_always, bench_run_geos_roundtrip, bench_gser_bytes},
+	{"lwgeom_prepared_intersects", bench_areal, bench_run_prepared_intersects, bench_gser_bytes},
+	{"lwgeom_covers_lwgeom_sphere", bench_areal, bench_run_covers_sphere, bench_gser_bytes},
+	{"lwgeom_covers_point_sphere_tree", bench_areal, bench_run_covers_sphere_tree, bench_gser_bytes},
+	{"lwhrtree_create", bench_always, bench_run_hrtree_create, bench_boxes_bytes},
+	{"lwhrtree_query_visit", bench_always, bench_run_hrtree_query, bench_boxes_bytes},
+	{"lwknn_search", bench_always, bench_run_knn_search, bench_boxes_bytes},
+	{"lwgeom_spatial_join", bench_always, bench_run_spatial_join, bench_boxes_bytes},
+	{"union_dbscan", bench_always, bench_run_union_dbscan, bench_boxes_bytes},
+	{"union_dbscan_parallel", bench_always, bench_run_union_dbscan_parallel, bench_boxes_bytes, LW_TRUE},
+	{"union_dbscan_minpoints_1", bench_always, bench_run_union_dbscan_minpoints_1, bench_boxes_bytes},
+	{"union_dbscan_minpoints_1_parallel", bench_always, bench_run_union_dbscan_minpoints_1_parallel, bench_boxes_bytes, LW_TRUE},
+	{"lwgeom_cluster_kmeans", bench_always, bench_run_cluster_kmeans, bench_boxes_bytes},
+	{"lwgeom_cluster_kmeans_parallel", bench_always, bench_run_cluster_kmeans_parallel, bench_boxes_bytes, LW_TRUE},
+	{"lwgeom_centroid", bench_always, bench_run_geos_centroid, bench_gser_bytes},
+	{"lwgeom_intersection", bench_linear, bench_run_geos_intersection, bench_gser_bytes},
+	{"lwgeom_unaryunion", bench_areal, bench_run_geos_unaryunion, bench_gser_bytes}};
+
+#define BENCH_NUM_CASES (sizeof(bench_cases) / sizeof(bench_cases[0]))
+
+/**********************************************************************
+ * Driver
+ */
+
+static void
+bench_execute(const BENCH_CASE *bc, BENCH_CORPUS *c, double min_time_ns, int *first)
+{
+	uint64_t i, iterations = 0, batch = 1;
+	uint64_t alloc_bytes, alloc_calls;
+	char allocs[128];
+	double start, elapsed = 0;
+	size_t bytes = bc->bytes(c);
+
+	/* Warm up caches and any lazily initialized state */
+	bc->run(c, 0);
+
+	bench_alloc_enabled = !bc->threaded;
+	alloc_bytes = bench_alloc_bytes;
+	alloc_calls = bench_alloc_calls;
+	start = bench_now_ns();
+	while (iterations < BENCH_MIN_ITERATIONS || elapsed < min_time_ns)
+	{
+		for (i = 0; i < batch; i++)
+			bc->run(c, iterations + i + 1);
+		iterations += batch;
+		elapsed = bench_now_ns() - start;
+		if (iterations >= BENCH_MAX_ITERATIONS)
+			break;
+		if (batch < 1024 * 1024)
+			batch *= 2;
+	}
+	alloc_bytes = bench_alloc_bytes - alloc_bytes;
+	alloc_calls = bench_alloc_calls - alloc_calls;
+	bench_alloc_enabled = LW_TRUE;
+
+	/* Every case gets the working copy as it started, whatever this one did to it */
+	lwgeom_free(c->work);
+	c->work = lwgeom_clone_deep(c->geom);
+
+	/* Threaded cases report null rather than racy allocation figures */
+	if (bc->threaded)
+		snprintf(allocs, sizeof(allocs), "\"bytes_allocated_per_op\": null, \"allocs_per_op\": null");
+	else
+		snprintf(allocs,
+			 sizeof(allocs),
+			 "\"bytes_allocated_per_op\": %.1f, \"allocs_per_op\": %.2f",
+			 (double)alloc_bytes / iterations,
+			 (double)alloc_calls / iterations);
+
+	printf("%s\n    {\"case\": \"%s\", \"corpus\": \"%s\", \"npoints\": %u, \"iterations\": %llu, "
+	       "\"ns_per_op\": %.1f, %s, "
+	       "\"ops_per_sec\": %.1f, \"mb_per_sec\": %.3f}",
+	       *first ? "" : ",",
+	       bc->name,
+	       c->name,
+	       lwgeom_count_vertices(c->geom),
+	       (unsigned long long)iterations,
+	       elapsed / iterations,
+	       allocs,
+	       iterations * 1e9 / elapsed,
+	       (double)bytes * iterations * 1e9 / elapsed / (1024.0 * 1024.0));
+	fflush(stdout);
+	*first = LW_FALSE;
+}
+
+static void
+bench_usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [--min-time SECONDS] [--scale N] [--filter TEXT]"
+		" [--cpu-level scalar|sse2|sse4.2|avx2|avx512|neon]\n",
+		prog);
+	exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+	double min_time = 0.5;
+	int scale = 1;
+	const char *filter = NULL;
+	const char *cpu_level = NULL;
+	LW_CPU_LEVEL level;
+	int i, first = LW_TRUE;
+	size_t ci, cc;
+	LWGEOM_CONTEXT *ctx;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--min-time") && i + 1 < argc)
+			min_time = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--scale") && i + 1 < argc)
+			scale = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+			filter = argv[++i];
+		else if (!strcmp(argv[i], "--cpu-level") && i + 1 < argc)
+			cpu_level = argv[++i];
+		else
+			bench_usage(argv[0]);
+	}
+	if (min_time <= 0 || scale <= 0)
+		bench_usage(argv[0]);
+	if (cpu_level && !lwcpu_level_from_name(cpu_level, &level))
+		bench_usage(argv[0]);
+	if (cpu_level && !lwcpu_set_level(level))
+	{
+		fprintf(stderr, "CPU level '%s' is not supported here\n", cpu_level);
+		exit(2);
+	}
+
+	lwgeom_set_handlers(bench_allocator, bench_reallocator, bench_freeor, NULL, NULL, NULL);
+
+	/* Single threaded, the default context is enough */
+	ctx = lwcontext();
+	ctx->geos_ctx = GEOS_init_r();
+	GEOSContext_setNoticeHandler_r(ctx->geos_ctx, lwnotice);
+	GEOSContext_setErrorHandler_r(ctx->geos_ctx, lwgeom_geos_error);
+
+	/* Transformation cases are skipped when no PROJ database is around */
+	bench_pj_fwd = lwproj_from_str("EPSG:4326", "EPSG:3857");
+	bench_pj_inv = lwproj_from_str("EPSG:3857", "EPSG:4326");
+	bench_arena = lwarena_create(0);
+	spheroid_init(&bench_spheroid, WGS84_MAJOR_AXIS, WGS84_MINOR_AXIS);
+
+	for (ci = 0; ci < BENCH_NUM_CORPUS; ci++)
+		bench_corpus_prepare(&bench_corpus[ci], scale);
+
+	printf("{\n  \"liblwgeom_version\": \"%s\",\n  \"geos_version\": \"%s\",\n"
+	       "  \"cpu_level\": \"%s\",\n"
+	       "  \"seed\": %d,\n  \"scale\": %d,\n  \"min_time\": %g,\n  \"results\": [",
+	       LIBLWGEOM_VERSION,
+	       lwgeom_geos_version(),
+	       lwcpu_level_name(lwcpu_level()),
+	       BENCH_SEED,
+	       scale,
+	       min_time);
+
+	for (cc = 0; cc < BENCH_NUM_CASES; cc++)
+	{
+		for (ci = 0; ci < BENCH_NUM_CORPUS; ci++)
+		{
+			BENCH_CORPUS *c = &bench_corpus[ci];
+			if (filter && !strstr(bench_cases[cc].name, filter) && !strstr(c->name, filter))
+				continue;
+			if (!bench_cases[cc].applies(c))
+				continue;
+			bench_execute(&bench_cases[cc], c, min_time * 1e9, &first);
+		}
+	}
+	printf("\n  ]\n}\n");
+
+	for (ci = 0; ci < BENCH_NUM_CORPUS; ci++)
+		bench_corpus_release(&bench_corpus[ci]);
+	if (bench_pj_fwd)
+	{
+		proj_destroy(bench_pj_fwd->pj);
+		lwfree(bench_pj_fwd);
+	}
+	if (bench_pj_inv)
+	{
+		proj_destroy(bench_pj_inv->pj);
+		lwfree(bench_pj_inv);
+	}
+	lwarena_destroy(bench_arena);
+	lwproj_cache_destroy();
+	lwprepared_cache_destroy();
+	rect_tree_cache_destroy();
+	circ_tree_cache_destroy();
+	GEOS_finish_r(ctx->geos_ctx);
+	ctx->geos_ctx = NULL;
+	return 0;
+}
@@ -0,0 +1,63 @@
+# Find CUNIT
+# ~~~~~~~~~~~~
+# Copyright (c) 2024, dameng <yangzhenglong at dameng.com>
+# Copyright (c) 2007, Martin Dobias <wonder.sk at gmail.com>
+# Redistribution and use is allowed according to the terms of the BSD license.
+# For details see the accompanying COPYING-CMAKE-SCRIPTS file.
+#
+# CMake module to search for the CUnit library, in CUNIT_DIR when it is
+# given and in the standard locations otherwise
+#
+# If it's found it sets CUNIT_FOUND to TRUE
+# and following variables are set:
+#    CUNIT_INCLUDE_DIR
+#    CUNIT_LIBRARY
+#    CUNIT_LIBRARY_DIR
+
+# These variable were setted by find_package()
+#    CUNIT_FIND_REQUIRED
+#    CUNIT_FIND_QUIETLY
+
+
+# find_path and find_library normally search standard locations
+# before the specified paths. To search non-standard paths first,
+# FIND_* is invoked first with specified paths and NO_DEFAULT_PATH
+# and then again with no specified paths to search the default
+# locations. When an earlier FIND_* succeeds, subsequent FIND_*s
+# searching for the same item do nothing.
+
+# not support APPLE currently
+
+if(CUNIT_DIR)
+  find_path(CUNIT_INCLUDE_DIR NAMES CUnit/Basic.h PATHS
+    "${CUNIT_DIR}/include"
+    NO_DEFAULT_PATH
+  )
+
+  find_library(CUNIT_LIBRARY NAMES cunit PATHS
+    "${CUNIT_DIR}/lib"
+    "${CUNIT_DIR}/lib64"
+    NO_DEFAULT_PATH
+  )
+endif()
+
+find_path(CUNIT_INCLUDE_DIR NAMES CUnit/Basic.h)
+find_library(CUNIT_LIBRARY NAMES cunit)
+
+if(CUNIT_INCLUDE_DIR AND CUNIT_LIBRARY)
+  get_filename_component(CUNIT_LIBRARY_DIR ${CUNIT_LIBRARY} DIRECTORY)
+  set(CUNIT_FOUND TRUE)
+endif()
+
+if(CUNIT_FOUND)
+  if(NOT CUNIT_FIND_QUIETLY)
+    message(STATUS "Found CUnit library: ${CUNIT_LIBRARY}")
+    message(STATUS "Found CUnit headers: ${CUNIT_INCLUDE_DIR}")
+  endif()
+else()
+
+if(CUNIT_FIND_REQUIRED) # this variable will be set when 'REQUIRED' in find_package() function
+  message(FATAL_ERROR "Could not find CUnit")
+endif()
+
+endif()
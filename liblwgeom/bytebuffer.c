@@ -68,7 +68,7 @@ bytebuffer_destroy_buffer(bytebuffer_t *s)
 * If necessary, expand the bytebuffer_t internal buffer to accomodate the
 * specified additional size.
 */
-static inline void
+void
 bytebuffer_makeroom(bytebuffer_t *s, size_t size_to_add)
 {
 	LWDEBUGF(2,"Entered bytebuffer_makeroom with space need of %d", size_to_add);
@@ -169,6 +169,30 @@ bytebuffer_append_uvarint(bytebuffer_t *b, const uint64_t val)
 	return;
 }
 
+/**
+* Reset the bytebuffer_t. Useful for starting a fresh string
+* without the expense of freeing and re-allocating a new
+* bytebuffer_t.
+*/
+void
+bytebuffer_clear(bytebuffer_t *s)
+{
+	s->readcursor = s->writecursor = s->buf_start;
+}
+
+/**
+* Writes size bytes from start to the buffer
+*/
+void
+bytebuffer_append_bulk(bytebuffer_t *s, const void *start, size_t size)
+{
+	LWDEBUGF(2,"bytebuffer_append_bulk with size %d",size);
+	bytebuffer_makeroom(s, size);
+	memcpy(s->writecursor, start, size);
+	s->writecursor += size;
+	return;
+}
+
 /**
  * Returns the length of the current buffer
  */
@@ -251,30 +275,6 @@ bytebuffer_reset_reading(bytebuffer_t *s)
 	s->readcursor = s->buf_start;
 }
 
- /**
-* Reset the bytebuffer_t. Useful for starting a fresh string
-* without the expense of freeing and re-allocating a new
-* bytebuffer_t.
-*/
-void
-bytebuffer_clear(bytebuffer_t *s)
-{
-	s->readcursor = s->writecursor = s->buf_start;
-}
-
-/**
-* Writes a uint8_t value to the buffer
-*/
-void
-bytebuffer_append_bulk(bytebuffer_t *s, void * start, size_t size)
-{
-	LWDEBUGF(2,"bytebuffer_append_bulk with size %d",size);
-	bytebuffer_makeroom(s, size);
-	memcpy(s->writecursor, start, size);
-	s->writecursor += size;
-	return;
-}
-
 /*
 * Writes Integer to the buffer
 */
@@ -386,31 +386,4 @@ bytebuffer_read_uvarint(bytebuffer_t *b)
 	return val;
 }
 
-
- /**
-* Returns a new bytebuffer were both ingoing bytebuffers is merged.
-* Caller is responsible for freeing both incoming bytebuffers and resulting bytebuffer
-*/
-bytebuffer_t*
-bytebuffer_merge(bytebuffer_t **buff_array, int nbuffers)
-{
-	size_t total_size = 0, current_size, acc_size = 0;
-	int i;
-	for ( i = 0; i < nbuffers; i++ )
-	{
-		total_size += bytebuffer_getlength(buff_array[i]);
-	}
-
-	bytebuffer_t *res = bytebuffer_create_with_size(total_size);
-	for ( i = 0; i < nbuffers; i++)
-	{
-		current_size = bytebuffer_getlength(buff_array[i]);
-		memcpy(res->buf_start+acc_size, buff_array[i]->buf_start, current_size);
-		acc_size += current_size;
-	}
-	res->writecursor = res->buf_start + total_size;
-	res->readcursor = res->buf_start;
-	return res;
-}
-
 #endif
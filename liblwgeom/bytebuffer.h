@@ -53,6 +53,9 @@ void bytebuffer_append_byte(bytebuffer_t *s, const uint8_t val);
 void bytebuffer_append_bytebuffer(bytebuffer_t *write_to, bytebuffer_t *write_from);
 void bytebuffer_append_varint(bytebuffer_t *s, const int64_t val);
 void bytebuffer_append_uvarint(bytebuffer_t *s, const uint64_t val);
+void bytebuffer_append_bulk(bytebuffer_t *s, const void *start, size_t size);
+void bytebuffer_makeroom(bytebuffer_t *s, size_t size_to_add);
+void bytebuffer_clear(bytebuffer_t *s);
 size_t bytebuffer_getlength(const bytebuffer_t *s);
 lwvarlena_t *bytebuffer_get_buffer_varlena(const bytebuffer_t *s);
 const uint8_t* bytebuffer_get_buffer(const bytebuffer_t *s, size_t *buffer_length);
@@ -62,14 +65,11 @@ const uint8_t* bytebuffer_get_buffer(const bytebuffer_t *s, size_t *buffer_lengt
 void bytebuffer_destroy(bytebuffer_t *s);
 bytebuffer_t *bytebuffer_create_with_size(size_t size);
 bytebuffer_t *bytebuffer_create(void);
-void bytebuffer_clear(bytebuffer_t *s);
 uint8_t* bytebuffer_get_buffer_copy(const bytebuffer_t *s, size_t *buffer_length);
 uint64_t bytebuffer_read_uvarint(bytebuffer_t *s);
 int64_t bytebuffer_read_varint(bytebuffer_t *s);
-bytebuffer_t* bytebuffer_merge(bytebuffer_t **buff_array, int nbuffers);
 void bytebuffer_reset_reading(bytebuffer_t *s);
 void bytebuffer_append_bytebuffer(bytebuffer_t *write_to,bytebuffer_t *write_from);
-void bytebuffer_append_bulk(bytebuffer_t *s, void * start, size_t size);
 void bytebuffer_append_int(bytebuffer_t *buf, const int val, int swap);
 void bytebuffer_append_double(bytebuffer_t *buf, const double val, int swap);
 #endif
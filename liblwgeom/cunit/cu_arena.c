@@ -0,0 +1,158 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "cu_tester.h"
+
+static void
+test_arena_alloc(void)
+{
+	LWARENA *arena = lwarena_create(0);
+	uint8_t *a, *b, *c;
+	size_t used;
+
+	a = lwarena_alloc(arena, 3);
+	b = lwarena_alloc(arena, 17);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(a);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(b);
+	CU_ASSERT_EQUAL((uintptr_t)a % 8, 0);
+	CU_ASSERT_EQUAL((uintptr_t)b % 8, 0);
+	CU_ASSERT(b >= a + 3);
+	CU_ASSERT(lwarena_owns(arena, a));
+	CU_ASSERT(lwarena_owns(arena, b + 16));
+	CU_ASSERT_FALSE(lwarena_owns(arena, &used));
+	memset(a, 1, 3);
+	memset(b, 2, 17);
+
+	/* The last allocation grows in place, others move with their content */
+	used = lwarena_allocated(arena);
+	c = lwarena_realloc(arena, b, 100);
+	CU_ASSERT_PTR_EQUAL(c, b);
+	CU_ASSERT(lwarena_allocated(arena) > used);
+	c = lwarena_realloc(arena, a, 64);
+	CU_ASSERT(c != a);
+	CU_ASSERT_EQUAL(c[0], 1);
+	CU_ASSERT_EQUAL(c[2], 1);
+
+	/* Only the last allocation is given back */
+	used = lwarena_allocated(arena);
+	lwarena_free(arena, b);
+	CU_ASSERT_EQUAL(lwarena_allocated(arena), used);
+	lwarena_free(arena, c);
+	CU_ASSERT(lwarena_allocated(arena) < used);
+
+	/* Larger than a block */
+	a = lwarena_alloc(arena, 100000);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(a);
+	memset(a, 3, 100000);
+	CU_ASSERT(lwarena_owns(arena, a + 99999));
+
+	lwarena_reset(arena);
+	CU_ASSERT_EQUAL(lwarena_allocated(arena), 0);
+	CU_ASSERT_FALSE(lwarena_owns(arena, a));
+
+	/* Reset blocks are reused */
+	b = lwarena_alloc(arena, 50000);
+	CU_ASSERT_PTR_NOT_NULL(b);
+	CU_ASSERT(lwarena_owns(arena, b));
+
+	lwarena_destroy(arena);
+}
+
+static void
+test_arena_scope(void)
+{
+	LWARENA *arena = lwarena_create(4096);
+	LWARENA_SCOPE scope, inner, heap;
+	void *before, *mem, *kept;
+	LWGEOM *geom;
+	size_t mark;
+
+	before = lwalloc(32);
+	CU_ASSERT_PTR_NULL(lwarena_current());
+
+	lwarena_push(arena, &scope);
+	CU_ASSERT_PTR_EQUAL(lwarena_current(), arena);
+
+	/* lwalloc and friends go to the arena */
+	mem = lwalloc(100);
+	CU_ASSERT(lwarena_owns(arena, mem));
+	CU_ASSERT_PTR_EQUAL(lwarena_owner(mem), arena);
+	mem = lwrealloc(mem, 1000);
+	CU_ASSERT(lwarena_owns(arena, mem));
+
+	/* Heap memory from before the scope is still freed normally */
+	CU_ASSERT_PTR_NULL(lwarena_owner(before));
+	before = lwrealloc(before, 64);
+	CU_ASSERT_FALSE(lwarena_owns(arena, before));
+	lwfree(before);
+
+	/* A whole geometry, freeing it is a no-op */
+	geom = lwgeom_from_wkt("POLYGON((0 0,1 0,1 1,0 0))", LW_PARSER_CHECK_NONE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(geom);
+	CU_ASSERT(lwarena_owns(arena, geom));
+	lwgeom_free(geom);
+
+	/* Nested scopes release only their own allocations */
+	mark = lwarena_allocated(arena);
+	lwarena_push(arena, &inner);
+	mem = lwalloc(5000);
+	CU_ASSERT(lwarena_allocated(arena) > mark);
+	lwarena_pop(&inner);
+	ASSERT_INT_EQUAL(lwarena_allocated(arena), mark);
+
+	/* A heap scope inside makes memory that survives the pop */
+	lwarena_push(NULL, &heap);
+	CU_ASSERT_PTR_NULL(lwarena_current());
+	kept = lwalloc(64);
+	CU_ASSERT_PTR_NULL(lwarena_owner(kept));
+	lwarena_pop(&heap);
+	CU_ASSERT_PTR_EQUAL(lwarena_current(), arena);
+
+	/* Popping out of order is an error, and changes nothing */
+	lwarena_push(arena, &inner);
+	cu_error_msg_reset();
+	lwarena_pop(&scope);
+	CU_ASSERT_STRING_EQUAL(cu_error_msg, "lwarena_pop: arena scopes must be popped in reverse push order");
+	lwarena_pop(&inner);
+
+	lwarena_pop(&scope);
+	CU_ASSERT_PTR_NULL(lwarena_current());
+	ASSERT_INT_EQUAL(lwarena_allocated(arena), 0);
+
+	lwfree(kept);
+	lwarena_destroy(arena);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void arena_suite_setup(void);
+void arena_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("arena", NULL, NULL);
+	PG_ADD_TEST(suite, test_arena_alloc);
+	PG_ADD_TEST(suite, test_arena_scope);
+}
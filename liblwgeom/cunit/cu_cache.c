@@ -0,0 +1,247 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "lwcache.h"
+#include "cu_tester.h"
+
+static int released = 0;
+
+static void
+cu_cache_release(void *value)
+{
+	released++;
+	lwfree(value);
+}
+
+static int *
+cu_cache_value(int v)
+{
+	int *value = lwalloc(sizeof(int));
+	*value = v;
+	return value;
+}
+
+/* A line of npoints points, with point "moved" shifted by delta */
+static LWGEOM *
+cu_cache_line(uint32_t npoints, uint32_t moved, double delta)
+{
+	POINTARRAY *pa = ptarray_construct(0, 0, npoints);
+	POINT4D pt = {0, 0, 0, 0};
+	uint32_t i;
+
+	for (i = 0; i < npoints; i++)
+	{
+		pt.x = i;
+		pt.y = (i % 7) + (i == moved ? delta : 0);
+		ptarray_set_point4d(pa, i, &pt);
+	}
+	return lwline_as_lwgeom(lwline_construct(SRID_UNKNOWN, NULL, pa));
+}
+
+static void
+test_cache_key(void)
+{
+	const char *wkts[] = {
+		"POINT(1 2)",
+		"POINT(2 1)",
+		"POINT Z(1 2 3)",
+		"POINT M(1 2 3)",
+		"SRID=4326;POINT(1 2)",
+		"LINESTRING(1 2,3 4)",
+		"MULTIPOINT(1 2,3 4)",
+		"POLYGON((0 0,1 0,1 1,0 0))",
+		"POLYGON((0 0,1 0,1 1,0 0),(0 0,1 0,1 1,0 0))",
+		"GEOMETRYCOLLECTION(POINT(1 2))",
+		"GEOMETRYCOLLECTION(POINT EMPTY)",
+		"GEOMETRYCOLLECTION EMPTY",
+		"POINT EMPTY",
+	};
+	LWGEOM *geoms[sizeof(wkts) / sizeof(wkts[0])];
+	uint32_t i, j, n = sizeof(wkts) / sizeof(wkts[0]);
+	LWGEOM *a, *b;
+
+	for (i = 0; i < n; i++)
+	{
+		geoms[i] = lwgeom_from_wkt(wkts[i], LW_PARSER_CHECK_NONE);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(geoms[i]);
+	}
+	for (i = 0; i < n; i++)
+	{
+		LWGEOM *copy = lwgeom_clone_deep(geoms[i]);
+		CU_ASSERT_EQUAL(lwcache_key(geoms[i]), lwcache_key(copy));
+		CU_ASSERT(lwcache_geom_same(geoms[i], copy));
+		lwgeom_free(copy);
+		for (j = i + 1; j < n; j++)
+		{
+			CU_ASSERT(lwcache_key(geoms[i]) != lwcache_key(geoms[j]));
+			CU_ASSERT_FALSE(lwcache_geom_same(geoms[i], geoms[j]));
+		}
+	}
+	for (i = 0; i < n; i++)
+		lwgeom_free(geoms[i]);
+
+	/* Only some points are sampled, the comparison sees all of them */
+	a = cu_cache_line(1000, 501, 0.0);
+	b = cu_cache_line(1000, 501, 1e-9);
+	CU_ASSERT_EQUAL(lwcache_key(a), lwcache_key(b));
+	CU_ASSERT_FALSE(lwcache_geom_same(a, b));
+	lwgeom_free(b);
+
+	/* Bit for bit: -0 is not 0 */
+	b = cu_cache_line(1000, 501, 0.0);
+	CU_ASSERT(lwcache_geom_same(a, b));
+	{
+		POINT4D pt = {0, -0.0, 0, 0};
+		ptarray_set_point4d(lwgeom_as_lwline(b)->points, 0, &pt);
+	}
+	CU_ASSERT_FALSE(lwcache_geom_same(a, b));
+	lwgeom_free(b);
+	lwgeom_free(a);
+}
+
+static void
+test_cache_collision(void)
+{
+	LWCACHE cache;
+	LWGEOM *a = cu_cache_line(1000, 501, 0.0);
+	LWGEOM *b = cu_cache_line(1000, 501, 1.0);
+	uint64_t key_a, key_b, hits, misses;
+	uint32_t size;
+	int *value;
+
+	lwcache_init(&cache, 4, cu_cache_release);
+	released = 0;
+
+	CU_ASSERT_PTR_NULL(lwcache_find(&cache, a, &key_a));
+	lwcache_add(&cache, key_a, a, lwgeom_clone_deep(a), cu_cache_value(1));
+
+	/* Same key, different geometry: a miss, not the value of a */
+	CU_ASSERT_PTR_NULL(lwcache_find(&cache, b, &key_b));
+	CU_ASSERT_EQUAL(key_a, key_b);
+	lwcache_add(&cache, key_b, b, lwgeom_clone_deep(b), cu_cache_value(2));
+
+	value = lwcache_find(&cache, a, &key_a);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(value);
+	CU_ASSERT_EQUAL(*value, 1);
+	value = lwcache_find(&cache, b, &key_b);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(value);
+	CU_ASSERT_EQUAL(*value, 2);
+
+	lwcache_stats(&cache, &hits, &misses, &size);
+	CU_ASSERT_EQUAL(hits, 2);
+	CU_ASSERT_EQUAL(misses, 2);
+	CU_ASSERT_EQUAL(size, 2);
+
+	lwcache_flush(&cache);
+	CU_ASSERT_EQUAL(released, 2);
+	lwgeom_free(a);
+	lwgeom_free(b);
+}
+
+static void
+test_cache_input(void)
+{
+	LWCACHE cache;
+	LWGEOM *a = cu_cache_line(100, 0, 0.0);
+	LWGEOM *copy;
+	POINT4D pt;
+	uint64_t key;
+	int *value;
+
+	lwcache_init(&cache, 4, cu_cache_release);
+	released = 0;
+	CU_ASSERT_PTR_NULL(lwcache_find(&cache, a, &key));
+	lwcache_add(&cache, key, a, lwgeom_clone_deep(a), cu_cache_value(1));
+
+	/* Another object with the same content hits */
+	copy = lwgeom_clone_deep(a);
+	value = lwcache_find(&cache, copy, &key);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(value);
+	CU_ASSERT_EQUAL(*value, 1);
+
+	/* The same object changed in place does not */
+	pt.x = 50;
+	pt.y = 1000;
+	pt.z = pt.m = 0;
+	ptarray_set_point4d(lwgeom_as_lwline(copy)->points, 50, &pt);
+	CU_ASSERT_PTR_NULL(lwcache_find(&cache, copy, &key));
+	CU_ASSERT_PTR_NOT_NULL(lwcache_find(&cache, a, &key));
+
+	lwcache_flush(&cache);
+	CU_ASSERT_EQUAL(released, 1);
+	lwgeom_free(copy);
+	lwgeom_free(a);
+}
+
+static void
+test_cache_lru(void)
+{
+	LWCACHE cache;
+	LWGEOM *geoms[4];
+	uint64_t key;
+	uint32_t i, size;
+
+	lwcache_init(&cache, 3, cu_cache_release);
+	released = 0;
+	for (i = 0; i < 4; i++)
+		geoms[i] = cu_cache_line(10 + i, 0, 0.0);
+
+	for (i = 0; i < 3; i++)
+	{
+		CU_ASSERT_PTR_NULL(lwcache_find(&cache, geoms[i], &key));
+		lwcache_add(&cache, key, geoms[i], lwgeom_clone_deep(geoms[i]), cu_cache_value(i));
+	}
+
+	/* Touch 0, so 1 is the one to go */
+	CU_ASSERT_PTR_NOT_NULL(lwcache_find(&cache, geoms[0], &key));
+	CU_ASSERT_PTR_NULL(lwcache_find(&cache, geoms[3], &key));
+	lwcache_add(&cache, key, geoms[3], lwgeom_clone_deep(geoms[3]), cu_cache_value(3));
+	CU_ASSERT_EQUAL(released, 1);
+	lwcache_stats(&cache, NULL, NULL, &size);
+	CU_ASSERT_EQUAL(size, 3);
+	CU_ASSERT_PTR_NOT_NULL(lwcache_find(&cache, geoms[0], &key));
+	CU_ASSERT_PTR_NULL(lwcache_find(&cache, geoms[1], &key));
+	CU_ASSERT_PTR_NOT_NULL(lwcache_find(&cache, geoms[2], &key));
+	CU_ASSERT_PTR_NOT_NULL(lwcache_find(&cache, geoms[3], &key));
+
+	lwcache_flush(&cache);
+	CU_ASSERT_EQUAL(released, 4);
+	for (i = 0; i < 4; i++)
+		lwgeom_free(geoms[i]);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void cache_suite_setup(void);
+void cache_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("cache", NULL, NULL);
+	PG_ADD_TEST(suite, test_cache_key);
+	PG_ADD_TEST(suite, test_cache_collision);
+	PG_ADD_TEST(suite, test_cache_input);
+	PG_ADD_TEST(suite, test_cache_lru);
+}
@@ -0,0 +1,241 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "lwgeodetic.h"
+#include "lwgeodetic_tree.h"
+#include "cu_tester.h"
+
+/* Ring of n vertices at constant latitude (a polar cap) or a lon/lat ellipse */
+static LWGEOM *
+cu_circ_ring(uint32_t n, double lon0, double lat0, double dlon, double dlat, int cap)
+{
+	POINTARRAY *pa = ptarray_construct(0, 0, n + 1);
+	LWPOLY *poly = lwpoly_construct_empty(4326, 0, 0);
+	POINT4D pt = {0, 0, 0, 0};
+	LWGEOM *geom;
+	uint32_t i;
+
+	for (i = 0; i <= n; i++)
+	{
+		double a = 2 * M_PI * (i % n) / n;
+		if (cap)
+		{
+			pt.x = -180.0 + 360.0 * (i % n) / n;
+			pt.y = lat0;
+		}
+		else
+		{
+			pt.x = lon0 + dlon * cos(a);
+			pt.y = lat0 + dlat * sin(a);
+		}
+		if (pt.x > 180.0)
+			pt.x -= 360.0;
+		ptarray_set_point4d(pa, i, &pt);
+	}
+	lwpoly_add_ring(poly, pa);
+	geom = lwpoly_as_lwgeom(poly);
+	lwgeom_set_geodetic(geom, LW_TRUE);
+	return geom;
+}
+
+/* Full scan and cached tree covers must agree, and match expected when given */
+static void
+cu_covers_check(const LWGEOM *poly, double lon, double lat, int expected)
+{
+	LWGEOM *pt = lwpoint_as_lwgeom(lwpoint_make2d(4326, lon, lat));
+	int plain, cached, tree;
+
+	lwgeom_set_geodetic(pt, LW_TRUE);
+	plain = lwgeom_covers_lwgeom_sphere_uncached(poly, pt);
+	cached = lwgeom_covers_lwgeom_sphere(poly, pt);
+	tree = lwgeom_covers_point_sphere_tree(poly, pt);
+	if (plain != cached || plain != tree)
+		fprintf(stderr, "[%s:%d]\n POINT(%.17g %.17g): %d %d %d\n", __FILE__, __LINE__, lon, lat, plain, cached, tree);
+	CU_ASSERT_EQUAL(cached, plain);
+	CU_ASSERT_EQUAL(tree, plain);
+	if (expected >= 0)
+		CU_ASSERT_EQUAL(cached, expected);
+	lwgeom_free(pt);
+}
+
+static void
+test_circ_tree_covers_agree(void)
+{
+	LWGEOM *ellipse = cu_circ_ring(200, 10, 45, 20, 10, LW_FALSE);
+	LWGEOM *dateline = cu_circ_ring(200, 180, -20, 15, 8, LW_FALSE);
+	LWGEOM *cap = cu_circ_ring(100, 0, 80, 0, 0, LW_TRUE);
+	const POINTARRAY *pa;
+	uint64_t hits, misses;
+	uint32_t i;
+
+	circ_tree_cache_destroy();
+
+	cu_covers_check(ellipse, 10, 45, LW_TRUE);
+	cu_covers_check(ellipse, 29, 45, LW_TRUE);
+	cu_covers_check(ellipse, 31, 45, LW_FALSE);
+	cu_covers_check(ellipse, 10, 56, LW_FALSE);
+	cu_covers_check(ellipse, -170, -45, LW_FALSE);
+
+	/* Across the antimeridian */
+	cu_covers_check(dateline, 180, -20, LW_TRUE);
+	cu_covers_check(dateline, -180, -20, LW_TRUE);
+	cu_covers_check(dateline, 175, -22, LW_TRUE);
+	cu_covers_check(dateline, -172, -18, LW_TRUE);
+	cu_covers_check(dateline, 160, -20, LW_FALSE);
+	cu_covers_check(dateline, -160, -20, LW_FALSE);
+	cu_covers_check(dateline, 0, 20, LW_FALSE);
+
+	/* Around the north pole */
+	cu_covers_check(cap, 0, 90, LW_TRUE);
+	cu_covers_check(cap, 123, 85, LW_TRUE);
+	cu_covers_check(cap, -45, 80.5, LW_TRUE);
+	cu_covers_check(cap, 45, 75, LW_FALSE);
+	cu_covers_check(cap, 0, -90, LW_FALSE);
+
+	/* Boundary: every vertex */
+	pa = lwgeom_as_lwpoly(ellipse)->rings[0];
+	for (i = 0; i < pa->npoints; i += 7)
+	{
+		const POINT2D *p = getPoint2d_cp(pa, i);
+		cu_covers_check(ellipse, p->x, p->y, -1);
+	}
+	pa = lwgeom_as_lwpoly(dateline)->rings[0];
+	for (i = 0; i < pa->npoints; i += 7)
+	{
+		const POINT2D *p = getPoint2d_cp(pa, i);
+		cu_covers_check(dateline, p->x, p->y, -1);
+	}
+
+	/* Random points over the whole sphere */
+	srand(9);
+	for (i = 0; i < 300; i++)
+	{
+		double lon = -180.0 + 360.0 * rand() / RAND_MAX;
+		double lat = -90.0 + 180.0 * rand() / RAND_MAX;
+		cu_covers_check(ellipse, lon, lat, -1);
+		cu_covers_check(dateline, lon, lat, -1);
+		cu_covers_check(cap, lon, lat, -1);
+	}
+
+	/* One tree per polygon, shared by both entry points */
+	circ_tree_cache_stats(&hits, &misses, NULL);
+	CU_ASSERT_EQUAL(misses, 3);
+	CU_ASSERT(hits > 1000);
+
+	circ_tree_cache_destroy();
+	lwgeom_free(ellipse);
+	lwgeom_free(dateline);
+	lwgeom_free(cap);
+}
+
+static void
+test_circ_tree_distance_agree(void)
+{
+	LWGEOM *ellipse = cu_circ_ring(200, 170, 45, 20, 10, LW_FALSE);
+	SPHEROID s;
+	LWGEOM *small = lwgeom_from_wkt("LINESTRING(0 0,10 10)", LW_PARSER_CHECK_NONE);
+	uint64_t hits, misses;
+	uint32_t i;
+
+	lwgeom_set_geodetic(small, LW_TRUE);
+	spheroid_init(&s, WGS84_MAJOR_AXIS, WGS84_MINOR_AXIS);
+	circ_tree_cache_destroy();
+	srand(10);
+	for (i = 0; i < 100; i++)
+	{
+		LWGEOM *pt = lwpoint_as_lwgeom(lwpoint_make2d(4326,
+							      -180.0 + 360.0 * rand() / RAND_MAX,
+							      -90.0 + 180.0 * rand() / RAND_MAX));
+		double plain, tree;
+
+		lwgeom_set_geodetic(pt, LW_TRUE);
+		lwgeom_add_bbox(pt);
+		lwgeom_add_bbox(ellipse);
+		plain = lwgeom_distance_spheroid_uncached(ellipse, pt, &s, 0.0);
+		tree = lwgeom_distance_spheroid(ellipse, pt, &s, 0.0);
+		CU_ASSERT_DOUBLE_EQUAL(tree, plain, 1e-6 * (plain + 1.0));
+		CU_ASSERT_EQUAL(lwgeom_distance_spheroid(pt, ellipse, &s, 0.0), tree);
+		CU_ASSERT_EQUAL(lwgeom_distance_spheroid_tree(ellipse, pt, &s, 0.0), tree);
+		/* Small inputs keep the full scan */
+		CU_ASSERT_EQUAL(lwgeom_distance_spheroid(small, pt, &s, 0.0), lwgeom_distance_spheroid_uncached(small, pt, &s, 0.0));
+		CU_ASSERT_EQUAL(lwgeom_dwithin_spheroid_tree(ellipse, pt, &s, plain + 1.0), LW_TRUE);
+		if (plain > 2.0)
+			CU_ASSERT_EQUAL(lwgeom_dwithin_spheroid_tree(ellipse, pt, &s, plain - 1.0), LW_FALSE);
+		lwgeom_free(pt);
+	}
+
+	/* The ellipse tree was built once */
+	circ_tree_cache_stats(&hits, &misses, NULL);
+	CU_ASSERT_EQUAL(misses, 1);
+	CU_ASSERT(hits >= 300);
+
+	circ_tree_cache_destroy();
+	lwgeom_free(ellipse);
+	lwgeom_free(small);
+}
+
+static void
+test_circ_tree_cache_collision(void)
+{
+	LWGEOM *plain = cu_circ_ring(200, 10, 45, 20, 10, LW_FALSE);
+	LWGEOM *spiked = cu_circ_ring(200, 10, 45, 20, 10, LW_FALSE);
+	LWGEOM *probe;
+	POINT4D p = {9.7, 65, 0, 0};
+	uint64_t hits, misses;
+	int i;
+
+	/* A spike at vertex 51, which is not part of the cache key sample */
+	ptarray_set_point4d(lwgeom_as_lwpoly(spiked)->rings[0], 51, &p);
+	probe = lwpoint_as_lwgeom(lwpoint_make2d(4326, 9.7, 58));
+	lwgeom_set_geodetic(probe, LW_TRUE);
+
+	circ_tree_cache_destroy();
+	for (i = 0; i < 3; i++)
+	{
+		CU_ASSERT_EQUAL(lwgeom_covers_point_sphere_tree(plain, probe), LW_FALSE);
+		CU_ASSERT_EQUAL(lwgeom_covers_point_sphere_tree(spiked, probe), LW_TRUE);
+	}
+	circ_tree_cache_stats(&hits, &misses, NULL);
+	CU_ASSERT_EQUAL(misses, 2);
+	CU_ASSERT_EQUAL(hits, 4);
+
+	circ_tree_cache_destroy();
+	lwgeom_free(plain);
+	lwgeom_free(spiked);
+	lwgeom_free(probe);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void circ_tree_cache_suite_setup(void);
+void circ_tree_cache_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("circ_tree_cache", NULL, NULL);
+	PG_ADD_TEST(suite, test_circ_tree_covers_agree);
+	PG_ADD_TEST(suite, test_circ_tree_distance_agree);
+	PG_ADD_TEST(suite, test_circ_tree_cache_collision);
+}
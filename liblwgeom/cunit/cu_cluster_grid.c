@@ -0,0 +1,370 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "lwgeom_geos.h"
+#include "lwunionfind.h"
+#include "cu_tester.h"
+
+/* Points in blobs, with duplicates and empties */
+static LWGEOM **
+cu_grid_points(uint32_t n, double side)
+{
+	LWGEOM **geoms = lwalloc(n * sizeof(LWGEOM *));
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		double x = side * rand() / RAND_MAX;
+		double y = side * rand() / RAND_MAX;
+
+		if (i % 211 == 3)
+			geoms[i] = lwpoint_as_lwgeom(lwpoint_construct_empty(SRID_UNKNOWN, 0, 0));
+		else if (i % 13 == 5)
+			geoms[i] = lwgeom_clone_deep(geoms[i - 1]);
+		else
+			geoms[i] = lwpoint_as_lwgeom(lwpoint_make2d(SRID_UNKNOWN, x, y));
+	}
+	return geoms;
+}
+
+static void
+cu_grid_free_points(LWGEOM **geoms, uint32_t n)
+{
+	uint32_t i;
+	for (i = 0; i < n; i++)
+		lwgeom_free(geoms[i]);
+	lwfree(geoms);
+}
+
+/* Both union-finds have the same clusters, whatever their roots */
+static void
+cu_grid_check_partition(UNIONFIND *uf1, UNIONFIND *uf2, uint32_t n)
+{
+	uint32_t *map1 = lwalloc(n * sizeof(uint32_t));
+	uint32_t *map2 = lwalloc(n * sizeof(uint32_t));
+	uint32_t i, bad = 0;
+
+	memset(map1, 0xFF, n * sizeof(uint32_t));
+	memset(map2, 0xFF, n * sizeof(uint32_t));
+	for (i = 0; i < n; i++)
+	{
+		uint32_t r1 = UF_find(uf1, i), r2 = UF_find(uf2, i);
+		if (map1[r1] == UINT32_MAX)
+			map1[r1] = r2;
+		if (map2[r2] == UINT32_MAX)
+			map2[r2] = r1;
+		if (map1[r1] != r2 || map2[r2] != r1)
+			bad++;
+	}
+	CU_ASSERT_EQUAL(bad, 0);
+	CU_ASSERT_EQUAL(uf1->num_clusters, uf2->num_clusters);
+	lwfree(map1);
+	lwfree(map2);
+}
+
+/* Same roots, hence the same cluster ids */
+static void
+cu_grid_check_same(UNIONFIND *uf1, UNIONFIND *uf2, uint32_t n)
+{
+	uint32_t *ids1 = UF_get_collapsed_cluster_ids(uf1, NULL);
+	uint32_t *ids2 = UF_get_collapsed_cluster_ids(uf2, NULL);
+	uint32_t i, same_roots = 0, same_ids = 0;
+
+	for (i = 0; i < n; i++)
+	{
+		if (UF_find(uf1, i) == UF_find(uf2, i))
+			same_roots++;
+		if (ids1[i] == ids2[i])
+			same_ids++;
+	}
+	CU_ASSERT_EQUAL(same_roots, n);
+	CU_ASSERT_EQUAL(same_ids, n);
+	lwfree(ids1);
+	lwfree(ids2);
+}
+
+/* Every pair within eps, with the arithmetic of lw_dist2d_pt_pt */
+static UNIONFIND *
+cu_grid_brute_force(LWGEOM **geoms, uint32_t n, double eps)
+{
+	UNIONFIND *uf = UF_create(n);
+	uint32_t i, j;
+
+	for (i = 0; i < n; i++)
+	{
+		const POINT2D *p;
+		if (lwgeom_is_empty(geoms[i]))
+			continue;
+		p = getPoint2d_cp(lwgeom_as_lwpoint(geoms[i])->point, 0);
+		for (j = i + 1; j < n; j++)
+		{
+			const POINT2D *q;
+			double h, v;
+			if (lwgeom_is_empty(geoms[j]))
+				continue;
+			q = getPoint2d_cp(lwgeom_as_lwpoint(geoms[j])->point, 0);
+			h = q->x - p->x;
+			v = q->y - p->y;
+			if (sqrt(h * h + v * v) <= eps)
+				UF_union(uf, i, j);
+		}
+	}
+	return uf;
+}
+
+static void
+test_cluster_grid_threads(void)
+{
+	uint32_t sizes[] = {3000, 4 * LW_CLUSTER_PARALLEL_MIN_GEOMS + 10, 70000};
+	uint32_t threads[] = {2, 3, 4, 0};
+	uint32_t s, t;
+
+	srand(15);
+	for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+	{
+		uint32_t n = sizes[s];
+		LWGEOM **geoms = cu_grid_points(n, sqrt((double)n) * 1.5);
+		UNIONFIND *uf = UF_create(n);
+		char *in = NULL;
+		uint32_t i, in_count = 0;
+
+		CU_ASSERT_EQUAL(union_dbscan_parallel(geoms, n, uf, 1.0, 1, &in, 1), LW_SUCCESS);
+		CU_ASSERT(uf->num_clusters > 1 && uf->num_clusters < n);
+		for (i = 0; i < n; i++)
+			in_count += in[i] ? 1 : 0;
+		CU_ASSERT_EQUAL(in_count, n);
+
+		for (t = 0; t < sizeof(threads) / sizeof(threads[0]); t++)
+		{
+			UNIONFIND *uf_par = UF_create(n);
+			CU_ASSERT_EQUAL(union_dbscan_parallel(geoms, n, uf_par, 1.0, 1, NULL, threads[t]), LW_SUCCESS);
+			cu_grid_check_same(uf, uf_par, n);
+			UF_destroy(uf_par);
+		}
+
+		/* The grid finds the pairs a full scan finds */
+		if (n <= 5000)
+		{
+			UNIONFIND *uf_brute = cu_grid_brute_force(geoms, n, 1.0);
+			cu_grid_check_partition(uf, uf_brute, n);
+			UF_destroy(uf_brute);
+		}
+
+		lwfree(in);
+		UF_destroy(uf);
+		cu_grid_free_points(geoms, n);
+	}
+}
+
+static void
+test_cluster_grid_edges(void)
+{
+	uint32_t n = 2000, i;
+	LWGEOM **geoms;
+	UNIONFIND *uf, *uf_brute;
+
+	/* Points exactly eps apart, on cell boundaries, are neighbours */
+	geoms = lwalloc(n * sizeof(LWGEOM *));
+	for (i = 0; i < n; i++)
+		geoms[i] = lwpoint_as_lwgeom(lwpoint_make2d(SRID_UNKNOWN, (i % 40) * 0.5, (i / 40) * 0.75));
+	uf = UF_create(n);
+	CU_ASSERT_EQUAL(union_dbscan_parallel(geoms, n, uf, 0.5, 1, NULL, 2), LW_SUCCESS);
+	uf_brute = cu_grid_brute_force(geoms, n, 0.5);
+	cu_grid_check_partition(uf, uf_brute, n);
+	CU_ASSERT_EQUAL(uf->num_clusters, 50);
+	UF_destroy(uf);
+	UF_destroy(uf_brute);
+
+	/* Coordinates far from the origin, against a small eps */
+	for (i = 0; i < n; i++)
+	{
+		lwgeom_free(geoms[i]);
+		geoms[i] = lwpoint_as_lwgeom(lwpoint_make2d(SRID_UNKNOWN, 1e6 + (i % 40) * 0.01, -1e6 + (i / 40) * 0.02));
+	}
+	uf = UF_create(n);
+	CU_ASSERT_EQUAL(union_dbscan_parallel(geoms, n, uf, 0.015, 1, NULL, 3), LW_SUCCESS);
+	uf_brute = cu_grid_brute_force(geoms, n, 0.015);
+	cu_grid_check_partition(uf, uf_brute, n);
+	UF_destroy(uf);
+	UF_destroy(uf_brute);
+
+	/* All in one place */
+	for (i = 0; i < n; i++)
+	{
+		lwgeom_free(geoms[i]);
+		geoms[i] = lwpoint_as_lwgeom(lwpoint_make2d(SRID_UNKNOWN, 3, 4));
+	}
+	uf = UF_create(n);
+	CU_ASSERT_EQUAL(union_dbscan_parallel(geoms, n, uf, 0.5, 1, NULL, 4), LW_SUCCESS);
+	CU_ASSERT_EQUAL(uf->num_clusters, 1);
+	UF_destroy(uf);
+
+	cu_grid_free_points(geoms, n);
+}
+
+/* Clusters numbered in the order of their lowest input */
+static void
+cu_grid_check_canonical(UNIONFIND *uf, uint32_t n)
+{
+	uint32_t *ids = UF_get_collapsed_cluster_ids(uf, NULL);
+	uint32_t i, next = 0, bad = 0;
+
+	for (i = 0; i < n; i++)
+	{
+		if (UF_find(uf, i) > i)
+			bad++;
+		if (UF_find(uf, i) == i && ids[i] != next++)
+			bad++;
+	}
+	CU_ASSERT_EQUAL(bad, 0);
+	CU_ASSERT_EQUAL(next, uf->num_clusters);
+	lwfree(ids);
+}
+
+static void
+test_cluster_grid_normalize(void)
+{
+	UNIONFIND *uf = UF_create(6);
+	uint32_t *ids;
+
+	/* Roots chosen by size, then by lowest root: 5 and 3 */
+	UF_union(uf, 5, 4);
+	UF_union(uf, 4, 1);
+	UF_union(uf, 3, 2);
+	UF_union(uf, 2, 0);
+	UF_normalize(uf);
+	CU_ASSERT_EQUAL(uf->num_clusters, 2);
+	CU_ASSERT_EQUAL(UF_find(uf, 5), 1);
+	CU_ASSERT_EQUAL(UF_find(uf, 2), 0);
+	CU_ASSERT_EQUAL(UF_size(uf, 4), 3);
+	CU_ASSERT_EQUAL(UF_size(uf, 3), 3);
+	ids = UF_get_collapsed_cluster_ids(uf, NULL);
+	CU_ASSERT_EQUAL(ids[0], 0);
+	CU_ASSERT_EQUAL(ids[1], 1);
+	CU_ASSERT_EQUAL(ids[3], 0);
+	CU_ASSERT_EQUAL(ids[5], 1);
+	lwfree(ids);
+
+	/* Unions keep working on the normalized roots */
+	UF_union(uf, 5, 3);
+	CU_ASSERT_EQUAL(uf->num_clusters, 1);
+	CU_ASSERT_EQUAL(UF_size(uf, 0), 6);
+	UF_normalize(uf);
+	CU_ASSERT_EQUAL(UF_find(uf, 4), 0);
+	UF_destroy(uf);
+}
+
+/*
+ * The same points as one point multipoints go through the tree path,
+ * which has to give the ids of the grid, single threaded or not.
+ */
+static void
+test_cluster_grid_tree(void)
+{
+	uint32_t n = 5000, i, k;
+	LWGEOM **geoms, **multis;
+	UNIONFIND *uf, *uf_seq, *uf_tree, *uf_brute;
+	LWGEOM **clusters = NULL, **clusters_tree = NULL;
+	uint32_t num_clusters = 0, num_clusters_tree = 0;
+
+	srand(16);
+	geoms = cu_grid_points(n, 100);
+	multis = lwalloc(n * sizeof(LWGEOM *));
+	for (i = 0; i < n; i++)
+	{
+		LWMPOINT *mp = lwmpoint_construct_empty(SRID_UNKNOWN, 0, 0);
+		if (!lwgeom_is_empty(geoms[i]))
+			lwmpoint_add_lwpoint(mp, lwgeom_as_lwpoint(lwgeom_clone_deep(geoms[i])));
+		multis[i] = lwmpoint_as_lwgeom(mp);
+	}
+
+	uf = UF_create(n);
+	uf_seq = UF_create(n);
+	uf_tree = UF_create(n);
+	CU_ASSERT_EQUAL(union_dbscan_parallel(geoms, n, uf, 1.0, 1, NULL, 2), LW_SUCCESS);
+	CU_ASSERT_EQUAL(union_dbscan(geoms, n, uf_seq, 1.0, 1, NULL), LW_SUCCESS);
+	CU_ASSERT_EQUAL(union_dbscan(multis, n, uf_tree, 1.0, 1, NULL), LW_SUCCESS);
+	cu_grid_check_canonical(uf, n);
+	cu_grid_check_same(uf, uf_seq, n);
+	cu_grid_check_same(uf, uf_tree, n);
+
+	/* Same as the full scan, once numbered the same way */
+	uf_brute = cu_grid_brute_force(geoms, n, 1.0);
+	UF_normalize(uf_brute);
+	cu_grid_check_same(uf, uf_brute, n);
+
+	/* Same collections out of cluster_within_distance */
+	CU_ASSERT_EQUAL(cluster_within_distance(geoms, n, 1.0, &clusters, &num_clusters), LW_SUCCESS);
+	CU_ASSERT_EQUAL(cluster_within_distance(multis, n, 1.0, &clusters_tree, &num_clusters_tree), LW_SUCCESS);
+	CU_ASSERT_EQUAL(num_clusters, uf->num_clusters);
+	CU_ASSERT_EQUAL(num_clusters, num_clusters_tree);
+	for (k = 0; k < num_clusters && k < num_clusters_tree; k++)
+	{
+		LWCOLLECTION *c = lwgeom_as_lwcollection(clusters[k]);
+		LWCOLLECTION *c_tree = lwgeom_as_lwcollection(clusters_tree[k]);
+		CU_ASSERT_EQUAL(c->ngeoms, c_tree->ngeoms);
+		for (i = 0; i < c->ngeoms && i < c_tree->ngeoms; i++)
+		{
+			if (lwgeom_is_empty(c->geoms[i]))
+				CU_ASSERT(lwgeom_is_empty(c_tree->geoms[i]));
+			else
+				CU_ASSERT(lwgeom_same(c->geoms[i], lwcollection_getsubgeom((LWCOLLECTION *)c_tree->geoms[i], 0)));
+		}
+	}
+	/* The parts are the inputs */
+	for (k = 0; k < num_clusters; k++)
+	{
+		lwfree(lwgeom_as_lwcollection(clusters[k])->geoms);
+		lwcollection_release(lwgeom_as_lwcollection(clusters[k]));
+	}
+	for (k = 0; k < num_clusters_tree; k++)
+	{
+		lwfree(lwgeom_as_lwcollection(clusters_tree[k])->geoms);
+		lwcollection_release(lwgeom_as_lwcollection(clusters_tree[k]));
+	}
+	lwfree(clusters);
+	lwfree(clusters_tree);
+
+	UF_destroy(uf);
+	UF_destroy(uf_seq);
+	UF_destroy(uf_tree);
+	UF_destroy(uf_brute);
+	cu_grid_free_points(geoms, n);
+	cu_grid_free_points(multis, n);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void cluster_grid_suite_setup(void);
+void cluster_grid_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("cluster_grid", NULL, NULL);
+	PG_ADD_TEST(suite, test_cluster_grid_threads);
+	PG_ADD_TEST(suite, test_cluster_grid_edges);
+	PG_ADD_TEST(suite, test_cluster_grid_normalize);
+	PG_ADD_TEST(suite, test_cluster_grid_tree);
+}
@@ -0,0 +1,209 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "lwgeom_geos.h"
+#include "lwunionfind.h"
+#include "cu_tester.h"
+
+/* Short lines, points, small polygons and empties over [0,side) x [0,side) */
+static LWGEOM **
+cu_cluster_geoms(uint32_t n, double side)
+{
+	LWGEOM **geoms = lwalloc(n * sizeof(LWGEOM *));
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		double x = side * rand() / RAND_MAX;
+		double y = side * rand() / RAND_MAX;
+		char wkt[256];
+
+		if (i % 97 == 5)
+			snprintf(wkt, sizeof(wkt), "LINESTRING EMPTY");
+		else if (i % 3 == 0)
+			snprintf(wkt, sizeof(wkt), "POINT(%.4f %.4f)", x, y);
+		else if (i % 3 == 1)
+			snprintf(wkt, sizeof(wkt), "LINESTRING(%.4f %.4f,%.4f %.4f)", x, y, x + 0.4, y + 0.3);
+		else
+			snprintf(wkt, sizeof(wkt), "POLYGON((%.4f %.4f,%.4f %.4f,%.4f %.4f,%.4f %.4f))",
+				 x, y, x + 0.3, y, x + 0.3, y + 0.3, x, y);
+		geoms[i] = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+	}
+	return geoms;
+}
+
+static void
+cu_cluster_free_geoms(LWGEOM **geoms, uint32_t n)
+{
+	uint32_t i;
+	for (i = 0; i < n; i++)
+		lwgeom_free(geoms[i]);
+	lwfree(geoms);
+}
+
+/* The collections, but not their parts, which are the inputs */
+static void
+cu_cluster_free_clusters(LWGEOM **clusters, uint32_t num_clusters)
+{
+	uint32_t i;
+	for (i = 0; i < num_clusters; i++)
+	{
+		lwfree(lwgeom_as_lwcollection(clusters[i])->geoms);
+		lwcollection_release(lwgeom_as_lwcollection(clusters[i]));
+	}
+	lwfree(clusters);
+}
+
+/* Same roots, same membership, same cluster ids */
+static void
+cu_cluster_check_same(UNIONFIND *uf1, char *in1, UNIONFIND *uf2, char *in2, uint32_t n)
+{
+	uint32_t *ids1 = UF_get_collapsed_cluster_ids(uf1, in1);
+	uint32_t *ids2 = UF_get_collapsed_cluster_ids(uf2, in2);
+	uint32_t i, roots = 0, same_roots = 0, same_in = 0, same_ids = 0;
+
+	for (i = 0; i < n; i++)
+	{
+		if (UF_find(uf1, i) == i)
+			roots++;
+		if (UF_find(uf1, i) == UF_find(uf2, i))
+			same_roots++;
+		if (!in1 || !in2 || in1[i] == in2[i])
+			same_in++;
+		if (ids1[i] == ids2[i])
+			same_ids++;
+	}
+	CU_ASSERT_EQUAL(same_roots, n);
+	CU_ASSERT_EQUAL(same_in, n);
+	CU_ASSERT_EQUAL(same_ids, n);
+	/* Neither everything in one cluster nor nothing clustered */
+	CU_ASSERT(roots > 1 && roots < n);
+
+	lwfree(ids1);
+	lwfree(ids2);
+}
+
+static void
+test_cluster_dbscan_parallel(void)
+{
+	uint32_t n = 4 * LW_CLUSTER_PARALLEL_MIN_GEOMS + 100;
+	uint32_t min_points[] = {1, 3};
+	uint32_t threads[] = {2, 4};
+	LWGEOM **geoms;
+	uint32_t i, j;
+
+	srand(13);
+	geoms = cu_cluster_geoms(n, 120);
+
+	for (i = 0; i < sizeof(min_points) / sizeof(min_points[0]); i++)
+	{
+		UNIONFIND *uf = UF_create(n);
+		char *in = NULL;
+
+		CU_ASSERT_EQUAL(union_dbscan(geoms, n, uf, 0.2, min_points[i], &in), LW_SUCCESS);
+		for (j = 0; j < sizeof(threads) / sizeof(threads[0]); j++)
+		{
+			UNIONFIND *uf_par = UF_create(n);
+			char *in_par = NULL;
+
+			CU_ASSERT_EQUAL(union_dbscan_parallel(geoms, n, uf_par, 0.2, min_points[i], &in_par, threads[j]), LW_SUCCESS);
+			cu_cluster_check_same(uf, in, uf_par, in_par, n);
+			UF_destroy(uf_par);
+			lwfree(in_par);
+		}
+		UF_destroy(uf);
+		lwfree(in);
+	}
+
+	cu_cluster_free_geoms(geoms, n);
+}
+
+static void
+test_cluster_intersecting_parallel(void)
+{
+	uint32_t n = 2 * LW_CLUSTER_PARALLEL_MIN_GEOMS + 100;
+	LWGEOM **geoms;
+	GEOSGeometry **g;
+	UNIONFIND *uf, *uf_par;
+	uint32_t i;
+
+	srand(14);
+	geoms = cu_cluster_geoms(n, 80);
+	g = lwalloc(n * sizeof(GEOSGeometry *));
+	for (i = 0; i < n; i++)
+		g[i] = LWGEOM2GEOS(geoms[i], 0);
+
+	uf = UF_create(n);
+	uf_par = UF_create(n);
+	CU_ASSERT_EQUAL(union_intersecting_pairs(g, n, uf), LW_SUCCESS);
+	CU_ASSERT_EQUAL(union_intersecting_pairs_parallel(g, n, uf_par, 2), LW_SUCCESS);
+	cu_cluster_check_same(uf, NULL, uf_par, NULL, n);
+
+	UF_destroy(uf);
+	UF_destroy(uf_par);
+	for (i = 0; i < n; i++)
+		GEOSGeom_destroy_r(lwcontext()->geos_ctx, g[i]);
+	lwfree(g);
+	cu_cluster_free_geoms(geoms, n);
+}
+
+static void
+test_cluster_within_distance_parallel(void)
+{
+	uint32_t n = 2 * LW_CLUSTER_PARALLEL_MIN_GEOMS + 100;
+	LWGEOM **geoms, **clusters = NULL, **clusters_par = NULL;
+	uint32_t num_clusters = 0, num_clusters_par = 0, i;
+
+	srand(15);
+	geoms = cu_cluster_geoms(n, 120);
+
+	CU_ASSERT_EQUAL(cluster_within_distance(geoms, n, 0.2, &clusters, &num_clusters), LW_SUCCESS);
+	CU_ASSERT_EQUAL(cluster_within_distance_parallel(geoms, n, 0.2, &clusters_par, &num_clusters_par, 2), LW_SUCCESS);
+	CU_ASSERT_EQUAL(num_clusters, num_clusters_par);
+	for (i = 0; i < num_clusters && i < num_clusters_par; i++)
+		CU_ASSERT(lwgeom_same(clusters[i], clusters_par[i]));
+
+	/* Small inputs take the single threaded path */
+	cu_cluster_free_clusters(clusters, num_clusters);
+	cu_cluster_free_clusters(clusters_par, num_clusters_par);
+	CU_ASSERT_EQUAL(cluster_within_distance_parallel(geoms, 50, 0.2, &clusters_par, &num_clusters_par, 4), LW_SUCCESS);
+	CU_ASSERT(num_clusters_par > 0 && num_clusters_par <= 50);
+	cu_cluster_free_clusters(clusters_par, num_clusters_par);
+
+	cu_cluster_free_geoms(geoms, n);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void cluster_parallel_suite_setup(void);
+void cluster_parallel_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("cluster_parallel", NULL, NULL);
+	PG_ADD_TEST(suite, test_cluster_dbscan_parallel);
+	PG_ADD_TEST(suite, test_cluster_intersecting_parallel);
+	PG_ADD_TEST(suite, test_cluster_within_distance_parallel);
+}
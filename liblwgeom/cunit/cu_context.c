@@ -0,0 +1,180 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "cu_tester.h"
+
+/* Counting handlers, installed on the current context only */
+static int ctx_allocs = 0;
+static int ctx_reallocs = 0;
+static int ctx_frees = 0;
+static int ctx_debugs = 0;
+static char ctx_error_msg[MAX_CUNIT_ERROR_LENGTH + 1];
+
+static void *
+ctx_allocator(size_t size)
+{
+	ctx_allocs++;
+	return malloc(size);
+}
+
+static void *
+ctx_reallocator(void *mem, size_t size)
+{
+	ctx_reallocs++;
+	return realloc(mem, size);
+}
+
+static void
+ctx_freeor(void *mem)
+{
+	/* The WKT lexer hands NULL back on cleanup */
+	if (mem)
+		ctx_frees++;
+	free(mem);
+}
+
+static void
+ctx_errorreporter(const char *fmt, va_list ap)
+{
+	vsnprintf(ctx_error_msg, MAX_CUNIT_ERROR_LENGTH, fmt, ap);
+}
+
+static void
+ctx_debuglogger(int level, const char *fmt, va_list ap)
+{
+	(void)level;
+	(void)fmt;
+	(void)ap;
+	ctx_debugs++;
+}
+
+static void
+ctx_counters_reset(void)
+{
+	ctx_allocs = ctx_reallocs = ctx_frees = ctx_debugs = 0;
+	ctx_error_msg[0] = '\0';
+}
+
+static void
+test_context_memory(void)
+{
+	LWGEOM_CONTEXT *ctx = lwcontext();
+	LWGEOM *geom;
+	void *mem;
+
+	ctx_counters_reset();
+	lwcontext_set_handlers(ctx, ctx_allocator, ctx_reallocator, ctx_freeor, NULL, NULL);
+
+	mem = lwalloc(32);
+	CU_ASSERT_EQUAL(ctx_allocs, 1);
+	mem = lwrealloc(mem, 64);
+	CU_ASSERT_EQUAL(ctx_reallocs, 1);
+	lwfree(mem);
+	CU_ASSERT_EQUAL(ctx_frees, 1);
+
+	/* Whole geometries go through the context handlers, balanced */
+	ctx_counters_reset();
+	geom = lwgeom_from_wkt("POLYGON((0 0,1 0,1 1,0 0))", LW_PARSER_CHECK_NONE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(geom);
+	CU_ASSERT(ctx_allocs > 0);
+	lwgeom_free(geom);
+	CU_ASSERT_EQUAL(ctx_allocs, ctx_frees);
+
+	/* Arena blocks come from the handlers of the context */
+	ctx_counters_reset();
+	{
+		LWARENA *arena = lwarena_create(0);
+		LWARENA_SCOPE scope;
+		int allocs;
+
+		lwarena_push(arena, &scope);
+		geom = lwgeom_from_wkt("LINESTRING(0 0,1 1,2 2)", LW_PARSER_CHECK_NONE);
+		CU_ASSERT_PTR_NOT_NULL(geom);
+		lwgeom_free(geom);
+		allocs = ctx_allocs;
+		lwarena_pop(&scope);
+		/* Arena itself plus at least one block */
+		CU_ASSERT(allocs >= 2);
+		lwarena_destroy(arena);
+		CU_ASSERT_EQUAL(ctx_allocs, ctx_frees);
+	}
+
+	/* NULL falls back to the process wide handlers */
+	lwcontext_set_handlers(ctx, NULL, NULL, NULL, NULL, NULL);
+	ctx_counters_reset();
+	mem = lwalloc(16);
+	lwfree(mem);
+	CU_ASSERT_EQUAL(ctx_allocs, 0);
+	CU_ASSERT_EQUAL(ctx_frees, 0);
+}
+
+static void
+test_context_reporters(void)
+{
+	LWGEOM_CONTEXT *ctx = lwcontext();
+	LWGEOM *geom;
+
+	/* Context error reporter takes precedence over the global one */
+	ctx_counters_reset();
+	cu_error_msg_reset();
+	lwcontext_set_handlers(ctx, NULL, NULL, NULL, ctx_errorreporter, NULL);
+	lwerror("context %d", 1);
+	CU_ASSERT_STRING_EQUAL(ctx_error_msg, "context 1");
+	CU_ASSERT_STRING_EQUAL(cu_error_msg, "");
+
+	/* Parser errors use it too */
+	geom = lwgeom_from_wkt("POINT(0 0", LW_PARSER_CHECK_NONE);
+	CU_ASSERT_PTR_NULL(geom);
+	CU_ASSERT(ctx_error_msg[0] != '\0');
+
+	/* And the global one comes back when the slot is cleared */
+	ctx_counters_reset();
+	lwcontext_set_handlers(ctx, NULL, NULL, NULL, NULL, NULL);
+	lwerror("global %d", 2);
+	CU_ASSERT_STRING_EQUAL(cu_error_msg, "global 2");
+	CU_ASSERT_STRING_EQUAL(ctx_error_msg, "");
+	cu_error_msg_reset();
+
+	/* Debug logger */
+	lwcontext_set_debuglogger(ctx, ctx_debuglogger);
+	lwdebug(1, "debug %d", 3);
+	CU_ASSERT_EQUAL(ctx_debugs, 1);
+	lwcontext_set_debuglogger(ctx, NULL);
+	lwdebug(1, "debug %d", 4);
+	CU_ASSERT_EQUAL(ctx_debugs, 1);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void context_suite_setup(void);
+void context_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("context", NULL, NULL);
+	PG_ADD_TEST(suite, test_context_memory);
+	PG_ADD_TEST(suite, test_context_reporters);
+}
@@ -0,0 +1,156 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "lwcpu.h"
+#include "cu_tester.h"
+
+static const LWCPU_KERNEL *cu_cpu_kernels[] = {&gbox_minmax_kernels, &twkb_quantize_kernels};
+
+static void
+test_cpu_names(void)
+{
+	LW_CPU_LEVEL level, parsed;
+	int l;
+
+	for (l = LW_CPU_SCALAR; l < LW_CPU_NUM_LEVELS; l++)
+	{
+		const char *name = lwcpu_level_name((LW_CPU_LEVEL)l);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(name);
+		CU_ASSERT_EQUAL(lwcpu_level_from_name(name, &parsed), LW_SUCCESS);
+		CU_ASSERT_EQUAL(parsed, l);
+	}
+	ASSERT_STRING_EQUAL(lwcpu_level_name(LW_CPU_SSE42), "sse4.2");
+	ASSERT_STRING_EQUAL(lwcpu_level_name(LW_CPU_AVX512), "avx512");
+
+	/* Names are case insensitive */
+	CU_ASSERT_EQUAL(lwcpu_level_from_name("AVX2", &level), LW_SUCCESS);
+	CU_ASSERT_EQUAL(level, LW_CPU_AVX2);
+	CU_ASSERT_EQUAL(lwcpu_level_from_name("Scalar", &level), LW_SUCCESS);
+	CU_ASSERT_EQUAL(level, LW_CPU_SCALAR);
+
+	/* Unknown names and levels, the output is left alone */
+	level = LW_CPU_NEON;
+	CU_ASSERT_EQUAL(lwcpu_level_from_name("avx", &level), LW_FAILURE);
+	CU_ASSERT_EQUAL(lwcpu_level_from_name("", &level), LW_FAILURE);
+	CU_ASSERT_EQUAL(lwcpu_level_from_name(NULL, &level), LW_FAILURE);
+	CU_ASSERT_EQUAL(level, LW_CPU_NEON);
+	CU_ASSERT_PTR_NULL(lwcpu_level_name(LW_CPU_NUM_LEVELS));
+	CU_ASSERT_PTR_NULL(lwcpu_level_name((LW_CPU_LEVEL)-1));
+}
+
+static void
+test_cpu_set_level(void)
+{
+	LW_CPU_LEVEL detected = lwcpu_detected_level();
+	LW_CPU_LEVEL initial = lwcpu_level();
+	int l;
+
+	CU_ASSERT(detected >= LW_CPU_SCALAR && detected < LW_CPU_NUM_LEVELS);
+#if defined(__x86_64__) || defined(_M_X64)
+	/* SSE2 is part of x86-64 */
+	CU_ASSERT(detected >= LW_CPU_SSE2 && detected <= LW_CPU_AVX512);
+#endif
+
+	/* Scalar and the detected level are always allowed */
+	CU_ASSERT_EQUAL(lwcpu_set_level(LW_CPU_SCALAR), LW_SUCCESS);
+	CU_ASSERT_EQUAL(lwcpu_level(), LW_CPU_SCALAR);
+	CU_ASSERT_EQUAL(lwcpu_set_level(detected), LW_SUCCESS);
+	CU_ASSERT_EQUAL(lwcpu_level(), detected);
+
+	/* The x86 levels include the lower ones, NEON only scalar */
+	for (l = LW_CPU_SCALAR; l < LW_CPU_NUM_LEVELS; l++)
+	{
+		int supported = l == LW_CPU_SCALAR || l == (int)detected ||
+				(detected != LW_CPU_NEON && l != LW_CPU_NEON && l < (int)detected);
+		LW_CPU_LEVEL before = lwcpu_level();
+		CU_ASSERT_EQUAL(lwcpu_set_level((LW_CPU_LEVEL)l), supported ? LW_SUCCESS : LW_FAILURE);
+		/* A refused level is not an error and leaves the active one as it was */
+		CU_ASSERT_EQUAL(lwcpu_level(), supported ? (LW_CPU_LEVEL)l : before);
+		CU_ASSERT_EQUAL(cu_error_msg[0], '\0');
+	}
+
+	/* Out of range levels are an error */
+	lwcpu_set_level(detected);
+	cu_error_msg_reset();
+	CU_ASSERT_EQUAL(lwcpu_set_level(LW_CPU_NUM_LEVELS), LW_FAILURE);
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+	CU_ASSERT_EQUAL(lwcpu_set_level((LW_CPU_LEVEL)-1), LW_FAILURE);
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+	CU_ASSERT_EQUAL(lwcpu_level(), detected);
+
+	lwcpu_set_level(initial);
+}
+
+/* Every kernel points at the widest variant the active level allows */
+static void
+test_cpu_dispatch(void)
+{
+	LW_CPU_LEVEL initial = lwcpu_level();
+	size_t k;
+	int l, v;
+
+	for (l = LW_CPU_SCALAR; l < LW_CPU_NUM_LEVELS; l++)
+	{
+		if (lwcpu_set_level((LW_CPU_LEVEL)l) == LW_FAILURE)
+			continue;
+		for (k = 0; k < sizeof(cu_cpu_kernels) / sizeof(cu_cpu_kernels[0]); k++)
+		{
+			const LWCPU_KERNEL *kernel = cu_cpu_kernels[k];
+			lwcpu_function expected = NULL;
+
+			/* Supported levels below a NEON level are only scalar */
+			for (v = l; v >= LW_CPU_SCALAR && !expected; v--)
+			{
+				if (l == LW_CPU_NEON && v != LW_CPU_NEON && v != LW_CPU_SCALAR)
+					continue;
+				expected = kernel->variants[v];
+			}
+			CU_ASSERT_PTR_NOT_NULL(kernel->name);
+			CU_ASSERT(*kernel->dispatch == expected);
+		}
+	}
+
+	/* At the scalar level only the scalar variants run */
+	lwcpu_set_level(LW_CPU_SCALAR);
+	for (k = 0; k < sizeof(cu_cpu_kernels) / sizeof(cu_cpu_kernels[0]); k++)
+		CU_ASSERT(*cu_cpu_kernels[k]->dispatch == cu_cpu_kernels[k]->variants[LW_CPU_SCALAR]);
+
+	lwcpu_set_level(initial);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void cpu_suite_setup(void);
+void cpu_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("cpu", NULL, NULL);
+	PG_ADD_TEST(suite, test_cpu_names);
+	PG_ADD_TEST(suite, test_cpu_set_level);
+	PG_ADD_TEST(suite, test_cpu_dispatch);
+}
@@ -0,0 +1,311 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "stringbuffer.h"
+#include "cu_tester.h"
+
+typedef struct
+{
+	uint8_t *bytes;
+	size_t size;
+	size_t capacity;
+} cu_fgb_file;
+
+static int
+cu_fgb_sink(const uint8_t *bytes, size_t size, void *data)
+{
+	cu_fgb_file *f = data;
+	if (f->size + size > f->capacity)
+	{
+		f->capacity = 2 * (f->size + size);
+		f->bytes = lwrealloc(f->bytes, f->capacity);
+	}
+	memcpy(f->bytes + f->size, bytes, size);
+	f->size += size;
+	return LW_SUCCESS;
+}
+
+/* Write the geometries, a NULL one for a feature without geometry */
+static cu_fgb_file
+cu_fgb_write(const char **wkts, uint32_t n, int has_z, int has_m, uint16_t node_size)
+{
+	cu_fgb_file f = {NULL, 0, 0};
+	LWFLATGEOBUF_WRITER *w = lwflatgeobuf_writer_create(cu_fgb_sink, &f, "test", 4326, has_z, has_m, node_size);
+	LWPROPERTY p[3];
+	uint32_t i;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(w);
+	memset(p, 0, sizeof(p));
+	p[0].key = "name";
+	p[0].type = LWPROPERTY_STRING;
+	p[1].key = "n";
+	p[1].type = LWPROPERTY_INT;
+	p[2].key = "x";
+	p[2].type = LWPROPERTY_DOUBLE;
+	for (i = 0; i < n; i++)
+	{
+		LWGEOM *geom = wkts[i] ? lwgeom_from_wkt(wkts[i], LW_PARSER_CHECK_NONE) : NULL;
+		char name[16];
+		snprintf(name, sizeof(name), "f%u", i);
+		p[0].string_value = name;
+		p[1].int_value = (int64_t)i - 2;
+		p[2].double_value = i * 0.5;
+		CU_ASSERT_EQUAL(lwflatgeobuf_writer_feature(w, geom, p, 3), LW_SUCCESS);
+		if (geom)
+			lwgeom_free(geom);
+	}
+	CU_ASSERT_EQUAL(lwflatgeobuf_writer_finish(w), LW_SUCCESS);
+	lwflatgeobuf_writer_free(w);
+	return f;
+}
+
+/* One line per feature, its WKT and its properties */
+static int
+cu_fgb_collect(LWGEOM *geom, const LWPROPERTY *properties, uint32_t nproperties, void *data)
+{
+	stringbuffer_t *sb = data;
+	uint32_t i;
+
+	if (geom)
+	{
+		char *wkt = lwgeom_to_wkt(geom, WKT_ISO, 15, NULL);
+		stringbuffer_append(sb, wkt);
+		lwfree(wkt);
+		lwgeom_free(geom);
+	}
+	else
+		stringbuffer_append(sb, "NULL");
+	for (i = 0; i < nproperties; i++)
+	{
+		const LWPROPERTY *p = &properties[i];
+		if (p->type == LWPROPERTY_STRING)
+			stringbuffer_aprintf(sb, "|%s='%s'", p->key, p->string_value);
+		else if (p->type == LWPROPERTY_INT)
+			stringbuffer_aprintf(sb, "|%s=%lld", p->key, (long long)p->int_value);
+		else
+			stringbuffer_aprintf(sb, "|%s=%g", p->key, p->double_value);
+	}
+	stringbuffer_append_len(sb, "\n", 1);
+	return LW_TRUE;
+}
+
+static int
+cu_fgb_line_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Indexed files hold their features in the order of the index */
+static void
+cu_fgb_sort_lines(char *text)
+{
+	size_t n = 0, i, len = strlen(text);
+	char *copy = lwalloc(len + 1), **lines, *p;
+
+	memcpy(copy, text, len + 1);
+	for (p = copy; *p; p++)
+		n += *p == '\n';
+	lines = lwalloc((n + 1) * sizeof(char *));
+	for (i = 0, p = strtok(copy, "\n"); p; p = strtok(NULL, "\n"))
+		lines[i++] = p;
+	qsort(lines, i, sizeof(char *), cu_fgb_line_cmp);
+	for (p = text, n = i, i = 0; i < n; i++)
+		p += sprintf(p, "%s\n", lines[i]);
+	lwfree(lines);
+	lwfree(copy);
+}
+
+static char *
+cu_fgb_query(const cu_fgb_file *f, const GBOX *query, int64_t *count)
+{
+	LWFLATGEOBUF *fgb = lwflatgeobuf_open(f->bytes, f->size);
+	stringbuffer_t *sb = stringbuffer_create();
+	char *out;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(fgb);
+	*count = lwflatgeobuf_query(fgb, query, cu_fgb_collect, sb);
+	lwflatgeobuf_close(fgb);
+	out = stringbuffer_getstringcopy(sb);
+	cu_fgb_sort_lines(out);
+	stringbuffer_destroy(sb);
+	return out;
+}
+
+static void
+test_fgb_round_trip(void)
+{
+	const char *wkts[] = {"POINT(1 2)",
+			      NULL,
+			      "LINESTRING(0 0,1.5 1,2 -2)",
+			      "POLYGON((0 0,10 0,10 10,0 0),(1 1,2 1,2 2,1 1))",
+			      "MULTIPOINT((1 2),(3 4))",
+			      "MULTILINESTRING((0 0,1 1),(2 2,3 3))",
+			      "MULTIPOLYGON(((0 0,1 0,1 1,0 0)),((5 5,6 5,6 6,5 5)))",
+			      "POINT EMPTY"};
+	const char *wkts_zm[] = {"POINT ZM (1 2 3 4)", "LINESTRING ZM (0 0 1 2,1 1 3 4)", "POINT(5 6)"};
+	uint16_t node_sizes[] = {0, 2, 16};
+	size_t i;
+
+	for (i = 0; i < sizeof(node_sizes) / sizeof(node_sizes[0]); i++)
+	{
+		cu_fgb_file f = cu_fgb_write(wkts, 8, 0, 0, node_sizes[i]);
+		int64_t count;
+		char *out = cu_fgb_query(&f, NULL, &count);
+		CU_ASSERT_EQUAL(count, 8);
+		ASSERT_STRING_EQUAL(out,
+				    "LINESTRING(0 0,1.5 1,2 -2)|name='f2'|n=0|x=1\n"
+				    "MULTILINESTRING((0 0,1 1),(2 2,3 3))|name='f5'|n=3|x=2.5\n"
+				    "MULTIPOINT((1 2),(3 4))|name='f4'|n=2|x=2\n"
+				    "MULTIPOLYGON(((0 0,1 0,1 1,0 0)),((5 5,6 5,6 6,5 5)))|name='f6'|n=4|x=3\n"
+				    "NULL|name='f1'|n=-1|x=0.5\n"
+				    "POINT EMPTY|name='f7'|n=5|x=3.5\n"
+				    "POINT(1 2)|name='f0'|n=-2|x=0\n"
+				    "POLYGON((0 0,10 0,10 10,0 0),(1 1,2 1,2 2,1 1))|name='f3'|n=1|x=1.5\n");
+		lwfree(out);
+		lwfree(f.bytes);
+	}
+
+	/* Missing ordinates are written as zero */
+	{
+		cu_fgb_file f = cu_fgb_write(wkts_zm, 3, 1, 1, 16);
+		LWFLATGEOBUF *fgb = lwflatgeobuf_open(f.bytes, f.size);
+		int64_t count;
+		char *out;
+		GBOX extent;
+
+		CU_ASSERT_PTR_NOT_NULL_FATAL(fgb);
+		CU_ASSERT_EQUAL(lwflatgeobuf_nfeatures(fgb), 3);
+		CU_ASSERT_EQUAL(lwflatgeobuf_extent(fgb, &extent), LW_SUCCESS);
+		CU_ASSERT_DOUBLE_EQUAL(extent.xmin, 0, 0);
+		CU_ASSERT_DOUBLE_EQUAL(extent.ymax, 6, 0);
+		lwflatgeobuf_close(fgb);
+
+		out = cu_fgb_query(&f, NULL, &count);
+		ASSERT_STRING_EQUAL(out,
+				    "LINESTRING ZM (0 0 1 2,1 1 3 4)|name='f1'|n=-1|x=0.5\n"
+				    "POINT ZM (1 2 3 4)|name='f0'|n=-2|x=0\n"
+				    "POINT ZM (5 6 0 0)|name='f2'|n=0|x=1\n");
+		lwfree(out);
+		lwfree(f.bytes);
+	}
+}
+
+/* Queries through the index give what a scan of every feature gives */
+static void
+test_fgb_query(void)
+{
+	uint32_t n = 1000, i, q;
+	const char **wkts = lwalloc(n * sizeof(char *));
+	char (*texts)[64] = lwalloc(n * 64);
+	cu_fgb_file indexed, scanned;
+
+	srand(24);
+	for (i = 0; i < n; i++)
+	{
+		double x = rand() % 1000, y = rand() % 1000;
+		if (i % 3)
+			snprintf(texts[i], 64, "POINT(%g %g)", x, y);
+		else
+			snprintf(texts[i], 64, "LINESTRING(%g %g,%g %g)", x, y, x + rand() % 50, y + rand() % 50);
+		wkts[i] = texts[i];
+	}
+	indexed = cu_fgb_write(wkts, n, 0, 0, 16);
+	scanned = cu_fgb_write(wkts, n, 0, 0, 0);
+
+	for (q = 0; q < 50; q++)
+	{
+		GBOX query;
+		int64_t count_indexed, count_scanned;
+		char *a, *b;
+
+		memset(&query, 0, sizeof(GBOX));
+		query.xmin = rand() % 1000;
+		query.ymin = rand() % 1000;
+		query.xmax = query.xmin + rand() % (q < 25 ? 100 : 1000);
+		query.ymax = query.ymin + rand() % (q < 25 ? 100 : 1000);
+		a = cu_fgb_query(&indexed, &query, &count_indexed);
+		b = cu_fgb_query(&scanned, &query, &count_scanned);
+		CU_ASSERT_EQUAL(count_indexed, count_scanned);
+		ASSERT_STRING_EQUAL(a, b);
+		lwfree(a);
+		lwfree(b);
+	}
+
+	lwfree(indexed.bytes);
+	lwfree(scanned.bytes);
+	lwfree(texts);
+	lwfree(wkts);
+}
+
+static void
+test_fgb_errors(void)
+{
+	const char *wkts[] = {"POINT(1 2)", "POINT(3 4)", "POINT(5 6)"};
+	cu_fgb_file f = cu_fgb_write(wkts, 3, 0, 0, 0x1234), empty = {NULL, 0, 0};
+	size_t i, found = 0;
+
+	/* Writers take no node size of 1 */
+	CU_ASSERT_PTR_NULL(lwflatgeobuf_writer_create(cu_fgb_sink, &empty, NULL, 0, 0, 0, 1));
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+
+	/* A file claiming one gets a single error, about the node size */
+	for (i = 0; i + 1 < f.size; i++)
+	{
+		if (f.bytes[i] == 0x34 && f.bytes[i + 1] == 0x12)
+		{
+			f.bytes[i] = 1;
+			f.bytes[i + 1] = 0;
+			found++;
+		}
+	}
+	CU_ASSERT_EQUAL(found, 1);
+	CU_ASSERT_PTR_NULL(lwflatgeobuf_open(f.bytes, f.size));
+	CU_ASSERT(strstr(cu_error_msg, "node size") != NULL);
+	cu_error_msg_reset();
+
+	/* Truncated, or not FlatGeobuf */
+	CU_ASSERT_PTR_NULL(lwflatgeobuf_open(f.bytes, 12));
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+	f.bytes[0] = 'x';
+	CU_ASSERT_PTR_NULL(lwflatgeobuf_open(f.bytes, f.size));
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+	lwfree(f.bytes);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void flatgeobuf_suite_setup(void);
+void flatgeobuf_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("flatgeobuf", NULL, NULL);
+	PG_ADD_TEST(suite, test_fgb_round_trip);
+	PG_ADD_TEST(suite, test_fgb_query);
+	PG_ADD_TEST(suite, test_fgb_errors);
+}
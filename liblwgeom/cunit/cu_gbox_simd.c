@@ -0,0 +1,232 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "cu_tester.h"
+
+/* The plain loop the kernels have to reproduce, bit for bit */
+static void
+cu_gbox_reference(const POINTARRAY *pa, GBOX *box)
+{
+	uint32_t i;
+	POINT4D p;
+
+	getPoint4d_p(pa, 0, &p);
+	box->xmin = box->xmax = p.x;
+	box->ymin = box->ymax = p.y;
+	box->zmin = box->zmax = p.z;
+	box->mmin = box->mmax = p.m;
+	for (i = 1; i < pa->npoints; i++)
+	{
+		getPoint4d_p(pa, i, &p);
+		box->xmin = FP_MIN(box->xmin, p.x);
+		box->xmax = FP_MAX(box->xmax, p.x);
+		box->ymin = FP_MIN(box->ymin, p.y);
+		box->ymax = FP_MAX(box->ymax, p.y);
+		box->zmin = FP_MIN(box->zmin, p.z);
+		box->zmax = FP_MAX(box->zmax, p.z);
+		box->mmin = FP_MIN(box->mmin, p.m);
+		box->mmax = FP_MAX(box->mmax, p.m);
+	}
+}
+
+static int
+cu_gbox_same_double(double a, double b)
+{
+	return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+/* Compare a box with the reference, only the dimensions of the array */
+static int
+cu_gbox_check(const POINTARRAY *pa, const GBOX *box, const GBOX *ref)
+{
+	int ok = cu_gbox_same_double(box->xmin, ref->xmin) && cu_gbox_same_double(box->xmax, ref->xmax) &&
+		 cu_gbox_same_double(box->ymin, ref->ymin) && cu_gbox_same_double(box->ymax, ref->ymax);
+	if (FLAGS_GET_Z(pa->flags))
+		ok = ok && cu_gbox_same_double(box->zmin, ref->zmin) && cu_gbox_same_double(box->zmax, ref->zmax);
+	if (FLAGS_GET_M(pa->flags))
+		ok = ok && cu_gbox_same_double(box->mmin, ref->mmin) && cu_gbox_same_double(box->mmax, ref->mmax);
+	return ok;
+}
+
+/* Random values with some signed zeros, infinities and NaNs mixed in */
+static double
+cu_gbox_value(uint32_t kind)
+{
+	switch (rand() % 40)
+	{
+	case 0:
+		return 0.0;
+	case 1:
+		return -0.0;
+	case 2:
+		return kind > 0 ? INFINITY : 1.0;
+	case 3:
+		return kind > 0 ? -INFINITY : -1.0;
+	case 4:
+		return kind > 1 ? NAN : 2.0;
+	default:
+		return 2000.0 * rand() / RAND_MAX - 1000.0;
+	}
+}
+
+static POINTARRAY *
+cu_gbox_ptarray(uint32_t npoints, int has_z, int has_m, uint32_t kind)
+{
+	POINTARRAY *pa = ptarray_construct(has_z, has_m, npoints);
+	uint32_t i;
+
+	for (i = 0; i < npoints; i++)
+	{
+		POINT4D p;
+		p.x = cu_gbox_value(kind);
+		p.y = cu_gbox_value(kind);
+		p.z = cu_gbox_value(kind);
+		p.m = cu_gbox_value(kind);
+		ptarray_set_point4d(pa, i, &p);
+	}
+	return pa;
+}
+
+static void
+test_gbox_simd_levels(void)
+{
+	uint32_t sizes[] = {1, 2, 3, 7, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 1000, 4099};
+	LW_CPU_LEVEL initial = lwcpu_level();
+	uint32_t s, dims, kind, trial, level, checked = 0, bad = 0;
+
+	srand(16);
+	for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+	{
+		for (dims = 0; dims < 4; dims++)
+		{
+			for (kind = 0; kind < 3; kind++)
+			{
+				for (trial = 0; trial < 4; trial++)
+				{
+					POINTARRAY *pa = cu_gbox_ptarray(sizes[s], dims & 1, dims >> 1, kind);
+					GBOX ref;
+
+					cu_gbox_reference(pa, &ref);
+					for (level = LW_CPU_SCALAR; level < LW_CPU_NUM_LEVELS; level++)
+					{
+						GBOX box;
+						if (lwcpu_set_level((LW_CPU_LEVEL)level) == LW_FAILURE)
+							continue;
+						memset(&box, 0, sizeof(GBOX));
+						CU_ASSERT_EQUAL(ptarray_calculate_gbox_cartesian(pa, &box), LW_SUCCESS);
+						if (!cu_gbox_check(pa, &box, &ref))
+							bad++;
+						checked++;
+					}
+					ptarray_free(pa);
+				}
+			}
+		}
+	}
+	CU_ASSERT_EQUAL(bad, 0);
+	CU_ASSERT(checked > 0);
+	lwcpu_set_level(initial);
+}
+
+/* Runs of equal values and signed zeros at the very ends */
+static void
+test_gbox_simd_zeros(void)
+{
+	LW_CPU_LEVEL initial = lwcpu_level();
+	uint32_t n = 67, i, level, pattern;
+
+	for (pattern = 0; pattern < 4; pattern++)
+	{
+		POINTARRAY *pa = ptarray_construct(1, 1, n);
+		GBOX ref;
+
+		for (i = 0; i < n; i++)
+		{
+			POINT4D p;
+			int neg = pattern == 0 ? 0 : pattern == 1 ? 1 : pattern == 2 ? (i == n - 1) : (i % 2);
+			p.x = neg ? -0.0 : 0.0;
+			p.y = pattern == 3 ? 5.0 : (double)(i % 3) - 1.0;
+			p.z = (i == 0 || i == n - 1) ? (neg ? -0.0 : 0.0) : 1.0;
+			p.m = -(p.x);
+			ptarray_set_point4d(pa, i, &p);
+		}
+		cu_gbox_reference(pa, &ref);
+		for (level = LW_CPU_SCALAR; level < LW_CPU_NUM_LEVELS; level++)
+		{
+			GBOX box;
+			if (lwcpu_set_level((LW_CPU_LEVEL)level) == LW_FAILURE)
+				continue;
+			ptarray_calculate_gbox_cartesian(pa, &box);
+			CU_ASSERT(cu_gbox_check(pa, &box, &ref));
+		}
+		ptarray_free(pa);
+	}
+	lwcpu_set_level(initial);
+}
+
+/* Geometries, through the public entry point */
+static void
+test_gbox_simd_geometries(void)
+{
+	LW_CPU_LEVEL initial = lwcpu_level();
+	POINTARRAY *pa;
+	LWGEOM *geom;
+	GBOX ref, box;
+	uint32_t level;
+
+	srand(17);
+	pa = cu_gbox_ptarray(500, 1, 0, 0);
+	geom = lwline_as_lwgeom(lwline_construct(SRID_UNKNOWN, NULL, pa));
+	lwcpu_set_level(LW_CPU_SCALAR);
+	CU_ASSERT_EQUAL(lwgeom_calculate_gbox_cartesian(geom, &ref), LW_SUCCESS);
+	for (level = LW_CPU_SCALAR; level < LW_CPU_NUM_LEVELS; level++)
+	{
+		if (lwcpu_set_level((LW_CPU_LEVEL)level) == LW_FAILURE)
+			continue;
+		CU_ASSERT_EQUAL(lwgeom_calculate_gbox_cartesian(geom, &box), LW_SUCCESS);
+		CU_ASSERT(gbox_same(&box, &ref));
+	}
+	lwgeom_free(geom);
+
+	/* Empty arrays have no box */
+	pa = ptarray_construct_empty(0, 0, 1);
+	CU_ASSERT_EQUAL(ptarray_calculate_gbox_cartesian(pa, &box), LW_FAILURE);
+	ptarray_free(pa);
+	lwcpu_set_level(initial);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void gbox_simd_suite_setup(void);
+void gbox_simd_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("gbox_simd", NULL, NULL);
+	PG_ADD_TEST(suite, test_gbox_simd_levels);
+	PG_ADD_TEST(suite, test_gbox_simd_zeros);
+	PG_ADD_TEST(suite, test_gbox_simd_geometries);
+}
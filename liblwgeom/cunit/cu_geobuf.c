@@ -0,0 +1,306 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "stringbuffer.h"
+#include "cu_tester.h"
+
+static lwvarlena_t *
+cu_geobuf_encode(const char *wkt, int precision)
+{
+	LWGEOM *geom = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+	lwvarlena_t *v = lwgeom_to_geobuf(geom, precision);
+	lwgeom_free(geom);
+	return v;
+}
+
+/* Encode, decode and write back as WKT */
+static void
+cu_geobuf_round_trip(const char *wkt, int precision, const char *expected)
+{
+	lwvarlena_t *v = cu_geobuf_encode(wkt, precision);
+	LWGEOM *back;
+	char *out;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(v);
+	back = lwgeom_from_geobuf((const uint8_t *)v->data, LWSIZE_GET(v->size) - LWVARHDRSZ);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(back);
+	out = lwgeom_to_wkt(back, WKT_ISO, 15, NULL);
+	ASSERT_STRING_EQUAL(out, expected ? expected : wkt);
+	lwfree(out);
+	lwgeom_free(back);
+	lwfree(v);
+}
+
+static void
+test_geobuf_round_trip(void)
+{
+	cu_geobuf_round_trip("POINT(1 2)", 6, NULL);
+	cu_geobuf_round_trip("POINT(-1.5 2.25)", 2, NULL);
+	cu_geobuf_round_trip("POINT(1.23456789 -2.3456789)", 3, "POINT(1.235 -2.346)");
+	cu_geobuf_round_trip("LINESTRING(0 0,1.000001 2,-3 4.5)", 6, NULL);
+	cu_geobuf_round_trip("POLYGON((0 0,10 0,10 10,0 10,0 0),(1 1,2 1,2 2,1 1))", 0, NULL);
+	cu_geobuf_round_trip("MULTIPOINT((1 2),(3 4))", 6, NULL);
+	cu_geobuf_round_trip("MULTILINESTRING((0 0,1 1),(2 2,3 3,4 4))", 6, NULL);
+	cu_geobuf_round_trip("MULTIPOLYGON(((0 0,1 0,1 1,0 0)),((5 5,6 5,6 6,5 5),(5.2 5.1,5.8 5.1,5.8 5.7,5.2 5.1)))", 1, NULL);
+	cu_geobuf_round_trip("GEOMETRYCOLLECTION(POINT(1 2),LINESTRING(0 0,1 1))", 6, NULL);
+	cu_geobuf_round_trip("GEOMETRYCOLLECTION EMPTY", 6, NULL);
+	/* Z at the default precision and at others, M left out */
+	cu_geobuf_round_trip("POINT Z (1.5 2.25 3.125)", 6, NULL);
+	cu_geobuf_round_trip("LINESTRING Z (0 0 0,1.000001 2 -3.5)", 6, NULL);
+	cu_geobuf_round_trip("POLYGON Z ((0 0 1,1 0 2,1 1 3,0 0 1))", 9, NULL);
+	cu_geobuf_round_trip("MULTIPOINT Z ((1 2 3),(4 5 6))", 0, NULL);
+	cu_geobuf_round_trip("POINT M (1 2 3)", 6, "POINT(1 2)");
+}
+
+typedef struct
+{
+	stringbuffer_t *sb;
+	uint32_t count;
+	uint32_t stop_after;
+} cu_geobuf_features;
+
+/* One line per feature, its WKT and its properties */
+static int
+cu_geobuf_collect(LWGEOM *geom, const LWPROPERTY *properties, uint32_t nproperties, void *data)
+{
+	cu_geobuf_features *f = data;
+	char *wkt = lwgeom_to_wkt(geom, WKT_ISO, 15, NULL);
+	uint32_t i;
+
+	stringbuffer_append(f->sb, wkt);
+	for (i = 0; i < nproperties; i++)
+	{
+		const LWPROPERTY *p = &properties[i];
+		stringbuffer_aprintf(f->sb, "|%s=", p->key);
+		switch (p->type)
+		{
+		case LWPROPERTY_STRING:
+			stringbuffer_aprintf(f->sb, "'%s'", p->string_value);
+			break;
+		case LWPROPERTY_JSON:
+			stringbuffer_aprintf(f->sb, "json:%s", p->string_value);
+			break;
+		case LWPROPERTY_FLOAT:
+		case LWPROPERTY_DOUBLE:
+			stringbuffer_aprintf(f->sb, "%g", p->double_value);
+			break;
+		case LWPROPERTY_INT:
+			stringbuffer_aprintf(f->sb, "%lld", (long long)p->int_value);
+			break;
+		case LWPROPERTY_BOOL:
+			stringbuffer_append(f->sb, p->int_value ? "true" : "false");
+			break;
+		}
+	}
+	stringbuffer_append_len(f->sb, "\n", 1);
+	lwfree(wkt);
+	lwgeom_free(geom);
+	f->count++;
+	return !f->stop_after || f->count < f->stop_after;
+}
+
+/* Push the bytes in chunks of the given size, 0 for all at once */
+static char *
+cu_geobuf_read(const lwvarlena_t *v, size_t chunk, uint32_t stop_after, int *rv)
+{
+	cu_geobuf_features f;
+	LWGEOBUF_READER *r;
+	size_t len = LWSIZE_GET(v->size) - LWVARHDRSZ, pos = 0;
+	char *out;
+
+	f.sb = stringbuffer_create();
+	f.count = 0;
+	f.stop_after = stop_after;
+	r = lwgeobuf_reader_create(cu_geobuf_collect, &f);
+	*rv = LW_SUCCESS;
+	while (*rv && pos < len)
+	{
+		size_t size = chunk && len - pos > chunk ? chunk : len - pos;
+		*rv = lwgeobuf_reader_push(r, (const uint8_t *)v->data + pos, size);
+		pos += size;
+	}
+	if (*rv)
+		*rv = lwgeobuf_reader_finish(r);
+	lwgeobuf_reader_free(r);
+
+	out = stringbuffer_getstringcopy(f.sb);
+	stringbuffer_destroy(f.sb);
+	return out;
+}
+
+static void
+cu_geobuf_stream(const lwvarlena_t *v, const char *expected)
+{
+	size_t chunks[] = {0, 1, 2, 3, 7, 64};
+	size_t i;
+
+	for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+	{
+		int rv;
+		char *out = cu_geobuf_read(v, chunks[i], 0, &rv);
+		CU_ASSERT_EQUAL(rv, LW_SUCCESS);
+		ASSERT_STRING_EQUAL(out, expected);
+		lwfree(out);
+	}
+}
+
+static lwvarlena_t *
+cu_geobuf_collection(int precision, int has_z, const char **wkts, uint32_t n)
+{
+	LWGEOBUF_WRITER *w = lwgeobuf_writer_create(precision, has_z);
+	LWPROPERTY p[5];
+	lwvarlena_t *v;
+	uint32_t i;
+
+	memset(p, 0, sizeof(p));
+	p[0].key = "name";
+	p[0].type = LWPROPERTY_STRING;
+	p[1].key = "n";
+	p[1].type = LWPROPERTY_INT;
+	p[2].key = "x";
+	p[2].type = LWPROPERTY_DOUBLE;
+	p[2].double_value = 0.5;
+	p[3].key = "ok";
+	p[3].type = LWPROPERTY_BOOL;
+	p[4].key = "tags";
+	p[4].type = LWPROPERTY_JSON;
+	p[4].string_value = "[1,2]";
+
+	for (i = 0; i < n; i++)
+	{
+		LWGEOM *geom = wkts[i] ? lwgeom_from_wkt(wkts[i], LW_PARSER_CHECK_NONE) : NULL;
+		char name[16];
+		snprintf(name, sizeof(name), "f%u", i);
+		p[0].string_value = name;
+		p[1].int_value = (int64_t)i - 1;
+		p[3].int_value = i % 2;
+		CU_ASSERT_EQUAL(lwgeobuf_writer_feature(w, geom, p, i % 2 ? 5 : 2), LW_SUCCESS);
+		if (geom)
+			lwgeom_free(geom);
+	}
+	v = lwgeobuf_writer_finish(w);
+	lwgeobuf_writer_free(w);
+	return v;
+}
+
+static void
+test_geobuf_stream(void)
+{
+	const char *wkts[] = {"POINT(1 2)", NULL, "LINESTRING(0 0,1.5 1,2 -2)", "POLYGON((0 0,1 0,1 1,0 0))"};
+	const char *wkts_z[] = {"POINT Z (1 2 3.5)", "LINESTRING Z (0 0 0,1.000001 1 -2)", "POINT(4 5)"};
+	lwvarlena_t *v;
+	LWGEOM *geom;
+	char *wkt;
+
+	v = cu_geobuf_collection(6, 0, wkts, 4);
+	cu_geobuf_stream(v,
+			 "POINT(1 2)|name='f0'|n=-1\n"
+			 "GEOMETRYCOLLECTION EMPTY|name='f1'|n=0|x=0.5|ok=true|tags=json:[1,2]\n"
+			 "LINESTRING(0 0,1.5 1,2 -2)|name='f2'|n=1\n"
+			 "POLYGON((0 0,1 0,1 1,0 0))|name='f3'|n=2|x=0.5|ok=true|tags=json:[1,2]\n");
+
+	/* The whole collection at once */
+	geom = lwgeom_from_geobuf((const uint8_t *)v->data, LWSIZE_GET(v->size) - LWVARHDRSZ);
+	wkt = lwgeom_to_wkt(geom, WKT_ISO, 15, NULL);
+	ASSERT_STRING_EQUAL(wkt,
+			    "GEOMETRYCOLLECTION(POINT(1 2),GEOMETRYCOLLECTION EMPTY,LINESTRING(0 0,1.5 1,2 -2),"
+			    "POLYGON((0 0,1 0,1 1,0 0)))");
+	lwfree(wkt);
+	lwgeom_free(geom);
+	lwfree(v);
+
+	/* Three dimensions at the default precision, which is not written */
+	v = cu_geobuf_collection(6, 1, wkts_z, 3);
+	cu_geobuf_stream(v,
+			 "POINT Z (1 2 3.5)|name='f0'|n=-1\n"
+			 "LINESTRING Z (0 0 0,1.000001 1 -2)|name='f1'|n=0|x=0.5|ok=true|tags=json:[1,2]\n"
+			 "POINT Z (4 5 0)|name='f2'|n=1\n");
+	lwfree(v);
+
+	/* And at another one */
+	v = cu_geobuf_collection(2, 1, wkts_z, 1);
+	cu_geobuf_stream(v, "POINT Z (1 2 3.5)|name='f0'|n=-1\n");
+	lwfree(v);
+
+	/* No features */
+	v = cu_geobuf_collection(6, 0, wkts, 0);
+	cu_geobuf_stream(v, "");
+	lwfree(v);
+
+	/* A single geometry is one feature */
+	v = cu_geobuf_encode("LINESTRING Z (1 2 3,4 5 6)", 6);
+	cu_geobuf_stream(v, "LINESTRING Z (1 2 3,4 5 6)\n");
+	lwfree(v);
+}
+
+static void
+test_geobuf_stop_and_errors(void)
+{
+	const char *wkts[] = {"POINT(1 2)", "POINT(3 4)", "POINT(5 6)"};
+	lwvarlena_t *v = cu_geobuf_collection(6, 0, wkts, 3);
+	uint8_t garbage[] = {0x12, 0x05, 0x01};
+	uint8_t bad_dims[] = {0x10, 0x01};
+	LWGEOBUF_READER *r;
+	int rv;
+	char *out;
+
+	out = cu_geobuf_read(v, 5, 2, &rv);
+	CU_ASSERT_EQUAL(rv, LW_SUCCESS);
+	ASSERT_STRING_EQUAL(out, "POINT(1 2)|name='f0'|n=-1\nPOINT(3 4)|name='f1'|n=0|x=0.5|ok=true|tags=json:[1,2]\n");
+	lwfree(out);
+
+	/* Truncated */
+	LWSIZE_SET(v->size, LWSIZE_GET(v->size) - 3);
+	out = cu_geobuf_read(v, 0, 0, &rv);
+	CU_ASSERT_EQUAL(rv, LW_FAILURE);
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+	lwfree(out);
+	lwfree(v);
+
+	/* A length running past the end, and a single dimension */
+	CU_ASSERT_PTR_NULL(lwgeom_from_geobuf(garbage, sizeof(garbage)));
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+	r = lwgeobuf_reader_create(cu_geobuf_collect, NULL);
+	CU_ASSERT_EQUAL(lwgeobuf_reader_push(r, bad_dims, sizeof(bad_dims)), LW_FAILURE);
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+	CU_ASSERT_EQUAL(lwgeobuf_reader_finish(r), LW_FAILURE);
+	lwgeobuf_reader_free(r);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void geobuf_suite_setup(void);
+void geobuf_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("geobuf", NULL, NULL);
+	PG_ADD_TEST(suite, test_geobuf_round_trip);
+	PG_ADD_TEST(suite, test_geobuf_stream);
+	PG_ADD_TEST(suite, test_geobuf_stop_and_errors);
+}
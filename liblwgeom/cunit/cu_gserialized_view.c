@@ -0,0 +1,197 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "gserialized1.h"
+#include "cu_tester.h"
+
+static const char *view_wkts[] = {
+	"POINT(1 2)",
+	"POINT EMPTY",
+	"POINT ZM (1 2 3 4)",
+	"LINESTRING(0 0,1 1,2 0)",
+	"LINESTRING M (0 0 1,1 1 2)",
+	"POLYGON((0 0,10 0,10 10,0 10,0 0),(2 2,2 4,4 4,2 2))",
+	"MULTIPOINT((1 2),EMPTY,(3 4))",
+	"MULTILINESTRING Z ((0 0 0,1 1 1),(2 2 2,3 3 3))",
+	"MULTIPOLYGON(((0 0,1 0,1 1,0 0)),((5 5,6 5,6 6,5 5)))",
+	"GEOMETRYCOLLECTION(POINT(1 2),LINESTRING EMPTY,GEOMETRYCOLLECTION(POINT(3 4)))",
+	"CIRCULARSTRING(0 0,1 1,2 0)",
+	"CURVEPOLYGON(COMPOUNDCURVE(CIRCULARSTRING(0 0,1 1,2 0),(2 0,0 0)))",
+	"TRIANGLE((0 0,1 0,0 1,0 0))",
+	"TIN(((0 0 0,1 0 0,0 1 0,0 0 0)))"
+};
+
+/* The view reads the same as the copy, and only points into the buffer */
+static void
+cu_view_check_ptarray(const POINTARRAY *pa, const GSERIALIZED *g, size_t size)
+{
+	const uint8_t *start = (const uint8_t *)g;
+
+	if ( ! pa->npoints )
+		return;
+	CU_ASSERT(FLAGS_GET_READONLY(pa->flags));
+	CU_ASSERT(pa->serialized_pointlist >= start);
+	CU_ASSERT(pa->serialized_pointlist + ptarray_point_size(pa) * pa->npoints <= start + size);
+}
+
+static void
+cu_view_check_geom(const LWGEOM *geom, const GSERIALIZED *g, size_t size)
+{
+	uint32_t i;
+
+	switch ( geom->type )
+	{
+		case POINTTYPE:
+		case LINETYPE:
+		case CIRCSTRINGTYPE:
+		case TRIANGLETYPE:
+			cu_view_check_ptarray(((LWLINE *)geom)->points, g, size);
+			break;
+		case POLYGONTYPE:
+			for ( i = 0; i < ((LWPOLY *)geom)->nrings; i++ )
+				cu_view_check_ptarray(((LWPOLY *)geom)->rings[i], g, size);
+			break;
+		default:
+			for ( i = 0; i < ((LWCOLLECTION *)geom)->ngeoms; i++ )
+				cu_view_check_geom(((LWCOLLECTION *)geom)->geoms[i], g, size);
+			break;
+	}
+}
+
+static void
+test_gserialized_view_same(void)
+{
+	size_t i;
+
+	for ( i = 0; i < sizeof(view_wkts) / sizeof(view_wkts[0]); i++ )
+	{
+		LWGEOM *geom = lwgeom_from_wkt(view_wkts[i], LW_PARSER_CHECK_NONE);
+		LWGEOM *copy, *view;
+		GSERIALIZED *g;
+		size_t size;
+
+		CU_ASSERT_PTR_NOT_NULL_FATAL(geom);
+		lwgeom_set_srid(geom, 4326);
+		g = gserialized_from_lwgeom(geom, &size);
+
+		copy = lwgeom_from_gserialized(g);
+		view = lwgeom_from_gserialized_view(g);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(view);
+		if ( ! lwgeom_same(copy, view) )
+			fprintf(stderr, "[%s:%d]\n WKT: %s\n", __FILE__, __LINE__, view_wkts[i]);
+		CU_ASSERT(lwgeom_same(copy, view));
+		ASSERT_INT_EQUAL(view->srid, 4326);
+		ASSERT_INT_EQUAL(lwgeom_is_empty(view), lwgeom_is_empty(geom));
+		cu_view_check_geom(view, g, size);
+
+		lwgeom_free(view);
+		lwgeom_free(copy);
+		lwgeom_free(geom);
+		lwfree(g);
+	}
+}
+
+/* Editing a view copies the ordinates, the serialization stays as it was */
+static void
+test_gserialized_view_copy_on_write(void)
+{
+	LWGEOM *geom = lwgeom_from_wkt("POLYGON((0 0,10 0,10 10,0 10,0 0))", LW_PARSER_CHECK_NONE);
+	LWGEOM *view, *copy;
+	GSERIALIZED *g, *before;
+	AFFINE affine = {2, 0, 0, 0, 2, 0, 0, 0, 1, 1, 1, 0};
+	POINT4D p = {5, 5, 0, 0};
+	LWPOLY *poly;
+	size_t size;
+
+	g = gserialized_from_lwgeom(geom, &size);
+	before = lwalloc(size);
+	memcpy(before, g, size);
+
+	view = lwgeom_from_gserialized_view(g);
+	lwgeom_affine(view, &affine);
+	CU_ASSERT_EQUAL(memcmp(g, before, size), 0);
+	poly = (LWPOLY *)view;
+	CU_ASSERT_FALSE(FLAGS_GET_READONLY(poly->rings[0]->flags));
+	getPoint4d_p(poly->rings[0], 2, &p);
+	ASSERT_DOUBLE_EQUAL(p.x, 21);
+	ASSERT_DOUBLE_EQUAL(p.y, 21);
+	lwgeom_free(view);
+
+	/* Growing a view */
+	view = lwgeom_from_gserialized_view(g);
+	poly = (LWPOLY *)view;
+	p.x = 5; p.y = 5;
+	CU_ASSERT_EQUAL(ptarray_insert_point(poly->rings[0], &p, 1), LW_SUCCESS);
+	ASSERT_INT_EQUAL(poly->rings[0]->npoints, 6);
+	CU_ASSERT_EQUAL(memcmp(g, before, size), 0);
+	lwgeom_free(view);
+
+	/* Reversing, then the original still reads back */
+	view = lwgeom_from_gserialized_view(g);
+	lwgeom_reverse_in_place(view);
+	CU_ASSERT_EQUAL(memcmp(g, before, size), 0);
+	copy = lwgeom_from_gserialized(g);
+	CU_ASSERT(lwgeom_same(copy, geom));
+	CU_ASSERT_FALSE(lwgeom_same(copy, view));
+	lwgeom_free(view);
+	lwgeom_free(copy);
+
+	lwfree(before);
+	lwfree(g);
+	lwgeom_free(geom);
+}
+
+/* The first serialization version is read through lwgeom_from_gserialized1,
+ * which references the buffer as well */
+static void
+test_gserialized_view_version1(void)
+{
+	LWGEOM *geom = lwgeom_from_wkt("LINESTRING(0 0,1 1,2 0)", LW_PARSER_CHECK_NONE);
+	LWGEOM *view;
+	GSERIALIZED *g;
+	size_t size;
+
+	g = gserialized1_from_lwgeom(geom, &size);
+	view = lwgeom_from_gserialized_view(g);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(view);
+	CU_ASSERT(lwgeom_same(view, geom));
+	CU_ASSERT(FLAGS_GET_READONLY(lwgeom_as_lwline(view)->points->flags));
+	lwgeom_free(view);
+	lwfree(g);
+	lwgeom_free(geom);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void gserialized_view_suite_setup(void);
+void gserialized_view_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("gserialized_view", NULL, NULL);
+	PG_ADD_TEST(suite, test_gserialized_view_same);
+	PG_ADD_TEST(suite, test_gserialized_view_copy_on_write);
+	PG_ADD_TEST(suite, test_gserialized_view_version1);
+}
@@ -0,0 +1,301 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "lwhrtree.h"
+#include "cu_tester.h"
+
+/* Random boxes, some of them points, over [0,1000) x [0,1000) */
+static GBOX *
+cu_hrtree_boxes(uint32_t n)
+{
+	GBOX *boxes = lwalloc(n * sizeof(GBOX));
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		double w = (i % 5) ? 20.0 * rand() / RAND_MAX : 0.0;
+		memset(&boxes[i], 0, sizeof(GBOX));
+		boxes[i].xmin = 1000.0 * rand() / RAND_MAX;
+		boxes[i].ymin = 1000.0 * rand() / RAND_MAX;
+		boxes[i].xmax = boxes[i].xmin + w;
+		boxes[i].ymax = boxes[i].ymin + w;
+	}
+	return boxes;
+}
+
+static int
+cu_hrtree_overlaps(const GBOX *a, const GBOX *b)
+{
+	return a->xmin <= b->xmax && a->xmax >= b->xmin && a->ymin <= b->ymax && a->ymax >= b->ymin;
+}
+
+/* Compare a query against a scan of all the boxes */
+static void
+cu_hrtree_check_query(const LWHRTREE *tree, const GBOX *boxes, uint32_t n, const GBOX *query)
+{
+	uint64_t num_found = 0, i, expected = 0;
+	uint64_t *found = lwhrtree_query(tree, query, &num_found);
+	uint8_t *seen = lwalloc(n ? n : 1);
+
+	memset(seen, 0, n ? n : 1);
+	for (i = 0; i < num_found; i++)
+	{
+		CU_ASSERT(found[i] < n);
+		if (found[i] >= n)
+			continue;
+		CU_ASSERT_EQUAL(seen[found[i]], 0);
+		seen[found[i]] = 1;
+		CU_ASSERT(cu_hrtree_overlaps(&boxes[found[i]], query));
+	}
+	for (i = 0; i < n; i++)
+		if (cu_hrtree_overlaps(&boxes[i], query))
+			expected++;
+	CU_ASSERT_EQUAL(num_found, expected);
+
+	lwfree(seen);
+	if (found)
+		lwfree(found);
+}
+
+static void
+test_hrtree_query(void)
+{
+	uint32_t sizes[] = {1, 2, 15, 16, 17, 1000, 5000};
+	uint32_t node_sizes[] = {0, 2, 4, 16, 64};
+	uint32_t i, j, k;
+
+	srand(10);
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		GBOX *boxes = cu_hrtree_boxes(sizes[i]);
+		for (j = 0; j < sizeof(node_sizes) / sizeof(node_sizes[0]); j++)
+		{
+			LWHRTREE *tree = lwhrtree_create(boxes, sizes[i], node_sizes[j]);
+			GBOX extent, all;
+
+			CU_ASSERT_PTR_NOT_NULL_FATAL(tree);
+			CU_ASSERT_EQUAL(tree->num_items, sizes[i]);
+			CU_ASSERT_EQUAL(tree->node_size, node_sizes[j] ? node_sizes[j] : LWHRTREE_NODE_SIZE);
+
+			for (k = 0; k < 50; k++)
+			{
+				GBOX query;
+				double w = 100.0 * rand() / RAND_MAX;
+				memset(&query, 0, sizeof(GBOX));
+				query.xmin = 1000.0 * rand() / RAND_MAX - 50.0;
+				query.ymin = 1000.0 * rand() / RAND_MAX - 50.0;
+				query.xmax = query.xmin + w;
+				query.ymax = query.ymin + (k % 3 ? w : 0.0);
+				cu_hrtree_check_query(tree, boxes, sizes[i], &query);
+			}
+			/* A query on an item box finds at least that item */
+			cu_hrtree_check_query(tree, boxes, sizes[i], &boxes[sizes[i] / 2]);
+
+			/* The extent covers everything */
+			CU_ASSERT_EQUAL(lwhrtree_extent(tree, &extent), LW_SUCCESS);
+			memset(&all, 0, sizeof(GBOX));
+			all.xmin = all.ymin = -1.0;
+			all.xmax = all.ymax = 1100.0;
+			cu_hrtree_check_query(tree, boxes, sizes[i], &all);
+			for (k = 0; k < sizes[i]; k++)
+			{
+				CU_ASSERT(extent.xmin <= boxes[k].xmin && extent.xmax >= boxes[k].xmax);
+				CU_ASSERT(extent.ymin <= boxes[k].ymin && extent.ymax >= boxes[k].ymax);
+			}
+			lwhrtree_free(tree);
+		}
+		lwfree(boxes);
+	}
+
+	/* No items, no tree */
+	CU_ASSERT_PTR_NULL(lwhrtree_create(NULL, 0, 0));
+	CU_ASSERT_EQUAL(lwhrtree_query_visit(NULL, NULL, NULL, NULL), 0);
+	CU_ASSERT_EQUAL(lwhrtree_extent(NULL, NULL), LW_FAILURE);
+}
+
+static int
+cu_hrtree_stop_after(const LWHRTREE_NODE *leaf, void *data)
+{
+	uint32_t *left = data;
+	(void)leaf;
+	return --(*left) > 0;
+}
+
+static void
+test_hrtree_visit(void)
+{
+	GBOX *boxes;
+	GBOX all;
+	LWHRTREE *tree;
+	uint32_t left = 10;
+
+	srand(11);
+	boxes = cu_hrtree_boxes(500);
+	tree = lwhrtree_create(boxes, 500, 4);
+	memset(&all, 0, sizeof(GBOX));
+	all.xmin = all.ymin = -1.0;
+	all.xmax = all.ymax = 1100.0;
+
+	/* A visitor returning LW_FALSE stops the query */
+	CU_ASSERT_EQUAL(lwhrtree_query_visit(tree, &all, cu_hrtree_stop_after, &left), 10);
+	CU_ASSERT_EQUAL(left, 0);
+	/* No visitor just counts */
+	CU_ASSERT_EQUAL(lwhrtree_query_visit(tree, &all, NULL, NULL), 500);
+
+	lwhrtree_free(tree);
+	lwfree(boxes);
+}
+
+static void
+test_hrtree_nan(void)
+{
+	GBOX boxes[40];
+	GBOX query;
+	LWHRTREE *tree;
+	uint32_t i;
+
+	memset(boxes, 0, sizeof(boxes));
+	for (i = 0; i < 40; i++)
+	{
+		boxes[i].xmin = boxes[i].xmax = i;
+		boxes[i].ymin = boxes[i].ymax = i;
+	}
+	/* NaN and infinite boxes, first in their nodes and elsewhere */
+	boxes[0].xmin = boxes[0].xmax = NAN;
+	boxes[5].ymin = boxes[5].ymax = NAN;
+	boxes[17].xmax = INFINITY;
+	boxes[23].xmin = -INFINITY;
+	boxes[31].xmin = boxes[31].ymin = boxes[31].xmax = boxes[31].ymax = NAN;
+
+	tree = lwhrtree_create(boxes, 40, 4);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(tree);
+
+	/* The finite boxes are all still found */
+	for (i = 0; i < 40; i++)
+	{
+		if (i == 0 || i == 5 || i == 31)
+			continue;
+		cu_hrtree_check_query(tree, boxes, 40, &boxes[i]);
+	}
+	memset(&query, 0, sizeof(GBOX));
+	query.xmin = query.ymin = -1000.0;
+	query.xmax = query.ymax = 1000.0;
+	cu_hrtree_check_query(tree, boxes, 40, &query);
+	lwhrtree_free(tree);
+
+	/* Only NaN boxes */
+	for (i = 0; i < 40; i++)
+		boxes[i].xmin = boxes[i].ymin = boxes[i].xmax = boxes[i].ymax = NAN;
+	tree = lwhrtree_create(boxes, 40, 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(tree);
+	CU_ASSERT_EQUAL(lwhrtree_query_visit(tree, &query, NULL, NULL), 0);
+	lwhrtree_free(tree);
+}
+
+static void
+test_hrtree_buffer(void)
+{
+	GBOX *boxes;
+	LWHRTREE *tree, *view;
+	uint8_t *buf;
+	size_t size;
+	uint32_t k;
+
+	srand(12);
+	boxes = cu_hrtree_boxes(777);
+	tree = lwhrtree_create(boxes, 777, 8);
+	buf = lwhrtree_to_buffer(tree, &size);
+	CU_ASSERT_EQUAL(size, lwhrtree_buffer_size(777, 8));
+	CU_ASSERT_EQUAL(size, tree->num_nodes * sizeof(LWHRTREE_NODE));
+
+	view = lwhrtree_from_buffer(buf, size, 777, 8);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(view);
+	CU_ASSERT_EQUAL(view->num_nodes, tree->num_nodes);
+	CU_ASSERT_EQUAL(view->num_levels, tree->num_levels);
+	CU_ASSERT_EQUAL(memcmp(view->nodes, tree->nodes, size), 0);
+	for (k = 0; k < 30; k++)
+		cu_hrtree_check_query(view, boxes, 777, &boxes[k * 20]);
+
+	/* Wrong sizes are refused */
+	cu_error_msg_reset();
+	CU_ASSERT_PTR_NULL(lwhrtree_from_buffer(buf, size - 1, 777, 8));
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+	CU_ASSERT_PTR_NULL(lwhrtree_from_buffer(buf, size, 778, 8));
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+
+	/* Leaves that name no item and misplaced children are refused */
+	{
+		LWHRTREE_NODE *nodes = (LWHRTREE_NODE *)buf;
+		uint64_t leaf = tree->level_bounds[0][0];
+		uint64_t saved = nodes[leaf].offset;
+
+		nodes[leaf].offset = 777;
+		CU_ASSERT_PTR_NULL(lwhrtree_from_buffer(buf, size, 777, 8));
+		CU_ASSERT(cu_error_msg[0] != '\0');
+		cu_error_msg_reset();
+		/* Offsets below a given limit are fine for offset trees */
+		lwhrtree_free(lwhrtree_from_buffer_offsets(buf, size, 777, 8, 778));
+		CU_ASSERT(cu_error_msg[0] == '\0');
+		nodes[leaf].offset = saved;
+
+		saved = nodes[0].offset;
+		nodes[0].offset = saved + 1;
+		CU_ASSERT_PTR_NULL(lwhrtree_from_buffer(buf, size, 777, 8));
+		CU_ASSERT(cu_error_msg[0] != '\0');
+		cu_error_msg_reset();
+		nodes[0].offset = UINT64_MAX;
+		CU_ASSERT_PTR_NULL(lwhrtree_from_buffer(buf, size, 777, 8));
+		CU_ASSERT(cu_error_msg[0] != '\0');
+		cu_error_msg_reset();
+		nodes[0].offset = saved;
+		lwhrtree_free(lwhrtree_from_buffer(buf, size, 777, 8));
+		CU_ASSERT(cu_error_msg[0] == '\0');
+	}
+
+	/* Garbage child offsets do not send the query out of the array */
+	view->nodes[0].offset = UINT64_MAX;
+	CU_ASSERT_EQUAL(lwhrtree_query_visit(view, &boxes[0], NULL, NULL), 0);
+
+	lwhrtree_free(view);
+	lwfree(buf);
+	lwhrtree_free(tree);
+	lwfree(boxes);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void hrtree_suite_setup(void);
+void hrtree_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("hrtree", NULL, NULL);
+	PG_ADD_TEST(suite, test_hrtree_query);
+	PG_ADD_TEST(suite, test_hrtree_visit);
+	PG_ADD_TEST(suite, test_hrtree_nan);
+	PG_ADD_TEST(suite, test_hrtree_buffer);
+}
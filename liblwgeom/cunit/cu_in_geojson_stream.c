@@ -0,0 +1,229 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "stringbuffer.h"
+#include "cu_tester.h"
+
+typedef struct
+{
+	stringbuffer_t *sb;
+	uint32_t count;
+	uint32_t stop_after; /* 0 to read everything */
+	int has_bbox;
+} cu_geojson_features;
+
+/* One line per feature, its WKT and its properties */
+static int
+cu_geojson_collect(LWGEOM *geom, const char *properties, size_t properties_size, void *data)
+{
+	cu_geojson_features *f = data;
+
+	if (geom)
+	{
+		char *wkt = lwgeom_to_wkt(geom, WKT_ISO, 15, NULL);
+		stringbuffer_append(f->sb, wkt);
+		f->has_bbox = f->has_bbox && (lwgeom_is_empty(geom) || geom->bbox);
+		lwfree(wkt);
+		lwgeom_free(geom);
+	}
+	else
+		stringbuffer_append(f->sb, "NULL");
+	stringbuffer_append_len(f->sb, "|", 1);
+	if (properties)
+		stringbuffer_append_len(f->sb, properties, properties_size);
+	stringbuffer_append_len(f->sb, "\n", 1);
+	f->count++;
+	return !f->stop_after || f->count < f->stop_after;
+}
+
+/* Push the text in chunks of the given size, 0 for all at once */
+static char *
+cu_geojson_read(const char *text, size_t chunk, uint32_t stop_after, int *rv)
+{
+	cu_geojson_features f;
+	LWGEOJSON_READER *r;
+	size_t len = strlen(text), pos = 0;
+	char *out;
+
+	f.sb = stringbuffer_create();
+	f.count = 0;
+	f.stop_after = stop_after;
+	f.has_bbox = LW_TRUE;
+	r = lwgeojson_reader_create(cu_geojson_collect, &f);
+	*rv = LW_SUCCESS;
+	while (*rv && pos < len)
+	{
+		size_t size = chunk && len - pos > chunk ? chunk : len - pos;
+		*rv = lwgeojson_reader_push(r, text + pos, size);
+		pos += size;
+	}
+	if (*rv)
+		*rv = lwgeojson_reader_finish(r);
+	lwgeojson_reader_free(r);
+	CU_ASSERT(f.has_bbox);
+
+	out = stringbuffer_getstringcopy(f.sb);
+	stringbuffer_destroy(f.sb);
+	return out;
+}
+
+/* Same features whatever the chunks are */
+static void
+cu_geojson_stream(const char *text, const char *expected)
+{
+	size_t chunks[] = {0, 1, 2, 3, 7, 64};
+	size_t i;
+
+	for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+	{
+		int rv;
+		char *out = cu_geojson_read(text, chunks[i], 0, &rv);
+		CU_ASSERT_EQUAL(rv, LW_SUCCESS);
+		ASSERT_STRING_EQUAL(out, expected);
+		lwfree(out);
+	}
+	cu_error_msg_reset();
+}
+
+static void
+cu_geojson_stream_fails(const char *text)
+{
+	size_t chunks[] = {0, 1, 5};
+	size_t i;
+
+	for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+	{
+		int rv;
+		char *out = cu_geojson_read(text, chunks[i], 0, &rv);
+		CU_ASSERT_EQUAL(rv, LW_FAILURE);
+		CU_ASSERT(cu_error_msg[0] != '\0');
+		cu_error_msg_reset();
+		lwfree(out);
+	}
+}
+
+static void
+test_geojson_stream_collection(void)
+{
+	const char *features =
+	    "[{\"type\":\"Feature\",\"geometry\":{\"type\":\"Point\",\"coordinates\":[1,2]},\"properties\":{\"a\":\"x]}\"}},"
+	    "{\"type\":\"Feature\",\"geometry\":null,\"properties\":null},"
+	    "{\"type\":\"Feature\",\"properties\":{\"b\":[1,{\"c\":2}]},\"geometry\":{\"type\":\"LineString\",\"coordinates\":[[0,0,1],[1,1]]}},"
+	    "{\"type\":\"Polygon\",\"coordinates\":[[[0,0],[1,0],[1,1],[0,0]]]}]";
+	const char *expected = "POINT(1 2)|{\"a\":\"x]}\"}\n"
+			       "NULL|null\n"
+			       "LINESTRING Z (0 0 1,1 1 0)|{\"b\":[1,{\"c\":2}]}\n"
+			       "POLYGON((0 0,1 0,1 1,0 0))|\n";
+	char text[2048];
+
+	/* The type first, the features are streamed */
+	snprintf(text, sizeof(text), "{\"type\":\"FeatureCollection\",\"name\":\"t\",\"features\":%s}", features);
+	cu_geojson_stream(text, expected);
+
+	/* The type last, the whole collection is read at once */
+	snprintf(text, sizeof(text), " {\"name\":{\"x\":[]},\n\"features\" : %s , \"type\" : \"featurecollection\"}\n", features);
+	cu_geojson_stream(text, expected);
+
+	/* Any other member called geometry is no feature */
+	cu_geojson_stream("{\"type\":\"FeatureCollection\",\"geometry\":{\"type\":\"Point\",\"coordinates\":[9,9]},"
+			  "\"features\":[]}",
+			  "");
+	cu_geojson_stream("{\"geometry\":{\"type\":\"Point\",\"coordinates\":[9,9]},\"features\":[{\"type\":\"Point\","
+			  "\"coordinates\":[1,1]}],\"type\":\"FeatureCollection\"}",
+			  "POINT(1 1)|\n");
+	cu_geojson_stream("{\"type\":\"FeatureCollection\"}", "");
+	cu_geojson_stream("{\"type\":\"FeatureCollection\",\"features\":null}", "");
+}
+
+/* A "features" member of anything but a FeatureCollection is foreign */
+static void
+test_geojson_stream_foreign_features(void)
+{
+	cu_geojson_stream("{\"type\":\"Feature\",\"features\":[{\"type\":\"Point\",\"coordinates\":[5,5]}],"
+			  "\"geometry\":{\"type\":\"Point\",\"coordinates\":[1,2]},\"properties\":{}}",
+			  "POINT(1 2)|{}\n");
+	cu_geojson_stream("{\"features\":[],\"type\":\"MultiPoint\",\"coordinates\":[[1,2],[3,4]]}",
+			  "MULTIPOINT((1 2),(3 4))|\n");
+}
+
+/* Several top level objects, one per line or separated by RS */
+static void
+test_geojson_stream_sequence(void)
+{
+	cu_geojson_stream("{\"type\":\"Point\",\"coordinates\":[1,2]}\n"
+			  "\x1e{\"type\":\"Feature\",\"geometry\":{\"type\":\"Point\",\"coordinates\":[3,4,5]}}\n"
+			  "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Point\",\"coordinates\":[6,7]}]}\n"
+			  "{\"type\":\"GeometryCollection\",\"geometries\":[]}\n",
+			  "POINT(1 2)|\nPOINT Z (3 4 5)|\nPOINT(6 7)|\nGEOMETRYCOLLECTION EMPTY|\n");
+	cu_geojson_stream("", "");
+	cu_geojson_stream(" \n ", "");
+}
+
+static void
+test_geojson_stream_stop(void)
+{
+	const char *text = "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Point\",\"coordinates\":[1,2]},"
+			   "{\"type\":\"Point\",\"coordinates\":[3,4]},{\"type\":\"Point\",\"coordinates\":[5,6]}]}";
+	int rv;
+	char *out = cu_geojson_read(text, 3, 2, &rv);
+
+	CU_ASSERT_EQUAL(rv, LW_SUCCESS);
+	ASSERT_STRING_EQUAL(out, "POINT(1 2)|\nPOINT(3 4)|\n");
+	lwfree(out);
+}
+
+static void
+test_geojson_stream_errors(void)
+{
+	/* Truncated */
+	cu_geojson_stream_fails("{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Point\",\"coordinates\":[1,2]}");
+	cu_geojson_stream_fails("{\"type\":\"Point\",\"coordinates\":[1,2]");
+	/* Features must be objects and cannot be collections */
+	cu_geojson_stream_fails("{\"type\":\"FeatureCollection\",\"features\":[1]}");
+	cu_geojson_stream_fails("{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"FeatureCollection\",\"features\":[]}]}");
+	cu_geojson_stream_fails("{\"features\":[{\"type\":\"FeatureCollection\",\"features\":[]}],\"type\":\"FeatureCollection\"}");
+	cu_geojson_stream_fails("{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"FeatureCollection\","
+				"\"geometry\":{\"type\":\"Point\",\"coordinates\":[1,2]}}]}");
+	cu_geojson_stream_fails("{\"features\":[{\"type\":\"Point\",\"coordinates\":[1]}],\"type\":\"FeatureCollection\"}");
+	/* Not an object, or not GeoJSON */
+	cu_geojson_stream_fails("[1,2]");
+	cu_geojson_stream_fails("{\"type\":\"Circle\",\"coordinates\":[1,2]}");
+	cu_geojson_stream_fails("{\"type\":\"Point\",\"coordinates\":[1,2]} x");
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void in_geojson_stream_suite_setup(void);
+void in_geojson_stream_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("in_geojson_stream", NULL, NULL);
+	PG_ADD_TEST(suite, test_geojson_stream_collection);
+	PG_ADD_TEST(suite, test_geojson_stream_foreign_features);
+	PG_ADD_TEST(suite, test_geojson_stream_sequence);
+	PG_ADD_TEST(suite, test_geojson_stream_stop);
+	PG_ADD_TEST(suite, test_geojson_stream_errors);
+}
@@ -0,0 +1,277 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "cu_tester.h"
+
+/*
+ * The common types are read by the recursive descent reader. Inside a
+ * collection that starts with a curve the grammar reads them, which gives
+ * the reference to compare with.
+ */
+static void
+cu_wkt_fast_same(const char *wkt)
+{
+	char grammar_wkt[1024];
+	LWGEOM *fast, *grammar;
+	const char *dims = "";
+
+	fast = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(fast);
+
+	if ( lwgeom_has_z(fast) && lwgeom_has_m(fast) )
+		dims = " ZM";
+	else if ( lwgeom_has_z(fast) )
+		dims = " Z";
+	else if ( lwgeom_has_m(fast) )
+		dims = " M";
+	snprintf(grammar_wkt, sizeof(grammar_wkt), "GEOMETRYCOLLECTION%s(CIRCULARSTRING%s EMPTY,%s)", dims, dims, wkt);
+	grammar = lwgeom_from_wkt(grammar_wkt, LW_PARSER_CHECK_NONE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(grammar);
+
+	if ( ! lwgeom_same(fast, lwcollection_getsubgeom((LWCOLLECTION *)grammar, 1)) )
+		fprintf(stderr, "[%s:%d]\n WKT: %s\n", __FILE__, __LINE__, wkt);
+	CU_ASSERT(lwgeom_same(fast, lwcollection_getsubgeom((LWCOLLECTION *)grammar, 1)));
+	ASSERT_INT_EQUAL(FLAGS_GET_ZM(fast->flags), FLAGS_GET_ZM(grammar->flags));
+
+	lwgeom_free(fast);
+	lwgeom_free(grammar);
+}
+
+static void
+test_wkt_fast_types(void)
+{
+	cu_wkt_fast_same("POINT(1 2)");
+	cu_wkt_fast_same("point ( 1 2 )");
+	cu_wkt_fast_same("POINT EMPTY");
+	cu_wkt_fast_same("POINT Z (1 2 3)");
+	cu_wkt_fast_same("POINT M (1 2 3)");
+	cu_wkt_fast_same("POINT ZM (1 2 3 4)");
+	cu_wkt_fast_same("POINT(1 2 3)");
+	cu_wkt_fast_same("POINT(1 2 3 4)");
+	cu_wkt_fast_same("LINESTRING(0 0,1 1,2 -2)");
+	cu_wkt_fast_same("LINESTRING EMPTY");
+	cu_wkt_fast_same("LINESTRING Z (0 0 0,1 1 1)");
+	cu_wkt_fast_same("POLYGON((0 0,1 0,1 1,0 1,0 0),(0.2 0.2,0.2 0.4,0.4 0.4,0.2 0.2))");
+	cu_wkt_fast_same("POLYGON EMPTY");
+	cu_wkt_fast_same("POLYGON M ((0 0 1,1 0 2,1 1 3,0 0 1))");
+	cu_wkt_fast_same("MULTIPOINT(1 2,3 4)");
+	cu_wkt_fast_same("MULTIPOINT((1 2),(3 4))");
+	cu_wkt_fast_same("MULTIPOINT((1 2),EMPTY)");
+	cu_wkt_fast_same("MULTIPOINT EMPTY");
+	cu_wkt_fast_same("MULTILINESTRING((0 0,1 1),(2 2,3 3))");
+	cu_wkt_fast_same("MULTILINESTRING ZM ((0 0 0 0,1 1 1 1))");
+	cu_wkt_fast_same("MULTIPOLYGON(((0 0,1 0,1 1,0 0)),((5 5,6 5,6 6,5 5),(5.1 5.1,5.2 5.1,5.2 5.2,5.1 5.1)))");
+	cu_wkt_fast_same("MULTIPOLYGON(EMPTY,((0 0,1 0,1 1,0 0)))");
+	cu_wkt_fast_same("GEOMETRYCOLLECTION(POINT(1 2),LINESTRING(0 0,1 1),GEOMETRYCOLLECTION(POINT EMPTY))");
+	cu_wkt_fast_same("GEOMETRYCOLLECTION EMPTY");
+	cu_wkt_fast_same("GEOMETRYCOLLECTION Z (POINT Z (1 2 3),MULTIPOINT Z ((1 2 3)))");
+	cu_wkt_fast_same("\n\tLINESTRING\r\n(0 0 , 1 1)\n");
+}
+
+static void
+test_wkt_fast_numbers(void)
+{
+	static const char *numbers[] = {
+		"0", "-0", ".5", "5.", "-.5", "0.1", "0.3", "1e22", "1e23", "1E-5",
+		"1e+5", "123456789012345678901234567890", "9007199254740993",
+		"2.2250738585072011e-308", "2.2250738585072014e-308", "4.9e-324",
+		"1.7976931348623157e308", "1e-64", "1e64", "1e-65", "1e65",
+		"0.000000000000000000000000000000000001", "3.141592653589793238462643",
+		"89.99999999999999", "-179.99999999999997", "1234567.123456789",
+		"7.2057594037927933e16", "4.35679e-400", "1e310"
+	};
+	char wkt[128];
+	size_t i;
+	int k;
+
+	for ( i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++ )
+	{
+		LWGEOM *geom;
+		POINT4D p;
+
+		snprintf(wkt, sizeof(wkt), "POINT(%s 1)", numbers[i]);
+		geom = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(geom);
+		getPoint4d_p(((LWPOINT *)geom)->point, 0, &p);
+		if ( memcmp(&p.x, &(double){strtod(numbers[i], NULL)}, sizeof(double)) )
+			fprintf(stderr, "[%s:%d]\n Number: %s\n", __FILE__, __LINE__, numbers[i]);
+		CU_ASSERT(memcmp(&p.x, &(double){strtod(numbers[i], NULL)}, sizeof(double)) == 0);
+		lwgeom_free(geom);
+	}
+
+	/* Shortest round trip representations of spread out doubles */
+	srand(4326);
+	for ( k = 0; k < 2000; k++ )
+	{
+		LWGEOM *geom;
+		POINT4D p;
+		double d = ((double)rand() / RAND_MAX - 0.5) * pow(10, rand() % 40 - 20);
+
+		snprintf(wkt, sizeof(wkt), "POINT(%.17g %.15g)", d, d);
+		geom = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(geom);
+		getPoint4d_p(((LWPOINT *)geom)->point, 0, &p);
+		CU_ASSERT_EQUAL(p.x, d);
+		CU_ASSERT_EQUAL(p.y, strtod(strchr(wkt, ' ') + 1, NULL));
+		lwgeom_free(geom);
+	}
+}
+
+static void
+test_wkt_fast_srid(void)
+{
+	LWGEOM *geom;
+
+	geom = lwgeom_from_wkt("SRID=4326;POINT(1 2)", LW_PARSER_CHECK_NONE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(geom);
+	ASSERT_INT_EQUAL(geom->srid, 4326);
+	lwgeom_free(geom);
+
+	geom = lwgeom_from_wkt("srid=3857 ; MULTIPOINT(1 2)", LW_PARSER_CHECK_NONE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(geom);
+	ASSERT_INT_EQUAL(geom->srid, 3857);
+	lwgeom_free(geom);
+
+	geom = lwgeom_from_wkt("POINT(1 2)", LW_PARSER_CHECK_NONE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(geom);
+	ASSERT_INT_EQUAL(geom->srid, SRID_UNKNOWN);
+	lwgeom_free(geom);
+}
+
+/* Malformed input goes to the grammar, which reports where it stopped */
+static void
+test_wkt_fast_errors(void)
+{
+	static const char *bad[] = {
+		"POINT(1 2", "POINT(1)", "POINT(1 2,)", "LINESTRING(0 0,)",
+		"POINT(1 2) x", "POINT(1a 2)", "POINT Z (1 2)", "POINT ZM (1 2 3)",
+		"MULTIPOINT((1 2)", "GEOMETRYCOLLECTION(POINT(1 2)", "POLYGON((0 0,1 1)",
+		"SRID=x;POINT(1 2)", "POINTS(1 2)", ""
+	};
+	size_t i;
+
+	for ( i = 0; i < sizeof(bad) / sizeof(bad[0]); i++ )
+	{
+		LWGEOM_PARSER_RESULT p;
+		int rv = lwgeom_parse_wkt(&p, (char *)bad[i], LW_PARSER_CHECK_NONE);
+		if ( rv != LW_FAILURE )
+			fprintf(stderr, "[%s:%d]\n WKT: %s\n", __FILE__, __LINE__, bad[i]);
+		CU_ASSERT_EQUAL(rv, LW_FAILURE);
+		CU_ASSERT_PTR_NULL(p.geom);
+		CU_ASSERT_NOT_EQUAL(p.errcode, 0);
+		CU_ASSERT_PTR_NOT_NULL(p.message);
+		lwgeom_parser_result_free(&p);
+	}
+}
+
+/* The grammar reads the curves, also inside types the fast reader knows */
+static void
+test_wkt_fast_curves(void)
+{
+	LWGEOM *geom;
+
+	geom = lwgeom_from_wkt("GEOMETRYCOLLECTION(POINT(1 2),CIRCULARSTRING(0 0,1 1,2 0))", LW_PARSER_CHECK_NONE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(geom);
+	ASSERT_INT_EQUAL(lwgeom_count_vertices(geom), 4);
+	CU_ASSERT_EQUAL(lwcollection_getsubgeom((LWCOLLECTION *)geom, 1)->type, CIRCSTRINGTYPE);
+	lwgeom_free(geom);
+
+	geom = lwgeom_from_wkt("MULTIPOLYGON(((0 0,1 0,1 1,0 0)))", LW_PARSER_CHECK_ALL);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(geom);
+	CU_ASSERT_EQUAL(geom->type, MULTIPOLYGONTYPE);
+	lwgeom_free(geom);
+}
+
+/*
+ * Many tagged elements, which must not rescan the rest of the input
+ * each: the reader has to take about as long as the grammar.
+ */
+static void
+cu_wkt_fast_tagged(const char *open, const char *element, uint32_t n, uint8_t zm)
+{
+	size_t element_size = strlen(element), open_size = strlen(open);
+	size_t size = open_size + n * (element_size + 1) + 64;
+	char *fast_wkt = lwalloc(size), *grammar_wkt = lwalloc(size + 32);
+	LWGEOM *fast, *grammar;
+	LWCOLLECTION *col;
+	char *p = fast_wkt;
+	uint32_t i;
+
+	memcpy(p, open, open_size);
+	p += open_size;
+	for (i = 0; i < n; i++)
+	{
+		memcpy(p, element, element_size);
+		p += element_size;
+		*p++ = i + 1 < n ? ',' : ')';
+	}
+	*p = '\0';
+
+	fast = lwgeom_from_wkt(fast_wkt, LW_PARSER_CHECK_NONE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(fast);
+	col = lwgeom_as_lwcollection(fast);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(col);
+	ASSERT_INT_EQUAL(col->ngeoms, n);
+	ASSERT_INT_EQUAL(FLAGS_GET_ZM(col->geoms[n - 1]->flags), zm);
+
+	/* The same elements after a curve, for the grammar */
+	snprintf(grammar_wkt, size + 32, "%sCIRCULARSTRING EMPTY,%s", open, fast_wkt + open_size);
+	grammar = lwgeom_from_wkt(grammar_wkt, LW_PARSER_CHECK_NONE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(grammar);
+	ASSERT_INT_EQUAL(lwgeom_as_lwcollection(grammar)->ngeoms, n + 1);
+	for (i = 0; i < n; i++)
+		if (!lwgeom_same(col->geoms[i], lwcollection_getsubgeom((LWCOLLECTION *)grammar, i + 1)))
+			break;
+	ASSERT_INT_EQUAL(i, n);
+
+	lwgeom_free(fast);
+	lwgeom_free(grammar);
+	lwfree(fast_wkt);
+	lwfree(grammar_wkt);
+}
+
+static void
+test_wkt_fast_tagged(void)
+{
+	cu_wkt_fast_tagged("GEOMETRYCOLLECTION Z (", "POINT Z (1 2 3)", 100000, 2);
+	cu_wkt_fast_tagged("GEOMETRYCOLLECTION M (", "LINESTRING M (0 0 1,1 1 2)", 100000, 1);
+	cu_wkt_fast_tagged("GEOMETRYCOLLECTION ZM (", "MULTIPOINT ZM ((1 2 3 4))", 100000, 3);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void in_wkt_fast_suite_setup(void);
+void in_wkt_fast_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("wkt_fast_input", NULL, NULL);
+	PG_ADD_TEST(suite, test_wkt_fast_types);
+	PG_ADD_TEST(suite, test_wkt_fast_numbers);
+	PG_ADD_TEST(suite, test_wkt_fast_srid);
+	PG_ADD_TEST(suite, test_wkt_fast_errors);
+	PG_ADD_TEST(suite, test_wkt_fast_curves);
+	PG_ADD_TEST(suite, test_wkt_fast_tagged);
+}
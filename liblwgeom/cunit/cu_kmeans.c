@@ -0,0 +1,214 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "cu_tester.h"
+
+/* Points around a few blobs, with Z and M weights when asked, and some empties */
+static LWGEOM **
+cu_kmeans_geoms(uint32_t n, int zm)
+{
+	LWGEOM **geoms = lwalloc(n * sizeof(LWGEOM *));
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		double cx = 100.0 * (i % 7), cy = 50.0 * (i % 5);
+		double x = cx + 30.0 * rand() / RAND_MAX;
+		double y = cy + 30.0 * rand() / RAND_MAX;
+		double z = 10.0 * rand() / RAND_MAX;
+
+		if (i % 101 == 7)
+			geoms[i] = lwpoint_as_lwgeom(lwpoint_construct_empty(SRID_UNKNOWN, zm, zm));
+		else if (zm)
+			geoms[i] = lwpoint_as_lwgeom(lwpoint_make4d(SRID_UNKNOWN, x, y, z, 1.0 + (i % 3)));
+		else
+			geoms[i] = lwpoint_as_lwgeom(lwpoint_make2d(SRID_UNKNOWN, x, y));
+	}
+	return geoms;
+}
+
+static void
+cu_kmeans_free_geoms(LWGEOM **geoms, uint32_t n)
+{
+	uint32_t i;
+	for (i = 0; i < n; i++)
+		lwgeom_free(geoms[i]);
+	lwfree(geoms);
+}
+
+/* Every point is nearest to the weighted mean of its own cluster */
+static void
+cu_kmeans_check_converged(LWGEOM **geoms, uint32_t n, const int *clusters, uint32_t k)
+{
+	POINT4D *means = lwalloc(k * sizeof(POINT4D));
+	uint32_t i, j, bad = 0;
+
+	memset(means, 0, k * sizeof(POINT4D));
+	for (i = 0; i < n; i++)
+	{
+		POINT4D p;
+		if (clusters[i] < 0)
+			continue;
+		CU_ASSERT(clusters[i] < (int)k);
+		lwpoint_getPoint4d_p(lwgeom_as_lwpoint(geoms[i]), &p);
+		if (!lwgeom_has_m(geoms[i]))
+			p.m = 1.0;
+		means[clusters[i]].x += p.x * p.m;
+		means[clusters[i]].y += p.y * p.m;
+		means[clusters[i]].z += p.z * p.m;
+		means[clusters[i]].m += p.m;
+	}
+	for (j = 0; j < k; j++)
+	{
+		CU_ASSERT(means[j].m > 0);
+		means[j].x /= means[j].m;
+		means[j].y /= means[j].m;
+		means[j].z /= means[j].m;
+	}
+	for (i = 0; i < n; i++)
+	{
+		POINT4D p;
+		double own, best = DBL_MAX;
+		if (clusters[i] < 0)
+			continue;
+		lwpoint_getPoint4d_p(lwgeom_as_lwpoint(geoms[i]), &p);
+		for (j = 0; j < k; j++)
+		{
+			double d = (p.x - means[j].x) * (p.x - means[j].x) + (p.y - means[j].y) * (p.y - means[j].y) +
+				   (p.z - means[j].z) * (p.z - means[j].z);
+			if (d < best)
+				best = d;
+		}
+		own = (p.x - means[clusters[i]].x) * (p.x - means[clusters[i]].x) +
+		      (p.y - means[clusters[i]].y) * (p.y - means[clusters[i]].y) +
+		      (p.z - means[clusters[i]].z) * (p.z - means[clusters[i]].z);
+		if (own > best + 1e-9 * (best + 1.0))
+			bad++;
+	}
+	CU_ASSERT_EQUAL(bad, 0);
+	lwfree(means);
+}
+
+static void
+cu_kmeans_check_parallel(LWGEOM **geoms, uint32_t n, uint32_t k, double max_radius)
+{
+	int *clusters = lwgeom_cluster_kmeans((const LWGEOM **)geoms, n, k, max_radius);
+	uint32_t threads[] = {0, 2, 3, 4};
+	uint32_t i, t;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(clusters);
+	for (t = 0; t < sizeof(threads) / sizeof(threads[0]); t++)
+	{
+		int *clusters_par = lwgeom_cluster_kmeans_parallel((const LWGEOM **)geoms, n, k, max_radius, threads[t]);
+		uint32_t same = 0;
+		CU_ASSERT_PTR_NOT_NULL_FATAL(clusters_par);
+		for (i = 0; i < n; i++)
+			if (clusters[i] == clusters_par[i])
+				same++;
+		CU_ASSERT_EQUAL(same, n);
+		lwfree(clusters_par);
+	}
+
+	/* Empty inputs are left out */
+	for (i = 0; i < n; i++)
+		CU_ASSERT_EQUAL(clusters[i] < 0, lwgeom_is_empty(geoms[i]));
+	if (max_radius == 0)
+		cu_kmeans_check_converged(geoms, n, clusters, k);
+	lwfree(clusters);
+}
+
+static void
+test_kmeans_parallel(void)
+{
+	uint32_t n = 40000;
+	LWGEOM **geoms;
+
+	srand(14);
+	geoms = cu_kmeans_geoms(n, LW_FALSE);
+	cu_kmeans_check_parallel(geoms, n, 1, 0);
+	cu_kmeans_check_parallel(geoms, n, 25, 0);
+	cu_kmeans_check_parallel(geoms, n, 10, 15.0);
+	cu_kmeans_free_geoms(geoms, n);
+}
+
+static void
+test_kmeans_parallel_zm(void)
+{
+	uint32_t n = 35000;
+	LWGEOM **geoms;
+
+	srand(15);
+	geoms = cu_kmeans_geoms(n, LW_TRUE);
+	cu_kmeans_check_parallel(geoms, n, 40, 0);
+	cu_kmeans_check_parallel(geoms, n, 5, 20.0);
+	cu_kmeans_free_geoms(geoms, n);
+}
+
+static void
+test_kmeans_small(void)
+{
+	LWGEOM **geoms;
+	int *clusters;
+	uint32_t i;
+
+	srand(16);
+	geoms = cu_kmeans_geoms(500, LW_FALSE);
+	cu_kmeans_check_parallel(geoms, 500, 7, 0);
+
+	/* Duplicates: fewer distinct points than clusters */
+	for (i = 0; i < 10; i++)
+	{
+		lwgeom_free(geoms[i]);
+		geoms[i] = lwpoint_as_lwgeom(lwpoint_make2d(SRID_UNKNOWN, 1, 1));
+	}
+	clusters = lwgeom_cluster_kmeans((const LWGEOM **)geoms, 10, 3, 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(clusters);
+	for (i = 0; i < 10; i++)
+		CU_ASSERT(clusters[i] >= 0 && clusters[i] < 3);
+	lwfree(clusters);
+
+	/* More clusters than geometries */
+	cu_error_msg_reset();
+	clusters = lwgeom_cluster_kmeans((const LWGEOM **)geoms, 2, 3, 0);
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+	if (clusters)
+		lwfree(clusters);
+
+	cu_kmeans_free_geoms(geoms, 500);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void kmeans_suite_setup(void);
+void kmeans_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("kmeans", NULL, NULL);
+	PG_ADD_TEST(suite, test_kmeans_parallel);
+	PG_ADD_TEST(suite, test_kmeans_parallel_zm);
+	PG_ADD_TEST(suite, test_kmeans_small);
+}
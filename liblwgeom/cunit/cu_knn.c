@@ -0,0 +1,242 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "lwknn.h"
+#include "cu_tester.h"
+
+static int
+cu_knn_cmp(const void *a, const void *b)
+{
+	double da = *(const double *)a, db = *(const double *)b;
+	return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+/* Mix of points, short lines and empties around [x0,x0+w) x [y0,y0+h) */
+static LWGEOM **
+cu_knn_geoms(uint32_t n, double x0, double y0, double w, double h, int geodetic)
+{
+	LWGEOM **geoms = lwalloc(n * sizeof(LWGEOM *));
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		double x = x0 + w * rand() / RAND_MAX;
+		double y = y0 + h * rand() / RAND_MAX;
+		char wkt[128];
+
+		if (i % 17 == 3)
+			snprintf(wkt, sizeof(wkt), "LINESTRING EMPTY");
+		else if (i % 3)
+			snprintf(wkt, sizeof(wkt), "POINT(%.6f %.6f)", x, y);
+		else
+			snprintf(wkt, sizeof(wkt), "LINESTRING(%.6f %.6f,%.6f %.6f,%.6f %.6f)",
+				 x, y, x + w / 100, y, x + w / 100, y + h / 100);
+		geoms[i] = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+		if (geodetic)
+		{
+			lwgeom_set_geodetic(geoms[i], LW_TRUE);
+			lwgeom_add_bbox(geoms[i]);
+		}
+	}
+	return geoms;
+}
+
+static void
+cu_knn_free_geoms(LWGEOM **geoms, uint32_t n)
+{
+	uint32_t i;
+	for (i = 0; i < n; i++)
+		lwgeom_free(geoms[i]);
+	lwfree(geoms);
+}
+
+/* Compare a search against the sorted distances of a full scan */
+static void
+cu_knn_check(LWKNN *knn, LWGEOM **geoms, uint32_t n, const LWGEOM *query, uint32_t k, double max_distance, const SPHEROID *s)
+{
+	LWKNN_RESULT *results = lwalloc(k * sizeof(LWKNN_RESULT));
+	double *all = lwalloc(n * sizeof(double));
+	uint32_t i, nall = 0, expected, found;
+
+	for (i = 0; i < n; i++)
+	{
+		double d;
+		if (lwgeom_is_empty(geoms[i]))
+			continue;
+		d = s ? lwgeom_distance_spheroid(geoms[i], query, s, 0.0) : lwgeom_mindistance2d(geoms[i], query);
+		if (max_distance >= 0.0 && d > max_distance)
+			continue;
+		all[nall++] = d;
+	}
+	qsort(all, nall, sizeof(double), cu_knn_cmp);
+	expected = nall < k ? nall : k;
+
+	found = lwknn_search(knn, query, k, max_distance, results);
+	CU_ASSERT_EQUAL(found, expected);
+	for (i = 0; i < found && i < expected; i++)
+	{
+		double tol = s ? 1e-6 * all[i] + 1e-3 : 1e-9;
+		double d = s ? lwgeom_distance_spheroid(geoms[results[i].item], query, s, 0.0)
+			     : lwgeom_mindistance2d(geoms[results[i].item], query);
+		CU_ASSERT(results[i].item < n);
+		CU_ASSERT_DOUBLE_EQUAL(results[i].distance, all[i], tol);
+		CU_ASSERT_DOUBLE_EQUAL(results[i].distance, d, tol);
+		if (i)
+			CU_ASSERT(results[i].distance >= results[i - 1].distance);
+	}
+
+	lwfree(all);
+	lwfree(results);
+}
+
+static void
+test_knn_cartesian(void)
+{
+	uint32_t n = 3000, i;
+	LWGEOM **geoms;
+	LWKNN *knn;
+
+	srand(11);
+	geoms = cu_knn_geoms(n, 0, 0, 1000, 1000, LW_FALSE);
+	knn = lwknn_create((const LWGEOM **)geoms, n);
+
+	for (i = 0; i < 40; i++)
+	{
+		char wkt[128];
+		LWGEOM *query;
+		double x = -100 + 1200.0 * rand() / RAND_MAX;
+		double y = -100 + 1200.0 * rand() / RAND_MAX;
+
+		if (i % 4 == 3)
+			snprintf(wkt, sizeof(wkt), "POLYGON((%g %g,%g %g,%g %g,%g %g))", x, y, x + 30, y, x + 30, y + 30, x, y);
+		else
+			snprintf(wkt, sizeof(wkt), "POINT(%g %g)", x, y);
+		query = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+
+		cu_knn_check(knn, geoms, n, query, 1, -1.0, NULL);
+		cu_knn_check(knn, geoms, n, query, 10, -1.0, NULL);
+		cu_knn_check(knn, geoms, n, query, 50, 20.0, NULL);
+		lwgeom_free(query);
+	}
+
+	lwknn_free(knn);
+	cu_knn_free_geoms(geoms, n);
+}
+
+static void
+test_knn_geodetic(void)
+{
+	uint32_t n = 800, i;
+	LWGEOM **geoms;
+	LWKNN *knn;
+	SPHEROID s;
+
+	spheroid_init(&s, WGS84_MAJOR_AXIS, WGS84_MINOR_AXIS);
+	srand(12);
+	/* Across the dateline and up to the pole */
+	geoms = cu_knn_geoms(n, 150, 40, 60, 49, LW_TRUE);
+	for (i = 0; i < n; i++)
+	{
+		if (!lwgeom_is_empty(geoms[i]))
+			lwgeom_longitude_shift(geoms[i]);
+		lwgeom_drop_bbox(geoms[i]);
+		lwgeom_add_bbox(geoms[i]);
+	}
+	knn = lwknn_create_geodetic((const LWGEOM **)geoms, n, &s);
+
+	for (i = 0; i < 20; i++)
+	{
+		LWGEOM *query = lwpoint_as_lwgeom(lwpoint_make2d(4326,
+								  i % 2 ? 179.9 : -170.0 + 5.0 * rand() / RAND_MAX,
+								  30.0 + 60.0 * rand() / RAND_MAX));
+		lwgeom_set_geodetic(query, LW_TRUE);
+		lwgeom_add_bbox(query);
+		cu_knn_check(knn, geoms, n, query, 1, -1.0, &s);
+		cu_knn_check(knn, geoms, n, query, 8, -1.0, &s);
+		cu_knn_check(knn, geoms, n, query, 30, 200000.0, &s);
+		lwgeom_free(query);
+	}
+
+	lwknn_free(knn);
+	cu_knn_free_geoms(geoms, n);
+}
+
+static void
+test_knn_edges(void)
+{
+	LWGEOM *geoms[3];
+	LWGEOM *pt = lwgeom_from_wkt("POINT(0 0)", LW_PARSER_CHECK_NONE);
+	LWGEOM *empty = lwgeom_from_wkt("POINT EMPTY", LW_PARSER_CHECK_NONE);
+	LWKNN_RESULT results[5];
+	LWKNN *knn;
+
+	/* No geometries, or only empty ones */
+	knn = lwknn_create(NULL, 0);
+	CU_ASSERT_EQUAL(lwknn_search(knn, pt, 5, -1.0, results), 0);
+	lwknn_free(knn);
+	geoms[0] = empty;
+	knn = lwknn_create((const LWGEOM **)geoms, 1);
+	CU_ASSERT_EQUAL(lwknn_search(knn, pt, 5, -1.0, results), 0);
+	lwknn_free(knn);
+
+	/* More wanted than there are, empty query, k of zero */
+	geoms[0] = lwgeom_from_wkt("POINT(3 4)", LW_PARSER_CHECK_NONE);
+	geoms[1] = empty;
+	geoms[2] = lwgeom_from_wkt("LINESTRING(0 1,1 1)", LW_PARSER_CHECK_NONE);
+	knn = lwknn_create((const LWGEOM **)geoms, 3);
+	CU_ASSERT_EQUAL(lwknn_search(knn, pt, 5, -1.0, results), 2);
+	CU_ASSERT_EQUAL(results[0].item, 2);
+	CU_ASSERT_DOUBLE_EQUAL(results[0].distance, 1.0, 1e-12);
+	CU_ASSERT_EQUAL(results[1].item, 0);
+	CU_ASSERT_DOUBLE_EQUAL(results[1].distance, 5.0, 1e-12);
+	CU_ASSERT_EQUAL(lwknn_search(knn, pt, 5, 4.0, results), 1);
+	CU_ASSERT_EQUAL(lwknn_search(knn, empty, 5, -1.0, results), 0);
+	CU_ASSERT_EQUAL(lwknn_search(knn, pt, 0, -1.0, results), 0);
+	lwknn_free(knn);
+	lwgeom_free(geoms[0]);
+	lwgeom_free(geoms[2]);
+
+	/* Geodetic needs a spheroid */
+	cu_error_msg_reset();
+	CU_ASSERT_PTR_NULL(lwknn_create_geodetic(NULL, 0, NULL));
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+
+	lwgeom_free(pt);
+	lwgeom_free(empty);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void knn_suite_setup(void);
+void knn_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("knn", NULL, NULL);
+	PG_ADD_TEST(suite, test_knn_cartesian);
+	PG_ADD_TEST(suite, test_knn_geodetic);
+	PG_ADD_TEST(suite, test_knn_edges);
+}
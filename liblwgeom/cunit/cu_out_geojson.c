@@ -0,0 +1,390 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "stringbuffer.h"
+#include "cu_tester.h"
+
+static char *
+cu_geojson_text(const lwvarlena_t *v)
+{
+	size_t size = LWSIZE_GET(v->size) - LWVARHDRSZ;
+	char *str = lwalloc(size + 1);
+	memcpy(str, v->data, size);
+	str[size] = '\0';
+	return str;
+}
+
+static void
+cu_geojson_out(const char *wkt, const char *srs, int precision, int has_bbox, const char *expected)
+{
+	LWGEOM *geom = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+	lwvarlena_t *v;
+	char *str;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(geom);
+	v = lwgeom_to_geojson(geom, srs, precision, has_bbox);
+	str = cu_geojson_text(v);
+	ASSERT_STRING_EQUAL(str, expected);
+	lwfree(str);
+	lwfree(v);
+	lwgeom_free(geom);
+}
+
+static void
+test_geojson_out_types(void)
+{
+	cu_geojson_out("POINT(1 2)", NULL, 15, 0, "{\"type\":\"Point\",\"coordinates\":[1,2]}");
+	cu_geojson_out("POINT EMPTY", NULL, 15, 0, "{\"type\":\"Point\",\"coordinates\":[]}");
+	cu_geojson_out("POINT(1.23456 2 3)", NULL, 2, 0, "{\"type\":\"Point\",\"coordinates\":[1.23,2,3]}");
+	/* M is left out */
+	cu_geojson_out("POINTM(1 2 3)", NULL, 15, 0, "{\"type\":\"Point\",\"coordinates\":[1,2]}");
+	cu_geojson_out("LINESTRING(0 0,1 1)", NULL, 15, 0, "{\"type\":\"LineString\",\"coordinates\":[[0,0],[1,1]]}");
+	cu_geojson_out("LINESTRING EMPTY", NULL, 15, 0, "{\"type\":\"LineString\",\"coordinates\":[]}");
+	cu_geojson_out("POLYGON((0 0,1 0,1 1,0 0),(0.2 0.2,0.3 0.2,0.3 0.3,0.2 0.2))",
+		       NULL,
+		       15,
+		       0,
+		       "{\"type\":\"Polygon\",\"coordinates\":[[[0,0],[1,0],[1,1],[0,0]],"
+		       "[[0.2,0.2],[0.3,0.2],[0.3,0.3],[0.2,0.2]]]}");
+	cu_geojson_out("TRIANGLE((0 0,1 0,1 1,0 0))",
+		       NULL,
+		       15,
+		       0,
+		       "{\"type\":\"Polygon\",\"coordinates\":[[[0,0],[1,0],[1,1],[0,0]]]}");
+	cu_geojson_out("MULTIPOINT Z (1 2 3,4 5 6)", NULL, 15, 0, "{\"type\":\"MultiPoint\",\"coordinates\":[[1,2,3],[4,5,6]]}");
+	cu_geojson_out("MULTILINESTRING((0 0,1 1),(2 2,3 3))",
+		       NULL,
+		       15,
+		       0,
+		       "{\"type\":\"MultiLineString\",\"coordinates\":[[[0,0],[1,1]],[[2,2],[3,3]]]}");
+	cu_geojson_out("MULTIPOLYGON(((0 0,1 0,1 1,0 0)),((5 5,6 5,6 6,5 5)))",
+		       NULL,
+		       15,
+		       0,
+		       "{\"type\":\"MultiPolygon\",\"coordinates\":[[[[0,0],[1,0],[1,1],[0,0]]],"
+		       "[[[5,5],[6,5],[6,6],[5,5]]]]}");
+	cu_geojson_out("GEOMETRYCOLLECTION(POINT(1 2),LINESTRING(0 0,1 1))",
+		       NULL,
+		       15,
+		       0,
+		       "{\"type\":\"GeometryCollection\",\"geometries\":[{\"type\":\"Point\",\"coordinates\":[1,2]},"
+		       "{\"type\":\"LineString\",\"coordinates\":[[0,0],[1,1]]}]}");
+	cu_geojson_out("GEOMETRYCOLLECTION EMPTY", NULL, 15, 0, "{\"type\":\"GeometryCollection\",\"geometries\":[]}");
+}
+
+static void
+test_geojson_out_options(void)
+{
+	cu_geojson_out("POINT(1 2)",
+		       "EPSG:4326",
+		       15,
+		       0,
+		       "{\"type\":\"Point\",\"crs\":{\"type\":\"name\",\"properties\":{\"name\":\"EPSG:4326\"}},"
+		       "\"coordinates\":[1,2]}");
+	cu_geojson_out("LINESTRING(0 0,1.5 2)",
+		       NULL,
+		       1,
+		       1,
+		       "{\"type\":\"LineString\",\"bbox\":[0.0,0.0,1.5,2.0],\"coordinates\":[[0,0],[1.5,2]]}");
+	cu_geojson_out("LINESTRING Z (0 0 0,1 2 3)",
+		       NULL,
+		       0,
+		       1,
+		       "{\"type\":\"LineString\",\"bbox\":[0,0,0,1,2,3],\"coordinates\":[[0,0,0],[1,2,3]]}");
+	/* Only the collection gets the box and the reference system */
+	cu_geojson_out("GEOMETRYCOLLECTION(POINT(1 2),POINT(3 4))",
+		       "EPSG:3857",
+		       0,
+		       1,
+		       "{\"type\":\"GeometryCollection\",\"crs\":{\"type\":\"name\",\"properties\":{\"name\":\"EPSG:3857\"}},"
+		       "\"bbox\":[1,2,3,4],\"geometries\":[{\"type\":\"Point\",\"coordinates\":[1,2]},"
+		       "{\"type\":\"Point\",\"coordinates\":[3,4]}]}");
+	/* Widest values, in the coordinates and in the box */
+	cu_geojson_out("POINT(1e300 -1e-300)", NULL, 15, 0, "{\"type\":\"Point\",\"coordinates\":[1e+300,-1e-300]}");
+	{
+		char expected[1024];
+		snprintf(expected,
+			 sizeof(expected),
+			 "{\"type\":\"LineString\",\"bbox\":[%.3f,%.3f,%.3f,%.3f],\"coordinates\":[[-1e+300,0],[1,1e+300]]}",
+			 -1e300,
+			 0.0,
+			 1.0,
+			 1e300);
+		cu_geojson_out("LINESTRING(-1e300 0,1 1e300)", NULL, 3, 1, expected);
+	}
+}
+
+/* Positions the way lwprint_double formats every ordinate */
+static char *
+cu_geojson_line_reference(const POINTARRAY *pa, int precision)
+{
+	stringbuffer_t *sb = stringbuffer_create();
+	uint32_t i, d, ndims = FLAGS_GET_Z(pa->flags) ? 3 : 2;
+	char *str;
+
+	stringbuffer_append(sb, "{\"type\":\"LineString\",\"coordinates\":[");
+	for (i = 0; i < pa->npoints; i++)
+	{
+		const double *c = (const double *)getPoint_internal(pa, i);
+		stringbuffer_append_len(sb, i ? ",[" : "[", i ? 2 : 1);
+		for (d = 0; d < ndims; d++)
+		{
+			if (d)
+				stringbuffer_append_len(sb, ",", 1);
+			stringbuffer_append_double(sb, c[d], precision);
+		}
+		stringbuffer_append_len(sb, "]", 1);
+	}
+	stringbuffer_append_len(sb, "]}", 2);
+	str = stringbuffer_getstringcopy(sb);
+	stringbuffer_destroy(sb);
+	return str;
+}
+
+static void
+test_geojson_out_ordinates(void)
+{
+	static const double special[] = {
+	    0.0, -0.0, -1.2345678901234567e-300, -DBL_MAX, DBL_MIN, -9.999999999999999e14, -1e15, 1e-9, -5e-324};
+	int precisions[] = {0, 1, 9, 15, 20};
+	uint32_t p, dims, trial, i;
+
+	srand(21);
+	for (p = 0; p < sizeof(precisions) / sizeof(precisions[0]); p++)
+	{
+		for (dims = 0; dims < 4; dims++)
+		{
+			for (trial = 0; trial < 10; trial++)
+			{
+				uint32_t npoints = 1 + rand() % 300;
+				POINTARRAY *pa = ptarray_construct(dims & 1, dims >> 1, npoints);
+				LWGEOM *line;
+				lwvarlena_t *v;
+				char *ref, *str;
+
+				for (i = 0; i < npoints; i++)
+				{
+					double c[4];
+					POINT4D pt;
+					int d;
+					for (d = 0; d < 4; d++)
+					{
+						int r = rand() % 20;
+						c[d] = r < 9 ? special[r] : (2.0 * rand() / RAND_MAX - 1.0) * pow(10.0, rand() % 30 - 10);
+					}
+					pt.x = c[0];
+					pt.y = c[1];
+					pt.z = c[2];
+					pt.m = c[3];
+					ptarray_set_point4d(pa, i, &pt);
+				}
+				line = lwline_as_lwgeom(lwline_construct(SRID_UNKNOWN, NULL, pa));
+				ref = cu_geojson_line_reference(pa, precisions[p]);
+				v = lwgeom_to_geojson(line, NULL, precisions[p], 0);
+				str = cu_geojson_text(v);
+				ASSERT_STRING_EQUAL(str, ref);
+
+				lwfree(str);
+				lwfree(v);
+				lwfree(ref);
+				lwgeom_free(line);
+			}
+		}
+	}
+}
+
+typedef struct
+{
+	stringbuffer_t *sb;
+	uint32_t chunks;
+	uint32_t fail_at; /* 0 to never fail */
+} cu_geojson_sink_data;
+
+static int
+cu_geojson_sink(const char *text, size_t size, void *data)
+{
+	cu_geojson_sink_data *s = data;
+	if (s->fail_at && ++s->chunks >= s->fail_at)
+		return LW_FAILURE;
+	if (!s->fail_at)
+		s->chunks++;
+	stringbuffer_append_len(s->sb, text, size);
+	return LW_SUCCESS;
+}
+
+static void
+test_geojson_writer(void)
+{
+	cu_geojson_sink_data s = {NULL, 0, 0};
+	LWGEOJSON_WRITER *w;
+	LWGEOM *geom = lwgeom_from_wkt("LINESTRING Z (0 0 1,1 1 2)", LW_PARSER_CHECK_NONE);
+	char *str;
+
+	/* No features */
+	s.sb = stringbuffer_create();
+	w = lwgeojson_writer_create(cu_geojson_sink, &s, NULL, 15, 0);
+	CU_ASSERT_EQUAL(lwgeojson_writer_finish(w), LW_SUCCESS);
+	lwgeojson_writer_free(w);
+	ASSERT_STRING_EQUAL(stringbuffer_getstring(s.sb), "{\"type\":\"FeatureCollection\",\"features\":[]}");
+	CU_ASSERT_EQUAL(s.chunks, 1);
+
+	/* Geometries and properties may be missing */
+	stringbuffer_clear(s.sb);
+	w = lwgeojson_writer_create(cu_geojson_sink, &s, "EPSG:4326", 15, 1);
+	CU_ASSERT_EQUAL(lwgeojson_writer_feature(w, geom, "{\"a\":1}x", 7), LW_SUCCESS);
+	CU_ASSERT_EQUAL(lwgeojson_writer_feature(w, NULL, NULL, 0), LW_SUCCESS);
+	CU_ASSERT_EQUAL(lwgeojson_writer_finish(w), LW_SUCCESS);
+	lwgeojson_writer_free(w);
+	ASSERT_STRING_EQUAL(stringbuffer_getstring(s.sb),
+			    "{\"type\":\"FeatureCollection\",\"crs\":{\"type\":\"name\",\"properties\":{\"name\":\"EPSG:4326\"}},"
+			    "\"features\":[{\"type\":\"Feature\",\"geometry\":{\"type\":\"LineString\","
+			    "\"bbox\":[0.000000000000000,0.000000000000000,1.000000000000000,1.000000000000000,"
+			    "1.000000000000000,2.000000000000000],\"coordinates\":[[0,0,1],[1,1,2]]},\"properties\":{\"a\":1}},"
+			    "{\"type\":\"Feature\",\"geometry\":null,\"properties\":null}]}");
+
+	/* The geometry of a feature is the one lwgeom_to_geojson writes */
+	{
+		lwvarlena_t *v = lwgeom_to_geojson(geom, NULL, 3, 0);
+		char *expected;
+		stringbuffer_clear(s.sb);
+		w = lwgeojson_writer_create(cu_geojson_sink, &s, NULL, 3, 0);
+		lwgeojson_writer_feature(w, geom, NULL, 0);
+		lwgeojson_writer_finish(w);
+		lwgeojson_writer_free(w);
+		str = cu_geojson_text(v);
+		expected = lwalloc(strlen(str) + 128);
+		sprintf(expected,
+			"{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",\"geometry\":%s,"
+			"\"properties\":null}]}",
+			str);
+		ASSERT_STRING_EQUAL(stringbuffer_getstring(s.sb), expected);
+		lwfree(expected);
+		lwfree(str);
+		lwfree(v);
+	}
+
+	stringbuffer_destroy(s.sb);
+	lwgeom_free(geom);
+}
+
+typedef struct
+{
+	uint32_t count;
+	int ok;
+} cu_geojson_read_data;
+
+static int
+cu_geojson_read_back(LWGEOM *geom, const char *properties, size_t properties_size, void *data)
+{
+	cu_geojson_read_data *d = data;
+	char expected[64];
+
+	snprintf(expected, sizeof(expected), "{\"i\":%u}", d->count);
+	if (!geom || lwgeom_count_vertices(geom) != 2 + d->count % 5 || properties_size != strlen(expected) ||
+	    strncmp(properties, expected, properties_size))
+		d->ok = LW_FALSE;
+	if (geom)
+		lwgeom_free(geom);
+	d->count++;
+	return LW_TRUE;
+}
+
+/* Many features, flushed in chunks, read back by the streaming reader */
+static void
+test_geojson_writer_chunks(void)
+{
+	cu_geojson_sink_data s = {NULL, 0, 0};
+	cu_geojson_read_data r = {0, LW_TRUE};
+	LWGEOJSON_WRITER *w;
+	LWGEOJSON_READER *reader;
+	uint32_t i, n = 5000;
+
+	s.sb = stringbuffer_create();
+	w = lwgeojson_writer_create(cu_geojson_sink, &s, NULL, 6, 1);
+	for (i = 0; i < n; i++)
+	{
+		POINTARRAY *pa = ptarray_construct(0, 0, 2 + i % 5);
+		LWGEOM *line;
+		char props[64];
+		uint32_t j;
+
+		for (j = 0; j < pa->npoints; j++)
+		{
+			POINT4D pt = {i * 0.001, j * 1e6 + 0.5, 0, 0};
+			ptarray_set_point4d(pa, j, &pt);
+		}
+		line = lwline_as_lwgeom(lwline_construct(SRID_UNKNOWN, NULL, pa));
+		snprintf(props, sizeof(props), "{\"i\":%u}", i);
+		CU_ASSERT_EQUAL(lwgeojson_writer_feature(w, line, props, strlen(props)), LW_SUCCESS);
+		lwgeom_free(line);
+	}
+	CU_ASSERT_EQUAL(lwgeojson_writer_finish(w), LW_SUCCESS);
+	lwgeojson_writer_free(w);
+	CU_ASSERT(s.chunks > 1);
+
+	reader = lwgeojson_reader_create(cu_geojson_read_back, &r);
+	CU_ASSERT_EQUAL(lwgeojson_reader_push(reader, stringbuffer_getstring(s.sb), stringbuffer_getlength(s.sb)), LW_SUCCESS);
+	CU_ASSERT_EQUAL(lwgeojson_reader_finish(reader), LW_SUCCESS);
+	lwgeojson_reader_free(reader);
+	CU_ASSERT_EQUAL(r.count, n);
+	CU_ASSERT(r.ok);
+
+	/* A failing sink stops the writer */
+	stringbuffer_clear(s.sb);
+	s.chunks = 0;
+	s.fail_at = 2;
+	w = lwgeojson_writer_create(cu_geojson_sink, &s, NULL, 15, 0);
+	for (i = 0; i < n; i++)
+	{
+		LWGEOM *point = lwpoint_as_lwgeom(lwpoint_make2d(SRID_UNKNOWN, i, i));
+		int rv = lwgeojson_writer_feature(w, point, NULL, 0);
+		lwgeom_free(point);
+		if (!rv)
+			break;
+	}
+	CU_ASSERT(i < n);
+	CU_ASSERT_EQUAL(lwgeojson_writer_feature(w, NULL, NULL, 0), LW_FAILURE);
+	CU_ASSERT_EQUAL(lwgeojson_writer_finish(w), LW_FAILURE);
+	lwgeojson_writer_free(w);
+
+	stringbuffer_destroy(s.sb);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void out_geojson_suite_setup(void);
+void out_geojson_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("out_geojson", NULL, NULL);
+	PG_ADD_TEST(suite, test_geojson_out_types);
+	PG_ADD_TEST(suite, test_geojson_out_options);
+	PG_ADD_TEST(suite, test_geojson_out_ordinates);
+	PG_ADD_TEST(suite, test_geojson_writer);
+	PG_ADD_TEST(suite, test_geojson_writer_chunks);
+}
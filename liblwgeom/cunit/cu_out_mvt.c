@@ -0,0 +1,318 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "vector_tile.pb-c.h"
+#include "cu_tester.h"
+
+static LWGEOM *
+cu_mvt_geom(const char *wkt, uint32_t extent, uint32_t buffer, int clip)
+{
+	GBOX bounds;
+	LWGEOM *in = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE), *out;
+
+	/* A tile of 100 units, its top left corner at (0, 100) */
+	memset(&bounds, 0, sizeof(GBOX));
+	bounds.xmin = bounds.ymin = 0;
+	bounds.xmax = bounds.ymax = 100;
+	out = lwgeom_to_mvt_geom(in, &bounds, extent, buffer, clip);
+	lwgeom_free(in);
+	return out;
+}
+
+static void
+cu_mvt_geom_check(const char *wkt, uint32_t extent, uint32_t buffer, int clip, const char *expected)
+{
+	LWGEOM *g = cu_mvt_geom(wkt, extent, buffer, clip);
+	char *out;
+
+	if (!expected)
+	{
+		CU_ASSERT_PTR_NULL(g);
+		if (g)
+			lwgeom_free(g);
+		return;
+	}
+	CU_ASSERT_PTR_NOT_NULL_FATAL(g);
+	out = lwgeom_to_wkt(g, WKT_ISO, 15, NULL);
+	ASSERT_STRING_EQUAL(out, expected);
+	lwfree(out);
+	lwgeom_free(g);
+}
+
+static void
+test_mvt_geom(void)
+{
+	/* Scaled to the grid, y going down */
+	cu_mvt_geom_check("POINT(10 10)", 4096, 0, 1, "POINT(410 3686)");
+	cu_mvt_geom_check("POINT Z (10 90 5)", 10, 0, 1, "POINT(1 1)");
+	cu_mvt_geom_check("LINESTRING(0 100,50 50,100 0)", 10, 0, 1, "LINESTRING(0 0,10 10)");
+	/* Clipped to the buffer around the tile, or not */
+	cu_mvt_geom_check("MULTIPOINT(10 90,500 500)", 10, 1, 1, "MULTIPOINT((1 1))");
+	cu_mvt_geom_check("MULTIPOINT(10 90,500 500)", 10, 1, 0, "MULTIPOINT((1 1),(50 -40))");
+	cu_mvt_geom_check("LINESTRING(50 50,300 50)", 10, 2, 1, "MULTILINESTRING((5 5,12 5))");
+	cu_mvt_geom_check("POINT(500 500)", 10, 1, 1, NULL);
+	/* Nothing left */
+	cu_mvt_geom_check("POINT EMPTY", 10, 0, 1, NULL);
+	cu_mvt_geom_check("POLYGON((0 0,0.001 0,0.001 0.001,0 0))", 10, 0, 1, NULL);
+
+	/* Bad bounds */
+	{
+		LWGEOM *in = lwgeom_from_wkt("POINT(1 1)", LW_PARSER_CHECK_NONE);
+		GBOX bounds;
+		memset(&bounds, 0, sizeof(GBOX));
+		CU_ASSERT_PTR_NULL(lwgeom_to_mvt_geom(in, &bounds, 4096, 0, 1));
+		CU_ASSERT(cu_error_msg[0] != '\0');
+		cu_error_msg_reset();
+		lwgeom_free(in);
+	}
+}
+
+static int
+cu_mvt_add(LWMVT_LAYER *layer, const char *wkt, const LWPROPERTY *properties, uint32_t nproperties, const uint64_t *id)
+{
+	LWGEOM *g = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+	int rv = lwmvt_layer_add_feature(layer, g, properties, nproperties, id);
+	lwgeom_free(g);
+	return rv;
+}
+
+/* Features of the two halves, and their properties */
+static void
+cu_mvt_fill(LWMVT_LAYER *layer, int half)
+{
+	LWPROPERTY p[3];
+	uint64_t id = 7 + half;
+
+	memset(p, 0, sizeof(p));
+	p[0].key = "name";
+	p[0].type = LWPROPERTY_STRING;
+	p[0].string_value = half ? "b" : "a";
+	p[1].key = half ? "height" : "count";
+	p[1].type = LWPROPERTY_INT;
+	p[1].int_value = -3;
+	p[2].key = "ok";
+	p[2].type = LWPROPERTY_BOOL;
+	p[2].int_value = 1;
+
+	CU_ASSERT_EQUAL(cu_mvt_add(layer, half ? "POINT(1 2)" : "MULTIPOINT(5 5,6 6)", p, 3, &id), LW_SUCCESS);
+	CU_ASSERT_EQUAL(cu_mvt_add(layer, "LINESTRING(0 0,10 0,10 10)", p + 1, 2, NULL), LW_SUCCESS);
+}
+
+static VectorTile__Tile *
+cu_mvt_decode(const lwvarlena_t *v)
+{
+	return vector_tile__tile__unpack(NULL, LWSIZE_GET(v->size) - LWVARHDRSZ, (const uint8_t *)v->data);
+}
+
+static int
+cu_mvt_same(const lwvarlena_t *a, const lwvarlena_t *b)
+{
+	return LWSIZE_GET(a->size) == LWSIZE_GET(b->size) && memcmp(a->data, b->data, LWSIZE_GET(a->size) - LWVARHDRSZ) == 0;
+}
+
+static void
+test_mvt_layer(void)
+{
+	LWMVT_LAYER *layer = lwmvt_layer_create("roads", 4096);
+	LWPROPERTY p[4];
+	VectorTile__Tile *tile;
+	VectorTile__Tile__Layer *l;
+	lwvarlena_t *v;
+	uint64_t id = 42;
+
+	memset(p, 0, sizeof(p));
+	p[0].key = "name";
+	p[0].type = LWPROPERTY_STRING;
+	p[0].string_value = "main";
+	p[1].key = NULL; /* Left out */
+	p[1].type = LWPROPERTY_INT;
+	p[2].key = "width";
+	p[2].type = LWPROPERTY_DOUBLE;
+	p[2].double_value = 2.5;
+	p[3].key = "nothing";
+	p[3].type = LWPROPERTY_STRING; /* No string, left out */
+
+	CU_ASSERT_EQUAL(cu_mvt_add(layer, "POINT(1 2)", p, 4, &id), LW_SUCCESS);
+	CU_ASSERT_EQUAL(cu_mvt_add(layer, "LINESTRING(0 0,3 0,3 4)", p, 1, NULL), LW_SUCCESS);
+	CU_ASSERT_EQUAL(cu_mvt_add(layer, "POLYGON((0 0,4 0,4 4,0 4,0 0))", NULL, 0, NULL), LW_SUCCESS);
+	/* Nothing to encode */
+	CU_ASSERT_EQUAL(cu_mvt_add(layer, "LINESTRING EMPTY", NULL, 0, NULL), LW_FAILURE);
+	CU_ASSERT_EQUAL(lwmvt_layer_nfeatures(layer), 3);
+
+	v = lwmvt_encode(&layer, 1);
+	tile = cu_mvt_decode(v);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(tile);
+	CU_ASSERT_EQUAL(tile->n_layers, 1);
+	l = tile->layers[0];
+	ASSERT_STRING_EQUAL(l->name, "roads");
+	CU_ASSERT_EQUAL(l->extent, 4096);
+	CU_ASSERT_EQUAL(l->version, 2);
+	CU_ASSERT_EQUAL(l->n_features, 3);
+
+	/* The keys and values are shared */
+	CU_ASSERT_EQUAL(l->n_keys, 2);
+	CU_ASSERT_EQUAL(l->n_values, 2);
+	CU_ASSERT_EQUAL(l->features[0]->n_tags, 4);
+	CU_ASSERT_EQUAL(l->features[1]->n_tags, 2);
+	CU_ASSERT_EQUAL(l->features[2]->n_tags, 0);
+	CU_ASSERT_EQUAL(l->features[1]->tags[0], l->features[0]->tags[0]);
+	CU_ASSERT_EQUAL(l->features[1]->tags[1], l->features[0]->tags[1]);
+	ASSERT_STRING_EQUAL(l->keys[l->features[0]->tags[2]], "width");
+	CU_ASSERT_DOUBLE_EQUAL(l->values[l->features[0]->tags[3]]->double_value, 2.5, 0);
+
+	/* Commands: MoveTo(1) of zigzag deltas, LineTo(n) and ClosePath */
+	CU_ASSERT(l->features[0]->has_id && l->features[0]->id == 42);
+	CU_ASSERT(!l->features[1]->has_id);
+	CU_ASSERT_EQUAL(l->features[0]->type, VECTOR_TILE__TILE__GEOM_TYPE__POINT);
+	CU_ASSERT_EQUAL(l->features[0]->n_geometry, 3);
+	CU_ASSERT_EQUAL(l->features[0]->geometry[0], 9);
+	CU_ASSERT_EQUAL(l->features[0]->geometry[1], 2);
+	CU_ASSERT_EQUAL(l->features[0]->geometry[2], 4);
+	CU_ASSERT_EQUAL(l->features[1]->type, VECTOR_TILE__TILE__GEOM_TYPE__LINESTRING);
+	CU_ASSERT_EQUAL(l->features[1]->n_geometry, 8);
+	CU_ASSERT_EQUAL(l->features[1]->geometry[3], (2 << 3) | 2);
+	CU_ASSERT_EQUAL(l->features[2]->type, VECTOR_TILE__TILE__GEOM_TYPE__POLYGON);
+	CU_ASSERT_EQUAL(l->features[2]->geometry[l->features[2]->n_geometry - 1], 15);
+
+	vector_tile__tile__free_unpacked(tile, NULL);
+	lwfree(v);
+	lwmvt_layer_free(layer);
+}
+
+/* A layer built in parts is the layer built at once */
+static void
+test_mvt_merge(void)
+{
+	LWMVT_LAYER *whole = lwmvt_layer_create("l", 4096);
+	LWMVT_LAYER *first = lwmvt_layer_create("l", 4096);
+	LWMVT_LAYER *second = lwmvt_layer_create("l", 4096);
+	LWMVT_LAYER *other = lwmvt_layer_create("l", 512);
+	lwvarlena_t *a, *b;
+
+	cu_mvt_fill(whole, 0);
+	cu_mvt_fill(whole, 1);
+	cu_mvt_fill(first, 0);
+	cu_mvt_fill(second, 1);
+
+	CU_ASSERT_EQUAL(lwmvt_layer_merge(first, second), LW_SUCCESS);
+	CU_ASSERT_EQUAL(lwmvt_layer_nfeatures(first), 4);
+	CU_ASSERT_EQUAL(lwmvt_layer_nfeatures(second), 2);
+	a = lwmvt_encode(&whole, 1);
+	b = lwmvt_encode(&first, 1);
+	CU_ASSERT(cu_mvt_same(a, b));
+	lwfree(a);
+	lwfree(b);
+
+	/* The merged layer is left as it was */
+	lwmvt_layer_free(whole);
+	whole = lwmvt_layer_create("l", 4096);
+	cu_mvt_fill(whole, 1);
+	a = lwmvt_encode(&whole, 1);
+	b = lwmvt_encode(&second, 1);
+	CU_ASSERT(cu_mvt_same(a, b));
+	lwfree(a);
+	lwfree(b);
+
+	/* Merging into itself doubles the features */
+	lwmvt_layer_free(whole);
+	whole = lwmvt_layer_create("l", 4096);
+	cu_mvt_fill(whole, 0);
+	cu_mvt_fill(whole, 1);
+	cu_mvt_fill(whole, 0);
+	cu_mvt_fill(whole, 1);
+	CU_ASSERT_EQUAL(lwmvt_layer_merge(first, first), LW_SUCCESS);
+	CU_ASSERT_EQUAL(lwmvt_layer_nfeatures(first), 8);
+	a = lwmvt_encode(&whole, 1);
+	b = lwmvt_encode(&first, 1);
+	CU_ASSERT(cu_mvt_same(a, b));
+	lwfree(a);
+	lwfree(b);
+
+	/* Empty layers */
+	lwmvt_layer_free(second);
+	second = lwmvt_layer_create("l", 4096);
+	CU_ASSERT_EQUAL(lwmvt_layer_merge(first, second), LW_SUCCESS);
+	CU_ASSERT_EQUAL(lwmvt_layer_merge(second, second), LW_SUCCESS);
+	CU_ASSERT_EQUAL(lwmvt_layer_nfeatures(first), 8);
+	CU_ASSERT_EQUAL(lwmvt_layer_nfeatures(second), 0);
+
+	/* Extents must match */
+	CU_ASSERT_EQUAL(lwmvt_layer_merge(first, other), LW_FAILURE);
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+
+	lwmvt_layer_free(whole);
+	lwmvt_layer_free(first);
+	lwmvt_layer_free(second);
+	lwmvt_layer_free(other);
+}
+
+/* Layers encoded apart concatenate into one tile */
+static void
+test_mvt_tiles(void)
+{
+	LWMVT_LAYER *layers[2];
+	lwvarlena_t *both, *a, *b;
+	size_t size_a, size_b;
+
+	layers[0] = lwmvt_layer_create("a", 4096);
+	layers[1] = lwmvt_layer_create("b", 256);
+	cu_mvt_fill(layers[0], 0);
+	cu_mvt_fill(layers[1], 1);
+
+	both = lwmvt_encode(layers, 2);
+	a = lwmvt_encode(layers, 1);
+	b = lwmvt_encode(layers + 1, 1);
+	size_a = LWSIZE_GET(a->size) - LWVARHDRSZ;
+	size_b = LWSIZE_GET(b->size) - LWVARHDRSZ;
+	CU_ASSERT_EQUAL(LWSIZE_GET(both->size) - LWVARHDRSZ, size_a + size_b);
+	CU_ASSERT_EQUAL(memcmp(both->data, a->data, size_a), 0);
+	CU_ASSERT_EQUAL(memcmp(both->data + size_a, b->data, size_b), 0);
+	lwfree(both);
+	lwfree(a);
+	lwfree(b);
+
+	/* No layers, no bytes */
+	both = lwmvt_encode(layers, 0);
+	CU_ASSERT_EQUAL(LWSIZE_GET(both->size), LWVARHDRSZ);
+	lwfree(both);
+
+	lwmvt_layer_free(layers[0]);
+	lwmvt_layer_free(layers[1]);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void out_mvt_suite_setup(void);
+void out_mvt_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("out_mvt", NULL, NULL);
+	PG_ADD_TEST(suite, test_mvt_geom);
+	PG_ADD_TEST(suite, test_mvt_layer);
+	PG_ADD_TEST(suite, test_mvt_merge);
+	PG_ADD_TEST(suite, test_mvt_tiles);
+}
@@ -0,0 +1,236 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "stringbuffer.h"
+#include "cu_tester.h"
+
+/* Point array text the way lwprint_double formats every ordinate */
+static char *
+cu_wkt_reference(const POINTARRAY *pa, int precision)
+{
+	stringbuffer_t *sb = stringbuffer_create();
+	uint32_t i, d, ndims = FLAGS_NDIMS(pa->flags);
+	char *str;
+
+	stringbuffer_append_len(sb, "(", 1);
+	for (i = 0; i < pa->npoints; i++)
+	{
+		const double *c = (const double *)getPoint_internal(pa, i);
+		for (d = 0; d < ndims; d++)
+		{
+			if (d)
+				stringbuffer_append_len(sb, " ", 1);
+			stringbuffer_append_double(sb, c[d], precision);
+		}
+		if (i + 1 < pa->npoints)
+			stringbuffer_append_len(sb, ",", 1);
+	}
+	stringbuffer_append_len(sb, ")", 1);
+	str = stringbuffer_getstringcopy(sb);
+	stringbuffer_destroy(sb);
+	return str;
+}
+
+/* Widest outputs of lwprint_double, and values around the notation switch */
+static double
+cu_wkt_value(void)
+{
+	static const double special[] = {0.0,
+					 -0.0,
+					 -1.2345678901234567e-300,
+					 -DBL_MAX,
+					 DBL_MIN,
+					 -9.999999999999999e14,
+					 -1e15,
+					 1e15,
+					 -1e-8,
+					 1e-9,
+					 -123456789012345.67,
+					 0.1,
+					 -5e-324};
+	int r = rand() % 30;
+	if (r < (int)(sizeof(special) / sizeof(special[0])))
+		return special[r];
+	return (2.0 * rand() / RAND_MAX - 1.0) * pow(10.0, rand() % 30 - 10);
+}
+
+static void
+test_wkt_out_ordinates(void)
+{
+	int precisions[] = {-1, 0, 1, 5, 15, 17, 20};
+	uint32_t p, dims, trial, i;
+
+	srand(19);
+	for (p = 0; p < sizeof(precisions) / sizeof(precisions[0]); p++)
+	{
+		for (dims = 0; dims < 4; dims++)
+		{
+			for (trial = 0; trial < 20; trial++)
+			{
+				uint32_t npoints = 1 + rand() % 40;
+				POINTARRAY *pa = ptarray_construct(dims & 1, dims >> 1, npoints);
+				LWGEOM *line;
+				char *ref, *wkt, expected[8192];
+				const char *qualifier = dims == 3 ? " ZM " : dims == 2 ? " M " : dims == 1 ? " Z " : "";
+				size_t size = 0;
+
+				for (i = 0; i < npoints; i++)
+				{
+					POINT4D pt;
+					pt.x = cu_wkt_value();
+					pt.y = cu_wkt_value();
+					pt.z = cu_wkt_value();
+					pt.m = cu_wkt_value();
+					ptarray_set_point4d(pa, i, &pt);
+				}
+				line = lwline_as_lwgeom(lwline_construct(SRID_UNKNOWN, NULL, pa));
+				ref = cu_wkt_reference(pa, precisions[p]);
+				snprintf(expected, sizeof(expected), "LINESTRING%s%s", qualifier, ref);
+
+				wkt = lwgeom_to_wkt(line, WKT_ISO, precisions[p], &size);
+				ASSERT_STRING_EQUAL(wkt, expected);
+				CU_ASSERT_EQUAL(size, strlen(wkt) + 1);
+
+				lwfree(wkt);
+				lwfree(ref);
+				lwgeom_free(line);
+			}
+		}
+	}
+}
+
+static void
+cu_wkt_out(const char *in, uint8_t variant, int precision, const char *expected)
+{
+	LWGEOM *geom = lwgeom_from_wkt(in, LW_PARSER_CHECK_NONE);
+	char *wkt;
+	lwvarlena_t *v;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(geom);
+	wkt = lwgeom_to_wkt(geom, variant, precision, NULL);
+	ASSERT_STRING_EQUAL(wkt, expected);
+
+	/* The varlena has the same text */
+	v = lwgeom_to_wkt_varlena(geom, variant, precision);
+	CU_ASSERT_EQUAL(LWSIZE_GET(v->size) - LWVARHDRSZ, strlen(expected));
+	CU_ASSERT_EQUAL(memcmp(v->data, expected, strlen(expected)), 0);
+
+	lwfree(v);
+	lwfree(wkt);
+	lwgeom_free(geom);
+}
+
+static void
+test_wkt_out_types(void)
+{
+	cu_wkt_out("POINT(1 2)", WKT_ISO, 15, "POINT(1 2)");
+	cu_wkt_out("POINT EMPTY", WKT_ISO, 15, "POINT EMPTY");
+	cu_wkt_out("POINT ZM EMPTY", WKT_ISO, 15, "POINT ZM EMPTY");
+	cu_wkt_out("POINTM(1 2 3)", WKT_EXTENDED, 15, "POINTM(1 2 3)");
+	cu_wkt_out("POINTM(1 2 3)", WKT_ISO, 15, "POINT M (1 2 3)");
+	cu_wkt_out("POINT(1 2 3 4)", WKT_SFSQL, 15, "POINT(1 2)");
+	cu_wkt_out("SRID=4326;POINT(1.123456 2)", WKT_EXTENDED, 3, "SRID=4326;POINT(1.123 2)");
+	cu_wkt_out("SRID=4326;POINT(1 2)", WKT_ISO, 15, "POINT(1 2)");
+	cu_wkt_out("LINESTRING EMPTY", WKT_ISO, 15, "LINESTRING EMPTY");
+	cu_wkt_out("MULTIPOINT(1 2,EMPTY,3 4)", WKT_ISO, 15, "MULTIPOINT((1 2),EMPTY,(3 4))");
+	cu_wkt_out("POLYGON((0 0,1 0,1 1,0 0),(0.2 0.2,0.3 0.2,0.3 0.3,0.2 0.2))",
+		   WKT_ISO,
+		   15,
+		   "POLYGON((0 0,1 0,1 1,0 0),(0.2 0.2,0.3 0.2,0.3 0.3,0.2 0.2))");
+	cu_wkt_out("POLYGON Z EMPTY", WKT_ISO, 15, "POLYGON Z EMPTY");
+	cu_wkt_out("MULTIPOLYGON(((0 0,1 0,1 1,0 0)),EMPTY)", WKT_ISO, 15, "MULTIPOLYGON(((0 0,1 0,1 1,0 0)),EMPTY)");
+	cu_wkt_out("TRIANGLE((0 0,1 0,1 1,0 0))", WKT_ISO, 15, "TRIANGLE((0 0,1 0,1 1,0 0))");
+	cu_wkt_out("CURVEPOLYGON(CIRCULARSTRING(0 0,1 1,2 0,1 -1,0 0),(0.5 0,1 0.5,1.5 0,0.5 0))",
+		   WKT_ISO,
+		   15,
+		   "CURVEPOLYGON(CIRCULARSTRING(0 0,1 1,2 0,1 -1,0 0),(0.5 0,1 0.5,1.5 0,0.5 0))");
+	cu_wkt_out("GEOMETRYCOLLECTION(POINT Z (1 2 3),GEOMETRYCOLLECTION EMPTY,LINESTRING Z (0 0 0,1 1 1))",
+		   WKT_ISO,
+		   15,
+		   "GEOMETRYCOLLECTION Z (POINT Z (1 2 3),GEOMETRYCOLLECTION EMPTY,LINESTRING Z (0 0 0,1 1 1))");
+	cu_wkt_out("POINT(1e300 -1e-300)", WKT_ISO, 15, "POINT(1e+300 -1e-300)");
+	cu_wkt_out("POINT(0.123456789 -0.6)", WKT_ISO, 0, "POINT(0 -1)");
+}
+
+/* Large geometries with the widest ordinates, reading back to the same text */
+static void
+test_wkt_out_round_trip(void)
+{
+	uint32_t npoints = 5000, i;
+	POINTARRAY *pa = ptarray_construct(1, 1, npoints);
+	LWGEOM *geom, *back;
+	lwvarlena_t *v;
+	char *wkt, *wkt_back;
+
+	srand(20);
+	for (i = 0; i < npoints; i++)
+	{
+		POINT4D pt;
+		pt.x = -DBL_MAX / (1 + rand() % 1000);
+		pt.y = -1.2345678901234567e-300 * (1 + rand() % 1000);
+		pt.z = -123456789012345.67 + rand();
+		pt.m = (double)rand() / RAND_MAX;
+		ptarray_set_point4d(pa, i, &pt);
+	}
+	geom = lwmpoint_as_lwgeom(lwmpoint_construct(4326, pa));
+	ptarray_free(pa);
+
+	wkt = lwgeom_to_wkt(geom, WKT_EXTENDED, 17, NULL);
+	back = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(back);
+	wkt_back = lwgeom_to_wkt(back, WKT_EXTENDED, 17, NULL);
+	ASSERT_STRING_EQUAL(wkt_back, wkt);
+	CU_ASSERT_EQUAL(back->srid, 4326);
+	CU_ASSERT_EQUAL(lwgeom_count_vertices(back), npoints);
+
+	v = lwgeom_to_wkt_varlena(geom, WKT_EXTENDED, 17);
+	CU_ASSERT_EQUAL(LWSIZE_GET(v->size) - LWVARHDRSZ, strlen(wkt));
+	CU_ASSERT_EQUAL(memcmp(v->data, wkt, strlen(wkt)), 0);
+
+	lwfree(v);
+	lwfree(wkt);
+	lwfree(wkt_back);
+	lwgeom_free(back);
+	lwgeom_free(geom);
+
+	/* No geometry, no text */
+	CU_ASSERT_PTR_NULL(lwgeom_to_wkt(NULL, WKT_ISO, 15, NULL));
+	CU_ASSERT_PTR_NULL(lwgeom_to_wkt_varlena(NULL, WKT_ISO, 15));
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void out_wkt_suite_setup(void);
+void out_wkt_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("out_wkt", NULL, NULL);
+	PG_ADD_TEST(suite, test_wkt_out_ordinates);
+	PG_ADD_TEST(suite, test_wkt_out_types);
+	PG_ADD_TEST(suite, test_wkt_out_round_trip);
+}
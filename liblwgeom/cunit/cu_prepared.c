@@ -0,0 +1,160 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "cu_tester.h"
+
+static void
+cu_prepared_check(const char *wkt1, const char *wkt2, int intersects, int contains, int covers, int within)
+{
+	LWGEOM *g1 = lwgeom_from_wkt(wkt1, LW_PARSER_CHECK_NONE);
+	LWGEOM *g2 = lwgeom_from_wkt(wkt2, LW_PARSER_CHECK_NONE);
+	LWPREPARED *prep;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(g1);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(g2);
+
+	/* Cached and explicit prepared geometries agree */
+	ASSERT_INT_EQUAL(lwgeom_prepared_intersects(g1, g2), intersects);
+	ASSERT_INT_EQUAL(lwgeom_prepared_contains(g1, g2), contains);
+	ASSERT_INT_EQUAL(lwgeom_prepared_covers(g1, g2), covers);
+	ASSERT_INT_EQUAL(lwgeom_prepared_within(g1, g2), within);
+
+	prep = lwgeom_prepare(g1);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(prep);
+	ASSERT_INT_EQUAL(lwprepared_intersects(prep, g2), intersects);
+	ASSERT_INT_EQUAL(lwprepared_contains(prep, g2), contains);
+	ASSERT_INT_EQUAL(lwprepared_covers(prep, g2), covers);
+	ASSERT_INT_EQUAL(lwprepared_within(prep, g2), within);
+	lwprepared_free(prep);
+
+	lwgeom_free(g1);
+	lwgeom_free(g2);
+}
+
+static void
+test_prepared_predicates(void)
+{
+	const char *square = "POLYGON((0 0,10 0,10 10,0 10,0 0))";
+
+	lwprepared_cache_destroy();
+	cu_prepared_check(square, "POINT(5 5)", LW_TRUE, LW_TRUE, LW_TRUE, LW_FALSE);
+	cu_prepared_check(square, "POINT(10 5)", LW_TRUE, LW_FALSE, LW_TRUE, LW_FALSE);
+	cu_prepared_check(square, "POINT(11 5)", LW_FALSE, LW_FALSE, LW_FALSE, LW_FALSE);
+	cu_prepared_check(square, "LINESTRING(5 5,15 5)", LW_TRUE, LW_FALSE, LW_FALSE, LW_FALSE);
+	cu_prepared_check("POINT(5 5)", square, LW_TRUE, LW_FALSE, LW_FALSE, LW_TRUE);
+	cu_prepared_check(square, "POINT EMPTY", LW_FALSE, LW_FALSE, LW_FALSE, LW_FALSE);
+	cu_prepared_check("POLYGON EMPTY", "POINT(5 5)", LW_FALSE, LW_FALSE, LW_FALSE, LW_FALSE);
+
+	/* Mixed SRIDs are an error */
+	{
+		LWGEOM *g1 = lwgeom_from_wkt("SRID=4326;POINT(1 1)", LW_PARSER_CHECK_NONE);
+		LWGEOM *g2 = lwgeom_from_wkt("SRID=3857;POINT(1 1)", LW_PARSER_CHECK_NONE);
+		cu_error_msg_reset();
+		ASSERT_INT_EQUAL(lwgeom_prepared_intersects(g1, g2), -1);
+		CU_ASSERT(strstr(cu_error_msg, "mixed SRID") != NULL);
+		cu_error_msg_reset();
+		lwgeom_free(g1);
+		lwgeom_free(g2);
+	}
+	lwprepared_cache_destroy();
+}
+
+/* Regular polygon of 1000 sides, with a spike out to r = 20 at vertex 501 */
+static LWGEOM *
+cu_prepared_ring(int spike)
+{
+	POINTARRAY *pa = ptarray_construct(0, 0, 1001);
+	LWPOLY *poly = lwpoly_construct_empty(SRID_UNKNOWN, 0, 0);
+	POINT4D pt = {0, 0, 0, 0};
+	uint32_t i;
+
+	for (i = 0; i <= 1000; i++)
+	{
+		double r = (spike && i == 501) ? 20.0 : 10.0;
+		pt.x = r * cos(2 * M_PI * (i % 1000) / 1000.0);
+		pt.y = r * sin(2 * M_PI * (i % 1000) / 1000.0);
+		ptarray_set_point4d(pa, i, &pt);
+	}
+	lwpoly_add_ring(poly, pa);
+	return lwpoly_as_lwgeom(poly);
+}
+
+static void
+test_prepared_cache(void)
+{
+	LWGEOM *plain = cu_prepared_ring(LW_FALSE);
+	LWGEOM *spiked = cu_prepared_ring(LW_TRUE);
+	LWGEOM *probe;
+	uint64_t hits, misses;
+	uint32_t size;
+	int i;
+
+	probe = lwpoint_as_lwgeom(lwpoint_make2d(SRID_UNKNOWN,
+						 15.0 * cos(2 * M_PI * 501 / 1000.0),
+						 15.0 * sin(2 * M_PI * 501 / 1000.0)));
+
+	/* The two polygons only differ by a vertex outside the key sample */
+	lwprepared_cache_destroy();
+	for (i = 0; i < 3; i++)
+	{
+		CU_ASSERT_EQUAL(lwgeom_prepared_contains(plain, probe), LW_FALSE);
+		CU_ASSERT_EQUAL(lwgeom_prepared_contains(spiked, probe), LW_TRUE);
+	}
+	lwprepared_cache_stats(&hits, &misses, &size);
+	CU_ASSERT_EQUAL(misses, 2);
+	CU_ASSERT_EQUAL(hits, 4);
+	CU_ASSERT_EQUAL(size, 2);
+
+	/* Equal copies share the entry, freed inputs do not matter */
+	{
+		LWGEOM *copy = lwgeom_clone_deep(spiked);
+		lwgeom_free(spiked);
+		CU_ASSERT_EQUAL(lwgeom_prepared_contains(copy, probe), LW_TRUE);
+		lwprepared_cache_stats(&hits, &misses, &size);
+		CU_ASSERT_EQUAL(misses, 2);
+		lwgeom_free(copy);
+	}
+
+	lwprepared_cache_flush();
+	lwprepared_cache_stats(&hits, &misses, &size);
+	CU_ASSERT_EQUAL(size, 0);
+	CU_ASSERT_EQUAL(hits, 5);
+	lwprepared_cache_destroy();
+
+	lwgeom_free(plain);
+	lwgeom_free(probe);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void prepared_suite_setup(void);
+void prepared_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("prepared", NULL, NULL);
+	PG_ADD_TEST(suite, test_prepared_predicates);
+	PG_ADD_TEST(suite, test_prepared_cache);
+}
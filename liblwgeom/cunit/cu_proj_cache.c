@@ -0,0 +1,236 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "cu_tester.h"
+
+#define WGS84 "EPSG:4326"
+#define MERCATOR "EPSG:3857"
+#define UTM31 "EPSG:32631"
+#define AXISSWAP "+proj=pipeline +step +proj=axisswap +order=2,1"
+
+static void
+test_proj_cache_hits(void)
+{
+	LWPROJ *a, *b, *c;
+	uint64_t hits, misses;
+	uint32_t size;
+
+	lwproj_cache_destroy();
+	lwproj_cache_stats(&hits, &misses, &size);
+	CU_ASSERT_EQUAL(hits, 0);
+	CU_ASSERT_EQUAL(misses, 0);
+	CU_ASSERT_EQUAL(size, 0);
+
+	a = lwproj_cache_get(WGS84, MERCATOR);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(a);
+	b = lwproj_cache_get(WGS84, MERCATOR);
+	CU_ASSERT_PTR_EQUAL(a, b);
+	lwproj_cache_stats(&hits, &misses, &size);
+	CU_ASSERT_EQUAL(hits, 1);
+	CU_ASSERT_EQUAL(misses, 1);
+	CU_ASSERT_EQUAL(size, 1);
+
+	/* The direction is part of the key, so is the definition kind */
+	b = lwproj_cache_get(MERCATOR, WGS84);
+	CU_ASSERT_PTR_NOT_NULL(b);
+	CU_ASSERT(a != b);
+	b = lwproj_cache_get_pipeline(AXISSWAP, true);
+	c = lwproj_cache_get_pipeline(AXISSWAP, false);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(b);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(c);
+	CU_ASSERT(b != c);
+	CU_ASSERT(b->pipeline_is_forward);
+	CU_ASSERT_FALSE(c->pipeline_is_forward);
+	CU_ASSERT_PTR_EQUAL(lwproj_cache_get_pipeline(AXISSWAP, false), c);
+	lwproj_cache_stats(&hits, &misses, &size);
+	CU_ASSERT_EQUAL(hits, 2);
+	CU_ASSERT_EQUAL(misses, 4);
+	CU_ASSERT_EQUAL(size, 4);
+
+	/* Failures are not cached */
+	CU_ASSERT_PTR_NULL(lwproj_cache_get("+proj=bogus", MERCATOR));
+	CU_ASSERT_PTR_NULL(lwproj_cache_get(NULL, MERCATOR));
+	CU_ASSERT_PTR_NULL(lwproj_cache_get_pipeline(NULL, true));
+	lwproj_cache_stats(&hits, &misses, &size);
+	CU_ASSERT_EQUAL(misses, 5);
+	CU_ASSERT_EQUAL(size, 4);
+
+	/* Flushing keeps the statistics */
+	lwproj_cache_flush();
+	lwproj_cache_stats(&hits, &misses, &size);
+	CU_ASSERT_EQUAL(hits, 2);
+	CU_ASSERT_EQUAL(size, 0);
+	lwproj_cache_destroy();
+}
+
+static void
+test_proj_cache_lru(void)
+{
+	LWPROJ *a, *b, *c;
+	uint64_t hits, misses;
+	uint32_t size;
+
+	lwproj_cache_destroy();
+	lwproj_cache_set_size(2);
+	a = lwproj_cache_get(WGS84, MERCATOR);
+	b = lwproj_cache_get(WGS84, UTM31);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(a);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(b);
+
+	/* Touch a, so b is the least recently used and goes away */
+	CU_ASSERT_PTR_EQUAL(lwproj_cache_get(WGS84, MERCATOR), a);
+	c = lwproj_cache_get(MERCATOR, WGS84);
+	CU_ASSERT_PTR_NOT_NULL(c);
+	lwproj_cache_stats(&hits, &misses, &size);
+	CU_ASSERT_EQUAL(size, 2);
+	CU_ASSERT_PTR_EQUAL(lwproj_cache_get(WGS84, MERCATOR), a);
+	lwproj_cache_get(WGS84, UTM31);
+	lwproj_cache_stats(&hits, &misses, &size);
+	CU_ASSERT_EQUAL(hits, 2);
+	CU_ASSERT_EQUAL(misses, 4);
+	CU_ASSERT_EQUAL(size, 2);
+
+	/* Shrinking flushes, sizes are clamped */
+	lwproj_cache_set_size(1);
+	lwproj_cache_stats(NULL, NULL, &size);
+	CU_ASSERT_EQUAL(size, 0);
+	lwproj_cache_set_size(0);
+	lwproj_cache_get(WGS84, MERCATOR);
+	lwproj_cache_get(WGS84, UTM31);
+	lwproj_cache_stats(NULL, NULL, &size);
+	CU_ASSERT_EQUAL(size, 1);
+	lwproj_cache_set_size(LWPROJ_CACHE_MAX_ITEMS + 10);
+	lwproj_cache_get(WGS84, MERCATOR);
+	lwproj_cache_stats(NULL, NULL, &size);
+	CU_ASSERT_EQUAL(size, 2);
+	lwproj_cache_destroy();
+}
+
+/* Cached transformations give the same coordinates as fresh LWPROJ */
+static void
+test_proj_cache_transform(void)
+{
+	const char *wkt = "LINESTRING Z(1 50 10,2 51 20,3 52 30,4 53 40)";
+	LWGEOM *cached, *fresh;
+	LWPROJ *lp;
+	int i;
+
+	lwproj_cache_destroy();
+	for (i = 0; i < 2; i++)
+	{
+		cached = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+		fresh = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+		CU_ASSERT_EQUAL(lwgeom_transform_from_str(cached, WGS84, UTM31), LW_SUCCESS);
+		lp = lwproj_from_str(WGS84, UTM31);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(lp);
+		CU_ASSERT_EQUAL(lwgeom_transform(fresh, lp), LW_SUCCESS);
+		proj_destroy(lp->pj);
+		lwfree(lp);
+		CU_ASSERT(lwgeom_same(cached, fresh));
+		lwgeom_free(cached);
+		lwgeom_free(fresh);
+
+		cached = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+		fresh = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+		CU_ASSERT_EQUAL(lwgeom_transform_pipeline(cached, AXISSWAP, false), LW_SUCCESS);
+		lp = lwproj_from_str_pipeline(AXISSWAP, false);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(lp);
+		CU_ASSERT_EQUAL(lwgeom_transform(fresh, lp), LW_SUCCESS);
+		proj_destroy(lp->pj);
+		lwfree(lp);
+		CU_ASSERT(lwgeom_same(cached, fresh));
+		lwgeom_free(cached);
+		lwgeom_free(fresh);
+	}
+
+	/* Second round was served from the cache */
+	{
+		uint64_t hits, misses;
+		lwproj_cache_stats(&hits, &misses, NULL);
+		CU_ASSERT_EQUAL(hits, 2);
+		CU_ASSERT_EQUAL(misses, 2);
+	}
+
+	/* Unknown definitions still report an error */
+	cached = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+	cu_error_msg_reset();
+	CU_ASSERT_EQUAL(lwgeom_transform_from_str(cached, "+proj=bogus", UTM31), LW_FAILURE);
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+	lwgeom_free(cached);
+	lwproj_cache_destroy();
+}
+
+/* Entries of a replaced PROJ context are dropped, never destroyed */
+static void
+test_proj_cache_context(void)
+{
+	LWGEOM_CONTEXT *ctx = lwcontext();
+	void *pj_ctx_old = ctx->pj_ctx;
+	void *pj_ctx_new = proj_context_create();
+	LWPROJ *a, *b;
+	PJ *pj_old;
+	uint32_t size;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(pj_ctx_new);
+	lwproj_cache_destroy();
+	a = lwproj_cache_get(WGS84, MERCATOR);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(a);
+	pj_old = a->pj;
+
+	ctx->pj_ctx = pj_ctx_new;
+	b = lwproj_cache_get(WGS84, MERCATOR);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(b);
+	CU_ASSERT(b->pj != pj_old);
+	lwproj_cache_stats(NULL, NULL, &size);
+	CU_ASSERT_EQUAL(size, 1);
+
+	/* The stale PJ is still ours, destroy it while its context lives */
+	ctx->pj_ctx = pj_ctx_old;
+	proj_destroy(pj_old);
+
+	/* Flushing before dropping the new context releases its entries */
+	ctx->pj_ctx = pj_ctx_new;
+	lwproj_cache_flush();
+	lwproj_cache_stats(NULL, NULL, &size);
+	CU_ASSERT_EQUAL(size, 0);
+	ctx->pj_ctx = pj_ctx_old;
+	proj_context_destroy(pj_ctx_new);
+	lwproj_cache_destroy();
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void proj_cache_suite_setup(void);
+void proj_cache_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("proj_cache", NULL, NULL);
+	PG_ADD_TEST(suite, test_proj_cache_hits);
+	PG_ADD_TEST(suite, test_proj_cache_lru);
+	PG_ADD_TEST(suite, test_proj_cache_transform);
+	PG_ADD_TEST(suite, test_proj_cache_context);
+}
@@ -0,0 +1,176 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "lwtree.h"
+#include "cu_tester.h"
+
+/* Zig-zag line of npoints vertices, vertex "moved" pushed up by delta */
+static LWGEOM *
+cu_rect_line(uint32_t npoints, uint32_t moved, double delta)
+{
+	POINTARRAY *pa = ptarray_construct(0, 0, npoints);
+	POINT4D pt = {0, 0, 0, 0};
+	uint32_t i;
+
+	for (i = 0; i < npoints; i++)
+	{
+		pt.x = i;
+		pt.y = (i % 2) + (i == moved ? delta : 0);
+		ptarray_set_point4d(pa, i, &pt);
+	}
+	return lwline_as_lwgeom(lwline_construct(SRID_UNKNOWN, NULL, pa));
+}
+
+static void
+test_rect_tree_cache_distance(void)
+{
+	LWGEOM *line = cu_rect_line(1000, 0, 0.0);
+	LWGEOM *poly = lwgeom_from_wkt("POLYGON((-5 -5,1005 -5,1005 -2,-5 -2,-5 -5))", LW_PARSER_CHECK_NONE);
+	uint64_t hits, misses;
+	uint32_t size;
+	int i;
+
+	rect_tree_cache_destroy();
+	srand(8);
+	for (i = 0; i < 200; i++)
+	{
+		LWGEOM *pt = lwpoint_as_lwgeom(lwpoint_make2d(SRID_UNKNOWN,
+							      -10.0 + 1020.0 * rand() / RAND_MAX,
+							      -10.0 + 20.0 * rand() / RAND_MAX));
+		CU_ASSERT_DOUBLE_EQUAL(lwgeom_rect_tree_distance(line, pt, 0.0), lwgeom_mindistance2d(line, pt), 1e-12);
+		CU_ASSERT_DOUBLE_EQUAL(lwgeom_rect_tree_distance(pt, poly, 0.0), lwgeom_mindistance2d(pt, poly), 1e-12);
+		lwgeom_free(pt);
+	}
+	CU_ASSERT_DOUBLE_EQUAL(lwgeom_rect_tree_distance(line, poly, 0.0), 2.0, 1e-12);
+	CU_ASSERT_FALSE(lwgeom_rect_tree_intersects(line, poly));
+
+	/* Probe points are too small to be cached, the line is built once */
+	rect_tree_cache_stats(&hits, &misses, &size);
+	CU_ASSERT_EQUAL(misses, 1);
+	CU_ASSERT_EQUAL(hits, 201);
+	CU_ASSERT_EQUAL(size, 1);
+
+	/* Empties never reach the cache */
+	{
+		LWGEOM *empty = lwgeom_from_wkt("POINT EMPTY", LW_PARSER_CHECK_NONE);
+		CU_ASSERT(lwgeom_rect_tree_distance(line, empty, 0.0) == FLT_MAX);
+		CU_ASSERT_FALSE(lwgeom_rect_tree_intersects(empty, line));
+		lwgeom_free(empty);
+	}
+
+	rect_tree_cache_destroy();
+	lwgeom_free(line);
+	lwgeom_free(poly);
+}
+
+static void
+test_rect_tree_cache_collision(void)
+{
+	/* Same key, the second line has a spike at an unsampled vertex */
+	LWGEOM *flat = cu_rect_line(1000, 501, 0.0);
+	LWGEOM *spiked = cu_rect_line(1000, 501, 10.0);
+	LWGEOM *pt = lwpoint_as_lwgeom(lwpoint_make2d(SRID_UNKNOWN, 501, 11));
+	LWGEOM *crossing = lwgeom_from_wkt("LINESTRING(495 5,505 5)", LW_PARSER_CHECK_NONE);
+	uint64_t hits, misses;
+	int i;
+
+	rect_tree_cache_destroy();
+	for (i = 0; i < 3; i++)
+	{
+		CU_ASSERT_DOUBLE_EQUAL(lwgeom_rect_tree_distance(flat, pt, 0.0), lwgeom_mindistance2d(flat, pt), 1e-12);
+		CU_ASSERT_DOUBLE_EQUAL(lwgeom_rect_tree_distance(spiked, pt, 0.0), 0.0, 1e-12);
+		CU_ASSERT_FALSE(lwgeom_rect_tree_intersects(flat, crossing));
+		CU_ASSERT(lwgeom_rect_tree_intersects(spiked, crossing));
+	}
+	rect_tree_cache_stats(&hits, &misses, NULL);
+	CU_ASSERT_EQUAL(misses, 2);
+	CU_ASSERT_EQUAL(hits, 10);
+
+	/* A changed input is not served the tree of its old self */
+	{
+		POINT4D p = {501, 1, 0, 0};
+		ptarray_set_point4d(lwgeom_as_lwline(spiked)->points, 501, &p);
+		CU_ASSERT_DOUBLE_EQUAL(lwgeom_rect_tree_distance(spiked, pt, 0.0), 10.0, 1e-12);
+	}
+
+	rect_tree_cache_destroy();
+	lwgeom_free(flat);
+	lwgeom_free(spiked);
+	lwgeom_free(pt);
+	lwgeom_free(crossing);
+}
+
+/* Lines that only touch intersect, cached or not */
+static void
+test_rect_tree_cache_touching(void)
+{
+	const char *pairs[][2] = {
+	    /* Shared endpoint, with the last vertex of the long line */
+	    {NULL, "LINESTRING(999 1,1010 5)"},
+	    /* T-junction in the middle of a segment of the long line */
+	    {NULL, "LINESTRING(500.5 -3,500.5 0.5)"},
+	    /* Ending on a vertex of the long line */
+	    {NULL, "LINESTRING(300 -3,300 0)"},
+	    {"LINESTRING(0 0,1 1)", "LINESTRING(1 1,2 0)"},
+	    {"LINESTRING(0 0,2 0)", "LINESTRING(1 0,1 5)"},
+	    {"POLYGON((0 0,2 0,2 2,0 2,0 0))", "LINESTRING(2 1,3 1)"}};
+	LWGEOM *line = cu_rect_line(1000, 0, 0.0);
+	size_t i;
+	int j;
+
+	rect_tree_cache_destroy();
+	for (i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++)
+	{
+		LWGEOM *g1 = pairs[i][0] ? lwgeom_from_wkt(pairs[i][0], LW_PARSER_CHECK_NONE) : line;
+		LWGEOM *g2 = lwgeom_from_wkt(pairs[i][1], LW_PARSER_CHECK_NONE);
+
+		CU_ASSERT_DOUBLE_EQUAL(lwgeom_mindistance2d(g1, g2), 0.0, 0.0);
+		/* Twice, the second time from the cache */
+		for (j = 0; j < 2; j++)
+		{
+			CU_ASSERT(lwgeom_rect_tree_intersects(g1, g2));
+			CU_ASSERT(lwgeom_rect_tree_intersects(g2, g1));
+		}
+		if (g1 != line)
+			lwgeom_free(g1);
+		lwgeom_free(g2);
+	}
+
+	rect_tree_cache_destroy();
+	lwgeom_free(line);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void rect_tree_cache_suite_setup(void);
+void rect_tree_cache_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("rect_tree_cache", NULL, NULL);
+	PG_ADD_TEST(suite, test_rect_tree_cache_distance);
+	PG_ADD_TEST(suite, test_rect_tree_cache_collision);
+	PG_ADD_TEST(suite, test_rect_tree_cache_touching);
+}
@@ -0,0 +1,277 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "cu_tester.h"
+
+typedef struct
+{
+	uint32_t n, m;
+	uint8_t *pairs; /* n x m, times every pair was reported */
+	uint32_t count;
+	uint32_t stop_after;
+} CU_JOIN_RESULT;
+
+static int
+cu_join_collect(uint32_t ia, uint32_t ib, void *data)
+{
+	CU_JOIN_RESULT *r = data;
+	CU_ASSERT(ia < r->n && ib < r->m);
+	if (ia < r->n && ib < r->m)
+		r->pairs[(size_t)ia * r->m + ib]++;
+	r->count++;
+	return !r->stop_after || r->count < r->stop_after;
+}
+
+static void
+cu_join_result_init(CU_JOIN_RESULT *r, uint32_t n, uint32_t m)
+{
+	memset(r, 0, sizeof(CU_JOIN_RESULT));
+	r->n = n;
+	r->m = m;
+	r->pairs = lwalloc((size_t)n * m + 1);
+	memset(r->pairs, 0, (size_t)n * m + 1);
+}
+
+/* Points, lines, small polygons and empties over [0,100) x [0,100) */
+static LWGEOM **
+cu_join_geoms(uint32_t n)
+{
+	LWGEOM **geoms = lwalloc(n * sizeof(LWGEOM *));
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		double x = 100.0 * rand() / RAND_MAX;
+		double y = 100.0 * rand() / RAND_MAX;
+		double w = 5.0 * rand() / RAND_MAX;
+		char wkt[256];
+
+		switch (i % 5)
+		{
+		case 0:
+			snprintf(wkt, sizeof(wkt), "POINT(%.4f %.4f)", x, y);
+			break;
+		case 1:
+			snprintf(wkt, sizeof(wkt), "LINESTRING(%.4f %.4f,%.4f %.4f,%.4f %.4f)", x, y, x + w, y, x + w, y + w);
+			break;
+		case 2:
+			snprintf(wkt, sizeof(wkt), "POLYGON((%.4f %.4f,%.4f %.4f,%.4f %.4f,%.4f %.4f))",
+				 x, y, x + w, y, x + w, y + w, x, y);
+			break;
+		case 3:
+			if (i % 4 == 3)
+			{
+				snprintf(wkt, sizeof(wkt), "POLYGON EMPTY");
+				break;
+			}
+			/* fall through */
+		default:
+			snprintf(wkt, sizeof(wkt), "MULTIPOINT(%.4f %.4f,%.4f %.4f)", x, y, x + w, y - w);
+		}
+		geoms[i] = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+	}
+	return geoms;
+}
+
+static void
+cu_join_free_geoms(LWGEOM **geoms, uint32_t n)
+{
+	uint32_t i;
+	for (i = 0; i < n; i++)
+		lwgeom_free(geoms[i]);
+	lwfree(geoms);
+}
+
+static void
+test_join_distance(void)
+{
+	uint32_t n = 300, m = 400, i, j;
+	double distances[] = {0.0, 0.5, 3.0};
+	LWGEOM **a, **b;
+	uint32_t d;
+
+	srand(12);
+	a = cu_join_geoms(n);
+	b = cu_join_geoms(m);
+
+	for (d = 0; d < sizeof(distances) / sizeof(distances[0]); d++)
+	{
+		CU_JOIN_RESULT r;
+		LW_JOIN_PREDICATE predicate = d ? LW_JOIN_DWITHIN : LW_JOIN_INTERSECTS;
+		uint32_t expected = 0;
+
+		cu_join_result_init(&r, n, m);
+		CU_ASSERT_EQUAL(lwgeom_spatial_join((const LWGEOM **)a, n, (const LWGEOM **)b, m,
+						    predicate, distances[d], cu_join_collect, &r),
+				LW_SUCCESS);
+
+		/* Every pair of a full scan, each once */
+		for (i = 0; i < n; i++)
+		{
+			for (j = 0; j < m; j++)
+			{
+				int match = !lwgeom_is_empty(a[i]) && !lwgeom_is_empty(b[j]) &&
+					    lwgeom_mindistance2d(a[i], b[j]) <= distances[d];
+				if (match)
+					expected++;
+				CU_ASSERT_EQUAL(r.pairs[(size_t)i * m + j], match ? 1 : 0);
+			}
+		}
+		CU_ASSERT_EQUAL(r.count, expected);
+		CU_ASSERT(expected > 0);
+		lwfree(r.pairs);
+	}
+
+	cu_join_free_geoms(a, n);
+	cu_join_free_geoms(b, m);
+}
+
+static void
+test_join_touching(void)
+{
+	const char *wkt_a[] = {"LINESTRING(0 0,1 1)", "POLYGON((0 0,2 0,2 2,0 2,0 0))", "POINT(5 5)"};
+	const char *wkt_b[] = {"LINESTRING(1 1,3 0)", "POINT(2 1)", "LINESTRING(-1 5,5 5)", "POINT(7 7)"};
+	LWGEOM *a[3], *b[4];
+	CU_JOIN_RESULT r;
+	uint32_t i;
+
+	for (i = 0; i < 3; i++)
+		a[i] = lwgeom_from_wkt(wkt_a[i], LW_PARSER_CHECK_NONE);
+	for (i = 0; i < 4; i++)
+		b[i] = lwgeom_from_wkt(wkt_b[i], LW_PARSER_CHECK_NONE);
+
+	/* Lines meeting at their last vertex, points on a boundary */
+	cu_join_result_init(&r, 3, 4);
+	lwgeom_spatial_join((const LWGEOM **)a, 3, (const LWGEOM **)b, 4, LW_JOIN_INTERSECTS, 0, cu_join_collect, &r);
+	CU_ASSERT_EQUAL(r.count, 4);
+	CU_ASSERT_EQUAL(r.pairs[0 * 4 + 0], 1);
+	CU_ASSERT_EQUAL(r.pairs[1 * 4 + 0], 1);
+	CU_ASSERT_EQUAL(r.pairs[1 * 4 + 1], 1);
+	CU_ASSERT_EQUAL(r.pairs[2 * 4 + 2], 1);
+	CU_ASSERT_EQUAL(r.pairs[0 * 4 + 1], 0);
+	lwfree(r.pairs);
+
+	for (i = 0; i < 3; i++)
+		lwgeom_free(a[i]);
+	for (i = 0; i < 4; i++)
+		lwgeom_free(b[i]);
+}
+
+static void
+test_join_contains(void)
+{
+	LWGEOM *a[2], *b[3];
+	CU_JOIN_RESULT r;
+	uint32_t i;
+
+	a[0] = lwgeom_from_wkt("POLYGON((0 0,10 0,10 10,0 10,0 0))", LW_PARSER_CHECK_NONE);
+	a[1] = lwgeom_from_wkt("POLYGON((20 0,30 0,30 10,20 10,20 0))", LW_PARSER_CHECK_NONE);
+	b[0] = lwgeom_from_wkt("POINT(5 5)", LW_PARSER_CHECK_NONE);
+	b[1] = lwgeom_from_wkt("POINT(10 5)", LW_PARSER_CHECK_NONE);
+	b[2] = lwgeom_from_wkt("LINESTRING(21 1,29 9)", LW_PARSER_CHECK_NONE);
+
+	/* A boundary point is covered, not contained */
+	cu_join_result_init(&r, 2, 3);
+	CU_ASSERT_EQUAL(lwgeom_spatial_join((const LWGEOM **)a, 2, (const LWGEOM **)b, 3, LW_JOIN_CONTAINS, 0, cu_join_collect, &r), LW_SUCCESS);
+	CU_ASSERT_EQUAL(r.count, 2);
+	CU_ASSERT_EQUAL(r.pairs[0 * 3 + 0], 1);
+	CU_ASSERT_EQUAL(r.pairs[1 * 3 + 2], 1);
+	lwfree(r.pairs);
+
+	cu_join_result_init(&r, 2, 3);
+	lwgeom_spatial_join((const LWGEOM **)a, 2, (const LWGEOM **)b, 3, LW_JOIN_COVERS, 0, cu_join_collect, &r);
+	CU_ASSERT_EQUAL(r.count, 3);
+	CU_ASSERT_EQUAL(r.pairs[0 * 3 + 1], 1);
+	lwfree(r.pairs);
+
+	/* Within is the other way round */
+	cu_join_result_init(&r, 3, 2);
+	lwgeom_spatial_join((const LWGEOM **)b, 3, (const LWGEOM **)a, 2, LW_JOIN_WITHIN, 0, cu_join_collect, &r);
+	CU_ASSERT_EQUAL(r.count, 2);
+	CU_ASSERT_EQUAL(r.pairs[0 * 2 + 0], 1);
+	CU_ASSERT_EQUAL(r.pairs[2 * 2 + 1], 1);
+	lwfree(r.pairs);
+
+	for (i = 0; i < 2; i++)
+		lwgeom_free(a[i]);
+	for (i = 0; i < 3; i++)
+		lwgeom_free(b[i]);
+}
+
+static void
+test_join_errors(void)
+{
+	LWGEOM *a[2], *b[1];
+	CU_JOIN_RESULT r;
+
+	a[0] = lwgeom_from_wkt("SRID=4326;POINT(0 0)", LW_PARSER_CHECK_NONE);
+	a[1] = lwgeom_from_wkt("SRID=4326;POINT(0 0)", LW_PARSER_CHECK_NONE);
+	b[0] = lwgeom_from_wkt("SRID=3857;POINT(0 0)", LW_PARSER_CHECK_NONE);
+	cu_join_result_init(&r, 2, 1);
+
+	/* Stopped by the callback after the first pair */
+	r.stop_after = 1;
+	CU_ASSERT_EQUAL(lwgeom_spatial_join((const LWGEOM **)a, 2, (const LWGEOM **)a, 2, LW_JOIN_INTERSECTS, 0, cu_join_collect, &r), LW_SUCCESS);
+	CU_ASSERT_EQUAL(r.count, 1);
+
+	/* Nothing to join */
+	r.count = 0;
+	CU_ASSERT_EQUAL(lwgeom_spatial_join(NULL, 0, (const LWGEOM **)a, 2, LW_JOIN_INTERSECTS, 0, cu_join_collect, &r), LW_SUCCESS);
+	CU_ASSERT_EQUAL(r.count, 0);
+
+	cu_error_msg_reset();
+	CU_ASSERT_EQUAL(lwgeom_spatial_join((const LWGEOM **)a, 2, (const LWGEOM **)b, 1, LW_JOIN_INTERSECTS, 0, cu_join_collect, &r), LW_FAILURE);
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+	CU_ASSERT_EQUAL(lwgeom_spatial_join((const LWGEOM **)a, 2, (const LWGEOM **)a, 2, LW_JOIN_DWITHIN, -1, cu_join_collect, &r), LW_FAILURE);
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+	CU_ASSERT_EQUAL(lwgeom_spatial_join((const LWGEOM **)a, 2, (const LWGEOM **)a, 2, LW_JOIN_INTERSECTS, 0, NULL, NULL), LW_FAILURE);
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+	lwgeom_set_geodetic(a[1], LW_TRUE);
+	CU_ASSERT_EQUAL(lwgeom_spatial_join((const LWGEOM **)a, 2, (const LWGEOM **)a, 1, LW_JOIN_INTERSECTS, 0, cu_join_collect, &r), LW_FAILURE);
+	CU_ASSERT(cu_error_msg[0] != '\0');
+	cu_error_msg_reset();
+
+	lwfree(r.pairs);
+	lwgeom_free(a[0]);
+	lwgeom_free(a[1]);
+	lwgeom_free(b[0]);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void spatial_join_suite_setup(void);
+void spatial_join_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("spatial_join", NULL, NULL);
+	PG_ADD_TEST(suite, test_join_distance);
+	PG_ADD_TEST(suite, test_join_touching);
+	PG_ADD_TEST(suite, test_join_contains);
+	PG_ADD_TEST(suite, test_join_errors);
+}
@@ -0,0 +1,191 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "CUnit/Basic.h"
+#include "liblwgeom_internal.h"
+#include "cu_tester.h"
+
+/* Internal funcs */
+static void
+cu_errorreporter(const char *fmt, va_list ap);
+
+static void
+cu_noticereporter(const char *fmt, va_list ap);
+
+/* ADD YOUR SUITE SETUP FUNCTION DEFS HERE (1 of 2) */
+extern void gserialized_view_suite_setup(void);
+extern void arena_suite_setup(void);
+extern void context_suite_setup(void);
+extern void proj_cache_suite_setup(void);
+extern void transform_parallel_suite_setup(void);
+extern void cache_suite_setup(void);
+extern void prepared_suite_setup(void);
+extern void rect_tree_cache_suite_setup(void);
+extern void circ_tree_cache_suite_setup(void);
+extern void hrtree_suite_setup(void);
+extern void knn_suite_setup(void);
+extern void spatial_join_suite_setup(void);
+extern void cluster_parallel_suite_setup(void);
+extern void kmeans_suite_setup(void);
+extern void cluster_grid_suite_setup(void);
+extern void gbox_simd_suite_setup(void);
+extern void cpu_suite_setup(void);
+extern void in_wkt_fast_suite_setup(void);
+extern void out_wkt_suite_setup(void);
+extern void in_geojson_stream_suite_setup(void);
+extern void out_geojson_suite_setup(void);
+extern void out_mvt_suite_setup(void);
+extern void geobuf_suite_setup(void);
+extern void flatgeobuf_suite_setup(void);
+extern void twkb_suite_setup(void);
+
+/* AND ADD YOUR SUITE SETUP FUNCTION HERE (2 of 2) */
+PG_SuiteSetup setupfuncs[] =
+{
+	gserialized_view_suite_setup,
+	arena_suite_setup,
+	context_suite_setup,
+	proj_cache_suite_setup,
+	transform_parallel_suite_setup,
+	cache_suite_setup,
+	prepared_suite_setup,
+	rect_tree_cache_suite_setup,
+	circ_tree_cache_suite_setup,
+	hrtree_suite_setup,
+	knn_suite_setup,
+	spatial_join_suite_setup,
+	cluster_parallel_suite_setup,
+	kmeans_suite_setup,
+	cluster_grid_suite_setup,
+	gbox_simd_suite_setup,
+	cpu_suite_setup,
+	in_wkt_fast_suite_setup,
+	out_wkt_suite_setup,
+	in_geojson_stream_suite_setup,
+	out_geojson_suite_setup,
+	out_mvt_suite_setup,
+	geobuf_suite_setup,
+	flatgeobuf_suite_setup,
+	twkb_suite_setup,
+	NULL
+};
+
+
+/*
+** The main() function for setting up and running the tests.
+** Returns 0 when every test passed, and otherwise the number of
+** failed tests, or a CUnit error code if the registry failed.
+** Suite names given as arguments run only those suites.
+*/
+int main(int argc, char *argv[])
+{
+	int index;
+	CU_pSuite suite_to_run;
+	CU_ErrorCode errCode = 0;
+	unsigned int num_failed;
+	PG_SuiteSetup *setupfunc = setupfuncs;
+
+	/* Install the custom error handler */
+	lwgeom_set_handlers(0, 0, 0, cu_errorreporter, cu_noticereporter, 0);
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+	{
+		errCode = CU_get_error();
+		printf("    Error attempting to initialize registry: %d.  See CUError.h for error code list.\n", errCode);
+		return errCode;
+	}
+
+	/* Register all the test suites. */
+	while ( *setupfunc )
+	{
+		(*setupfunc)();
+		setupfunc++;
+	}
+
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	if (argc <= 1)
+	{
+		errCode = CU_basic_run_tests();
+	}
+	else
+	{
+		for (index = 1; index < argc; index++)
+		{
+			suite_to_run = CU_get_suite(argv[index]);
+			if (NULL == suite_to_run)
+			{
+				printf("\n'%s' does not appear to be a suite name.\n", argv[index]);
+				errCode = 1;
+				break;
+			}
+			errCode = CU_basic_run_suite(suite_to_run);
+			if (errCode != CUE_SUCCESS)
+				break;
+		}
+	}
+
+	if (errCode != CUE_SUCCESS)
+	{
+		printf("    Error attempting to run tests: %d.  See CUError.h for error code list.\n", errCode);
+		printf("    Error message: %s\n", CU_get_error_msg());
+		CU_cleanup_registry();
+		return errCode;
+	}
+
+	num_failed = CU_get_number_of_tests_failed();
+	CU_cleanup_registry();
+	return num_failed ? (int)num_failed : 0;
+}
+
+/**
+ * CUnit error handler
+ * Log message in a global var instead of printing in stderr
+ *
+ * CAUTION: Not stop execution on lwerror case !!!
+ */
+static void
+cu_errorreporter(const char *fmt, va_list ap)
+{
+	vsnprintf(cu_error_msg, MAX_CUNIT_ERROR_LENGTH, fmt, ap);
+	cu_error_msg[MAX_CUNIT_ERROR_LENGTH] = '\0';
+}
+
+static void
+cu_noticereporter(const char *fmt, va_list ap)
+{
+	char buf[MAX_CUNIT_ERROR_LENGTH + 1];
+	vsnprintf(buf, MAX_CUNIT_ERROR_LENGTH, fmt, ap);
+	buf[MAX_CUNIT_ERROR_LENGTH] = '\0';
+}
+
+void
+cu_error_msg_reset(void)
+{
+	memset(cu_error_msg, '\0', MAX_CUNIT_ERROR_LENGTH);
+}
+
+/* Only used by cu_errorreporter, but long-lived so that tests can look at it. */
+char cu_error_msg[MAX_CUNIT_ERROR_LENGTH+1];
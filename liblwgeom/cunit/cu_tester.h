@@ -0,0 +1,58 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#ifndef _CU_TESTER_H
+#define _CU_TESTER_H 1
+
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_CUNIT_ERROR_LENGTH 512
+
+#define PG_ADD_TEST(suite, testfunc) CU_add_test(suite, #testfunc, testfunc)
+
+#define ASSERT_DOUBLE_EQUAL(o,e) do { \
+	if ( o != e ) \
+		fprintf(stderr, "[%s:%d]\n Expected: %g\n Obtained: %g\n", __FILE__, __LINE__, (double)(e), (double)(o)); \
+	CU_ASSERT_EQUAL(o,e); \
+} while (0)
+
+#define ASSERT_INT_EQUAL(o,e) do { \
+	if ( o != e ) \
+		fprintf(stderr, "[%s:%d]\n Expected: %d\n Obtained: %d\n", __FILE__, __LINE__, (int)(e), (int)(o)); \
+	CU_ASSERT_EQUAL(o,e); \
+} while (0)
+
+#define ASSERT_STRING_EQUAL(o,e) do { \
+	if ( strcmp(o,e) != 0 ) \
+		fprintf(stderr, "[%s:%d]\n Expected: %s\n Obtained: %s\n", __FILE__, __LINE__, (e), (o)); \
+	CU_ASSERT_STRING_EQUAL(o,e); \
+} while (0)
+
+/* Contains the most recent error message generated by lwerror. */
+extern char cu_error_msg[];
+
+/* Resets cu_error_msg back to blank. */
+void cu_error_msg_reset(void);
+
+/* Our internal callback to register Suites with the main tester */
+typedef void (*PG_SuiteSetup)(void);
+
+#endif /* _CU_TESTER_H */
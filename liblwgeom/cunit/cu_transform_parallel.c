@@ -0,0 +1,156 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "cu_tester.h"
+
+/* Enough points for four threads, with chunks cut inside arrays */
+#define BIG_NPOINTS (4 * LW_TRANSFORM_PARALLEL_MIN_POINTS + 1234)
+
+static POINTARRAY *
+cu_random_ptarray(int has_z, uint32_t npoints)
+{
+	POINTARRAY *pa = ptarray_construct(has_z, 0, npoints);
+	POINT4D pt = {0, 0, 0, 0};
+	uint32_t i;
+
+	for (i = 0; i < npoints; i++)
+	{
+		pt.x = -170.0 + 340.0 * rand() / RAND_MAX;
+		pt.y = -80.0 + 160.0 * rand() / RAND_MAX;
+		pt.z = 1000.0 * rand() / RAND_MAX;
+		ptarray_set_point4d(pa, i, &pt);
+	}
+	return pa;
+}
+
+/* Transform a copy both ways and check they agree */
+static void
+cu_transform_compare(const LWGEOM *geom, LWPROJ *lp, uint32_t nthreads)
+{
+	LWGEOM *seq = lwgeom_clone_deep(geom);
+	LWGEOM *par = lwgeom_clone_deep(geom);
+
+	CU_ASSERT_EQUAL(lwgeom_transform(seq, lp), LW_SUCCESS);
+	CU_ASSERT_EQUAL(lwgeom_transform_parallel(par, lp, nthreads), LW_SUCCESS);
+	CU_ASSERT(lwgeom_same(seq, par));
+	/* Something happened at all */
+	if (!lwgeom_is_empty(geom))
+		CU_ASSERT_FALSE(lwgeom_same(seq, geom));
+
+	lwgeom_free(seq);
+	lwgeom_free(par);
+}
+
+static void
+test_transform_parallel_line(void)
+{
+	LWPROJ *lp = lwproj_from_str("EPSG:4326", "EPSG:3857");
+	LWGEOM *geom;
+	POINTARRAY *pa, *copy;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(lp);
+	srand(6);
+
+	/* One huge array, split across the threads */
+	geom = lwline_as_lwgeom(lwline_construct(SRID_UNKNOWN, NULL, cu_random_ptarray(0, BIG_NPOINTS)));
+	cu_transform_compare(geom, lp, 4);
+	cu_transform_compare(geom, lp, 0);
+	cu_transform_compare(geom, lp, 1);
+	lwgeom_free(geom);
+
+	geom = lwline_as_lwgeom(lwline_construct(SRID_UNKNOWN, NULL, cu_random_ptarray(1, BIG_NPOINTS)));
+	cu_transform_compare(geom, lp, 3);
+	lwgeom_free(geom);
+
+	/* Too small to be split, still transformed */
+	geom = lwline_as_lwgeom(lwline_construct(SRID_UNKNOWN, NULL, cu_random_ptarray(1, 100)));
+	cu_transform_compare(geom, lp, 8);
+	lwgeom_free(geom);
+
+	/* Bare point arrays */
+	pa = cu_random_ptarray(1, BIG_NPOINTS);
+	copy = ptarray_clone_deep(pa);
+	CU_ASSERT_EQUAL(ptarray_transform(pa, lp), LW_SUCCESS);
+	CU_ASSERT_EQUAL(ptarray_transform_parallel(copy, lp, 4), LW_SUCCESS);
+	CU_ASSERT(ptarray_same(pa, copy));
+	ptarray_free(pa);
+	ptarray_free(copy);
+
+	proj_destroy(lp->pj);
+	lwfree(lp);
+}
+
+static void
+test_transform_parallel_collection(void)
+{
+	LWPROJ *lp = lwproj_from_str("EPSG:4326", "EPSG:3857");
+	LWCOLLECTION *mpoint, *coll;
+	LWPOLY *poly;
+	LWGEOM *geom;
+	uint32_t i;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(lp);
+	srand(7);
+
+	/* Many tiny arrays, slices cross array boundaries */
+	mpoint = lwcollection_construct_empty(MULTIPOINTTYPE, SRID_UNKNOWN, 1, 0);
+	for (i = 0; i < BIG_NPOINTS / 2; i++)
+		lwcollection_add_lwgeom(mpoint, lwpoint_as_lwgeom(lwpoint_construct(SRID_UNKNOWN, NULL, cu_random_ptarray(1, 1))));
+	cu_transform_compare(lwcollection_as_lwgeom(mpoint), lp, 4);
+
+	/* Mixed collection with empties and rings of every size */
+	coll = lwcollection_construct_empty(COLLECTIONTYPE, SRID_UNKNOWN, 1, 0);
+	lwcollection_add_lwgeom(coll, lwgeom_from_wkt("POINT Z EMPTY", LW_PARSER_CHECK_NONE));
+	poly = lwpoly_construct_empty(SRID_UNKNOWN, 1, 0);
+	lwpoly_add_ring(poly, cu_random_ptarray(1, BIG_NPOINTS / 3));
+	lwpoly_add_ring(poly, cu_random_ptarray(1, 5));
+	lwpoly_add_ring(poly, cu_random_ptarray(1, BIG_NPOINTS / 3));
+	lwcollection_add_lwgeom(coll, lwpoly_as_lwgeom(poly));
+	lwcollection_add_lwgeom(coll, lwcollection_as_lwgeom(mpoint));
+	lwcollection_add_lwgeom(coll, lwgeom_from_wkt("LINESTRING Z EMPTY", LW_PARSER_CHECK_NONE));
+	cu_transform_compare(lwcollection_as_lwgeom(coll), lp, 4);
+	cu_transform_compare(lwcollection_as_lwgeom(coll), lp, 2);
+	lwcollection_free(coll);
+
+	/* Empties do not go anywhere near PROJ */
+	geom = lwgeom_from_wkt("GEOMETRYCOLLECTION(POINT EMPTY,LINESTRING EMPTY)", LW_PARSER_CHECK_NONE);
+	cu_transform_compare(geom, lp, 4);
+	lwgeom_free(geom);
+
+	proj_destroy(lp->pj);
+	lwfree(lp);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void transform_parallel_suite_setup(void);
+void transform_parallel_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("transform_parallel", NULL, NULL);
+	PG_ADD_TEST(suite, test_transform_parallel_line);
+	PG_ADD_TEST(suite, test_transform_parallel_collection);
+}
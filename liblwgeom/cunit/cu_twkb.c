@@ -0,0 +1,284 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "cu_tester.h"
+
+static LWGEOM *
+cu_twkb_geom(const char *wkt)
+{
+	LWGEOM *geom = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(geom);
+	return geom;
+}
+
+static int
+cu_twkb_same(const lwvarlena_t *a, const lwvarlena_t *b)
+{
+	if (!a || !b)
+		return LW_FALSE;
+	return LWSIZE_GET(a->size) == LWSIZE_GET(b->size) &&
+	       memcmp(a->data, b->data, LWSIZE_GET(a->size) - LWVARHDRSZ) == 0;
+}
+
+/* A batch against lwgeom_to_twkb_with_idlist of the collection it stands for */
+static void
+cu_twkb_batch(const char **wkts, uint32_t n, uint8_t type, int64_t *ids, uint8_t variant)
+{
+	LWGEOM **geoms = lwalloc(sizeof(LWGEOM *) * (n ? n : 1));
+	LWCOLLECTION *col;
+	lwvarlena_t *batch, *ref;
+	LWGEOM *back;
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+		geoms[i] = cu_twkb_geom(wkts[i]);
+
+	batch = lwgeom_to_twkb_batch((const LWGEOM **)geoms, n, ids, variant, 2, 1, 1);
+	col = lwcollection_construct(type, SRID_UNKNOWN, NULL, n, geoms);
+	ref = lwgeom_to_twkb_with_idlist(lwcollection_as_lwgeom(col), ids, variant, 2, 1, 1);
+	CU_ASSERT(cu_twkb_same(batch, ref));
+
+	/* And it reads back as that type, with the parts it was given */
+	back = lwgeom_from_twkb((uint8_t *)batch->data, LWSIZE_GET(batch->size) - LWVARHDRSZ, LW_PARSER_CHECK_NONE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(back);
+	CU_ASSERT_EQUAL(back->type, type);
+	if (n)
+	{
+		LWCOLLECTION *c = lwgeom_as_lwcollection(back);
+		CU_ASSERT_EQUAL(c->ngeoms, n);
+		for (i = 0; i < n && i < c->ngeoms; i++)
+		{
+			CU_ASSERT_EQUAL(c->geoms[i]->type, geoms[i]->type);
+			/* Multi parts take the dimensions of the collection */
+			if (type == COLLECTIONTYPE)
+				CU_ASSERT_EQUAL(FLAGS_GET_ZM(c->geoms[i]->flags), FLAGS_GET_ZM(geoms[i]->flags));
+		}
+	}
+	else
+		CU_ASSERT(lwgeom_is_empty(back));
+
+	lwgeom_free(back);
+	lwfree(batch);
+	lwfree(ref);
+	lwfree(col);
+	for (i = 0; i < n; i++)
+		lwgeom_free(geoms[i]);
+	lwfree(geoms);
+}
+
+static void
+test_twkb_batch_types(void)
+{
+	const char *points[] = {"POINT(1 2)", "POINT(3.456 4)", "POINT(-1 -2)"};
+	const char *lines[] = {"LINESTRING Z(0 0 1,1 1 2,2 2 3)", "LINESTRING Z EMPTY", "LINESTRING Z(5 5 5,6 6 6)"};
+	const char *mixed[] = {"POINT(1 2)", "LINESTRING(0 0,1 1)", "POLYGON((0 0,1 0,1 1,0 0))"};
+	const char *nested[] = {"MULTIPOINT(1 2,3 4)", "MULTIPOINT(5 6)"};
+	const char *zm[] = {"POINT(1 2)", "POINT Z(3 4 5)"};
+	const char *mz[] = {"POINT Z(3 4 5)", "POINT M(1 2 3)", "POINT ZM(1 2 3 4)"};
+	const char *zmlines[] = {"LINESTRING ZM(0 0 0 0,1 1 1 1)", "LINESTRING(0 0,1 1)"};
+
+	cu_twkb_batch(points, 3, MULTIPOINTTYPE, NULL, 0);
+	cu_twkb_batch(lines, 3, MULTILINETYPE, NULL, 0);
+	cu_twkb_batch(lines, 3, MULTILINETYPE, NULL, TWKB_BBOX | TWKB_SIZE);
+	cu_twkb_batch(mixed, 3, COLLECTIONTYPE, NULL, 0);
+	cu_twkb_batch(nested, 2, COLLECTIONTYPE, NULL, 0);
+
+	/* Mixed dimensions cannot share the header of a multi */
+	cu_twkb_batch(zm, 2, COLLECTIONTYPE, NULL, 0);
+	cu_twkb_batch(mz, 3, COLLECTIONTYPE, NULL, TWKB_BBOX);
+	cu_twkb_batch(zmlines, 2, COLLECTIONTYPE, NULL, TWKB_SIZE);
+
+	/* No geometries at all is an empty collection */
+	cu_twkb_batch(NULL, 0, COLLECTIONTYPE, NULL, 0);
+}
+
+static void
+test_twkb_batch_ids(void)
+{
+	const char *points[] = {"POINT(1 2)", "POINT(3 4)", "POINT(5 6)"};
+	const char *mixed[] = {"POINT(1 2)", "LINESTRING(0 0,1 1)"};
+	int64_t ids[] = {7, -3, INT64_C(1) << 40};
+	LWGEOM *back;
+	lwvarlena_t *v;
+	LWGEOM *geoms[3];
+	char *wkt;
+	uint32_t i;
+
+	cu_twkb_batch(points, 3, MULTIPOINTTYPE, ids, TWKB_ID);
+	cu_twkb_batch(mixed, 2, COLLECTIONTYPE, ids, TWKB_ID | TWKB_BBOX);
+
+	/* The ids are written, in order */
+	for (i = 0; i < 3; i++)
+		geoms[i] = cu_twkb_geom(points[i]);
+	v = lwgeom_to_twkb_batch((const LWGEOM **)geoms, 3, ids, TWKB_ID, 0, 0, 0);
+	back = lwgeom_from_twkb((uint8_t *)v->data, LWSIZE_GET(v->size) - LWVARHDRSZ, LW_PARSER_CHECK_NONE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(back);
+	wkt = lwgeom_to_ewkt(back);
+	ASSERT_STRING_EQUAL(wkt, "MULTIPOINT(1 2,3 4,5 6)");
+	lwfree(wkt);
+	/* After the type, the metadata and the count */
+	CU_ASSERT_EQUAL(v->data[3], 0x0E); /* zigzag of 7 */
+	CU_ASSERT_EQUAL(v->data[4], 0x05); /* zigzag of -3 */
+	lwgeom_free(back);
+	lwfree(v);
+	for (i = 0; i < 3; i++)
+		lwgeom_free(geoms[i]);
+}
+
+static void
+test_twkb_batch_errors(void)
+{
+	LWGEOM *geoms[2];
+
+	geoms[0] = cu_twkb_geom("POINT(1 2)");
+	geoms[1] = NULL;
+	cu_error_msg_reset();
+	CU_ASSERT_PTR_NULL(lwgeom_to_twkb_batch((const LWGEOM **)geoms, 2, NULL, 0, 0, 0, 0));
+	ASSERT_STRING_EQUAL(cu_error_msg, "Cannot convert NULL into TWKB");
+	cu_error_msg_reset();
+	lwgeom_free(geoms[0]);
+}
+
+/* Round trips, with the precision kept by the encoding */
+static void
+test_twkb_round_trip(void)
+{
+	const char *wkts[] = {
+	    "POINT(1.25 -2.5)",
+	    "LINESTRING(0 0,1.5 1.25,2 -3,2 -3,10 10)",
+	    "POLYGON Z((0 0 1,10 0 2,10 10 3,0 10 4,0 0 1),(2 2 0,3 2 0,3 3 0,2 2 0))",
+	    "LINESTRING M(0 0 0.5,1 1 1.5,2 2 2.5)",
+	    "MULTIPOINT ZM(1 2 3 4,5 6 7 8)",
+	    "GEOMETRYCOLLECTION(POINT(1 2),LINESTRING(0 0,1 1))",
+	    "MULTIPOLYGON EMPTY",
+	    "POINT EMPTY",
+	    "GEOMETRYCOLLECTION EMPTY"};
+	uint32_t i;
+
+	for (i = 0; i < sizeof(wkts) / sizeof(wkts[0]); i++)
+	{
+		LWGEOM *geom = cu_twkb_geom(wkts[i]);
+		lwvarlena_t *v = lwgeom_to_twkb(geom, TWKB_BBOX | TWKB_SIZE, 2, 1, 1);
+		LWGEOM *back = lwgeom_from_twkb((uint8_t *)v->data, LWSIZE_GET(v->size) - LWVARHDRSZ, LW_PARSER_CHECK_ALL);
+		char *in = lwgeom_to_wkt(geom, WKT_ISO, 8, NULL);
+		char *out;
+
+		CU_ASSERT_PTR_NOT_NULL_FATAL(back);
+		out = lwgeom_to_wkt(back, WKT_ISO, 8, NULL);
+		/* The repeated point goes away */
+		if (i == 1)
+			ASSERT_STRING_EQUAL(out, "LINESTRING(0 0,1.5 1.25,2 -3,10 10)");
+		else
+			ASSERT_STRING_EQUAL(out, in);
+		lwfree(in);
+		lwfree(out);
+		lwgeom_free(back);
+		lwgeom_free(geom);
+		lwfree(v);
+	}
+}
+
+/* Long enough for the vector kernels, with values they hand back to llround */
+static LWGEOM *
+cu_twkb_line(uint32_t npoints, int hasz, int hasm, int pattern)
+{
+	POINTARRAY *pa = ptarray_construct(hasz, hasm, npoints);
+	uint32_t ndims = 2 + hasz + hasm, i, j;
+	double *c = (double *)getPoint_internal(pa, 0);
+
+	for (i = 0; i < npoints; i++)
+	{
+		for (j = 0; j < ndims; j++)
+		{
+			double v = (rand() - RAND_MAX / 2) / 1024.0;
+			/* Halves check the rounding away from zero */
+			if (pattern == 1)
+				v = floor(v) + 0.5;
+			else if (pattern == 2 && i % 7 == 3)
+				v = (i % 2 ? -3e15 : 3e15) + v;
+			else if (pattern == 3 && i % 11 == 5)
+				v = NAN;
+			c[i * ndims + j] = v;
+		}
+	}
+	return lwline_as_lwgeom(lwline_construct(SRID_UNKNOWN, NULL, pa));
+}
+
+/* Every CPU level writes the bytes of the scalar code */
+static void
+test_twkb_cpu_levels(void)
+{
+	LW_CPU_LEVEL initial = lwcpu_level();
+	const uint32_t sizes[] = {3, 4, 5, 17, 1000};
+	const int8_t precisions[][3] = {{0, 0, 0}, {3, 2, 1}, {-2, 0, 5}, {7, 7, 7}};
+	uint32_t s, dims, pattern, p, level;
+
+	srand(23);
+	for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+	{
+		for (dims = 0; dims < 4; dims++)
+		{
+			for (pattern = 0; pattern < 4; pattern++)
+			{
+				LWGEOM *geom = cu_twkb_line(sizes[s], dims & 1, (dims & 2) >> 1, pattern);
+				for (p = 0; p < sizeof(precisions) / sizeof(precisions[0]); p++)
+				{
+					const int8_t *pr = precisions[p];
+					lwvarlena_t *ref, *v;
+
+					lwcpu_set_level(LW_CPU_SCALAR);
+					ref = lwgeom_to_twkb(geom, TWKB_BBOX | TWKB_SIZE, pr[0], pr[1], pr[2]);
+					for (level = LW_CPU_SCALAR + 1; level < LW_CPU_NUM_LEVELS; level++)
+					{
+						if (lwcpu_set_level((LW_CPU_LEVEL)level) == LW_FAILURE)
+							continue;
+						v = lwgeom_to_twkb(geom, TWKB_BBOX | TWKB_SIZE, pr[0], pr[1], pr[2]);
+						CU_ASSERT(cu_twkb_same(v, ref));
+						lwfree(v);
+					}
+					lwfree(ref);
+				}
+				lwgeom_free(geom);
+			}
+		}
+	}
+	lwcpu_set_level(initial);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void twkb_suite_setup(void);
+void twkb_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("twkb", NULL, NULL);
+	PG_ADD_TEST(suite, test_twkb_batch_types);
+	PG_ADD_TEST(suite, test_twkb_batch_ids);
+	PG_ADD_TEST(suite, test_twkb_batch_errors);
+	PG_ADD_TEST(suite, test_twkb_round_trip);
+	PG_ADD_TEST(suite, test_twkb_cpu_levels);
+}
@@ -536,65 +536,44 @@ static int lw_arc_calculate_gbox_cartesian(const POINT4D *p1, const POINT4D *p2,
 static void
 ptarray_calculate_gbox_cartesian_2d(const POINTARRAY *pa, GBOX *gbox)
 {
-	const POINT2D *p = getPoint2d_cp(pa, 0);
+	double mins[2], maxs[2];
 
-	gbox->xmax = gbox->xmin = p->x;
-	gbox->ymax = gbox->ymin = p->y;
-
-	for (uint32_t i = 1; i < pa->npoints; i++)
-	{
-		p = getPoint2d_cp(pa, i);
-		gbox->xmin = FP_MIN(gbox->xmin, p->x);
-		gbox->xmax = FP_MAX(gbox->xmax, p->x);
-		gbox->ymin = FP_MIN(gbox->ymin, p->y);
-		gbox->ymax = FP_MAX(gbox->ymax, p->y);
-	}
+	ptarray_calculate_minmax(pa, mins, maxs);
+	gbox->xmin = mins[0];
+	gbox->xmax = maxs[0];
+	gbox->ymin = mins[1];
+	gbox->ymax = maxs[1];
 }
 
 /* Works with X/Y/Z. Needs to be adjusted after if X/Y/M was required */
 static void
 ptarray_calculate_gbox_cartesian_3d(const POINTARRAY *pa, GBOX *gbox)
 {
-	const POINT3D *p = getPoint3d_cp(pa, 0);
+	double mins[3], maxs[3];
 
-	gbox->xmax = gbox->xmin = p->x;
-	gbox->ymax = gbox->ymin = p->y;
-	gbox->zmax = gbox->zmin = p->z;
-
-	for (uint32_t i = 1; i < pa->npoints; i++)
-	{
-		p = getPoint3d_cp(pa, i);
-		gbox->xmin = FP_MIN(gbox->xmin, p->x);
-		gbox->xmax = FP_MAX(gbox->xmax, p->x);
-		gbox->ymin = FP_MIN(gbox->ymin, p->y);
-		gbox->ymax = FP_MAX(gbox->ymax, p->y);
-		gbox->zmin = FP_MIN(gbox->zmin, p->z);
-		gbox->zmax = FP_MAX(gbox->zmax, p->z);
-	}
+	ptarray_calculate_minmax(pa, mins, maxs);
+	gbox->xmin = mins[0];
+	gbox->xmax = maxs[0];
+	gbox->ymin = mins[1];
+	gbox->ymax = maxs[1];
+	gbox->zmin = mins[2];
+	gbox->zmax = maxs[2];
 }
 
 static void
 ptarray_calculate_gbox_cartesian_4d(const POINTARRAY *pa, GBOX *gbox)
 {
-	const POINT4D *p = getPoint4d_cp(pa, 0);
-
-	gbox->xmax = gbox->xmin = p->x;
-	gbox->ymax = gbox->ymin = p->y;
-	gbox->zmax = gbox->zmin = p->z;
-	gbox->mmax = gbox->mmin = p->m;
-
-	for (uint32_t i = 1; i < pa->npoints; i++)
-	{
-		p = getPoint4d_cp(pa, i);
-		gbox->xmin = FP_MIN(gbox->xmin, p->x);
-		gbox->xmax = FP_MAX(gbox->xmax, p->x);
-		gbox->ymin = FP_MIN(gbox->ymin, p->y);
-		gbox->ymax = FP_MAX(gbox->ymax, p->y);
-		gbox->zmin = FP_MIN(gbox->zmin, p->z);
-		gbox->zmax = FP_MAX(gbox->zmax, p->z);
-		gbox->mmin = FP_MIN(gbox->mmin, p->m);
-		gbox->mmax = FP_MAX(gbox->mmax, p->m);
-	}
+	double mins[4], maxs[4];
+
+	ptarray_calculate_minmax(pa, mins, maxs);
+	gbox->xmin = mins[0];
+	gbox->xmax = maxs[0];
+	gbox->ymin = mins[1];
+	gbox->ymax = maxs[1];
+	gbox->zmin = mins[2];
+	gbox->zmax = maxs[2];
+	gbox->mmin = mins[3];
+	gbox->mmax = maxs[3];
 }
 
 int
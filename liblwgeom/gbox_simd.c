@@ -0,0 +1,339 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include "liblwgeom_internal.h"
+#include "lwcpu.h"
+
+/*
+ * Per ordinate extent of a point array, for the cartesian boxes.
+ *
+ * The coordinates are reduced as one flat stream of doubles: a run of
+ * lcm(ndims, vector width) of them fills whole vectors and starts on a
+ * point, so every lane always sees the same ordinate. The lanes are folded
+ * per ordinate at the end.
+ *
+ * The result has to be the one of the FP_MIN/FP_MAX loop, which keeps the
+ * last of the values comparing equal to the extreme. That only shows for
+ * zeros, whose sign is taken from the last zero of the ordinate, and for
+ * NaN, whose result depends on its position: arrays with a NaN go through
+ * the scalar loop.
+ */
+
+#ifdef LWCPU_X86
+#define LW_GBOX_SIMD 1
+#include <immintrin.h>
+#endif
+
+/* Below this, the vector set up costs more than it saves */
+#define LW_GBOX_SIMD_MIN_POINTS 16
+
+typedef int (*gbox_minmax_kernel)(const double *c, uint64_t nvals, uint32_t ndims, double *mins, double *maxs);
+
+static void
+gbox_minmax_scalar(const double *c, uint32_t npoints, uint32_t ndims, double *mins, double *maxs)
+{
+	uint32_t i, d;
+
+	for (d = 0; d < ndims; d++)
+		mins[d] = maxs[d] = c[d];
+
+	for (i = 1; i < npoints; i++)
+	{
+		const double *p = c + (uint64_t)i * ndims;
+		for (d = 0; d < ndims; d++)
+		{
+			mins[d] = FP_MIN(mins[d], p[d]);
+			maxs[d] = FP_MAX(maxs[d], p[d]);
+		}
+	}
+}
+
+#ifdef LW_GBOX_SIMD
+
+/* Fold the stored lanes of a period and the remaining values, returns LW_TRUE on NaN */
+static int
+gbox_minmax_fold(const double *c,
+		 uint64_t from,
+		 uint64_t nvals,
+		 uint32_t ndims,
+		 const double *lane_min,
+		 const double *lane_max,
+		 uint32_t period,
+		 double *mins,
+		 double *maxs)
+{
+	uint64_t i;
+	uint32_t k, d;
+	int nan = LW_FALSE;
+
+	for (d = 0; d < ndims; d++)
+	{
+		mins[d] = lane_min[d];
+		maxs[d] = lane_max[d];
+	}
+	for (k = ndims; k < period; k++)
+	{
+		d = k % ndims;
+		mins[d] = FP_MIN(mins[d], lane_min[k]);
+		maxs[d] = FP_MAX(maxs[d], lane_max[k]);
+	}
+	for (i = from, d = 0; i < nvals; i++)
+	{
+		if (c[i] != c[i])
+			nan = LW_TRUE;
+		mins[d] = FP_MIN(mins[d], c[i]);
+		maxs[d] = FP_MAX(maxs[d], c[i]);
+		if (++d == ndims)
+			d = 0;
+	}
+	return nan;
+}
+
+/*
+ * Every kernel works on a period of vectors, unrolled so that at least
+ * four of them are in flight, and needs nvals to hold one unrolled step.
+ */
+#define LW_GBOX_MAX_ACC 6
+
+LWCPU_TARGET("sse2") static inline int
+gbox_minmax_sse2_body(const double *c, uint64_t nvals, uint32_t ndims, double *mins, double *maxs)
+{
+	const uint32_t period = ndims == 3 ? 6 : ndims;
+	const uint32_t nvec = period / 2;
+	const uint32_t nacc = nvec == 1 ? 4 : 2 * nvec;
+	const uint64_t step = 2 * nacc;
+	double lane_min[LW_GBOX_MAX_ACC * 2], lane_max[LW_GBOX_MAX_ACC * 2];
+	__m128d mn[LW_GBOX_MAX_ACC], mx[LW_GBOX_MAX_ACC], bad = _mm_setzero_pd();
+	uint64_t i;
+	uint32_t j;
+
+	for (j = 0; j < nacc; j++)
+	{
+		mn[j] = mx[j] = _mm_loadu_pd(c + 2 * j);
+		bad = _mm_or_pd(bad, _mm_cmpunord_pd(mn[j], mn[j]));
+	}
+	for (i = step; i + step <= nvals; i += step)
+	{
+		for (j = 0; j < nacc; j++)
+		{
+			__m128d v = _mm_loadu_pd(c + i + 2 * j);
+			mn[j] = _mm_min_pd(mn[j], v);
+			mx[j] = _mm_max_pd(mx[j], v);
+			bad = _mm_or_pd(bad, _mm_cmpunord_pd(v, v));
+		}
+	}
+	for (j = nvec; j < nacc; j++)
+	{
+		mn[j % nvec] = _mm_min_pd(mn[j % nvec], mn[j]);
+		mx[j % nvec] = _mm_max_pd(mx[j % nvec], mx[j]);
+	}
+	for (j = 0; j < nvec; j++)
+	{
+		_mm_storeu_pd(lane_min + 2 * j, mn[j]);
+		_mm_storeu_pd(lane_max + 2 * j, mx[j]);
+	}
+	if (_mm_movemask_pd(bad))
+		return LW_TRUE;
+	return gbox_minmax_fold(c, i, nvals, ndims, lane_min, lane_max, period, mins, maxs);
+}
+
+LWCPU_TARGET("sse2") static int
+gbox_minmax_sse2(const double *c, uint64_t nvals, uint32_t ndims, double *mins, double *maxs)
+{
+	switch (ndims)
+	{
+	case 2:
+		return gbox_minmax_sse2_body(c, nvals, 2, mins, maxs);
+	case 3:
+		return gbox_minmax_sse2_body(c, nvals, 3, mins, maxs);
+	default:
+		return gbox_minmax_sse2_body(c, nvals, 4, mins, maxs);
+	}
+}
+
+LWCPU_TARGET("avx2") static inline int
+gbox_minmax_avx2_body(const double *c, uint64_t nvals, uint32_t ndims, double *mins, double *maxs)
+{
+	const uint32_t period = ndims == 3 ? 12 : 4;
+	const uint32_t nvec = period / 4;
+	const uint32_t nacc = nvec == 1 ? 4 : 2 * nvec;
+	const uint64_t step = 4 * nacc;
+	double lane_min[LW_GBOX_MAX_ACC * 4], lane_max[LW_GBOX_MAX_ACC * 4];
+	__m256d mn[LW_GBOX_MAX_ACC], mx[LW_GBOX_MAX_ACC], bad = _mm256_setzero_pd();
+	uint64_t i;
+	uint32_t j;
+
+	for (j = 0; j < nacc; j++)
+	{
+		mn[j] = mx[j] = _mm256_loadu_pd(c + 4 * j);
+		bad = _mm256_or_pd(bad, _mm256_cmp_pd(mn[j], mn[j], _CMP_UNORD_Q));
+	}
+	for (i = step; i + step <= nvals; i += step)
+	{
+		for (j = 0; j < nacc; j++)
+		{
+			__m256d v = _mm256_loadu_pd(c + i + 4 * j);
+			mn[j] = _mm256_min_pd(mn[j], v);
+			mx[j] = _mm256_max_pd(mx[j], v);
+			bad = _mm256_or_pd(bad, _mm256_cmp_pd(v, v, _CMP_UNORD_Q));
+		}
+	}
+	for (j = nvec; j < nacc; j++)
+	{
+		mn[j % nvec] = _mm256_min_pd(mn[j % nvec], mn[j]);
+		mx[j % nvec] = _mm256_max_pd(mx[j % nvec], mx[j]);
+	}
+	for (j = 0; j < nvec; j++)
+	{
+		_mm256_storeu_pd(lane_min + 4 * j, mn[j]);
+		_mm256_storeu_pd(lane_max + 4 * j, mx[j]);
+	}
+	if (_mm256_movemask_pd(bad))
+		return LW_TRUE;
+	return gbox_minmax_fold(c, i, nvals, ndims, lane_min, lane_max, period, mins, maxs);
+}
+
+LWCPU_TARGET("avx2") static int
+gbox_minmax_avx2(const double *c, uint64_t nvals, uint32_t ndims, double *mins, double *maxs)
+{
+	switch (ndims)
+	{
+	case 2:
+		return gbox_minmax_avx2_body(c, nvals, 2, mins, maxs);
+	case 3:
+		return gbox_minmax_avx2_body(c, nvals, 3, mins, maxs);
+	default:
+		return gbox_minmax_avx2_body(c, nvals, 4, mins, maxs);
+	}
+}
+
+LWCPU_TARGET("avx512f") static inline int
+gbox_minmax_avx512_body(const double *c, uint64_t nvals, uint32_t ndims, double *mins, double *maxs)
+{
+	const uint32_t period = ndims == 3 ? 24 : 8;
+	const uint32_t nvec = period / 8;
+	const uint32_t nacc = nvec == 1 ? 4 : 2 * nvec;
+	const uint64_t step = 8 * nacc;
+	double lane_min[LW_GBOX_MAX_ACC * 8], lane_max[LW_GBOX_MAX_ACC * 8];
+	__m512d mn[LW_GBOX_MAX_ACC], mx[LW_GBOX_MAX_ACC];
+	__mmask8 bad = 0;
+	uint64_t i;
+	uint32_t j;
+
+	for (j = 0; j < nacc; j++)
+	{
+		mn[j] = mx[j] = _mm512_loadu_pd(c + 8 * j);
+		bad |= _mm512_cmp_pd_mask(mn[j], mn[j], _CMP_UNORD_Q);
+	}
+	for (i = step; i + step <= nvals; i += step)
+	{
+		for (j = 0; j < nacc; j++)
+		{
+			__m512d v = _mm512_loadu_pd(c + i + 8 * j);
+			mn[j] = _mm512_min_pd(mn[j], v);
+			mx[j] = _mm512_max_pd(mx[j], v);
+			bad |= _mm512_cmp_pd_mask(v, v, _CMP_UNORD_Q);
+		}
+	}
+	for (j = nvec; j < nacc; j++)
+	{
+		mn[j % nvec] = _mm512_min_pd(mn[j % nvec], mn[j]);
+		mx[j % nvec] = _mm512_max_pd(mx[j % nvec], mx[j]);
+	}
+	for (j = 0; j < nvec; j++)
+	{
+		_mm512_storeu_pd(lane_min + 8 * j, mn[j]);
+		_mm512_storeu_pd(lane_max + 8 * j, mx[j]);
+	}
+	if (bad)
+		return LW_TRUE;
+	return gbox_minmax_fold(c, i, nvals, ndims, lane_min, lane_max, period, mins, maxs);
+}
+
+LWCPU_TARGET("avx512f") static int
+gbox_minmax_avx512(const double *c, uint64_t nvals, uint32_t ndims, double *mins, double *maxs)
+{
+	switch (ndims)
+	{
+	case 2:
+		return gbox_minmax_avx512_body(c, nvals, 2, mins, maxs);
+	case 3:
+		return gbox_minmax_avx512_body(c, nvals, 3, mins, maxs);
+	default:
+		return gbox_minmax_avx512_body(c, nvals, 4, mins, maxs);
+	}
+}
+
+#endif /* LW_GBOX_SIMD */
+
+/* NULL at the scalar level */
+static lwcpu_function gbox_minmax_dispatch = NULL;
+
+const LWCPU_KERNEL gbox_minmax_kernels = {
+	"gbox_minmax",
+	&gbox_minmax_dispatch,
+#ifdef LW_GBOX_SIMD
+	{[LW_CPU_SSE2] = (lwcpu_function)gbox_minmax_sse2,
+	 [LW_CPU_AVX2] = (lwcpu_function)gbox_minmax_avx2,
+	 [LW_CPU_AVX512] = (lwcpu_function)gbox_minmax_avx512}
+#else
+	{NULL}
+#endif
+};
+
+/* The vector lanes lose track of the sign of zeros: take it from the last one */
+static double
+gbox_last_zero(const double *c, uint32_t npoints, uint32_t ndims, uint32_t d)
+{
+	uint32_t i = npoints;
+
+	while (i-- > 0)
+		if (c[(uint64_t)i * ndims + d] == 0)
+			return c[(uint64_t)i * ndims + d];
+	return 0;
+}
+
+void
+ptarray_calculate_minmax(const POINTARRAY *pa, double *mins, double *maxs)
+{
+	const double *c = (const double *)pa->serialized_pointlist;
+	uint32_t ndims = FLAGS_NDIMS(pa->flags);
+
+	if (pa->npoints >= LW_GBOX_SIMD_MIN_POINTS)
+	{
+		gbox_minmax_kernel kernel;
+		lwcpu_ensure();
+		kernel = (gbox_minmax_kernel)gbox_minmax_dispatch;
+		if (kernel && !kernel(c, (uint64_t)pa->npoints * ndims, ndims, mins, maxs))
+		{
+			uint32_t d;
+			for (d = 0; d < ndims; d++)
+			{
+				if (mins[d] == 0)
+					mins[d] = gbox_last_zero(c, pa->npoints, ndims, d);
+				if (maxs[d] == 0)
+					maxs[d] = gbox_last_zero(c, pa->npoints, ndims, d);
+			}
+			return;
+		}
+	}
+
+	gbox_minmax_scalar(c, pa->npoints, ndims, mins, maxs);
+}
@@ -244,6 +244,18 @@ LWGEOM* lwgeom_from_gserialized(const GSERIALIZED *g)
 		return lwgeom_from_gserialized1(g);
 }
 
+/**
+* Allocate a new #LWGEOM whose point arrays reference the ordinates of the
+* #GSERIALIZED. Version 1 serializations are always read that way.
+*/
+LWGEOM* lwgeom_from_gserialized_view(const GSERIALIZED *g)
+{
+	if (GFLAGS_GET_VERSION(g->gflags))
+		return lwgeom_from_gserialized2_view(g);
+	else
+		return lwgeom_from_gserialized1(g);
+}
+
 
 const float * gserialized_get_float_box_p(const GSERIALIZED *g, size_t *ndims)
 {
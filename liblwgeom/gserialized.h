@@ -153,6 +153,12 @@ size_t gserialized_from_lwgeom_size(const LWGEOM *geom);
 */
 LWGEOM *lwgeom_from_gserialized(const GSERIALIZED *g);
 
+/**
+* Allocate a new #LWGEOM from a #GSERIALIZED whose point arrays reference
+* the serialized ordinates instead of copying them. See liblwgeom.h.
+*/
+LWGEOM *lwgeom_from_gserialized_view(const GSERIALIZED *g);
+
 /**
 * Pull a #GBOX from the header of a #GSERIALIZED, if one is available. If
 * it is not, calculate it from the geometry. If that doesn't work (null
@@ -165,6 +165,12 @@ size_t gserialized2_from_lwgeom_size(const LWGEOM *geom);
 */
 LWGEOM* lwgeom_from_gserialized2(const GSERIALIZED *g);
 
+/**
+* As lwgeom_from_gserialized2, but the point arrays are read-only references
+* into the serialization. The #GSERIALIZED has to outlive the result.
+*/
+LWGEOM* lwgeom_from_gserialized2_view(const GSERIALIZED *g);
+
 /**
 * Point into the float box area of the serialization
 */
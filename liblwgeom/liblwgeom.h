@@ -38,6 +38,27 @@
 
 #include "proj.h"
 
+/* Default and maximum size of the per context LWPROJ cache */
+#define LWPROJ_CACHE_ITEMS 16
+#define LWPROJ_CACHE_MAX_ITEMS 128
+
+typedef struct LWPROJ_CACHE LWPROJ_CACHE;
+
+/* Number of prepared geometries cached per context */
+#define LWPREPARED_CACHE_ITEMS 8
+
+typedef struct LWPREPARED_CACHE LWPREPARED_CACHE;
+
+/* Number of rect trees (see lwtree.h) cached per context */
+#define RECT_TREE_CACHE_ITEMS 8
+
+typedef struct RECT_TREE_CACHE RECT_TREE_CACHE;
+
+/* Number of circ trees (see lwgeodetic_tree.h) cached per context */
+#define CIRC_TREE_CACHE_ITEMS 8
+
+typedef struct CIRC_TREE_CACHE CIRC_TREE_CACHE;
+
 /* For PROJ6 we cache several extra values to avoid calls to proj_get_source_crs
  * or proj_get_target_crs since those are very costly
  */
@@ -296,6 +317,44 @@ extern int lwgeom_interrupt_state(void);
 typedef void (lwinterrupt_callback)();
 extern lwinterrupt_callback *lwgeom_register_interrupt_callback(lwinterrupt_callback *);
 
+/**
+ * Instruction set levels of the vectorized kernels. The processor is
+ * probed on first use, and every kernel then runs its widest variant
+ * allowed by the active level, which defaults to the detected one.
+ * The x86 levels include the lower ones.
+ * @ingroup system
+ */
+typedef enum
+{
+	LW_CPU_SCALAR = 0, /* Plain C only */
+	LW_CPU_SSE2,
+	LW_CPU_SSE42,  /* x86-64-v2 */
+	LW_CPU_AVX2,   /* x86-64-v3: AVX, AVX2, FMA, BMI */
+	LW_CPU_AVX512, /* x86-64-v4: AVX-512 F, CD, BW, DQ, VL */
+	LW_CPU_NEON,
+	LW_CPU_NUM_LEVELS
+} LW_CPU_LEVEL;
+
+/** Highest level the processor and the operating system support */
+extern LW_CPU_LEVEL lwcpu_detected_level(void);
+
+/** Level the kernels currently run at */
+extern LW_CPU_LEVEL lwcpu_level(void);
+
+/**
+ * Force the level the kernels run at, for comparisons or to pin the
+ * behaviour of a deployment. Returns LW_FAILURE, leaving the level as it
+ * is, if the processor does not support it. Not to be called while other
+ * threads run liblwgeom code.
+ */
+extern int lwcpu_set_level(LW_CPU_LEVEL level);
+
+/** Name of a level ("scalar", "sse2", "sse4.2", "avx2", "avx512", "neon"), NULL if unknown */
+extern const char *lwcpu_level_name(LW_CPU_LEVEL level);
+
+/** Level of a case insensitive name, LW_FAILURE if unknown */
+extern int lwcpu_level_from_name(const char *name, LW_CPU_LEVEL *level);
+
 
 /******************************************************************
 * LWGEOM and GBOX both use LWFLAGS bit mask.
@@ -825,6 +884,17 @@ extern GSERIALIZED* gserialized_from_lwgeom(LWGEOM *geom, size_t *size);
 */
 extern LWGEOM* lwgeom_from_gserialized(const GSERIALIZED *g);
 
+/**
+* Read-only view of a #GSERIALIZED. Point arrays reference the ordinates
+* inside the serialization instead of copying them, so the buffer must stay
+* alive (and unchanged) for as long as the returned #LWGEOM is used, and it
+* must be double aligned. The arrays are flagged read-only: lwgeom_free()
+* does not touch the buffer, and in-place editing functions copy the
+* ordinates first (see ptarray_make_writable). Several threads may build
+* and read views over the same buffer at the same time.
+*/
+extern LWGEOM* lwgeom_from_gserialized_view(const GSERIALIZED *g);
+
 /**
 * Pull a #GBOX from the header of a #GSERIALIZED, if one is available. If
 * it is not, calculate it from the geometry. If that doesn't work (null
@@ -1005,6 +1075,12 @@ extern POINTARRAY* ptarray_construct_copy_data(char hasz, char hasm, uint32_t np
 */
 extern POINTARRAY* ptarray_construct_reference_data(char hasz, char hasm, uint32_t npoints, uint8_t *ptlist);
 
+/**
+* Give a read-only #POINTARRAY its own copy of the ordinates so that it can
+* be modified. No-op on arrays that already own their storage.
+*/
+extern void ptarray_make_writable(POINTARRAY *pa);
+
 /**
 * Create a new #POINTARRAY with no points. Allocate enough storage
 * to hold maxpoints vertices before having to reallocate the storage
@@ -1717,10 +1793,175 @@ extern lwvarlena_t* lwgeom_extent_to_gml3(const LWGEOM *geom, const char *srs, i
 extern lwvarlena_t* lwgeom_to_gml3(const LWGEOM *geom, const char *srs, int precision, int opts, const char *prefix, const char *id);
 extern lwvarlena_t* lwgeom_to_kml2(const LWGEOM *geom, int precision, const char *prefix);
 extern lwvarlena_t* lwgeom_to_geojson(const LWGEOM *geo, const char *srs, int precision, int has_bbox);
+
+/**
+ * Streaming writer of a GeoJSON FeatureCollection. The output is handed
+ * to the sink in chunks as the features are added.
+ */
+struct LWGEOJSON_WRITER;
+typedef struct LWGEOJSON_WRITER LWGEOJSON_WRITER;
+
+/**
+ * Takes the next chunk of output, valid during the call only.
+ * Returns LW_SUCCESS, or LW_FAILURE to stop the writer.
+ */
+typedef int (*lwgeojson_sink)(const char *text, size_t size, void *data);
+
+/**
+ * @param srs written once as the "crs" of the collection, if not NULL
+ * @param precision and has_bbox as in lwgeom_to_geojson, for each geometry
+ */
+extern LWGEOJSON_WRITER* lwgeojson_writer_create(lwgeojson_sink sink, void *data, const char *srs, int precision, int has_bbox);
+
+/**
+ * Add a feature. The geometry may be NULL, and the properties are the
+ * raw JSON text of their object, written as null when NULL.
+ * Returns LW_FAILURE once the sink has failed.
+ */
+extern int lwgeojson_writer_feature(LWGEOJSON_WRITER *writer, const LWGEOM *geom, const char *properties, size_t properties_size);
+
+/**
+ * Close the collection and hand the rest of the output to the sink.
+ */
+extern int lwgeojson_writer_finish(LWGEOJSON_WRITER *writer);
+extern void lwgeojson_writer_free(LWGEOJSON_WRITER *writer);
 extern lwvarlena_t* lwgeom_to_x3d3(const LWGEOM *geom, int precision, int opts, const char *defid);
 extern lwvarlena_t* lwgeom_to_svg(const LWGEOM *geom, int precision, int relative);
 extern lwvarlena_t* lwgeom_to_encoded_polyline(const LWGEOM *geom, int precision);
 
+typedef enum
+{
+	LWPROPERTY_STRING,
+	LWPROPERTY_FLOAT,
+	LWPROPERTY_DOUBLE,
+	LWPROPERTY_INT,
+	LWPROPERTY_BOOL,
+	LWPROPERTY_JSON
+} LWPROPERTY_TYPE;
+
+/**
+ * A feature attribute, for the binary feature formats. STRING and JSON
+ * values are read from string_value, JSON ones being raw JSON text,
+ * FLOAT and DOUBLE values from double_value, INT and BOOL values from
+ * int_value. Properties without a key or with a NULL string are left out.
+ */
+typedef struct
+{
+	const char *key;
+	LWPROPERTY_TYPE type;
+	const char *string_value;
+	double double_value;
+	int64_t int_value;
+} LWPROPERTY;
+
+/**
+ * Mapbox Vector Tile encoding. Geometries are taken to the grid of the
+ * tile with lwgeom_to_mvt_geom, batched into layers and the layers
+ * encoded as one tile with lwmvt_encode.
+ *
+ * Layers share nothing, so layers and tiles can be built on different
+ * threads as long as each thread has its own LWGEOM_CONTEXT: the encoder
+ * allocates through lwalloc, which is not thread-safe across a shared
+ * context. A layer built in parts on several threads is put back
+ * together with lwmvt_layer_merge.
+ */
+struct LWMVT_LAYER;
+typedef struct LWMVT_LAYER LWMVT_LAYER;
+
+/**
+ * Take a geometry from the bounds of a tile to its integer grid of
+ * extent units, origin at the top left, clipped to buffer units around
+ * the tile when clip_geom is set. Polygons are made valid.
+ * Returns NULL when nothing is left of the geometry.
+ */
+extern LWGEOM* lwgeom_to_mvt_geom(const LWGEOM *geom, const GBOX *bounds, uint32_t extent, uint32_t buffer, int clip_geom);
+
+extern LWMVT_LAYER* lwmvt_layer_create(const char *name, uint32_t extent);
+extern void lwmvt_layer_free(LWMVT_LAYER *layer);
+extern size_t lwmvt_layer_nfeatures(const LWMVT_LAYER *layer);
+
+/**
+ * Add a feature, its geometry in the grid of the tile.
+ * @param id feature id, NULL when the feature has none
+ * @return LW_FAILURE when there is nothing left to encode of the geometry
+ */
+extern int lwmvt_layer_add_feature(LWMVT_LAYER *layer, const LWGEOM *geom, const LWPROPERTY *properties, uint32_t nproperties, const uint64_t *id);
+
+/**
+ * Append the features of another layer of the same extent, which is
+ * left as it was. Merging a layer into itself doubles its features.
+ */
+extern int lwmvt_layer_merge(LWMVT_LAYER *layer, const LWMVT_LAYER *from);
+
+/**
+ * Encode the layers as one tile. Tiles encoded separately can be
+ * concatenated into a tile holding all of their layers.
+ */
+extern lwvarlena_t* lwmvt_encode(LWMVT_LAYER **layers, uint32_t nlayers);
+
+/**
+ * Geobuf representation of a geometry, coordinates rounded to precision
+ * decimal digits (0 to 15) and Z kept if there is one.
+ */
+extern lwvarlena_t* lwgeom_to_geobuf(const LWGEOM *geom, int precision);
+
+/**
+ * Writer of a Geobuf FeatureCollection. Each feature is encoded as it is
+ * added, and the collection put together behind its header of keys by
+ * lwgeobuf_writer_finish.
+ */
+struct LWGEOBUF_WRITER;
+typedef struct LWGEOBUF_WRITER LWGEOBUF_WRITER;
+
+/**
+ * @param precision as in lwgeom_to_geobuf, for all the features
+ * @param has_z write three coordinates for all the features
+ */
+extern LWGEOBUF_WRITER* lwgeobuf_writer_create(int precision, int has_z);
+
+/**
+ * Add a feature. A NULL geometry is written as an empty
+ * GeometryCollection, as features need one.
+ */
+extern int lwgeobuf_writer_feature(LWGEOBUF_WRITER *writer, const LWGEOM *geom, const LWPROPERTY *properties, uint32_t nproperties);
+extern lwvarlena_t* lwgeobuf_writer_finish(LWGEOBUF_WRITER *writer);
+extern void lwgeobuf_writer_free(LWGEOBUF_WRITER *writer);
+
+/**
+ * Writer of a FlatGeobuf file. The features are held in memory, as the
+ * packed Hilbert R-tree of their boxes comes before them in the file,
+ * and handed to the sink by lwflatgeobuf_writer_finish.
+ */
+struct LWFLATGEOBUF_WRITER;
+typedef struct LWFLATGEOBUF_WRITER LWFLATGEOBUF_WRITER;
+
+/**
+ * Takes the next chunk of output, valid during the call only.
+ * Returns LW_SUCCESS, or LW_FAILURE to stop the writer.
+ */
+typedef int (*lwflatgeobuf_sink)(const uint8_t *bytes, size_t size, void *data);
+
+/**
+ * @param name name of the dataset, left out when NULL
+ * @param srid written as the EPSG code of the dataset when known
+ * @param has_z, has_m ordinates of all the features, zero where missing
+ * @param index_node_size children per index node, usually 16, or 0 for
+ *        a file without index
+ */
+extern LWFLATGEOBUF_WRITER* lwflatgeobuf_writer_create(lwflatgeobuf_sink sink, void *data, const char *name, int32_t srid, int has_z, int has_m, uint16_t index_node_size);
+
+/**
+ * Add a feature, the geometry may be NULL. The first feature with a
+ * property sets its type, which later ones must keep.
+ */
+extern int lwflatgeobuf_writer_feature(LWFLATGEOBUF_WRITER *writer, const LWGEOM *geom, const LWPROPERTY *properties, uint32_t nproperties);
+
+/**
+ * Build the index and hand the file to the sink.
+ */
+extern int lwflatgeobuf_writer_finish(LWFLATGEOBUF_WRITER *writer);
+extern void lwflatgeobuf_writer_free(LWFLATGEOBUF_WRITER *writer);
+
 /**
  * Create an LWGEOM object from a GeoJSON representation
  *
@@ -1732,6 +1973,105 @@ extern lwvarlena_t* lwgeom_to_encoded_polyline(const LWGEOM *geom, int precision
  */
 extern LWGEOM* lwgeom_from_geojson(const char *geojson, char **srs);
 
+/**
+ * Streaming reader of GeoJSON features. The text is pushed in chunks of
+ * any size, and only the feature being read is held in memory. It takes
+ * a FeatureCollection, single Features or geometries, and sequences of
+ * these (one per line or separated by RS). The features of a
+ * FeatureCollection are only read one at a time when its "type" comes
+ * before them, otherwise the whole collection is held.
+ */
+struct LWGEOJSON_READER;
+typedef struct LWGEOJSON_READER LWGEOJSON_READER;
+
+/**
+ * Called for each feature read. The geometry is NULL for a null geometry,
+ * and belongs to the callback. The properties are the raw JSON text of the
+ * "properties" member, NULL if there is none, valid during the call only.
+ * Returns LW_TRUE to go on, LW_FALSE to stop.
+ */
+typedef int (*lwgeojson_feature_callback)(LWGEOM *geom, const char *properties, size_t properties_size, void *data);
+
+extern LWGEOJSON_READER* lwgeojson_reader_create(lwgeojson_feature_callback callback, void *data);
+
+/**
+ * Read the features completed by the next chunk of text.
+ * Returns LW_FAILURE, after an lwerror, on invalid input.
+ */
+extern int lwgeojson_reader_push(LWGEOJSON_READER *reader, const char *text, size_t size);
+
+/**
+ * Signal the end of the input.
+ * Returns LW_FAILURE, after an lwerror, if it ends within a feature.
+ */
+extern int lwgeojson_reader_finish(LWGEOJSON_READER *reader);
+extern void lwgeojson_reader_free(LWGEOJSON_READER *reader);
+
+/**
+ * Create an LWGEOM object from a Geobuf message. A Feature gives its
+ * geometry, a FeatureCollection a GeometryCollection of the geometries of
+ * its features.
+ */
+extern LWGEOM* lwgeom_from_geobuf(const uint8_t *geobuf, size_t size);
+
+/**
+ * Streaming reader of Geobuf, pushed in chunks of any size. Only the
+ * feature being read is held in memory. A message holding a single Feature
+ * or geometry gives one feature.
+ */
+struct LWGEOBUF_READER;
+typedef struct LWGEOBUF_READER LWGEOBUF_READER;
+
+/**
+ * Called for each feature read. The geometry belongs to the callback, the
+ * properties are valid during the call only.
+ * Returns LW_TRUE to go on, LW_FALSE to stop.
+ */
+typedef int (*lwgeobuf_feature_callback)(LWGEOM *geom, const LWPROPERTY *properties, uint32_t nproperties, void *data);
+
+extern LWGEOBUF_READER* lwgeobuf_reader_create(lwgeobuf_feature_callback callback, void *data);
+extern int lwgeobuf_reader_push(LWGEOBUF_READER *reader, const uint8_t *bytes, size_t size);
+extern int lwgeobuf_reader_finish(LWGEOBUF_READER *reader);
+extern void lwgeobuf_reader_free(LWGEOBUF_READER *reader);
+
+/**
+ * Reader of a FlatGeobuf file held in memory, typically mapped. Opening
+ * it reads the header, and the index is used where it lies, so the
+ * buffer must outlive the reader.
+ */
+struct LWFLATGEOBUF;
+typedef struct LWFLATGEOBUF LWFLATGEOBUF;
+
+/**
+ * Called for each feature read. The geometry is NULL for a feature
+ * without one, and belongs to the callback. Its 2D point arrays may be
+ * read-only views of the buffer, see ptarray_make_writable. The
+ * properties are valid during the call only.
+ * Returns LW_TRUE to go on, LW_FALSE to stop.
+ */
+typedef int (*lwflatgeobuf_feature_callback)(LWGEOM *geom, const LWPROPERTY *properties, uint32_t nproperties, void *data);
+
+extern LWFLATGEOBUF* lwflatgeobuf_open(const uint8_t *buf, size_t size);
+extern void lwflatgeobuf_close(LWFLATGEOBUF *fgb);
+
+/**
+ * Number of features given by the header, 0 when unknown.
+ */
+extern uint64_t lwflatgeobuf_nfeatures(const LWFLATGEOBUF *fgb);
+
+/**
+ * Box of all the features given by the header, LW_FAILURE if there is none.
+ */
+extern int lwflatgeobuf_extent(const LWFLATGEOBUF *fgb, GBOX *extent);
+
+/**
+ * Read the features whose box overlaps query, or all of them, in file
+ * order, for a NULL query. With an index only the features it finds are
+ * read, without one every feature is read and tested.
+ * Returns the number of features read, -1 after an lwerror on invalid input.
+ */
+extern int64_t lwflatgeobuf_query(LWFLATGEOBUF *fgb, const GBOX *query, lwflatgeobuf_feature_callback callback, void *data);
+
 /**
  * Create an LWGEOM object from an Encoded Polyline representation
  *
@@ -2277,6 +2617,53 @@ extern void *lwalloc(size_t size);
 extern void *lwrealloc(void *mem, size_t size);
 extern void lwfree(void *mem);
 
+/**
+* Arena (bump) allocator for short lived work.
+*
+* While an arena is pushed on the current #LWGEOM_CONTEXT, lwalloc and
+* lwrealloc carve memory out of it, lwfree and lwgeom_free are no-ops on
+* memory the arena owns, and lwarena_pop releases everything allocated
+* since the matching lwarena_push in one go. Memory allocated before the
+* push is still freed normally. Anything that must outlive the scope has
+* to be copied after lwarena_pop, or inside a nested lwarena_push(NULL, ...)
+* scope, which temporarily goes back to the heap allocator. Scopes nest and
+* must be popped in reverse order.
+*
+* Arenas are not thread safe: use one per thread, with a per-thread context.
+*/
+typedef struct LWARENA LWARENA;
+
+typedef struct LWARENA_SCOPE
+{
+	LWARENA *arena;
+	struct LWARENA_SCOPE *outer;
+	void *block;
+	size_t used;
+	size_t allocated;
+} LWARENA_SCOPE;
+
+/** Create an empty arena, first heap block will be block_size bytes */
+extern LWARENA *lwarena_create(size_t block_size);
+/** Give all the arena blocks back to the heap allocator */
+extern void lwarena_destroy(LWARENA *arena);
+/** Release every allocation at once, keeping the blocks for reuse */
+extern void lwarena_reset(LWARENA *arena);
+extern void *lwarena_alloc(LWARENA *arena, size_t size);
+extern void *lwarena_realloc(LWARENA *arena, void *mem, size_t size);
+extern void lwarena_free(LWARENA *arena, void *mem);
+/** LW_TRUE if mem was allocated from (the live part of) the arena */
+extern int lwarena_owns(const LWARENA *arena, const void *mem);
+/** Bytes handed out since the last reset, including headers */
+extern size_t lwarena_allocated(const LWARENA *arena);
+/** Make arena (NULL for the heap) the allocator of the current context */
+extern void lwarena_push(LWARENA *arena, LWARENA_SCOPE *scope);
+/** Release the allocations of the scope and restore the previous allocator */
+extern void lwarena_pop(LWARENA_SCOPE *scope);
+/** Arena of the innermost scope of the current context, NULL for the heap */
+extern LWARENA *lwarena_current(void);
+/** Arena of the current scope chain that owns mem, NULL for heap memory */
+extern LWARENA *lwarena_owner(const void *mem);
+
 /* Utilities */
 extern char *lwmessage_truncate(char *str, int startpos, int endpos, int maxlength, int truncdirection);
 
@@ -2300,6 +2687,15 @@ extern lwvarlena_t* lwgeom_to_twkb(const LWGEOM *geom, uint8_t variant, int8_t p
 
 extern lwvarlena_t* lwgeom_to_twkb_with_idlist(const LWGEOM *geom, int64_t *idlist, uint8_t variant, int8_t precision_xy, int8_t precision_z, int8_t precision_m);
 
+/**
+ * Encode an array of geometries as one TWKB collection, the same as
+ * lwgeom_to_twkb_with_idlist of their collection, or multi when they all
+ * have the same simple type and dimensions. The geometries may not be
+ * NULL, and give the collection the dimensions of the first one.
+ * @param idlist one id per geometry, or NULL for no ids
+ */
+extern lwvarlena_t* lwgeom_to_twkb_batch(const LWGEOM **geoms, uint32_t ngeoms, const int64_t *idlist, uint8_t variant, int8_t precision_xy, int8_t precision_z, int8_t precision_m);
+
 /**
  * Trim the bits of an LWGEOM in place, to optimize it for compression.
  * Sets all bits to zero that are not required to maintain a specified
@@ -2490,6 +2886,21 @@ int lwgeom_transform_from_str(LWGEOM *geom, const char* instr, const char* outst
  */
 int lwgeom_transform(LWGEOM *geom, LWPROJ* pj);
 int ptarray_transform(POINTARRAY *pa, LWPROJ* pj);
+
+/* Points per proj_trans_generic call, so the degree/radian passes stay in cache */
+#define LW_TRANSFORM_CHUNK_POINTS 4096
+/* Below this many points per thread, cloning the PJ costs more than it saves */
+#define LW_TRANSFORM_PARALLEL_MIN_POINTS 65536
+
+/**
+ * Multi-threaded variants of lwgeom_transform and ptarray_transform, for
+ * very large geometries. The points are split between up to nthreads
+ * threads (0 for one per processor), each one using a clone of the PJ in
+ * a PROJ context of its own. Inputs too small to be worth it, or whose PJ
+ * cannot be cloned, are transformed on the calling thread.
+ */
+int lwgeom_transform_parallel(LWGEOM *geom, LWPROJ *pj, uint32_t nthreads);
+int ptarray_transform_parallel(POINTARRAY *pa, LWPROJ *pj, uint32_t nthreads);
 int box3d_transform(GBOX *box, LWPROJ *pj);
 
 /**
@@ -2524,11 +2935,112 @@ int lwgeom_transform_pipeline(LWGEOM *geom, const char* pipeline, bool is_forwar
  */
 LWPROJ *lwproj_from_str_pipeline(const char* str_pipeline, bool is_forward);
 
+/**
+ * Cached variants of lwproj_from_str and lwproj_from_str_pipeline.
+ *
+ * Every #LWGEOM_CONTEXT keeps a small LRU cache of LWPROJ objects keyed on
+ * the definition strings, used by lwgeom_transform_from_str and
+ * lwgeom_transform_pipeline. The returned LWPROJ belongs to the cache:
+ * do not free it, and do not keep it across other cache calls on the same
+ * context, which may evict it. NULL when PROJ cannot build the operation.
+ * Call lwproj_cache_flush before destroying or replacing the pj_ctx of the
+ * context: entries of a previous pj_ctx are dropped without proj_destroy.
+ */
+LWPROJ *lwproj_cache_get(const char *str_in, const char *str_out);
+LWPROJ *lwproj_cache_get_pipeline(const char *str_pipeline, bool is_forward);
+/** Destroy all the cached LWPROJ of the current context, statistics are kept */
+void lwproj_cache_flush(void);
+/** Maximum number of cached entries, between 1 and LWPROJ_CACHE_MAX_ITEMS */
+void lwproj_cache_set_size(uint32_t capacity);
+/** Cache hits, misses and current number of entries of the current context */
+void lwproj_cache_stats(uint64_t *hits, uint64_t *misses, uint32_t *size);
+/** Flush and release the cache, before destroying the context (or its pj_ctx) */
+void lwproj_cache_destroy(void);
+
 
 /*******************************************************************************
  * GEOS-dependent extra functions on LWGEOM
  ******************************************************************************/
 
+/**
+ * Prepared geometries, for predicates evaluated many times against the
+ * same geometry (a big polygon probed by millions of points).
+ *
+ * An LWPREPARED keeps the GEOS conversion of the geometry, its
+ * GEOSPreparedGeometry and its box alive between calls. The predicates
+ * return LW_TRUE or LW_FALSE, or -1 on GEOS error, like lwgeom_is_simple.
+ * Prepared geometries belong to the GEOS handle of the context that
+ * created them.
+ */
+typedef struct LWPREPARED LWPREPARED;
+
+LWPREPARED *lwgeom_prepare(const LWGEOM *geom);
+void lwprepared_free(LWPREPARED *prep);
+int lwprepared_intersects(LWPREPARED *prep, const LWGEOM *geom);
+int lwprepared_contains(LWPREPARED *prep, const LWGEOM *geom);
+int lwprepared_covers(LWPREPARED *prep, const LWGEOM *geom);
+/** LW_TRUE if the prepared geometry is within geom */
+int lwprepared_within(LWPREPARED *prep, const LWGEOM *geom);
+
+/**
+ * Same predicates, with geom1 prepared through a small per context LRU
+ * cache: calling them in a loop with the same geom1 only converts and
+ * prepares it once. Entries are matched on an exact copy of the geometry,
+ * not on a hash alone.
+ */
+int lwgeom_prepared_intersects(const LWGEOM *geom1, const LWGEOM *geom2);
+int lwgeom_prepared_contains(const LWGEOM *geom1, const LWGEOM *geom2);
+int lwgeom_prepared_covers(const LWGEOM *geom1, const LWGEOM *geom2);
+int lwgeom_prepared_within(const LWGEOM *geom1, const LWGEOM *geom2);
+
+/**
+ * The cached LWPREPARED of geom, owned by the cache: valid until the next
+ * cache call on the same context, do not free it.
+ */
+LWPREPARED *lwprepared_cache_get(const LWGEOM *geom);
+/** Release all the cached prepared geometries of the current context */
+void lwprepared_cache_flush(void);
+/** Cache hits, misses and current number of entries of the current context */
+void lwprepared_cache_stats(uint64_t *hits, uint64_t *misses, uint32_t *size);
+/** Flush and release the cache, before destroying the context (or its GEOS handle) */
+void lwprepared_cache_destroy(void);
+
+/**
+ * Spatial join of two geometry arrays.
+ *
+ * Candidate pairs come from the boxes, through a packed Hilbert R-tree
+ * over b probed by the elements of a in Hilbert order, and are refined
+ * with rect trees (intersects, dwithin) or with a prepared a (contains,
+ * covers, within). Matching pairs are passed to the callback as they are
+ * found, in no particular order, and never stored.
+ *
+ * Geometries are cartesian, empty ones never match.
+ */
+typedef enum
+{
+	LW_JOIN_INTERSECTS,
+	LW_JOIN_DWITHIN,  /* Distance of at most the given distance */
+	LW_JOIN_CONTAINS, /* a contains b */
+	LW_JOIN_COVERS,   /* a covers b */
+	LW_JOIN_WITHIN    /* a is within b */
+} LW_JOIN_PREDICATE;
+
+/**
+ * Gets the indexes in a and b of every matching pair. Returns LW_TRUE to
+ * go on, LW_FALSE to stop the join.
+ */
+typedef int (*lwgeom_join_callback)(uint32_t ia, uint32_t ib, void *data);
+
+/**
+ * Returns LW_FAILURE on error (mixed SRIDs, geodetic inputs, GEOS
+ * failure), LW_SUCCESS otherwise, including when stopped by the callback.
+ * distance is only used by LW_JOIN_DWITHIN.
+ */
+int lwgeom_spatial_join(const LWGEOM **a, uint32_t n,
+			const LWGEOM **b, uint32_t m,
+			LW_JOIN_PREDICATE predicate, double distance,
+			lwgeom_join_callback callback, void *data);
+
 /**
  * Take a geometry and return an areal geometry
  * (Polygon or MultiPolygon).
@@ -2629,6 +3141,14 @@ LWGEOM* lwgeom_triangulate_polygon(const LWGEOM* geom);
 */
 int * lwgeom_cluster_kmeans(const LWGEOM **geoms, uint32_t n, uint32_t k, double max_radius);
 
+/**
+* Multi-threaded variant of lwgeom_cluster_kmeans, for large inputs. The
+* points are split between up to nthreads threads (0 for one per
+* processor) for the seeding and assignment passes; the result is the same
+* as the one of lwgeom_cluster_kmeans.
+*/
+int * lwgeom_cluster_kmeans_parallel(const LWGEOM **geoms, uint32_t n, uint32_t k, double max_radius, uint32_t nthreads);
+
 #include "lwinline.h"
 
 #define LWGEOM_GEOS_ERRMSG_MAXSIZE 256
@@ -2656,11 +3176,35 @@ typedef struct
 	void* pj_ctx;
 	char lwgeom_geos_errmsg[LWGEOM_GEOS_ERRMSG_MAXSIZE];
 	char tflags[6];
+	LWARENA_SCOPE* arena_scope; /* Innermost arena scope, NULL for the heap */
+	LWPROJ_CACHE* proj_cache; /* See lwproj_cache_get */
+	LWPREPARED_CACHE* prepared_cache; /* See lwprepared_cache_get */
+	RECT_TREE_CACHE* rect_tree_cache; /* See rect_tree_cache_get */
+	CIRC_TREE_CACHE* circ_tree_cache; /* See circ_tree_cache_get */
+	/* Handlers of this context, NULL for the lwgeom_set_handlers ones */
+	lwallocator allocator;
+	lwreallocator reallocator;
+	lwfreeor freeor;
+	lwreporter errorreporter;
+	lwreporter noticereporter;
+	lwdebuglogger debuglogger;
 }
 LWGEOM_CONTEXT;
 
 extern LWGEOM_CONTEXT* lwcontext();
 
+/**
+* Install memory management and error handling functions for a single
+* context, so threads or sessions with their own context do not have to
+* share (or look up) a global allocator. They take precedence over the
+* handlers of lwgeom_set_handlers; NULL values fall back to those.
+* @ingroup system
+*/
+extern void lwcontext_set_handlers(LWGEOM_CONTEXT *ctx, lwallocator allocator,
+        lwreallocator reallocator, lwfreeor freeor, lwreporter errorreporter,
+        lwreporter noticereporter);
+extern void lwcontext_set_debuglogger(LWGEOM_CONTEXT *ctx, lwdebuglogger debuglogger);
+
 #ifdef WIN32
 #define bzero(s, n)	memset((s), 0, (n))
 #define strcasecmp _stricmp
@@ -149,6 +149,12 @@
 /* */
 #define OUT_MAX_BYTES_DOUBLE (1 /* Sign */ + 2 /* 0.x */ + OUT_MAX_DIGITS)
 #define OUT_DOUBLE_BUFFER_SIZE OUT_MAX_BYTES_DOUBLE + 1 /* +1 including NULL */
+/*
+ * Widest output of lwprint_double for a precision: at most 16 integer digits
+ * in fixed notation, or one digit and a three digit exponent in scientific
+ * notation, and never more than OUT_MAX_BYTES_DOUBLE.
+ */
+#define OUT_MAX_BYTES_DOUBLE_PRECISION(precision) FP_MIN(OUT_MAX_BYTES_DOUBLE, 18 + FP_MAX(0, (precision)))
 
 /**
 * Constants for point-in-polygon return values
@@ -430,6 +436,18 @@ void ptarray_grid_in_place(POINTARRAY *pa, const gridspec *grid);
 int lw_segment_side(const POINT2D *p1, const POINT2D *p2, const POINT2D *q);
 int lw_arc_side(const POINT2D *A1, const POINT2D *A2, const POINT2D *A3, const POINT2D *Q);
 int lw_arc_calculate_gbox_cartesian_2d(const POINT2D *A1, const POINT2D *A2, const POINT2D *A3, GBOX *gbox);
+
+/*
+* Extent of every ordinate of a point array, vectorized where the processor
+* allows it, with the same result as a FP_MIN/FP_MAX loop. Needs a point.
+*/
+void ptarray_calculate_minmax(const POINTARRAY *pa, double *mins, double *maxs);
+
+/*
+* llround(factor[d] * ordinate) of npoints points from first, for TWKB,
+* vectorized where the processor allows it.
+*/
+void ptarray_quantize(const POINTARRAY *pa, uint32_t first, uint32_t npoints, const double *factor, int64_t *out);
 double lw_arc_center(const POINT2D *p1, const POINT2D *p2, const POINT2D *p3, POINT2D *result);
 int lw_pt_in_seg(const POINT2D *P, const POINT2D *A1, const POINT2D *A2);
 int lw_pt_in_arc(const POINT2D *P, const POINT2D *A1, const POINT2D *A2, const POINT2D *A3);
@@ -469,6 +487,13 @@ int gbox_centroid(const GBOX* gbox, POINT2D* out);
 
 /* Utilities */
 int lwprint_double(double d, int maxdd, char *buf);
+
+/*
+* Correctly rounded w * 10^q for the text readers, LW_FAILURE when out of
+* the fast range, for the caller to use strtod.
+*/
+int lw_decimal_to_double(uint64_t w, int64_t q, int negative, double *d);
+
 extern uint8_t MULTITYPE[NUMTYPES];
 
 extern lwinterrupt_callback *_lwgeom_interrupt_callback;
@@ -490,4 +515,8 @@ int lwpoly_contains_point(const LWPOLY *poly, const POINT2D *pt);
 POINT4D* lwmpoint_extract_points_4d(const LWMPOINT* g, uint32_t* npoints, int* input_empty);
 char* lwstrdup(const char* a);
 
+/* Allocate straight from the installed handlers, bypassing any arena */
+void *lwalloc_heap(size_t size);
+void lwfree_heap(void *mem);
+
 #endif /* _LIBLWGEOM_INTERNAL_H */
@@ -0,0 +1,313 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include "liblwgeom_internal.h"
+#include "lwgeom_log.h"
+
+/*
+ * Bump allocator for short lived geometry work.
+ *
+ * Memory is carved out of large blocks obtained from the heap allocator.
+ * Every allocation is preceded by its (aligned) size so that lwrealloc can
+ * copy the right amount, and so the most recent allocation can grow or be
+ * given back in place. Released blocks are kept on a spare list and reused,
+ * so a per-row scope does not go back to the heap once it is warm.
+ */
+
+#define LWARENA_ALIGN 8
+#define LWARENA_ALIGNED(size) (((size) + (LWARENA_ALIGN - 1)) & ~((size_t)LWARENA_ALIGN - 1))
+#define LWARENA_HDR LWARENA_ALIGNED(sizeof(size_t))
+#define LWARENA_MIN_BLOCK 4096
+#define LWARENA_MAX_BLOCK (8 * 1024 * 1024)
+
+typedef struct LWARENA_BLOCK
+{
+	struct LWARENA_BLOCK *prev; /* Older block, or next spare one */
+	size_t size;                /* Usable bytes after the header */
+	size_t used;
+	size_t pad;                 /* Keep the data double aligned */
+} LWARENA_BLOCK;
+
+#define LWARENA_BLOCK_DATA(b) ((uint8_t *)((b) + 1))
+
+struct LWARENA
+{
+	LWARENA_BLOCK *head;  /* Block being filled */
+	LWARENA_BLOCK *tail;  /* Oldest block in use, for O(1) reset */
+	LWARENA_BLOCK *spare; /* Released blocks, ready for reuse */
+	size_t block_size;    /* Size of the next fresh block */
+	size_t allocated;     /* Bytes handed out since the last reset */
+};
+
+static void
+lwarena_block_free_list(LWARENA_BLOCK *b)
+{
+	while (b)
+	{
+		LWARENA_BLOCK *prev = b->prev;
+		lwfree_heap(b);
+		b = prev;
+	}
+}
+
+LWARENA *
+lwarena_create(size_t block_size)
+{
+	LWARENA *arena = lwalloc_heap(sizeof(LWARENA));
+	memset(arena, 0, sizeof(LWARENA));
+	arena->block_size = block_size < LWARENA_MIN_BLOCK ? LWARENA_MIN_BLOCK : block_size;
+	return arena;
+}
+
+void
+lwarena_destroy(LWARENA *arena)
+{
+	if (!arena)
+		return;
+	lwarena_block_free_list(arena->head);
+	lwarena_block_free_list(arena->spare);
+	lwfree_heap(arena);
+}
+
+/* Put the first block of the spare list that fits in front, or get a new one */
+static LWARENA_BLOCK *
+lwarena_add_block(LWARENA *arena, size_t needed)
+{
+	LWARENA_BLOCK *b = arena->spare;
+
+	if (b && b->size >= needed)
+	{
+		arena->spare = b->prev;
+	}
+	else
+	{
+		size_t size = arena->block_size;
+		while (size < needed)
+			size *= 2;
+		b = lwalloc_heap(sizeof(LWARENA_BLOCK) + size);
+		if (!b)
+			return NULL;
+		b->size = size;
+		/* Grow geometrically so big scopes need few blocks */
+		if (arena->block_size < LWARENA_MAX_BLOCK)
+			arena->block_size *= 2;
+	}
+
+	b->used = 0;
+	b->prev = arena->head;
+	if (!arena->head)
+		arena->tail = b;
+	arena->head = b;
+	return b;
+}
+
+void *
+lwarena_alloc(LWARENA *arena, size_t size)
+{
+	LWARENA_BLOCK *b = arena->head;
+	size_t needed = LWARENA_HDR + LWARENA_ALIGNED(size);
+	uint8_t *mem;
+
+	if (!b || b->size - b->used < needed)
+	{
+		b = lwarena_add_block(arena, needed);
+		if (!b)
+			return NULL;
+	}
+
+	mem = LWARENA_BLOCK_DATA(b) + b->used;
+	*((size_t *)mem) = LWARENA_ALIGNED(size);
+	b->used += needed;
+	arena->allocated += needed;
+	return mem + LWARENA_HDR;
+}
+
+/* Is mem the most recent allocation of the head block? */
+static inline int
+lwarena_is_last(const LWARENA *arena, const uint8_t *mem)
+{
+	const LWARENA_BLOCK *b = arena->head;
+	size_t size = *((const size_t *)(mem - LWARENA_HDR));
+	return b && mem + size == LWARENA_BLOCK_DATA(b) + b->used;
+}
+
+void *
+lwarena_realloc(LWARENA *arena, void *mem, size_t size)
+{
+	size_t oldsize, newsize;
+	void *newmem;
+
+	if (!mem)
+		return lwarena_alloc(arena, size);
+
+	oldsize = *((size_t *)((uint8_t *)mem - LWARENA_HDR));
+	newsize = LWARENA_ALIGNED(size);
+
+	if (lwarena_is_last(arena, mem))
+	{
+		/* Resizing the last allocation is just a bump */
+		LWARENA_BLOCK *b = arena->head;
+		if (newsize <= oldsize || b->size - b->used >= newsize - oldsize)
+		{
+			b->used = b->used - oldsize + newsize;
+			arena->allocated = arena->allocated - oldsize + newsize;
+			*((size_t *)((uint8_t *)mem - LWARENA_HDR)) = newsize;
+			return mem;
+		}
+	}
+	else if (newsize <= oldsize)
+	{
+		return mem;
+	}
+
+	newmem = lwarena_alloc(arena, size);
+	if (newmem)
+		memcpy(newmem, mem, oldsize < size ? oldsize : size);
+	return newmem;
+}
+
+void
+lwarena_free(LWARENA *arena, void *mem)
+{
+	/* Only the most recent allocation can be handed back */
+	if (mem && lwarena_is_last(arena, mem))
+	{
+		size_t size = LWARENA_HDR + *((size_t *)((uint8_t *)mem - LWARENA_HDR));
+		arena->head->used -= size;
+		arena->allocated -= size;
+	}
+}
+
+int
+lwarena_owns(const LWARENA *arena, const void *mem)
+{
+	const LWARENA_BLOCK *b;
+	const uint8_t *p = mem;
+
+	if (!arena || !mem)
+		return LW_FALSE;
+
+	for (b = arena->head; b; b = b->prev)
+	{
+		if (p >= LWARENA_BLOCK_DATA(b) && p < LWARENA_BLOCK_DATA(b) + b->used)
+			return LW_TRUE;
+	}
+	return LW_FALSE;
+}
+
+size_t
+lwarena_allocated(const LWARENA *arena)
+{
+	return arena ? arena->allocated : 0;
+}
+
+void
+lwarena_reset(LWARENA *arena)
+{
+	if (!arena || !arena->head)
+		return;
+
+	/* Splice the whole chain in front of the spare list */
+	arena->tail->prev = arena->spare;
+	arena->spare = arena->head;
+	arena->head = arena->tail = NULL;
+	arena->allocated = 0;
+}
+
+/* Release every block allocated after the mark */
+static void
+lwarena_rewind(LWARENA *arena, LWARENA_BLOCK *mark_block, size_t mark_used, size_t mark_allocated)
+{
+	if (!mark_block)
+	{
+		lwarena_reset(arena);
+		return;
+	}
+
+	while (arena->head && arena->head != mark_block)
+	{
+		LWARENA_BLOCK *b = arena->head;
+		arena->head = b->prev;
+		b->prev = arena->spare;
+		arena->spare = b;
+	}
+
+	/* The mark block went away with an explicit reset */
+	if (!arena->head)
+	{
+		arena->tail = NULL;
+		arena->allocated = 0;
+		return;
+	}
+	arena->head->used = mark_used;
+	arena->allocated = mark_allocated;
+}
+
+void
+lwarena_push(LWARENA *arena, LWARENA_SCOPE *scope)
+{
+	LWGEOM_CONTEXT *ctx = lwcontext();
+
+	scope->arena = arena;
+	scope->outer = ctx->arena_scope;
+	scope->block = arena ? arena->head : NULL;
+	scope->used = scope->block ? arena->head->used : 0;
+	scope->allocated = arena ? arena->allocated : 0;
+
+	ctx->arena_scope = scope;
+}
+
+void
+lwarena_pop(LWARENA_SCOPE *scope)
+{
+	LWGEOM_CONTEXT *ctx = lwcontext();
+
+	if (ctx->arena_scope != scope)
+	{
+		lwerror("%s: arena scopes must be popped in reverse push order", __func__);
+		return;
+	}
+
+	if (scope->arena)
+		lwarena_rewind(scope->arena, scope->block, scope->used, scope->allocated);
+
+	ctx->arena_scope = scope->outer;
+}
+
+LWARENA *
+lwarena_current(void)
+{
+	LWARENA_SCOPE *scope = lwcontext()->arena_scope;
+	return scope ? scope->arena : NULL;
+}
+
+LWARENA *
+lwarena_owner(const void *mem)
+{
+	LWARENA_SCOPE *scope;
+
+	/* Memory can come from any arena of the scope chain */
+	for (scope = lwcontext()->arena_scope; scope && mem; scope = scope->outer)
+	{
+		if (lwarena_owns(scope->arena, mem))
+			return scope->arena;
+	}
+	return NULL;
+}
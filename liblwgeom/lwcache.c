@@ -0,0 +1,284 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include "lwcache.h"
+
+#include <string.h>
+
+/* Points of every array going into the key, besides the last one */
+#define LWCACHE_KEY_SAMPLES 8
+
+#define LWCACHE_PRIME1 0x9E3779B97F4A7C15ULL
+#define LWCACHE_PRIME2 0xC2B2AE3D27D4EB4FULL
+
+static inline uint64_t
+lwcache_mix(uint64_t h, uint64_t w)
+{
+	h ^= w * LWCACHE_PRIME2;
+	h = (h << 31) | (h >> 33);
+	return h * LWCACHE_PRIME1;
+}
+
+static uint64_t
+lwcache_key_ptarray(uint64_t h, const POINTARRAY *pa)
+{
+	uint32_t i, j, step, ndims;
+	uint64_t w;
+
+	if (!pa)
+		return lwcache_mix(h, 0);
+	h = lwcache_mix(h, pa->npoints);
+	if (!pa->npoints)
+		return h;
+
+	/*
+	 * A handful of points spread over the array, plus the last one, so
+	 * the key costs the same for a point and for a coastline. Hits are
+	 * confirmed by lwcache_geom_same, the key only has to tell most
+	 * different geometries apart.
+	 */
+	ndims = FLAGS_NDIMS(pa->flags);
+	step = pa->npoints > LWCACHE_KEY_SAMPLES ? pa->npoints / LWCACHE_KEY_SAMPLES : 1;
+	for (i = 0; i < pa->npoints; i += step)
+	{
+		const uint8_t *pt = getPoint_internal(pa, i);
+		for (j = 0; j < ndims; j++)
+		{
+			memcpy(&w, pt + j * sizeof(double), sizeof(w));
+			h = lwcache_mix(h, w);
+		}
+	}
+	memcpy(&w, getPoint_internal(pa, pa->npoints - 1), sizeof(w));
+	return lwcache_mix(h, w);
+}
+
+static uint64_t
+lwcache_key_r(uint64_t h, const LWGEOM *geom)
+{
+	uint32_t i;
+
+	switch (geom->type)
+	{
+	case POINTTYPE:
+	case LINETYPE:
+	case CIRCSTRINGTYPE:
+	case TRIANGLETYPE:
+		h = lwcache_mix(h, geom->type);
+		return lwcache_key_ptarray(h, ((const LWLINE *)geom)->points);
+	case POLYGONTYPE:
+	{
+		const LWPOLY *poly = (const LWPOLY *)geom;
+		h = lwcache_mix(h, ((uint64_t)geom->type << 32) | poly->nrings);
+		for (i = 0; i < poly->nrings; i++)
+			h = lwcache_key_ptarray(h, poly->rings[i]);
+		return h;
+	}
+	default:
+	{
+		const LWCOLLECTION *col = (const LWCOLLECTION *)geom;
+		if (!lwgeom_is_collection(geom))
+			return lwcache_mix(h, geom->type);
+		h = lwcache_mix(h, ((uint64_t)geom->type << 32) | col->ngeoms);
+		for (i = 0; i < col->ngeoms; i++)
+			h = lwcache_key_r(h, col->geoms[i]);
+		return h;
+	}
+	}
+}
+
+uint64_t
+lwcache_key(const LWGEOM *geom)
+{
+	uint64_t h = lwcache_mix(LWCACHE_PRIME1,
+				 ((uint64_t)(uint32_t)geom->srid << 32) | FLAGS_GET_ZM(geom->flags) |
+				     (FLAGS_GET_GEODETIC(geom->flags) << 2));
+	h = lwcache_key_r(h, geom);
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	return h;
+}
+
+static int
+lwcache_ptarray_same(const POINTARRAY *pa1, const POINTARRAY *pa2)
+{
+	if (!pa1 || !pa2)
+		return pa1 == pa2;
+	if (pa1->npoints != pa2->npoints || FLAGS_GET_ZM(pa1->flags) != FLAGS_GET_ZM(pa2->flags))
+		return LW_FALSE;
+	return !pa1->npoints ||
+	       memcmp(pa1->serialized_pointlist, pa2->serialized_pointlist,
+		      ptarray_point_size(pa1) * pa1->npoints) == 0;
+}
+
+static int
+lwcache_geom_same_r(const LWGEOM *geom1, const LWGEOM *geom2)
+{
+	uint32_t i;
+
+	if (geom1->type != geom2->type || FLAGS_GET_ZM(geom1->flags) != FLAGS_GET_ZM(geom2->flags))
+		return LW_FALSE;
+
+	switch (geom1->type)
+	{
+	case POINTTYPE:
+	case LINETYPE:
+	case CIRCSTRINGTYPE:
+	case TRIANGLETYPE:
+		return lwcache_ptarray_same(((const LWLINE *)geom1)->points, ((const LWLINE *)geom2)->points);
+	case POLYGONTYPE:
+	{
+		const LWPOLY *poly1 = (const LWPOLY *)geom1;
+		const LWPOLY *poly2 = (const LWPOLY *)geom2;
+		if (poly1->nrings != poly2->nrings)
+			return LW_FALSE;
+		for (i = 0; i < poly1->nrings; i++)
+		{
+			if (!lwcache_ptarray_same(poly1->rings[i], poly2->rings[i]))
+				return LW_FALSE;
+		}
+		return LW_TRUE;
+	}
+	default:
+	{
+		const LWCOLLECTION *col1 = (const LWCOLLECTION *)geom1;
+		const LWCOLLECTION *col2 = (const LWCOLLECTION *)geom2;
+		if (!lwgeom_is_collection(geom1))
+			return LW_FALSE;
+		if (col1->ngeoms != col2->ngeoms)
+			return LW_FALSE;
+		for (i = 0; i < col1->ngeoms; i++)
+		{
+			if (!lwcache_geom_same_r(col1->geoms[i], col2->geoms[i]))
+				return LW_FALSE;
+		}
+		return LW_TRUE;
+	}
+	}
+}
+
+int
+lwcache_geom_same(const LWGEOM *geom1, const LWGEOM *geom2)
+{
+	if (geom1->srid != geom2->srid || FLAGS_GET_GEODETIC(geom1->flags) != FLAGS_GET_GEODETIC(geom2->flags))
+		return LW_FALSE;
+	return lwcache_geom_same_r(geom1, geom2);
+}
+
+void
+lwcache_init(LWCACHE *cache, uint32_t capacity, lwcache_releaser release)
+{
+	memset(cache, 0, sizeof(LWCACHE));
+	cache->capacity = capacity < LWCACHE_MAX_ITEMS ? capacity : LWCACHE_MAX_ITEMS;
+	cache->release = release;
+}
+
+static void
+lwcache_item_release(LWCACHE *cache, LWCACHE_ITEM *item)
+{
+	cache->release(item->value);
+	lwgeom_free(item->geom);
+	memset(item, 0, sizeof(LWCACHE_ITEM));
+}
+
+static inline void *
+lwcache_hit(LWCACHE *cache, LWCACHE_ITEM *item, const LWGEOM *geom)
+{
+	item->input = geom;
+	item->last_used = ++cache->clock;
+	cache->hits++;
+	return item->value;
+}
+
+void *
+lwcache_find(LWCACHE *cache, const LWGEOM *geom, uint64_t *key)
+{
+	LWCACHE_ITEM *item;
+	uint32_t i;
+
+	/* Same input as last time, most loops end here */
+	for (i = 0; i < cache->size; i++)
+	{
+		item = &cache->items[i];
+		if (item->input == geom && lwcache_geom_same(item->geom, geom))
+			return lwcache_hit(cache, item, geom);
+	}
+
+	*key = lwcache_key(geom);
+	for (i = 0; i < cache->size; i++)
+	{
+		item = &cache->items[i];
+		if (item->key == *key && item->input != geom && lwcache_geom_same(item->geom, geom))
+			return lwcache_hit(cache, item, geom);
+	}
+
+	cache->misses++;
+	return NULL;
+}
+
+void
+lwcache_add(LWCACHE *cache, uint64_t key, const LWGEOM *input, LWGEOM *copy, void *value)
+{
+	LWCACHE_ITEM *item;
+	uint32_t i;
+
+	/* Take a free slot, or evict the least recently used entry */
+	if (cache->size < cache->capacity)
+	{
+		item = &cache->items[cache->size++];
+	}
+	else
+	{
+		item = &cache->items[0];
+		for (i = 1; i < cache->size; i++)
+		{
+			if (cache->items[i].last_used < item->last_used)
+				item = &cache->items[i];
+		}
+		lwcache_item_release(cache, item);
+	}
+
+	item->key = key;
+	item->last_used = ++cache->clock;
+	item->input = input;
+	item->geom = copy;
+	item->value = value;
+}
+
+void
+lwcache_flush(LWCACHE *cache)
+{
+	uint32_t i;
+
+	for (i = 0; i < cache->size; i++)
+		lwcache_item_release(cache, &cache->items[i]);
+	cache->size = 0;
+}
+
+void
+lwcache_stats(const LWCACHE *cache, uint64_t *hits, uint64_t *misses, uint32_t *size)
+{
+	if (hits)
+		*hits = cache ? cache->hits : 0;
+	if (misses)
+		*misses = cache ? cache->misses : 0;
+	if (size)
+		*size = cache ? cache->size : 0;
+}
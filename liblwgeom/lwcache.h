@@ -0,0 +1,89 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#ifndef _LWCACHE_H
+#define _LWCACHE_H 1
+
+#include "liblwgeom_internal.h"
+
+/*
+ * Small LRU of objects built from a geometry, shared by the per context
+ * caches of prepared geometries, rect trees and circ trees.
+ *
+ * Every entry owns a deep copy of the geometry it was built from, and a
+ * hit is only returned once the probe compares bit for bit equal to that
+ * copy, so hash collisions cannot hand out the object of another
+ * geometry. Each entry also remembers the last input it was returned for:
+ * calling again with the same LWGEOM goes straight to the comparison,
+ * without computing the key.
+ */
+
+#define LWCACHE_MAX_ITEMS 16
+
+typedef void (*lwcache_releaser)(void *value);
+
+typedef struct
+{
+	uint64_t key;       /* lwcache_key of geom */
+	uint64_t last_used;
+	const LWGEOM *input; /* Last caller geometry this entry matched */
+	LWGEOM *geom;       /* Owned deep copy */
+	void *value;
+} LWCACHE_ITEM;
+
+typedef struct
+{
+	uint32_t size;
+	uint32_t capacity;
+	uint64_t clock;
+	uint64_t hits;
+	uint64_t misses;
+	lwcache_releaser release;
+	LWCACHE_ITEM items[LWCACHE_MAX_ITEMS];
+} LWCACHE;
+
+/* Empty cache of at most capacity (<= LWCACHE_MAX_ITEMS) entries */
+void lwcache_init(LWCACHE *cache, uint32_t capacity, lwcache_releaser release);
+
+/*
+ * Cached value for geom, or NULL on a miss. Both are counted in the
+ * statistics. On a miss, *key is set for the following lwcache_add.
+ */
+void *lwcache_find(LWCACHE *cache, const LWGEOM *geom, uint64_t *key);
+
+/*
+ * Store value, built on copy (a deep copy of the geometry passed to
+ * lwcache_find), both owned by the cache from now on. Evicts the least
+ * recently used entry of a full cache.
+ */
+void lwcache_add(LWCACHE *cache, uint64_t key, const LWGEOM *input, LWGEOM *copy, void *value);
+
+/* Release every entry, the statistics are kept */
+void lwcache_flush(LWCACHE *cache);
+
+void lwcache_stats(const LWCACHE *cache, uint64_t *hits, uint64_t *misses, uint32_t *size);
+
+/* Hash of the structure and a bounded sample of the coordinates */
+uint64_t lwcache_key(const LWGEOM *geom);
+
+/* Same type, dimensions, SRID, structure and bit identical coordinates */
+int lwcache_geom_same(const LWGEOM *geom1, const LWGEOM *geom2);
+
+#endif /* _LWCACHE_H */
@@ -0,0 +1,226 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include "liblwgeom_internal.h"
+#include "lwcpu.h"
+
+#if defined(LWCPU_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#elif defined(LWCPU_X86)
+#include <cpuid.h>
+#endif
+
+static const LWCPU_KERNEL *lwcpu_kernels[] = {&gbox_minmax_kernels, &twkb_quantize_kernels};
+
+#define LWCPU_NUM_KERNELS (sizeof(lwcpu_kernels) / sizeof(lwcpu_kernels[0]))
+
+static const char *lwcpu_level_names[LW_CPU_NUM_LEVELS] = {"scalar", "sse2", "sse4.2", "avx2", "avx512", "neon"};
+
+static LW_CPU_LEVEL lwcpu_detected = LW_CPU_SCALAR;
+static LW_CPU_LEVEL lwcpu_active = LW_CPU_SCALAR;
+volatile int lwcpu_ready = LW_FALSE;
+
+#ifdef LWCPU_X86
+
+/* Registers of a cpuid leaf, zero when the leaf does not exist */
+static void
+lwcpu_cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+{
+#ifdef _MSC_VER
+	int r[4];
+	__cpuid(r, 0);
+	if ((uint32_t)r[0] < leaf)
+	{
+		regs[0] = regs[1] = regs[2] = regs[3] = 0;
+		return;
+	}
+	__cpuidex(r, (int)leaf, (int)subleaf);
+	regs[0] = r[0];
+	regs[1] = r[1];
+	regs[2] = r[2];
+	regs[3] = r[3];
+#else
+	if (__get_cpuid_max(0, NULL) < leaf)
+	{
+		regs[0] = regs[1] = regs[2] = regs[3] = 0;
+		return;
+	}
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/* Register state the operating system saves on context switches */
+static uint64_t
+lwcpu_xgetbv(void)
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	uint32_t eax, edx;
+	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+#define LWCPU_BIT(reg, bit) (((reg) >> (bit)) & 1)
+
+/*
+ * The levels follow the x86-64 microarchitecture levels: SSE4.2 is v2
+ * (SSSE3, SSE4.1, SSE4.2, POPCNT), AVX2 is v3 (AVX, AVX2, FMA, BMI1/2) and
+ * AVX-512 is v4 (F, CD, BW, DQ, VL). The wide registers also need the
+ * support of the operating system.
+ */
+static LW_CPU_LEVEL
+lwcpu_probe(void)
+{
+	uint32_t l1[4], l7[4];
+	uint64_t xcr0 = 0;
+	int sse2, sse42, avx2, avx512;
+
+	lwcpu_cpuid(1, 0, l1);
+	lwcpu_cpuid(7, 0, l7);
+	if (LWCPU_BIT(l1[2], 27)) /* OSXSAVE */
+		xcr0 = lwcpu_xgetbv();
+
+	sse2 = LWCPU_BIT(l1[3], 26);
+	sse42 = sse2 && LWCPU_BIT(l1[2], 9) && LWCPU_BIT(l1[2], 19) && LWCPU_BIT(l1[2], 20) && LWCPU_BIT(l1[2], 23);
+	avx2 = sse42 && (xcr0 & 0x6) == 0x6 && LWCPU_BIT(l1[2], 28) && LWCPU_BIT(l1[2], 12) &&
+	       LWCPU_BIT(l7[1], 5) && LWCPU_BIT(l7[1], 3) && LWCPU_BIT(l7[1], 8);
+	avx512 = avx2 && (xcr0 & 0xE6) == 0xE6 && LWCPU_BIT(l7[1], 16) && LWCPU_BIT(l7[1], 28) &&
+		 LWCPU_BIT(l7[1], 30) && LWCPU_BIT(l7[1], 17) && LWCPU_BIT(l7[1], 31);
+
+	if (avx512)
+		return LW_CPU_AVX512;
+	if (avx2)
+		return LW_CPU_AVX2;
+	if (sse42)
+		return LW_CPU_SSE42;
+	if (sse2)
+		return LW_CPU_SSE2;
+	return LW_CPU_SCALAR;
+}
+
+#else
+
+/* NEON is part of the baseline of the targets it is enabled for */
+static LW_CPU_LEVEL
+lwcpu_probe(void)
+{
+#ifdef LWCPU_NEON
+	return LW_CPU_NEON;
+#else
+	return LW_CPU_SCALAR;
+#endif
+}
+
+#endif /* LWCPU_X86 */
+
+/* The x86 levels include the lower ones, NEON only includes scalar */
+static int
+lwcpu_supports(LW_CPU_LEVEL level)
+{
+	if (level == LW_CPU_SCALAR || level == lwcpu_detected)
+		return LW_TRUE;
+	return lwcpu_detected != LW_CPU_NEON && level != LW_CPU_NEON && level < lwcpu_detected;
+}
+
+static void
+lwcpu_select(LW_CPU_LEVEL level)
+{
+	size_t i;
+
+	for (i = 0; i < LWCPU_NUM_KERNELS; i++)
+	{
+		const LWCPU_KERNEL *kernel = lwcpu_kernels[i];
+		lwcpu_function fn = NULL;
+		int l;
+
+		for (l = level; l >= 0 && !fn; l--)
+			if (lwcpu_supports((LW_CPU_LEVEL)l))
+				fn = kernel->variants[l];
+		*kernel->dispatch = fn;
+	}
+	lwcpu_active = level;
+}
+
+/* Threads racing here all store the same values */
+void
+lwcpu_init(void)
+{
+	if (lwcpu_ready)
+		return;
+	lwcpu_detected = lwcpu_probe();
+	lwcpu_select(lwcpu_detected);
+	lwcpu_ready = LW_TRUE;
+}
+
+LW_CPU_LEVEL
+lwcpu_detected_level(void)
+{
+	lwcpu_init();
+	return lwcpu_detected;
+}
+
+LW_CPU_LEVEL
+lwcpu_level(void)
+{
+	lwcpu_init();
+	return lwcpu_active;
+}
+
+int
+lwcpu_set_level(LW_CPU_LEVEL level)
+{
+	if (level < LW_CPU_SCALAR || level >= LW_CPU_NUM_LEVELS)
+	{
+		lwerror("%s: Unknown CPU level %d", __func__, (int)level);
+		return LW_FAILURE;
+	}
+	lwcpu_init();
+	if (!lwcpu_supports(level))
+		return LW_FAILURE;
+	lwcpu_select(level);
+	return LW_SUCCESS;
+}
+
+const char *
+lwcpu_level_name(LW_CPU_LEVEL level)
+{
+	if (level < LW_CPU_SCALAR || level >= LW_CPU_NUM_LEVELS)
+		return NULL;
+	return lwcpu_level_names[level];
+}
+
+int
+lwcpu_level_from_name(const char *name, LW_CPU_LEVEL *level)
+{
+	int l;
+
+	for (l = 0; name && l < LW_CPU_NUM_LEVELS; l++)
+	{
+		if (strcasecmp(name, lwcpu_level_names[l]) == 0)
+		{
+			*level = (LW_CPU_LEVEL)l;
+			return LW_SUCCESS;
+		}
+	}
+	return LW_FAILURE;
+}
@@ -0,0 +1,77 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#ifndef _LWCPU_H
+#define _LWCPU_H 1
+
+#include "liblwgeom.h"
+
+/*
+ * Runtime dispatch of the vectorized kernels.
+ *
+ * The library is built for the baseline instruction set. Kernel variants
+ * for wider ones are compiled with LWCPU_TARGET and only ever reached
+ * through a dispatch pointer, which lwcpu_select points at the widest
+ * variant the active level allows.
+ *
+ * To add a kernel, define its LWCPU_KERNEL next to its variants and list
+ * it in lwcpu_kernels (lwcpu.c). A level without a variant falls back to
+ * the next lower one. The LW_CPU_SCALAR variant may be NULL, for callers
+ * that run their plain C loop themselves when the pointer is NULL.
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LWCPU_X86 1
+#define LWCPU_TARGET(isa) __attribute__((target(isa)))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define LWCPU_X86 1
+#define LWCPU_TARGET(isa) /* MSVC emits any intrinsic without target flags */
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define LWCPU_NEON 1
+#endif
+
+typedef void (*lwcpu_function)(void);
+
+typedef struct
+{
+	const char *name;
+	lwcpu_function *dispatch;                   /* Pointer the kernel is called through */
+	lwcpu_function variants[LW_CPU_NUM_LEVELS]; /* Indexed by LW_CPU_LEVEL, NULL if none */
+} LWCPU_KERNEL;
+
+/* Kernels of the library, see lwcpu_kernels */
+extern const LWCPU_KERNEL gbox_minmax_kernels;
+extern const LWCPU_KERNEL twkb_quantize_kernels;
+
+/* Probe the processor and fill the dispatch pointers, once */
+void lwcpu_init(void);
+extern volatile int lwcpu_ready;
+
+/* To be called before reading a dispatch pointer */
+static inline void
+lwcpu_ensure(void)
+{
+	if (!lwcpu_ready)
+		lwcpu_init();
+}
+
+#endif /* _LWCPU_H */
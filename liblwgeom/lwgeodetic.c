@@ -26,6 +26,7 @@
 
 #include "liblwgeom_internal.h"
 #include "lwgeodetic.h"
+#include "lwgeodetic_tree.h"
 #include "lwgeom_log.h"
 
 /**
@@ -2195,13 +2196,36 @@ double lwgeom_azumith_spheroid(const LWPOINT *r, const LWPOINT *s, const SPHEROI
 	// return az;
 }
 
+/* Simple types, which the circ trees handle the same way as the loops below */
+static inline int
+lwgeom_circ_tree_type(uint8_t type)
+{
+	return type == POINTTYPE || type == LINETYPE || type == POLYGONTYPE ||
+	       type == MULTIPOINTTYPE || type == MULTILINETYPE || type == MULTIPOLYGONTYPE;
+}
+
 /**
 * Calculate the distance between two LWGEOMs, using the coordinates are
 * longitude and latitude. Return immediately when the calculated distance drops
 * below the tolerance (useful for dwithin calculations).
 * Return a negative distance for incalculable cases.
+*
+* Simple geometries with at least CIRC_TREE_CACHE_MIN_VERTICES vertices on
+* either side go through their cached circ tree, so repeated calls against
+* the same large geometry do not scan all of it every time.
 */
 double lwgeom_distance_spheroid(const LWGEOM *lwgeom1, const LWGEOM *lwgeom2, const SPHEROID *spheroid, double tolerance)
+{
+	if ( lwgeom_circ_tree_type(lwgeom1->type) && lwgeom_circ_tree_type(lwgeom2->type) &&
+	     ( lwgeom_count_vertices(lwgeom1) >= CIRC_TREE_CACHE_MIN_VERTICES ||
+	       lwgeom_count_vertices(lwgeom2) >= CIRC_TREE_CACHE_MIN_VERTICES ) )
+	{
+		return lwgeom_distance_spheroid_tree(lwgeom1, lwgeom2, spheroid, tolerance);
+	}
+	return lwgeom_distance_spheroid_uncached(lwgeom1, lwgeom2, spheroid, tolerance);
+}
+
+double lwgeom_distance_spheroid_uncached(const LWGEOM *lwgeom1, const LWGEOM *lwgeom2, const SPHEROID *spheroid, double tolerance)
 {
 	uint8_t type1, type2;
 	int check_intersection = LW_FALSE;
@@ -2427,7 +2451,22 @@ double lwgeom_distance_spheroid(const LWGEOM *lwgeom1, const LWGEOM *lwgeom2, co
 }
 
 
+/**
+* Points against a large (multi)polygon are tested on its cached circ tree,
+* other inputs by lwgeom_covers_lwgeom_sphere_uncached.
+*/
 int lwgeom_covers_lwgeom_sphere(const LWGEOM *lwgeom1, const LWGEOM *lwgeom2)
+{
+	if ( (lwgeom1->type == POLYGONTYPE || lwgeom1->type == MULTIPOLYGONTYPE) &&
+	     (lwgeom2->type == POINTTYPE || lwgeom2->type == MULTIPOINTTYPE) &&
+	     lwgeom_count_vertices(lwgeom1) >= CIRC_TREE_CACHE_MIN_VERTICES )
+	{
+		return lwgeom_covers_point_sphere_tree(lwgeom1, lwgeom2);
+	}
+	return lwgeom_covers_lwgeom_sphere_uncached(lwgeom1, lwgeom2);
+}
+
+int lwgeom_covers_lwgeom_sphere_uncached(const LWGEOM *lwgeom1, const LWGEOM *lwgeom2)
 {
 	int type1, type2;
 	GBOX gbox1, gbox2;
@@ -120,6 +120,9 @@ double edge_distance_to_edge(const GEOGRAPHIC_EDGE *e1, const GEOGRAPHIC_EDGE *e
 void geographic_point_init(double lon, double lat, GEOGRAPHIC_POINT *g);
 int ptarray_contains_point_sphere(const POINTARRAY *pa, const POINT2D *pt_outside, const POINT2D *pt_to_test);
 int lwpoly_covers_point2d(const LWPOLY *poly, const POINT2D *pt_to_test);
+/* The full scans of lwgeom_distance_spheroid and lwgeom_covers_lwgeom_sphere, without circ trees */
+double lwgeom_distance_spheroid_uncached(const LWGEOM *lwgeom1, const LWGEOM *lwgeom2, const SPHEROID *spheroid, double tolerance);
+int lwgeom_covers_lwgeom_sphere_uncached(const LWGEOM *lwgeom1, const LWGEOM *lwgeom2);
 int lwpoly_covers_lwpoly(const LWPOLY *lwpoly1, const LWPOLY *lwpoly2);
 int lwpoly_covers_pointarray(const LWPOLY* lwpoly, const POINTARRAY* pta);
 int lwpoly_covers_lwline(const LWPOLY *poly, const LWLINE *line);
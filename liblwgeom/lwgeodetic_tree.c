@@ -25,6 +25,7 @@
 
 #include "liblwgeom_internal.h"
 #include "lwgeodetic_tree.h"
+#include "lwcache.h"
 #include "lwgeom_log.h"
 
 
@@ -489,6 +490,8 @@ int circ_tree_get_point_outside(const CIRC_NODE* node, POINT2D* pt)
 /**
 * Walk the tree and count intersections between the stab line and the edges.
 * odd => containment, even => no containment.
+* When on_boundary is not NULL it is set to LW_TRUE if the point lies on
+* one of the edges, it is left alone otherwise.
 * KNOWN PROBLEM: Grazings (think of a sharp point, just touching the
 *   stabline) will be counted for one, which will throw off the count.
 */
@@ -551,6 +554,13 @@ int circ_tree_contains_point(const CIRC_NODE* node, const POINT2D* pt, const POI
 					rad2deg(e2.lon), rad2deg(e2.lat)
 					);
 
+				/* The stab line starts on the edge, so the point is on the boundary */
+				if ( on_boundary && (inter & PIR_A_TOUCH_RIGHT || inter & PIR_A_TOUCH_LEFT) )
+				{
+					LWDEBUGF(3,"%*s ::point is on this edge", level, "");
+					*on_boundary = LW_TRUE;
+				}
+
 				if ( inter & PIR_B_TOUCH_RIGHT || inter & PIR_COLINEAR )
 				{
 					LWDEBUGF(3,"%*s ::rejecting stab line grazing by left-side edge", level, "");
@@ -998,6 +1008,16 @@ lwcollection_calculate_circ_tree(const LWCOLLECTION* lwcol)
 	/* Don't need the working list any more */
 	lwfree(nodes);
 	node->geom_type = lwgeom_get_type((LWGEOM*)lwcol);
+
+	/* Outside point for P-i-P tests against the whole areal tree */
+	if ( node->geom_type == MULTIPOLYGONTYPE )
+	{
+		GBOX gbox;
+		gbox_init(&gbox);
+		if ( lwgeom_calculate_gbox_geodetic((LWGEOM*)lwcol, &gbox) == LW_FAILURE ||
+		     gbox_pt_outside(&gbox, &(node->pt_outside)) == LW_FAILURE )
+			circ_tree_get_point_outside(node, &(node->pt_outside));
+	}
 	return node;
 }
 
@@ -1106,3 +1126,209 @@ geography_tree_shortestline(const LWGEOM* lwgeom1, const LWGEOM* lwgeom2, double
   circ_tree_free(circ_tree2);
   return result;
 }
+
+
+/***********************************************************************
+ * Cross-call cache of circ trees, one per LWGEOM_CONTEXT (see lwcache.h).
+ *
+ * Trees point into the point arrays of their geometry, so they are built
+ * on the deep copy owned by the cache entry; callers can free their own
+ * copy as soon as the call returns. Entries are built in a heap scope, so
+ * an active arena does not reclaim them.
+ ***********************************************************************/
+
+struct CIRC_TREE_CACHE
+{
+	LWCACHE cache;
+};
+
+static void
+circ_tree_cache_release(void *tree)
+{
+	circ_tree_free(tree);
+}
+
+CIRC_NODE *
+circ_tree_cache_get(const LWGEOM *lwgeom)
+{
+	LWGEOM_CONTEXT *ctx = lwcontext();
+	CIRC_TREE_CACHE *cache = ctx->circ_tree_cache;
+	LWARENA_SCOPE scope;
+	CIRC_NODE *tree;
+	LWGEOM *copy;
+	uint64_t key;
+
+	if (!cache)
+	{
+		cache = lwalloc_heap(sizeof(CIRC_TREE_CACHE));
+		lwcache_init(&cache->cache, CIRC_TREE_CACHE_ITEMS, circ_tree_cache_release);
+		ctx->circ_tree_cache = cache;
+	}
+
+	if ((tree = lwcache_find(&cache->cache, lwgeom, &key)))
+		return tree;
+
+	lwarena_push(NULL, &scope);
+	copy = lwgeom_clone_deep(lwgeom);
+	tree = lwgeom_calculate_circ_tree(copy);
+	lwarena_pop(&scope);
+
+	if (!tree)
+	{
+		/* Empty, nothing worth keeping */
+		lwgeom_free(copy);
+		return NULL;
+	}
+	lwcache_add(&cache->cache, key, lwgeom, copy, tree);
+	return tree;
+}
+
+void
+circ_tree_cache_flush(void)
+{
+	CIRC_TREE_CACHE *cache = lwcontext()->circ_tree_cache;
+	if (cache)
+		lwcache_flush(&cache->cache);
+}
+
+void
+circ_tree_cache_stats(uint64_t *hits, uint64_t *misses, uint32_t *size)
+{
+	CIRC_TREE_CACHE *cache = lwcontext()->circ_tree_cache;
+	lwcache_stats(cache ? &cache->cache : NULL, hits, misses, size);
+}
+
+void
+circ_tree_cache_destroy(void)
+{
+	LWGEOM_CONTEXT *ctx = lwcontext();
+	if (!ctx->circ_tree_cache)
+		return;
+	circ_tree_cache_flush();
+	lwfree_heap(ctx->circ_tree_cache);
+	ctx->circ_tree_cache = NULL;
+}
+
+/*
+* Small inputs (typically the probe points) get a throw-away tree, so
+* they cannot evict the large geometries the cache is meant for.
+*/
+static CIRC_NODE *
+circ_tree_cached_or_new(const LWGEOM *lwgeom, int *is_temporary)
+{
+	if (lwgeom_count_vertices(lwgeom) < CIRC_TREE_CACHE_MIN_VERTICES)
+	{
+		*is_temporary = LW_TRUE;
+		return lwgeom_calculate_circ_tree(lwgeom);
+	}
+	*is_temporary = LW_FALSE;
+	return circ_tree_cache_get(lwgeom);
+}
+
+int
+circ_tree_covers_point(const CIRC_NODE *tree, const POINT2D *pt)
+{
+	GEOGRAPHIC_POINT gpt;
+	int on_boundary = LW_FALSE;
+
+	if ( ! tree || (tree->geom_type != POLYGONTYPE && tree->geom_type != MULTIPOLYGONTYPE) )
+		return LW_FALSE;
+
+	/* Outside the bounding cap of the root? Done! */
+	geographic_point_init(pt->x, pt->y, &gpt);
+	if ( FP_GT(sphere_distance(&(tree->center), &gpt), tree->radius) )
+		return LW_FALSE;
+
+	if ( circ_tree_contains_point(tree, pt, &(tree->pt_outside), 0, &on_boundary) )
+		return LW_TRUE;
+	return on_boundary;
+}
+
+double
+circ_tree_distance_spheroid(const CIRC_NODE *n1, const CIRC_NODE *n2, const SPHEROID *spheroid, double tolerance)
+{
+	POINT2D pt1, pt2;
+
+	/* A vertex of either one inside the other one is zero distance */
+	circ_tree_get_point(n1, &pt1);
+	circ_tree_get_point(n2, &pt2);
+	if ( circ_tree_covers_point(n1, &pt2) || circ_tree_covers_point(n2, &pt1) )
+		return 0.0;
+
+	return circ_tree_distance_tree(n1, n2, spheroid, tolerance);
+}
+
+double
+lwgeom_distance_spheroid_tree(const LWGEOM *lwgeom1, const LWGEOM *lwgeom2, const SPHEROID *spheroid, double tolerance)
+{
+	int tmp1, tmp2;
+	CIRC_NODE *n1, *n2;
+	double distance;
+
+	/* Same convention as lwgeom_distance_spheroid */
+	if ( lwgeom_is_empty(lwgeom1) || lwgeom_is_empty(lwgeom2) )
+		return -1.0;
+
+	n1 = circ_tree_cached_or_new(lwgeom1, &tmp1);
+	n2 = circ_tree_cached_or_new(lwgeom2, &tmp2);
+	distance = circ_tree_distance_spheroid(n1, n2, spheroid, tolerance);
+	if (tmp1)
+		circ_tree_free(n1);
+	if (tmp2)
+		circ_tree_free(n2);
+	return distance;
+}
+
+int
+lwgeom_dwithin_spheroid_tree(const LWGEOM *lwgeom1, const LWGEOM *lwgeom2, const SPHEROID *spheroid, double tolerance)
+{
+	double distance;
+
+	if ( lwgeom_is_empty(lwgeom1) || lwgeom_is_empty(lwgeom2) )
+		return LW_FALSE;
+
+	distance = lwgeom_distance_spheroid_tree(lwgeom1, lwgeom2, spheroid, tolerance);
+	return distance >= 0.0 && distance <= tolerance;
+}
+
+int
+lwgeom_covers_point_sphere_tree(const LWGEOM *lwgeom1, const LWGEOM *lwgeom2)
+{
+	int tmp;
+	CIRC_NODE *tree;
+	int result = LW_TRUE;
+	uint32_t i;
+
+	if ( lwgeom_is_empty(lwgeom1) || lwgeom_is_empty(lwgeom2) )
+		return LW_FALSE;
+
+	if ( lwgeom2->type != POINTTYPE && lwgeom2->type != MULTIPOINTTYPE )
+	{
+		lwerror("%s: expected a point or multipoint, got %s", __func__, lwtype_name(lwgeom2->type));
+		return LW_FALSE;
+	}
+
+	tree = circ_tree_cached_or_new(lwgeom1, &tmp);
+	if ( lwgeom2->type == POINTTYPE )
+	{
+		POINT2D pt;
+		getPoint2d_p(((LWPOINT*)lwgeom2)->point, 0, &pt);
+		result = circ_tree_covers_point(tree, &pt);
+	}
+	else
+	{
+		const LWMPOINT *mpoint = (const LWMPOINT*)lwgeom2;
+		for ( i = 0; i < mpoint->ngeoms && result; i++ )
+		{
+			POINT2D pt;
+			if ( lwpoint_is_empty(mpoint->geoms[i]) )
+				continue;
+			getPoint2d_p(mpoint->geoms[i]->point, 0, &pt);
+			result = circ_tree_covers_point(tree, &pt);
+		}
+	}
+
+	if (tmp)
+		circ_tree_free(tree);
+	return result;
+}
@@ -59,6 +59,50 @@ int circ_tree_get_point_outside(const CIRC_NODE* node, POINT2D* pt);
 LWGEOM * geography_tree_closestpoint(const LWGEOM* g1, const LWGEOM* g2, double threshold);
 LWGEOM * geography_tree_shortestline(const LWGEOM* g1, const LWGEOM* g2, double threshold, const SPHEROID *spheroid);
 
+/**
+* Is pt inside or on the boundary of the (multi)polygon tree? Trees of
+* other types never cover anything.
+*/
+int circ_tree_covers_point(const CIRC_NODE* tree, const POINT2D* pt);
+
+/**
+* Spheroid distance between the shapes of two trees, zero when one of them
+* covers a vertex of the other. Trees built once with
+* lwgeom_calculate_circ_tree can be queried any number of times.
+*/
+double circ_tree_distance_spheroid(const CIRC_NODE* n1, const CIRC_NODE* n2, const SPHEROID *spheroid, double tolerance);
+
+/* Geometries with fewer vertices are not worth caching */
+#define CIRC_TREE_CACHE_MIN_VERTICES 64
+
+/**
+* Circ tree of geom from the per context LRU cache, built on a private
+* copy of the geometry on a miss. Owned by the cache: do not free it, and
+* do not keep it across other cache calls, which may evict it.
+* NULL for empty geometries.
+*/
+CIRC_NODE* circ_tree_cache_get(const LWGEOM* geom);
+void circ_tree_cache_flush(void);
+void circ_tree_cache_stats(uint64_t *hits, uint64_t *misses, uint32_t *size);
+void circ_tree_cache_destroy(void);
+
+/**
+* Geodetic distance, dwithin and point coverage through cached circ trees:
+* inputs with at least CIRC_TREE_CACHE_MIN_VERTICES vertices keep their
+* tree between calls, smaller ones get a temporary tree.
+* The distance is the spheroid distance between the closest points on the
+* sphere, -1.0 for empty inputs, like lwgeom_distance_spheroid. Searches
+* stop early once the distance is known to be under the tolerance.
+*/
+double lwgeom_distance_spheroid_tree(const LWGEOM* g1, const LWGEOM* g2, const SPHEROID* spheroid, double tolerance);
+int lwgeom_dwithin_spheroid_tree(const LWGEOM* g1, const LWGEOM* g2, const SPHEROID* spheroid, double tolerance);
+
+/**
+* Does the (multi)polygon g1 cover every point of the (multi)point g2?
+* Points on the boundary are covered.
+*/
+int lwgeom_covers_point_sphere_tree(const LWGEOM* g1, const LWGEOM* g2);
+
 
 #endif /* _LWGEODETIC_TREE_H */
 
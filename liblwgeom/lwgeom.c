@@ -1158,6 +1158,9 @@ void lwgeom_free(LWGEOM *lwgeom)
 	/* There's nothing here to free... */
 	if( ! lwgeom ) return;
 
+	/* Arena memory goes away with its scope, skip the walk */
+	if (lwarena_owner(lwgeom)) return;
+
 	LWDEBUGF(5,"freeing a %s",lwtype_name(lwgeom->type));
 
 	switch (lwgeom->type)
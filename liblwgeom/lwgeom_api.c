@@ -370,6 +370,7 @@ ptarray_set_point4d(POINTARRAY *pa, uint32_t n, const POINT4D *p4d)
 {
 	uint8_t *ptr;
 	assert(n < pa->npoints);
+	ptarray_make_writable(pa);
 	ptr = getPoint_internal(pa, n);
 	switch ( FLAGS_GET_ZM(pa->flags) )
 	{
@@ -394,6 +395,7 @@ void
 ptarray_copy_point(POINTARRAY *pa, uint32_t from, uint32_t to)
 {
 	int ndims = FLAGS_NDIMS(pa->flags);
+	ptarray_make_writable(pa);
 	switch (ndims)
 	{
 		case 2:
@@ -47,6 +47,24 @@ int union_intersecting_pairs(GEOSGeometry** geoms, uint32_t num_geoms, UNIONFIND
 int cluster_within_distance(LWGEOM **geoms, uint32_t num_geoms, double tolerance, LWGEOM ***clusterGeoms, uint32_t *num_clusters);
 int union_dbscan(LWGEOM **geoms, uint32_t num_geoms, UNIONFIND *uf, double eps, uint32_t min_points, char **is_in_cluster_ret);
 
+/* Fewer geometries per thread are not worth the thread start up */
+#define LW_CLUSTER_PARALLEL_MIN_GEOMS 4096
+
+/*
+** Same, with the tree queries and the predicates spread over up to nthreads
+** threads (0 for one per processor). The clusters, and their ids, are the
+** same as with the single threaded versions.
+**
+** With DBSCAN, and so within distance clustering, every cluster has its
+** lowest input as UNIONFIND root, so the cluster ids are numbered in the
+** order of the lowest input of every cluster. Points with min_points 1
+** are clustered on a grid, single threaded or not, with the same ids.
+*/
+int cluster_intersecting_parallel(GEOSGeometry **geoms, uint32_t num_geoms, GEOSGeometry ***clusterGeoms, uint32_t *num_clusters, uint32_t nthreads);
+int union_intersecting_pairs_parallel(GEOSGeometry **geoms, uint32_t num_geoms, UNIONFIND *uf, uint32_t nthreads);
+int cluster_within_distance_parallel(LWGEOM **geoms, uint32_t num_geoms, double tolerance, LWGEOM ***clusterGeoms, uint32_t *num_clusters, uint32_t nthreads);
+int union_dbscan_parallel(LWGEOM **geoms, uint32_t num_geoms, UNIONFIND *uf, double eps, uint32_t min_points, char **is_in_cluster_ret, uint32_t nthreads);
+
 POINTARRAY* ptarray_from_GEOSCoordSeq(const GEOSCoordSequence* cs, uint8_t want3d);
 
 //extern char lwgeom_geos_errmsg[];
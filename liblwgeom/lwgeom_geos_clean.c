@@ -125,6 +125,7 @@ ptarray_strip_nan_coords_in_place(POINTARRAY *pa)
 	uint32_t i, j = 0;
 	POINT4D *p, *np;
 	int ndims = FLAGS_NDIMS(pa->flags);
+	ptarray_make_writable(pa);
 	for ( i = 0; i < pa->npoints; i++ )
 	{
 		int isnan = 0;
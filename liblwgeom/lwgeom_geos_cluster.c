@@ -28,6 +28,9 @@
 #include "lwgeom_log.h"
 #include "lwgeom_geos.h"
 #include "lwunionfind.h"
+#include "lwthread.h"
+
+#include <stdlib.h>
 
 static const int STRTREE_NODE_CAPACITY = 10;
 
@@ -52,6 +55,11 @@ static struct STRTree make_strtree(void** geoms, uint32_t num_geoms, char is_lwg
 static void destroy_strtree(struct STRTree * tree);
 static int combine_geometries(UNIONFIND* uf, void** geoms, uint32_t num_geoms, void*** clustersGeoms, uint32_t* num_clusters, char is_lwgeom);
 
+/* Points hashed on a uniform grid, see cluster_grid_create */
+typedef struct CLUSTER_GRID CLUSTER_GRID;
+static CLUSTER_GRID *cluster_grid_create(LWGEOM **geoms, uint32_t num_geoms, double eps);
+static int union_dbscan_grid(CLUSTER_GRID *grid, LWGEOM **geoms, uint32_t num_geoms, UNIONFIND *uf, double eps, char **in_a_cluster_ret, uint32_t nthreads);
+
 /* Make a minimal GEOSGeometry* whose Envelope covers the same 2D extent as
  * the supplied GBOX.  This is faster and uses less memory than building a
  * five-point polygon with GBOX2GEOS.
@@ -527,10 +535,21 @@ union_dbscan_general(LWGEOM** geoms, uint32_t num_geoms, UNIONFIND* uf, double e
 
 int union_dbscan(LWGEOM** geoms, uint32_t num_geoms, UNIONFIND* uf, double eps, uint32_t min_points, char** in_a_cluster_ret)
 {
-	if (min_points <= 1)
-		return union_dbscan_minpoints_1(geoms, num_geoms, uf, eps, in_a_cluster_ret);
+	CLUSTER_GRID* grid;
+	int success;
+
+	/* Points go on the grid, which needs no GEOS tree */
+	if (min_points <= 1 && (grid = cluster_grid_create(geoms, num_geoms, eps)))
+		success = union_dbscan_grid(grid, geoms, num_geoms, uf, eps, in_a_cluster_ret, 1);
+	else if (min_points <= 1)
+		success = union_dbscan_minpoints_1(geoms, num_geoms, uf, eps, in_a_cluster_ret);
 	else
-		return union_dbscan_general(geoms, num_geoms, uf, eps, min_points, in_a_cluster_ret);
+		success = union_dbscan_general(geoms, num_geoms, uf, eps, min_points, in_a_cluster_ret);
+
+	/* Roots, hence ids, independent of the path and of the order of the unions */
+	if (success == LW_SUCCESS)
+		UF_normalize(uf);
+	return success;
 }
 
 /** Takes an array of LWGEOM* and constructs an array of LWGEOM*, where each element in the constructed array is a
@@ -553,6 +572,1074 @@ cluster_within_distance(LWGEOM** geoms, uint32_t num_geoms, double tolerance, LW
 	return cluster_success;
 }
 
+/*
+ * Parallel clustering.
+ *
+ * The geometries are handled in blocks. Within a block, workers run the
+ * tree queries and evaluate the predicates, each with its own GEOS handle,
+ * and record for every geometry the neighbours it has to be merged with,
+ * in query order. The calling thread then replays the merges in the order
+ * of the sequential loops above, so the UNIONFIND ends up with the same
+ * roots and the cluster ids do not depend on the number of threads.
+ *
+ * Workers only read the UNIONFIND as it was at the start of the block:
+ * pairs already in the same cluster by then are skipped, as the sequential
+ * loop would skip them. Distances between points are computed by the
+ * workers; other pairs need lwgeom_mindistance2d_tolerance, which may
+ * allocate, so they are left to the replay, which only computes the ones
+ * the sequential loop would have computed. Workers must not go through
+ * lwalloc, their buffers come from malloc.
+ */
+
+/* Geometries per block, bounds the memory of the recorded neighbours */
+#define CLUSTER_BLOCK_SIZE 65536
+/* Consecutive geometries per chunk, chunks of a block go to the workers in turn */
+#define CLUSTER_CHUNK_SIZE 256
+
+typedef enum
+{
+	CLUSTER_PAIR_NONE,      /* Not a neighbour, not recorded */
+	CLUSTER_PAIR_MATCH,     /* Neighbour */
+	CLUSTER_PAIR_UNDECIDED, /* Distance left to the replay */
+	CLUSTER_PAIR_ERROR      /* GEOS failed on the pair */
+} CLUSTER_PAIR_STATE;
+
+typedef struct
+{
+	uint32_t q;
+	uint32_t state;
+} CLUSTER_PAIR;
+
+typedef struct
+{
+	GEOSContextHandle_t handle;
+	/* Tree query results, reused for every geometry */
+	uint32_t *found;
+	uint32_t found_size;
+	uint32_t num_found;
+	/* Pairs recorded in the current block */
+	CLUSTER_PAIR *pairs;
+	size_t pairs_size;
+	size_t num_pairs;
+	/* Merges seen by a grid worker in the current block, see dbscan_grid_worker */
+	uint32_t *merged; /* Open addressing table of (root, parent) pairs */
+	uint32_t merged_bits;
+	uint32_t num_merged;
+	int failed;
+} CLUSTER_WORKER;
+
+typedef struct
+{
+	void **geoms;
+	GEOSSTRtree *tree;
+	const UNIONFIND *uf;
+	double eps;
+	uint32_t min_points;
+	uint32_t block_start;
+	uint32_t block_end;
+	/* Per geometry of the block, its recorded pairs in the buffer of its worker */
+	size_t *first;
+	uint32_t *count;
+	CLUSTER_WORKER *workers;
+	uint32_t num_workers;
+	/* Neighbours come from the grid rather than the tree, workers do not need GEOS */
+	const CLUSTER_GRID *grid;
+} CLUSTER_JOB;
+
+typedef int (*cluster_replay)(CLUSTER_JOB *job, void *state);
+
+/* Root of i, without the path compression of UF_find: safe to share between threads */
+static inline uint32_t
+cluster_uf_root(const UNIONFIND *uf, uint32_t i)
+{
+	while (uf->clusters[i] != i)
+		i = uf->clusters[i];
+	return i;
+}
+
+static inline CLUSTER_WORKER *
+cluster_job_worker(const CLUSTER_JOB *job, uint32_t p)
+{
+	return &job->workers[((p - job->block_start) / CLUSTER_CHUNK_SIZE) % job->num_workers];
+}
+
+static void
+cluster_worker_accumulate(void *item, void *userdata)
+{
+	CLUSTER_WORKER *w = userdata;
+	if (w->num_found == w->found_size)
+	{
+		uint32_t size = w->found_size ? 2 * w->found_size : 64;
+		uint32_t *found = realloc(w->found, size * sizeof(uint32_t));
+		if (!found)
+		{
+			w->failed = LW_TRUE;
+			return;
+		}
+		w->found = found;
+		w->found_size = size;
+	}
+	w->found[w->num_found++] = *((uint32_t *)item);
+}
+
+static void
+cluster_worker_record(CLUSTER_WORKER *w, uint32_t q, CLUSTER_PAIR_STATE state)
+{
+	if (w->num_pairs == w->pairs_size)
+	{
+		size_t size = w->pairs_size ? 2 * w->pairs_size : 1024;
+		CLUSTER_PAIR *pairs = realloc(w->pairs, size * sizeof(CLUSTER_PAIR));
+		if (!pairs)
+		{
+			w->failed = LW_TRUE;
+			return;
+		}
+		w->pairs = pairs;
+		w->pairs_size = size;
+	}
+	w->pairs[w->num_pairs].q = q;
+	w->pairs[w->num_pairs].state = state;
+	w->num_pairs++;
+}
+
+/* make_geos_segment, on the GEOS handle of a worker */
+static GEOSGeometry *
+cluster_geos_segment(GEOSContextHandle_t handle, double x1, double y1, double x2, double y2)
+{
+	GEOSCoordSequence *seq = GEOSCoordSeq_create_r(handle, 2, 2);
+	GEOSGeometry *geom = NULL;
+
+	if (!seq)
+		return NULL;
+
+#if POSTGIS_GEOS_VERSION < 30800
+	GEOSCoordSeq_setX_r(handle, seq, 0, x1);
+	GEOSCoordSeq_setY_r(handle, seq, 0, y1);
+	GEOSCoordSeq_setX_r(handle, seq, 1, x2);
+	GEOSCoordSeq_setY_r(handle, seq, 1, y2);
+#else
+	GEOSCoordSeq_setXY_r(handle, seq, 0, x1, y1);
+	GEOSCoordSeq_setXY_r(handle, seq, 1, x2, y2);
+#endif
+
+	geom = GEOSGeom_createLineString_r(handle, seq);
+	if (!geom)
+		GEOSCoordSeq_destroy_r(handle, seq);
+	return geom;
+}
+
+/* Same candidates, in the same order, as dbscan_update_context */
+static int
+dbscan_worker_query(CLUSTER_JOB *job, CLUSTER_WORKER *w, uint32_t p)
+{
+	LWGEOM **geoms = (LWGEOM **)job->geoms;
+	GEOSGeometry *query_envelope;
+	double eps = job->eps;
+
+	w->num_found = 0;
+	if (geoms[p]->type == POINTTYPE)
+	{
+		const POINT2D *pt = getPoint2d_cp(lwgeom_as_lwpoint(geoms[p])->point, 0);
+		query_envelope = cluster_geos_segment(w->handle, pt->x - eps, pt->y - eps, pt->x + eps, pt->y + eps);
+	}
+	else
+	{
+		const GBOX *box = lwgeom_get_bbox(geoms[p]);
+		query_envelope =
+		    cluster_geos_segment(w->handle, box->xmin - eps, box->ymin - eps, box->xmax + eps, box->ymax + eps);
+	}
+
+	if (!query_envelope)
+	{
+		w->failed = LW_TRUE;
+		return LW_FAILURE;
+	}
+
+	GEOSSTRtree_query_r(w->handle, job->tree, query_envelope, &cluster_worker_accumulate, w);
+	GEOSGeom_destroy_r(w->handle, query_envelope);
+	return w->failed ? LW_FAILURE : LW_SUCCESS;
+}
+
+/* Points are decided here, with the arithmetic of lw_dist2d_pt_pt */
+static CLUSTER_PAIR_STATE
+dbscan_worker_pair(const LWGEOM *g1, const LWGEOM *g2, double eps)
+{
+	if (g1->type == POINTTYPE && g2->type == POINTTYPE && !lwgeom_is_empty(g2))
+	{
+		const POINT2D *p1 = getPoint2d_cp(lwgeom_as_lwpoint(g1)->point, 0);
+		const POINT2D *p2 = getPoint2d_cp(lwgeom_as_lwpoint(g2)->point, 0);
+		double hside = p2->x - p1->x;
+		double vside = p2->y - p1->y;
+		double dist = sqrt(hside * hside + vside * vside);
+
+		if (dist < FLT_MAX)
+			return dist <= eps ? CLUSTER_PAIR_MATCH : CLUSTER_PAIR_NONE;
+	}
+	return CLUSTER_PAIR_UNDECIDED;
+}
+
+static void
+dbscan_worker(void *arg, uint32_t worker)
+{
+	CLUSTER_JOB *job = arg;
+	CLUSTER_WORKER *w = &job->workers[worker];
+	LWGEOM **geoms = (LWGEOM **)job->geoms;
+	uint32_t chunk, stride = job->num_workers * CLUSTER_CHUNK_SIZE;
+
+	w->num_pairs = 0;
+	for (chunk = job->block_start + worker * CLUSTER_CHUNK_SIZE; chunk < job->block_end && !w->failed;
+	     chunk += stride)
+	{
+		uint32_t p, i;
+		uint32_t end = job->block_end - chunk < CLUSTER_CHUNK_SIZE ? job->block_end : chunk + CLUSTER_CHUNK_SIZE;
+
+		for (p = chunk; p < end && !w->failed; p++)
+		{
+			uint32_t slot = p - job->block_start;
+			uint32_t root = cluster_uf_root(job->uf, p);
+
+			job->first[slot] = w->num_pairs;
+			job->count[slot] = 0;
+
+			if (lwgeom_is_empty(geoms[p]))
+				continue;
+			if (dbscan_worker_query(job, w, p) == LW_FAILURE)
+				break;
+
+			/* Not enough candidates to do anything (general case only) */
+			if (w->num_found < job->min_points)
+				continue;
+
+			for (i = 0; i < w->num_found; i++)
+			{
+				uint32_t q = w->found[i];
+				CLUSTER_PAIR_STATE state;
+
+				if (job->min_points <= 1 && root == cluster_uf_root(job->uf, q))
+					continue;
+
+				state = dbscan_worker_pair(geoms[p], geoms[q], job->eps);
+				if (state != CLUSTER_PAIR_NONE)
+					cluster_worker_record(w, q, state);
+			}
+			job->count[slot] = w->num_pairs - job->first[slot];
+		}
+	}
+}
+
+/* Replay of the inner loop of union_dbscan_minpoints_1 */
+static int
+dbscan_replay_minpoints_1(CLUSTER_JOB *job, __attribute__((__unused__)) void *state)
+{
+	LWGEOM **geoms = (LWGEOM **)job->geoms;
+	UNIONFIND *uf = (UNIONFIND *)job->uf;
+	uint32_t p, i;
+
+	for (p = job->block_start; p < job->block_end; p++)
+	{
+		uint32_t slot = p - job->block_start;
+		const CLUSTER_PAIR *pairs = cluster_job_worker(job, p)->pairs + job->first[slot];
+
+		for (i = 0; i < job->count[slot]; i++)
+		{
+			uint32_t q = pairs[i].q;
+
+			if (UF_find(uf, p) != UF_find(uf, q))
+			{
+				if (pairs[i].state == CLUSTER_PAIR_UNDECIDED)
+				{
+					double mindist = lwgeom_mindistance2d_tolerance(geoms[p], geoms[q], job->eps);
+					if (mindist == FLT_MAX)
+						return LW_FAILURE;
+					if (mindist > job->eps)
+						continue;
+				}
+				UF_union(uf, p, q);
+			}
+		}
+	}
+	return LW_SUCCESS;
+}
+
+typedef struct
+{
+	char *in_a_cluster;
+	char *is_in_core;
+	uint32_t *neighbors;
+} DBSCAN_REPLAY_STATE;
+
+/* Replay of the inner loop of union_dbscan_general */
+static int
+dbscan_replay_general(CLUSTER_JOB *job, void *state)
+{
+	DBSCAN_REPLAY_STATE *st = state;
+	LWGEOM **geoms = (LWGEOM **)job->geoms;
+	UNIONFIND *uf = (UNIONFIND *)job->uf;
+	uint32_t min_points = job->min_points;
+	uint32_t p, i;
+
+	for (p = job->block_start; p < job->block_end; p++)
+	{
+		uint32_t slot = p - job->block_start;
+		const CLUSTER_PAIR *pairs = cluster_job_worker(job, p)->pairs + job->first[slot];
+		uint32_t num_neighbors = 0;
+
+		for (i = 0; i < job->count[slot]; i++)
+		{
+			uint32_t q = pairs[i].q;
+
+			if (num_neighbors >= min_points)
+			{
+				if (UF_find(uf, p) == UF_find(uf, q))
+					continue;
+				if (st->in_a_cluster[q] && !st->is_in_core[q])
+					continue;
+			}
+
+			if (pairs[i].state == CLUSTER_PAIR_UNDECIDED)
+			{
+				double mindist = lwgeom_mindistance2d_tolerance(geoms[p], geoms[q], job->eps);
+				if (mindist == FLT_MAX)
+					return LW_FAILURE;
+				if (mindist > job->eps)
+					continue;
+			}
+
+			if (num_neighbors < min_points)
+			{
+				st->neighbors[num_neighbors++] = q;
+				if (num_neighbors == min_points)
+				{
+					uint32_t j;
+					st->is_in_core[p] = LW_TRUE;
+					st->in_a_cluster[p] = LW_TRUE;
+					for (j = 0; j < num_neighbors; j++)
+						union_if_available(uf, p, st->neighbors[j], st->is_in_core, st->in_a_cluster);
+				}
+			}
+			else
+			{
+				union_if_available(uf, p, q, st->is_in_core, st->in_a_cluster);
+			}
+		}
+	}
+	return LW_SUCCESS;
+}
+
+static void
+intersecting_worker(void *arg, uint32_t worker)
+{
+	CLUSTER_JOB *job = arg;
+	CLUSTER_WORKER *w = &job->workers[worker];
+	GEOSGeometry **geoms = (GEOSGeometry **)job->geoms;
+	GEOSContextHandle_t handle = w->handle;
+	uint32_t chunk, stride = job->num_workers * CLUSTER_CHUNK_SIZE;
+
+	w->num_pairs = 0;
+	for (chunk = job->block_start + worker * CLUSTER_CHUNK_SIZE; chunk < job->block_end && !w->failed;
+	     chunk += stride)
+	{
+		uint32_t p, i;
+		uint32_t end = job->block_end - chunk < CLUSTER_CHUNK_SIZE ? job->block_end : chunk + CLUSTER_CHUNK_SIZE;
+
+		for (p = chunk; p < end && !w->failed; p++)
+		{
+			uint32_t slot = p - job->block_start;
+			uint32_t root = cluster_uf_root(job->uf, p);
+			const GEOSPreparedGeometry *prep = NULL;
+
+			job->first[slot] = w->num_pairs;
+			job->count[slot] = 0;
+
+			if (!geoms[p] || GEOSisEmpty_r(handle, geoms[p]))
+				continue;
+
+			w->num_found = 0;
+			GEOSSTRtree_query_r(handle, job->tree, geoms[p], &cluster_worker_accumulate, w);
+
+			for (i = 0; i < w->num_found && !w->failed; i++)
+			{
+				uint32_t q = w->found[i];
+				int geos_type, geos_result;
+
+				if (p == q || root == cluster_uf_root(job->uf, q))
+					continue;
+
+				/* Same choice as union_intersecting_pairs, see #3433 */
+				geos_type = GEOSGeomTypeId_r(handle, geoms[p]);
+				if (geos_type != GEOS_POINT && geos_type != GEOS_MULTIPOINT)
+				{
+					if (prep == NULL)
+						prep = GEOSPrepare_r(handle, geoms[p]);
+					geos_result = GEOSPreparedIntersects_r(handle, prep, geoms[q]);
+				}
+				else
+				{
+					geos_result = GEOSIntersects_r(handle, geoms[p], geoms[q]);
+				}
+
+				/* Errors only count if the replay gets to the pair */
+				if (geos_result > 1)
+					cluster_worker_record(w, q, CLUSTER_PAIR_ERROR);
+				else if (geos_result)
+					cluster_worker_record(w, q, CLUSTER_PAIR_MATCH);
+			}
+
+			if (prep)
+				GEOSPreparedGeom_destroy_r(handle, prep);
+			job->count[slot] = w->num_pairs - job->first[slot];
+		}
+	}
+}
+
+/* Replay of the inner loop of union_intersecting_pairs */
+static int
+intersecting_replay(CLUSTER_JOB *job, __attribute__((__unused__)) void *state)
+{
+	UNIONFIND *uf = (UNIONFIND *)job->uf;
+	uint32_t p, i;
+
+	for (p = job->block_start; p < job->block_end; p++)
+	{
+		uint32_t slot = p - job->block_start;
+		const CLUSTER_PAIR *pairs = cluster_job_worker(job, p)->pairs + job->first[slot];
+
+		for (i = 0; i < job->count[slot]; i++)
+		{
+			if (UF_find(uf, p) == UF_find(uf, pairs[i].q))
+				continue;
+			if (pairs[i].state == CLUSTER_PAIR_ERROR)
+				return LW_FAILURE;
+			UF_union(uf, p, pairs[i].q);
+		}
+	}
+	return LW_SUCCESS;
+}
+
+static void
+cluster_noop_accumulate(__attribute__((__unused__)) void *item, __attribute__((__unused__)) void *userdata)
+{
+}
+
+/*
+ * Run the workers and the replay over all the blocks. Worker 0 uses the
+ * GEOS handle of the context, the others get their own; fewer workers are
+ * used when handles cannot be created.
+ */
+static int
+cluster_parallel(CLUSTER_JOB *job, uint32_t num_geoms, uint32_t nthreads, lwthread_worker worker, cluster_replay replay, void *state)
+{
+	uint32_t block_size = num_geoms < CLUSTER_BLOCK_SIZE ? num_geoms : CLUSTER_BLOCK_SIZE;
+	GEOSGeometry *probe;
+	int success = LW_SUCCESS;
+	uint32_t i;
+
+	/* GEOS builds the tree on its first query: do it before it is shared */
+	if (job->tree)
+	{
+		probe = make_geos_point(0, 0);
+		if (!probe)
+			return LW_FAILURE;
+		GEOSSTRtree_query_r(lwcontext()->geos_ctx, job->tree, probe, &cluster_noop_accumulate, NULL);
+		GEOSGeom_destroy_r(lwcontext()->geos_ctx, probe);
+	}
+
+	job->workers = lwalloc(nthreads * sizeof(CLUSTER_WORKER));
+	memset(job->workers, 0, nthreads * sizeof(CLUSTER_WORKER));
+	job->workers[0].handle = lwcontext()->geos_ctx;
+	for (job->num_workers = 1; job->num_workers < nthreads; job->num_workers++)
+	{
+		GEOSContextHandle_t handle;
+		if (job->grid)
+			continue;
+		handle = GEOS_init_r();
+		if (!handle)
+			break;
+		job->workers[job->num_workers].handle = handle;
+	}
+
+	job->first = lwalloc(block_size * sizeof(size_t));
+	job->count = lwalloc(block_size * sizeof(uint32_t));
+
+	for (job->block_start = 0; job->block_start < num_geoms && success; job->block_start = job->block_end)
+	{
+		job->block_end = num_geoms - job->block_start < block_size ? num_geoms : job->block_start + block_size;
+
+		LW_ON_INTERRUPT(success = LW_FAILURE; break);
+
+		lwthread_run(job->num_workers, worker, job);
+		for (i = 0; i < job->num_workers; i++)
+		{
+			if (job->workers[i].failed)
+				success = LW_FAILURE;
+		}
+		if (success)
+			success = replay(job, state);
+	}
+
+	for (i = 0; i < job->num_workers; i++)
+	{
+		free(job->workers[i].found);
+		free(job->workers[i].pairs);
+		free(job->workers[i].merged);
+		if (i && job->workers[i].handle)
+			GEOS_finish_r(job->workers[i].handle);
+	}
+	lwfree(job->workers);
+	lwfree(job->first);
+	lwfree(job->count);
+	return success;
+}
+
+int
+union_intersecting_pairs_parallel(GEOSGeometry **geoms, uint32_t num_geoms, UNIONFIND *uf, uint32_t nthreads)
+{
+	CLUSTER_JOB job;
+	struct STRTree tree;
+	int success;
+
+	nthreads = lwthread_count(nthreads, num_geoms, LW_CLUSTER_PARALLEL_MIN_GEOMS);
+	if (nthreads < 2)
+		return union_intersecting_pairs(geoms, num_geoms, uf);
+
+	tree = make_strtree((void **)geoms, num_geoms, LW_FALSE);
+	if (tree.tree == NULL)
+	{
+		destroy_strtree(&tree);
+		return LW_FAILURE;
+	}
+
+	memset(&job, 0, sizeof(CLUSTER_JOB));
+	job.geoms = (void **)geoms;
+	job.tree = tree.tree;
+	job.uf = uf;
+	success = cluster_parallel(&job, num_geoms, nthreads, intersecting_worker, intersecting_replay, NULL);
+
+	destroy_strtree(&tree);
+	return success;
+}
+
+int
+cluster_intersecting_parallel(GEOSGeometry **geoms, uint32_t num_geoms, GEOSGeometry ***clusterGeoms, uint32_t *num_clusters, uint32_t nthreads)
+{
+	int cluster_success;
+	UNIONFIND *uf = UF_create(num_geoms);
+
+	if (union_intersecting_pairs_parallel(geoms, num_geoms, uf, nthreads) == LW_FAILURE)
+	{
+		UF_destroy(uf);
+		return LW_FAILURE;
+	}
+
+	cluster_success = combine_geometries(uf, (void **)geoms, num_geoms, (void ***)clusterGeoms, num_clusters, 0);
+	UF_destroy(uf);
+	return cluster_success;
+}
+
+int
+union_dbscan_parallel(LWGEOM **geoms, uint32_t num_geoms, UNIONFIND *uf, double eps, uint32_t min_points, char **in_a_cluster_ret, uint32_t nthreads)
+{
+	CLUSTER_JOB job;
+	DBSCAN_REPLAY_STATE state;
+	struct STRTree tree;
+	CLUSTER_GRID *grid;
+	int success;
+
+	nthreads = lwthread_count(nthreads, num_geoms, LW_CLUSTER_PARALLEL_MIN_GEOMS);
+	if (nthreads < 2 || num_geoms <= 1 || num_geoms < min_points)
+		return union_dbscan(geoms, num_geoms, uf, eps, min_points, in_a_cluster_ret);
+	/* Points only: the grid, whose result does not depend on the number of threads */
+	if (min_points <= 1 && (grid = cluster_grid_create(geoms, num_geoms, eps)))
+	{
+		success = union_dbscan_grid(grid, geoms, num_geoms, uf, eps, in_a_cluster_ret, nthreads);
+		if (success == LW_SUCCESS)
+			UF_normalize(uf);
+		return success;
+	}
+
+	tree = make_strtree((void **)geoms, num_geoms, LW_TRUE);
+	if (tree.tree == NULL)
+	{
+		destroy_strtree(&tree);
+		return LW_FAILURE;
+	}
+
+	memset(&job, 0, sizeof(CLUSTER_JOB));
+	job.geoms = (void **)geoms;
+	job.tree = tree.tree;
+	job.uf = uf;
+	job.eps = eps;
+	job.min_points = min_points;
+
+	memset(&state, 0, sizeof(DBSCAN_REPLAY_STATE));
+	state.in_a_cluster = lwalloc(num_geoms * sizeof(char));
+	memset(state.in_a_cluster, min_points <= 1 ? LW_TRUE : LW_FALSE, num_geoms * sizeof(char));
+
+	if (min_points <= 1)
+	{
+		success = cluster_parallel(&job, num_geoms, nthreads, dbscan_worker, dbscan_replay_minpoints_1, NULL);
+	}
+	else
+	{
+		state.is_in_core = lwalloc(num_geoms * sizeof(char));
+		memset(state.is_in_core, 0, num_geoms * sizeof(char));
+		state.neighbors = lwalloc(min_points * sizeof(uint32_t));
+		success = cluster_parallel(&job, num_geoms, nthreads, dbscan_worker, dbscan_replay_general, &state);
+		lwfree(state.is_in_core);
+		lwfree(state.neighbors);
+	}
+
+	if (in_a_cluster_ret)
+		*in_a_cluster_ret = state.in_a_cluster;
+	else
+		lwfree(state.in_a_cluster);
+
+	destroy_strtree(&tree);
+	if (success == LW_SUCCESS)
+		UF_normalize(uf);
+	return success;
+}
+
+int
+cluster_within_distance_parallel(LWGEOM **geoms, uint32_t num_geoms, double tolerance, LWGEOM ***clusterGeoms, uint32_t *num_clusters, uint32_t nthreads)
+{
+	int cluster_success;
+	UNIONFIND *uf = UF_create(num_geoms);
+
+	if (union_dbscan_parallel(geoms, num_geoms, uf, tolerance, 1, NULL, nthreads) == LW_FAILURE)
+	{
+		UF_destroy(uf);
+		return LW_FAILURE;
+	}
+
+	cluster_success = combine_geometries(uf, (void **)geoms, num_geoms, (void ***)clusterGeoms, num_clusters, 1);
+	UF_destroy(uf);
+	return cluster_success;
+}
+
+/*
+ * Points on a grid.
+ *
+ * When every input is a point, the neighbours within eps of a point are
+ * found in the 3x3 cells around its own, on a grid of cells slightly larger
+ * than eps, with the same envelope test and distance arithmetic as the
+ * tree path. The points of a cell are stored together, coordinates apart,
+ * so the scans run over contiguous memory.
+ *
+ * The grid merges every point with its neighbours in input order, through
+ * the replay of the parallel path, so the result is the same on any
+ * number of threads. The clusters are those of the tree path, and since
+ * both give every cluster its lowest input as root (UF_normalize), so are
+ * their ids.
+ */
+
+/* Cells per axis, small enough for the cell of a point to be exact within the margin */
+#define CLUSTER_GRID_MAX_CELLS (1 << 24)
+/* Relative margin of the cell size over eps, for the rounding of the cell computation */
+#define CLUSTER_GRID_MARGIN (1.0 / 1024)
+#define CLUSTER_GRID_NO_CELL UINT32_MAX
+
+struct CLUSTER_GRID
+{
+	double xmin;
+	double ymin;
+	double cell_size;
+	uint32_t num_geoms;
+	uint32_t num_points;
+	uint32_t num_cells;
+	uint32_t *cell_of;    /* Cell of every input, CLUSTER_GRID_NO_CELL for the empty ones */
+	uint32_t *cell_start; /* Points of every cell, in the arrays below */
+	uint32_t *neighbors;  /* The 3x3 cells around every cell, itself included */
+	double *x;	      /* Points, grouped by cell */
+	double *y;
+	uint32_t *ids;
+};
+
+static inline uint64_t
+cluster_grid_key(uint32_t cx, uint32_t cy)
+{
+	return ((uint64_t)cx << 32) | cy;
+}
+
+static inline uint32_t
+cluster_grid_slot(uint64_t key, uint32_t bits)
+{
+	return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+}
+
+/* Cell with that key, CLUSTER_GRID_NO_CELL if there is none */
+static uint32_t
+cluster_grid_lookup(const uint64_t *keys, const uint32_t *cells, uint32_t bits, uint64_t key)
+{
+	uint32_t mask = (1U << bits) - 1;
+	uint32_t slot;
+
+	for (slot = cluster_grid_slot(key, bits); cells[slot] != CLUSTER_GRID_NO_CELL; slot = (slot + 1) & mask)
+		if (keys[slot] == key)
+			return cells[slot];
+	return CLUSTER_GRID_NO_CELL;
+}
+
+static void
+cluster_grid_destroy(CLUSTER_GRID *grid)
+{
+	lwfree(grid->cell_of);
+	lwfree(grid->cell_start);
+	lwfree(grid->neighbors);
+	lwfree(grid->x);
+	lwfree(grid->y);
+	lwfree(grid->ids);
+	lwfree(grid);
+}
+
+/*
+ * Hash the points on the grid. Returns NULL when the inputs are not all
+ * points, or when eps is too small or too large against their coordinates
+ * for the cells to be computed exactly enough: the tree path is used then.
+ */
+static CLUSTER_GRID *
+cluster_grid_create(LWGEOM **geoms, uint32_t num_geoms, double eps)
+{
+	CLUSTER_GRID *grid;
+	double xmin = DBL_MAX, ymin = DBL_MAX, xmax = -DBL_MAX, ymax = -DBL_MAX;
+	double cell_size, extent;
+	uint64_t *keys, *cell_keys;
+	uint32_t *slots, *count;
+	uint32_t i, j, num_points = 0, num_cells = 0, bits = 4;
+
+	if (!(eps > 0) || !isfinite(eps))
+		return NULL;
+
+	for (i = 0; i < num_geoms; i++)
+	{
+		const POINT2D *pt;
+		if (geoms[i]->type != POINTTYPE)
+			return NULL;
+		if (lwgeom_is_empty(geoms[i]))
+			continue;
+		pt = getPoint2d_cp(lwgeom_as_lwpoint(geoms[i])->point, 0);
+		if (!isfinite(pt->x) || !isfinite(pt->y))
+			return NULL;
+		xmin = FP_MIN(xmin, pt->x);
+		ymin = FP_MIN(ymin, pt->y);
+		xmax = FP_MAX(xmax, pt->x);
+		ymax = FP_MAX(ymax, pt->y);
+		num_points++;
+	}
+	if (num_points < 2)
+		return NULL;
+
+	/* Rounding of the coordinates has to stay far below the margin */
+	extent = FP_MAX(FP_MAX(fabs(xmin), fabs(xmax)), FP_MAX(fabs(ymin), fabs(ymax)));
+	if (extent > ldexp(eps, 30))
+		return NULL;
+	/* Distances have to stay below FLT_MAX, past it the tree path fails on purpose */
+	if (xmax - xmin >= FLT_MAX / 2 || ymax - ymin >= FLT_MAX / 2)
+		return NULL;
+	cell_size = eps * (1 + CLUSTER_GRID_MARGIN);
+	if ((xmax - xmin) / cell_size >= CLUSTER_GRID_MAX_CELLS - 1 ||
+	    (ymax - ymin) / cell_size >= CLUSTER_GRID_MAX_CELLS - 1)
+		return NULL;
+
+	grid = lwalloc(sizeof(CLUSTER_GRID));
+	memset(grid, 0, sizeof(CLUSTER_GRID));
+	grid->xmin = xmin;
+	grid->ymin = ymin;
+	grid->cell_size = cell_size;
+	grid->num_geoms = num_geoms;
+	grid->num_points = num_points;
+	grid->cell_of = lwalloc(num_geoms * sizeof(uint32_t));
+
+	/* Number the cells in order of appearance, through a hash of their coordinates */
+	while ((1U << bits) < 2 * num_points)
+		bits++;
+	keys = lwalloc(((size_t)1 << bits) * sizeof(uint64_t));
+	slots = lwalloc(((size_t)1 << bits) * sizeof(uint32_t));
+	memset(slots, 0xFF, ((size_t)1 << bits) * sizeof(uint32_t));
+	cell_keys = lwalloc(num_points * sizeof(uint64_t));
+	count = lwalloc((num_points + 1) * sizeof(uint32_t));
+	memset(count, 0, (num_points + 1) * sizeof(uint32_t));
+
+	for (i = 0; i < num_geoms; i++)
+	{
+		const POINT2D *pt;
+		uint64_t key;
+		uint32_t slot, mask = (1U << bits) - 1;
+
+		grid->cell_of[i] = CLUSTER_GRID_NO_CELL;
+		if (lwgeom_is_empty(geoms[i]))
+			continue;
+		pt = getPoint2d_cp(lwgeom_as_lwpoint(geoms[i])->point, 0);
+		key = cluster_grid_key((uint32_t)((pt->x - xmin) / cell_size) + 1,
+				       (uint32_t)((pt->y - ymin) / cell_size) + 1);
+
+		for (slot = cluster_grid_slot(key, bits); slots[slot] != CLUSTER_GRID_NO_CELL; slot = (slot + 1) & mask)
+			if (keys[slot] == key)
+				break;
+		if (slots[slot] == CLUSTER_GRID_NO_CELL)
+		{
+			keys[slot] = key;
+			slots[slot] = num_cells;
+			cell_keys[num_cells++] = key;
+		}
+		grid->cell_of[i] = slots[slot];
+		count[slots[slot] + 1]++;
+	}
+	grid->num_cells = num_cells;
+
+	/* Group the points by cell, keeping the input order within a cell */
+	for (j = 0; j < num_cells; j++)
+		count[j + 1] += count[j];
+	grid->cell_start = lwalloc((num_cells + 1) * sizeof(uint32_t));
+	memcpy(grid->cell_start, count, (num_cells + 1) * sizeof(uint32_t));
+	grid->x = lwalloc(num_points * sizeof(double));
+	grid->y = lwalloc(num_points * sizeof(double));
+	grid->ids = lwalloc(num_points * sizeof(uint32_t));
+	for (i = 0; i < num_geoms; i++)
+	{
+		const POINT2D *pt;
+		uint32_t pos;
+		if (grid->cell_of[i] == CLUSTER_GRID_NO_CELL)
+			continue;
+		pt = getPoint2d_cp(lwgeom_as_lwpoint(geoms[i])->point, 0);
+		pos = count[grid->cell_of[i]]++;
+		grid->x[pos] = pt->x;
+		grid->y[pos] = pt->y;
+		grid->ids[pos] = i;
+	}
+
+	/* Cell coordinates start at 1, so the cells around them never wrap */
+	grid->neighbors = lwalloc((size_t)num_cells * 9 * sizeof(uint32_t));
+	for (j = 0; j < num_cells; j++)
+	{
+		uint32_t cx = (uint32_t)(cell_keys[j] >> 32);
+		uint32_t cy = (uint32_t)cell_keys[j];
+		uint32_t n = 0, dx, dy;
+		for (dx = cx - 1; dx <= cx + 1; dx++)
+			for (dy = cy - 1; dy <= cy + 1; dy++)
+				grid->neighbors[9 * j + n++] =
+				    cluster_grid_lookup(keys, slots, bits, cluster_grid_key(dx, dy));
+	}
+
+	lwfree(keys);
+	lwfree(slots);
+	lwfree(cell_keys);
+	lwfree(count);
+	return grid;
+}
+
+static int
+cluster_pair_cmp(const void *a, const void *b)
+{
+	uint32_t qa = ((const CLUSTER_PAIR *)a)->q;
+	uint32_t qb = ((const CLUSTER_PAIR *)b)->q;
+	return qa < qb ? -1 : qa > qb;
+}
+
+/* Slot of i in the merges of a grid worker, or the free slot where it goes */
+static inline uint32_t
+cluster_local_slot(const CLUSTER_WORKER *w, uint32_t i)
+{
+	uint32_t mask = (1U << w->merged_bits) - 1;
+	uint32_t slot;
+
+	for (slot = cluster_grid_slot(i, w->merged_bits); w->merged[2 * slot] != CLUSTER_GRID_NO_CELL;
+	     slot = (slot + 1) & mask)
+	{
+		if (w->merged[2 * slot] == i)
+			break;
+	}
+	return slot;
+}
+
+/* Root of i in the merges seen by a grid worker, with path halving */
+static inline uint32_t
+cluster_local_root(CLUSTER_WORKER *w, uint32_t i)
+{
+	while (w->num_merged)
+	{
+		uint32_t slot = cluster_local_slot(w, i);
+		uint32_t parent, next;
+
+		if (w->merged[2 * slot] != i)
+			break;
+		parent = w->merged[2 * slot + 1];
+		next = cluster_local_slot(w, parent);
+		if (w->merged[2 * next] != parent)
+			return parent;
+		w->merged[2 * slot + 1] = w->merged[2 * next + 1];
+		i = w->merged[2 * next + 1];
+	}
+	return i;
+}
+
+/* Merge root a into root b, growing the table to stay at most half full */
+static int
+cluster_local_union(CLUSTER_WORKER *w, uint32_t a, uint32_t b)
+{
+	uint32_t slot;
+
+	if (a == b)
+		return LW_SUCCESS;
+	if (!w->merged || 2 * (w->num_merged + 1) > (1U << w->merged_bits))
+	{
+		uint32_t *old = w->merged;
+		uint32_t old_size = old ? 1U << w->merged_bits : 0;
+		uint32_t bits = old ? w->merged_bits + 1 : 10;
+		uint32_t i;
+
+		w->merged = malloc(((size_t)2 << bits) * sizeof(uint32_t));
+		if (!w->merged)
+		{
+			w->merged = old;
+			return LW_FAILURE;
+		}
+		memset(w->merged, 0xFF, ((size_t)2 << bits) * sizeof(uint32_t));
+		w->merged_bits = bits;
+		for (i = 0; i < old_size; i++)
+		{
+			if (old[2 * i] == CLUSTER_GRID_NO_CELL)
+				continue;
+			slot = cluster_local_slot(w, old[2 * i]);
+			w->merged[2 * slot] = old[2 * i];
+			w->merged[2 * slot + 1] = old[2 * i + 1];
+		}
+		free(old);
+	}
+
+	slot = cluster_local_slot(w, a);
+	w->merged[2 * slot] = a;
+	w->merged[2 * slot + 1] = b;
+	w->num_merged++;
+	return LW_SUCCESS;
+}
+
+/*
+ * Neighbours of a block of points from the grid, in input order.
+ *
+ * Besides the clusters at the start of the block, read from the shared
+ * UNIONFIND, a worker keeps track of the merges of its own points, which
+ * all come before the current one: a pair they already connect would be
+ * skipped by the sequential loop too, and is not recorded. Without it
+ * dense inputs, where most pairs end up connected, would record about all
+ * of them. Those merges only touch a few roots, so they go in a small
+ * table rather than in a parent array over all the inputs.
+ */
+static void
+dbscan_grid_worker(void *arg, uint32_t worker)
+{
+	CLUSTER_JOB *job = arg;
+	CLUSTER_WORKER *w = &job->workers[worker];
+	const CLUSTER_GRID *grid = job->grid;
+	LWGEOM **geoms = (LWGEOM **)job->geoms;
+	double eps = job->eps;
+	uint32_t chunk, stride = job->num_workers * CLUSTER_CHUNK_SIZE;
+	size_t i;
+
+	w->num_pairs = 0;
+	for (chunk = job->block_start + worker * CLUSTER_CHUNK_SIZE; chunk < job->block_end && !w->failed;
+	     chunk += stride)
+	{
+		uint32_t p, n;
+		uint32_t end = job->block_end - chunk < CLUSTER_CHUNK_SIZE ? job->block_end : chunk + CLUSTER_CHUNK_SIZE;
+
+		for (p = chunk; p < end && !w->failed; p++)
+		{
+			uint32_t slot = p - job->block_start;
+			uint32_t cell = grid->cell_of[p];
+			const POINT2D *pt;
+			double xlo, xhi, ylo, yhi;
+			uint32_t root;
+
+			job->first[slot] = w->num_pairs;
+			job->count[slot] = 0;
+			if (cell == CLUSTER_GRID_NO_CELL)
+				continue;
+
+			pt = getPoint2d_cp(lwgeom_as_lwpoint(geoms[p])->point, 0);
+			root = cluster_local_root(w, cluster_uf_root(job->uf, p));
+			/* Same query envelope as dbscan_update_context */
+			xlo = pt->x - eps;
+			xhi = pt->x + eps;
+			ylo = pt->y - eps;
+			yhi = pt->y + eps;
+
+			for (n = 0; n < 9; n++)
+			{
+				uint32_t c = grid->neighbors[9 * cell + n];
+				uint32_t k, k_end;
+				if (c == CLUSTER_GRID_NO_CELL)
+					continue;
+				k_end = grid->cell_start[c + 1];
+				for (k = grid->cell_start[c]; k < k_end; k++)
+				{
+					double qx = grid->x[k], qy = grid->y[k];
+					double hside, vside;
+					uint32_t q;
+
+					if (qx < xlo || qx > xhi || qy < ylo || qy > yhi)
+						continue;
+					/* Arithmetic of lw_dist2d_pt_pt */
+					hside = qx - pt->x;
+					vside = qy - pt->y;
+					if (!(sqrt(hside * hside + vside * vside) <= eps))
+						continue;
+					q = grid->ids[k];
+					if (q == p || root == cluster_local_root(w, cluster_uf_root(job->uf, q)))
+						continue;
+					cluster_worker_record(w, q, CLUSTER_PAIR_MATCH);
+				}
+			}
+			if (w->failed)
+				break;
+
+			/* Back to the input order, and merge them for the next points */
+			job->count[slot] = w->num_pairs - job->first[slot];
+			if (job->count[slot] > 1)
+				qsort(w->pairs + job->first[slot], job->count[slot], sizeof(CLUSTER_PAIR), cluster_pair_cmp);
+			for (i = job->first[slot]; i < w->num_pairs; i++)
+			{
+				uint32_t q = w->pairs[i].q;
+				root = cluster_local_root(w, root);
+				if (cluster_local_union(w, cluster_local_root(w, cluster_uf_root(job->uf, q)), root) == LW_FAILURE)
+					w->failed = LW_TRUE;
+			}
+		}
+	}
+
+	/* The clusters change with the replay of the block */
+	if (w->num_merged)
+	{
+		memset(w->merged, 0xFF, ((size_t)2 << w->merged_bits) * sizeof(uint32_t));
+		w->num_merged = 0;
+	}
+}
+
+static int
+union_dbscan_grid(CLUSTER_GRID *grid, LWGEOM **geoms, uint32_t num_geoms, UNIONFIND *uf, double eps, char **in_a_cluster_ret, uint32_t nthreads)
+{
+	CLUSTER_JOB job;
+	int success;
+
+	if (in_a_cluster_ret)
+	{
+		char *in_a_cluster = lwalloc(num_geoms * sizeof(char));
+		memset(in_a_cluster, LW_TRUE, num_geoms * sizeof(char));
+		*in_a_cluster_ret = in_a_cluster;
+	}
+
+	memset(&job, 0, sizeof(CLUSTER_JOB));
+	job.geoms = (void **)geoms;
+	job.uf = uf;
+	job.eps = eps;
+	job.min_points = 1;
+	job.grid = grid;
+	success = cluster_parallel(&job, num_geoms, nthreads, dbscan_grid_worker, dbscan_replay_minpoints_1, NULL);
+
+	cluster_grid_destroy(grid);
+	return success;
+}
+
 /** Uses a UNIONFIND to identify the set with which each input geometry is associated, and groups the geometries into
  *  GeometryCollections.  Supplied geometry array may be of either LWGEOM* or GEOSGeometry*; is_lwgeom is used to
  *  identify which. Caller is responsible for freeing input geometry array but not the items contained within it. */
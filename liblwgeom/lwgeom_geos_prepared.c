@@ -0,0 +1,323 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include "../postgis_config.h"
+#include "lwgeom_geos.h"
+#include "liblwgeom_internal.h"
+#include "lwgeom_log.h"
+#include "lwcache.h"
+
+#include <string.h>
+
+/*
+ * Prepared GEOS geometries for repeated predicates.
+ *
+ * An LWPREPARED holds the GEOS conversion of a geometry, its
+ * GEOSPreparedGeometry (built lazily, on first use) and its cartesian box,
+ * used to answer most negative probes without calling GEOS at all. They
+ * can be handled explicitly (lwgeom_prepare / lwprepared_free) or through
+ * the per context cache used by the lwgeom_prepared_* predicates (see
+ * lwcache.h).
+ */
+
+struct LWPREPARED
+{
+	GEOSGeometry *geom;
+	const GEOSPreparedGeometry *prepared;
+	GBOX box;
+	int32_t srid;
+	uint8_t empty;
+};
+
+typedef enum
+{
+	LWPREPARED_INTERSECTS,
+	LWPREPARED_CONTAINS,
+	LWPREPARED_COVERS,
+	LWPREPARED_WITHIN
+} LWPREPARED_PREDICATE;
+
+struct LWPREPARED_CACHE
+{
+	void *geos_ctx; /* GEOS handle the entries were created with */
+	LWCACHE cache;
+};
+
+LWPREPARED *
+lwgeom_prepare(const LWGEOM *geom)
+{
+	LWPREPARED *prep;
+
+	if (!geom)
+	{
+		lwerror("%s: Geometry is null", __func__);
+		return NULL;
+	}
+
+	prep = lwalloc_heap(sizeof(LWPREPARED));
+	memset(prep, 0, sizeof(LWPREPARED));
+	prep->srid = geom->srid;
+	prep->empty = lwgeom_is_empty(geom);
+	if (prep->empty)
+		return prep;
+
+	GEOSContext_setNoticeHandler_r(lwcontext()->geos_ctx, lwnotice);
+	GEOSContext_setErrorHandler_r(lwcontext()->geos_ctx, lwgeom_geos_error);
+
+	if (!(prep->geom = LWGEOM2GEOS(geom, LW_TRUE)))
+	{
+		lwfree_heap(prep);
+		lwerror("%s: GEOS Error: %s", __func__, lwgeom_geos_errmsg);
+		return NULL;
+	}
+	lwgeom_calculate_gbox_cartesian(geom, &prep->box);
+	return prep;
+}
+
+void
+lwprepared_free(LWPREPARED *prep)
+{
+	if (!prep)
+		return;
+	if (prep->prepared)
+		GEOSPreparedGeom_destroy_r(lwcontext()->geos_ctx, prep->prepared);
+	if (prep->geom)
+		GEOSGeom_destroy_r(lwcontext()->geos_ctx, prep->geom);
+	lwfree_heap(prep);
+}
+
+static int
+lwprepared_predicate(LWPREPARED *prep, const LWGEOM *geom, LWPREPARED_PREDICATE predicate, const char *funcname)
+{
+	GEOSGeometry *g;
+	GBOX box;
+	char result;
+
+	if (!geom)
+	{
+		lwerror("%s: Geometry is null", funcname);
+		return -1;
+	}
+	if (prep->srid != geom->srid)
+	{
+		lwerror("%s: Operation on mixed SRID geometries (%d != %d)", funcname, prep->srid, geom->srid);
+		return -1;
+	}
+
+	/* Nothing intersects, contains, covers or is within an empty */
+	if (prep->empty || lwgeom_is_empty(geom))
+		return LW_FALSE;
+
+	/* Box filter, enough for most negative probes */
+	lwgeom_calculate_gbox_cartesian(geom, &box);
+	switch (predicate)
+	{
+	case LWPREPARED_INTERSECTS:
+		if (!gbox_overlaps_2d(&prep->box, &box))
+			return LW_FALSE;
+		break;
+	case LWPREPARED_CONTAINS:
+	case LWPREPARED_COVERS:
+		if (!gbox_contains_2d(&prep->box, &box))
+			return LW_FALSE;
+		break;
+	case LWPREPARED_WITHIN:
+		if (!gbox_contains_2d(&box, &prep->box))
+			return LW_FALSE;
+		break;
+	}
+
+	GEOSContext_setNoticeHandler_r(lwcontext()->geos_ctx, lwnotice);
+	GEOSContext_setErrorHandler_r(lwcontext()->geos_ctx, lwgeom_geos_error);
+
+	if (!prep->prepared && !(prep->prepared = GEOSPrepare_r(lwcontext()->geos_ctx, prep->geom)))
+	{
+		lwerror("%s: GEOS Error: %s", funcname, lwgeom_geos_errmsg);
+		return -1;
+	}
+	if (!(g = LWGEOM2GEOS(geom, LW_TRUE)))
+	{
+		lwerror("%s: GEOS Error: %s", funcname, lwgeom_geos_errmsg);
+		return -1;
+	}
+
+	switch (predicate)
+	{
+	case LWPREPARED_INTERSECTS:
+		result = GEOSPreparedIntersects_r(lwcontext()->geos_ctx, prep->prepared, g);
+		break;
+	case LWPREPARED_CONTAINS:
+		result = GEOSPreparedContains_r(lwcontext()->geos_ctx, prep->prepared, g);
+		break;
+	case LWPREPARED_COVERS:
+		result = GEOSPreparedCovers_r(lwcontext()->geos_ctx, prep->prepared, g);
+		break;
+	case LWPREPARED_WITHIN:
+	default:
+		result = GEOSPreparedWithin_r(lwcontext()->geos_ctx, prep->prepared, g);
+		break;
+	}
+	GEOSGeom_destroy_r(lwcontext()->geos_ctx, g);
+
+	if (result == 2) /* exception thrown */
+	{
+		lwerror("%s: GEOS Error: %s", funcname, lwgeom_geos_errmsg);
+		return -1;
+	}
+	return result ? LW_TRUE : LW_FALSE;
+}
+
+int
+lwprepared_intersects(LWPREPARED *prep, const LWGEOM *geom)
+{
+	return lwprepared_predicate(prep, geom, LWPREPARED_INTERSECTS, __func__);
+}
+
+int
+lwprepared_contains(LWPREPARED *prep, const LWGEOM *geom)
+{
+	return lwprepared_predicate(prep, geom, LWPREPARED_CONTAINS, __func__);
+}
+
+int
+lwprepared_covers(LWPREPARED *prep, const LWGEOM *geom)
+{
+	return lwprepared_predicate(prep, geom, LWPREPARED_COVERS, __func__);
+}
+
+int
+lwprepared_within(LWPREPARED *prep, const LWGEOM *geom)
+{
+	return lwprepared_predicate(prep, geom, LWPREPARED_WITHIN, __func__);
+}
+
+/*
+ * Per context cache
+ */
+
+static void
+lwprepared_cache_release(void *prep)
+{
+	lwprepared_free(prep);
+}
+
+static LWPREPARED_CACHE *
+lwprepared_cache_get_context(LWGEOM_CONTEXT *ctx)
+{
+	LWPREPARED_CACHE *cache = ctx->prepared_cache;
+	if (!cache)
+	{
+		cache = lwalloc_heap(sizeof(LWPREPARED_CACHE));
+		lwcache_init(&cache->cache, LWPREPARED_CACHE_ITEMS, lwprepared_cache_release);
+		cache->geos_ctx = ctx->geos_ctx;
+		ctx->prepared_cache = cache;
+	}
+	/* GEOS objects are bound to the handle that created them */
+	else if (cache->geos_ctx != ctx->geos_ctx)
+	{
+		lwprepared_cache_flush();
+		cache->geos_ctx = ctx->geos_ctx;
+	}
+	return cache;
+}
+
+LWPREPARED *
+lwprepared_cache_get(const LWGEOM *geom)
+{
+	LWPREPARED_CACHE *cache;
+	LWPREPARED *prep;
+	LWARENA_SCOPE scope;
+	LWGEOM *copy;
+	uint64_t key;
+
+	if (!geom)
+	{
+		lwerror("%s: Geometry is null", __func__);
+		return NULL;
+	}
+
+	cache = lwprepared_cache_get_context(lwcontext());
+	if ((prep = lwcache_find(&cache->cache, geom, &key)))
+		return prep;
+
+	if (!(prep = lwgeom_prepare(geom)))
+		return NULL;
+
+	/* The key copy must outlive any arena scope of the caller */
+	lwarena_push(NULL, &scope);
+	copy = lwgeom_clone_deep(geom);
+	lwarena_pop(&scope);
+	lwcache_add(&cache->cache, key, geom, copy, prep);
+	return prep;
+}
+
+void
+lwprepared_cache_flush(void)
+{
+	LWPREPARED_CACHE *cache = lwcontext()->prepared_cache;
+	if (cache)
+		lwcache_flush(&cache->cache);
+}
+
+void
+lwprepared_cache_stats(uint64_t *hits, uint64_t *misses, uint32_t *size)
+{
+	LWPREPARED_CACHE *cache = lwcontext()->prepared_cache;
+	lwcache_stats(cache ? &cache->cache : NULL, hits, misses, size);
+}
+
+void
+lwprepared_cache_destroy(void)
+{
+	LWGEOM_CONTEXT *ctx = lwcontext();
+	if (!ctx->prepared_cache)
+		return;
+	lwprepared_cache_flush();
+	lwfree_heap(ctx->prepared_cache);
+	ctx->prepared_cache = NULL;
+}
+
+int
+lwgeom_prepared_intersects(const LWGEOM *geom1, const LWGEOM *geom2)
+{
+	LWPREPARED *prep = lwprepared_cache_get(geom1);
+	return prep ? lwprepared_predicate(prep, geom2, LWPREPARED_INTERSECTS, __func__) : -1;
+}
+
+int
+lwgeom_prepared_contains(const LWGEOM *geom1, const LWGEOM *geom2)
+{
+	LWPREPARED *prep = lwprepared_cache_get(geom1);
+	return prep ? lwprepared_predicate(prep, geom2, LWPREPARED_CONTAINS, __func__) : -1;
+}
+
+int
+lwgeom_prepared_covers(const LWGEOM *geom1, const LWGEOM *geom2)
+{
+	LWPREPARED *prep = lwprepared_cache_get(geom1);
+	return prep ? lwprepared_predicate(prep, geom2, LWPREPARED_COVERS, __func__) : -1;
+}
+
+int
+lwgeom_prepared_within(const LWGEOM *geom1, const LWGEOM *geom2)
+{
+	LWPREPARED *prep = lwprepared_cache_get(geom1);
+	return prep ? lwprepared_predicate(prep, geom2, LWPREPARED_WITHIN, __func__) : -1;
+}
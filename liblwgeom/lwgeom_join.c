@@ -0,0 +1,268 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include "liblwgeom_internal.h"
+#include "lwgeom_log.h"
+#include "lwhrtree.h"
+#include "lwtree.h"
+
+/*
+ * Index nested loop join: b is bulk loaded in a packed Hilbert R-tree,
+ * and the elements of a probe it in the Hilbert order of their own boxes,
+ * so that consecutive probes hit the same parts of the tree and of b.
+ *
+ * Every element of a is refined against all its candidates at once, so
+ * its rect tree or prepared geometry is built once per join, and the rect
+ * trees of b are built on first use and kept until the end of the join.
+ */
+
+typedef struct
+{
+	/* Inner side */
+	const LWGEOM **b;
+	uint32_t *ids;     /* Geometry of every item of the tree */
+	GBOX *boxes;       /* Box of every item of the tree */
+	RECT_NODE **trees; /* Rect tree of every item, on demand */
+
+	LW_JOIN_PREDICATE predicate;
+	double distance;
+	lwgeom_join_callback callback;
+	void *data;
+
+	/* Current probe */
+	uint32_t ia;
+	const LWGEOM *geom;
+	GBOX box;
+	RECT_NODE *tree;
+	LWPREPARED *prep;
+
+	int stopped;
+	int failed;
+} LWJOIN_STATE;
+
+/*
+ * Non-empty geometries of an array, with their boxes. Returns the number
+ * of them, or -1 when they do not all share the same cartesian SRID.
+ */
+static int64_t
+lwjoin_collect(const LWGEOM **geoms, uint32_t ngeoms, int32_t *srid, uint32_t *ids, GBOX *boxes)
+{
+	uint32_t i, count = 0;
+
+	for (i = 0; i < ngeoms; i++)
+	{
+		const LWGEOM *geom = geoms[i];
+		if (!geom)
+			continue;
+		if (FLAGS_GET_GEODETIC(geom->flags))
+		{
+			lwerror("%s: Geodetic geometries are not supported", __func__);
+			return -1;
+		}
+		if (*srid == SRID_INVALID)
+			*srid = geom->srid;
+		else if (geom->srid != *srid)
+		{
+			lwerror("%s: Operation on mixed SRID geometries (%d != %d)", __func__, *srid, geom->srid);
+			return -1;
+		}
+		if (lwgeom_is_empty(geom))
+			continue;
+		lwgeom_calculate_gbox_cartesian(geom, &boxes[count]);
+		ids[count++] = i;
+	}
+	return count;
+}
+
+static RECT_NODE *
+lwjoin_inner_tree(LWJOIN_STATE *state, uint64_t item)
+{
+	if (!state->trees[item])
+		state->trees[item] = rect_tree_from_lwgeom(state->b[state->ids[item]]);
+	return state->trees[item];
+}
+
+static RECT_NODE *
+lwjoin_outer_tree(LWJOIN_STATE *state)
+{
+	if (!state->tree)
+		state->tree = rect_tree_from_lwgeom(state->geom);
+	return state->tree;
+}
+
+static LWPREPARED *
+lwjoin_outer_prepared(LWJOIN_STATE *state)
+{
+	if (!state->prep)
+		state->prep = lwgeom_prepare(state->geom);
+	return state->prep;
+}
+
+/* Refine one candidate pair, LW_TRUE, LW_FALSE or -1 on error */
+static int
+lwjoin_refine(LWJOIN_STATE *state, uint64_t item)
+{
+	const LWGEOM *geom = state->b[state->ids[item]];
+	const GBOX *box = &state->boxes[item];
+	LWPREPARED *prep;
+
+	switch (state->predicate)
+	{
+	/*
+	 * Intersects is a zero distance: rect_tree_intersects_tree only
+	 * counts the first vertex of touching segments, and misses lines
+	 * whose last vertex lies on the other geometry.
+	 */
+	case LW_JOIN_INTERSECTS:
+	case LW_JOIN_DWITHIN:
+		return rect_tree_dwithin_tree(lwjoin_outer_tree(state), lwjoin_inner_tree(state, item), state->distance);
+	case LW_JOIN_CONTAINS:
+		if (!gbox_contains_2d(&state->box, box))
+			return LW_FALSE;
+		if (!(prep = lwjoin_outer_prepared(state)))
+			return -1;
+		return lwprepared_contains(prep, geom);
+	case LW_JOIN_COVERS:
+		if (!gbox_contains_2d(&state->box, box))
+			return LW_FALSE;
+		if (!(prep = lwjoin_outer_prepared(state)))
+			return -1;
+		return lwprepared_covers(prep, geom);
+	case LW_JOIN_WITHIN:
+		if (!gbox_contains_2d(box, &state->box))
+			return LW_FALSE;
+		if (!(prep = lwjoin_outer_prepared(state)))
+			return -1;
+		return lwprepared_within(prep, geom);
+	}
+	return LW_FALSE;
+}
+
+static int
+lwjoin_visit(const LWHRTREE_NODE *leaf, void *data)
+{
+	LWJOIN_STATE *state = (LWJOIN_STATE *)data;
+	int result = lwjoin_refine(state, leaf->offset);
+
+	if (result < 0)
+	{
+		state->failed = LW_TRUE;
+		return LW_FALSE;
+	}
+	if (result && !state->callback(state->ia, state->ids[leaf->offset], state->data))
+	{
+		state->stopped = LW_TRUE;
+		return LW_FALSE;
+	}
+	return LW_TRUE;
+}
+
+int
+lwgeom_spatial_join(const LWGEOM **a,
+		    uint32_t n,
+		    const LWGEOM **b,
+		    uint32_t m,
+		    LW_JOIN_PREDICATE predicate,
+		    double distance,
+		    lwgeom_join_callback callback,
+		    void *data)
+{
+	LWJOIN_STATE state;
+	LWHRTREE *inner = NULL, *outer = NULL;
+	uint32_t *outer_ids;
+	GBOX *outer_boxes;
+	int32_t srid = SRID_INVALID;
+	int64_t num_outer, num_inner;
+	uint64_t i;
+
+	if (!callback)
+	{
+		lwerror("%s: Callback is null", __func__);
+		return LW_FAILURE;
+	}
+	if (predicate == LW_JOIN_DWITHIN && distance < 0)
+	{
+		lwerror("%s: Tolerance cannot be less than zero", __func__);
+		return LW_FAILURE;
+	}
+
+	memset(&state, 0, sizeof(LWJOIN_STATE));
+	state.b = b;
+	state.predicate = predicate;
+	state.distance = predicate == LW_JOIN_DWITHIN ? distance : 0.0;
+	state.callback = callback;
+	state.data = data;
+
+	outer_ids = lwalloc(sizeof(uint32_t) * (n ? n : 1));
+	outer_boxes = lwalloc(sizeof(GBOX) * (n ? n : 1));
+	state.ids = lwalloc(sizeof(uint32_t) * (m ? m : 1));
+	state.boxes = lwalloc(sizeof(GBOX) * (m ? m : 1));
+
+	num_outer = lwjoin_collect(a, n, &srid, outer_ids, outer_boxes);
+	num_inner = num_outer < 0 ? -1 : lwjoin_collect(b, m, &srid, state.ids, state.boxes);
+	if (num_outer < 0 || num_inner < 0)
+		state.failed = LW_TRUE;
+	else if (num_outer > 0 && num_inner > 0)
+	{
+		inner = lwhrtree_create(state.boxes, num_inner, 0);
+		outer = lwhrtree_create(outer_boxes, num_outer, 0);
+		state.trees = lwalloc(sizeof(RECT_NODE *) * num_inner);
+		memset(state.trees, 0, sizeof(RECT_NODE *) * num_inner);
+	}
+
+	/* The leaves of the outer tree are its items in Hilbert order */
+	for (i = 0; outer && i < outer->num_items && !state.stopped && !state.failed; i++)
+	{
+		const LWHRTREE_NODE *leaf = &outer->nodes[outer->level_bounds[0][0] + i];
+		GBOX query;
+
+		state.ia = outer_ids[leaf->offset];
+		state.geom = a[state.ia];
+		state.box = outer_boxes[leaf->offset];
+		query = state.box;
+		if (predicate == LW_JOIN_DWITHIN)
+			gbox_expand(&query, distance);
+
+		lwhrtree_query_visit(inner, &query, lwjoin_visit, &state);
+
+		if (state.tree)
+			rect_tree_free(state.tree);
+		if (state.prep)
+			lwprepared_free(state.prep);
+		state.tree = NULL;
+		state.prep = NULL;
+	}
+
+	if (state.trees)
+	{
+		for (i = 0; i < (uint64_t)num_inner; i++)
+			if (state.trees[i])
+				rect_tree_free(state.trees[i]);
+		lwfree(state.trees);
+	}
+	lwhrtree_free(inner);
+	lwhrtree_free(outer);
+	lwfree(outer_ids);
+	lwfree(outer_boxes);
+	lwfree(state.ids);
+	lwfree(state.boxes);
+
+	return state.failed ? LW_FAILURE : LW_SUCCESS;
+}
@@ -26,24 +26,9 @@
 #include "../postgis_config.h"
 #include "liblwgeom_internal.h"
 #include "lwgeom_log.h"
+#include "lwthread.h"
 #include <string.h>
 
-/** convert decimal degress to radians */
-static void
-to_rad(POINT4D *pt)
-{
-	pt->x *= M_PI/180.0;
-	pt->y *= M_PI/180.0;
-}
-
-/** convert radians to decimal degress */
-static void
-to_dec(POINT4D *pt)
-{
-	pt->x *= 180.0/M_PI;
-	pt->y *= 180.0/M_PI;
-}
-
 /***************************************************************************/
 
 LWPROJ *
@@ -153,10 +138,218 @@ lwproj_from_str_pipeline(const char* str_pipeline, bool is_forward)
 	return lp;
 }
 
+/***************************************************************************/
+
+/*
+ * Per context LRU cache of LWPROJ objects.
+ *
+ * Creating a PJ (database lookups, operation selection, ellipsoid queries)
+ * costs far more than transforming a geometry, so repeated transformations
+ * between the same definitions reuse the PJ of the first one. Entries are
+ * owned by the cache and only use the heap allocator, so they survive any
+ * arena scope they happen to be created in.
+ */
+
+typedef struct
+{
+	char *str_in;  /* Source definition, or pipeline */
+	char *str_out; /* Target definition, NULL for pipelines */
+	bool is_forward;
+	uint64_t last_used;
+	LWPROJ lp;
+} LWPROJ_CACHE_ITEM;
+
+struct LWPROJ_CACHE
+{
+	void *pj_ctx; /* PROJ context the entries were created in */
+	uint32_t size;
+	uint32_t capacity;
+	uint64_t clock;
+	uint64_t hits;
+	uint64_t misses;
+	LWPROJ_CACHE_ITEM items[LWPROJ_CACHE_MAX_ITEMS];
+};
+
+static char *
+lwproj_cache_strdup(const char *str)
+{
+	size_t len;
+	char *copy;
+
+	if (!str)
+		return NULL;
+	len = strlen(str) + 1;
+	copy = lwalloc_heap(len);
+	memcpy(copy, str, len);
+	return copy;
+}
+
+static void
+lwproj_cache_item_release(LWPROJ_CACHE_ITEM *item, bool destroy_pj)
+{
+	if (destroy_pj)
+		proj_destroy(item->lp.pj);
+	lwfree_heap(item->str_in);
+	if (item->str_out)
+		lwfree_heap(item->str_out);
+	memset(item, 0, sizeof(LWPROJ_CACHE_ITEM));
+}
+
+static LWPROJ_CACHE *
+lwproj_cache_get_context(LWGEOM_CONTEXT *ctx)
+{
+	LWPROJ_CACHE *cache = ctx->proj_cache;
+	if (!cache)
+	{
+		cache = lwalloc_heap(sizeof(LWPROJ_CACHE));
+		memset(cache, 0, sizeof(LWPROJ_CACHE));
+		cache->capacity = LWPROJ_CACHE_ITEMS;
+		cache->pj_ctx = ctx->pj_ctx;
+		ctx->proj_cache = cache;
+	}
+	/*
+	 * PJ objects are bound to the PROJ context that created them, and the
+	 * previous one may already be destroyed: forget its entries without
+	 * calling proj_destroy on them. Callers release them properly by
+	 * flushing the cache before replacing pj_ctx.
+	 */
+	else if (cache->pj_ctx != ctx->pj_ctx)
+	{
+		uint32_t i;
+		for (i = 0; i < cache->size; i++)
+			lwproj_cache_item_release(&cache->items[i], false);
+		cache->size = 0;
+		cache->pj_ctx = ctx->pj_ctx;
+	}
+	return cache;
+}
+
+static LWPROJ *
+lwproj_cache_lookup(const char *str_in, const char *str_out, bool is_forward)
+{
+	LWPROJ_CACHE *cache = lwproj_cache_get_context(lwcontext());
+	LWPROJ_CACHE_ITEM *item, *victim = NULL;
+	LWPROJ *lp;
+	uint32_t i;
+
+	for (i = 0; i < cache->size; i++)
+	{
+		item = &cache->items[i];
+		if (item->is_forward == is_forward &&
+		    (str_out ? (item->str_out && strcmp(item->str_out, str_out) == 0) : !item->str_out) &&
+		    strcmp(item->str_in, str_in) == 0)
+		{
+			item->last_used = ++cache->clock;
+			cache->hits++;
+			return &item->lp;
+		}
+	}
+
+	cache->misses++;
+	lp = str_out ? lwproj_from_str(str_in, str_out) : lwproj_from_str_pipeline(str_in, is_forward);
+	if (!lp)
+		return NULL;
+
+	/* Take a free slot, or evict the least recently used entry */
+	if (cache->size < cache->capacity)
+	{
+		victim = &cache->items[cache->size++];
+	}
+	else
+	{
+		victim = &cache->items[0];
+		for (i = 1; i < cache->size; i++)
+		{
+			if (cache->items[i].last_used < victim->last_used)
+				victim = &cache->items[i];
+		}
+		lwproj_cache_item_release(victim, true);
+	}
+
+	victim->str_in = lwproj_cache_strdup(str_in);
+	victim->str_out = lwproj_cache_strdup(str_out);
+	victim->is_forward = is_forward;
+	victim->last_used = ++cache->clock;
+	victim->lp = *lp;
+	lwfree(lp);
+	return &victim->lp;
+}
+
+LWPROJ *
+lwproj_cache_get(const char *str_in, const char *str_out)
+{
+	if (!(str_in && str_out))
+		return NULL;
+	return lwproj_cache_lookup(str_in, str_out, true);
+}
+
+LWPROJ *
+lwproj_cache_get_pipeline(const char *str_pipeline, bool is_forward)
+{
+	if (!str_pipeline)
+		return NULL;
+	return lwproj_cache_lookup(str_pipeline, NULL, is_forward);
+}
+
+void
+lwproj_cache_flush(void)
+{
+	LWGEOM_CONTEXT *ctx = lwcontext();
+	LWPROJ_CACHE *cache = ctx->proj_cache;
+	uint32_t i;
+
+	if (!cache)
+		return;
+	/* Entries of a replaced PROJ context are never destroyed here */
+	for (i = 0; i < cache->size; i++)
+		lwproj_cache_item_release(&cache->items[i], cache->pj_ctx == ctx->pj_ctx);
+	cache->size = 0;
+	cache->pj_ctx = ctx->pj_ctx;
+}
+
+void
+lwproj_cache_set_size(uint32_t capacity)
+{
+	LWPROJ_CACHE *cache = lwproj_cache_get_context(lwcontext());
+
+	if (capacity < 1)
+		capacity = 1;
+	if (capacity > LWPROJ_CACHE_MAX_ITEMS)
+		capacity = LWPROJ_CACHE_MAX_ITEMS;
+
+	/* Shrinking drops everything, it is not worth picking survivors */
+	if (capacity < cache->size)
+		lwproj_cache_flush();
+	cache->capacity = capacity;
+}
+
+void
+lwproj_cache_stats(uint64_t *hits, uint64_t *misses, uint32_t *size)
+{
+	LWPROJ_CACHE *cache = lwcontext()->proj_cache;
+	if (hits)
+		*hits = cache ? cache->hits : 0;
+	if (misses)
+		*misses = cache ? cache->misses : 0;
+	if (size)
+		*size = cache ? cache->size : 0;
+}
+
+void
+lwproj_cache_destroy(void)
+{
+	LWGEOM_CONTEXT *ctx = lwcontext();
+	if (!ctx->proj_cache)
+		return;
+	lwproj_cache_flush();
+	lwfree_heap(ctx->proj_cache);
+	ctx->proj_cache = NULL;
+}
+
 int
 lwgeom_transform_from_str(LWGEOM *geom, const char* instr, const char* outstr)
 {
-	LWPROJ *lp = lwproj_from_str(instr, outstr);
+	LWPROJ *lp = lwproj_cache_get(instr, outstr);
 	if (!lp)
 	{
 		PJ *pj_in = proj_create(lwcontext()->pj_ctx, instr);
@@ -177,16 +370,14 @@ lwgeom_transform_from_str(LWGEOM *geom, const char* instr, const char* outstr)
 		lwerror("%s: Failed to transform", __func__);
 		return LW_FAILURE;
 	}
-	int ret = lwgeom_transform(geom, lp);
-	proj_destroy(lp->pj);
-	lwfree(lp);
-	return ret;
+	/* Owned by the cache */
+	return lwgeom_transform(geom, lp);
 }
 
 int
 lwgeom_transform_pipeline(LWGEOM *geom, const char* pipelinestr, bool is_forward)
 {
-	LWPROJ *lp = lwproj_from_str_pipeline(pipelinestr, is_forward);
+	LWPROJ *lp = lwproj_cache_get_pipeline(pipelinestr, is_forward);
 	if (!lp)
 	{
 		PJ *pj_in = proj_create(lwcontext()->pj_ctx, pipelinestr);
@@ -199,10 +390,8 @@ lwgeom_transform_pipeline(LWGEOM *geom, const char* pipelinestr, bool is_forward
 		lwerror("%s: Failed to transform", __func__);
 		return LW_FAILURE;
 	}
-	int ret = lwgeom_transform(geom, lp);
-	proj_destroy(lp->pj);
-	lwfree(lp);
-	return ret;
+	/* Owned by the cache */
+	return lwgeom_transform(geom, lp);
 }
 
 int
@@ -226,34 +415,103 @@ box3d_transform(GBOX *gbox, LWPROJ *pj)
 	return ptarray_calculate_gbox_cartesian(pa, gbox);
 }
 
+/*
+ * Scale X and Y of n points laid out every stride doubles, in place.
+ * Used for the degree/radian conversions around angular PROJ operations.
+ */
+static inline void
+ptarray_scale_xy(double *d, size_t n_points, size_t stride, double factor)
+{
+	size_t i;
+	for (i = 0; i < n_points; i++, d += stride)
+	{
+		d[0] *= factor;
+		d[1] *= factor;
+	}
+}
+
+/*
+ * Transform a run of n_points points starting at d in place: conversion to
+ * radians, proj_trans_generic and conversion back to degrees, chunk by
+ * chunk so the data is still in cache for the second conversion.
+ * Does not report errors: returns the number of converted points, the PROJ
+ * error state is left on the PJ. Safe to call from worker threads with a
+ * PJ of their own.
+ */
+static size_t
+ptarray_transform_run(PJ *pj, PJ_DIRECTION direction, double *d, size_t n_points, size_t point_size,
+		      int has_z, int angular_in, int angular_out)
+{
+	size_t stride = point_size / sizeof(double);
+	size_t done = 0;
+
+	while (done < n_points)
+	{
+		size_t n = n_points - done;
+		size_t n_converted;
+		if (n > LW_TRANSFORM_CHUNK_POINTS)
+			n = LW_TRANSFORM_CHUNK_POINTS;
+
+		if (angular_in)
+			ptarray_scale_xy(d, n, stride, M_PI / 180.0);
+
+		/*
+		 * size_t proj_trans_generic(PJ *P, PJ_DIRECTION direction,
+		 * double *x, size_t sx, size_t nx,
+		 * double *y, size_t sy, size_t ny,
+		 * double *z, size_t sz, size_t nz,
+		 * double *t, size_t st, size_t nt)
+		 */
+		n_converted = proj_trans_generic(pj,
+						 direction,
+						 d,
+						 point_size,
+						 n, /* X */
+						 d + 1,
+						 point_size,
+						 n, /* Y */
+						 has_z ? d + 2 : NULL,
+						 has_z ? point_size : 0,
+						 has_z ? n : 0, /* Z */
+						 NULL,
+						 0,
+						 0 /* M */
+		);
+
+		if (angular_out)
+			ptarray_scale_xy(d, n, stride, 180.0 / M_PI);
+
+		done += n_converted;
+		if (n_converted != n)
+			break;
+		d += n * stride;
+	}
+	return done;
+}
+
 int
 ptarray_transform(POINTARRAY *pa, LWPROJ *pj)
 {
-	uint32_t i;
-	POINT4D p;
 	size_t n_converted;
 	size_t n_points = pa->npoints;
 	size_t point_size = ptarray_point_size(pa);
 	int has_z = ptarray_has_z(pa);
-	double *pa_double = (double*)(pa->serialized_pointlist);
+	double *pa_double;
 
-	PJ_DIRECTION direction = pj->pipeline_is_forward ? PJ_FWD : PJ_INV;
+	/* Views over a serialized buffer are transformed on a private copy */
+	ptarray_make_writable(pa);
+	pa_double = (double*)(pa->serialized_pointlist);
 
-	/* Convert to radians if necessary */
-	if (proj_angular_input(pj->pj, direction))
-	{
-		for (i = 0; i < pa->npoints; i++)
-		{
-			getPoint4d_p(pa, i, &p);
-			to_rad(&p);
-			ptarray_set_point4d(pa, i, &p);
-		}
-	}
+	PJ_DIRECTION direction = pj->pipeline_is_forward ? PJ_FWD : PJ_INV;
+	int angular_in = proj_angular_input(pj->pj, direction);
+	int angular_out = proj_angular_output(pj->pj, direction);
 
 	if (n_points == 1)
 	{
 		/* For single points it's faster to call proj_trans */
-		PJ_XYZT v = {pa_double[0], pa_double[1], has_z ? pa_double[2] : 0.0, 0.0};
+		double scale_in = angular_in ? M_PI / 180.0 : 1.0;
+		double scale_out = angular_out ? 180.0 / M_PI : 1.0;
+		PJ_XYZT v = {pa_double[0] * scale_in, pa_double[1] * scale_in, has_z ? pa_double[2] : 0.0, 0.0};
 		PJ_COORD c;
 		c.xyzt = v;
 		PJ_COORD t = proj_trans(pj->pj, direction, c);
@@ -264,40 +522,19 @@ ptarray_transform(POINTARRAY *pa, LWPROJ *pj)
 			lwerror("transform: %s (%d)", proj_errno_string(pj_errno_val), pj_errno_val);
 			return LW_FAILURE;
 		}
-		pa_double[0] = (t.xyzt).x;
-		pa_double[1] = (t.xyzt).y;
+		pa_double[0] = (t.xyzt).x * scale_out;
+		pa_double[1] = (t.xyzt).y * scale_out;
 		if (has_z)
 			pa_double[2] = (t.xyzt).z;
 	}
 	else
 	{
-		/*
-		 * size_t proj_trans_generic(PJ *P, PJ_DIRECTION direction,
-		 * double *x, size_t sx, size_t nx,
-		 * double *y, size_t sy, size_t ny,
-		 * double *z, size_t sz, size_t nz,
-		 * double *t, size_t st, size_t nt)
-		 */
-
-		n_converted = proj_trans_generic(pj->pj,
-						 direction,
-						 pa_double,
-						 point_size,
-						 n_points, /* X */
-						 pa_double + 1,
-						 point_size,
-						 n_points, /* Y */
-						 has_z ? pa_double + 2 : NULL,
-						 has_z ? point_size : 0,
-						 has_z ? n_points : 0, /* Z */
-						 NULL,
-						 0,
-						 0 /* M */
-		);
+		n_converted = ptarray_transform_run(
+		    pj->pj, direction, pa_double, n_points, point_size, has_z, angular_in, angular_out);
 
 		if (n_converted != n_points)
 		{
-			lwerror("ptarray_transform: converted (%d) != input (%d)", n_converted, n_points);
+			lwerror("ptarray_transform: converted (%zu) != input (%zu)", n_converted, n_points);
 			return LW_FAILURE;
 		}
 
@@ -309,20 +546,281 @@ ptarray_transform(POINTARRAY *pa, LWPROJ *pj)
 		}
 	}
 
-	/* Convert radians to degrees if necessary */
-	if (proj_angular_output(pj->pj, direction))
+	return LW_SUCCESS;
+}
+
+/*
+ * Parallel transformation: the points of all the arrays are split in one
+ * contiguous share per thread, cutting arrays where needed, so a single
+ * huge array and a multipoint of many tiny ones both spread evenly. PJ
+ * objects are not thread safe, so every extra thread works with a clone of
+ * the operation living in its own PROJ context; the calling thread keeps
+ * using the original.
+ */
+typedef struct
+{
+	double *data;
+	size_t n_points;
+	size_t point_size;
+	int has_z;
+} LWPROJ_SEGMENT;
+
+typedef struct
+{
+	PJ_CONTEXT *pj_ctx;
+	PJ *pj;
+	uint32_t first_segment;
+	uint32_t end_segment;
+	size_t n_points;
+	size_t n_converted;
+	int pj_errno;
+} LWPROJ_SLICE;
+
+typedef struct
+{
+	LWPROJ_SEGMENT *segments;
+	LWPROJ_SLICE *slices;
+	PJ_DIRECTION direction;
+	int angular_in;
+	int angular_out;
+} LWPROJ_PARALLEL;
+
+static void
+ptarray_transform_worker(void *arg, uint32_t worker)
+{
+	LWPROJ_PARALLEL *job = arg;
+	LWPROJ_SLICE *slice = &job->slices[worker];
+	uint32_t i;
+
+	for (i = slice->first_segment; i < slice->end_segment; i++)
+	{
+		LWPROJ_SEGMENT *seg = &job->segments[i];
+		size_t n = ptarray_transform_run(slice->pj,
+						 job->direction,
+						 seg->data,
+						 seg->n_points,
+						 seg->point_size,
+						 seg->has_z,
+						 job->angular_in,
+						 job->angular_out);
+		slice->n_converted += n;
+		if (n != seg->n_points)
+			break;
+	}
+	slice->pj_errno = proj_errno_reset(slice->pj);
+}
+
+static int
+ptarrays_transform_parallel(POINTARRAY **pas, uint32_t npas, LWPROJ *pj, uint32_t nthreads)
+{
+	LWPROJ_PARALLEL job;
+	LWPROJ_SLICE *slices;
+	LWPROJ_SEGMENT *segments;
+	size_t n_points = 0, per_slice, room;
+	uint32_t i, nslices, nsegments = 0;
+	int ret = LW_SUCCESS;
+
+	for (i = 0; i < npas; i++)
+		n_points += pas[i]->npoints;
+
+	nthreads = lwthread_count(nthreads, n_points, LW_TRANSFORM_PARALLEL_MIN_POINTS);
+	if (nthreads < 2)
+	{
+		for (i = 0; i < npas; i++)
+		{
+			if (pas[i]->npoints && !ptarray_transform(pas[i], pj))
+				return LW_FAILURE;
+		}
+		return LW_SUCCESS;
+	}
+
+	job.direction = pj->pipeline_is_forward ? PJ_FWD : PJ_INV;
+	job.angular_in = proj_angular_input(pj->pj, job.direction);
+	job.angular_out = proj_angular_output(pj->pj, job.direction);
+	job.slices = slices = lwalloc(sizeof(LWPROJ_SLICE) * nthreads);
+	memset(slices, 0, sizeof(LWPROJ_SLICE) * nthreads);
+
+	/* Clone the operation for the extra threads, use less if it fails */
+	slices[0].pj = pj->pj;
+	for (nslices = 1; nslices < nthreads; nslices++)
 	{
-		for (i = 0; i < pa->npoints; i++)
+		PJ_CONTEXT *pj_ctx = proj_context_create();
+		PJ *clone = pj_ctx ? proj_clone(pj_ctx, pj->pj) : NULL;
+		if (!clone)
 		{
-			getPoint4d_p(pa, i, &p);
-			to_dec(&p);
-			ptarray_set_point4d(pa, i, &p);
+			if (pj_ctx)
+				proj_context_destroy(pj_ctx);
+			break;
 		}
+		slices[nslices].pj_ctx = pj_ctx;
+		slices[nslices].pj = clone;
 	}
 
+	/* Cut the arrays into segments, each slice gets per_slice points */
+	job.segments = segments = lwalloc(sizeof(LWPROJ_SEGMENT) * (npas + nslices));
+	per_slice = (n_points + nslices - 1) / nslices;
+	room = per_slice;
+	slices[0].first_segment = 0;
+	for (i = 0; i < npas; i++)
+	{
+		POINTARRAY *pa = pas[i];
+		size_t point_size = ptarray_point_size(pa);
+		size_t done = 0;
+
+		/* Views over a serialized buffer are transformed on a private copy */
+		if (pa->npoints)
+			ptarray_make_writable(pa);
+
+		while (done < pa->npoints)
+		{
+			LWPROJ_SEGMENT *seg = &segments[nsegments++];
+			seg->n_points = pa->npoints - done < room ? pa->npoints - done : room;
+			seg->data = (double *)(pa->serialized_pointlist + done * point_size);
+			seg->point_size = point_size;
+			seg->has_z = ptarray_has_z(pa);
+			done += seg->n_points;
+			room -= seg->n_points;
+			if (!room)
+				room = per_slice;
+		}
+	}
+
+	/* Assign consecutive segments to the slices */
+	{
+		uint32_t s = 0;
+		size_t filled = 0;
+		for (i = 0; i < nsegments; i++)
+		{
+			if (filled == per_slice && s + 1 < nslices)
+			{
+				slices[s].end_segment = i;
+				slices[++s].first_segment = i;
+				filled = 0;
+			}
+			filled += segments[i].n_points;
+			slices[s].n_points += segments[i].n_points;
+		}
+		slices[s].end_segment = nsegments;
+		for (s = s + 1; s < nslices; s++)
+			slices[s].first_segment = slices[s].end_segment = nsegments;
+	}
+
+	lwthread_run(nslices, ptarray_transform_worker, &job);
+
+	for (i = 0; i < nslices; i++)
+	{
+		if (ret == LW_SUCCESS && slices[i].n_converted != slices[i].n_points)
+		{
+			lwerror("ptarray_transform: converted (%zu) != input (%zu)",
+				slices[i].n_converted, slices[i].n_points);
+			ret = LW_FAILURE;
+		}
+		else if (ret == LW_SUCCESS && slices[i].pj_errno)
+		{
+			lwerror("transform: %s (%d)", proj_errno_string(slices[i].pj_errno), slices[i].pj_errno);
+			ret = LW_FAILURE;
+		}
+		if (i)
+		{
+			proj_destroy(slices[i].pj);
+			proj_context_destroy(slices[i].pj_ctx);
+		}
+	}
+	lwfree(segments);
+	lwfree(slices);
+	return ret;
+}
+
+int
+ptarray_transform_parallel(POINTARRAY *pa, LWPROJ *pj, uint32_t nthreads)
+{
+	return ptarrays_transform_parallel(&pa, 1, pj, nthreads);
+}
+
+/* Gather the point arrays of a geometry, in storage order */
+static int
+lwgeom_collect_ptarrays(LWGEOM *geom, POINTARRAY ***pas, uint32_t *npas, uint32_t *maxpas)
+{
+	uint32_t i;
+
+	if (lwgeom_is_empty(geom))
+		return LW_SUCCESS;
+
+	switch (geom->type)
+	{
+	case POINTTYPE:
+	case LINETYPE:
+	case CIRCSTRINGTYPE:
+	case TRIANGLETYPE:
+	{
+		LWLINE *g = (LWLINE *)geom;
+		if (*npas == *maxpas)
+		{
+			*maxpas *= 2;
+			*pas = lwrealloc(*pas, sizeof(POINTARRAY *) * (*maxpas));
+		}
+		(*pas)[(*npas)++] = g->points;
+		break;
+	}
+	case POLYGONTYPE:
+	{
+		LWPOLY *g = (LWPOLY *)geom;
+		if (*npas + g->nrings > *maxpas)
+		{
+			while (*npas + g->nrings > *maxpas)
+				*maxpas *= 2;
+			*pas = lwrealloc(*pas, sizeof(POINTARRAY *) * (*maxpas));
+		}
+		for (i = 0; i < g->nrings; i++)
+			(*pas)[(*npas)++] = g->rings[i];
+		break;
+	}
+	case MULTIPOINTTYPE:
+	case MULTILINETYPE:
+	case MULTIPOLYGONTYPE:
+	case COLLECTIONTYPE:
+	case COMPOUNDTYPE:
+	case CURVEPOLYTYPE:
+	case MULTICURVETYPE:
+	case MULTISURFACETYPE:
+	case POLYHEDRALSURFACETYPE:
+	case TINTYPE:
+	{
+		LWCOLLECTION *g = (LWCOLLECTION *)geom;
+		for (i = 0; i < g->ngeoms; i++)
+		{
+			if (!lwgeom_collect_ptarrays(g->geoms[i], pas, npas, maxpas))
+				return LW_FAILURE;
+		}
+		break;
+	}
+	default:
+	{
+		lwerror("lwgeom_transform: Cannot handle type '%s'", lwtype_name(geom->type));
+		return LW_FAILURE;
+	}
+	}
 	return LW_SUCCESS;
 }
 
+int
+lwgeom_transform_parallel(LWGEOM *geom, LWPROJ *pj, uint32_t nthreads)
+{
+	POINTARRAY **pas;
+	uint32_t npas = 0, maxpas = 8;
+	int ret;
+
+	if (nthreads == 1 || lwgeom_is_empty(geom))
+		return lwgeom_transform(geom, pj);
+
+	pas = lwalloc(sizeof(POINTARRAY *) * maxpas);
+	ret = lwgeom_collect_ptarrays(geom, &pas, &npas, &maxpas);
+	if (ret)
+		ret = ptarrays_transform_parallel(pas, npas, pj, nthreads);
+	lwfree(pas);
+	return ret;
+}
+
 /**
  * Transform given LWGEOM geometry
  * from inpj projection to outpj projection
@@ -0,0 +1,486 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include "liblwgeom_internal.h"
+#include "lwgeom_log.h"
+#include "lwhrtree.h"
+
+typedef struct
+{
+	uint64_t key;
+	uint64_t item;
+} LWHRTREE_SORT_ITEM;
+
+static int
+lwhrtree_sort_cmp(const void *a, const void *b)
+{
+	const LWHRTREE_SORT_ITEM *ia = a;
+	const LWHRTREE_SORT_ITEM *ib = b;
+	if (ia->key != ib->key)
+		return ia->key < ib->key ? -1 : 1;
+	/* Keep equal keys in input order, like the radix sort */
+	if (ia->item != ib->item)
+		return ia->item < ib->item ? -1 : 1;
+	return 0;
+}
+
+/*
+* Stable LSD radix sort on the keys, 16 bits at a time. Passes where every
+* key has the same digit are skipped, which leaves two of them for the
+* 32 bit keys of a 16 bit grid. Inputs smaller than the digit range are
+* cheaper to qsort.
+*/
+#define LWHRTREE_RADIX_BITS 16
+#define LWHRTREE_RADIX_SIZE (1 << LWHRTREE_RADIX_BITS)
+
+static void
+lwhrtree_sort(LWHRTREE_SORT_ITEM *items, uint64_t num_items)
+{
+	LWHRTREE_SORT_ITEM *tmp, *src = items, *dst, *swap;
+	uint64_t *count;
+	uint64_t i, pos, c;
+	uint32_t shift, d;
+
+	if (num_items < LWHRTREE_RADIX_SIZE)
+	{
+		qsort(items, num_items, sizeof(LWHRTREE_SORT_ITEM), lwhrtree_sort_cmp);
+		return;
+	}
+
+	dst = tmp = lwalloc(num_items * sizeof(LWHRTREE_SORT_ITEM));
+	count = lwalloc(LWHRTREE_RADIX_SIZE * sizeof(uint64_t));
+
+	for (shift = 0; shift < 64; shift += LWHRTREE_RADIX_BITS)
+	{
+		memset(count, 0, LWHRTREE_RADIX_SIZE * sizeof(uint64_t));
+		for (i = 0; i < num_items; i++)
+			count[(src[i].key >> shift) & (LWHRTREE_RADIX_SIZE - 1)]++;
+		if (count[(src[0].key >> shift) & (LWHRTREE_RADIX_SIZE - 1)] == num_items)
+			continue;
+
+		for (d = 0, pos = 0; d < LWHRTREE_RADIX_SIZE; d++)
+		{
+			c = count[d];
+			count[d] = pos;
+			pos += c;
+		}
+		for (i = 0; i < num_items; i++)
+			dst[count[(src[i].key >> shift) & (LWHRTREE_RADIX_SIZE - 1)]++] = src[i];
+
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	if (src != items)
+		memcpy(items, src, num_items * sizeof(LWHRTREE_SORT_ITEM));
+	lwfree(count);
+	lwfree(tmp);
+}
+
+/*
+* Level sizes, from the items up to a single root. Even one item gets a
+* root above its leaf, like in FlatGeobuf.
+*/
+static int
+lwhrtree_init_levels(LWHRTREE *tree, uint64_t num_items, uint32_t node_size)
+{
+	uint64_t level_nodes[LWHRTREE_MAX_LEVELS];
+	uint64_t n = num_items, num_nodes = num_items, end;
+	uint32_t i, num_levels = 1;
+
+	if (node_size < 2)
+	{
+		lwerror("%s: node size must be at least 2, got %u", __func__, node_size);
+		return LW_FAILURE;
+	}
+
+	level_nodes[0] = n;
+	do
+	{
+		if (num_levels == LWHRTREE_MAX_LEVELS)
+		{
+			lwerror("%s: too many levels", __func__);
+			return LW_FAILURE;
+		}
+		n = (n + node_size - 1) / node_size;
+		level_nodes[num_levels++] = n;
+		num_nodes += n;
+	} while (n != 1);
+
+	/* Leaves go last, the root first */
+	end = num_nodes;
+	for (i = 0; i < num_levels; i++)
+	{
+		tree->level_bounds[i][0] = end - level_nodes[i];
+		tree->level_bounds[i][1] = end;
+		end -= level_nodes[i];
+	}
+
+	tree->num_items = num_items;
+	tree->num_nodes = num_nodes;
+	tree->node_size = node_size;
+	tree->num_levels = num_levels;
+	return LW_SUCCESS;
+}
+
+/* Grid cell of v, clamped so that empty, infinite and NaN boxes get one too */
+static inline uint32_t
+lwhrtree_grid(double v)
+{
+	return v > 0.0 ? (v < (double)UINT16_MAX ? (uint32_t)v : UINT16_MAX) : 0;
+}
+
+static inline void
+lwhrtree_node_expand(LWHRTREE_NODE *node, const LWHRTREE_NODE *child)
+{
+	if (child->xmin < node->xmin) node->xmin = child->xmin;
+	if (child->ymin < node->ymin) node->ymin = child->ymin;
+	if (child->xmax > node->xmax) node->xmax = child->xmax;
+	if (child->ymax > node->ymax) node->ymax = child->ymax;
+}
+
+LWHRTREE *
+lwhrtree_create(const GBOX *boxes, uint64_t num_items, uint32_t node_size)
+{
+	LWHRTREE *tree;
+	LWHRTREE_SORT_ITEM *sorted;
+	double xmin = DBL_MAX, ymin = DBL_MAX, xmax = -DBL_MAX, ymax = -DBL_MAX;
+	double xscale, yscale;
+	uint64_t i;
+	uint32_t level;
+
+	if (!boxes || !num_items)
+		return NULL;
+
+	tree = lwalloc(sizeof(LWHRTREE));
+	memset(tree, 0, sizeof(LWHRTREE));
+	if (lwhrtree_init_levels(tree, num_items, node_size ? node_size : LWHRTREE_NODE_SIZE) == LW_FAILURE)
+	{
+		lwfree(tree);
+		return NULL;
+	}
+	tree->nodes = lwalloc(tree->num_nodes * sizeof(LWHRTREE_NODE));
+	tree->owns_nodes = LW_TRUE;
+
+	for (i = 0; i < num_items; i++)
+	{
+		if (boxes[i].xmin < xmin) xmin = boxes[i].xmin;
+		if (boxes[i].ymin < ymin) ymin = boxes[i].ymin;
+		if (boxes[i].xmax > xmax) xmax = boxes[i].xmax;
+		if (boxes[i].ymax > ymax) ymax = boxes[i].ymax;
+	}
+
+	/* Centers on a 2^16 x 2^16 grid over the extent, like FlatGeobuf, sorted along the curve */
+	xscale = xmax > xmin ? (double)UINT16_MAX / (xmax - xmin) : 0.0;
+	yscale = ymax > ymin ? (double)UINT16_MAX / (ymax - ymin) : 0.0;
+	sorted = lwalloc(num_items * sizeof(LWHRTREE_SORT_ITEM));
+	for (i = 0; i < num_items; i++)
+	{
+		double cx = (boxes[i].xmin + boxes[i].xmax) / 2.0;
+		double cy = (boxes[i].ymin + boxes[i].ymax) / 2.0;
+		sorted[i].key = uint32_hilbert(lwhrtree_grid((cx - xmin) * xscale), lwhrtree_grid((cy - ymin) * yscale));
+		sorted[i].item = i;
+	}
+	lwhrtree_sort(sorted, num_items);
+
+	for (i = 0; i < num_items; i++)
+	{
+		LWHRTREE_NODE *leaf = &tree->nodes[tree->level_bounds[0][0] + i];
+		const GBOX *box = &boxes[sorted[i].item];
+		leaf->xmin = box->xmin;
+		leaf->ymin = box->ymin;
+		leaf->xmax = box->xmax;
+		leaf->ymax = box->ymax;
+		leaf->offset = sorted[i].item;
+	}
+	lwfree(sorted);
+
+	/* Pack every level into the one above it */
+	for (level = 0; level + 1 < tree->num_levels; level++)
+	{
+		uint64_t pos = tree->level_bounds[level][0];
+		uint64_t end = tree->level_bounds[level][1];
+		uint64_t parent = tree->level_bounds[level + 1][0];
+
+		while (pos < end)
+		{
+			LWHRTREE_NODE *node = &tree->nodes[parent++];
+			uint64_t last = pos + tree->node_size < end ? pos + tree->node_size : end;
+			/* From an empty box, so that NaN children cannot spoil it */
+			node->xmin = node->ymin = INFINITY;
+			node->xmax = node->ymax = -INFINITY;
+			node->offset = pos;
+			for (; pos < last; pos++)
+				lwhrtree_node_expand(node, &tree->nodes[pos]);
+		}
+	}
+
+	return tree;
+}
+
+void
+lwhrtree_free(LWHRTREE *tree)
+{
+	if (!tree)
+		return;
+	if (tree->owns_nodes)
+		lwfree(tree->nodes);
+	lwfree(tree);
+}
+
+static inline int
+lwhrtree_node_overlaps(const LWHRTREE_NODE *node, const GBOX *query)
+{
+	return node->xmin <= query->xmax && node->xmax >= query->xmin &&
+	       node->ymin <= query->ymax && node->ymax >= query->ymin;
+}
+
+uint64_t
+lwhrtree_query_visit(const LWHRTREE *tree, const GBOX *query, lwhrtree_visitor visitor, void *data)
+{
+	/* Depth first, one pending node range per level */
+	struct
+	{
+		uint64_t pos;
+		uint64_t end;
+	} stack[LWHRTREE_MAX_LEVELS];
+	int top = 0;
+	uint32_t level;
+	uint64_t found = 0;
+
+	if (!tree || !query)
+		return 0;
+
+	level = tree->num_levels - 1;
+	stack[0].pos = 0;
+	stack[0].end = 1;
+
+	while (top >= 0)
+	{
+		const LWHRTREE_NODE *node;
+
+		if (stack[top].pos == stack[top].end)
+		{
+			/* Range done, back to the parent level */
+			top--;
+			level++;
+			continue;
+		}
+
+		node = &tree->nodes[stack[top].pos++];
+		if (!lwhrtree_node_overlaps(node, query))
+			continue;
+
+		if (level == 0)
+		{
+			found++;
+			if (visitor && !visitor(node, data))
+				break;
+		}
+		else
+		{
+			uint64_t first = node->offset;
+			uint64_t end = tree->level_bounds[level - 1][1];
+			/* Views share the caller buffer, which may change after loading */
+			if (first < tree->level_bounds[level - 1][0] || first >= end)
+				continue;
+			top++;
+			level--;
+			stack[top].pos = first;
+			stack[top].end = first + tree->node_size < end ? first + tree->node_size : end;
+		}
+	}
+
+	return found;
+}
+
+typedef struct
+{
+	uint64_t *items;
+	uint64_t num_items;
+	uint64_t capacity;
+} LWHRTREE_RESULT;
+
+static int
+lwhrtree_collect(const LWHRTREE_NODE *leaf, void *data)
+{
+	LWHRTREE_RESULT *result = data;
+	if (result->num_items == result->capacity)
+	{
+		result->capacity = result->capacity ? 2 * result->capacity : 64;
+		result->items = lwrealloc(result->items, result->capacity * sizeof(uint64_t));
+	}
+	result->items[result->num_items++] = leaf->offset;
+	return LW_TRUE;
+}
+
+uint64_t *
+lwhrtree_query(const LWHRTREE *tree, const GBOX *query, uint64_t *num_found)
+{
+	LWHRTREE_RESULT result = {NULL, 0, 0};
+	lwhrtree_query_visit(tree, query, lwhrtree_collect, &result);
+	*num_found = result.num_items;
+	return result.items;
+}
+
+int
+lwhrtree_extent(const LWHRTREE *tree, GBOX *extent)
+{
+	if (!tree)
+		return LW_FAILURE;
+	memset(extent, 0, sizeof(GBOX));
+	extent->xmin = tree->nodes[0].xmin;
+	extent->ymin = tree->nodes[0].ymin;
+	extent->xmax = tree->nodes[0].xmax;
+	extent->ymax = tree->nodes[0].ymax;
+	return LW_SUCCESS;
+}
+
+size_t
+lwhrtree_buffer_size(uint64_t num_items, uint32_t node_size)
+{
+	LWHRTREE tree;
+	if (!num_items || lwhrtree_init_levels(&tree, num_items, node_size ? node_size : LWHRTREE_NODE_SIZE) == LW_FAILURE)
+		return 0;
+	return tree.num_nodes * sizeof(LWHRTREE_NODE);
+}
+
+#if IS_BIG_ENDIAN
+static void
+lwhrtree_swap_nodes(LWHRTREE_NODE *nodes, uint64_t num_nodes)
+{
+	uint8_t *b = (uint8_t *)nodes;
+	size_t i, j, nwords = num_nodes * sizeof(LWHRTREE_NODE) / 8;
+	for (i = 0; i < nwords; i++, b += 8)
+	{
+		for (j = 0; j < 4; j++)
+		{
+			uint8_t tmp = b[j];
+			b[j] = b[7 - j];
+			b[7 - j] = tmp;
+		}
+	}
+}
+#endif
+
+uint8_t *
+lwhrtree_to_buffer(const LWHRTREE *tree, size_t *size)
+{
+	uint8_t *buf;
+	size_t bytes;
+
+	if (!tree)
+	{
+		*size = 0;
+		return NULL;
+	}
+	bytes = tree->num_nodes * sizeof(LWHRTREE_NODE);
+	buf = lwalloc(bytes);
+	memcpy(buf, tree->nodes, bytes);
+#if IS_BIG_ENDIAN
+	lwhrtree_swap_nodes((LWHRTREE_NODE *)buf, tree->num_nodes);
+#endif
+	*size = bytes;
+	return buf;
+}
+
+/*
+ * Nodes read from a buffer point where the buffer says. Leaves must stay
+ * below max_offset, and internal nodes name the first child of the packed
+ * layout built by lwhrtree_create, so that queries stay inside the array.
+ */
+static int
+lwhrtree_check_nodes(const LWHRTREE *tree, uint64_t max_offset)
+{
+	uint64_t i;
+	uint32_t level;
+
+	for (i = tree->level_bounds[0][0]; i < tree->level_bounds[0][1]; i++)
+	{
+		if (tree->nodes[i].offset >= max_offset)
+			return LW_FAILURE;
+	}
+	for (level = 1; level < tree->num_levels; level++)
+	{
+		uint64_t first = tree->level_bounds[level - 1][0];
+		for (i = tree->level_bounds[level][0]; i < tree->level_bounds[level][1]; i++)
+		{
+			if (tree->nodes[i].offset != first)
+				return LW_FAILURE;
+			first += tree->node_size;
+		}
+	}
+	return LW_SUCCESS;
+}
+
+LWHRTREE *
+lwhrtree_from_buffer(const uint8_t *buf, size_t size, uint64_t num_items, uint32_t node_size)
+{
+	return lwhrtree_from_buffer_offsets(buf, size, num_items, node_size, num_items);
+}
+
+LWHRTREE *
+lwhrtree_from_buffer_offsets(const uint8_t *buf, size_t size, uint64_t num_items, uint32_t node_size, uint64_t max_offset)
+{
+	LWHRTREE *tree;
+
+	if (!buf || !num_items)
+		return NULL;
+
+	tree = lwalloc(sizeof(LWHRTREE));
+	memset(tree, 0, sizeof(LWHRTREE));
+	if (lwhrtree_init_levels(tree, num_items, node_size ? node_size : LWHRTREE_NODE_SIZE) == LW_FAILURE)
+	{
+		lwfree(tree);
+		return NULL;
+	}
+	if (size != tree->num_nodes * sizeof(LWHRTREE_NODE))
+	{
+		lwerror("%s: buffer size does not match the number of items", __func__);
+		lwfree(tree);
+		return NULL;
+	}
+
+#if ! IS_BIG_ENDIAN
+	if (((uintptr_t)buf % sizeof(double)) == 0)
+	{
+		tree->nodes = (LWHRTREE_NODE *)buf;
+		tree->owns_nodes = LW_FALSE;
+	}
+	else
+#endif
+	{
+		tree->nodes = lwalloc(size);
+		memcpy(tree->nodes, buf, size);
+#if IS_BIG_ENDIAN
+		lwhrtree_swap_nodes(tree->nodes, tree->num_nodes);
+#endif
+		tree->owns_nodes = LW_TRUE;
+	}
+
+	if (lwhrtree_check_nodes(tree, max_offset) == LW_FAILURE)
+	{
+		lwerror("%s: buffer has node offsets out of range", __func__);
+		lwhrtree_free(tree);
+		return NULL;
+	}
+	return tree;
+}
@@ -0,0 +1,123 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#ifndef _LWHRTREE_H
+#define _LWHRTREE_H 1
+
+#include "liblwgeom.h"
+
+/*
+ * Static packed Hilbert R-tree over an array of 2D boxes.
+ *
+ * The items are sorted along the Hilbert curve of their box centers and
+ * packed bottom up, node_size children per node. All the nodes live in
+ * one flat array, root first and leaves last, with the same layout as the
+ * FlatGeobuf spatial index: a node is four doubles and a 64 bit offset,
+ * which is the index of the first child for internal nodes and the index
+ * of the item in the input array for leaves.
+ *
+ * The array has no pointers, so its bytes can be written next to the
+ * geometries and memory-mapped back with lwhrtree_from_buffer.
+ */
+
+/* Default number of children per node */
+#define LWHRTREE_NODE_SIZE 16
+
+/* Enough for 2^64 items with the smallest node size */
+#define LWHRTREE_MAX_LEVELS 64
+
+typedef struct
+{
+	double xmin;
+	double ymin;
+	double xmax;
+	double ymax;
+	uint64_t offset; /* First child for internal nodes, item for leaves */
+} LWHRTREE_NODE;
+
+typedef struct
+{
+	uint64_t num_items;
+	uint64_t num_nodes;
+	uint32_t node_size;
+	uint32_t num_levels;
+	/* Node range [start, end) of every level, leaves first */
+	uint64_t level_bounds[LWHRTREE_MAX_LEVELS][2];
+	LWHRTREE_NODE *nodes;
+	int owns_nodes; /* LW_FALSE for trees viewing a caller buffer */
+} LWHRTREE;
+
+/**
+* Visitor of the items found by a query, gets the leaf node of every
+* item. Returns LW_TRUE to go on, LW_FALSE to stop the query.
+*/
+typedef int (*lwhrtree_visitor)(const LWHRTREE_NODE *leaf, void *data);
+
+/**
+* Bulk load a tree over num_items boxes, only their X and Y ranges are
+* used. A node_size of zero means LWHRTREE_NODE_SIZE.
+* NULL when there are no items.
+*/
+LWHRTREE *lwhrtree_create(const GBOX *boxes, uint64_t num_items, uint32_t node_size);
+void lwhrtree_free(LWHRTREE *tree);
+
+/**
+* Call visitor on every item whose box overlaps query, boundaries
+* included. Returns the number of items visited.
+*/
+uint64_t lwhrtree_query_visit(const LWHRTREE *tree, const GBOX *query, lwhrtree_visitor visitor, void *data);
+
+/**
+* Indexes of the items whose box overlaps query, in tree order.
+* Caller must lwfree the result, NULL when nothing matches.
+*/
+uint64_t *lwhrtree_query(const LWHRTREE *tree, const GBOX *query, uint64_t *num_found);
+
+/**
+* Box of all the items. Returns LW_FAILURE for a NULL tree.
+*/
+int lwhrtree_extent(const LWHRTREE *tree, GBOX *extent);
+
+/**
+* Bytes of the serialized node array of a tree over num_items items.
+*/
+size_t lwhrtree_buffer_size(uint64_t num_items, uint32_t node_size);
+
+/**
+* Copy of the node array in little endian order, the serialized form of
+* the tree. Caller must lwfree the result.
+*/
+uint8_t *lwhrtree_to_buffer(const LWHRTREE *tree, size_t *size);
+
+/**
+* Tree over a serialized node array. On little endian hosts an aligned
+* buffer is used in place, so it must outlive the tree; otherwise the
+* nodes are copied. NULL, with an error, when the size does not match, a
+* leaf names no item or an internal node does not point to its children.
+*/
+LWHRTREE *lwhrtree_from_buffer(const uint8_t *buf, size_t size, uint64_t num_items, uint32_t node_size);
+
+/**
+* Same, for leaves that hold offsets below max_offset rather than item
+* indexes, such as byte offsets into a file that follows the index.
+*/
+LWHRTREE *lwhrtree_from_buffer_offsets(const uint8_t *buf, size_t size, uint64_t num_items, uint32_t node_size, uint64_t max_offset);
+
+#endif /* _LWHRTREE_H */
@@ -0,0 +1,276 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <float.h>
+#include <string.h>
+
+#include "liblwgeom_internal.h"
+
+/*
+ * Decimal to double conversion for the text readers (Clinger fast path,
+ * then Eisel-Lemire). They scan the digits with their own grammar into
+ * a mantissa w of at most 19 digits and a power of ten q.
+ *
+ * lw_decimal_pow5[q + 64] holds the 128 most significant bits of 5^q,
+ * rounded up for negative q. Exponents outside of [-64, 64], subnormal
+ * results and the rare products too close to call are left to strtod.
+ */
+#define LW_DECIMAL_MIN_POW10 -64
+#define LW_DECIMAL_MAX_POW10 64
+
+static const uint64_t lw_decimal_pow5[][2] = {
+	{0xA87FEA27A539E9A5ULL, 0x3F2398D747B36224ULL}, /* -64 */
+	{0xD29FE4B18E88640EULL, 0x8EEC7F0D19A03AADULL}, /* -63 */
+	{0x83A3EEEEF9153E89ULL, 0x1953CF68300424ACULL}, /* -62 */
+	{0xA48CEAAAB75A8E2BULL, 0x5FA8C3423C052DD7ULL}, /* -61 */
+	{0xCDB02555653131B6ULL, 0x3792F412CB06794DULL}, /* -60 */
+	{0x808E17555F3EBF11ULL, 0xE2BBD88BBEE40BD0ULL}, /* -59 */
+	{0xA0B19D2AB70E6ED6ULL, 0x5B6ACEAEAE9D0EC4ULL}, /* -58 */
+	{0xC8DE047564D20A8BULL, 0xF245825A5A445275ULL}, /* -57 */
+	{0xFB158592BE068D2EULL, 0xEED6E2F0F0D56712ULL}, /* -56 */
+	{0x9CED737BB6C4183DULL, 0x55464DD69685606BULL}, /* -55 */
+	{0xC428D05AA4751E4CULL, 0xAA97E14C3C26B886ULL}, /* -54 */
+	{0xF53304714D9265DFULL, 0xD53DD99F4B3066A8ULL}, /* -53 */
+	{0x993FE2C6D07B7FABULL, 0xE546A8038EFE4029ULL}, /* -52 */
+	{0xBF8FDB78849A5F96ULL, 0xDE98520472BDD033ULL}, /* -51 */
+	{0xEF73D256A5C0F77CULL, 0x963E66858F6D4440ULL}, /* -50 */
+	{0x95A8637627989AADULL, 0xDDE7001379A44AA8ULL}, /* -49 */
+	{0xBB127C53B17EC159ULL, 0x5560C018580D5D52ULL}, /* -48 */
+	{0xE9D71B689DDE71AFULL, 0xAAB8F01E6E10B4A6ULL}, /* -47 */
+	{0x9226712162AB070DULL, 0xCAB3961304CA70E8ULL}, /* -46 */
+	{0xB6B00D69BB55C8D1ULL, 0x3D607B97C5FD0D22ULL}, /* -45 */
+	{0xE45C10C42A2B3B05ULL, 0x8CB89A7DB77C506AULL}, /* -44 */
+	{0x8EB98A7A9A5B04E3ULL, 0x77F3608E92ADB242ULL}, /* -43 */
+	{0xB267ED1940F1C61CULL, 0x55F038B237591ED3ULL}, /* -42 */
+	{0xDF01E85F912E37A3ULL, 0x6B6C46DEC52F6688ULL}, /* -41 */
+	{0x8B61313BBABCE2C6ULL, 0x2323AC4B3B3DA015ULL}, /* -40 */
+	{0xAE397D8AA96C1B77ULL, 0xABEC975E0A0D081AULL}, /* -39 */
+	{0xD9C7DCED53C72255ULL, 0x96E7BD358C904A21ULL}, /* -38 */
+	{0x881CEA14545C7575ULL, 0x7E50D64177DA2E54ULL}, /* -37 */
+	{0xAA242499697392D2ULL, 0xDDE50BD1D5D0B9E9ULL}, /* -36 */
+	{0xD4AD2DBFC3D07787ULL, 0x955E4EC64B44E864ULL}, /* -35 */
+	{0x84EC3C97DA624AB4ULL, 0xBD5AF13BEF0B113EULL}, /* -34 */
+	{0xA6274BBDD0FADD61ULL, 0xECB1AD8AEACDD58EULL}, /* -33 */
+	{0xCFB11EAD453994BAULL, 0x67DE18EDA5814AF2ULL}, /* -32 */
+	{0x81CEB32C4B43FCF4ULL, 0x80EACF948770CED7ULL}, /* -31 */
+	{0xA2425FF75E14FC31ULL, 0xA1258379A94D028DULL}, /* -30 */
+	{0xCAD2F7F5359A3B3EULL, 0x096EE45813A04330ULL}, /* -29 */
+	{0xFD87B5F28300CA0DULL, 0x8BCA9D6E188853FCULL}, /* -28 */
+	{0x9E74D1B791E07E48ULL, 0x775EA264CF55347EULL}, /* -27 */
+	{0xC612062576589DDAULL, 0x95364AFE032A819EULL}, /* -26 */
+	{0xF79687AED3EEC551ULL, 0x3A83DDBD83F52205ULL}, /* -25 */
+	{0x9ABE14CD44753B52ULL, 0xC4926A9672793543ULL}, /* -24 */
+	{0xC16D9A0095928A27ULL, 0x75B7053C0F178294ULL}, /* -23 */
+	{0xF1C90080BAF72CB1ULL, 0x5324C68B12DD6339ULL}, /* -22 */
+	{0x971DA05074DA7BEEULL, 0xD3F6FC16EBCA5E04ULL}, /* -21 */
+	{0xBCE5086492111AEAULL, 0x88F4BB1CA6BCF585ULL}, /* -20 */
+	{0xEC1E4A7DB69561A5ULL, 0x2B31E9E3D06C32E6ULL}, /* -19 */
+	{0x9392EE8E921D5D07ULL, 0x3AFF322E62439FD0ULL}, /* -18 */
+	{0xB877AA3236A4B449ULL, 0x09BEFEB9FAD487C3ULL}, /* -17 */
+	{0xE69594BEC44DE15BULL, 0x4C2EBE687989A9B4ULL}, /* -16 */
+	{0x901D7CF73AB0ACD9ULL, 0x0F9D37014BF60A11ULL}, /* -15 */
+	{0xB424DC35095CD80FULL, 0x538484C19EF38C95ULL}, /* -14 */
+	{0xE12E13424BB40E13ULL, 0x2865A5F206B06FBAULL}, /* -13 */
+	{0x8CBCCC096F5088CBULL, 0xF93F87B7442E45D4ULL}, /* -12 */
+	{0xAFEBFF0BCB24AAFEULL, 0xF78F69A51539D749ULL}, /* -11 */
+	{0xDBE6FECEBDEDD5BEULL, 0xB573440E5A884D1CULL}, /* -10 */
+	{0x89705F4136B4A597ULL, 0x31680A88F8953031ULL}, /* -9 */
+	{0xABCC77118461CEFCULL, 0xFDC20D2B36BA7C3EULL}, /* -8 */
+	{0xD6BF94D5E57A42BCULL, 0x3D32907604691B4DULL}, /* -7 */
+	{0x8637BD05AF6C69B5ULL, 0xA63F9A49C2C1B110ULL}, /* -6 */
+	{0xA7C5AC471B478423ULL, 0x0FCF80DC33721D54ULL}, /* -5 */
+	{0xD1B71758E219652BULL, 0xD3C36113404EA4A9ULL}, /* -4 */
+	{0x83126E978D4FDF3BULL, 0x645A1CAC083126EAULL}, /* -3 */
+	{0xA3D70A3D70A3D70AULL, 0x3D70A3D70A3D70A4ULL}, /* -2 */
+	{0xCCCCCCCCCCCCCCCCULL, 0xCCCCCCCCCCCCCCCDULL}, /* -1 */
+	{0x8000000000000000ULL, 0x0000000000000000ULL}, /* 0 */
+	{0xA000000000000000ULL, 0x0000000000000000ULL}, /* 1 */
+	{0xC800000000000000ULL, 0x0000000000000000ULL}, /* 2 */
+	{0xFA00000000000000ULL, 0x0000000000000000ULL}, /* 3 */
+	{0x9C40000000000000ULL, 0x0000000000000000ULL}, /* 4 */
+	{0xC350000000000000ULL, 0x0000000000000000ULL}, /* 5 */
+	{0xF424000000000000ULL, 0x0000000000000000ULL}, /* 6 */
+	{0x9896800000000000ULL, 0x0000000000000000ULL}, /* 7 */
+	{0xBEBC200000000000ULL, 0x0000000000000000ULL}, /* 8 */
+	{0xEE6B280000000000ULL, 0x0000000000000000ULL}, /* 9 */
+	{0x9502F90000000000ULL, 0x0000000000000000ULL}, /* 10 */
+	{0xBA43B74000000000ULL, 0x0000000000000000ULL}, /* 11 */
+	{0xE8D4A51000000000ULL, 0x0000000000000000ULL}, /* 12 */
+	{0x9184E72A00000000ULL, 0x0000000000000000ULL}, /* 13 */
+	{0xB5E620F480000000ULL, 0x0000000000000000ULL}, /* 14 */
+	{0xE35FA931A0000000ULL, 0x0000000000000000ULL}, /* 15 */
+	{0x8E1BC9BF04000000ULL, 0x0000000000000000ULL}, /* 16 */
+	{0xB1A2BC2EC5000000ULL, 0x0000000000000000ULL}, /* 17 */
+	{0xDE0B6B3A76400000ULL, 0x0000000000000000ULL}, /* 18 */
+	{0x8AC7230489E80000ULL, 0x0000000000000000ULL}, /* 19 */
+	{0xAD78EBC5AC620000ULL, 0x0000000000000000ULL}, /* 20 */
+	{0xD8D726B7177A8000ULL, 0x0000000000000000ULL}, /* 21 */
+	{0x878678326EAC9000ULL, 0x0000000000000000ULL}, /* 22 */
+	{0xA968163F0A57B400ULL, 0x0000000000000000ULL}, /* 23 */
+	{0xD3C21BCECCEDA100ULL, 0x0000000000000000ULL}, /* 24 */
+	{0x84595161401484A0ULL, 0x0000000000000000ULL}, /* 25 */
+	{0xA56FA5B99019A5C8ULL, 0x0000000000000000ULL}, /* 26 */
+	{0xCECB8F27F4200F3AULL, 0x0000000000000000ULL}, /* 27 */
+	{0x813F3978F8940984ULL, 0x4000000000000000ULL}, /* 28 */
+	{0xA18F07D736B90BE5ULL, 0x5000000000000000ULL}, /* 29 */
+	{0xC9F2C9CD04674EDEULL, 0xA400000000000000ULL}, /* 30 */
+	{0xFC6F7C4045812296ULL, 0x4D00000000000000ULL}, /* 31 */
+	{0x9DC5ADA82B70B59DULL, 0xF020000000000000ULL}, /* 32 */
+	{0xC5371912364CE305ULL, 0x6C28000000000000ULL}, /* 33 */
+	{0xF684DF56C3E01BC6ULL, 0xC732000000000000ULL}, /* 34 */
+	{0x9A130B963A6C115CULL, 0x3C7F400000000000ULL}, /* 35 */
+	{0xC097CE7BC90715B3ULL, 0x4B9F100000000000ULL}, /* 36 */
+	{0xF0BDC21ABB48DB20ULL, 0x1E86D40000000000ULL}, /* 37 */
+	{0x96769950B50D88F4ULL, 0x1314448000000000ULL}, /* 38 */
+	{0xBC143FA4E250EB31ULL, 0x17D955A000000000ULL}, /* 39 */
+	{0xEB194F8E1AE525FDULL, 0x5DCFAB0800000000ULL}, /* 40 */
+	{0x92EFD1B8D0CF37BEULL, 0x5AA1CAE500000000ULL}, /* 41 */
+	{0xB7ABC627050305ADULL, 0xF14A3D9E40000000ULL}, /* 42 */
+	{0xE596B7B0C643C719ULL, 0x6D9CCD05D0000000ULL}, /* 43 */
+	{0x8F7E32CE7BEA5C6FULL, 0xE4820023A2000000ULL}, /* 44 */
+	{0xB35DBF821AE4F38BULL, 0xDDA2802C8A800000ULL}, /* 45 */
+	{0xE0352F62A19E306EULL, 0xD50B2037AD200000ULL}, /* 46 */
+	{0x8C213D9DA502DE45ULL, 0x4526F422CC340000ULL}, /* 47 */
+	{0xAF298D050E4395D6ULL, 0x9670B12B7F410000ULL}, /* 48 */
+	{0xDAF3F04651D47B4CULL, 0x3C0CDD765F114000ULL}, /* 49 */
+	{0x88D8762BF324CD0FULL, 0xA5880A69FB6AC800ULL}, /* 50 */
+	{0xAB0E93B6EFEE0053ULL, 0x8EEA0D047A457A00ULL}, /* 51 */
+	{0xD5D238A4ABE98068ULL, 0x72A4904598D6D880ULL}, /* 52 */
+	{0x85A36366EB71F041ULL, 0x47A6DA2B7F864750ULL}, /* 53 */
+	{0xA70C3C40A64E6C51ULL, 0x999090B65F67D924ULL}, /* 54 */
+	{0xD0CF4B50CFE20765ULL, 0xFFF4B4E3F741CF6DULL}, /* 55 */
+	{0x82818F1281ED449FULL, 0xBFF8F10E7A8921A4ULL}, /* 56 */
+	{0xA321F2D7226895C7ULL, 0xAFF72D52192B6A0DULL}, /* 57 */
+	{0xCBEA6F8CEB02BB39ULL, 0x9BF4F8A69F764490ULL}, /* 58 */
+	{0xFEE50B7025C36A08ULL, 0x02F236D04753D5B4ULL}, /* 59 */
+	{0x9F4F2726179A2245ULL, 0x01D762422C946590ULL}, /* 60 */
+	{0xC722F0EF9D80AAD6ULL, 0x424D3AD2B7B97EF5ULL}, /* 61 */
+	{0xF8EBAD2B84E0D58BULL, 0xD2E0898765A7DEB2ULL}, /* 62 */
+	{0x9B934C3B330C8577ULL, 0x63CC55F49F88EB2FULL}, /* 63 */
+	{0xC2781F49FFCFA6D5ULL, 0x3CBF6B71C76B25FBULL}  /* 64 */
+};
+
+/* Powers of ten exactly representable as doubles */
+static const double lw_decimal_pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+					1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static inline uint64_t
+lw_decimal_mul128(uint64_t a, uint64_t b, uint64_t *hi)
+{
+#if defined(__SIZEOF_INT128__)
+	unsigned __int128 r = (unsigned __int128)a * b;
+	*hi = (uint64_t)(r >> 64);
+	return (uint64_t)r;
+#else
+	uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+	uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+	uint64_t p00 = a_lo * b_lo, p01 = a_lo * b_hi, p10 = a_hi * b_lo, p11 = a_hi * b_hi;
+	uint64_t mid = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+	*hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+	return (mid << 32) | (uint32_t)p00;
+#endif
+}
+
+static inline int
+lw_decimal_clz(uint64_t w)
+{
+#if defined(__GNUC__)
+	return __builtin_clzll(w);
+#else
+	int n = 0;
+	while (!(w & 0x8000000000000000ULL))
+	{
+		w <<= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+/* Correctly rounded w * 10^q, LW_FAILURE when left to strtod */
+int
+lw_decimal_to_double(uint64_t w, int64_t q, int negative, double *d)
+{
+	const uint64_t *pow5;
+	uint64_t hi, lo, mantissa, bits;
+	int32_t power2;
+	int lz, upperbit;
+
+	if (!w)
+	{
+		*d = negative ? -0.0 : 0.0;
+		return LW_SUCCESS;
+	}
+
+	/* Both w and 10^|q| are exact, one rounding */
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+	if (w <= (1ULL << 53) && q >= -22 && q <= 22)
+	{
+		double v = (double)w;
+		v = q < 0 ? v / lw_decimal_pow10[-q] : v * lw_decimal_pow10[q];
+		*d = negative ? -v : v;
+		return LW_SUCCESS;
+	}
+#endif
+
+	if (q < LW_DECIMAL_MIN_POW10 || q > LW_DECIMAL_MAX_POW10)
+		return LW_FAILURE;
+
+	/* Normalized w times the truncated 5^q, widened when the low bits matter */
+	pow5 = lw_decimal_pow5[q - LW_DECIMAL_MIN_POW10];
+	lz = lw_decimal_clz(w);
+	w <<= lz;
+	lo = lw_decimal_mul128(w, pow5[0], &hi);
+	if ((hi & 0x1FF) == 0x1FF)
+	{
+		uint64_t hi2;
+		lw_decimal_mul128(w, pow5[1], &hi2);
+		lo += hi2;
+		if (hi2 > lo)
+			hi++;
+	}
+	if (lo == UINT64_MAX && (q < -27 || q > 55))
+		return LW_FAILURE;
+
+	upperbit = (int)(hi >> 63);
+	mantissa = hi >> (upperbit + 9);
+	power2 = (int32_t)((((152170 + 65536) * (int32_t)q) >> 16) + 63 + upperbit - lz + 1023);
+	if (power2 <= 0 || power2 >= 0x7FF)
+		return LW_FAILURE;
+
+	/* Exactly halfway (only possible for small q): round to even */
+	if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << (upperbit + 9)) == hi)
+		mantissa &= ~1ULL;
+
+	mantissa += mantissa & 1;
+	mantissa >>= 1;
+	if (mantissa >= (2ULL << 52))
+	{
+		mantissa = 1ULL << 52;
+		power2++;
+	}
+	mantissa &= ~(1ULL << 52);
+	if (power2 >= 0x7FF)
+		return LW_FAILURE;
+
+	bits = mantissa | ((uint64_t)power2 << 52) | ((uint64_t)negative << 63);
+	memcpy(d, &bits, sizeof(double));
+	return LW_SUCCESS;
+}
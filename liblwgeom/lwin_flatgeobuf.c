@@ -0,0 +1,1014 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "liblwgeom_internal.h"
+#include "lwgeom_log.h"
+#include "lwhrtree.h"
+
+/*
+ * FlatGeobuf decoder.
+ *
+ * The file is read where it lies, typically a memory mapping: opening it
+ * reads the header only, and the packed Hilbert R-tree that follows is
+ * used in place. A box query walks the tree down to the matching leaves
+ * and decodes just their features, so only the pages of the index nodes
+ * on the way and of those features are touched.
+ *
+ * The offsets of the flatbuffers are checked against their bounds before
+ * anything is read through them. The point arrays of 2D geometries view
+ * the coordinates of the file when they are aligned, on little endian
+ * hosts, and are copied otherwise.
+ */
+
+#define FGB_MAGIC_SIZE 8
+#define FGB_MAJOR_VERSION 3
+
+/* Header fields */
+#define FGB_HEADER_ENVELOPE 1
+#define FGB_HEADER_GEOMETRY_TYPE 2
+#define FGB_HEADER_HAS_Z 3
+#define FGB_HEADER_HAS_M 4
+#define FGB_HEADER_COLUMNS 7
+#define FGB_HEADER_FEATURES_COUNT 8
+#define FGB_HEADER_INDEX_NODE_SIZE 9
+#define FGB_HEADER_CRS 10
+
+/* Column fields */
+#define FGB_COLUMN_NAME 0
+#define FGB_COLUMN_TYPE 1
+
+/* Crs fields */
+#define FGB_CRS_ORG 0
+#define FGB_CRS_CODE 1
+
+/* Geometry fields */
+#define FGB_GEOMETRY_ENDS 0
+#define FGB_GEOMETRY_XY 1
+#define FGB_GEOMETRY_Z 2
+#define FGB_GEOMETRY_M 3
+#define FGB_GEOMETRY_TYPE 6
+#define FGB_GEOMETRY_PARTS 7
+
+/* Feature fields */
+#define FGB_FEATURE_GEOMETRY 0
+#define FGB_FEATURE_PROPERTIES 1
+
+/* Column types */
+#define FGB_COLUMN_BYTE 0
+#define FGB_COLUMN_UBYTE 1
+#define FGB_COLUMN_BOOL 2
+#define FGB_COLUMN_SHORT 3
+#define FGB_COLUMN_USHORT 4
+#define FGB_COLUMN_INT 5
+#define FGB_COLUMN_UINT 6
+#define FGB_COLUMN_LONG 7
+#define FGB_COLUMN_ULONG 8
+#define FGB_COLUMN_FLOAT 9
+#define FGB_COLUMN_DOUBLE 10
+#define FGB_COLUMN_STRING 11
+#define FGB_COLUMN_JSON 12
+#define FGB_COLUMN_DATETIME 13
+#define FGB_COLUMN_BINARY 14
+
+#define FGB_DEFAULT_INDEX_NODE_SIZE 16
+#define FGB_MAX_DEPTH 64
+
+/* liblwgeom types, by FlatGeobuf geometry type, 0 for those without one */
+#define FGB_NUM_TYPES 18
+static const uint8_t fgb_lwtype[FGB_NUM_TYPES] = {
+	0,                     /* Unknown */
+	POINTTYPE,             /* Point */
+	LINETYPE,              /* LineString */
+	POLYGONTYPE,           /* Polygon */
+	MULTIPOINTTYPE,        /* MultiPoint */
+	MULTILINETYPE,         /* MultiLineString */
+	MULTIPOLYGONTYPE,      /* MultiPolygon */
+	COLLECTIONTYPE,        /* GeometryCollection */
+	CIRCSTRINGTYPE,        /* CircularString */
+	COMPOUNDTYPE,          /* CompoundCurve */
+	CURVEPOLYTYPE,         /* CurvePolygon */
+	MULTICURVETYPE,        /* MultiCurve */
+	MULTISURFACETYPE,      /* MultiSurface */
+	0,                     /* Curve */
+	0,                     /* Surface */
+	POLYHEDRALSURFACETYPE, /* PolyhedralSurface */
+	TINTYPE,               /* TIN */
+	TRIANGLETYPE           /* Triangle */
+};
+
+typedef struct
+{
+	char *name;
+	uint8_t type;
+} FGB_COLUMN;
+
+struct LWFLATGEOBUF
+{
+	const uint8_t *buf;
+	size_t size;
+
+	GBOX extent;
+	int has_extent;
+	uint8_t geometry_type;
+	int has_z;
+	int has_m;
+	int32_t srid;
+	uint64_t nfeatures;
+
+	FGB_COLUMN *columns;
+	uint32_t ncolumns;
+
+	LWHRTREE *index;
+	size_t features; /* Offset of the first feature */
+
+	/* Properties of the feature being read, and their strings */
+	LWPROPERTY *properties;
+	size_t maxproperties;
+	char *strings;
+	size_t maxstrings;
+};
+
+static void
+fgb_reserve(void **mem, size_t *max, size_t needed, size_t elem_size)
+{
+	size_t size = *max ? *max : 16;
+	if (needed <= *max)
+		return;
+	while (size < needed)
+		size *= 2;
+	*mem = lwrealloc(*mem, size * elem_size);
+	*max = size;
+}
+
+/**********************************************************************
+ * Little endian scalars
+ */
+
+static inline uint16_t
+fgb_get_u16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t
+fgb_get_u32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t
+fgb_get_u64(const uint8_t *p)
+{
+	return (uint64_t)fgb_get_u32(p) | ((uint64_t)fgb_get_u32(p + 4) << 32);
+}
+
+static inline double
+fgb_get_double(const uint8_t *p)
+{
+	uint64_t v = fgb_get_u64(p);
+	double d;
+	memcpy(&d, &v, sizeof(double));
+	return d;
+}
+
+/**********************************************************************
+ * Flatbuffers
+ */
+
+/* A table within the flatbuffer buf[0..size) */
+typedef struct
+{
+	const uint8_t *buf;
+	size_t size;
+	size_t table;
+	size_t vtable;
+	uint16_t vtable_size;
+	uint16_t table_size;
+} FGB_TABLE;
+
+static int
+fgb_table_at(const uint8_t *buf, size_t size, size_t pos, FGB_TABLE *t)
+{
+	int64_t vtable;
+
+	if (size < 4 || pos > size - 4)
+		return LW_FAILURE;
+	vtable = (int64_t)pos - (int32_t)fgb_get_u32(buf + pos);
+	if (vtable < 0 || (uint64_t)vtable > size - 4)
+		return LW_FAILURE;
+
+	t->buf = buf;
+	t->size = size;
+	t->table = pos;
+	t->vtable = (size_t)vtable;
+	t->vtable_size = fgb_get_u16(buf + t->vtable);
+	t->table_size = fgb_get_u16(buf + t->vtable + 2);
+	if (t->vtable_size < 4 || t->vtable_size > size - t->vtable || t->table_size < 4 ||
+	    t->table_size > size - pos)
+		return LW_FAILURE;
+	return LW_SUCCESS;
+}
+
+/* Root table of a flatbuffer */
+static int
+fgb_root(const uint8_t *buf, size_t size, FGB_TABLE *t)
+{
+	if (size < 4)
+		return LW_FAILURE;
+	return fgb_table_at(buf, size, fgb_get_u32(buf), t);
+}
+
+/* Where a field of elem_size bytes is, NULL when absent */
+static const uint8_t *
+fgb_field(const FGB_TABLE *t, uint16_t id, size_t elem_size)
+{
+	uint16_t offset;
+	if (4 + 2 * (size_t)id + 2 > t->vtable_size)
+		return NULL;
+	offset = fgb_get_u16(t->buf + t->vtable + 4 + 2 * id);
+	if (!offset || offset + elem_size > t->table_size)
+		return NULL;
+	return t->buf + t->table + offset;
+}
+
+static inline uint8_t
+fgb_field_u8(const FGB_TABLE *t, uint16_t id, uint8_t value)
+{
+	const uint8_t *p = fgb_field(t, id, 1);
+	return p ? *p : value;
+}
+
+/* Position of what an offset field points to, LW_FAILURE when absent or out of bounds */
+static int
+fgb_field_target(const FGB_TABLE *t, uint16_t id, size_t *target)
+{
+	const uint8_t *p = fgb_field(t, id, 4);
+	size_t pos;
+	if (!p)
+		return LW_FAILURE;
+	pos = (size_t)(p - t->buf);
+	*target = pos + fgb_get_u32(p);
+	return *target < t->size && *target >= pos;
+}
+
+/* Vector of count elements of elem_size bytes, LW_FAILURE when absent or out of bounds */
+static int
+fgb_field_vector(const FGB_TABLE *t, uint16_t id, size_t elem_size, const uint8_t **data, uint32_t *count)
+{
+	size_t pos;
+	if (!fgb_field_target(t, id, &pos) || pos > t->size - 4)
+		return LW_FAILURE;
+	*count = fgb_get_u32(t->buf + pos);
+	if (*count > (t->size - pos - 4) / elem_size)
+		return LW_FAILURE;
+	*data = t->buf + pos + 4;
+	return LW_SUCCESS;
+}
+
+/* Table i of a vector of tables */
+static int
+fgb_vector_table(const FGB_TABLE *t, const uint8_t *data, uint32_t i, FGB_TABLE *sub)
+{
+	size_t pos = (size_t)(data - t->buf) + 4 * (size_t)i;
+	return fgb_table_at(t->buf, t->size, pos + fgb_get_u32(t->buf + pos), sub);
+}
+
+/* Copy of a string field, NULL when absent */
+static char *
+fgb_field_string(const FGB_TABLE *t, uint16_t id)
+{
+	const uint8_t *data;
+	uint32_t len;
+	char *str;
+	if (!fgb_field_vector(t, id, 1, &data, &len))
+		return NULL;
+	str = lwalloc(len + 1);
+	memcpy(str, data, len);
+	str[len] = '\0';
+	return str;
+}
+
+/**********************************************************************
+ * Header
+ */
+
+/* Node size of the index, -1 for an invalid header */
+static int
+fgb_read_header(LWFLATGEOBUF *fgb, const uint8_t *buf, size_t size)
+{
+	FGB_TABLE t, sub;
+	const uint8_t *data, *p;
+	uint32_t count, i;
+	size_t pos;
+
+	if (!fgb_root(buf, size, &t))
+		return -1;
+
+	if (fgb_field_vector(&t, FGB_HEADER_ENVELOPE, sizeof(double), &data, &count) && count >= 4)
+	{
+		fgb->extent.xmin = fgb_get_double(data);
+		fgb->extent.ymin = fgb_get_double(data + 8);
+		fgb->extent.xmax = fgb_get_double(data + 16);
+		fgb->extent.ymax = fgb_get_double(data + 24);
+		fgb->has_extent = LW_TRUE;
+	}
+	fgb->geometry_type = fgb_field_u8(&t, FGB_HEADER_GEOMETRY_TYPE, 0);
+	fgb->has_z = fgb_field_u8(&t, FGB_HEADER_HAS_Z, 0) != 0;
+	fgb->has_m = fgb_field_u8(&t, FGB_HEADER_HAS_M, 0) != 0;
+	p = fgb_field(&t, FGB_HEADER_FEATURES_COUNT, 8);
+	fgb->nfeatures = p ? fgb_get_u64(p) : 0;
+
+	fgb->srid = SRID_UNKNOWN;
+	if (fgb_field_target(&t, FGB_HEADER_CRS, &pos) && fgb_table_at(buf, size, pos, &sub))
+	{
+		char *org = fgb_field_string(&sub, FGB_CRS_ORG);
+		p = fgb_field(&sub, FGB_CRS_CODE, 4);
+		/* Codes are EPSG ones unless told otherwise */
+		if (p && (!org || strcmp(org, "EPSG") == 0))
+			fgb->srid = clamp_srid((int32_t)fgb_get_u32(p));
+		if (org)
+			lwfree(org);
+	}
+
+	if (fgb_field_vector(&t, FGB_HEADER_COLUMNS, 4, &data, &count) && count)
+	{
+		fgb->columns = lwalloc(count * sizeof(FGB_COLUMN));
+		for (i = 0; i < count; i++)
+		{
+			FGB_COLUMN *column = &fgb->columns[i];
+			if (!fgb_vector_table(&t, data, i, &sub) || !(column->name = fgb_field_string(&sub, FGB_COLUMN_NAME)))
+				return -1;
+			column->type = fgb_field_u8(&sub, FGB_COLUMN_TYPE, FGB_COLUMN_BYTE);
+			fgb->ncolumns++;
+		}
+	}
+
+	p = fgb_field(&t, FGB_HEADER_INDEX_NODE_SIZE, 2);
+	return p ? fgb_get_u16(p) : FGB_DEFAULT_INDEX_NODE_SIZE;
+}
+
+LWFLATGEOBUF *
+lwflatgeobuf_open(const uint8_t *buf, size_t size)
+{
+	LWFLATGEOBUF *fgb;
+	size_t header_size, index_size = 0;
+	int node_size;
+
+	if (!buf || size < FGB_MAGIC_SIZE + 4 || memcmp(buf, "fgb", 3) != 0 || buf[3] != FGB_MAJOR_VERSION ||
+	    memcmp(buf + 4, "fgb", 3) != 0)
+	{
+		lwerror("%s: not a FlatGeobuf file", __func__);
+		return NULL;
+	}
+	header_size = fgb_get_u32(buf + FGB_MAGIC_SIZE);
+	if (header_size > size - FGB_MAGIC_SIZE - 4)
+	{
+		lwerror("%s: header runs past the end of the file", __func__);
+		return NULL;
+	}
+
+	fgb = lwalloc(sizeof(LWFLATGEOBUF));
+	memset(fgb, 0, sizeof(LWFLATGEOBUF));
+	fgb->buf = buf;
+	fgb->size = size;
+	fgb->features = FGB_MAGIC_SIZE + 4 + header_size;
+
+	node_size = fgb_read_header(fgb, buf + FGB_MAGIC_SIZE + 4, header_size);
+	if (node_size < 0)
+	{
+		lwerror("%s: invalid header", __func__);
+		lwflatgeobuf_close(fgb);
+		return NULL;
+	}
+	/* Checked here, so that the index is only read when it can be */
+	if (node_size == 1)
+	{
+		lwerror("%s: index node size must be at least 2", __func__);
+		lwflatgeobuf_close(fgb);
+		return NULL;
+	}
+
+	if (node_size && fgb->nfeatures)
+	{
+		/* Nodes are 40 bytes, so no valid count overflows the size */
+		if (fgb->nfeatures > (size - fgb->features) / sizeof(LWHRTREE_NODE))
+		{
+			lwerror("%s: index runs past the end of the file", __func__);
+			lwflatgeobuf_close(fgb);
+			return NULL;
+		}
+		index_size = lwhrtree_buffer_size(fgb->nfeatures, (uint32_t)node_size);
+		if (!index_size || index_size > size - fgb->features)
+		{
+			lwerror("%s: index runs past the end of the file", __func__);
+			lwflatgeobuf_close(fgb);
+			return NULL;
+		}
+		/* Leaves hold byte offsets into the features that follow the index */
+		fgb->index = lwhrtree_from_buffer_offsets(buf + fgb->features,
+							  index_size,
+							  fgb->nfeatures,
+							  (uint32_t)node_size,
+							  size - fgb->features - index_size);
+		if (!fgb->index)
+		{
+			lwflatgeobuf_close(fgb);
+			return NULL;
+		}
+		fgb->features += index_size;
+	}
+
+	return fgb;
+}
+
+void
+lwflatgeobuf_close(LWFLATGEOBUF *fgb)
+{
+	uint32_t i;
+
+	if (!fgb)
+		return;
+	for (i = 0; i < fgb->ncolumns; i++)
+		lwfree(fgb->columns[i].name);
+	if (fgb->columns)
+		lwfree(fgb->columns);
+	lwhrtree_free(fgb->index);
+	if (fgb->properties)
+		lwfree(fgb->properties);
+	if (fgb->strings)
+		lwfree(fgb->strings);
+	lwfree(fgb);
+}
+
+uint64_t
+lwflatgeobuf_nfeatures(const LWFLATGEOBUF *fgb)
+{
+	return fgb->nfeatures;
+}
+
+int
+lwflatgeobuf_extent(const LWFLATGEOBUF *fgb, GBOX *extent)
+{
+	if (!fgb->has_extent)
+		return LW_FAILURE;
+	gbox_init(extent);
+	extent->xmin = fgb->extent.xmin;
+	extent->ymin = fgb->extent.ymin;
+	extent->xmax = fgb->extent.xmax;
+	extent->ymax = fgb->extent.ymax;
+	return LW_SUCCESS;
+}
+
+/**********************************************************************
+ * Geometries
+ */
+
+/* Coordinates of a geometry table */
+typedef struct
+{
+	const uint8_t *xy;
+	const uint8_t *z;
+	const uint8_t *m;
+	uint32_t npoints;
+	int has_z;
+	int has_m;
+} FGB_POINTS;
+
+/* Points [start, end) as a point array, a view of the buffer when possible */
+static POINTARRAY *
+fgb_read_points(const FGB_POINTS *pts, uint32_t start, uint32_t end)
+{
+	uint32_t i, n = end - start;
+	POINTARRAY *pa;
+
+	if (!n)
+		return ptarray_construct_empty(pts->has_z, pts->has_m, 1);
+
+#if ! IS_BIG_ENDIAN
+	if (!pts->has_z && !pts->has_m && ((uintptr_t)pts->xy % sizeof(double)) == 0)
+		return ptarray_construct_reference_data(0, 0, n, (uint8_t *)(pts->xy + 16 * (size_t)start));
+#endif
+
+	pa = ptarray_construct(pts->has_z, pts->has_m, n);
+	for (i = 0; i < n; i++)
+	{
+		POINT4D pt;
+		size_t j = (size_t)start + i;
+		pt.x = fgb_get_double(pts->xy + 16 * j);
+		pt.y = fgb_get_double(pts->xy + 16 * j + 8);
+		pt.z = pts->z ? fgb_get_double(pts->z + 8 * j) : 0.0;
+		pt.m = pts->m ? fgb_get_double(pts->m + 8 * j) : 0.0;
+		ptarray_set_point4d(pa, i, &pt);
+	}
+	return pa;
+}
+
+static LWGEOM *fgb_read_geometry(const LWFLATGEOBUF *fgb, const FGB_TABLE *t, uint8_t type, int depth);
+
+/* Lines of a point based geometry, cut at its ends */
+static int
+fgb_read_lines(const FGB_TABLE *t, const FGB_POINTS *pts, POINTARRAY ***lines, uint32_t *nlines)
+{
+	const uint8_t *ends;
+	uint32_t nends, i, start = 0;
+
+	*lines = NULL;
+	*nlines = 0;
+	if (!fgb_field_vector(t, FGB_GEOMETRY_ENDS, 4, &ends, &nends) || !nends)
+	{
+		if (pts->npoints)
+		{
+			*lines = lwalloc(sizeof(POINTARRAY *));
+			(*lines)[0] = fgb_read_points(pts, 0, pts->npoints);
+			*nlines = 1;
+		}
+		return LW_SUCCESS;
+	}
+
+	for (i = 0; i < nends; i++)
+	{
+		uint32_t end = fgb_get_u32(ends + 4 * i);
+		if (end < start || end > pts->npoints)
+		{
+			lwerror("lwflatgeobuf_query: invalid geometry ends");
+			return LW_FAILURE;
+		}
+		start = end;
+	}
+
+	*lines = lwalloc(nends * sizeof(POINTARRAY *));
+	for (i = 0, start = 0; i < nends; i++)
+	{
+		uint32_t end = fgb_get_u32(ends + 4 * i);
+		(*lines)[i] = fgb_read_points(pts, start, end);
+		start = end;
+	}
+	*nlines = nends;
+	return LW_SUCCESS;
+}
+
+static LWGEOM *
+fgb_read_parts(const LWFLATGEOBUF *fgb, const FGB_TABLE *t, uint8_t lwtype, int depth)
+{
+	const uint8_t *parts;
+	uint32_t nparts = 0, i;
+	LWCOLLECTION *col;
+	/* Parts of these have a known type */
+	uint8_t part_type = lwtype == MULTIPOLYGONTYPE || lwtype == POLYHEDRALSURFACETYPE ? 3 : lwtype == TINTYPE ? 17 : 0;
+
+	if (lwtype == CURVEPOLYTYPE)
+		col = (LWCOLLECTION *)lwcurvepoly_construct_empty(fgb->srid, fgb->has_z, fgb->has_m);
+	else
+		col = lwcollection_construct_empty(lwtype, fgb->srid, fgb->has_z, fgb->has_m);
+
+	if (fgb_field_vector(t, FGB_GEOMETRY_PARTS, 4, &parts, &nparts))
+	{
+		for (i = 0; i < nparts; i++)
+		{
+			FGB_TABLE sub;
+			LWGEOM *part;
+			int rv;
+
+			if (!fgb_vector_table(t, parts, i, &sub))
+			{
+				lwerror("lwflatgeobuf_query: invalid geometry part");
+				lwgeom_free((LWGEOM *)col);
+				return NULL;
+			}
+			part = fgb_read_geometry(fgb, &sub, part_type, depth + 1);
+			if (!part)
+			{
+				lwgeom_free((LWGEOM *)col);
+				return NULL;
+			}
+
+			if (lwtype == CURVEPOLYTYPE)
+				rv = lwcurvepoly_add_ring((LWCURVEPOLY *)col, part);
+			else if (lwtype == COMPOUNDTYPE)
+				rv = (part->type == LINETYPE || part->type == CIRCSTRINGTYPE) &&
+				     lwcompound_add_lwgeom((LWCOMPOUND *)col, part);
+			else
+				rv = lwcollection_allows_subtype(lwtype, part->type) &&
+				     lwcollection_add_lwgeom(col, part);
+			if (!rv)
+			{
+				lwerror("lwflatgeobuf_query: invalid %s part of a %s",
+					lwtype_name(part->type), lwtype_name(lwtype));
+				lwgeom_free(part);
+				lwgeom_free((LWGEOM *)col);
+				return NULL;
+			}
+		}
+	}
+	return (LWGEOM *)col;
+}
+
+/*
+ * Geometry of a table, of the given type when the table has none, as
+ * the parts of some geometries and the features of a typed file.
+ */
+static LWGEOM *
+fgb_read_geometry(const LWFLATGEOBUF *fgb, const FGB_TABLE *t, uint8_t type, int depth)
+{
+	FGB_POINTS pts;
+	POINTARRAY **lines = NULL;
+	uint32_t n, nlines, i;
+	uint8_t lwtype;
+	LWGEOM *geom = NULL;
+
+	if (depth > FGB_MAX_DEPTH)
+	{
+		lwerror("lwflatgeobuf_query: geometries nested too deep");
+		return NULL;
+	}
+
+	type = fgb_field_u8(t, FGB_GEOMETRY_TYPE, type);
+	lwtype = type < FGB_NUM_TYPES ? fgb_lwtype[type] : 0;
+	if (!lwtype)
+	{
+		lwerror("lwflatgeobuf_query: unsupported geometry type %u", type);
+		return NULL;
+	}
+
+	switch (lwtype)
+	{
+	case MULTIPOLYGONTYPE:
+	case COLLECTIONTYPE:
+	case COMPOUNDTYPE:
+	case CURVEPOLYTYPE:
+	case MULTICURVETYPE:
+	case MULTISURFACETYPE:
+	case POLYHEDRALSURFACETYPE:
+	case TINTYPE:
+		return fgb_read_parts(fgb, t, lwtype, depth);
+	default:
+		break;
+	}
+
+	/* Missing Z and M vectors read as zeros */
+	memset(&pts, 0, sizeof(FGB_POINTS));
+	pts.has_z = fgb->has_z;
+	pts.has_m = fgb->has_m;
+	if (fgb_field_vector(t, FGB_GEOMETRY_XY, sizeof(double), &pts.xy, &n))
+	{
+		if (n % 2)
+		{
+			lwerror("lwflatgeobuf_query: odd number of xy coordinates");
+			return NULL;
+		}
+		pts.npoints = n / 2;
+	}
+	if ((pts.has_z && fgb_field_vector(t, FGB_GEOMETRY_Z, sizeof(double), &pts.z, &n) && n != pts.npoints) ||
+	    (pts.has_m && fgb_field_vector(t, FGB_GEOMETRY_M, sizeof(double), &pts.m, &n) && n != pts.npoints))
+	{
+		lwerror("lwflatgeobuf_query: ordinates do not match the xy coordinates");
+		return NULL;
+	}
+
+	switch (lwtype)
+	{
+	case POINTTYPE:
+		if (pts.npoints > 1)
+			break;
+		geom = (LWGEOM *)lwpoint_construct(fgb->srid, NULL, fgb_read_points(&pts, 0, pts.npoints));
+		break;
+	case LINETYPE:
+		geom = (LWGEOM *)lwline_construct(fgb->srid, NULL, fgb_read_points(&pts, 0, pts.npoints));
+		break;
+	case CIRCSTRINGTYPE:
+		geom = (LWGEOM *)lwcircstring_construct(fgb->srid, NULL, fgb_read_points(&pts, 0, pts.npoints));
+		break;
+	case TRIANGLETYPE:
+		geom = (LWGEOM *)lwtriangle_construct(fgb->srid, NULL, fgb_read_points(&pts, 0, pts.npoints));
+		break;
+	case MULTIPOINTTYPE:
+	{
+		LWMPOINT *mpoint = lwmpoint_construct_empty(fgb->srid, fgb->has_z, fgb->has_m);
+		for (i = 0; i < pts.npoints; i++)
+			lwmpoint_add_lwpoint(mpoint, lwpoint_construct(fgb->srid, NULL, fgb_read_points(&pts, i, i + 1)));
+		geom = (LWGEOM *)mpoint;
+		break;
+	}
+	case POLYGONTYPE:
+		if (!fgb_read_lines(t, &pts, &lines, &nlines))
+			return NULL;
+		if (!nlines)
+			geom = (LWGEOM *)lwpoly_construct_empty(fgb->srid, fgb->has_z, fgb->has_m);
+		else
+			geom = (LWGEOM *)lwpoly_construct(fgb->srid, NULL, nlines, lines);
+		break;
+	case MULTILINETYPE:
+	{
+		LWMLINE *mline;
+		if (!fgb_read_lines(t, &pts, &lines, &nlines))
+			return NULL;
+		mline = lwmline_construct_empty(fgb->srid, fgb->has_z, fgb->has_m);
+		for (i = 0; i < nlines; i++)
+			lwmline_add_lwline(mline, lwline_construct(fgb->srid, NULL, lines[i]));
+		if (lines)
+			lwfree(lines);
+		geom = (LWGEOM *)mline;
+		break;
+	}
+	default:
+		break;
+	}
+
+	if (!geom)
+		lwerror("lwflatgeobuf_query: invalid %s", lwtype_name(lwtype));
+	return geom;
+}
+
+/**********************************************************************
+ * Features
+ */
+
+/* Properties of a feature, the strings copied out to be terminated */
+static int
+fgb_read_properties(LWFLATGEOBUF *fgb, const uint8_t *data, uint32_t size, uint32_t *nproperties)
+{
+	const uint8_t *end = data + size;
+	char *strings;
+	uint32_t n = 0;
+
+	/* Each string takes less room terminated than in the input */
+	fgb_reserve((void **)&fgb->strings, &fgb->maxstrings, (size_t)size + 1, 1);
+	strings = fgb->strings;
+
+	while (data < end)
+	{
+		LWPROPERTY *p;
+		FGB_COLUMN *column;
+		uint16_t c;
+
+		if (end - data < 2 || (c = fgb_get_u16(data)) >= fgb->ncolumns)
+			goto invalid;
+		data += 2;
+		column = &fgb->columns[c];
+
+		fgb_reserve((void **)&fgb->properties, &fgb->maxproperties, n + 1, sizeof(LWPROPERTY));
+		p = &fgb->properties[n];
+		memset(p, 0, sizeof(LWPROPERTY));
+		p->key = column->name;
+		p->type = LWPROPERTY_INT;
+
+#define FGB_NEED(bytes) if (end - data < (bytes)) goto invalid
+		switch (column->type)
+		{
+		case FGB_COLUMN_BYTE:
+			FGB_NEED(1);
+			p->int_value = (int8_t)data[0];
+			data += 1;
+			break;
+		case FGB_COLUMN_UBYTE:
+			FGB_NEED(1);
+			p->int_value = data[0];
+			data += 1;
+			break;
+		case FGB_COLUMN_BOOL:
+			FGB_NEED(1);
+			p->type = LWPROPERTY_BOOL;
+			p->int_value = data[0] != 0;
+			data += 1;
+			break;
+		case FGB_COLUMN_SHORT:
+			FGB_NEED(2);
+			p->int_value = (int16_t)fgb_get_u16(data);
+			data += 2;
+			break;
+		case FGB_COLUMN_USHORT:
+			FGB_NEED(2);
+			p->int_value = fgb_get_u16(data);
+			data += 2;
+			break;
+		case FGB_COLUMN_INT:
+			FGB_NEED(4);
+			p->int_value = (int32_t)fgb_get_u32(data);
+			data += 4;
+			break;
+		case FGB_COLUMN_UINT:
+			FGB_NEED(4);
+			p->int_value = fgb_get_u32(data);
+			data += 4;
+			break;
+		case FGB_COLUMN_LONG:
+			FGB_NEED(8);
+			p->int_value = (int64_t)fgb_get_u64(data);
+			data += 8;
+			break;
+		case FGB_COLUMN_ULONG:
+		{
+			uint64_t v;
+			FGB_NEED(8);
+			v = fgb_get_u64(data);
+			if (v > INT64_MAX)
+			{
+				p->type = LWPROPERTY_DOUBLE;
+				p->double_value = (double)v;
+			}
+			else
+				p->int_value = (int64_t)v;
+			data += 8;
+			break;
+		}
+		case FGB_COLUMN_FLOAT:
+		{
+			uint32_t v;
+			float f;
+			FGB_NEED(4);
+			v = fgb_get_u32(data);
+			memcpy(&f, &v, sizeof(float));
+			p->type = LWPROPERTY_FLOAT;
+			p->double_value = f;
+			data += 4;
+			break;
+		}
+		case FGB_COLUMN_DOUBLE:
+			FGB_NEED(8);
+			p->type = LWPROPERTY_DOUBLE;
+			p->double_value = fgb_get_double(data);
+			data += 8;
+			break;
+		case FGB_COLUMN_STRING:
+		case FGB_COLUMN_JSON:
+		case FGB_COLUMN_DATETIME:
+		case FGB_COLUMN_BINARY:
+		{
+			uint32_t len;
+			FGB_NEED(4);
+			len = fgb_get_u32(data);
+			data += 4;
+			FGB_NEED(len);
+			if (column->type == FGB_COLUMN_BINARY)
+			{
+				/* No binary properties, left out */
+				data += len;
+				continue;
+			}
+			p->type = column->type == FGB_COLUMN_JSON ? LWPROPERTY_JSON : LWPROPERTY_STRING;
+			memcpy(strings, data, len);
+			strings[len] = '\0';
+			p->string_value = strings;
+			strings += len + 1;
+			data += len;
+			break;
+		}
+		default:
+			/* Unknown sizes, nothing after can be read */
+			goto invalid;
+		}
+#undef FGB_NEED
+		n++;
+	}
+
+	*nproperties = n;
+	return LW_SUCCESS;
+
+invalid:
+	lwerror("lwflatgeobuf_query: invalid feature properties");
+	return LW_FAILURE;
+}
+
+typedef struct
+{
+	LWFLATGEOBUF *fgb;
+	const GBOX *query;
+	lwflatgeobuf_feature_callback callback;
+	void *data;
+	int failed;
+	int stopped;
+	uint64_t nread;
+} FGB_QUERY;
+
+/* Feature at offset of the features, filtered by the query box unless indexed */
+static int
+fgb_read_feature(FGB_QUERY *q, uint64_t offset, int filter)
+{
+	LWFLATGEOBUF *fgb = q->fgb;
+	const uint8_t *buf, *properties;
+	size_t size, available = fgb->size - fgb->features;
+	uint32_t nproperties = 0, psize;
+	FGB_TABLE t, sub;
+	size_t pos;
+	LWGEOM *geom = NULL;
+
+	if (offset > available || available - offset < 4 ||
+	    fgb_get_u32(fgb->buf + fgb->features + offset) > available - offset - 4)
+	{
+		lwerror("lwflatgeobuf_query: feature runs past the end of the file");
+		return LW_FAILURE;
+	}
+	buf = fgb->buf + fgb->features + offset + 4;
+	size = fgb_get_u32(buf - 4);
+
+	if (!fgb_root(buf, size, &t))
+	{
+		lwerror("lwflatgeobuf_query: invalid feature");
+		return LW_FAILURE;
+	}
+
+	if (fgb_field_target(&t, FGB_FEATURE_GEOMETRY, &pos))
+	{
+		if (!fgb_table_at(buf, size, pos, &sub))
+		{
+			lwerror("lwflatgeobuf_query: invalid feature geometry");
+			return LW_FAILURE;
+		}
+		geom = fgb_read_geometry(fgb, &sub, fgb->geometry_type, 0);
+		if (!geom)
+			return LW_FAILURE;
+	}
+
+	if (filter && q->query)
+	{
+		GBOX box;
+		if (!geom || lwgeom_calculate_gbox(geom, &box) == LW_FAILURE || !gbox_overlaps_2d(&box, q->query))
+		{
+			if (geom)
+				lwgeom_free(geom);
+			return LW_SUCCESS;
+		}
+	}
+
+	if (fgb_field_vector(&t, FGB_FEATURE_PROPERTIES, 1, &properties, &psize) &&
+	    fgb_read_properties(fgb, properties, psize, &nproperties) == LW_FAILURE)
+	{
+		if (geom)
+			lwgeom_free(geom);
+		return LW_FAILURE;
+	}
+
+	q->nread++;
+	if (!q->callback(geom, fgb->properties, nproperties, q->data))
+		q->stopped = LW_TRUE;
+	return LW_SUCCESS;
+}
+
+static int
+fgb_visit_leaf(const LWHRTREE_NODE *leaf, void *data)
+{
+	FGB_QUERY *q = data;
+	/* Empty features have inverted boxes, which only infinite queries reach */
+	if (leaf->xmin > leaf->xmax)
+		return LW_TRUE;
+	if (fgb_read_feature(q, leaf->offset, LW_FALSE) == LW_FAILURE)
+	{
+		q->failed = LW_TRUE;
+		return LW_FALSE;
+	}
+	return !q->stopped;
+}
+
+int64_t
+lwflatgeobuf_query(LWFLATGEOBUF *fgb, const GBOX *query, lwflatgeobuf_feature_callback callback, void *data)
+{
+	FGB_QUERY q;
+
+	memset(&q, 0, sizeof(FGB_QUERY));
+	q.fgb = fgb;
+	q.query = query;
+	q.callback = callback;
+	q.data = data;
+
+	if (query && fgb->index)
+	{
+		lwhrtree_query_visit(fgb->index, query, fgb_visit_leaf, &q);
+	}
+	else
+	{
+		/* One after the other, as many as the header says if it does */
+		uint64_t offset = 0, i;
+		size_t available = fgb->size - fgb->features;
+		for (i = 0; !q.stopped && (fgb->nfeatures ? i < fgb->nfeatures : available - offset >= 4); i++)
+		{
+			if (fgb_read_feature(&q, offset, LW_TRUE) == LW_FAILURE)
+			{
+				q.failed = LW_TRUE;
+				break;
+			}
+			offset += 4 + (uint64_t)fgb_get_u32(fgb->buf + fgb->features + offset);
+		}
+	}
+
+	return q.failed ? -1 : (int64_t)q.nread;
+}
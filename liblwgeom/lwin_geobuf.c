@@ -0,0 +1,773 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "liblwgeom_internal.h"
+#include "lwgeom_log.h"
+#include "varint.h"
+#include "geobuf.pb-c.h"
+
+/*
+ * Geobuf decoder.
+ *
+ * lwgeom_from_geobuf unpacks a whole message. The streaming reader frames
+ * the top level fields of the message by hand instead, so that a
+ * FeatureCollection is read one feature at a time: only the feature being
+ * read is held in memory and unpacked, then handed to the callback.
+ *
+ * Coordinates are written straight into the point arrays, the rings
+ * getting back the closing point the encoding leaves out.
+ */
+
+#define GEOBUF_DEFAULT_DIMENSIONS 2
+#define GEOBUF_DEFAULT_PRECISION 6
+#define GEOBUF_BUFFER_SIZE 16384
+/* Longest varint, in bytes */
+#define GEOBUF_MAX_VARINT 10
+
+typedef struct
+{
+	double scale;
+	uint32_t dims;
+} GEOBUF_DEC;
+
+typedef enum
+{
+	GEOBUF_TOP = 0,    /* Between the fields of the message */
+	GEOBUF_COLLECTION, /* Between the fields of the FeatureCollection */
+	GEOBUF_DONE        /* Stopped by the callback or by an error */
+} GEOBUF_STATE;
+
+struct LWGEOBUF_READER
+{
+	lwgeobuf_feature_callback callback;
+	void *data;
+	GEOBUF_STATE state;
+	int failed;
+	GEOBUF_DEC dec;
+
+	uint8_t *buf;    /* Input not consumed yet */
+	size_t len;      /* Bytes of input in buf */
+	size_t capacity; /* Allocated bytes */
+	size_t pos;      /* Next field */
+	size_t base;     /* Input offset of buf[0] */
+
+	size_t collection_end; /* Input offset of the end of the collection */
+	uint64_t skip;         /* Bytes left of a field being skipped */
+
+	char **keys;
+	size_t nkeys;
+	size_t maxkeys;
+	LWPROPERTY *properties;
+	size_t maxproperties;
+};
+
+/* Unpacked messages live in the memory of liblwgeom too */
+static void *
+geobuf_alloc(__attribute__((__unused__)) void *data, size_t size)
+{
+	return lwalloc(size);
+}
+
+static void
+geobuf_free(__attribute__((__unused__)) void *data, void *ptr)
+{
+	lwfree(ptr);
+}
+
+static ProtobufCAllocator geobuf_allocator = {geobuf_alloc, geobuf_free, NULL};
+
+static int
+geobuf_dec_dims(GEOBUF_DEC *dec, uint32_t dims)
+{
+	if (dims < 2)
+	{
+		lwerror("lwgeom_from_geobuf: invalid number of dimensions %u", dims);
+		return LW_FAILURE;
+	}
+	dec->dims = dims;
+	return LW_SUCCESS;
+}
+
+static int
+geobuf_dec_init(GEOBUF_DEC *dec, uint32_t dims, uint32_t precision)
+{
+	dec->scale = pow(10.0, precision);
+	return geobuf_dec_dims(dec, dims);
+}
+
+/**********************************************************************
+ * Geometries
+ */
+
+/*
+ * Read npoints points of a line from the coordinates at offset, which
+ * is moved past them.
+ */
+static POINTARRAY *
+geobuf_dec_line(const GEOBUF_DEC *dec, const Data__Geometry *g, size_t *offset, size_t npoints, int closed)
+{
+	int hasz = dec->dims > 2;
+	uint64_t acc[3] = {0, 0, 0};
+	const int64_t *c = g->coords + *offset;
+	POINTARRAY *pa;
+	size_t i;
+
+	if (npoints > (g->n_coords - *offset) / dec->dims || npoints >= UINT32_MAX)
+	{
+		lwerror("lwgeom_from_geobuf: lengths run past the coordinates");
+		return NULL;
+	}
+
+	pa = ptarray_construct(hasz, 0, npoints + (closed && npoints));
+	for (i = 0; i < npoints; i++)
+	{
+		double *p = (double *)getPoint_internal(pa, i);
+		/* Unsigned, as the sums of bad input may overflow */
+		acc[0] += (uint64_t)c[0];
+		acc[1] += (uint64_t)c[1];
+		p[0] = (int64_t)acc[0] / dec->scale;
+		p[1] = (int64_t)acc[1] / dec->scale;
+		if (hasz)
+		{
+			acc[2] += (uint64_t)c[2];
+			p[2] = (int64_t)acc[2] / dec->scale;
+		}
+		c += dec->dims;
+	}
+	if (closed && npoints)
+		memcpy(getPoint_internal(pa, npoints), getPoint_internal(pa, 0), ptarray_point_size(pa));
+
+	*offset += npoints * dec->dims;
+	return pa;
+}
+
+/* Read a polygon of nrings rings, their lengths at lengths[*ring] */
+static LWPOLY *
+geobuf_dec_polygon(const GEOBUF_DEC *dec, const Data__Geometry *g, size_t *offset, size_t *ring, size_t nrings)
+{
+	LWPOLY *poly = lwpoly_construct_empty(SRID_UNKNOWN, dec->dims > 2, 0);
+	size_t i;
+
+	if (nrings > g->n_lengths - *ring)
+	{
+		lwpoly_free(poly);
+		lwerror("lwgeom_from_geobuf: polygon has more rings than lengths");
+		return NULL;
+	}
+	for (i = 0; i < nrings; i++)
+	{
+		POINTARRAY *pa = geobuf_dec_line(dec, g, offset, g->lengths[(*ring)++], LW_TRUE);
+		if (!pa)
+		{
+			lwpoly_free(poly);
+			return NULL;
+		}
+		lwpoly_add_ring(poly, pa);
+	}
+	return poly;
+}
+
+static LWGEOM *
+geobuf_dec_geometry(const GEOBUF_DEC *dec, const Data__Geometry *g)
+{
+	int hasz = dec->dims > 2;
+	size_t offset = 0, ring = 0, i;
+	size_t npoints;
+	POINTARRAY *pa;
+
+	if (!g)
+	{
+		lwerror("lwgeom_from_geobuf: feature without a geometry");
+		return NULL;
+	}
+	npoints = g->n_coords / dec->dims;
+
+	switch (g->type)
+	{
+	case DATA__GEOMETRY__TYPE__POINT:
+		if (!npoints)
+			return (LWGEOM *)lwpoint_construct_empty(SRID_UNKNOWN, hasz, 0);
+		if (!(pa = geobuf_dec_line(dec, g, &offset, 1, LW_FALSE)))
+			return NULL;
+		return (LWGEOM *)lwpoint_construct(SRID_UNKNOWN, NULL, pa);
+
+	case DATA__GEOMETRY__TYPE__MULTIPOINT:
+	{
+		LWMPOINT *mpoint;
+		if (!npoints)
+			return (LWGEOM *)lwcollection_construct_empty(MULTIPOINTTYPE, SRID_UNKNOWN, hasz, 0);
+		if (!(pa = geobuf_dec_line(dec, g, &offset, npoints, LW_FALSE)))
+			return NULL;
+		mpoint = lwmpoint_construct(SRID_UNKNOWN, pa);
+		ptarray_free(pa);
+		return (LWGEOM *)mpoint;
+	}
+
+	case DATA__GEOMETRY__TYPE__LINESTRING:
+		if (!npoints)
+			return (LWGEOM *)lwline_construct_empty(SRID_UNKNOWN, hasz, 0);
+		if (!(pa = geobuf_dec_line(dec, g, &offset, npoints, LW_FALSE)))
+			return NULL;
+		return (LWGEOM *)lwline_construct(SRID_UNKNOWN, NULL, pa);
+
+	case DATA__GEOMETRY__TYPE__MULTILINESTRING:
+	{
+		LWMLINE *mline = (LWMLINE *)lwcollection_construct_empty(MULTILINETYPE, SRID_UNKNOWN, hasz, 0);
+		size_t nlines = g->n_lengths ? g->n_lengths : (npoints ? 1 : 0);
+		for (i = 0; i < nlines; i++)
+		{
+			if (!(pa = geobuf_dec_line(dec, g, &offset, g->n_lengths ? g->lengths[i] : npoints, LW_FALSE)))
+			{
+				lwmline_free(mline);
+				return NULL;
+			}
+			lwmline_add_lwline(mline, lwline_construct(SRID_UNKNOWN, NULL, pa));
+		}
+		return (LWGEOM *)mline;
+	}
+
+	case DATA__GEOMETRY__TYPE__POLYGON:
+	{
+		LWPOLY *poly;
+		if (g->n_lengths)
+			return (LWGEOM *)geobuf_dec_polygon(dec, g, &offset, &ring, g->n_lengths);
+		poly = lwpoly_construct_empty(SRID_UNKNOWN, hasz, 0);
+		if (npoints)
+		{
+			if (!(pa = geobuf_dec_line(dec, g, &offset, npoints, LW_TRUE)))
+			{
+				lwpoly_free(poly);
+				return NULL;
+			}
+			lwpoly_add_ring(poly, pa);
+		}
+		return (LWGEOM *)poly;
+	}
+
+	case DATA__GEOMETRY__TYPE__MULTIPOLYGON:
+	{
+		LWMPOLY *mpoly = (LWMPOLY *)lwcollection_construct_empty(MULTIPOLYGONTYPE, SRID_UNKNOWN, hasz, 0);
+		LWPOLY *poly;
+		if (!g->n_lengths)
+		{
+			/* A single polygon of a single ring */
+			if (npoints)
+			{
+				if (!(pa = geobuf_dec_line(dec, g, &offset, npoints, LW_TRUE)))
+				{
+					lwmpoly_free(mpoly);
+					return NULL;
+				}
+				poly = lwpoly_construct_empty(SRID_UNKNOWN, hasz, 0);
+				lwpoly_add_ring(poly, pa);
+				lwmpoly_add_lwpoly(mpoly, poly);
+			}
+			return (LWGEOM *)mpoly;
+		}
+		/* Number of polygons, then the number of rings and their lengths for each */
+		ring = 1;
+		for (i = 0; i < g->lengths[0]; i++)
+		{
+			if (ring >= g->n_lengths)
+			{
+				lwmpoly_free(mpoly);
+				lwerror("lwgeom_from_geobuf: multipolygon has more polygons than lengths");
+				return NULL;
+			}
+			ring++;
+			if (!(poly = geobuf_dec_polygon(dec, g, &offset, &ring, g->lengths[ring - 1])))
+			{
+				lwmpoly_free(mpoly);
+				return NULL;
+			}
+			lwmpoly_add_lwpoly(mpoly, poly);
+		}
+		return (LWGEOM *)mpoly;
+	}
+
+	case DATA__GEOMETRY__TYPE__GEOMETRYCOLLECTION:
+	{
+		LWCOLLECTION *col = lwcollection_construct_empty(COLLECTIONTYPE, SRID_UNKNOWN, hasz, 0);
+		for (i = 0; i < g->n_geometries; i++)
+		{
+			LWGEOM *member = geobuf_dec_geometry(dec, g->geometries[i]);
+			if (!member)
+			{
+				lwcollection_free(col);
+				return NULL;
+			}
+			lwcollection_add_lwgeom(col, member);
+		}
+		return (LWGEOM *)col;
+	}
+
+	default:
+		lwerror("lwgeom_from_geobuf: unknown geometry type %d", (int)g->type);
+		return NULL;
+	}
+}
+
+/**
+ * Create an LWGEOM object from a Geobuf message. A Feature gives its
+ * geometry, and a FeatureCollection a GeometryCollection of the geometries
+ * of its features.
+ */
+LWGEOM *
+lwgeom_from_geobuf(const uint8_t *geobuf, size_t size)
+{
+	Data *data = data__unpack(&geobuf_allocator, size, geobuf);
+	GEOBUF_DEC dec;
+	LWGEOM *geom = NULL;
+	size_t i;
+
+	if (!data)
+	{
+		lwerror("lwgeom_from_geobuf: invalid Geobuf input");
+		return NULL;
+	}
+	if (!geobuf_dec_init(&dec, data->dimensions, data->precision))
+	{
+		data__free_unpacked(data, &geobuf_allocator);
+		return NULL;
+	}
+
+	switch (data->data_type_case)
+	{
+	case DATA__DATA_TYPE_GEOMETRY:
+		geom = geobuf_dec_geometry(&dec, data->geometry);
+		break;
+	case DATA__DATA_TYPE_FEATURE:
+		geom = geobuf_dec_geometry(&dec, data->feature->geometry);
+		break;
+	case DATA__DATA_TYPE_FEATURE_COLLECTION:
+	{
+		const Data__FeatureCollection *fc = data->feature_collection;
+		LWCOLLECTION *col = lwcollection_construct_empty(COLLECTIONTYPE, SRID_UNKNOWN, dec.dims > 2, 0);
+		for (i = 0; i < fc->n_features; i++)
+		{
+			LWGEOM *member = geobuf_dec_geometry(&dec, fc->features[i]->geometry);
+			if (!member)
+			{
+				lwcollection_free(col);
+				col = NULL;
+				break;
+			}
+			lwcollection_add_lwgeom(col, member);
+		}
+		geom = (LWGEOM *)col;
+		break;
+	}
+	default:
+		lwerror("lwgeom_from_geobuf: Geobuf input holds no geometry");
+	}
+
+	data__free_unpacked(data, &geobuf_allocator);
+	return geom;
+}
+
+/**********************************************************************
+ * Reader
+ */
+
+static int
+geobuf_reader_error(LWGEOBUF_READER *r, const char *message, size_t at)
+{
+	r->state = GEOBUF_DONE;
+	r->failed = LW_TRUE;
+	lwerror("%s (at offset %llu)", message, (unsigned long long)(r->base + at));
+	return LW_FAILURE;
+}
+
+/* Property of a feature value, LW_FAILURE if it has none */
+static int
+geobuf_property_value(const Data__Value *v, LWPROPERTY *p)
+{
+	switch (v->value_type_case)
+	{
+	case DATA__VALUE__VALUE_TYPE_STRING_VALUE:
+		p->type = LWPROPERTY_STRING;
+		p->string_value = v->string_value;
+		break;
+	case DATA__VALUE__VALUE_TYPE_JSON_VALUE:
+		p->type = LWPROPERTY_JSON;
+		p->string_value = v->json_value;
+		break;
+	case DATA__VALUE__VALUE_TYPE_DOUBLE_VALUE:
+		p->type = LWPROPERTY_DOUBLE;
+		p->double_value = v->double_value;
+		break;
+	case DATA__VALUE__VALUE_TYPE_POS_INT_VALUE:
+		if (v->pos_int_value > INT64_MAX)
+		{
+			p->type = LWPROPERTY_DOUBLE;
+			p->double_value = (double)v->pos_int_value;
+		}
+		else
+		{
+			p->type = LWPROPERTY_INT;
+			p->int_value = (int64_t)v->pos_int_value;
+		}
+		break;
+	case DATA__VALUE__VALUE_TYPE_NEG_INT_VALUE:
+		/* Magnitudes up to that of INT64_MIN fit */
+		if (v->neg_int_value > (uint64_t)INT64_MAX + 1)
+		{
+			p->type = LWPROPERTY_DOUBLE;
+			p->double_value = -(double)v->neg_int_value;
+		}
+		else
+		{
+			p->type = LWPROPERTY_INT;
+			p->int_value = v->neg_int_value ? -(int64_t)(v->neg_int_value - 1) - 1 : 0;
+		}
+		break;
+	case DATA__VALUE__VALUE_TYPE_BOOL_VALUE:
+		p->type = LWPROPERTY_BOOL;
+		p->int_value = v->bool_value ? 1 : 0;
+		break;
+	default:
+		return LW_FAILURE;
+	}
+	return LW_SUCCESS;
+}
+
+/* Unpack the complete feature in buf[start, start + size) and hand it over */
+static int
+geobuf_reader_feature(LWGEOBUF_READER *r, size_t start, size_t size)
+{
+	Data__Feature *feature;
+	LWGEOM *geom;
+	uint32_t nproperties = 0;
+	size_t i;
+	int rv;
+
+	feature = (Data__Feature *)protobuf_c_message_unpack(&data__feature__descriptor, &geobuf_allocator, size, r->buf + start);
+	if (!feature)
+		return geobuf_reader_error(r, "Invalid Geobuf feature", start);
+
+	if (feature->n_properties / 2 > r->maxproperties)
+	{
+		r->maxproperties = feature->n_properties / 2;
+		r->properties = lwrealloc(r->properties, r->maxproperties * sizeof(LWPROPERTY));
+	}
+	for (i = 0; i + 1 < feature->n_properties; i += 2)
+	{
+		uint32_t key = feature->properties[i];
+		uint32_t value = feature->properties[i + 1];
+		LWPROPERTY *p = &r->properties[nproperties];
+
+		if (key >= r->nkeys || value >= feature->n_values)
+		{
+			protobuf_c_message_free_unpacked(&feature->base, &geobuf_allocator);
+			return geobuf_reader_error(r, "Geobuf feature property out of range", start);
+		}
+		memset(p, 0, sizeof(LWPROPERTY));
+		p->key = r->keys[key];
+		if (geobuf_property_value(feature->values[value], p))
+			nproperties++;
+	}
+
+	geom = geobuf_dec_geometry(&r->dec, feature->geometry);
+	if (!geom)
+	{
+		protobuf_c_message_free_unpacked(&feature->base, &geobuf_allocator);
+		r->state = GEOBUF_DONE;
+		r->failed = LW_TRUE;
+		return LW_FAILURE;
+	}
+	lwgeom_add_bbox(geom);
+	rv = r->callback(geom, nproperties ? r->properties : NULL, nproperties, r->data);
+	protobuf_c_message_free_unpacked(&feature->base, &geobuf_allocator);
+	if (!rv)
+		r->state = GEOBUF_DONE;
+	return LW_SUCCESS;
+}
+
+/* A lone geometry at the top, handed over as a feature without properties */
+static int
+geobuf_reader_geometry(LWGEOBUF_READER *r, size_t start, size_t size)
+{
+	Data__Geometry *g;
+	LWGEOM *geom;
+
+	g = (Data__Geometry *)protobuf_c_message_unpack(&data__geometry__descriptor, &geobuf_allocator, size, r->buf + start);
+	if (!g)
+		return geobuf_reader_error(r, "Invalid Geobuf geometry", start);
+	geom = geobuf_dec_geometry(&r->dec, g);
+	protobuf_c_message_free_unpacked(&g->base, &geobuf_allocator);
+	if (!geom)
+	{
+		r->state = GEOBUF_DONE;
+		r->failed = LW_TRUE;
+		return LW_FAILURE;
+	}
+	lwgeom_add_bbox(geom);
+	if (!r->callback(geom, NULL, 0, r->data))
+		r->state = GEOBUF_DONE;
+	return LW_SUCCESS;
+}
+
+/*
+ * Read the key of the field at pos and the varint after it, the value of
+ * wire type 0 or the length of wire type 2. Returns LW_FALSE if the input
+ * stops within them.
+ */
+static int
+geobuf_reader_field(LWGEOBUF_READER *r, uint32_t *field, uint32_t *wire, uint64_t *value, size_t *header)
+{
+	const uint8_t *p = r->buf + r->pos;
+	const uint8_t *end = r->buf + r->len;
+	size_t n, m;
+	uint64_t key;
+
+	if (!(n = varint_size(p, end)))
+		return LW_FALSE;
+	key = varint_u64_decode(p, end, &n);
+	*field = (uint32_t)(key >> 3);
+	*wire = (uint32_t)(key & 7);
+
+	switch (*wire)
+	{
+	case 0:
+	case 2:
+		if (!(m = varint_size(p + n, end)))
+			return LW_FALSE;
+		*value = varint_u64_decode(p + n, end, &m);
+		*header = n + m;
+		break;
+	case 1:
+		*value = 8;
+		*header = n;
+		break;
+	case 5:
+		*value = 4;
+		*header = n;
+		break;
+	default:
+		/* Groups, and anything else, are not part of Geobuf */
+		*value = 0;
+		*header = 0;
+	}
+	return LW_TRUE;
+}
+
+static int
+geobuf_reader_run(LWGEOBUF_READER *r)
+{
+	while (r->state != GEOBUF_DONE)
+	{
+		uint32_t field, wire;
+		uint64_t value;
+		size_t header, avail;
+
+		if (r->skip)
+		{
+			size_t n = r->len - r->pos;
+			if (n > r->skip)
+				n = r->skip;
+			r->pos += n;
+			r->skip -= n;
+			if (r->skip)
+				return LW_SUCCESS;
+			continue;
+		}
+		if (r->state == GEOBUF_COLLECTION && r->base + r->pos == r->collection_end)
+		{
+			r->state = GEOBUF_TOP;
+			continue;
+		}
+		if (r->pos == r->len)
+			return LW_SUCCESS;
+
+		if (!geobuf_reader_field(r, &field, &wire, &value, &header))
+		{
+			if (r->len - r->pos >= 2 * GEOBUF_MAX_VARINT)
+				return geobuf_reader_error(r, "Invalid Geobuf field", r->pos);
+			return LW_SUCCESS;
+		}
+		if (!header)
+			return geobuf_reader_error(r, "Invalid Geobuf wire type", r->pos);
+		if (r->state == GEOBUF_COLLECTION)
+		{
+			uint64_t left = r->collection_end - (r->base + r->pos);
+			if (header > left || (wire != 0 && value > left - header))
+				return geobuf_reader_error(r, "Geobuf field runs past its collection", r->pos);
+		}
+		if (wire == 1 || wire == 5)
+		{
+			r->pos += header;
+			r->skip = value;
+			continue;
+		}
+
+		if (wire == 0)
+		{
+			if (r->state == GEOBUF_TOP && (field == 2 || field == 3))
+			{
+				if (value > UINT32_MAX)
+					return geobuf_reader_error(r, "Invalid Geobuf header", r->pos);
+				/* The fields may come in any order, each one sets its own part */
+				if (field == 2 && !geobuf_dec_dims(&r->dec, (uint32_t)value))
+				{
+					r->state = GEOBUF_DONE;
+					r->failed = LW_TRUE;
+					return LW_FAILURE;
+				}
+				if (field == 3)
+					r->dec.scale = pow(10.0, (double)value);
+			}
+			r->pos += header;
+			continue;
+		}
+
+		/* Length delimited */
+		if (r->state == GEOBUF_TOP && field == 4)
+		{
+			r->pos += header;
+			r->collection_end = r->base + r->pos + value;
+			r->state = GEOBUF_COLLECTION;
+			continue;
+		}
+		if (!(r->state == GEOBUF_TOP ? (field == 1 || field == 5 || field == 6) : field == 1))
+		{
+			r->pos += header;
+			r->skip = value;
+			continue;
+		}
+
+		/* Wait for the whole field */
+		avail = r->len - r->pos - header;
+		if (value > avail)
+			return LW_SUCCESS;
+
+		if (r->state == GEOBUF_TOP && field == 1)
+		{
+			char *key = lwalloc(value + 1);
+			memcpy(key, r->buf + r->pos + header, value);
+			key[value] = '\0';
+			if (r->nkeys == r->maxkeys)
+			{
+				r->maxkeys = r->maxkeys ? 2 * r->maxkeys : 16;
+				r->keys = lwrealloc(r->keys, r->maxkeys * sizeof(char *));
+			}
+			r->keys[r->nkeys++] = key;
+		}
+		else if (r->state == GEOBUF_TOP && field == 6)
+		{
+			if (!geobuf_reader_geometry(r, r->pos + header, value))
+				return LW_FAILURE;
+		}
+		else if (!geobuf_reader_feature(r, r->pos + header, value))
+			return LW_FAILURE;
+		r->pos += header + value;
+	}
+	return LW_SUCCESS;
+}
+
+/* Drop the input that is not needed anymore */
+static void
+geobuf_reader_compact(LWGEOBUF_READER *r)
+{
+	if (!r->pos)
+		return;
+	memmove(r->buf, r->buf + r->pos, r->len - r->pos);
+	r->len -= r->pos;
+	r->base += r->pos;
+	r->pos = 0;
+}
+
+LWGEOBUF_READER *
+lwgeobuf_reader_create(lwgeobuf_feature_callback callback, void *data)
+{
+	LWGEOBUF_READER *r = lwalloc(sizeof(LWGEOBUF_READER));
+	memset(r, 0, sizeof(LWGEOBUF_READER));
+	r->callback = callback;
+	r->data = data;
+	r->state = GEOBUF_TOP;
+	geobuf_dec_init(&r->dec, GEOBUF_DEFAULT_DIMENSIONS, GEOBUF_DEFAULT_PRECISION);
+	r->capacity = GEOBUF_BUFFER_SIZE;
+	r->buf = lwalloc(r->capacity);
+	return r;
+}
+
+int
+lwgeobuf_reader_push(LWGEOBUF_READER *r, const uint8_t *bytes, size_t size)
+{
+	if (r->failed)
+		return LW_FAILURE;
+	if (r->state == GEOBUF_DONE)
+		return LW_SUCCESS;
+
+	/* Skipped fields are not kept */
+	if (r->skip && r->pos == r->len)
+	{
+		size_t n = size < r->skip ? size : r->skip;
+		r->base += n;
+		r->skip -= n;
+		bytes += n;
+		size -= n;
+	}
+
+	if (r->len + size > r->capacity)
+	{
+		while (r->len + size > r->capacity)
+			r->capacity *= 2;
+		r->buf = lwrealloc(r->buf, r->capacity);
+	}
+	memcpy(r->buf + r->len, bytes, size);
+	r->len += size;
+
+	if (!geobuf_reader_run(r))
+		return LW_FAILURE;
+	geobuf_reader_compact(r);
+	return LW_SUCCESS;
+}
+
+int
+lwgeobuf_reader_finish(LWGEOBUF_READER *r)
+{
+	if (r->failed)
+		return LW_FAILURE;
+	if (r->state == GEOBUF_DONE)
+		return LW_SUCCESS;
+	if (r->state != GEOBUF_TOP || r->skip || r->pos != r->len)
+		return geobuf_reader_error(r, "Unexpected end of Geobuf input", r->len);
+	return LW_SUCCESS;
+}
+
+void
+lwgeobuf_reader_free(LWGEOBUF_READER *r)
+{
+	size_t i;
+
+	if (!r)
+		return;
+	for (i = 0; i < r->nkeys; i++)
+		lwfree(r->keys[i]);
+	if (r->keys)
+		lwfree(r->keys);
+	if (r->properties)
+		lwfree(r->properties);
+	lwfree(r->buf);
+	lwfree(r);
+}
@@ -0,0 +1,1231 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "liblwgeom_internal.h"
+#include "lwgeom_log.h"
+
+/*
+ * Streaming GeoJSON reader.
+ *
+ * Text is pushed in chunks of any size. A resumable scanner frames the top
+ * level: once the "type" of an object says it is a FeatureCollection, its
+ * other members are skipped, except for the "features" array, whose
+ * elements are taken one at a time. A FeatureCollection whose features come
+ * before its type, and any other top level object, are held until they are
+ * complete and read as a whole. Top level objects may follow each other
+ * (GeoJSON text sequences, one feature per line).
+ *
+ * Once a feature is complete in the buffer, a recursive descent parser
+ * reads it in place and writes the positions straight into the point
+ * arrays, so that only the current feature is ever held in memory. The
+ * geometries follow the rules of lwgeom_from_geojson. Members other than
+ * the geometry are only checked for balanced brackets and strings, the
+ * "properties" being handed over as raw text.
+ */
+
+#define GJS_SPACE(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
+/* Record separators of GeoJSON text sequences are spaces at the top level */
+#define GJS_TOP_SPACE(c) (GJS_SPACE(c) || (c) == 0x1E)
+#define GJS_DIGIT(c) ((unsigned char)((c) - '0') < 10)
+#define GJS_KEY_IS(key, len, name) ((len) == sizeof(name) - 1 && strncasecmp((key), (name), (len)) == 0)
+/* The value the reader just framed, quotes included */
+#define GJS_FRAMED_IS(r, text) GJS_KEY_IS((r)->buf + (r)->value, (r)->pos - (r)->value, text)
+
+#define GJS_BUFFER_SIZE 16384
+/* Nested geometry collections, as deep as json-c goes by default */
+#define GJS_MAX_NESTING 32
+
+/* Values of the "type" members besides the geometry types */
+#define GJS_TYPE_NONE 0
+#define GJS_TYPE_FEATURE 100
+#define GJS_TYPE_FEATURECOLLECTION 101
+#define GJS_TYPE_UNKNOWN 102
+
+/* Top level members the reader looks at */
+#define GJS_MEMBER_OTHER 0
+#define GJS_MEMBER_TYPE 1
+#define GJS_MEMBER_FEATURES 2
+
+typedef enum
+{
+	GJS_TOP = 0,       /* Before a top level object */
+	GJS_MEMBER_FIRST,  /* After the brace of the top level object */
+	GJS_MEMBER,        /* After a comma between its members */
+	GJS_KEY,           /* In a member name */
+	GJS_COLON,         /* After a member name */
+	GJS_VALUE,         /* Before a member value */
+	GJS_MEMBER_VALUE,  /* In a member value */
+	GJS_MEMBER_NEXT,   /* After a member value */
+	GJS_FEATURE_FIRST, /* After the bracket of the features */
+	GJS_FEATURE,       /* After a comma between features */
+	GJS_FEATURE_VALUE, /* In a feature */
+	GJS_FEATURE_NEXT,  /* After a feature */
+	GJS_DONE           /* Stopped by the callback or by an error */
+} GJS_STATE;
+
+struct LWGEOJSON_READER
+{
+	lwgeojson_feature_callback callback;
+	void *data;
+	GJS_STATE state;
+	int failed;
+
+	char *buf;       /* Text not consumed yet, null terminated */
+	size_t len;      /* Bytes of text in buf */
+	size_t capacity; /* Allocated bytes */
+	size_t pos;      /* Next byte to scan */
+	size_t base;     /* Input offset of buf[0] */
+
+	size_t object;  /* Start of the top level object */
+	int collection; /* Its "type" is FeatureCollection */
+	int streaming;  /* Its features are being read one at a time */
+	int member;     /* Current member, GJS_MEMBER_* */
+
+	/* Value being framed, across chunks */
+	size_t value;
+	uint32_t depth;
+	int in_string;
+	int escape;
+	int scalar;
+};
+
+/* Recursive descent over a complete feature, null terminated */
+typedef struct
+{
+	const char *p;
+	const char *error;   /* First error message */
+	const char *error_p; /* Where it happened */
+	int hasz;            /* Point arrays have a Z */
+	int restart;         /* A Z was found while reading without */
+	int nesting;
+} GJS_PARSER;
+
+/**********************************************************************
+ * Feature parser
+ */
+
+static void *
+gjs_fail(GJS_PARSER *P, const char *message)
+{
+	if (!P->error)
+	{
+		P->error = message;
+		P->error_p = P->p;
+	}
+	return NULL;
+}
+
+static inline void
+gjs_skip_space(GJS_PARSER *P)
+{
+	while (GJS_SPACE(*P->p))
+		P->p++;
+}
+
+/* Consume the given punctuation, after spaces */
+static inline int
+gjs_accept(GJS_PARSER *P, char c)
+{
+	gjs_skip_space(P);
+	if (*P->p != c)
+		return LW_FALSE;
+	P->p++;
+	return LW_TRUE;
+}
+
+/* Raw text between the quotes of a string, escapes left as they are */
+static int
+gjs_string(GJS_PARSER *P, const char **s, size_t *len)
+{
+	const char *p;
+
+	gjs_skip_space(P);
+	if (*P->p != '"')
+		return LW_FALSE;
+	for (p = P->p + 1; *p != '"'; p++)
+	{
+		if (!*p)
+			return LW_FALSE;
+		if (*p == '\\' && p[1])
+			p++;
+	}
+	*s = P->p + 1;
+	*len = p - *s;
+	P->p = p + 1;
+	return LW_TRUE;
+}
+
+/* "name": */
+static int
+gjs_key(GJS_PARSER *P, const char **key, size_t *len)
+{
+	if (!gjs_string(P, key, len) || !gjs_accept(P, ':'))
+	{
+		gjs_fail(P, "invalid GeoJSON representation");
+		return LW_FALSE;
+	}
+	return LW_TRUE;
+}
+
+/*
+ * A JSON number, -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][-+]?[0-9]+)?
+ */
+static int
+gjs_number(GJS_PARSER *P, double *d)
+{
+	const char *p = P->p;
+	uint64_t w = 0;
+	int64_t q = 0;
+	int negative = 0, nsig = 0, truncated = 0;
+
+	if (*p == '-')
+	{
+		negative = 1;
+		p++;
+	}
+	if (!GJS_DIGIT(*p))
+	{
+		gjs_fail(P, "Invalid number in GeoJSON");
+		return LW_FALSE;
+	}
+
+	/* Up to 19 significant digits fit in w, the others only move q */
+	if (*p == '0')
+		p++;
+	else
+	{
+		for (; GJS_DIGIT(*p); p++)
+		{
+			if (nsig < 19)
+			{
+				w = w * 10 + (uint64_t)(*p - '0');
+				nsig++;
+			}
+			else
+			{
+				q++;
+				truncated |= *p != '0';
+			}
+		}
+	}
+	if (*p == '.')
+	{
+		p++;
+		if (!GJS_DIGIT(*p))
+		{
+			gjs_fail(P, "Invalid number in GeoJSON");
+			return LW_FALSE;
+		}
+		for (; GJS_DIGIT(*p); p++)
+		{
+			if (nsig < 19)
+			{
+				w = w * 10 + (uint64_t)(*p - '0');
+				nsig += w != 0;
+				q--;
+			}
+			else
+				truncated |= *p != '0';
+		}
+	}
+	if (*p == 'e' || *p == 'E')
+	{
+		int64_t exponent = 0;
+		int exponent_negative = 0;
+
+		p++;
+		if (*p == '-' || *p == '+')
+			exponent_negative = *p++ == '-';
+		if (!GJS_DIGIT(*p))
+		{
+			gjs_fail(P, "Invalid number in GeoJSON");
+			return LW_FALSE;
+		}
+		for (; GJS_DIGIT(*p); p++)
+			if (exponent < 100000)
+				exponent = exponent * 10 + (*p - '0');
+		q += exponent_negative ? -exponent : exponent;
+	}
+
+	if (truncated || !lw_decimal_to_double(w, q, negative, d))
+		*d = strtod(P->p, NULL);
+	P->p = p;
+	return LW_TRUE;
+}
+
+/*
+ * Any value, with brackets and strings balanced. Strings and literals are
+ * not checked any further.
+ */
+static int
+gjs_skip_value(GJS_PARSER *P)
+{
+	const char *p;
+	uint32_t depth = 0;
+
+	gjs_skip_space(P);
+	p = P->p;
+	if (*p == '"')
+	{
+		const char *s;
+		size_t len;
+		if (!gjs_string(P, &s, &len))
+			return gjs_fail(P, "invalid GeoJSON representation") != NULL;
+		return LW_TRUE;
+	}
+	if (*p == '-' || GJS_DIGIT(*p))
+	{
+		double d;
+		return gjs_number(P, &d);
+	}
+	if (!strncmp(p, "true", 4) || !strncmp(p, "null", 4))
+	{
+		P->p += 4;
+		return LW_TRUE;
+	}
+	if (!strncmp(p, "false", 5))
+	{
+		P->p += 5;
+		return LW_TRUE;
+	}
+	if (*p != '{' && *p != '[')
+		return gjs_fail(P, "invalid GeoJSON representation") != NULL;
+
+	for (; *p; p++)
+	{
+		if (*p == '"')
+		{
+			for (p++; *p != '"'; p++)
+			{
+				if (!*p)
+					break;
+				if (*p == '\\' && p[1])
+					p++;
+			}
+			if (!*p)
+				break;
+		}
+		else if (*p == '{' || *p == '[')
+			depth++;
+		else if ((*p == '}' || *p == ']') && --depth == 0)
+		{
+			P->p = p + 1;
+			return LW_TRUE;
+		}
+	}
+	P->p = p;
+	return gjs_fail(P, "invalid GeoJSON representation") != NULL;
+}
+
+/* The "type" member value */
+static int
+gjs_type(GJS_PARSER *P, int *type)
+{
+	const char *s;
+	size_t len;
+
+	if (!gjs_string(P, &s, &len))
+	{
+		gjs_fail(P, "unknown GeoJSON type");
+		return LW_FALSE;
+	}
+	if (GJS_KEY_IS(s, len, "Point"))
+		*type = POINTTYPE;
+	else if (GJS_KEY_IS(s, len, "LineString"))
+		*type = LINETYPE;
+	else if (GJS_KEY_IS(s, len, "Polygon"))
+		*type = POLYGONTYPE;
+	else if (GJS_KEY_IS(s, len, "MultiPoint"))
+		*type = MULTIPOINTTYPE;
+	else if (GJS_KEY_IS(s, len, "MultiLineString"))
+		*type = MULTILINETYPE;
+	else if (GJS_KEY_IS(s, len, "MultiPolygon"))
+		*type = MULTIPOLYGONTYPE;
+	else if (GJS_KEY_IS(s, len, "GeometryCollection"))
+		*type = COLLECTIONTYPE;
+	else if (GJS_KEY_IS(s, len, "Feature"))
+		*type = GJS_TYPE_FEATURE;
+	else if (GJS_KEY_IS(s, len, "FeatureCollection"))
+		*type = GJS_TYPE_FEATURECOLLECTION;
+	else
+		*type = GJS_TYPE_UNKNOWN;
+	return LW_TRUE;
+}
+
+/*
+ * [x, y, z...] appended to the point array, ordinates after the third
+ * ignored. Returns the number of ordinates, -1 on failure.
+ */
+static int
+gjs_position(GJS_PARSER *P, POINTARRAY *pa)
+{
+	double c[3] = {0, 0, 0};
+	size_t size;
+	int n = 0;
+
+	if (!gjs_accept(P, '['))
+	{
+		gjs_fail(P, "The 'coordinates' in GeoJSON are not sufficiently nested");
+		return -1;
+	}
+	if (gjs_accept(P, ']'))
+		return 0;
+	do
+	{
+		double d;
+		gjs_skip_space(P);
+		if (!gjs_number(P, &d))
+			return -1;
+		if (n < 3)
+			c[n] = d;
+		n++;
+	} while (gjs_accept(P, ','));
+	if (!gjs_accept(P, ']'))
+	{
+		gjs_fail(P, "The 'coordinates' in GeoJSON are not sufficiently nested");
+		return -1;
+	}
+	if (n < 2)
+	{
+		gjs_fail(P, "Too few ordinates in GeoJSON");
+		return -1;
+	}
+
+	/* Everything is read again with a Z */
+	if (n > 2 && !P->hasz)
+	{
+		P->restart = LW_TRUE;
+		return -1;
+	}
+
+	size = FLAGS_NDIMS(pa->flags) * sizeof(double);
+	if (pa->npoints == pa->maxpoints)
+	{
+		pa->maxpoints *= 2;
+		pa->serialized_pointlist = lwrealloc(pa->serialized_pointlist, size * pa->maxpoints);
+	}
+	memcpy(pa->serialized_pointlist + size * pa->npoints, c, size);
+	pa->npoints++;
+	return n;
+}
+
+/*
+ * [position, ...] into a new point array, the number of positions in
+ * *count, counting the empty ones.
+ */
+static POINTARRAY *
+gjs_positions(GJS_PARSER *P, uint32_t *count, const char *message)
+{
+	POINTARRAY *pa;
+
+	*count = 0;
+	if (!gjs_accept(P, '['))
+		return gjs_fail(P, message);
+	pa = ptarray_construct_empty(P->hasz, 0, 4);
+	if (gjs_accept(P, ']'))
+		return pa;
+	do
+	{
+		if (gjs_position(P, pa) < 0)
+		{
+			ptarray_free(pa);
+			return NULL;
+		}
+		(*count)++;
+	} while (gjs_accept(P, ','));
+	if (!gjs_accept(P, ']'))
+	{
+		ptarray_free(pa);
+		return gjs_fail(P, "The 'coordinates' in GeoJSON are not sufficiently nested");
+	}
+	return pa;
+}
+
+/*
+ * [ring, ...] of a polygon. Empty rings are skipped, and an empty shell
+ * makes an empty polygon.
+ */
+static LWPOLY *
+gjs_rings(GJS_PARSER *P, const char *message)
+{
+	POINTARRAY **rings = NULL;
+	uint32_t nrings = 0, maxrings = 0, i;
+	int shell_empty = LW_FALSE;
+
+	if (!gjs_accept(P, '['))
+		return gjs_fail(P, message);
+	if (!gjs_accept(P, ']'))
+	{
+		do
+		{
+			uint32_t count;
+			POINTARRAY *pa;
+
+			if (shell_empty)
+			{
+				if (!gjs_skip_value(P))
+					goto fail;
+				continue;
+			}
+			pa = gjs_positions(P, &count, "The 'coordinates' in GeoJSON ring are not an array");
+			if (!pa)
+				goto fail;
+			if (!count)
+			{
+				ptarray_free(pa);
+				shell_empty = !nrings;
+				continue;
+			}
+			if (nrings == maxrings)
+			{
+				maxrings = maxrings ? maxrings * 2 : 4;
+				rings = rings ? lwrealloc(rings, maxrings * sizeof(POINTARRAY *))
+					      : lwalloc(maxrings * sizeof(POINTARRAY *));
+			}
+			rings[nrings++] = pa;
+		} while (gjs_accept(P, ','));
+		if (!gjs_accept(P, ']'))
+		{
+			gjs_fail(P, "The 'coordinates' in GeoJSON ring are not an array");
+			goto fail;
+		}
+	}
+
+	if (!nrings)
+	{
+		if (rings)
+			lwfree(rings);
+		return lwpoly_construct_empty(SRID_UNKNOWN, P->hasz, 0);
+	}
+	return lwpoly_construct(SRID_UNKNOWN, NULL, nrings, rings);
+
+fail:
+	for (i = 0; i < nrings; i++)
+		ptarray_free(rings[i]);
+	if (rings)
+		lwfree(rings);
+	return NULL;
+}
+
+static LWGEOM *gjs_geometry(GJS_PARSER *P);
+
+/* The "coordinates" or "geometries" of a geometry of the given type */
+static LWGEOM *
+gjs_geometry_body(GJS_PARSER *P, int type)
+{
+	const char *not_an_array = "The 'coordinates' in GeoJSON are not an array";
+	LWCOLLECTION *col;
+	POINTARRAY *pa;
+	uint32_t count;
+
+	switch (type)
+	{
+	case POINTTYPE:
+		gjs_skip_space(P);
+		if (*P->p != '[')
+			return gjs_fail(P, not_an_array);
+		pa = ptarray_construct_empty(P->hasz, 0, 1);
+		if (gjs_position(P, pa) < 0)
+		{
+			ptarray_free(pa);
+			return NULL;
+		}
+		return lwpoint_as_lwgeom(lwpoint_construct(SRID_UNKNOWN, NULL, pa));
+
+	case LINETYPE:
+		pa = gjs_positions(P, &count, not_an_array);
+		return pa ? lwline_as_lwgeom(lwline_construct(SRID_UNKNOWN, NULL, pa)) : NULL;
+
+	case POLYGONTYPE:
+		return lwpoly_as_lwgeom(gjs_rings(P, not_an_array));
+
+	case COLLECTIONTYPE:
+		col = lwcollection_construct_empty(COLLECTIONTYPE, SRID_UNKNOWN, P->hasz, 0);
+		/* Anything but an array is an empty collection */
+		gjs_skip_space(P);
+		if (*P->p != '[')
+		{
+			if (gjs_skip_value(P))
+				return lwcollection_as_lwgeom(col);
+			lwcollection_free(col);
+			return NULL;
+		}
+		P->p++;
+		if (gjs_accept(P, ']'))
+			return lwcollection_as_lwgeom(col);
+		do
+		{
+			LWGEOM *geom = gjs_geometry(P);
+			if (!geom)
+			{
+				lwcollection_free(col);
+				return NULL;
+			}
+			lwcollection_add_lwgeom(col, geom);
+		} while (gjs_accept(P, ','));
+		if (!gjs_accept(P, ']'))
+		{
+			lwcollection_free(col);
+			return gjs_fail(P, "invalid GeoJSON representation");
+		}
+		return lwcollection_as_lwgeom(col);
+
+	default:
+		break;
+	}
+
+	/* Multi geometries */
+	if (!gjs_accept(P, '['))
+		return gjs_fail(P, not_an_array);
+	col = lwcollection_construct_empty(type, SRID_UNKNOWN, P->hasz, 0);
+	if (gjs_accept(P, ']'))
+		return lwcollection_as_lwgeom(col);
+	do
+	{
+		LWGEOM *geom = NULL;
+
+		if (type == MULTIPOINTTYPE)
+		{
+			pa = ptarray_construct_empty(P->hasz, 0, 1);
+			if (gjs_position(P, pa) < 0)
+				ptarray_free(pa);
+			else
+				geom = lwpoint_as_lwgeom(lwpoint_construct(SRID_UNKNOWN, NULL, pa));
+		}
+		else if (type == MULTILINETYPE)
+		{
+			pa = gjs_positions(P, &count, "The 'coordinates' in GeoJSON are not sufficiently nested");
+			if (pa)
+				geom = lwline_as_lwgeom(lwline_construct(SRID_UNKNOWN, NULL, pa));
+		}
+		else
+			geom = lwpoly_as_lwgeom(gjs_rings(P, "The 'coordinates' in GeoJSON ring are not an array"));
+
+		if (!geom)
+		{
+			lwcollection_free(col);
+			return NULL;
+		}
+		lwcollection_add_lwgeom(col, geom);
+	} while (gjs_accept(P, ','));
+	if (!gjs_accept(P, ']'))
+	{
+		lwcollection_free(col);
+		return gjs_fail(P, "The 'coordinates' in GeoJSON are not sufficiently nested");
+	}
+	return lwcollection_as_lwgeom(col);
+}
+
+/*
+ * A geometry object. Its members may come in any order: when the type
+ * comes after the coordinates, these are skipped and read afterwards.
+ */
+static LWGEOM *
+gjs_geometry(GJS_PARSER *P)
+{
+	const char *coordinates = NULL, *geometries = NULL, *key, *end;
+	int type = GJS_TYPE_NONE;
+	LWGEOM *geom = NULL;
+	size_t len;
+
+	if (!gjs_accept(P, '{'))
+		return gjs_fail(P, "invalid GeoJSON representation");
+	if (++P->nesting > GJS_MAX_NESTING)
+		return gjs_fail(P, "GeoJSON nesting is too deep");
+
+	if (!gjs_accept(P, '}'))
+	{
+		do
+		{
+			if (!gjs_key(P, &key, &len))
+				goto fail;
+			if (GJS_KEY_IS(key, len, "type"))
+			{
+				if (!gjs_type(P, &type))
+					goto fail;
+				continue;
+			}
+			gjs_skip_space(P);
+			if (!geom && type > 0 && type < GJS_TYPE_FEATURE &&
+			    (type == COLLECTIONTYPE ? GJS_KEY_IS(key, len, "geometries")
+						    : GJS_KEY_IS(key, len, "coordinates")))
+			{
+				if (!(geom = gjs_geometry_body(P, type)))
+					goto fail;
+				continue;
+			}
+			if (GJS_KEY_IS(key, len, "coordinates"))
+				coordinates = P->p;
+			else if (GJS_KEY_IS(key, len, "geometries"))
+				geometries = P->p;
+			if (!gjs_skip_value(P))
+				goto fail;
+		} while (gjs_accept(P, ','));
+		if (!gjs_accept(P, '}'))
+		{
+			gjs_fail(P, "invalid GeoJSON representation");
+			goto fail;
+		}
+	}
+
+	if (!geom)
+	{
+		if (type == GJS_TYPE_NONE)
+			return gjs_fail(P, "unknown GeoJSON type");
+		if (type >= GJS_TYPE_FEATURE)
+			return gjs_fail(P, "invalid GeoJson representation");
+		if (type == COLLECTIONTYPE ? !geometries : !coordinates)
+			return gjs_fail(P,
+					type == COLLECTIONTYPE ? "Unable to find 'geometries' in GeoJSON string"
+							       : "Unable to find 'coordinates' in GeoJSON string");
+
+		/* Members that came before the type */
+		end = P->p;
+		P->p = type == COLLECTIONTYPE ? geometries : coordinates;
+		if (!(geom = gjs_geometry_body(P, type)))
+			return NULL;
+		P->p = end;
+	}
+	P->nesting--;
+	return geom;
+
+fail:
+	if (geom)
+		lwgeom_free(geom);
+	return NULL;
+}
+
+/*
+ * A Feature, or a bare geometry. The properties are returned as the raw
+ * text of their value, NULL when there are none. A FeatureCollection
+ * without features reads as such, with no geometry.
+ */
+static int
+gjs_feature(GJS_PARSER *P, int *type, LWGEOM **geom, const char **properties, size_t *properties_size)
+{
+	const char *object = P->p, *key;
+	size_t len;
+
+	*type = GJS_TYPE_NONE;
+	*geom = NULL;
+	*properties = NULL;
+	*properties_size = 0;
+
+	if (!gjs_accept(P, '{'))
+		return gjs_fail(P, "invalid GeoJSON representation") != NULL;
+	if (!gjs_accept(P, '}'))
+	{
+		do
+		{
+			if (!gjs_key(P, &key, &len))
+				goto fail;
+			if (GJS_KEY_IS(key, len, "type"))
+			{
+				if (!gjs_type(P, type))
+					goto fail;
+				/* A geometry, read from the start again */
+				if (*type < GJS_TYPE_FEATURE)
+				{
+					if (*geom)
+						lwgeom_free(*geom);
+					*properties = NULL;
+					*properties_size = 0;
+					P->p = object;
+					*geom = gjs_geometry(P);
+					return *geom != NULL;
+				}
+				continue;
+			}
+			gjs_skip_space(P);
+			if (GJS_KEY_IS(key, len, "geometry") && !*geom && strncmp(P->p, "null", 4))
+			{
+				if (!(*geom = gjs_geometry(P)))
+					goto fail;
+				continue;
+			}
+			if (GJS_KEY_IS(key, len, "properties"))
+				*properties = P->p;
+			if (!gjs_skip_value(P))
+				goto fail;
+			if (GJS_KEY_IS(key, len, "properties"))
+				*properties_size = P->p - *properties;
+		} while (gjs_accept(P, ','));
+		if (!gjs_accept(P, '}'))
+		{
+			gjs_fail(P, "invalid GeoJSON representation");
+			goto fail;
+		}
+	}
+
+	if (*type == GJS_TYPE_FEATURE || *type == GJS_TYPE_FEATURECOLLECTION)
+		return LW_SUCCESS;
+	gjs_fail(P, *type == GJS_TYPE_NONE ? "unknown GeoJSON type" : "invalid GeoJson representation");
+
+fail:
+	if (*geom)
+		lwgeom_free(*geom);
+	*geom = NULL;
+	return LW_FAILURE;
+}
+
+/**********************************************************************
+ * Reader
+ */
+
+static int
+gjs_reader_error(LWGEOJSON_READER *r, const char *message, size_t at)
+{
+	r->state = GJS_DONE;
+	r->failed = LW_TRUE;
+	lwerror("%s (at offset %llu)", message, (unsigned long long)(r->base + at));
+	return LW_FAILURE;
+}
+
+static int gjs_reader_collection(LWGEOJSON_READER *r, size_t start, size_t end);
+
+/*
+ * Parse the complete feature in buf[start, end) and hand it over. Features
+ * of a collection cannot be collections themselves.
+ */
+static int
+gjs_reader_feature(LWGEOJSON_READER *r, size_t start, size_t end, int in_collection)
+{
+	GJS_PARSER P;
+	LWGEOM *geom = NULL;
+	const char *properties;
+	size_t properties_size;
+	char saved = r->buf[end];
+	int rv, type;
+
+	/* The parser stops at the terminator */
+	r->buf[end] = '\0';
+	memset(&P, 0, sizeof(GJS_PARSER));
+	for (;;)
+	{
+		P.p = r->buf + start;
+		P.error = NULL;
+		P.restart = LW_FALSE;
+		P.nesting = 0;
+		rv = gjs_feature(&P, &type, &geom, &properties, &properties_size);
+		if (rv || !P.restart || P.hasz)
+			break;
+		/* A position has a Z, which all of them get */
+		P.hasz = LW_TRUE;
+	}
+	if (rv)
+	{
+		gjs_skip_space(&P);
+		/* Collections only come at the top */
+		if (type == GJS_TYPE_FEATURECOLLECTION && in_collection)
+		{
+			rv = LW_FAILURE;
+			P.p = r->buf + start;
+			gjs_fail(&P, "invalid GeoJson representation");
+		}
+		else if (*P.p)
+		{
+			rv = LW_FAILURE;
+			gjs_fail(&P, "invalid GeoJSON representation");
+		}
+		if (!rv && geom)
+			lwgeom_free(geom);
+	}
+	r->buf[end] = saved;
+
+	if (!rv)
+	{
+		gjs_fail(&P, "invalid GeoJSON representation");
+		return gjs_reader_error(r, P.error, P.error_p - r->buf);
+	}
+
+	/* A "geometry" member of a collection is not a feature */
+	if (type == GJS_TYPE_FEATURECOLLECTION)
+	{
+		if (geom)
+			lwgeom_free(geom);
+		return gjs_reader_collection(r, start, end);
+	}
+	if (geom)
+		lwgeom_add_bbox(geom);
+	if (!r->callback(geom, properties, properties_size, r->data))
+		r->state = GJS_DONE;
+	return LW_SUCCESS;
+}
+
+/*
+ * The features of a FeatureCollection read as a whole, once complete. Its
+ * text has been checked by gjs_feature already.
+ */
+static int
+gjs_reader_collection(LWGEOJSON_READER *r, size_t start, size_t end)
+{
+	GJS_PARSER P;
+	const char *key;
+	size_t len, feature;
+	char saved = r->buf[end];
+	int rv = LW_SUCCESS;
+
+	r->buf[end] = '\0';
+	memset(&P, 0, sizeof(GJS_PARSER));
+	P.p = r->buf + start;
+	if (gjs_accept(&P, '{') && !gjs_accept(&P, '}'))
+	{
+		do
+		{
+			if (!gjs_key(&P, &key, &len))
+				break;
+			if (!GJS_KEY_IS(key, len, "features") || !gjs_accept(&P, '['))
+			{
+				gjs_skip_value(&P);
+				continue;
+			}
+			if (gjs_accept(&P, ']'))
+				continue;
+			do
+			{
+				gjs_skip_space(&P);
+				feature = P.p - r->buf;
+				gjs_skip_value(&P);
+				rv = gjs_reader_feature(r, feature, P.p - r->buf, LW_TRUE);
+			} while (rv && r->state != GJS_DONE && gjs_accept(&P, ','));
+			gjs_accept(&P, ']');
+		} while (rv && r->state != GJS_DONE && gjs_accept(&P, ','));
+	}
+	r->buf[end] = saved;
+	return rv;
+}
+
+/* Start framing the value at pos */
+static int
+gjs_frame_start(LWGEOJSON_READER *r)
+{
+	char c = r->buf[r->pos];
+
+	if (!(c == '{' || c == '[' || c == '"' || c == '-' || GJS_DIGIT(c) || c == 't' || c == 'f' || c == 'n'))
+		return gjs_reader_error(r, "invalid GeoJSON representation", r->pos);
+	r->value = r->pos;
+	r->depth = 0;
+	r->in_string = LW_FALSE;
+	r->escape = LW_FALSE;
+	r->scalar = !(c == '{' || c == '[' || c == '"');
+	return LW_SUCCESS;
+}
+
+/* Bytes that stop the framing scan, outside and inside of strings */
+static const unsigned char gjs_frame_stop[256] = {['\0'] = 1, ['"'] = 1, ['{'] = 1, ['}'] = 1, ['['] = 1, [']'] = 1};
+static const unsigned char gjs_string_stop[256] = {['\0'] = 1, ['"'] = 1, ['\\'] = 1};
+
+/*
+ * Advance over the value that started at r->value, across chunks. Returns
+ * LW_TRUE once it is complete, with pos just after it. A number or literal
+ * is only complete after a delimiter, or at the end of the input.
+ */
+static int
+gjs_frame(LWGEOJSON_READER *r, int last)
+{
+	const char *buf = r->buf;
+	size_t i = r->pos, len = r->len;
+
+	if (r->scalar)
+	{
+		while (i < len && !(GJS_SPACE(buf[i]) || buf[i] == ',' || buf[i] == '}' || buf[i] == ']'))
+			i++;
+		r->pos = i;
+		return i < len || last;
+	}
+
+	/* The buffer is null terminated, so the tables stop at its end */
+	for (; i < len; i++)
+	{
+		char c;
+
+		if (r->in_string)
+		{
+			if (r->escape)
+			{
+				r->escape = LW_FALSE;
+				continue;
+			}
+			while (!gjs_string_stop[(unsigned char)buf[i]])
+				i++;
+			if (i >= len)
+				break;
+			if (buf[i] == '\\')
+				r->escape = LW_TRUE;
+			else if (buf[i] == '"')
+			{
+				r->in_string = LW_FALSE;
+				if (!r->depth)
+				{
+					r->pos = i + 1;
+					return LW_TRUE;
+				}
+			}
+			continue;
+		}
+
+		while (!gjs_frame_stop[(unsigned char)buf[i]])
+			i++;
+		if (i >= len)
+			break;
+		c = buf[i];
+		if (c == '"')
+			r->in_string = LW_TRUE;
+		else if (c == '{' || c == '[')
+			r->depth++;
+		else if ((c == '}' || c == ']') && --r->depth == 0)
+		{
+			r->pos = i + 1;
+			return LW_TRUE;
+		}
+	}
+	r->pos = len;
+	return LW_FALSE;
+}
+
+/* The top level object is complete */
+static int
+gjs_object_end(LWGEOJSON_READER *r)
+{
+	r->state = GJS_TOP;
+	if (r->streaming)
+		return LW_SUCCESS;
+	return gjs_reader_feature(r, r->object, r->pos, LW_FALSE);
+}
+
+/* Consume the buffered text as far as it goes */
+static int
+gjs_run(LWGEOJSON_READER *r, int last)
+{
+	for (;;)
+	{
+		GJS_STATE state = r->state;
+		char c;
+
+		if (state == GJS_DONE)
+			return LW_SUCCESS;
+
+		/* Spaces between the tokens */
+		if (state != GJS_KEY && state != GJS_MEMBER_VALUE && state != GJS_FEATURE_VALUE)
+		{
+			while (r->pos < r->len && GJS_TOP_SPACE(r->buf[r->pos]))
+				r->pos++;
+			if (r->pos == r->len)
+				return LW_SUCCESS;
+		}
+		c = r->buf[r->pos];
+
+		switch (state)
+		{
+		case GJS_TOP:
+			if (c != '{')
+				return gjs_reader_error(r, "invalid GeoJSON representation", r->pos);
+			r->object = r->pos++;
+			r->collection = LW_FALSE;
+			r->streaming = LW_FALSE;
+			r->state = GJS_MEMBER_FIRST;
+			break;
+
+		case GJS_MEMBER_FIRST:
+		case GJS_MEMBER:
+			if (c == '}' && state == GJS_MEMBER_FIRST)
+			{
+				r->pos++;
+				if (!gjs_object_end(r))
+					return LW_FAILURE;
+				break;
+			}
+			if (c != '"')
+				return gjs_reader_error(r, "invalid GeoJSON representation", r->pos);
+			gjs_frame_start(r);
+			r->state = GJS_KEY;
+			break;
+
+		case GJS_KEY:
+			if (!gjs_frame(r, last))
+				return LW_SUCCESS;
+			if (GJS_FRAMED_IS(r, "\"type\""))
+				r->member = GJS_MEMBER_TYPE;
+			else if (GJS_FRAMED_IS(r, "\"features\""))
+				r->member = GJS_MEMBER_FEATURES;
+			else
+				r->member = GJS_MEMBER_OTHER;
+			r->state = GJS_COLON;
+			break;
+
+		case GJS_COLON:
+			if (c != ':')
+				return gjs_reader_error(r, "invalid GeoJSON representation", r->pos);
+			r->pos++;
+			r->state = GJS_VALUE;
+			break;
+
+		case GJS_VALUE:
+			/* Features that come before the type are buffered with the rest */
+			if (r->member == GJS_MEMBER_FEATURES && r->collection && c == '[')
+			{
+				r->pos++;
+				r->streaming = LW_TRUE;
+				r->state = GJS_FEATURE_FIRST;
+				break;
+			}
+			if (!gjs_frame_start(r))
+				return LW_FAILURE;
+			r->state = GJS_MEMBER_VALUE;
+			break;
+
+		case GJS_MEMBER_VALUE:
+			if (!gjs_frame(r, last))
+				return LW_SUCCESS;
+			if (r->member == GJS_MEMBER_TYPE && GJS_FRAMED_IS(r, "\"FeatureCollection\""))
+				r->collection = LW_TRUE;
+			r->state = GJS_MEMBER_NEXT;
+			break;
+
+		case GJS_MEMBER_NEXT:
+			r->pos++;
+			if (c == ',')
+				r->state = GJS_MEMBER;
+			else if (c != '}')
+				return gjs_reader_error(r, "invalid GeoJSON representation", r->pos - 1);
+			else if (!gjs_object_end(r))
+				return LW_FAILURE;
+			break;
+
+		case GJS_FEATURE_FIRST:
+		case GJS_FEATURE:
+			if (c == ']' && state == GJS_FEATURE_FIRST)
+			{
+				r->pos++;
+				r->state = GJS_MEMBER_NEXT;
+				break;
+			}
+			if (c != '{')
+				return gjs_reader_error(r, "invalid GeoJSON representation", r->pos);
+			gjs_frame_start(r);
+			r->state = GJS_FEATURE_VALUE;
+			break;
+
+		case GJS_FEATURE_VALUE:
+			if (!gjs_frame(r, last))
+				return LW_SUCCESS;
+			r->state = GJS_FEATURE_NEXT;
+			if (!gjs_reader_feature(r, r->value, r->pos, LW_TRUE))
+				return LW_FAILURE;
+			break;
+
+		case GJS_FEATURE_NEXT:
+			r->pos++;
+			if (c == ',')
+				r->state = GJS_FEATURE;
+			else if (c == ']')
+				r->state = GJS_MEMBER_NEXT;
+			else
+				return gjs_reader_error(r, "invalid GeoJSON representation", r->pos - 1);
+			break;
+
+		case GJS_DONE:
+			return LW_SUCCESS;
+		}
+	}
+}
+
+/* Drop the text that is not needed anymore */
+static void
+gjs_compact(LWGEOJSON_READER *r)
+{
+	size_t keep = r->pos;
+
+	if (r->state == GJS_KEY || r->state == GJS_MEMBER_VALUE || r->state == GJS_FEATURE_VALUE)
+		keep = r->value;
+	if (r->state != GJS_TOP && !r->streaming)
+		keep = r->object;
+	if (!keep)
+		return;
+
+	memmove(r->buf, r->buf + keep, r->len - keep + 1);
+	r->len -= keep;
+	r->pos -= keep;
+	r->base += keep;
+	r->value = r->value >= keep ? r->value - keep : 0;
+	r->object = r->object >= keep ? r->object - keep : 0;
+}
+
+LWGEOJSON_READER *
+lwgeojson_reader_create(lwgeojson_feature_callback callback, void *data)
+{
+	LWGEOJSON_READER *r = lwalloc(sizeof(LWGEOJSON_READER));
+	memset(r, 0, sizeof(LWGEOJSON_READER));
+	r->callback = callback;
+	r->data = data;
+	r->state = GJS_TOP;
+	r->capacity = GJS_BUFFER_SIZE;
+	r->buf = lwalloc(r->capacity);
+	r->buf[0] = '\0';
+	return r;
+}
+
+int
+lwgeojson_reader_push(LWGEOJSON_READER *r, const char *text, size_t size)
+{
+	if (r->failed)
+		return LW_FAILURE;
+	if (r->state == GJS_DONE)
+		return LW_SUCCESS;
+
+	if (r->len + size + 1 > r->capacity)
+	{
+		while (r->len + size + 1 > r->capacity)
+			r->capacity *= 2;
+		r->buf = lwrealloc(r->buf, r->capacity);
+	}
+	memcpy(r->buf + r->len, text, size);
+	r->len += size;
+	r->buf[r->len] = '\0';
+
+	if (!gjs_run(r, LW_FALSE))
+		return LW_FAILURE;
+	gjs_compact(r);
+	return LW_SUCCESS;
+}
+
+int
+lwgeojson_reader_finish(LWGEOJSON_READER *r)
+{
+	if (r->failed)
+		return LW_FAILURE;
+	if (!gjs_run(r, LW_TRUE))
+		return LW_FAILURE;
+	if (r->state != GJS_TOP && r->state != GJS_DONE)
+		return gjs_reader_error(r, "Unexpected end of GeoJSON input", r->len);
+	return LW_SUCCESS;
+}
+
+void
+lwgeojson_reader_free(LWGEOJSON_READER *r)
+{
+	if (!r)
+		return;
+	lwfree(r->buf);
+	lwfree(r);
+}
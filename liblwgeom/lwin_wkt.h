@@ -84,3 +84,8 @@ LWGEOM* wkt_parser_collection_new(LWGEOM *geom);
 LWGEOM* wkt_parser_collection_add_geom(LWGEOM *col, LWGEOM *geom);
 LWGEOM* wkt_parser_collection_finalize(int lwtype, LWGEOM *col, char *dimensionality);
 void wkt_parser_geometry_new(LWGEOM *geom, int32_t srid);
+
+/*
+* Reader for the common geometry types, tried before the bison parser.
+*/
+int wkt_fast_parse(char *wktstr);
@@ -0,0 +1,507 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <stdlib.h>
+
+#include "lwin_wkt.h"
+#include "lwgeom_log.h"
+
+/*
+ * Recursive descent reader for the common WKT inputs: points, lines,
+ * polygons, their multi versions and collections of them.
+ *
+ * It accepts a subset of what the grammar accepts, and builds the same
+ * geometries: tokens follow the rules of the lexer (case insensitive
+ * keywords matched longest first, numbers only followed by a delimiter),
+ * and the structure goes through the same wkt_parser_* actions. Only the
+ * point arrays are filled directly, without the per coordinate calls.
+ *
+ * Anything else (curves, surfaces, any error) returns LW_FAILURE before
+ * touching the SRID, and lwgeom_parse_wkt runs the grammar from the
+ * start, which reports the errors with their location.
+ */
+
+#define WKT_FAST_SPACE(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
+#define WKT_FAST_DELIMITER(c) (WKT_FAST_SPACE(c) || (c) == ',' || (c) == ')')
+#define WKT_FAST_DIGIT(c) ((unsigned char)((c) - '0') < 10)
+#define WKT_FAST_NUMBER_START(c) (WKT_FAST_DIGIT(c) || (c) == '-' || (c) == '.' || (c) == 'n' || (c) == 'N')
+#define WKT_FAST_FAILED() (global_parser_result.errcode != 0)
+
+typedef struct
+{
+	char *p; /* Next character to read */
+} WKT_FAST;
+
+typedef enum
+{
+	WKT_FAST_OTHER = 0, /* Not a keyword, or a type left to the grammar */
+	WKT_FAST_TYPE,
+	WKT_FAST_EMPTY,
+	WKT_FAST_DIMS
+} WKT_FAST_TOKEN;
+
+typedef struct
+{
+	const char *name;
+	size_t len;
+	WKT_FAST_TOKEN token;
+	uint8_t type;
+} WKT_FAST_KEYWORD;
+
+/* Every word of the lexer, so that the longest match is the lexer one */
+static const WKT_FAST_KEYWORD wkt_fast_keywords[] = {
+    {"GEOMETRYCOLLECTION", 18, WKT_FAST_TYPE, COLLECTIONTYPE},
+    {"MULTISURFACE", 12, WKT_FAST_OTHER, 0},
+    {"MULTIPOLYGON", 12, WKT_FAST_TYPE, MULTIPOLYGONTYPE},
+    {"MULTICURVE", 10, WKT_FAST_OTHER, 0},
+    {"MULTILINESTRING", 15, WKT_FAST_TYPE, MULTILINETYPE},
+    {"MULTIPOINT", 10, WKT_FAST_TYPE, MULTIPOINTTYPE},
+    {"CURVEPOLYGON", 12, WKT_FAST_OTHER, 0},
+    {"POLYGON", 7, WKT_FAST_TYPE, POLYGONTYPE},
+    {"COMPOUNDCURVE", 13, WKT_FAST_OTHER, 0},
+    {"CIRCULARSTRING", 14, WKT_FAST_OTHER, 0},
+    {"LINESTRING", 10, WKT_FAST_TYPE, LINETYPE},
+    {"POLYHEDRALSURFACE", 17, WKT_FAST_OTHER, 0},
+    {"TRIANGLE", 8, WKT_FAST_OTHER, 0},
+    {"TIN", 3, WKT_FAST_OTHER, 0},
+    {"POINT", 5, WKT_FAST_TYPE, POINTTYPE},
+    {"EMPTY", 5, WKT_FAST_EMPTY, 0},
+    {"ZM", 2, WKT_FAST_DIMS, 0},
+    {"Z", 1, WKT_FAST_DIMS, 0},
+    {"M", 1, WKT_FAST_DIMS, 0}};
+
+#define WKT_FAST_NUM_KEYWORDS (sizeof(wkt_fast_keywords) / sizeof(wkt_fast_keywords[0]))
+
+/*
+ * A number token of the lexer, -?([0-9]+\.?|[0-9]*\.?[0-9]+([eE][-+]?[0-9]+)?)
+ * or NaN, followed by a delimiter. Returns the end of the number, NULL if
+ * the text is no such token.
+ */
+static char *
+wkt_fast_number(char *p, double *d)
+{
+	char *start = p;
+	uint64_t w = 0;
+	int64_t q = 0;
+	int negative = 0, ndigits = 0, nsig = 0, truncated = 0, ends_with_digit;
+
+	if ((*p | 0x20) == 'n')
+	{
+		if ((p[1] | 0x20) != 'a' || (p[2] | 0x20) != 'n' || !WKT_FAST_DELIMITER(p[3]))
+			return NULL;
+		*d = NAN;
+		return p + 3;
+	}
+
+	if (*p == '-')
+	{
+		negative = 1;
+		p++;
+	}
+
+	/* Up to 19 significant digits fit in w, the others only move q */
+	for (; WKT_FAST_DIGIT(*p); p++, ndigits++)
+	{
+		if (nsig < 19)
+		{
+			w = w * 10 + (uint64_t)(*p - '0');
+			nsig += w != 0;
+		}
+		else
+		{
+			q++;
+			truncated |= *p != '0';
+		}
+	}
+	ends_with_digit = ndigits > 0;
+	if (*p == '.')
+	{
+		p++;
+		ends_with_digit = LW_FALSE;
+		for (; WKT_FAST_DIGIT(*p); p++, ndigits++)
+		{
+			ends_with_digit = LW_TRUE;
+			if (nsig < 19)
+			{
+				w = w * 10 + (uint64_t)(*p - '0');
+				nsig += w != 0;
+				q--;
+			}
+			else
+				truncated |= *p != '0';
+		}
+	}
+	if (!ndigits)
+		return NULL;
+
+	/* No exponent after a trailing dot */
+	if ((*p == 'e' || *p == 'E') && ends_with_digit)
+	{
+		char *e = p + 1;
+		int64_t exponent = 0;
+		int exponent_negative = 0;
+
+		if (*e == '-' || *e == '+')
+			exponent_negative = *e++ == '-';
+		if (WKT_FAST_DIGIT(*e))
+		{
+			for (; WKT_FAST_DIGIT(*e); e++)
+				if (exponent < 100000)
+					exponent = exponent * 10 + (*e - '0');
+			q += exponent_negative ? -exponent : exponent;
+			p = e;
+		}
+	}
+	if (!WKT_FAST_DELIMITER(*p))
+		return NULL;
+
+	if (truncated || !lw_decimal_to_double(w, q, negative, d))
+		*d = strtod(start, NULL);
+	return p;
+}
+
+static inline char *
+wkt_fast_skip(char *p)
+{
+	while (WKT_FAST_SPACE(*p))
+		p++;
+	return p;
+}
+
+/* Consume the given punctuation, after spaces */
+static inline int
+wkt_fast_accept(WKT_FAST *s, char c)
+{
+	s->p = wkt_fast_skip(s->p);
+	if (*s->p != c)
+		return LW_FALSE;
+	s->p++;
+	return LW_TRUE;
+}
+
+/* Longest keyword at the next token, consumed unless it is WKT_FAST_OTHER */
+static WKT_FAST_TOKEN
+wkt_fast_keyword(WKT_FAST *s, uint8_t *type)
+{
+	const WKT_FAST_KEYWORD *best = NULL;
+	size_t i;
+
+	s->p = wkt_fast_skip(s->p);
+	for (i = 0; i < WKT_FAST_NUM_KEYWORDS; i++)
+	{
+		const WKT_FAST_KEYWORD *k = &wkt_fast_keywords[i];
+		if ((!best || k->len > best->len) && strncasecmp(s->p, k->name, k->len) == 0)
+			best = k;
+	}
+	if (!best || best->token == WKT_FAST_OTHER)
+		return WKT_FAST_OTHER;
+	s->p += best->len;
+	if (type)
+		*type = best->type;
+	return best->token;
+}
+
+/* Two to four numbers, returns their count or 0 */
+static inline uint32_t
+wkt_fast_coordinate(WKT_FAST *s, double *c)
+{
+	char *p = s->p;
+	uint32_t n = 0;
+
+	for (;;)
+	{
+		p = wkt_fast_skip(p);
+		if (!WKT_FAST_NUMBER_START(*p))
+			break;
+		if (n == 4 || !(p = wkt_fast_number(p, &c[n++])))
+			return 0;
+	}
+	if (n < 2)
+		return 0;
+	s->p = p;
+	return n;
+}
+
+/* Coordinates separated by commas, all with the dimension of the first */
+static POINTARRAY *
+wkt_fast_ptarray(WKT_FAST *s)
+{
+	double c[4];
+	uint32_t ndims = wkt_fast_coordinate(s, c);
+	size_t size = ndims * sizeof(double);
+	POINTARRAY *pa;
+
+	if (!ndims)
+		return NULL;
+
+	pa = ptarray_construct_empty(ndims > 2, ndims > 3, 4);
+	for (;;)
+	{
+		if (pa->npoints == pa->maxpoints)
+		{
+			pa->maxpoints *= 2;
+			pa->serialized_pointlist = lwrealloc(pa->serialized_pointlist, size * pa->maxpoints);
+		}
+		memcpy(pa->serialized_pointlist + size * pa->npoints, c, size);
+		pa->npoints++;
+
+		if (!wkt_fast_accept(s, ','))
+			return pa;
+		if (wkt_fast_coordinate(s, c) != ndims)
+		{
+			ptarray_free(pa);
+			return NULL;
+		}
+	}
+}
+
+/* ( ptarray ) */
+static POINTARRAY *
+wkt_fast_bracketed_ptarray(WKT_FAST *s)
+{
+	POINTARRAY *pa;
+
+	if (!wkt_fast_accept(s, '('))
+		return NULL;
+	if (!(pa = wkt_fast_ptarray(s)))
+		return NULL;
+	if (!wkt_fast_accept(s, ')'))
+	{
+		ptarray_free(pa);
+		return NULL;
+	}
+	return pa;
+}
+
+/* ( ring, ... ), as an unfinalized polygon */
+static LWGEOM *
+wkt_fast_rings(WKT_FAST *s)
+{
+	LWGEOM *poly = NULL;
+
+	if (!wkt_fast_accept(s, '('))
+		return NULL;
+	do
+	{
+		POINTARRAY *pa = wkt_fast_bracketed_ptarray(s);
+		if (!pa)
+		{
+			if (poly)
+				lwgeom_free(poly);
+			return NULL;
+		}
+		/* On failure the actions free what they were given */
+		poly = poly ? wkt_parser_polygon_add_ring(poly, pa, '2') : wkt_parser_polygon_new(pa, '2');
+		if (WKT_FAST_FAILED())
+			return NULL;
+	} while (wkt_fast_accept(s, ','));
+
+	if (!wkt_fast_accept(s, ')'))
+	{
+		lwgeom_free(poly);
+		return NULL;
+	}
+	return poly;
+}
+
+static LWGEOM *wkt_fast_geometry(WKT_FAST *s);
+
+/* Element of a multi geometry or collection */
+static LWGEOM *
+wkt_fast_element(WKT_FAST *s, uint8_t type)
+{
+	WKT_FAST_TOKEN token;
+	POINTARRAY *pa;
+	double c[4];
+	uint32_t ndims;
+
+	if (type == COLLECTIONTYPE)
+		return wkt_fast_geometry(s);
+
+	s->p = wkt_fast_skip(s->p);
+	if (*s->p != '(')
+	{
+		if (type == MULTIPOINTTYPE && WKT_FAST_NUMBER_START(*s->p))
+		{
+			if (!(ndims = wkt_fast_coordinate(s, c)))
+				return NULL;
+			pa = ptarray_construct_empty(ndims > 2, ndims > 3, 1);
+			memcpy(pa->serialized_pointlist, c, ndims * sizeof(double));
+			pa->npoints = 1;
+			return wkt_parser_point_new(pa, NULL);
+		}
+		token = wkt_fast_keyword(s, NULL);
+		if (token != WKT_FAST_EMPTY)
+			return NULL;
+		switch (type)
+		{
+		case MULTIPOINTTYPE:
+			return wkt_parser_point_new(NULL, NULL);
+		case MULTILINETYPE:
+			return wkt_parser_linestring_new(NULL, NULL);
+		default:
+			return wkt_parser_polygon_finalize(NULL, NULL);
+		}
+	}
+
+	switch (type)
+	{
+	case MULTIPOINTTYPE:
+		s->p++;
+		if (!(ndims = wkt_fast_coordinate(s, c)))
+			return NULL;
+		if (!wkt_fast_accept(s, ')'))
+			return NULL;
+		pa = ptarray_construct_empty(ndims > 2, ndims > 3, 1);
+		memcpy(pa->serialized_pointlist, c, ndims * sizeof(double));
+		pa->npoints = 1;
+		return wkt_parser_point_new(pa, NULL);
+	case MULTILINETYPE:
+		if (!(pa = wkt_fast_bracketed_ptarray(s)))
+			return NULL;
+		return wkt_parser_linestring_new(pa, NULL);
+	default:
+		return wkt_fast_rings(s);
+	}
+}
+
+/* ( element, ... ), as an unfinalized collection */
+static LWGEOM *
+wkt_fast_elements(WKT_FAST *s, uint8_t type)
+{
+	LWGEOM *col = NULL;
+
+	if (!wkt_fast_accept(s, '('))
+		return NULL;
+	do
+	{
+		LWGEOM *geom = wkt_fast_element(s, type);
+		if (!geom || WKT_FAST_FAILED())
+		{
+			if (col)
+				lwgeom_free(col);
+			return NULL;
+		}
+		col = col ? wkt_parser_collection_add_geom(col, geom) : wkt_parser_collection_new(geom);
+	} while (wkt_fast_accept(s, ','));
+
+	if (!wkt_fast_accept(s, ')'))
+	{
+		lwgeom_free(col);
+		return NULL;
+	}
+	return col;
+}
+
+/* A tagged geometry, the geometry_no_srid of the grammar */
+static LWGEOM *
+wkt_fast_geometry(WKT_FAST *s)
+{
+	WKT_FAST_TOKEN token;
+	char dimsbuf[3], *dims = NULL, *start;
+	uint8_t type;
+	LWGEOM *geom = NULL;
+	POINTARRAY *pa = NULL;
+	int empty;
+
+	if (wkt_fast_keyword(s, &type) != WKT_FAST_TYPE)
+		return NULL;
+
+	/* The actions read the dimension letters up to the end of the string, */
+	/* so they get a copy of the token, as the lexer gives them */
+	s->p = wkt_fast_skip(s->p);
+	start = s->p;
+	token = wkt_fast_keyword(s, NULL);
+	if (token == WKT_FAST_DIMS)
+	{
+		memcpy(dimsbuf, start, s->p - start);
+		dimsbuf[s->p - start] = '\0';
+		dims = dimsbuf;
+		token = wkt_fast_keyword(s, NULL);
+	}
+	empty = token == WKT_FAST_EMPTY;
+	if (!empty && (token != WKT_FAST_OTHER || *s->p != '('))
+		return NULL;
+
+	switch (type)
+	{
+	case POINTTYPE:
+		if (!empty && !(pa = wkt_fast_bracketed_ptarray(s)))
+			return NULL;
+		geom = wkt_parser_point_new(pa, dims);
+		break;
+	case LINETYPE:
+		if (!empty && !(pa = wkt_fast_bracketed_ptarray(s)))
+			return NULL;
+		geom = wkt_parser_linestring_new(pa, dims);
+		break;
+	case POLYGONTYPE:
+		if (!empty && !(geom = wkt_fast_rings(s)))
+			return NULL;
+		geom = wkt_parser_polygon_finalize(geom, dims);
+		break;
+	default:
+		if (!empty && !(geom = wkt_fast_elements(s, type)))
+			return NULL;
+		geom = wkt_parser_collection_finalize(type, geom, dims);
+		break;
+	}
+	return WKT_FAST_FAILED() ? NULL : geom;
+}
+
+/*
+ * Parse wktstr into global_parser_result, whose check flags have to be
+ * set. Returns LW_FAILURE, with nothing allocated, when the grammar has
+ * to read it.
+ */
+int
+wkt_fast_parse(char *wktstr)
+{
+	WKT_FAST s;
+	char *srid = NULL;
+	LWGEOM *geom;
+
+	s.p = wkt_fast_skip(wktstr);
+	if (strncasecmp(s.p, "SRID=", 5) == 0)
+	{
+		srid = s.p;
+		s.p += 5;
+		if (*s.p == '-')
+			s.p++;
+		if (!WKT_FAST_DIGIT(*s.p))
+			return LW_FAILURE;
+		while (WKT_FAST_DIGIT(*s.p))
+			s.p++;
+		if (!wkt_fast_accept(&s, ';'))
+			return LW_FAILURE;
+	}
+
+	if (!(geom = wkt_fast_geometry(&s)))
+		return LW_FAILURE;
+	if (*wkt_fast_skip(s.p))
+	{
+		lwgeom_free(geom);
+		return LW_FAILURE;
+	}
+
+	/* Read the SRID last, it may raise a notice */
+	wkt_parser_geometry_new(geom, srid ? wkt_lexer_read_srid(srid) : SRID_UNKNOWN);
+	return LW_SUCCESS;
+}
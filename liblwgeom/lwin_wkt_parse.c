@@ -138,6 +138,18 @@ int lwgeom_parse_wkt(LWGEOM_PARSER_RESULT *parser_result, char *wktstr, int pars
 	global_parser_result.wkinput = wktstr;
 	global_parser_result.parser_check_flags = parser_check_flags;
 
+	/* Common geometry types are read without the lexer */
+	if ( wkt_fast_parse(wktstr) == LW_SUCCESS )
+	{
+		*parser_result = global_parser_result;
+		return LW_SUCCESS;
+	}
+
+	/* Otherwise start over, the fast reader may have left an error behind */
+	lwgeom_parser_result_init(&global_parser_result);
+	global_parser_result.wkinput = wktstr;
+	global_parser_result.parser_check_flags = parser_check_flags;
+
 	wkt_lexer_init(wktstr, &wkt_yyg); /* Lexer ready */
 	parse_rv = wkt_yyparse(wkt_yyg); /* Run the parse */
 	LWDEBUGF(4,"wkt_yyparse returned %d", parse_rv);
@@ -179,7 +191,7 @@ int lwgeom_parse_wkt(LWGEOM_PARSER_RESULT *parser_result, char *wktstr, int pars
 
 
 
-#line 183 "lwin_wkt_parse.c"
+#line 195 "lwin_wkt_parse.c"
 
 # ifndef YY_CAST
 #  ifdef __cplusplus
@@ -664,20 +676,20 @@ static const yytype_int8 yytranslate[] =
 /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
 static const yytype_int16 yyrline[] =
 {
-       0,   219,   219,   221,   225,   226,   227,   228,   229,   230,
-     231,   232,   233,   234,   235,   236,   237,   238,   239,   242,
-     244,   246,   248,   252,   254,   258,   260,   262,   264,   268,
-     270,   272,   274,   276,   278,   282,   284,   286,   288,   292,
-     294,   296,   298,   302,   304,   306,   308,   312,   314,   318,
-     320,   324,   326,   328,   330,   334,   336,   340,   343,   345,
-     347,   349,   353,   355,   359,   360,   361,   362,   365,   367,
-     371,   373,   377,   380,   383,   385,   387,   389,   393,   395,
-     397,   399,   401,   403,   407,   409,   411,   413,   417,   419,
-     421,   423,   425,   427,   429,   431,   435,   437,   439,   441,
-     445,   447,   451,   453,   455,   457,   461,   463,   465,   467,
-     471,   473,   477,   479,   483,   485,   487,   489,   493,   497,
-     499,   501,   503,   507,   509,   513,   515,   517,   521,   523,
-     525,   527,   531,   533,   537,   539,   541
+       0,   231,   231,   233,   237,   238,   239,   240,   241,   242,
+     243,   244,   245,   246,   247,   248,   249,   250,   251,   254,
+     256,   258,   260,   264,   266,   270,   272,   274,   276,   280,
+     282,   284,   286,   288,   290,   294,   296,   298,   300,   304,
+     306,   308,   310,   314,   316,   318,   320,   324,   326,   330,
+     332,   336,   338,   340,   342,   346,   348,   352,   355,   357,
+     359,   361,   365,   367,   371,   372,   373,   374,   377,   379,
+     383,   385,   389,   392,   395,   397,   399,   401,   405,   407,
+     409,   411,   413,   415,   419,   421,   423,   425,   429,   431,
+     433,   435,   437,   439,   441,   443,   447,   449,   451,   453,
+     457,   459,   463,   465,   467,   469,   473,   475,   477,   479,
+     483,   485,   489,   491,   495,   497,   499,   501,   505,   509,
+     511,   513,   515,   519,   521,   525,   527,   529,   533,   535,
+     537,   539,   543,   545,   549,   551,   553
 };
 #endif
 
@@ -1515,225 +1527,225 @@ yydestruct (const char *yymsg,
   switch (yykind)
     {
     case YYSYMBOL_geometry_no_srid: /* geometry_no_srid  */
-#line 196 "lwin_wkt_parse.y"
+#line 208 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1521 "lwin_wkt_parse.c"
+#line 1533 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_geometrycollection: /* geometrycollection  */
-#line 197 "lwin_wkt_parse.y"
+#line 209 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1527 "lwin_wkt_parse.c"
+#line 1539 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_geometry_list: /* geometry_list  */
-#line 198 "lwin_wkt_parse.y"
+#line 210 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1533 "lwin_wkt_parse.c"
+#line 1545 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_multisurface: /* multisurface  */
-#line 205 "lwin_wkt_parse.y"
+#line 217 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1539 "lwin_wkt_parse.c"
+#line 1551 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_surface_list: /* surface_list  */
-#line 183 "lwin_wkt_parse.y"
+#line 195 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1545 "lwin_wkt_parse.c"
+#line 1557 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_tin: /* tin  */
-#line 212 "lwin_wkt_parse.y"
+#line 224 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1551 "lwin_wkt_parse.c"
+#line 1563 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_polyhedralsurface: /* polyhedralsurface  */
-#line 211 "lwin_wkt_parse.y"
+#line 223 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1557 "lwin_wkt_parse.c"
+#line 1569 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_multipolygon: /* multipolygon  */
-#line 204 "lwin_wkt_parse.y"
+#line 216 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1563 "lwin_wkt_parse.c"
+#line 1575 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_polygon_list: /* polygon_list  */
-#line 184 "lwin_wkt_parse.y"
+#line 196 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1569 "lwin_wkt_parse.c"
+#line 1581 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_patch_list: /* patch_list  */
-#line 185 "lwin_wkt_parse.y"
+#line 197 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1575 "lwin_wkt_parse.c"
+#line 1587 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_polygon: /* polygon  */
-#line 208 "lwin_wkt_parse.y"
+#line 220 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1581 "lwin_wkt_parse.c"
+#line 1593 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_polygon_untagged: /* polygon_untagged  */
-#line 210 "lwin_wkt_parse.y"
+#line 222 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1587 "lwin_wkt_parse.c"
+#line 1599 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_patch: /* patch  */
-#line 209 "lwin_wkt_parse.y"
+#line 221 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1593 "lwin_wkt_parse.c"
+#line 1605 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_curvepolygon: /* curvepolygon  */
-#line 194 "lwin_wkt_parse.y"
+#line 206 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1599 "lwin_wkt_parse.c"
+#line 1611 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_curvering_list: /* curvering_list  */
-#line 181 "lwin_wkt_parse.y"
+#line 193 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1605 "lwin_wkt_parse.c"
+#line 1617 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_curvering: /* curvering  */
-#line 195 "lwin_wkt_parse.y"
+#line 207 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1611 "lwin_wkt_parse.c"
+#line 1623 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_patchring_list: /* patchring_list  */
-#line 191 "lwin_wkt_parse.y"
+#line 203 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1617 "lwin_wkt_parse.c"
+#line 1629 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_ring_list: /* ring_list  */
-#line 190 "lwin_wkt_parse.y"
+#line 202 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1623 "lwin_wkt_parse.c"
+#line 1635 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_patchring: /* patchring  */
-#line 180 "lwin_wkt_parse.y"
+#line 192 "lwin_wkt_parse.y"
             { ptarray_free(((*yyvaluep).ptarrayvalue)); }
-#line 1629 "lwin_wkt_parse.c"
+#line 1641 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_ring: /* ring  */
-#line 179 "lwin_wkt_parse.y"
+#line 191 "lwin_wkt_parse.y"
             { ptarray_free(((*yyvaluep).ptarrayvalue)); }
-#line 1635 "lwin_wkt_parse.c"
+#line 1647 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_compoundcurve: /* compoundcurve  */
-#line 193 "lwin_wkt_parse.y"
+#line 205 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1641 "lwin_wkt_parse.c"
+#line 1653 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_compound_list: /* compound_list  */
-#line 189 "lwin_wkt_parse.y"
+#line 201 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1647 "lwin_wkt_parse.c"
+#line 1659 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_multicurve: /* multicurve  */
-#line 201 "lwin_wkt_parse.y"
+#line 213 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1653 "lwin_wkt_parse.c"
+#line 1665 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_curve_list: /* curve_list  */
-#line 188 "lwin_wkt_parse.y"
+#line 200 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1659 "lwin_wkt_parse.c"
+#line 1671 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_multilinestring: /* multilinestring  */
-#line 202 "lwin_wkt_parse.y"
+#line 214 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1665 "lwin_wkt_parse.c"
+#line 1677 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_linestring_list: /* linestring_list  */
-#line 187 "lwin_wkt_parse.y"
+#line 199 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1671 "lwin_wkt_parse.c"
+#line 1683 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_circularstring: /* circularstring  */
-#line 192 "lwin_wkt_parse.y"
+#line 204 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1677 "lwin_wkt_parse.c"
+#line 1689 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_linestring: /* linestring  */
-#line 199 "lwin_wkt_parse.y"
+#line 211 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1683 "lwin_wkt_parse.c"
+#line 1695 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_linestring_untagged: /* linestring_untagged  */
-#line 200 "lwin_wkt_parse.y"
+#line 212 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1689 "lwin_wkt_parse.c"
+#line 1701 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_triangle_list: /* triangle_list  */
-#line 182 "lwin_wkt_parse.y"
+#line 194 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1695 "lwin_wkt_parse.c"
+#line 1707 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_triangle: /* triangle  */
-#line 213 "lwin_wkt_parse.y"
+#line 225 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1701 "lwin_wkt_parse.c"
+#line 1713 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_triangle_untagged: /* triangle_untagged  */
-#line 214 "lwin_wkt_parse.y"
+#line 226 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1707 "lwin_wkt_parse.c"
+#line 1719 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_multipoint: /* multipoint  */
-#line 203 "lwin_wkt_parse.y"
+#line 215 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1713 "lwin_wkt_parse.c"
+#line 1725 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_point_list: /* point_list  */
-#line 186 "lwin_wkt_parse.y"
+#line 198 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1719 "lwin_wkt_parse.c"
+#line 1731 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_point_untagged: /* point_untagged  */
-#line 207 "lwin_wkt_parse.y"
+#line 219 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1725 "lwin_wkt_parse.c"
+#line 1737 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_point: /* point  */
-#line 206 "lwin_wkt_parse.y"
+#line 218 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1731 "lwin_wkt_parse.c"
+#line 1743 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_ptarray: /* ptarray  */
-#line 178 "lwin_wkt_parse.y"
+#line 190 "lwin_wkt_parse.y"
             { ptarray_free(((*yyvaluep).ptarrayvalue)); }
-#line 1737 "lwin_wkt_parse.c"
+#line 1749 "lwin_wkt_parse.c"
         break;
 
       default:
@@ -2037,817 +2049,817 @@ yyreduce:
   switch (yyn)
     {
   case 2: /* geometry: geometry_no_srid  */
-#line 220 "lwin_wkt_parse.y"
+#line 232 "lwin_wkt_parse.y"
                 { wkt_parser_geometry_new((yyvsp[0].geometryvalue), SRID_UNKNOWN); WKT_ERROR(); }
-#line 2043 "lwin_wkt_parse.c"
+#line 2055 "lwin_wkt_parse.c"
     break;
 
   case 3: /* geometry: SRID_TOK SEMICOLON_TOK geometry_no_srid  */
-#line 222 "lwin_wkt_parse.y"
+#line 234 "lwin_wkt_parse.y"
                 { wkt_parser_geometry_new((yyvsp[0].geometryvalue), (yyvsp[-2].integervalue)); WKT_ERROR(); }
-#line 2049 "lwin_wkt_parse.c"
+#line 2061 "lwin_wkt_parse.c"
     break;
 
   case 4: /* geometry_no_srid: point  */
-#line 225 "lwin_wkt_parse.y"
+#line 237 "lwin_wkt_parse.y"
               { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2055 "lwin_wkt_parse.c"
+#line 2067 "lwin_wkt_parse.c"
     break;
 
   case 5: /* geometry_no_srid: linestring  */
-#line 226 "lwin_wkt_parse.y"
+#line 238 "lwin_wkt_parse.y"
                    { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2061 "lwin_wkt_parse.c"
+#line 2073 "lwin_wkt_parse.c"
     break;
 
   case 6: /* geometry_no_srid: circularstring  */
-#line 227 "lwin_wkt_parse.y"
+#line 239 "lwin_wkt_parse.y"
                        { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2067 "lwin_wkt_parse.c"
+#line 2079 "lwin_wkt_parse.c"
     break;
 
   case 7: /* geometry_no_srid: compoundcurve  */
-#line 228 "lwin_wkt_parse.y"
+#line 240 "lwin_wkt_parse.y"
                       { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2073 "lwin_wkt_parse.c"
+#line 2085 "lwin_wkt_parse.c"
     break;
 
   case 8: /* geometry_no_srid: polygon  */
-#line 229 "lwin_wkt_parse.y"
+#line 241 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2079 "lwin_wkt_parse.c"
+#line 2091 "lwin_wkt_parse.c"
     break;
 
   case 9: /* geometry_no_srid: curvepolygon  */
-#line 230 "lwin_wkt_parse.y"
+#line 242 "lwin_wkt_parse.y"
                      { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2085 "lwin_wkt_parse.c"
+#line 2097 "lwin_wkt_parse.c"
     break;
 
   case 10: /* geometry_no_srid: multipoint  */
-#line 231 "lwin_wkt_parse.y"
+#line 243 "lwin_wkt_parse.y"
                    { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2091 "lwin_wkt_parse.c"
+#line 2103 "lwin_wkt_parse.c"
     break;
 
   case 11: /* geometry_no_srid: multilinestring  */
-#line 232 "lwin_wkt_parse.y"
+#line 244 "lwin_wkt_parse.y"
                         { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2097 "lwin_wkt_parse.c"
+#line 2109 "lwin_wkt_parse.c"
     break;
 
   case 12: /* geometry_no_srid: multipolygon  */
-#line 233 "lwin_wkt_parse.y"
+#line 245 "lwin_wkt_parse.y"
                      { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2103 "lwin_wkt_parse.c"
+#line 2115 "lwin_wkt_parse.c"
     break;
 
   case 13: /* geometry_no_srid: multisurface  */
-#line 234 "lwin_wkt_parse.y"
+#line 246 "lwin_wkt_parse.y"
                      { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2109 "lwin_wkt_parse.c"
+#line 2121 "lwin_wkt_parse.c"
     break;
 
   case 14: /* geometry_no_srid: multicurve  */
-#line 235 "lwin_wkt_parse.y"
+#line 247 "lwin_wkt_parse.y"
                    { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2115 "lwin_wkt_parse.c"
+#line 2127 "lwin_wkt_parse.c"
     break;
 
   case 15: /* geometry_no_srid: tin  */
-#line 236 "lwin_wkt_parse.y"
+#line 248 "lwin_wkt_parse.y"
             { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2121 "lwin_wkt_parse.c"
+#line 2133 "lwin_wkt_parse.c"
     break;
 
   case 16: /* geometry_no_srid: polyhedralsurface  */
-#line 237 "lwin_wkt_parse.y"
+#line 249 "lwin_wkt_parse.y"
                           { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2127 "lwin_wkt_parse.c"
+#line 2139 "lwin_wkt_parse.c"
     break;
 
   case 17: /* geometry_no_srid: triangle  */
-#line 238 "lwin_wkt_parse.y"
+#line 250 "lwin_wkt_parse.y"
                  { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2133 "lwin_wkt_parse.c"
+#line 2145 "lwin_wkt_parse.c"
     break;
 
   case 18: /* geometry_no_srid: geometrycollection  */
-#line 239 "lwin_wkt_parse.y"
+#line 251 "lwin_wkt_parse.y"
                            { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2139 "lwin_wkt_parse.c"
+#line 2151 "lwin_wkt_parse.c"
     break;
 
   case 19: /* geometrycollection: COLLECTION_TOK LBRACKET_TOK geometry_list RBRACKET_TOK  */
-#line 243 "lwin_wkt_parse.y"
+#line 255 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(COLLECTIONTYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2145 "lwin_wkt_parse.c"
+#line 2157 "lwin_wkt_parse.c"
     break;
 
   case 20: /* geometrycollection: COLLECTION_TOK DIMENSIONALITY_TOK LBRACKET_TOK geometry_list RBRACKET_TOK  */
-#line 245 "lwin_wkt_parse.y"
+#line 257 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(COLLECTIONTYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2151 "lwin_wkt_parse.c"
+#line 2163 "lwin_wkt_parse.c"
     break;
 
   case 21: /* geometrycollection: COLLECTION_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 247 "lwin_wkt_parse.y"
+#line 259 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(COLLECTIONTYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2157 "lwin_wkt_parse.c"
+#line 2169 "lwin_wkt_parse.c"
     break;
 
   case 22: /* geometrycollection: COLLECTION_TOK EMPTY_TOK  */
-#line 249 "lwin_wkt_parse.y"
+#line 261 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(COLLECTIONTYPE, NULL, NULL); WKT_ERROR(); }
-#line 2163 "lwin_wkt_parse.c"
+#line 2175 "lwin_wkt_parse.c"
     break;
 
   case 23: /* geometry_list: geometry_list COMMA_TOK geometry_no_srid  */
-#line 253 "lwin_wkt_parse.y"
+#line 265 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2169 "lwin_wkt_parse.c"
+#line 2181 "lwin_wkt_parse.c"
     break;
 
   case 24: /* geometry_list: geometry_no_srid  */
-#line 255 "lwin_wkt_parse.y"
+#line 267 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2175 "lwin_wkt_parse.c"
+#line 2187 "lwin_wkt_parse.c"
     break;
 
   case 25: /* multisurface: MSURFACE_TOK LBRACKET_TOK surface_list RBRACKET_TOK  */
-#line 259 "lwin_wkt_parse.y"
+#line 271 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTISURFACETYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2181 "lwin_wkt_parse.c"
+#line 2193 "lwin_wkt_parse.c"
     break;
 
   case 26: /* multisurface: MSURFACE_TOK DIMENSIONALITY_TOK LBRACKET_TOK surface_list RBRACKET_TOK  */
-#line 261 "lwin_wkt_parse.y"
+#line 273 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTISURFACETYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2187 "lwin_wkt_parse.c"
+#line 2199 "lwin_wkt_parse.c"
     break;
 
   case 27: /* multisurface: MSURFACE_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 263 "lwin_wkt_parse.y"
+#line 275 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTISURFACETYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2193 "lwin_wkt_parse.c"
+#line 2205 "lwin_wkt_parse.c"
     break;
 
   case 28: /* multisurface: MSURFACE_TOK EMPTY_TOK  */
-#line 265 "lwin_wkt_parse.y"
+#line 277 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTISURFACETYPE, NULL, NULL); WKT_ERROR(); }
-#line 2199 "lwin_wkt_parse.c"
+#line 2211 "lwin_wkt_parse.c"
     break;
 
   case 29: /* surface_list: surface_list COMMA_TOK polygon  */
-#line 269 "lwin_wkt_parse.y"
+#line 281 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2205 "lwin_wkt_parse.c"
+#line 2217 "lwin_wkt_parse.c"
     break;
 
   case 30: /* surface_list: surface_list COMMA_TOK curvepolygon  */
-#line 271 "lwin_wkt_parse.y"
+#line 283 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2211 "lwin_wkt_parse.c"
+#line 2223 "lwin_wkt_parse.c"
     break;
 
   case 31: /* surface_list: surface_list COMMA_TOK polygon_untagged  */
-#line 273 "lwin_wkt_parse.y"
+#line 285 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2217 "lwin_wkt_parse.c"
+#line 2229 "lwin_wkt_parse.c"
     break;
 
   case 32: /* surface_list: polygon  */
-#line 275 "lwin_wkt_parse.y"
+#line 287 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2223 "lwin_wkt_parse.c"
+#line 2235 "lwin_wkt_parse.c"
     break;
 
   case 33: /* surface_list: curvepolygon  */
-#line 277 "lwin_wkt_parse.y"
+#line 289 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2229 "lwin_wkt_parse.c"
+#line 2241 "lwin_wkt_parse.c"
     break;
 
   case 34: /* surface_list: polygon_untagged  */
-#line 279 "lwin_wkt_parse.y"
+#line 291 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2235 "lwin_wkt_parse.c"
+#line 2247 "lwin_wkt_parse.c"
     break;
 
   case 35: /* tin: TIN_TOK LBRACKET_TOK triangle_list RBRACKET_TOK  */
-#line 283 "lwin_wkt_parse.y"
+#line 295 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(TINTYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2241 "lwin_wkt_parse.c"
+#line 2253 "lwin_wkt_parse.c"
     break;
 
   case 36: /* tin: TIN_TOK DIMENSIONALITY_TOK LBRACKET_TOK triangle_list RBRACKET_TOK  */
-#line 285 "lwin_wkt_parse.y"
+#line 297 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(TINTYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2247 "lwin_wkt_parse.c"
+#line 2259 "lwin_wkt_parse.c"
     break;
 
   case 37: /* tin: TIN_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 287 "lwin_wkt_parse.y"
+#line 299 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(TINTYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2253 "lwin_wkt_parse.c"
+#line 2265 "lwin_wkt_parse.c"
     break;
 
   case 38: /* tin: TIN_TOK EMPTY_TOK  */
-#line 289 "lwin_wkt_parse.y"
+#line 301 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(TINTYPE, NULL, NULL); WKT_ERROR(); }
-#line 2259 "lwin_wkt_parse.c"
+#line 2271 "lwin_wkt_parse.c"
     break;
 
   case 39: /* polyhedralsurface: POLYHEDRALSURFACE_TOK LBRACKET_TOK patch_list RBRACKET_TOK  */
-#line 293 "lwin_wkt_parse.y"
+#line 305 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(POLYHEDRALSURFACETYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2265 "lwin_wkt_parse.c"
+#line 2277 "lwin_wkt_parse.c"
     break;
 
   case 40: /* polyhedralsurface: POLYHEDRALSURFACE_TOK DIMENSIONALITY_TOK LBRACKET_TOK patch_list RBRACKET_TOK  */
-#line 295 "lwin_wkt_parse.y"
+#line 307 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(POLYHEDRALSURFACETYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2271 "lwin_wkt_parse.c"
+#line 2283 "lwin_wkt_parse.c"
     break;
 
   case 41: /* polyhedralsurface: POLYHEDRALSURFACE_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 297 "lwin_wkt_parse.y"
+#line 309 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(POLYHEDRALSURFACETYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2277 "lwin_wkt_parse.c"
+#line 2289 "lwin_wkt_parse.c"
     break;
 
   case 42: /* polyhedralsurface: POLYHEDRALSURFACE_TOK EMPTY_TOK  */
-#line 299 "lwin_wkt_parse.y"
+#line 311 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(POLYHEDRALSURFACETYPE, NULL, NULL); WKT_ERROR(); }
-#line 2283 "lwin_wkt_parse.c"
+#line 2295 "lwin_wkt_parse.c"
     break;
 
   case 43: /* multipolygon: MPOLYGON_TOK LBRACKET_TOK polygon_list RBRACKET_TOK  */
-#line 303 "lwin_wkt_parse.y"
+#line 315 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTIPOLYGONTYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2289 "lwin_wkt_parse.c"
+#line 2301 "lwin_wkt_parse.c"
     break;
 
   case 44: /* multipolygon: MPOLYGON_TOK DIMENSIONALITY_TOK LBRACKET_TOK polygon_list RBRACKET_TOK  */
-#line 305 "lwin_wkt_parse.y"
+#line 317 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTIPOLYGONTYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2295 "lwin_wkt_parse.c"
+#line 2307 "lwin_wkt_parse.c"
     break;
 
   case 45: /* multipolygon: MPOLYGON_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 307 "lwin_wkt_parse.y"
+#line 319 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTIPOLYGONTYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2301 "lwin_wkt_parse.c"
+#line 2313 "lwin_wkt_parse.c"
     break;
 
   case 46: /* multipolygon: MPOLYGON_TOK EMPTY_TOK  */
-#line 309 "lwin_wkt_parse.y"
+#line 321 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTIPOLYGONTYPE, NULL, NULL); WKT_ERROR(); }
-#line 2307 "lwin_wkt_parse.c"
+#line 2319 "lwin_wkt_parse.c"
     break;
 
   case 47: /* polygon_list: polygon_list COMMA_TOK polygon_untagged  */
-#line 313 "lwin_wkt_parse.y"
+#line 325 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2313 "lwin_wkt_parse.c"
+#line 2325 "lwin_wkt_parse.c"
     break;
 
   case 48: /* polygon_list: polygon_untagged  */
-#line 315 "lwin_wkt_parse.y"
+#line 327 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2319 "lwin_wkt_parse.c"
+#line 2331 "lwin_wkt_parse.c"
     break;
 
   case 49: /* patch_list: patch_list COMMA_TOK patch  */
-#line 319 "lwin_wkt_parse.y"
+#line 331 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2325 "lwin_wkt_parse.c"
+#line 2337 "lwin_wkt_parse.c"
     break;
 
   case 50: /* patch_list: patch  */
-#line 321 "lwin_wkt_parse.y"
+#line 333 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2331 "lwin_wkt_parse.c"
+#line 2343 "lwin_wkt_parse.c"
     break;
 
   case 51: /* polygon: POLYGON_TOK LBRACKET_TOK ring_list RBRACKET_TOK  */
-#line 325 "lwin_wkt_parse.y"
+#line 337 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_finalize((yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2337 "lwin_wkt_parse.c"
+#line 2349 "lwin_wkt_parse.c"
     break;
 
   case 52: /* polygon: POLYGON_TOK DIMENSIONALITY_TOK LBRACKET_TOK ring_list RBRACKET_TOK  */
-#line 327 "lwin_wkt_parse.y"
+#line 339 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_finalize((yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2343 "lwin_wkt_parse.c"
+#line 2355 "lwin_wkt_parse.c"
     break;
 
   case 53: /* polygon: POLYGON_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 329 "lwin_wkt_parse.y"
+#line 341 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_finalize(NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2349 "lwin_wkt_parse.c"
+#line 2361 "lwin_wkt_parse.c"
     break;
 
   case 54: /* polygon: POLYGON_TOK EMPTY_TOK  */
-#line 331 "lwin_wkt_parse.y"
+#line 343 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_finalize(NULL, NULL); WKT_ERROR(); }
-#line 2355 "lwin_wkt_parse.c"
+#line 2367 "lwin_wkt_parse.c"
     break;
 
   case 55: /* polygon_untagged: LBRACKET_TOK ring_list RBRACKET_TOK  */
-#line 335 "lwin_wkt_parse.y"
+#line 347 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = (yyvsp[-1].geometryvalue); }
-#line 2361 "lwin_wkt_parse.c"
+#line 2373 "lwin_wkt_parse.c"
     break;
 
   case 56: /* polygon_untagged: EMPTY_TOK  */
-#line 337 "lwin_wkt_parse.y"
+#line 349 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_finalize(NULL, NULL); WKT_ERROR(); }
-#line 2367 "lwin_wkt_parse.c"
+#line 2379 "lwin_wkt_parse.c"
     break;
 
   case 57: /* patch: LBRACKET_TOK patchring_list RBRACKET_TOK  */
-#line 340 "lwin_wkt_parse.y"
+#line 352 "lwin_wkt_parse.y"
                                                  { (yyval.geometryvalue) = (yyvsp[-1].geometryvalue); }
-#line 2373 "lwin_wkt_parse.c"
+#line 2385 "lwin_wkt_parse.c"
     break;
 
   case 58: /* curvepolygon: CURVEPOLYGON_TOK LBRACKET_TOK curvering_list RBRACKET_TOK  */
-#line 344 "lwin_wkt_parse.y"
+#line 356 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_curvepolygon_finalize((yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2379 "lwin_wkt_parse.c"
+#line 2391 "lwin_wkt_parse.c"
     break;
 
   case 59: /* curvepolygon: CURVEPOLYGON_TOK DIMENSIONALITY_TOK LBRACKET_TOK curvering_list RBRACKET_TOK  */
-#line 346 "lwin_wkt_parse.y"
+#line 358 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_curvepolygon_finalize((yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2385 "lwin_wkt_parse.c"
+#line 2397 "lwin_wkt_parse.c"
     break;
 
   case 60: /* curvepolygon: CURVEPOLYGON_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 348 "lwin_wkt_parse.y"
+#line 360 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_curvepolygon_finalize(NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2391 "lwin_wkt_parse.c"
+#line 2403 "lwin_wkt_parse.c"
     break;
 
   case 61: /* curvepolygon: CURVEPOLYGON_TOK EMPTY_TOK  */
-#line 350 "lwin_wkt_parse.y"
+#line 362 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_curvepolygon_finalize(NULL, NULL); WKT_ERROR(); }
-#line 2397 "lwin_wkt_parse.c"
+#line 2409 "lwin_wkt_parse.c"
     break;
 
   case 62: /* curvering_list: curvering_list COMMA_TOK curvering  */
-#line 354 "lwin_wkt_parse.y"
+#line 366 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_curvepolygon_add_ring((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2403 "lwin_wkt_parse.c"
+#line 2415 "lwin_wkt_parse.c"
     break;
 
   case 63: /* curvering_list: curvering  */
-#line 356 "lwin_wkt_parse.y"
+#line 368 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_curvepolygon_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2409 "lwin_wkt_parse.c"
+#line 2421 "lwin_wkt_parse.c"
     break;
 
   case 64: /* curvering: linestring_untagged  */
-#line 359 "lwin_wkt_parse.y"
+#line 371 "lwin_wkt_parse.y"
                             { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2415 "lwin_wkt_parse.c"
+#line 2427 "lwin_wkt_parse.c"
     break;
 
   case 65: /* curvering: linestring  */
-#line 360 "lwin_wkt_parse.y"
+#line 372 "lwin_wkt_parse.y"
                    { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2421 "lwin_wkt_parse.c"
+#line 2433 "lwin_wkt_parse.c"
     break;
 
   case 66: /* curvering: compoundcurve  */
-#line 361 "lwin_wkt_parse.y"
+#line 373 "lwin_wkt_parse.y"
                       { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2427 "lwin_wkt_parse.c"
+#line 2439 "lwin_wkt_parse.c"
     break;
 
   case 67: /* curvering: circularstring  */
-#line 362 "lwin_wkt_parse.y"
+#line 374 "lwin_wkt_parse.y"
                        { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2433 "lwin_wkt_parse.c"
+#line 2445 "lwin_wkt_parse.c"
     break;
 
   case 68: /* patchring_list: patchring_list COMMA_TOK patchring  */
-#line 366 "lwin_wkt_parse.y"
+#line 378 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_add_ring((yyvsp[-2].geometryvalue),(yyvsp[0].ptarrayvalue),'Z'); WKT_ERROR(); }
-#line 2439 "lwin_wkt_parse.c"
+#line 2451 "lwin_wkt_parse.c"
     break;
 
   case 69: /* patchring_list: patchring  */
-#line 368 "lwin_wkt_parse.y"
+#line 380 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_new((yyvsp[0].ptarrayvalue),'Z'); WKT_ERROR(); }
-#line 2445 "lwin_wkt_parse.c"
+#line 2457 "lwin_wkt_parse.c"
     break;
 
   case 70: /* ring_list: ring_list COMMA_TOK ring  */
-#line 372 "lwin_wkt_parse.y"
+#line 384 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_add_ring((yyvsp[-2].geometryvalue),(yyvsp[0].ptarrayvalue),'2'); WKT_ERROR(); }
-#line 2451 "lwin_wkt_parse.c"
+#line 2463 "lwin_wkt_parse.c"
     break;
 
   case 71: /* ring_list: ring  */
-#line 374 "lwin_wkt_parse.y"
+#line 386 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_new((yyvsp[0].ptarrayvalue),'2'); WKT_ERROR(); }
-#line 2457 "lwin_wkt_parse.c"
+#line 2469 "lwin_wkt_parse.c"
     break;
 
   case 72: /* patchring: LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 377 "lwin_wkt_parse.y"
+#line 389 "lwin_wkt_parse.y"
                                           { (yyval.ptarrayvalue) = (yyvsp[-1].ptarrayvalue); }
-#line 2463 "lwin_wkt_parse.c"
+#line 2475 "lwin_wkt_parse.c"
     break;
 
   case 73: /* ring: LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 380 "lwin_wkt_parse.y"
+#line 392 "lwin_wkt_parse.y"
                                           { (yyval.ptarrayvalue) = (yyvsp[-1].ptarrayvalue); }
-#line 2469 "lwin_wkt_parse.c"
+#line 2481 "lwin_wkt_parse.c"
     break;
 
   case 74: /* compoundcurve: COMPOUNDCURVE_TOK LBRACKET_TOK compound_list RBRACKET_TOK  */
-#line 384 "lwin_wkt_parse.y"
+#line 396 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(COMPOUNDTYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2475 "lwin_wkt_parse.c"
+#line 2487 "lwin_wkt_parse.c"
     break;
 
   case 75: /* compoundcurve: COMPOUNDCURVE_TOK DIMENSIONALITY_TOK LBRACKET_TOK compound_list RBRACKET_TOK  */
-#line 386 "lwin_wkt_parse.y"
+#line 398 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(COMPOUNDTYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2481 "lwin_wkt_parse.c"
+#line 2493 "lwin_wkt_parse.c"
     break;
 
   case 76: /* compoundcurve: COMPOUNDCURVE_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 388 "lwin_wkt_parse.y"
+#line 400 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(COMPOUNDTYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2487 "lwin_wkt_parse.c"
+#line 2499 "lwin_wkt_parse.c"
     break;
 
   case 77: /* compoundcurve: COMPOUNDCURVE_TOK EMPTY_TOK  */
-#line 390 "lwin_wkt_parse.y"
+#line 402 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(COMPOUNDTYPE, NULL, NULL); WKT_ERROR(); }
-#line 2493 "lwin_wkt_parse.c"
+#line 2505 "lwin_wkt_parse.c"
     break;
 
   case 78: /* compound_list: compound_list COMMA_TOK circularstring  */
-#line 394 "lwin_wkt_parse.y"
+#line 406 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2499 "lwin_wkt_parse.c"
+#line 2511 "lwin_wkt_parse.c"
     break;
 
   case 79: /* compound_list: compound_list COMMA_TOK linestring  */
-#line 396 "lwin_wkt_parse.y"
+#line 408 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2505 "lwin_wkt_parse.c"
+#line 2517 "lwin_wkt_parse.c"
     break;
 
   case 80: /* compound_list: compound_list COMMA_TOK linestring_untagged  */
-#line 398 "lwin_wkt_parse.y"
+#line 410 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2511 "lwin_wkt_parse.c"
+#line 2523 "lwin_wkt_parse.c"
     break;
 
   case 81: /* compound_list: circularstring  */
-#line 400 "lwin_wkt_parse.y"
+#line 412 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2517 "lwin_wkt_parse.c"
+#line 2529 "lwin_wkt_parse.c"
     break;
 
   case 82: /* compound_list: linestring  */
-#line 402 "lwin_wkt_parse.y"
+#line 414 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2523 "lwin_wkt_parse.c"
+#line 2535 "lwin_wkt_parse.c"
     break;
 
   case 83: /* compound_list: linestring_untagged  */
-#line 404 "lwin_wkt_parse.y"
+#line 416 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2529 "lwin_wkt_parse.c"
+#line 2541 "lwin_wkt_parse.c"
     break;
 
   case 84: /* multicurve: MCURVE_TOK LBRACKET_TOK curve_list RBRACKET_TOK  */
-#line 408 "lwin_wkt_parse.y"
+#line 420 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTICURVETYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2535 "lwin_wkt_parse.c"
+#line 2547 "lwin_wkt_parse.c"
     break;
 
   case 85: /* multicurve: MCURVE_TOK DIMENSIONALITY_TOK LBRACKET_TOK curve_list RBRACKET_TOK  */
-#line 410 "lwin_wkt_parse.y"
+#line 422 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTICURVETYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2541 "lwin_wkt_parse.c"
+#line 2553 "lwin_wkt_parse.c"
     break;
 
   case 86: /* multicurve: MCURVE_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 412 "lwin_wkt_parse.y"
+#line 424 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTICURVETYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2547 "lwin_wkt_parse.c"
+#line 2559 "lwin_wkt_parse.c"
     break;
 
   case 87: /* multicurve: MCURVE_TOK EMPTY_TOK  */
-#line 414 "lwin_wkt_parse.y"
+#line 426 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTICURVETYPE, NULL, NULL); WKT_ERROR(); }
-#line 2553 "lwin_wkt_parse.c"
+#line 2565 "lwin_wkt_parse.c"
     break;
 
   case 88: /* curve_list: curve_list COMMA_TOK circularstring  */
-#line 418 "lwin_wkt_parse.y"
+#line 430 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2559 "lwin_wkt_parse.c"
+#line 2571 "lwin_wkt_parse.c"
     break;
 
   case 89: /* curve_list: curve_list COMMA_TOK compoundcurve  */
-#line 420 "lwin_wkt_parse.y"
+#line 432 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2565 "lwin_wkt_parse.c"
+#line 2577 "lwin_wkt_parse.c"
     break;
 
   case 90: /* curve_list: curve_list COMMA_TOK linestring  */
-#line 422 "lwin_wkt_parse.y"
+#line 434 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2571 "lwin_wkt_parse.c"
+#line 2583 "lwin_wkt_parse.c"
     break;
 
   case 91: /* curve_list: curve_list COMMA_TOK linestring_untagged  */
-#line 424 "lwin_wkt_parse.y"
+#line 436 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2577 "lwin_wkt_parse.c"
+#line 2589 "lwin_wkt_parse.c"
     break;
 
   case 92: /* curve_list: circularstring  */
-#line 426 "lwin_wkt_parse.y"
+#line 438 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2583 "lwin_wkt_parse.c"
+#line 2595 "lwin_wkt_parse.c"
     break;
 
   case 93: /* curve_list: compoundcurve  */
-#line 428 "lwin_wkt_parse.y"
+#line 440 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2589 "lwin_wkt_parse.c"
+#line 2601 "lwin_wkt_parse.c"
     break;
 
   case 94: /* curve_list: linestring  */
-#line 430 "lwin_wkt_parse.y"
+#line 442 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2595 "lwin_wkt_parse.c"
+#line 2607 "lwin_wkt_parse.c"
     break;
 
   case 95: /* curve_list: linestring_untagged  */
-#line 432 "lwin_wkt_parse.y"
+#line 444 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2601 "lwin_wkt_parse.c"
+#line 2613 "lwin_wkt_parse.c"
     break;
 
   case 96: /* multilinestring: MLINESTRING_TOK LBRACKET_TOK linestring_list RBRACKET_TOK  */
-#line 436 "lwin_wkt_parse.y"
+#line 448 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTILINETYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2607 "lwin_wkt_parse.c"
+#line 2619 "lwin_wkt_parse.c"
     break;
 
   case 97: /* multilinestring: MLINESTRING_TOK DIMENSIONALITY_TOK LBRACKET_TOK linestring_list RBRACKET_TOK  */
-#line 438 "lwin_wkt_parse.y"
+#line 450 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTILINETYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2613 "lwin_wkt_parse.c"
+#line 2625 "lwin_wkt_parse.c"
     break;
 
   case 98: /* multilinestring: MLINESTRING_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 440 "lwin_wkt_parse.y"
+#line 452 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTILINETYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2619 "lwin_wkt_parse.c"
+#line 2631 "lwin_wkt_parse.c"
     break;
 
   case 99: /* multilinestring: MLINESTRING_TOK EMPTY_TOK  */
-#line 442 "lwin_wkt_parse.y"
+#line 454 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTILINETYPE, NULL, NULL); WKT_ERROR(); }
-#line 2625 "lwin_wkt_parse.c"
+#line 2637 "lwin_wkt_parse.c"
     break;
 
   case 100: /* linestring_list: linestring_list COMMA_TOK linestring_untagged  */
-#line 446 "lwin_wkt_parse.y"
+#line 458 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2631 "lwin_wkt_parse.c"
+#line 2643 "lwin_wkt_parse.c"
     break;
 
   case 101: /* linestring_list: linestring_untagged  */
-#line 448 "lwin_wkt_parse.y"
+#line 460 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2637 "lwin_wkt_parse.c"
+#line 2649 "lwin_wkt_parse.c"
     break;
 
   case 102: /* circularstring: CIRCULARSTRING_TOK LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 452 "lwin_wkt_parse.y"
+#line 464 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_circularstring_new((yyvsp[-1].ptarrayvalue), NULL); WKT_ERROR(); }
-#line 2643 "lwin_wkt_parse.c"
+#line 2655 "lwin_wkt_parse.c"
     break;
 
   case 103: /* circularstring: CIRCULARSTRING_TOK DIMENSIONALITY_TOK LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 454 "lwin_wkt_parse.y"
+#line 466 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_circularstring_new((yyvsp[-1].ptarrayvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2649 "lwin_wkt_parse.c"
+#line 2661 "lwin_wkt_parse.c"
     break;
 
   case 104: /* circularstring: CIRCULARSTRING_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 456 "lwin_wkt_parse.y"
+#line 468 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_circularstring_new(NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2655 "lwin_wkt_parse.c"
+#line 2667 "lwin_wkt_parse.c"
     break;
 
   case 105: /* circularstring: CIRCULARSTRING_TOK EMPTY_TOK  */
-#line 458 "lwin_wkt_parse.y"
+#line 470 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_circularstring_new(NULL, NULL); WKT_ERROR(); }
-#line 2661 "lwin_wkt_parse.c"
+#line 2673 "lwin_wkt_parse.c"
     break;
 
   case 106: /* linestring: LINESTRING_TOK LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 462 "lwin_wkt_parse.y"
+#line 474 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_linestring_new((yyvsp[-1].ptarrayvalue), NULL); WKT_ERROR(); }
-#line 2667 "lwin_wkt_parse.c"
+#line 2679 "lwin_wkt_parse.c"
     break;
 
   case 107: /* linestring: LINESTRING_TOK DIMENSIONALITY_TOK LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 464 "lwin_wkt_parse.y"
+#line 476 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_linestring_new((yyvsp[-1].ptarrayvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2673 "lwin_wkt_parse.c"
+#line 2685 "lwin_wkt_parse.c"
     break;
 
   case 108: /* linestring: LINESTRING_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 466 "lwin_wkt_parse.y"
+#line 478 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_linestring_new(NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2679 "lwin_wkt_parse.c"
+#line 2691 "lwin_wkt_parse.c"
     break;
 
   case 109: /* linestring: LINESTRING_TOK EMPTY_TOK  */
-#line 468 "lwin_wkt_parse.y"
+#line 480 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_linestring_new(NULL, NULL); WKT_ERROR(); }
-#line 2685 "lwin_wkt_parse.c"
+#line 2697 "lwin_wkt_parse.c"
     break;
 
   case 110: /* linestring_untagged: LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 472 "lwin_wkt_parse.y"
+#line 484 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_linestring_new((yyvsp[-1].ptarrayvalue), NULL); WKT_ERROR(); }
-#line 2691 "lwin_wkt_parse.c"
+#line 2703 "lwin_wkt_parse.c"
     break;
 
   case 111: /* linestring_untagged: EMPTY_TOK  */
-#line 474 "lwin_wkt_parse.y"
+#line 486 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_linestring_new(NULL, NULL); WKT_ERROR(); }
-#line 2697 "lwin_wkt_parse.c"
+#line 2709 "lwin_wkt_parse.c"
     break;
 
   case 112: /* triangle_list: triangle_list COMMA_TOK triangle_untagged  */
-#line 478 "lwin_wkt_parse.y"
+#line 490 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2703 "lwin_wkt_parse.c"
+#line 2715 "lwin_wkt_parse.c"
     break;
 
   case 113: /* triangle_list: triangle_untagged  */
-#line 480 "lwin_wkt_parse.y"
+#line 492 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2709 "lwin_wkt_parse.c"
+#line 2721 "lwin_wkt_parse.c"
     break;
 
   case 114: /* triangle: TRIANGLE_TOK LBRACKET_TOK LBRACKET_TOK ptarray RBRACKET_TOK RBRACKET_TOK  */
-#line 484 "lwin_wkt_parse.y"
+#line 496 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_triangle_new((yyvsp[-2].ptarrayvalue), NULL); WKT_ERROR(); }
-#line 2715 "lwin_wkt_parse.c"
+#line 2727 "lwin_wkt_parse.c"
     break;
 
   case 115: /* triangle: TRIANGLE_TOK DIMENSIONALITY_TOK LBRACKET_TOK LBRACKET_TOK ptarray RBRACKET_TOK RBRACKET_TOK  */
-#line 486 "lwin_wkt_parse.y"
+#line 498 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_triangle_new((yyvsp[-2].ptarrayvalue), (yyvsp[-5].stringvalue)); WKT_ERROR(); }
-#line 2721 "lwin_wkt_parse.c"
+#line 2733 "lwin_wkt_parse.c"
     break;
 
   case 116: /* triangle: TRIANGLE_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 488 "lwin_wkt_parse.y"
+#line 500 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_triangle_new(NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2727 "lwin_wkt_parse.c"
+#line 2739 "lwin_wkt_parse.c"
     break;
 
   case 117: /* triangle: TRIANGLE_TOK EMPTY_TOK  */
-#line 490 "lwin_wkt_parse.y"
+#line 502 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_triangle_new(NULL, NULL); WKT_ERROR(); }
-#line 2733 "lwin_wkt_parse.c"
+#line 2745 "lwin_wkt_parse.c"
     break;
 
   case 118: /* triangle_untagged: LBRACKET_TOK LBRACKET_TOK ptarray RBRACKET_TOK RBRACKET_TOK  */
-#line 494 "lwin_wkt_parse.y"
+#line 506 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_triangle_new((yyvsp[-2].ptarrayvalue), NULL); WKT_ERROR(); }
-#line 2739 "lwin_wkt_parse.c"
+#line 2751 "lwin_wkt_parse.c"
     break;
 
   case 119: /* multipoint: MPOINT_TOK LBRACKET_TOK point_list RBRACKET_TOK  */
-#line 498 "lwin_wkt_parse.y"
+#line 510 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTIPOINTTYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2745 "lwin_wkt_parse.c"
+#line 2757 "lwin_wkt_parse.c"
     break;
 
   case 120: /* multipoint: MPOINT_TOK DIMENSIONALITY_TOK LBRACKET_TOK point_list RBRACKET_TOK  */
-#line 500 "lwin_wkt_parse.y"
+#line 512 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTIPOINTTYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2751 "lwin_wkt_parse.c"
+#line 2763 "lwin_wkt_parse.c"
     break;
 
   case 121: /* multipoint: MPOINT_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 502 "lwin_wkt_parse.y"
+#line 514 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTIPOINTTYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2757 "lwin_wkt_parse.c"
+#line 2769 "lwin_wkt_parse.c"
     break;
 
   case 122: /* multipoint: MPOINT_TOK EMPTY_TOK  */
-#line 504 "lwin_wkt_parse.y"
+#line 516 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTIPOINTTYPE, NULL, NULL); WKT_ERROR(); }
-#line 2763 "lwin_wkt_parse.c"
+#line 2775 "lwin_wkt_parse.c"
     break;
 
   case 123: /* point_list: point_list COMMA_TOK point_untagged  */
-#line 508 "lwin_wkt_parse.y"
+#line 520 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2769 "lwin_wkt_parse.c"
+#line 2781 "lwin_wkt_parse.c"
     break;
 
   case 124: /* point_list: point_untagged  */
-#line 510 "lwin_wkt_parse.y"
+#line 522 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2775 "lwin_wkt_parse.c"
+#line 2787 "lwin_wkt_parse.c"
     break;
 
   case 125: /* point_untagged: coordinate  */
-#line 514 "lwin_wkt_parse.y"
+#line 526 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_point_new(wkt_parser_ptarray_new((yyvsp[0].coordinatevalue)),NULL); WKT_ERROR(); }
-#line 2781 "lwin_wkt_parse.c"
+#line 2793 "lwin_wkt_parse.c"
     break;
 
   case 126: /* point_untagged: LBRACKET_TOK coordinate RBRACKET_TOK  */
-#line 516 "lwin_wkt_parse.y"
+#line 528 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_point_new(wkt_parser_ptarray_new((yyvsp[-1].coordinatevalue)),NULL); WKT_ERROR(); }
-#line 2787 "lwin_wkt_parse.c"
+#line 2799 "lwin_wkt_parse.c"
     break;
 
   case 127: /* point_untagged: EMPTY_TOK  */
-#line 518 "lwin_wkt_parse.y"
+#line 530 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_point_new(NULL, NULL); WKT_ERROR(); }
-#line 2793 "lwin_wkt_parse.c"
+#line 2805 "lwin_wkt_parse.c"
     break;
 
   case 128: /* point: POINT_TOK LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 522 "lwin_wkt_parse.y"
+#line 534 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_point_new((yyvsp[-1].ptarrayvalue), NULL); WKT_ERROR(); }
-#line 2799 "lwin_wkt_parse.c"
+#line 2811 "lwin_wkt_parse.c"
     break;
 
   case 129: /* point: POINT_TOK DIMENSIONALITY_TOK LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 524 "lwin_wkt_parse.y"
+#line 536 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_point_new((yyvsp[-1].ptarrayvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2805 "lwin_wkt_parse.c"
+#line 2817 "lwin_wkt_parse.c"
     break;
 
   case 130: /* point: POINT_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 526 "lwin_wkt_parse.y"
+#line 538 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_point_new(NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2811 "lwin_wkt_parse.c"
+#line 2823 "lwin_wkt_parse.c"
     break;
 
   case 131: /* point: POINT_TOK EMPTY_TOK  */
-#line 528 "lwin_wkt_parse.y"
+#line 540 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_point_new(NULL,NULL); WKT_ERROR(); }
-#line 2817 "lwin_wkt_parse.c"
+#line 2829 "lwin_wkt_parse.c"
     break;
 
   case 132: /* ptarray: ptarray COMMA_TOK coordinate  */
-#line 532 "lwin_wkt_parse.y"
+#line 544 "lwin_wkt_parse.y"
                 { (yyval.ptarrayvalue) = wkt_parser_ptarray_add_coord((yyvsp[-2].ptarrayvalue), (yyvsp[0].coordinatevalue)); WKT_ERROR(); }
-#line 2823 "lwin_wkt_parse.c"
+#line 2835 "lwin_wkt_parse.c"
     break;
 
   case 133: /* ptarray: coordinate  */
-#line 534 "lwin_wkt_parse.y"
+#line 546 "lwin_wkt_parse.y"
                 { (yyval.ptarrayvalue) = wkt_parser_ptarray_new((yyvsp[0].coordinatevalue)); WKT_ERROR(); }
-#line 2829 "lwin_wkt_parse.c"
+#line 2841 "lwin_wkt_parse.c"
     break;
 
   case 134: /* coordinate: DOUBLE_TOK DOUBLE_TOK  */
-#line 538 "lwin_wkt_parse.y"
+#line 550 "lwin_wkt_parse.y"
                 { (yyval.coordinatevalue) = wkt_parser_coord_2((yyvsp[-1].doublevalue), (yyvsp[0].doublevalue)); WKT_ERROR(); }
-#line 2835 "lwin_wkt_parse.c"
+#line 2847 "lwin_wkt_parse.c"
     break;
 
   case 135: /* coordinate: DOUBLE_TOK DOUBLE_TOK DOUBLE_TOK  */
-#line 540 "lwin_wkt_parse.y"
+#line 552 "lwin_wkt_parse.y"
                 { (yyval.coordinatevalue) = wkt_parser_coord_3((yyvsp[-2].doublevalue), (yyvsp[-1].doublevalue), (yyvsp[0].doublevalue)); WKT_ERROR(); }
-#line 2841 "lwin_wkt_parse.c"
+#line 2853 "lwin_wkt_parse.c"
     break;
 
   case 136: /* coordinate: DOUBLE_TOK DOUBLE_TOK DOUBLE_TOK DOUBLE_TOK  */
-#line 542 "lwin_wkt_parse.y"
+#line 554 "lwin_wkt_parse.y"
                 { (yyval.coordinatevalue) = wkt_parser_coord_4((yyvsp[-3].doublevalue), (yyvsp[-2].doublevalue), (yyvsp[-1].doublevalue), (yyvsp[0].doublevalue)); WKT_ERROR(); }
-#line 2847 "lwin_wkt_parse.c"
+#line 2859 "lwin_wkt_parse.c"
     break;
 
 
-#line 2851 "lwin_wkt_parse.c"
+#line 2863 "lwin_wkt_parse.c"
 
       default: break;
     }
@@ -3076,6 +3088,6 @@ yyreturnlab:
   return yyresult;
 }
 
-#line 544 "lwin_wkt_parse.y"
+#line 556 "lwin_wkt_parse.y"
 
 
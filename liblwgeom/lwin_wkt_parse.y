@@ -63,6 +63,18 @@ int lwgeom_parse_wkt(LWGEOM_PARSER_RESULT *parser_result, char *wktstr, int pars
 	global_parser_result.wkinput = wktstr;
 	global_parser_result.parser_check_flags = parser_check_flags;
 
+	/* Common geometry types are read without the lexer */
+	if ( wkt_fast_parse(wktstr) == LW_SUCCESS )
+	{
+		*parser_result = global_parser_result;
+		return LW_SUCCESS;
+	}
+
+	/* Otherwise start over, the fast reader may have left an error behind */
+	lwgeom_parser_result_init(&global_parser_result);
+	global_parser_result.wkinput = wktstr;
+	global_parser_result.parser_check_flags = parser_check_flags;
+
 	wkt_lexer_init(wktstr, &wkt_yyg); /* Lexer ready */
 	parse_rv = wkt_yyparse(wkt_yyg); /* Run the parse */
 	LWDEBUGF(4,"wkt_yyparse returned %d", parse_rv);
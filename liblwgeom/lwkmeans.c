@@ -6,6 +6,11 @@
  *------------------------------------------------------------------------*/
 
 #include "liblwgeom_internal.h"
+#include "lwthread.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /*
  * When clustering lists with NULL or EMPTY elements, they will get this as
@@ -19,13 +24,61 @@
  */
 #define KMEANS_MAX_ITERATIONS 1000
 
+/* Below this many points per thread, starting the threads costs more than it saves */
+#define KMEANS_PARALLEL_MIN_POINTS 16384
+
+/*
+ * The distance bounds are updated with rounded arithmetic, so they only
+ * skip a point when they hold by this much, relative to the input extent.
+ * Anything closer is checked against all centers, so that the assignment
+ * is exactly the one of the plain scan, ties included.
+ */
+#define KMEANS_BOUND_EPSILON 1e-9
+
+/* Cluster centers as a structure of arrays, scanned two at a time */
+typedef struct
+{
+	double *x;
+	double *y;
+	double *z;
+	uint32_t k;
+} KMEANS_CENTERS;
+
+/*
+ * Assignment state, keeping Hamerly's bounds for every point: an upper
+ * bound on the distance to its center and a lower bound on the distance
+ * to any other center. Moving the centers loosens the bounds by the
+ * distance they moved, and only the points whose bounds overlap need a
+ * distance computation, or a scan of all the centers.
+ */
+typedef struct
+{
+	const POINT4D *objs;
+	uint32_t *clusters;
+	uint32_t n;
+	KMEANS_CENTERS c;
+	uint32_t capacity;
+	double *upper;
+	double *lower;
+	double *half_gap; /* Half the distance from every center to the nearest other one */
+	double *drift;	  /* Distance every center moved since the last assignment */
+	double max_drift;
+	double second_drift;
+	uint32_t max_drift_center;
+	double slack;
+	uint8_t full; /* Bounds are unset, every point scans all centers */
+	uint32_t nthreads;
+	uint8_t *changed; /* One flag per worker */
+} KMEANS_STATE;
+
 static uint32_t kmeans(POINT4D *objs,
 		       uint32_t *clusters,
 		       uint32_t n,
 		       POINT4D *centers,
 		       double *radii,
 		       uint32_t min_k,
-		       double max_radius);
+		       double max_radius,
+		       uint32_t nthreads);
 
 inline static double
 distance3d_sqr_pt4d_pt4d(const POINT4D *p1, const POINT4D *p2)
@@ -45,7 +98,8 @@ improve_structure(POINT4D *objs,
 		  POINT4D *centers,
 		  double *radii,
 		  uint32_t k,
-		  double max_radius)
+		  double max_radius,
+		  uint32_t nthreads)
 {
 	/* Input check: radius limit should be measurable */
 	if (max_radius <= 0)
@@ -82,7 +136,7 @@ improve_structure(POINT4D *objs,
 			continue;
 
 		/* run 2-means on the cluster */
-		kmeans(temp_objs, temp_clusters, cluster_size, temp_centers, temp_radii, 2, 0);
+		kmeans(temp_objs, temp_clusters, cluster_size, temp_centers, temp_radii, 2, 0, nthreads);
 
 		/* replace cluster with split */
 		uint32_t d = 0;
@@ -104,46 +158,209 @@ improve_structure(POINT4D *objs,
 	return new_k;
 }
 
-/* Refresh mapping of point to closest cluster */
-static uint8_t
-update_r(POINT4D *objs, uint32_t *clusters, uint32_t n, POINT4D *centers, double *radii, uint32_t k)
+#if defined(__SSE2__)
+static inline __m128d
+kmeans_select(__m128d mask, __m128d a, __m128d b)
 {
-	uint8_t converged = LW_TRUE;
-	if (radii)
-		memset(radii, 0, sizeof(double) * k);
+	return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+#endif
 
-	for (uint32_t i = 0; i < n; i++)
+/*
+ * Nearest center to a point, with the squared distances to it and to the
+ * second nearest one. Ties go to the lowest center, like a plain scan.
+ */
+static uint32_t
+kmeans_nearest(const KMEANS_CENTERS *c, const POINT4D *obj, double *d1, double *d2)
+{
+	double m1[3] = {DBL_MAX, DBL_MAX, DBL_MAX};
+	double m2[3] = {DBL_MAX, DBL_MAX, DBL_MAX};
+	double i1[3] = {0, 0, 0};
+	uint32_t j = 0, lane, best = 0;
+
+#if defined(__SSE2__)
+	/* Two lanes, for the even and the odd centers */
+	__m128d px = _mm_set1_pd(obj->x), py = _mm_set1_pd(obj->y), pz = _mm_set1_pd(obj->z);
+	__m128d vm1 = _mm_set1_pd(DBL_MAX), vm2 = _mm_set1_pd(DBL_MAX);
+	__m128d vi1 = _mm_set_pd(1, 0), vidx = _mm_set_pd(1, 0), two = _mm_set1_pd(2);
+	for (; j + 2 <= c->k; j += 2)
 	{
-		POINT4D obj = objs[i];
+		__m128d hside = _mm_sub_pd(_mm_loadu_pd(c->x + j), px);
+		__m128d vside = _mm_sub_pd(_mm_loadu_pd(c->y + j), py);
+		__m128d zside = _mm_sub_pd(_mm_loadu_pd(c->z + j), pz);
+		__m128d d = _mm_add_pd(_mm_add_pd(_mm_mul_pd(hside, hside), _mm_mul_pd(vside, vside)),
+				       _mm_mul_pd(zside, zside));
+		__m128d closer = _mm_cmplt_pd(d, vm1);
+		vm2 = kmeans_select(closer, vm1, _mm_min_pd(d, vm2));
+		vm1 = kmeans_select(closer, d, vm1);
+		vi1 = kmeans_select(closer, vidx, vi1);
+		vidx = _mm_add_pd(vidx, two);
+	}
+	_mm_storeu_pd(m1, vm1);
+	_mm_storeu_pd(m2, vm2);
+	_mm_storeu_pd(i1, vi1);
+#endif
+
+	/* Remaining centers in the last lane */
+	i1[2] = j;
+	for (; j < c->k; j++)
+	{
+		double hside = c->x[j] - obj->x;
+		double vside = c->y[j] - obj->y;
+		double zside = c->z[j] - obj->z;
+		double d = hside * hside + vside * vside + zside * zside;
+		if (d < m1[2])
+		{
+			m2[2] = m1[2];
+			m1[2] = d;
+			i1[2] = j;
+		}
+		else if (d < m2[2])
+			m2[2] = d;
+	}
 
-		/* Initialize with distance to first cluster */
-		double curr_distance = distance3d_sqr_pt4d_pt4d(&obj, &centers[0]);
-		uint32_t curr_cluster = 0;
+	/* Nearest over the lanes, the second nearest is the best of the rest */
+	for (lane = 1; lane < 3; lane++)
+		if (m1[lane] < m1[best] || (m1[lane] == m1[best] && i1[lane] < i1[best]))
+			best = lane;
+	*d1 = m1[best];
+	*d2 = m2[best];
+	for (lane = 0; lane < 3; lane++)
+		if (lane != best && m1[lane] < *d2)
+			*d2 = m1[lane];
+	return (uint32_t)i1[best];
+}
 
-		/* Check all other cluster centers and find the nearest */
-		for (uint32_t cluster = 1; cluster < k; cluster++)
+static inline double
+kmeans_center_distance_sqr(const KMEANS_CENTERS *c, uint32_t j, const POINT4D *obj)
+{
+	double hside = c->x[j] - obj->x;
+	double vside = c->y[j] - obj->y;
+	double zside = c->z[j] - obj->z;
+
+	return hside * hside + vside * vside + zside * zside;
+}
+
+static void
+kmeans_assign_worker(void *arg, uint32_t worker)
+{
+	KMEANS_STATE *state = (KMEANS_STATE *)arg;
+	uint32_t from = (uint32_t)((uint64_t)state->n * worker / state->nthreads);
+	uint32_t to = (uint32_t)((uint64_t)state->n * (worker + 1) / state->nthreads);
+	uint8_t changed = LW_FALSE;
+
+	for (uint32_t i = from; i < to; i++)
+	{
+		const POINT4D *obj = &state->objs[i];
+		uint32_t cluster = state->clusters[i];
+		double d1, d2;
+
+		if (!state->full)
 		{
-			double distance = distance3d_sqr_pt4d_pt4d(&obj, &centers[cluster]);
-			if (distance < curr_distance)
+			double upper = state->upper[i] + state->drift[cluster];
+			double lower = state->lower[i] -
+				       (cluster == state->max_drift_center ? state->second_drift : state->max_drift);
+			double bound = FP_MAX(state->half_gap[cluster], lower) - state->slack;
+
+			state->lower[i] = lower;
+			if (upper < bound)
 			{
-				curr_distance = distance;
-				curr_cluster = cluster;
+				state->upper[i] = upper;
+				continue;
 			}
+
+			/* Tighten the upper bound before giving up */
+			upper = sqrt(kmeans_center_distance_sqr(&state->c, cluster, obj));
+			state->upper[i] = upper;
+			if (upper < bound)
+				continue;
 		}
 
-		/* Store the nearest cluster this object is in */
-		if (clusters[i] != curr_cluster)
+		uint32_t nearest = kmeans_nearest(&state->c, obj, &d1, &d2);
+		state->upper[i] = sqrt(d1);
+		state->lower[i] = sqrt(d2);
+		if (nearest != cluster)
 		{
-			converged = LW_FALSE;
-			clusters[i] = curr_cluster;
+			state->clusters[i] = nearest;
+			changed = LW_TRUE;
 		}
-		if (radii)
-			if (radii[curr_cluster] < curr_distance)
-				radii[curr_cluster] = curr_distance;
 	}
+	state->changed[worker] = changed;
+}
+
+/* Refresh mapping of point to closest cluster */
+static uint8_t
+kmeans_assign(KMEANS_STATE *state)
+{
+	uint8_t converged = LW_TRUE;
+
+	lwthread_run(state->nthreads, kmeans_assign_worker, state);
+	for (uint32_t w = 0; w < state->nthreads; w++)
+		if (state->changed[w])
+			converged = LW_FALSE;
+	state->full = LW_FALSE;
 	return converged;
 }
 
+/* Load new centers, and how far they moved for the bounds */
+static void
+kmeans_set_centers(KMEANS_STATE *state, const POINT4D *centers, uint32_t k)
+{
+	if (k > state->capacity)
+	{
+		state->capacity = k;
+		state->c.x = lwrealloc(state->c.x, sizeof(double) * k);
+		state->c.y = lwrealloc(state->c.y, sizeof(double) * k);
+		state->c.z = lwrealloc(state->c.z, sizeof(double) * k);
+		state->half_gap = lwrealloc(state->half_gap, sizeof(double) * k);
+		state->drift = lwrealloc(state->drift, sizeof(double) * k);
+	}
+
+	state->max_drift = state->second_drift = 0;
+	state->max_drift_center = 0;
+	for (uint32_t j = 0; j < k; j++)
+	{
+		if (!state->full)
+		{
+			double drift = sqrt(kmeans_center_distance_sqr(&state->c, j, &centers[j]));
+			state->drift[j] = drift;
+			if (drift > state->max_drift)
+			{
+				state->second_drift = state->max_drift;
+				state->max_drift = drift;
+				state->max_drift_center = j;
+			}
+			else if (drift > state->second_drift)
+				state->second_drift = drift;
+		}
+		state->c.x[j] = centers[j].x;
+		state->c.y[j] = centers[j].y;
+		state->c.z[j] = centers[j].z;
+	}
+	state->c.k = k;
+
+	/* A center is its own nearest, the second nearest is the other one */
+	for (uint32_t j = 0; j < k; j++)
+	{
+		double d1, d2;
+		kmeans_nearest(&state->c, &centers[j], &d1, &d2);
+		state->half_gap[j] = sqrt(d2) / 2;
+	}
+}
+
+/* Squared radius of every cluster, as the farthest of its objects */
+static void
+kmeans_radii(const POINT4D *objs, const uint32_t *clusters, uint32_t n, const POINT4D *centers, double *radii, uint32_t k)
+{
+	memset(radii, 0, sizeof(double) * k);
+	for (uint32_t i = 0; i < n; i++)
+	{
+		double distance = distance3d_sqr_pt4d_pt4d(&objs[i], &centers[clusters[i]]);
+		if (radii[clusters[i]] < distance)
+			radii[clusters[i]] = distance;
+	}
+}
+
 /* Refresh cluster centroids based on all of their objects */
 static void
 update_means(POINT4D *objs, uint32_t *clusters, uint32_t n, POINT4D *centers, uint32_t k)
@@ -170,11 +387,89 @@ update_means(POINT4D *objs, uint32_t *clusters, uint32_t n, POINT4D *centers, ui
 	}
 }
 
+/* Objects as a structure of arrays for the farthest point scans */
+typedef struct
+{
+	const double *x;
+	const double *y;
+	const double *z;
+	double *distances;
+	uint32_t n;
+	POINT4D center;
+	uint32_t nthreads;
+	uint32_t *candidates; /* One per worker */
+	double *candidate_distances;
+} KMEANS_INIT_JOB;
+
+/*
+ * Lower the distances of a range of objects to the accepted centers with
+ * the latest one, and find the farthest of them. Accepted centers are
+ * marked with a negative distance, that the new one can only keep.
+ */
+static void
+kmeans_init_worker(void *arg, uint32_t worker)
+{
+	KMEANS_INIT_JOB *job = (KMEANS_INIT_JOB *)arg;
+	uint32_t from = (uint32_t)((uint64_t)job->n * worker / job->nthreads);
+	uint32_t to = (uint32_t)((uint64_t)job->n * (worker + 1) / job->nthreads);
+	double best[3] = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+	double best_j[3] = {from, from, from};
+	uint32_t j = from, lane, winner = 0;
+
+#if defined(__SSE2__)
+	__m128d cx = _mm_set1_pd(job->center.x), cy = _mm_set1_pd(job->center.y), cz = _mm_set1_pd(job->center.z);
+	__m128d vbest = _mm_set1_pd(-DBL_MAX);
+	__m128d vbest_j = _mm_set_pd(from + 1, from), vidx = _mm_set_pd(from + 1, from), two = _mm_set1_pd(2);
+	for (; j + 2 <= to; j += 2)
+	{
+		__m128d hside = _mm_sub_pd(cx, _mm_loadu_pd(job->x + j));
+		__m128d vside = _mm_sub_pd(cy, _mm_loadu_pd(job->y + j));
+		__m128d zside = _mm_sub_pd(cz, _mm_loadu_pd(job->z + j));
+		__m128d d = _mm_add_pd(_mm_add_pd(_mm_mul_pd(hside, hside), _mm_mul_pd(vside, vside)),
+				       _mm_mul_pd(zside, zside));
+		__m128d farther;
+		d = _mm_min_pd(d, _mm_loadu_pd(job->distances + j));
+		_mm_storeu_pd(job->distances + j, d);
+		farther = _mm_cmpgt_pd(d, vbest);
+		vbest = kmeans_select(farther, d, vbest);
+		vbest_j = kmeans_select(farther, vidx, vbest_j);
+		vidx = _mm_add_pd(vidx, two);
+	}
+	_mm_storeu_pd(best, vbest);
+	_mm_storeu_pd(best_j, vbest_j);
+#endif
+
+	best_j[2] = j;
+	for (; j < to; j++)
+	{
+		if (job->distances[j] < 0)
+			continue;
+		double hside = job->center.x - job->x[j];
+		double vside = job->center.y - job->y[j];
+		double zside = job->center.z - job->z[j];
+		double d = hside * hside + vside * vside + zside * zside;
+		if (d < job->distances[j])
+			job->distances[j] = d;
+		if (job->distances[j] > best[2])
+		{
+			best[2] = job->distances[j];
+			best_j[2] = j;
+		}
+	}
+
+	for (lane = 1; lane < 3; lane++)
+		if (best[lane] > best[winner] || (best[lane] == best[winner] && best_j[lane] < best_j[winner]))
+			winner = lane;
+	job->candidates[worker] = (uint32_t)best_j[winner];
+	job->candidate_distances[worker] = best[winner];
+}
+
 /* Assign initial clusters centroids heuristically */
 static void
-kmeans_init(POINT4D *objs, uint32_t n, POINT4D *centers, uint32_t k)
+kmeans_init(POINT4D *objs, uint32_t n, POINT4D *centers, uint32_t k, uint32_t nthreads)
 {
-	double *distances;
+	KMEANS_INIT_JOB job;
+	double *distances, *x, *y, *z;
 	uint32_t p1 = 0, p2 = 0;
 	uint32_t duplicate_count = 1; /* a point is a duplicate of itself */
 	double max_dst = -1;
@@ -226,36 +521,45 @@ kmeans_init(POINT4D *objs, uint32_t n, POINT4D *centers, uint32_t k)
 	{
 		/* array of minimum distance to a point from accepted cluster centers */
 		distances = lwalloc(sizeof(double) * n);
+		x = lwalloc(sizeof(double) * n);
+		y = lwalloc(sizeof(double) * n);
+		z = lwalloc(sizeof(double) * n);
 
 		/* initialize array with distance to first object */
 		for (uint32_t j = 0; j < n; j++)
+		{
 			distances[j] = distance3d_sqr_pt4d_pt4d(&objs[j], &centers[0]);
+			x[j] = objs[j].x;
+			y[j] = objs[j].y;
+			z[j] = objs[j].z;
+		}
 		distances[p1] = -1;
 		distances[p2] = -1;
 
+		job.x = x;
+		job.y = y;
+		job.z = z;
+		job.distances = distances;
+		job.n = n;
+		job.nthreads = lwthread_count(nthreads, n, KMEANS_PARALLEL_MIN_POINTS);
+		job.candidates = lwalloc(sizeof(uint32_t) * job.nthreads);
+		job.candidate_distances = lwalloc(sizeof(double) * job.nthreads);
+
 		/* loop i on clusters, skip 0 and 1 as found already */
 		for (uint32_t i = 2; i < k; i++)
 		{
 			uint32_t candidate_center = 0;
 			double max_distance = -DBL_MAX;
 
-			/* loop j on objs */
-			for (uint32_t j = 0; j < n; j++)
+			/* greedily take a point that's farthest from any of accepted clusters */
+			job.center = centers[i - 1];
+			lwthread_run(job.nthreads, kmeans_init_worker, &job);
+			for (uint32_t w = 0; w < job.nthreads; w++)
 			{
-				/* empty objs and accepted clusters are already marked with distance = -1 */
-				if (distances[j] < 0)
-					continue;
-
-				/* update minimal distance with previosuly accepted cluster */
-				double current_distance = distance3d_sqr_pt4d_pt4d(&objs[j], &centers[i - 1]);
-				if (current_distance < distances[j])
-					distances[j] = current_distance;
-
-				/* greedily take a point that's farthest from any of accepted clusters */
-				if (distances[j] > max_distance)
+				if (job.candidate_distances[w] > max_distance)
 				{
-					candidate_center = j;
-					max_distance = distances[j];
+					candidate_center = job.candidates[w];
+					max_distance = job.candidate_distances[w];
 				}
 			}
 
@@ -268,6 +572,11 @@ kmeans_init(POINT4D *objs, uint32_t n, POINT4D *centers, uint32_t k)
 			 * Centers array is an array of pointers to points, not an array of points */
 			centers[i] = objs[candidate_center];
 		}
+		lwfree(job.candidate_distances);
+		lwfree(job.candidates);
+		lwfree(z);
+		lwfree(y);
+		lwfree(x);
 		lwfree(distances);
 	}
 }
@@ -279,14 +588,45 @@ kmeans(POINT4D *objs,
        POINT4D *centers,
        double *radii,
        uint32_t min_k,
-       double max_radius)
+       double max_radius,
+       uint32_t nthreads)
 {
+	KMEANS_STATE state;
+	GBOX extent;
 	uint8_t converged = LW_FALSE;
 	uint32_t cur_k = min_k;
 
-	kmeans_init(objs, n, centers, cur_k);
+	memset(&state, 0, sizeof(KMEANS_STATE));
+	state.objs = objs;
+	state.clusters = clusters;
+	state.n = n;
+	state.nthreads = lwthread_count(nthreads, n, KMEANS_PARALLEL_MIN_POINTS);
+	state.changed = lwalloc(sizeof(uint8_t) * state.nthreads);
+	state.upper = lwalloc(sizeof(double) * n);
+	state.lower = lwalloc(sizeof(double) * n);
+	state.full = LW_TRUE;
+
+	/* Rounding of the bounds scales with the coordinates */
+	extent.xmin = extent.xmax = objs[0].x;
+	extent.ymin = extent.ymax = objs[0].y;
+	extent.zmin = extent.zmax = objs[0].z;
+	for (uint32_t i = 1; i < n; i++)
+	{
+		extent.xmin = FP_MIN(extent.xmin, objs[i].x);
+		extent.xmax = FP_MAX(extent.xmax, objs[i].x);
+		extent.ymin = FP_MIN(extent.ymin, objs[i].y);
+		extent.ymax = FP_MAX(extent.ymax, objs[i].y);
+		extent.zmin = FP_MIN(extent.zmin, objs[i].z);
+		extent.zmax = FP_MAX(extent.zmax, objs[i].z);
+	}
+	state.slack = KMEANS_BOUND_EPSILON *
+		      (FP_MAX(fabs(extent.xmin), fabs(extent.xmax)) + FP_MAX(fabs(extent.ymin), fabs(extent.ymax)) +
+		       FP_MAX(fabs(extent.zmin), fabs(extent.zmax)));
+
+	kmeans_init(objs, n, centers, cur_k, nthreads);
 	/* One iteration of kmeans needs to happen without shortcuts to fully initialize structures */
-	update_r(objs, clusters, n, centers, radii, cur_k);
+	kmeans_set_centers(&state, centers, cur_k);
+	kmeans_assign(&state);
 	update_means(objs, clusters, n, centers, cur_k);
 	for (uint32_t t = 0; t < KMEANS_MAX_ITERATIONS; t++)
 	{
@@ -294,21 +634,36 @@ kmeans(POINT4D *objs,
 		for (uint32_t i = 0; i < KMEANS_MAX_ITERATIONS; i++)
 		{
 			LW_ON_INTERRUPT(break);
-			converged = update_r(objs, clusters, n, centers, radii, cur_k);
+			kmeans_set_centers(&state, centers, cur_k);
+			converged = kmeans_assign(&state);
 			if (converged)
 				break;
 			update_means(objs, clusters, n, centers, cur_k);
 		}
-		if (!converged || !max_radius)
+		if (!converged)
+			break;
+		kmeans_radii(objs, clusters, n, centers, radii, cur_k);
+		if (!max_radius)
 			break;
 
 		/* XMeans-inspired improve_structure pass to split clusters bigger than limit into 2 */
-		uint32_t new_k = improve_structure(objs, clusters, n, centers, radii, cur_k, max_radius);
+		uint32_t new_k = improve_structure(objs, clusters, n, centers, radii, cur_k, max_radius, nthreads);
 		if (new_k == cur_k)
 			break;
 		cur_k = new_k;
+		/* The split moved points between clusters, start the bounds over */
+		state.full = LW_TRUE;
 	}
 
+	lwfree(state.c.x);
+	lwfree(state.c.y);
+	lwfree(state.c.z);
+	lwfree(state.half_gap);
+	lwfree(state.drift);
+	lwfree(state.upper);
+	lwfree(state.lower);
+	lwfree(state.changed);
+
 	if (!converged)
 	{
 		lwerror("%s did not converge after %d iterations", __func__, KMEANS_MAX_ITERATIONS);
@@ -319,6 +674,12 @@ kmeans(POINT4D *objs,
 
 int *
 lwgeom_cluster_kmeans(const LWGEOM **geoms, uint32_t n, uint32_t k, double max_radius)
+{
+	return lwgeom_cluster_kmeans_parallel(geoms, n, k, max_radius, 1);
+}
+
+int *
+lwgeom_cluster_kmeans_parallel(const LWGEOM **geoms, uint32_t n, uint32_t k, double max_radius, uint32_t nthreads)
 {
 	uint32_t num_non_empty = 0;
 
@@ -426,7 +787,7 @@ lwgeom_cluster_kmeans(const LWGEOM **geoms, uint32_t n, uint32_t k, double max_r
 	{
 		uint32_t *clusters_dense = lwalloc(sizeof(uint32_t) * num_non_empty);
 		memset(clusters_dense, 0, sizeof(uint32_t) * num_non_empty);
-		uint32_t output_cluster_count = kmeans(objs_dense, clusters_dense, num_non_empty, centers, radii, k, max_radius);
+		uint32_t output_cluster_count = kmeans(objs_dense, clusters_dense, num_non_empty, centers, radii, k, max_radius, nthreads);
 
 		uint32_t d = 0;
 		for (uint32_t i = 0; i < n; i++)
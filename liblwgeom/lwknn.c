@@ -0,0 +1,430 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include "liblwgeom_internal.h"
+#include "lwgeom_log.h"
+#include "lwgeodetic_tree.h"
+#include "lwhrtree.h"
+#include "lwtree.h"
+#include "lwknn.h"
+
+/*
+* Geodetic bounds work on the unit sphere: every node of the index gets a
+* cap (center and angular radius) holding everything under it.
+*/
+typedef struct
+{
+	POINT3D center;
+	double radius;
+} LWKNN_CAP;
+
+struct LWKNN
+{
+	const LWGEOM **geoms;
+	uint32_t ngeoms;
+	uint32_t *ids;     /* Geometry of every item of the tree */
+	LWHRTREE *tree;
+	int geodetic;
+	SPHEROID spheroid;
+	double min_radius; /* Smallest radius of curvature of the spheroid */
+	LWKNN_CAP *caps;   /* Geodetic only, one per tree node */
+	void **exact;      /* RECT_NODE or CIRC_NODE of every item, on demand */
+};
+
+/* Queue entry, level -1 for items with their exact distance */
+typedef struct
+{
+	double distance;
+	uint64_t node;
+	int32_t level;
+} LWKNN_ENTRY;
+
+typedef struct
+{
+	LWKNN_ENTRY *entries;
+	size_t size;
+	size_t capacity;
+} LWKNN_QUEUE;
+
+static void
+lwknn_queue_push(LWKNN_QUEUE *q, double distance, uint64_t node, int32_t level)
+{
+	size_t i;
+
+	if (q->size == q->capacity)
+	{
+		q->capacity = q->capacity ? 2 * q->capacity : 64;
+		q->entries = lwrealloc(q->entries, q->capacity * sizeof(LWKNN_ENTRY));
+	}
+
+	/* Sift up */
+	i = q->size++;
+	while (i > 0)
+	{
+		size_t parent = (i - 1) / 2;
+		if (q->entries[parent].distance <= distance)
+			break;
+		q->entries[i] = q->entries[parent];
+		i = parent;
+	}
+	q->entries[i].distance = distance;
+	q->entries[i].node = node;
+	q->entries[i].level = level;
+}
+
+static LWKNN_ENTRY
+lwknn_queue_pop(LWKNN_QUEUE *q)
+{
+	LWKNN_ENTRY top = q->entries[0];
+	LWKNN_ENTRY last = q->entries[--q->size];
+	size_t i = 0;
+
+	/* Sift the last entry down from the root */
+	for (;;)
+	{
+		size_t child = 2 * i + 1;
+		if (child >= q->size)
+			break;
+		if (child + 1 < q->size && q->entries[child + 1].distance < q->entries[child].distance)
+			child++;
+		if (last.distance <= q->entries[child].distance)
+			break;
+		q->entries[i] = q->entries[child];
+		i = child;
+	}
+	if (q->size)
+		q->entries[i] = last;
+	return top;
+}
+
+/* Angle between two unit vectors, accurate for small angles too */
+static inline double
+lwknn_angle(const POINT3D *a, const POINT3D *b)
+{
+	double cx = a->y * b->z - a->z * b->y;
+	double cy = a->z * b->x - a->x * b->z;
+	double cz = a->x * b->y - a->y * b->x;
+	double dot = a->x * b->x + a->y * b->y + a->z * b->z;
+	return atan2(sqrt(cx * cx + cy * cy + cz * cz), dot);
+}
+
+/* Center the cap on sum, or give up on anything smaller than the sphere */
+static inline int
+lwknn_cap_center(LWKNN_CAP *cap, const POINT3D *sum)
+{
+	double len = sqrt(sum->x * sum->x + sum->y * sum->y + sum->z * sum->z);
+	if (len < FP_TOLERANCE)
+	{
+		cap->center.x = 1.0;
+		cap->center.y = cap->center.z = 0.0;
+		cap->radius = M_PI;
+		return LW_FAILURE;
+	}
+	cap->center.x = sum->x / len;
+	cap->center.y = sum->y / len;
+	cap->center.z = sum->z / len;
+	cap->radius = 0.0;
+	return LW_SUCCESS;
+}
+
+/*
+* Cap around the vertices of a geometry. Great circle edges between points
+* of a cap stay in it as long as it is smaller than a hemisphere, larger
+* ones are widened to the whole sphere.
+*/
+static void
+lwknn_cap_from_lwgeom(const LWGEOM *geom, LWKNN_CAP *cap)
+{
+	LWPOINTITERATOR *it;
+	POINT3D sum = {0.0, 0.0, 0.0}, p;
+	POINT4D pt;
+	POINT2D ll;
+
+	it = lwpointiterator_create(geom);
+	while (lwpointiterator_next(it, &pt))
+	{
+		ll.x = pt.x;
+		ll.y = pt.y;
+		ll2cart(&ll, &p);
+		sum.x += p.x;
+		sum.y += p.y;
+		sum.z += p.z;
+	}
+	lwpointiterator_destroy(it);
+
+	if (lwknn_cap_center(cap, &sum) == LW_FAILURE)
+		return;
+
+	it = lwpointiterator_create(geom);
+	while (lwpointiterator_next(it, &pt))
+	{
+		double a;
+		ll.x = pt.x;
+		ll.y = pt.y;
+		ll2cart(&ll, &p);
+		a = lwknn_angle(&cap->center, &p);
+		if (a > cap->radius)
+			cap->radius = a;
+	}
+	lwpointiterator_destroy(it);
+
+	if (cap->radius >= M_PI_2)
+		cap->radius = M_PI;
+}
+
+/* Caps of the leaves from their geometry, then level by level up to the root */
+static void
+lwknn_caps_build(LWKNN *knn)
+{
+	const LWHRTREE *tree = knn->tree;
+	uint64_t i, j;
+	uint32_t level;
+
+	knn->caps = lwalloc(tree->num_nodes * sizeof(LWKNN_CAP));
+
+	for (i = tree->level_bounds[0][0]; i < tree->level_bounds[0][1]; i++)
+		lwknn_cap_from_lwgeom(knn->geoms[knn->ids[tree->nodes[i].offset]], &knn->caps[i]);
+
+	for (level = 1; level < tree->num_levels; level++)
+	{
+		uint64_t child_end = tree->level_bounds[level - 1][1];
+		for (i = tree->level_bounds[level][0]; i < tree->level_bounds[level][1]; i++)
+		{
+			LWKNN_CAP *cap = &knn->caps[i];
+			uint64_t first = tree->nodes[i].offset;
+			uint64_t last = first + tree->node_size < child_end ? first + tree->node_size : child_end;
+			POINT3D sum = {0.0, 0.0, 0.0};
+
+			for (j = first; j < last; j++)
+			{
+				sum.x += knn->caps[j].center.x;
+				sum.y += knn->caps[j].center.y;
+				sum.z += knn->caps[j].center.z;
+			}
+			if (lwknn_cap_center(cap, &sum) == LW_FAILURE)
+				continue;
+			for (j = first; j < last; j++)
+			{
+				double r = lwknn_angle(&cap->center, &knn->caps[j].center) + knn->caps[j].radius;
+				if (r > cap->radius)
+					cap->radius = r;
+			}
+			if (cap->radius > M_PI)
+				cap->radius = M_PI;
+		}
+	}
+}
+
+static LWKNN *
+lwknn_create_internal(const LWGEOM **geoms, uint32_t ngeoms, const SPHEROID *spheroid)
+{
+	LWKNN *knn = lwalloc(sizeof(LWKNN));
+	GBOX *boxes = lwalloc((ngeoms ? ngeoms : 1) * sizeof(GBOX));
+	uint32_t i, n = 0;
+
+	memset(knn, 0, sizeof(LWKNN));
+	knn->geoms = geoms;
+	knn->ngeoms = ngeoms;
+	knn->ids = lwalloc((ngeoms ? ngeoms : 1) * sizeof(uint32_t));
+
+	for (i = 0; i < ngeoms; i++)
+	{
+		if (!geoms[i] || lwgeom_is_empty(geoms[i]))
+			continue;
+		if (lwgeom_calculate_gbox_cartesian(geoms[i], &boxes[n]) == LW_FAILURE)
+			continue;
+		knn->ids[n++] = i;
+	}
+
+	/* Items are grouped by their coordinate boxes, geodetic or not */
+	knn->tree = lwhrtree_create(boxes, n, 0);
+	lwfree(boxes);
+
+	if (spheroid)
+	{
+		knn->geodetic = LW_TRUE;
+		knn->spheroid = *spheroid;
+		/* Meridian radius at the equator, b^2/a, no geodesic is shorter */
+		knn->min_radius = spheroid->b * spheroid->b / spheroid->a;
+		if (knn->tree)
+			lwknn_caps_build(knn);
+	}
+
+	knn->exact = lwalloc((n ? n : 1) * sizeof(void *));
+	memset(knn->exact, 0, (n ? n : 1) * sizeof(void *));
+	return knn;
+}
+
+LWKNN *
+lwknn_create(const LWGEOM **geoms, uint32_t ngeoms)
+{
+	return lwknn_create_internal(geoms, ngeoms, NULL);
+}
+
+LWKNN *
+lwknn_create_geodetic(const LWGEOM **geoms, uint32_t ngeoms, const SPHEROID *spheroid)
+{
+	if (!spheroid)
+	{
+		lwerror("%s: spheroid is required", __func__);
+		return NULL;
+	}
+	return lwknn_create_internal(geoms, ngeoms, spheroid);
+}
+
+void
+lwknn_free(LWKNN *knn)
+{
+	uint64_t i;
+
+	if (!knn)
+		return;
+	if (knn->tree)
+	{
+		for (i = 0; i < knn->tree->num_items; i++)
+		{
+			if (!knn->exact[i])
+				continue;
+			if (knn->geodetic)
+				circ_tree_free(knn->exact[i]);
+			else
+				rect_tree_free(knn->exact[i]);
+		}
+	}
+	lwhrtree_free(knn->tree);
+	lwfree(knn->caps);
+	lwfree(knn->exact);
+	lwfree(knn->ids);
+	lwfree(knn);
+}
+
+/* Lower bound of the distance from the query to anything under a node */
+static inline double
+lwknn_node_distance(const LWKNN *knn, uint64_t node, RECT_NODE *qrect, const LWKNN_CAP *qcap)
+{
+	if (knn->geodetic)
+	{
+		const LWKNN_CAP *cap = &knn->caps[node];
+		double a = lwknn_angle(&qcap->center, &cap->center) - cap->radius - qcap->radius;
+		return a > 0.0 ? a * knn->min_radius : 0.0;
+	}
+	else
+	{
+		const LWHRTREE_NODE *n = &knn->tree->nodes[node];
+		RECT_NODE box;
+		box.xmin = n->xmin;
+		box.ymin = n->ymin;
+		box.xmax = n->xmax;
+		box.ymax = n->ymax;
+		return rect_node_min_distance(qrect, &box);
+	}
+}
+
+/*
+* Exact distance to an item. Its tree is kept for later searches, built in
+* a heap scope so an active arena does not reclaim it.
+*/
+static double
+lwknn_item_distance(LWKNN *knn, uint64_t item, void *qtree)
+{
+	const LWGEOM *geom = knn->geoms[knn->ids[item]];
+
+	if (!knn->exact[item])
+	{
+		LWARENA_SCOPE scope;
+		lwarena_push(NULL, &scope);
+		if (knn->geodetic)
+			knn->exact[item] = lwgeom_calculate_circ_tree(geom);
+		else
+			knn->exact[item] = rect_tree_from_lwgeom(geom);
+		lwarena_pop(&scope);
+	}
+
+	if (knn->geodetic)
+		return circ_tree_distance_spheroid(qtree, knn->exact[item], &knn->spheroid, 0.0);
+	else
+		return rect_tree_distance_tree(qtree, knn->exact[item], 0.0);
+}
+
+uint32_t
+lwknn_search(LWKNN *knn, const LWGEOM *query, uint32_t k, double max_distance, LWKNN_RESULT *results)
+{
+	LWKNN_QUEUE queue = {NULL, 0, 0};
+	LWKNN_CAP qcap;
+	void *qtree;
+	uint32_t found = 0;
+	const LWHRTREE *tree;
+
+	if (!knn || !knn->tree || !query || !k || lwgeom_is_empty(query))
+		return 0;
+	tree = knn->tree;
+
+	if (knn->geodetic)
+	{
+		qtree = lwgeom_calculate_circ_tree(query);
+		lwknn_cap_from_lwgeom(query, &qcap);
+	}
+	else
+	{
+		qtree = rect_tree_from_lwgeom(query);
+	}
+	if (!qtree)
+		return 0;
+
+	lwknn_queue_push(&queue, lwknn_node_distance(knn, 0, qtree, &qcap), 0, tree->num_levels - 1);
+
+	while (queue.size && found < k)
+	{
+		LWKNN_ENTRY e = lwknn_queue_pop(&queue);
+		const LWHRTREE_NODE *node = &tree->nodes[e.node];
+
+		/* Everything left is further away */
+		if (max_distance >= 0.0 && e.distance > max_distance)
+			break;
+
+		if (e.level < 0)
+		{
+			/* Nothing left in the queue can be closer */
+			results[found].item = knn->ids[node->offset];
+			results[found].distance = e.distance;
+			found++;
+		}
+		else if (e.level == 0)
+		{
+			/* Back in the queue with the exact distance */
+			lwknn_queue_push(&queue, lwknn_item_distance(knn, node->offset, qtree), e.node, -1);
+		}
+		else
+		{
+			uint64_t i, first = node->offset;
+			uint64_t end = tree->level_bounds[e.level - 1][1];
+			uint64_t last = first + tree->node_size < end ? first + tree->node_size : end;
+			for (i = first; i < last; i++)
+				lwknn_queue_push(&queue, lwknn_node_distance(knn, i, qtree, &qcap), i, e.level - 1);
+		}
+	}
+
+	lwfree(queue.entries);
+	if (knn->geodetic)
+		circ_tree_free(qtree);
+	else
+		rect_tree_free(qtree);
+	return found;
+}
@@ -0,0 +1,70 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#ifndef _LWKNN_H
+#define _LWKNN_H 1
+
+#include "liblwgeom.h"
+
+/*
+ * k nearest neighbours over a fixed set of geometries.
+ *
+ * The set is indexed by a packed Hilbert R-tree (see lwhrtree.h) that is
+ * walked best first: a priority queue holds the tree nodes and the
+ * candidates ordered by a lower bound of their distance to the query,
+ * and a candidate only gets its exact distance, through rect trees or
+ * circ trees, when it reaches the head of the queue.
+ */
+
+typedef struct LWKNN LWKNN;
+
+typedef struct
+{
+	uint32_t item;   /* Index of the geometry in the indexed array */
+	double distance; /* Cartesian units, or meters on the spheroid */
+} LWKNN_RESULT;
+
+/**
+* Index an array of geometries for cartesian kNN searches. The geometries
+* are not copied and must outlive the index. Empty ones are never found.
+*/
+LWKNN *lwknn_create(const LWGEOM **geoms, uint32_t ngeoms);
+
+/**
+* Same, for geodetic searches on the given spheroid. Coordinates are
+* longitude/latitude degrees.
+*/
+LWKNN *lwknn_create_geodetic(const LWGEOM **geoms, uint32_t ngeoms, const SPHEROID *spheroid);
+
+void lwknn_free(LWKNN *knn);
+
+/**
+* Find the (at most) k geometries nearest to query, closer than
+* max_distance unless it is negative. results must hold k entries and is
+* filled in order of increasing distance. Returns the number found.
+*
+* Exact trees of the candidates are built on demand and kept in the
+* index, so repeated searches get cheaper. That makes a search a write to
+* the index: concurrent lwknn_search calls on the same LWKNN are not safe
+* and must be serialized by the caller, or use one index per thread.
+*/
+uint32_t lwknn_search(LWKNN *knn, const LWGEOM *query, uint32_t k, double max_distance, LWKNN_RESULT *results);
+
+#endif /* _LWKNN_H */
@@ -0,0 +1,936 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "liblwgeom_internal.h"
+#include "lwgeom_log.h"
+#include "bytebuffer.h"
+#include "lwhrtree.h"
+
+/*
+ * FlatGeobuf encoder.
+ *
+ * A file is the magic bytes, the Header, the packed Hilbert R-tree of
+ * the feature boxes and the Features, the Header and each Feature being
+ * a size-prefixed flatbuffer. The index comes before the features and
+ * points at them by byte offset, so the features are kept in memory
+ * until lwflatgeobuf_writer_finish builds the tree and writes them out
+ * in its leaf order.
+ *
+ * The flatbuffers are laid out by hand, front to back: each table comes
+ * after its vtable and before the vectors and tables it points to, which
+ * all start 8 byte aligned within the file. Coordinates are written as
+ * they sit in the point arrays, so 2D arrays are copied in one go, and
+ * read back in place by lwflatgeobuf_query.
+ */
+
+#define FGB_MAGIC_SIZE 8
+static const uint8_t fgb_magic[FGB_MAGIC_SIZE] = {0x66, 0x67, 0x62, 0x03, 0x66, 0x67, 0x62, 0x00};
+
+/* Header fields */
+#define FGB_HEADER_NAME 0
+#define FGB_HEADER_ENVELOPE 1
+#define FGB_HEADER_GEOMETRY_TYPE 2
+#define FGB_HEADER_HAS_Z 3
+#define FGB_HEADER_HAS_M 4
+#define FGB_HEADER_COLUMNS 7
+#define FGB_HEADER_FEATURES_COUNT 8
+#define FGB_HEADER_INDEX_NODE_SIZE 9
+#define FGB_HEADER_CRS 10
+#define FGB_HEADER_NFIELDS 11
+
+/* Column fields */
+#define FGB_COLUMN_NAME 0
+#define FGB_COLUMN_TYPE 1
+#define FGB_COLUMN_NFIELDS 2
+
+/* Crs fields */
+#define FGB_CRS_ORG 0
+#define FGB_CRS_CODE 1
+#define FGB_CRS_NFIELDS 2
+
+/* Geometry fields */
+#define FGB_GEOMETRY_ENDS 0
+#define FGB_GEOMETRY_XY 1
+#define FGB_GEOMETRY_Z 2
+#define FGB_GEOMETRY_M 3
+#define FGB_GEOMETRY_TYPE 6
+#define FGB_GEOMETRY_PARTS 7
+#define FGB_GEOMETRY_NFIELDS 8
+
+/* Feature fields */
+#define FGB_FEATURE_GEOMETRY 0
+#define FGB_FEATURE_PROPERTIES 1
+#define FGB_FEATURE_NFIELDS 2
+
+#define FGB_MAX_FIELDS 11
+
+/* Column types */
+#define FGB_COLUMN_BOOL 2
+#define FGB_COLUMN_LONG 7
+#define FGB_COLUMN_FLOAT 9
+#define FGB_COLUMN_DOUBLE 10
+#define FGB_COLUMN_STRING 11
+#define FGB_COLUMN_JSON 12
+
+#define FGB_MAX_COLUMNS UINT16_MAX
+
+/* FlatGeobuf geometry types, by liblwgeom type */
+static const uint8_t fgb_geometry_type[NUMTYPES] = {
+	0,  /* unknown */
+	1,  /* POINTTYPE */
+	2,  /* LINETYPE */
+	3,  /* POLYGONTYPE */
+	4,  /* MULTIPOINTTYPE */
+	5,  /* MULTILINETYPE */
+	6,  /* MULTIPOLYGONTYPE */
+	7,  /* COLLECTIONTYPE */
+	8,  /* CIRCSTRINGTYPE */
+	9,  /* COMPOUNDTYPE */
+	10, /* CURVEPOLYTYPE */
+	11, /* MULTICURVETYPE */
+	12, /* MULTISURFACETYPE */
+	15, /* POLYHEDRALSURFACETYPE */
+	17, /* TRIANGLETYPE */
+	16  /* TINTYPE */
+};
+
+typedef struct
+{
+	char *name;
+	LWPROPERTY_TYPE type;
+} FGB_COLUMN;
+
+struct LWFLATGEOBUF_WRITER
+{
+	lwflatgeobuf_sink sink;
+	void *data;
+	char *name;
+	int32_t srid;
+	int has_z;
+	int has_m;
+	uint16_t index_node_size;
+
+	FGB_COLUMN *columns;
+	size_t ncolumns;
+	size_t maxcolumns;
+
+	/* Geometry type of all the features, 0 once they differ */
+	uint8_t geometry_type;
+	int has_geometry_type;
+
+	/* Features, one after the other, and their offsets and boxes */
+	bytebuffer_t features;
+	uint64_t *offsets;
+	GBOX *boxes;
+	uint64_t nfeatures;
+	size_t maxfeatures;
+
+	/* Properties of the feature being written */
+	bytebuffer_t properties;
+};
+
+static void
+fgb_reserve(void **mem, size_t *max, size_t needed, size_t elem_size)
+{
+	size_t size = *max ? *max : 16;
+	if (needed <= *max)
+		return;
+	while (size < needed)
+		size *= 2;
+	*mem = lwrealloc(*mem, size * elem_size);
+	*max = size;
+}
+
+/**********************************************************************
+ * Little endian scalars
+ */
+
+static inline void
+fgb_put_u16(uint8_t *p, uint16_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void
+fgb_put_u32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	p[2] = (uint8_t)(v >> 16);
+	p[3] = (uint8_t)(v >> 24);
+}
+
+static inline void
+fgb_put_u64(uint8_t *p, uint64_t v)
+{
+	fgb_put_u32(p, (uint32_t)v);
+	fgb_put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline void
+fgb_put_double(uint8_t *p, double d)
+{
+	uint64_t v;
+	memcpy(&v, &d, sizeof(double));
+	fgb_put_u64(p, v);
+}
+
+/**********************************************************************
+ * Flatbuffers, built at absolute positions of a bytebuffer
+ */
+
+static inline uint8_t *
+fgb_at(bytebuffer_t *b, size_t pos)
+{
+	return b->buf_start + pos;
+}
+
+/* Append size zero bytes, returns where they start */
+static size_t
+fgb_zeros(bytebuffer_t *b, size_t size)
+{
+	static const uint8_t zeros[64] = {0};
+	size_t pos = bytebuffer_getlength(b);
+	while (size)
+	{
+		size_t n = size < sizeof(zeros) ? size : sizeof(zeros);
+		bytebuffer_append_bulk(b, zeros, n);
+		size -= n;
+	}
+	return pos;
+}
+
+static inline size_t
+fgb_align(size_t pos, size_t align)
+{
+	return (pos + align - 1) & ~(align - 1);
+}
+
+/*
+ * A vtable and its table, fields of sizes[i] bytes, 0 for absent ones.
+ * Writes the position of each field to pos[i] and returns the table's.
+ */
+static size_t
+fgb_table(bytebuffer_t *b, uint32_t nfields, const uint8_t *sizes, size_t *pos)
+{
+	uint16_t offsets[FGB_MAX_FIELDS];
+	size_t table_size = 4, align = 4, vtable_size, vtable, table;
+	uint32_t i, used = 0;
+	uint8_t size;
+
+	/* Largest fields first, so that none needs padding but the first */
+	for (size = 8; size; size /= 2)
+	{
+		for (i = 0; i < nfields; i++)
+		{
+			if (sizes[i] != size)
+				continue;
+			table_size = fgb_align(table_size, size);
+			offsets[i] = (uint16_t)table_size;
+			table_size += size;
+			if (size > align)
+				align = size;
+		}
+	}
+	for (i = 0; i < nfields; i++)
+	{
+		if (!sizes[i])
+			offsets[i] = 0;
+		else
+			used = i + 1;
+	}
+
+	vtable_size = 4 + 2 * used;
+	table = fgb_align(bytebuffer_getlength(b) + vtable_size, align);
+	vtable = table - vtable_size;
+	fgb_zeros(b, table + table_size - bytebuffer_getlength(b));
+
+	fgb_put_u16(fgb_at(b, vtable), (uint16_t)vtable_size);
+	fgb_put_u16(fgb_at(b, vtable + 2), (uint16_t)table_size);
+	for (i = 0; i < used; i++)
+		fgb_put_u16(fgb_at(b, vtable + 4 + 2 * i), offsets[i]);
+	fgb_put_u32(fgb_at(b, table), (uint32_t)(table - vtable));
+
+	for (i = 0; i < nfields; i++)
+		pos[i] = table + offsets[i];
+	return table;
+}
+
+/* Point the offset field at pos to target, which follows it */
+static inline void
+fgb_set_offset(bytebuffer_t *b, size_t pos, size_t target)
+{
+	fgb_put_u32(fgb_at(b, pos), (uint32_t)(target - pos));
+}
+
+/*
+ * Room for a vector of count elements of elem_size bytes, the elements
+ * 8 byte aligned. Returns the position of the vector, its length first.
+ */
+static size_t
+fgb_vector(bytebuffer_t *b, size_t count, size_t elem_size)
+{
+	size_t data = fgb_align(bytebuffer_getlength(b) + 4, 8);
+	fgb_zeros(b, data + count * elem_size - bytebuffer_getlength(b));
+	fgb_put_u32(fgb_at(b, data - 4), (uint32_t)count);
+	return data - 4;
+}
+
+static size_t
+fgb_string(bytebuffer_t *b, const char *str)
+{
+	size_t len = strlen(str);
+	size_t pos = fgb_vector(b, len + 1, 1);
+	memcpy(fgb_at(b, pos + 4), str, len);
+	/* The terminating zero is not part of the length */
+	fgb_put_u32(fgb_at(b, pos), (uint32_t)len);
+	return pos;
+}
+
+/* Start a size-prefixed flatbuffer, returns the position of its root offset */
+static size_t
+fgb_begin(bytebuffer_t *b)
+{
+	return fgb_zeros(b, 8) + 4;
+}
+
+/* Size the flatbuffer started at root, padded to a multiple of 8 bytes */
+static void
+fgb_end(bytebuffer_t *b, size_t root, size_t table)
+{
+	size_t end;
+	fgb_set_offset(b, root, table);
+	end = fgb_align(bytebuffer_getlength(b), 8);
+	fgb_zeros(b, end - bytebuffer_getlength(b));
+	fgb_put_u32(fgb_at(b, root - 4), (uint32_t)(end - root));
+}
+
+/**********************************************************************
+ * Geometries
+ */
+
+typedef struct
+{
+	int has_z;
+	int has_m;
+} FGB_DIMS;
+
+/* Points of arrays pa[0..n), one after the other */
+static size_t
+fgb_npoints(POINTARRAY **pa, uint32_t n)
+{
+	size_t npoints = 0;
+	uint32_t i;
+	for (i = 0; i < n; i++)
+		npoints += pa[i]->npoints;
+	return npoints;
+}
+
+static void
+fgb_write_xy(bytebuffer_t *b, size_t pos, POINTARRAY **pa, uint32_t n)
+{
+	uint8_t *p = fgb_at(b, pos);
+	uint32_t i, j;
+
+	for (i = 0; i < n; i++)
+	{
+		const POINTARRAY *a = pa[i];
+#if ! IS_BIG_ENDIAN
+		if (!FLAGS_GET_Z(a->flags) && !FLAGS_GET_M(a->flags))
+		{
+			size_t size = (size_t)a->npoints * 2 * sizeof(double);
+			if (size)
+				memcpy(p, a->serialized_pointlist, size);
+			p += size;
+			continue;
+		}
+#endif
+		for (j = 0; j < a->npoints; j++)
+		{
+			const POINT2D *pt = getPoint2d_cp(a, j);
+			fgb_put_double(p, pt->x);
+			fgb_put_double(p + 8, pt->y);
+			p += 16;
+		}
+	}
+}
+
+/* Z or M ordinates of the arrays, zero where they have none */
+static void
+fgb_write_ordinate(bytebuffer_t *b, size_t pos, POINTARRAY **pa, uint32_t n, int m)
+{
+	uint8_t *p = fgb_at(b, pos);
+	uint32_t i, j;
+
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < pa[i]->npoints; j++)
+		{
+			POINT4D pt;
+			getPoint4d_p(pa[i], j, &pt);
+			fgb_put_double(p, m ? pt.m : pt.z);
+			p += 8;
+		}
+	}
+}
+
+static size_t fgb_write_geometry(bytebuffer_t *b, const FGB_DIMS *dims, const LWGEOM *geom);
+
+/*
+ * Geometry table of the point arrays, their ends listed when with_ends
+ * is set, or of the parts when pa is NULL.
+ */
+static size_t
+fgb_write_geometry_table(bytebuffer_t *b, const FGB_DIMS *dims, uint8_t type,
+			 POINTARRAY **pa, uint32_t npa, int with_ends,
+			 LWGEOM **parts, uint32_t nparts)
+{
+	uint8_t sizes[FGB_GEOMETRY_NFIELDS] = {0};
+	size_t pos[FGB_GEOMETRY_NFIELDS];
+	size_t npoints = pa ? fgb_npoints(pa, npa) : 0;
+	size_t table, v;
+	uint32_t i;
+
+	if (npoints > UINT32_MAX)
+	{
+		lwerror("%s: too many points", __func__);
+		return 0;
+	}
+	if (with_ends && npa > 1)
+		sizes[FGB_GEOMETRY_ENDS] = 4;
+	if (npoints)
+	{
+		sizes[FGB_GEOMETRY_XY] = 4;
+		if (dims->has_z)
+			sizes[FGB_GEOMETRY_Z] = 4;
+		if (dims->has_m)
+			sizes[FGB_GEOMETRY_M] = 4;
+	}
+	if (nparts)
+		sizes[FGB_GEOMETRY_PARTS] = 4;
+	sizes[FGB_GEOMETRY_TYPE] = 1;
+
+	table = fgb_table(b, FGB_GEOMETRY_NFIELDS, sizes, pos);
+	*fgb_at(b, pos[FGB_GEOMETRY_TYPE]) = type;
+
+	if (sizes[FGB_GEOMETRY_ENDS])
+	{
+		uint32_t end = 0;
+		v = fgb_vector(b, npa, sizeof(uint32_t));
+		for (i = 0; i < npa; i++)
+		{
+			end += pa[i]->npoints;
+			fgb_put_u32(fgb_at(b, v + 4 + 4 * i), end);
+		}
+		fgb_set_offset(b, pos[FGB_GEOMETRY_ENDS], v);
+	}
+	if (sizes[FGB_GEOMETRY_XY])
+	{
+		v = fgb_vector(b, 2 * npoints, sizeof(double));
+		fgb_write_xy(b, v + 4, pa, npa);
+		fgb_set_offset(b, pos[FGB_GEOMETRY_XY], v);
+	}
+	if (sizes[FGB_GEOMETRY_Z])
+	{
+		v = fgb_vector(b, npoints, sizeof(double));
+		fgb_write_ordinate(b, v + 4, pa, npa, 0);
+		fgb_set_offset(b, pos[FGB_GEOMETRY_Z], v);
+	}
+	if (sizes[FGB_GEOMETRY_M])
+	{
+		v = fgb_vector(b, npoints, sizeof(double));
+		fgb_write_ordinate(b, v + 4, pa, npa, 1);
+		fgb_set_offset(b, pos[FGB_GEOMETRY_M], v);
+	}
+	if (sizes[FGB_GEOMETRY_PARTS])
+	{
+		v = fgb_vector(b, nparts, sizeof(uint32_t));
+		fgb_set_offset(b, pos[FGB_GEOMETRY_PARTS], v);
+		for (i = 0; i < nparts; i++)
+		{
+			size_t part = fgb_write_geometry(b, dims, parts[i]);
+			if (!part)
+				return 0;
+			fgb_set_offset(b, v + 4 + 4 * i, part);
+		}
+	}
+	return table;
+}
+
+/*
+ * Simple geometries keep their coordinates in the table, lines and rings
+ * told apart by ends. The others are made of parts.
+ */
+static size_t
+fgb_write_geometry(bytebuffer_t *b, const FGB_DIMS *dims, const LWGEOM *geom)
+{
+	uint8_t type = fgb_geometry_type[geom->type];
+	POINTARRAY **pa;
+	size_t table;
+	uint32_t i;
+
+	switch (geom->type)
+	{
+	case POINTTYPE:
+		return fgb_write_geometry_table(b, dims, type, &((LWPOINT *)geom)->point, 1, LW_FALSE, NULL, 0);
+	case LINETYPE:
+	case CIRCSTRINGTYPE:
+	case TRIANGLETYPE:
+		return fgb_write_geometry_table(b, dims, type, &((LWLINE *)geom)->points, 1, LW_FALSE, NULL, 0);
+	case POLYGONTYPE:
+	{
+		LWPOLY *poly = (LWPOLY *)geom;
+		return fgb_write_geometry_table(b, dims, type, poly->rings, poly->nrings, LW_TRUE, NULL, 0);
+	}
+	case MULTIPOINTTYPE:
+	case MULTILINETYPE:
+	{
+		LWCOLLECTION *col = (LWCOLLECTION *)geom;
+		if (!col->ngeoms)
+			return fgb_write_geometry_table(b, dims, type, NULL, 0, LW_FALSE, NULL, 0);
+		/* Points and lines share the layout of their point array */
+		pa = lwalloc(col->ngeoms * sizeof(POINTARRAY *));
+		for (i = 0; i < col->ngeoms; i++)
+			pa[i] = ((LWLINE *)col->geoms[i])->points;
+		table = fgb_write_geometry_table(b, dims, type, pa, col->ngeoms, geom->type == MULTILINETYPE, NULL, 0);
+		lwfree(pa);
+		return table;
+	}
+	case MULTIPOLYGONTYPE:
+	case COLLECTIONTYPE:
+	case COMPOUNDTYPE:
+	case CURVEPOLYTYPE:
+	case MULTICURVETYPE:
+	case MULTISURFACETYPE:
+	case POLYHEDRALSURFACETYPE:
+	case TINTYPE:
+	{
+		LWCOLLECTION *col = (LWCOLLECTION *)geom;
+		return fgb_write_geometry_table(b, dims, type, NULL, 0, LW_FALSE, col->geoms, col->ngeoms);
+	}
+	default:
+		lwerror("%s: unsupported geometry type: %s", __func__, lwtype_name(geom->type));
+		return 0;
+	}
+}
+
+/**********************************************************************
+ * Writer
+ */
+
+LWFLATGEOBUF_WRITER *
+lwflatgeobuf_writer_create(lwflatgeobuf_sink sink, void *data, const char *name, int32_t srid,
+			   int has_z, int has_m, uint16_t index_node_size)
+{
+	LWFLATGEOBUF_WRITER *w;
+
+	if (index_node_size == 1)
+	{
+		lwerror("%s: index node size must be at least 2", __func__);
+		return NULL;
+	}
+
+	w = lwalloc(sizeof(LWFLATGEOBUF_WRITER));
+	memset(w, 0, sizeof(LWFLATGEOBUF_WRITER));
+	w->sink = sink;
+	w->data = data;
+	w->name = name ? lwstrdup(name) : NULL;
+	w->srid = srid;
+	w->has_z = has_z;
+	w->has_m = has_m;
+	w->index_node_size = index_node_size;
+	bytebuffer_init_with_size(&w->features, BYTEBUFFER_STARTSIZE);
+	bytebuffer_init_with_size(&w->properties, BYTEBUFFER_STARTSIZE);
+	return w;
+}
+
+static uint8_t
+fgb_column_type(LWPROPERTY_TYPE type)
+{
+	switch (type)
+	{
+	case LWPROPERTY_FLOAT:
+		return FGB_COLUMN_FLOAT;
+	case LWPROPERTY_DOUBLE:
+		return FGB_COLUMN_DOUBLE;
+	case LWPROPERTY_INT:
+		return FGB_COLUMN_LONG;
+	case LWPROPERTY_BOOL:
+		return FGB_COLUMN_BOOL;
+	case LWPROPERTY_JSON:
+		return FGB_COLUMN_JSON;
+	case LWPROPERTY_STRING:
+	default:
+		return FGB_COLUMN_STRING;
+	}
+}
+
+/* Index of the column of a property, added if new, -1 if it does not fit */
+static int32_t
+fgb_writer_column(LWFLATGEOBUF_WRITER *w, const LWPROPERTY *p, uint32_t hint)
+{
+	size_t i;
+
+	/* Features mostly list the same columns in the same order */
+	if (hint < w->ncolumns && strcmp(w->columns[hint].name, p->key) == 0)
+		i = hint;
+	else
+	{
+		for (i = 0; i < w->ncolumns; i++)
+		{
+			if (strcmp(w->columns[i].name, p->key) == 0)
+				break;
+		}
+	}
+
+	if (i < w->ncolumns)
+	{
+		if (fgb_column_type(w->columns[i].type) != fgb_column_type(p->type))
+		{
+			lwerror("%s: property \"%s\" changes type", __func__, p->key);
+			return -1;
+		}
+		return (int32_t)i;
+	}
+
+	if (w->ncolumns == FGB_MAX_COLUMNS)
+	{
+		lwerror("%s: more than %d properties", __func__, FGB_MAX_COLUMNS);
+		return -1;
+	}
+	fgb_reserve((void **)&w->columns, &w->maxcolumns, w->ncolumns + 1, sizeof(FGB_COLUMN));
+	w->columns[w->ncolumns].name = lwstrdup(p->key);
+	w->columns[w->ncolumns].type = p->type;
+	return (int32_t)w->ncolumns++;
+}
+
+/* Column index and value of each property, into w->properties */
+static int
+fgb_writer_properties(LWFLATGEOBUF_WRITER *w, const LWPROPERTY *properties, uint32_t nproperties)
+{
+	bytebuffer_t *b = &w->properties;
+	uint8_t scalar[8];
+	uint32_t i;
+
+	bytebuffer_clear(b);
+	for (i = 0; i < nproperties; i++)
+	{
+		const LWPROPERTY *p = &properties[i];
+		int32_t column;
+
+		if (!p->key)
+			continue;
+		if ((p->type == LWPROPERTY_STRING || p->type == LWPROPERTY_JSON) && !p->string_value)
+			continue;
+		column = fgb_writer_column(w, p, i);
+		if (column < 0)
+			return LW_FAILURE;
+
+		fgb_put_u16(scalar, (uint16_t)column);
+		bytebuffer_append_bulk(b, scalar, 2);
+		switch (p->type)
+		{
+		case LWPROPERTY_FLOAT:
+		{
+			float f = (float)p->double_value;
+			uint32_t v;
+			memcpy(&v, &f, sizeof(float));
+			fgb_put_u32(scalar, v);
+			bytebuffer_append_bulk(b, scalar, 4);
+			break;
+		}
+		case LWPROPERTY_DOUBLE:
+			fgb_put_double(scalar, p->double_value);
+			bytebuffer_append_bulk(b, scalar, 8);
+			break;
+		case LWPROPERTY_INT:
+			fgb_put_u64(scalar, (uint64_t)p->int_value);
+			bytebuffer_append_bulk(b, scalar, 8);
+			break;
+		case LWPROPERTY_BOOL:
+			bytebuffer_append_byte(b, p->int_value ? 1 : 0);
+			break;
+		case LWPROPERTY_STRING:
+		case LWPROPERTY_JSON:
+		default:
+		{
+			size_t len = strlen(p->string_value);
+			if (len > UINT32_MAX)
+			{
+				lwerror("%s: property \"%s\" is too long", __func__, p->key);
+				return LW_FAILURE;
+			}
+			fgb_put_u32(scalar, (uint32_t)len);
+			bytebuffer_append_bulk(b, scalar, 4);
+			bytebuffer_append_bulk(b, p->string_value, len);
+			break;
+		}
+		}
+	}
+	return LW_SUCCESS;
+}
+
+int
+lwflatgeobuf_writer_feature(LWFLATGEOBUF_WRITER *w, const LWGEOM *geom, const LWPROPERTY *properties, uint32_t nproperties)
+{
+	bytebuffer_t *b = &w->features;
+	uint8_t sizes[FGB_FEATURE_NFIELDS] = {0};
+	size_t pos[FGB_FEATURE_NFIELDS];
+	size_t start = bytebuffer_getlength(b);
+	size_t root, table, nprops;
+	FGB_DIMS dims = {w->has_z, w->has_m};
+	GBOX *box;
+
+	if (!w->sink)
+		return LW_FAILURE;
+	if (fgb_writer_properties(w, properties, nproperties) == LW_FAILURE)
+		return LW_FAILURE;
+	nprops = bytebuffer_getlength(&w->properties);
+
+	if (geom)
+		sizes[FGB_FEATURE_GEOMETRY] = 4;
+	if (nprops)
+		sizes[FGB_FEATURE_PROPERTIES] = 4;
+
+	root = fgb_begin(b);
+	table = fgb_table(b, FGB_FEATURE_NFIELDS, sizes, pos);
+	if (geom)
+	{
+		size_t g = fgb_write_geometry(b, &dims, geom);
+		if (!g)
+		{
+			/* Drop what was written of the feature */
+			b->writecursor = b->buf_start + start;
+			return LW_FAILURE;
+		}
+		fgb_set_offset(b, pos[FGB_FEATURE_GEOMETRY], g);
+	}
+	if (nprops)
+	{
+		size_t v = fgb_vector(b, nprops, 1);
+		memcpy(fgb_at(b, v + 4), w->properties.buf_start, nprops);
+		fgb_set_offset(b, pos[FGB_FEATURE_PROPERTIES], v);
+	}
+	fgb_end(b, root, table);
+
+	if (w->nfeatures == w->maxfeatures)
+	{
+		fgb_reserve((void **)&w->offsets, &w->maxfeatures, w->nfeatures + 1, sizeof(uint64_t));
+		w->boxes = lwrealloc(w->boxes, w->maxfeatures * sizeof(GBOX));
+	}
+	w->offsets[w->nfeatures] = start;
+	box = &w->boxes[w->nfeatures];
+	memset(box, 0, sizeof(GBOX));
+	if (!geom || lwgeom_calculate_gbox(geom, box) == LW_FAILURE)
+	{
+		/* Empty features match no query */
+		box->xmin = box->ymin = INFINITY;
+		box->xmax = box->ymax = -INFINITY;
+	}
+	w->nfeatures++;
+
+	if (geom)
+	{
+		uint8_t type = fgb_geometry_type[geom->type];
+		if (!w->has_geometry_type)
+		{
+			w->geometry_type = type;
+			w->has_geometry_type = LW_TRUE;
+		}
+		else if (w->geometry_type != type)
+			w->geometry_type = 0;
+	}
+	return LW_SUCCESS;
+}
+
+static size_t
+fgb_write_header(LWFLATGEOBUF_WRITER *w, bytebuffer_t *b)
+{
+	uint8_t sizes[FGB_HEADER_NFIELDS] = {0};
+	size_t pos[FGB_HEADER_NFIELDS];
+	GBOX extent;
+	int has_extent;
+	size_t root, table, v, i;
+
+	/* Empty features and NaN coordinates left out */
+	extent.xmin = extent.ymin = INFINITY;
+	extent.xmax = extent.ymax = -INFINITY;
+	for (i = 0; i < w->nfeatures; i++)
+	{
+		const GBOX *box = &w->boxes[i];
+		if (box->xmin < extent.xmin) extent.xmin = box->xmin;
+		if (box->ymin < extent.ymin) extent.ymin = box->ymin;
+		if (box->xmax > extent.xmax) extent.xmax = box->xmax;
+		if (box->ymax > extent.ymax) extent.ymax = box->ymax;
+	}
+	has_extent = extent.xmin <= extent.xmax && extent.ymin <= extent.ymax;
+
+	if (w->name)
+		sizes[FGB_HEADER_NAME] = 4;
+	if (has_extent)
+		sizes[FGB_HEADER_ENVELOPE] = 4;
+	sizes[FGB_HEADER_GEOMETRY_TYPE] = 1;
+	sizes[FGB_HEADER_HAS_Z] = 1;
+	sizes[FGB_HEADER_HAS_M] = 1;
+	if (w->ncolumns)
+		sizes[FGB_HEADER_COLUMNS] = 4;
+	sizes[FGB_HEADER_FEATURES_COUNT] = 8;
+	sizes[FGB_HEADER_INDEX_NODE_SIZE] = 2;
+	if (w->srid > 0)
+		sizes[FGB_HEADER_CRS] = 4;
+
+	root = fgb_begin(b);
+	table = fgb_table(b, FGB_HEADER_NFIELDS, sizes, pos);
+	*fgb_at(b, pos[FGB_HEADER_GEOMETRY_TYPE]) = w->geometry_type;
+	*fgb_at(b, pos[FGB_HEADER_HAS_Z]) = w->has_z ? 1 : 0;
+	*fgb_at(b, pos[FGB_HEADER_HAS_M]) = w->has_m ? 1 : 0;
+	fgb_put_u64(fgb_at(b, pos[FGB_HEADER_FEATURES_COUNT]), w->nfeatures);
+	fgb_put_u16(fgb_at(b, pos[FGB_HEADER_INDEX_NODE_SIZE]), w->nfeatures ? w->index_node_size : 0);
+
+	if (w->name)
+		fgb_set_offset(b, pos[FGB_HEADER_NAME], fgb_string(b, w->name));
+	if (has_extent)
+	{
+		v = fgb_vector(b, 4, sizeof(double));
+		fgb_put_double(fgb_at(b, v + 4), extent.xmin);
+		fgb_put_double(fgb_at(b, v + 12), extent.ymin);
+		fgb_put_double(fgb_at(b, v + 20), extent.xmax);
+		fgb_put_double(fgb_at(b, v + 28), extent.ymax);
+		fgb_set_offset(b, pos[FGB_HEADER_ENVELOPE], v);
+	}
+	if (w->ncolumns)
+	{
+		v = fgb_vector(b, w->ncolumns, sizeof(uint32_t));
+		fgb_set_offset(b, pos[FGB_HEADER_COLUMNS], v);
+		for (i = 0; i < w->ncolumns; i++)
+		{
+			uint8_t csizes[FGB_COLUMN_NFIELDS] = {4, 1};
+			size_t cpos[FGB_COLUMN_NFIELDS];
+			size_t column = fgb_table(b, FGB_COLUMN_NFIELDS, csizes, cpos);
+			*fgb_at(b, cpos[FGB_COLUMN_TYPE]) = fgb_column_type(w->columns[i].type);
+			fgb_set_offset(b, cpos[FGB_COLUMN_NAME], fgb_string(b, w->columns[i].name));
+			fgb_set_offset(b, v + 4 + 4 * i, column);
+		}
+	}
+	if (w->srid > 0)
+	{
+		uint8_t csizes[FGB_CRS_NFIELDS] = {4, 4};
+		size_t cpos[FGB_CRS_NFIELDS];
+		size_t crs = fgb_table(b, FGB_CRS_NFIELDS, csizes, cpos);
+		fgb_put_u32(fgb_at(b, cpos[FGB_CRS_CODE]), (uint32_t)w->srid);
+		fgb_set_offset(b, cpos[FGB_CRS_ORG], fgb_string(b, "EPSG"));
+		fgb_set_offset(b, pos[FGB_HEADER_CRS], crs);
+	}
+
+	/* Padded so that the index starts 8 byte aligned after the magic bytes */
+	fgb_end(b, root, table);
+	return bytebuffer_getlength(b);
+}
+
+static inline uint64_t
+fgb_feature_size(const LWFLATGEOBUF_WRITER *w, uint64_t i)
+{
+	uint64_t end = i + 1 < w->nfeatures ? w->offsets[i + 1] : bytebuffer_getlength(&w->features);
+	return end - w->offsets[i];
+}
+
+int
+lwflatgeobuf_writer_finish(LWFLATGEOBUF_WRITER *w)
+{
+	bytebuffer_t header;
+	LWHRTREE *tree = NULL;
+	uint8_t *index = NULL;
+	size_t index_size = 0;
+	int rv = LW_SUCCESS;
+
+	if (!w->sink)
+		return LW_FAILURE;
+
+	if (w->nfeatures && w->index_node_size)
+	{
+		uint64_t i, offset = 0;
+		tree = lwhrtree_create(w->boxes, w->nfeatures, w->index_node_size);
+		if (!tree)
+			return LW_FAILURE;
+		index = lwhrtree_to_buffer(tree, &index_size);
+		/* Leaves point at their feature in the output, in leaf order */
+		for (i = 0; i < w->nfeatures; i++)
+		{
+			uint64_t leaf = tree->level_bounds[0][0] + i;
+			fgb_put_u64(index + leaf * sizeof(LWHRTREE_NODE) + offsetof(LWHRTREE_NODE, offset), offset);
+			offset += fgb_feature_size(w, tree->nodes[leaf].offset);
+		}
+	}
+
+	bytebuffer_init_with_size(&header, BYTEBUFFER_STARTSIZE);
+	fgb_write_header(w, &header);
+
+	rv = w->sink(fgb_magic, FGB_MAGIC_SIZE, w->data);
+	if (rv)
+		rv = w->sink(header.buf_start, bytebuffer_getlength(&header), w->data);
+	if (rv && index_size)
+		rv = w->sink(index, index_size, w->data);
+	if (rv && tree)
+	{
+		uint64_t i;
+		for (i = 0; rv && i < w->nfeatures; i++)
+		{
+			uint64_t item = tree->nodes[tree->level_bounds[0][0] + i].offset;
+			rv = w->sink(w->features.buf_start + w->offsets[item], fgb_feature_size(w, item), w->data);
+		}
+	}
+	else if (rv && w->nfeatures)
+		rv = w->sink(w->features.buf_start, bytebuffer_getlength(&w->features), w->data);
+
+	bytebuffer_destroy_buffer(&header);
+	if (index)
+		lwfree(index);
+	lwhrtree_free(tree);
+
+	/* Written once */
+	w->sink = NULL;
+	return rv ? LW_SUCCESS : LW_FAILURE;
+}
+
+void
+lwflatgeobuf_writer_free(LWFLATGEOBUF_WRITER *w)
+{
+	size_t i;
+
+	if (!w)
+		return;
+	for (i = 0; i < w->ncolumns; i++)
+		lwfree(w->columns[i].name);
+	if (w->columns)
+		lwfree(w->columns);
+	if (w->name)
+		lwfree(w->name);
+	if (w->offsets)
+		lwfree(w->offsets);
+	if (w->boxes)
+		lwfree(w->boxes);
+	bytebuffer_destroy_buffer(&w->features);
+	bytebuffer_destroy_buffer(&w->properties);
+	lwfree(w);
+}
@@ -0,0 +1,621 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "liblwgeom_internal.h"
+#include "lwgeom_log.h"
+#include "varint.h"
+#include "geobuf.pb-c.h"
+
+/*
+ * Geobuf encoder.
+ *
+ * Coordinates are scaled by 10^precision, rounded, and delta-encoded
+ * along each line and ring, the rings leaving out their closing point.
+ * The layout follows the reference JavaScript encoder, so that what is
+ * written here reads back with it.
+ *
+ * The coordinates, lengths and subgeometries of a geometry are written to
+ * arrays sized for it up front, which the protobuf structures point into:
+ * encoding only allocates when those arrays have to grow.
+ */
+
+#define GEOBUF_DEFAULT_DIMENSIONS 2
+#define GEOBUF_DEFAULT_PRECISION 6
+#define GEOBUF_MAX_PRECISION 15
+
+/* Largest scaled coordinate, so that the steps between two still fit 64 bits */
+#define GEOBUF_MAX_COORD 4.6e18
+
+/* Key of a field, wire type 0 for varints and 2 for length delimited */
+#define GEOBUF_TAG(field, wire) ((uint8_t)(((field) << 3) | (wire)))
+
+typedef struct
+{
+	double scale;
+	int precision;
+	uint32_t dims;
+
+	int64_t *coords;
+	size_t ncoords;
+	size_t maxcoords;
+	uint32_t *lengths;
+	size_t nlengths;
+	size_t maxlengths;
+
+	/* Members of geometry collections, and pointers to them */
+	Data__Geometry *geoms;
+	Data__Geometry **pgeoms;
+	size_t ngeoms;
+	size_t maxgeoms;
+} GEOBUF_ENC;
+
+struct LWGEOBUF_WRITER
+{
+	GEOBUF_ENC enc;
+
+	char **keys;
+	size_t nkeys;
+	size_t maxkeys;
+
+	/* Values and property indexes of the current feature */
+	Data__Value *values;
+	Data__Value **pvalues;
+	size_t maxvalues;
+	uint32_t *properties;
+	size_t maxproperties;
+
+	/* Features of the collection, one after the other */
+	uint8_t *body;
+	size_t size;
+	size_t maxsize;
+};
+
+static void
+geobuf_reserve(void **mem, size_t *max, size_t needed, size_t elem_size)
+{
+	size_t size = *max ? *max : 16;
+	if (needed <= *max)
+		return;
+	while (size < needed)
+		size *= 2;
+	*mem = lwrealloc(*mem, size * elem_size);
+	*max = size;
+}
+
+static void
+geobuf_enc_init(GEOBUF_ENC *enc, int precision, int has_z)
+{
+	memset(enc, 0, sizeof(GEOBUF_ENC));
+	if (precision < 0)
+		precision = 0;
+	if (precision > GEOBUF_MAX_PRECISION)
+		precision = GEOBUF_MAX_PRECISION;
+	enc->precision = precision;
+	enc->scale = pow(10.0, precision);
+	enc->dims = has_z ? 3 : 2;
+}
+
+static void
+geobuf_enc_release(GEOBUF_ENC *enc)
+{
+	if (enc->coords)
+		lwfree(enc->coords);
+	if (enc->lengths)
+		lwfree(enc->lengths);
+	if (enc->geoms)
+		lwfree(enc->geoms);
+	if (enc->pgeoms)
+		lwfree(enc->pgeoms);
+}
+
+/* Lengths and collection members a geometry needs at most */
+static void
+geobuf_count_parts(const LWGEOM *geom, size_t *nlengths, size_t *ngeoms)
+{
+	uint32_t i;
+
+	switch (geom->type)
+	{
+	case POLYGONTYPE:
+		*nlengths += ((const LWPOLY *)geom)->nrings;
+		break;
+	case MULTILINETYPE:
+		*nlengths += ((const LWCOLLECTION *)geom)->ngeoms;
+		break;
+	case MULTIPOLYGONTYPE:
+	{
+		const LWCOLLECTION *col = (const LWCOLLECTION *)geom;
+		*nlengths += 1 + col->ngeoms;
+		for (i = 0; i < col->ngeoms; i++)
+			*nlengths += ((const LWPOLY *)col->geoms[i])->nrings;
+		break;
+	}
+	case COLLECTIONTYPE:
+	case TINTYPE:
+	{
+		const LWCOLLECTION *col = (const LWCOLLECTION *)geom;
+		*ngeoms += col->ngeoms;
+		for (i = 0; i < col->ngeoms; i++)
+			geobuf_count_parts(col->geoms[i], nlengths, ngeoms);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+static inline int
+geobuf_round(const GEOBUF_ENC *enc, double d, int64_t *v)
+{
+	d *= enc->scale;
+	/* Also false for NaN */
+	if (!(fabs(d) <= GEOBUF_MAX_COORD))
+		return LW_FAILURE;
+	*v = (int64_t)llround(d);
+	return LW_SUCCESS;
+}
+
+/*
+ * Append npoints points of a point array, as steps from prev, which is
+ * left at the last point.
+ */
+static int
+geobuf_points(GEOBUF_ENC *enc, const POINTARRAY *pa, uint32_t npoints, int64_t *prev)
+{
+	int64_t *c = enc->coords + enc->ncoords;
+	int hasz = FLAGS_GET_Z(pa->flags);
+	uint32_t i, d;
+
+	for (i = 0; i < npoints; i++)
+	{
+		const double *p = (const double *)getPoint_internal(pa, i);
+		int64_t v[3];
+
+		if (!geobuf_round(enc, p[0], &v[0]) || !geobuf_round(enc, p[1], &v[1]) ||
+		    (enc->dims == 3 && !geobuf_round(enc, hasz ? p[2] : 0.0, &v[2])))
+		{
+			lwerror("lwgeom_to_geobuf: coordinate (%g %g) out of range at precision %d",
+				p[0], p[1], enc->precision);
+			return LW_FAILURE;
+		}
+		for (d = 0; d < enc->dims; d++)
+		{
+			*c++ = v[d] - prev[d];
+			prev[d] = v[d];
+		}
+	}
+	enc->ncoords = c - enc->coords;
+	return LW_SUCCESS;
+}
+
+static int
+geobuf_line(GEOBUF_ENC *enc, const POINTARRAY *pa, int closed)
+{
+	int64_t prev[3] = {0, 0, 0};
+	uint32_t npoints = pa->npoints;
+	if (closed && npoints)
+		npoints--;
+	return geobuf_points(enc, pa, npoints, prev);
+}
+
+/* Points written of a ring, without the closing one */
+static inline uint32_t
+geobuf_ring_length(const POINTARRAY *pa)
+{
+	return pa->npoints ? pa->npoints - 1 : 0;
+}
+
+static int geobuf_geometry(GEOBUF_ENC *enc, const LWGEOM *geom, Data__Geometry *g);
+
+static int
+geobuf_collection(GEOBUF_ENC *enc, const LWCOLLECTION *col, Data__Geometry *g)
+{
+	uint32_t i;
+
+	g->type = DATA__GEOMETRY__TYPE__GEOMETRYCOLLECTION;
+	if (!col->ngeoms)
+		return LW_SUCCESS;
+
+	g->n_geometries = col->ngeoms;
+	g->geometries = enc->pgeoms + enc->ngeoms;
+	enc->ngeoms += col->ngeoms;
+	for (i = 0; i < col->ngeoms; i++)
+	{
+		Data__Geometry *member = &enc->geoms[g->geometries - enc->pgeoms + i];
+		g->geometries[i] = member;
+		if (!geobuf_geometry(enc, col->geoms[i], member))
+			return LW_FAILURE;
+	}
+	return LW_SUCCESS;
+}
+
+static int
+geobuf_geometry(GEOBUF_ENC *enc, const LWGEOM *geom, Data__Geometry *g)
+{
+	size_t coords = enc->ncoords;
+	size_t lengths = enc->nlengths;
+	int64_t prev[3] = {0, 0, 0};
+	uint32_t i, j;
+
+	data__geometry__init(g);
+
+	switch (geom->type)
+	{
+	case POINTTYPE:
+	{
+		const LWPOINT *point = (const LWPOINT *)geom;
+		g->type = DATA__GEOMETRY__TYPE__POINT;
+		if (!lwpoint_is_empty(point) && !geobuf_points(enc, point->point, 1, prev))
+			return LW_FAILURE;
+		break;
+	}
+	case LINETYPE:
+		g->type = DATA__GEOMETRY__TYPE__LINESTRING;
+		if (!geobuf_line(enc, ((const LWLINE *)geom)->points, LW_FALSE))
+			return LW_FAILURE;
+		break;
+	case TRIANGLETYPE:
+		g->type = DATA__GEOMETRY__TYPE__POLYGON;
+		if (!geobuf_line(enc, ((const LWTRIANGLE *)geom)->points, LW_TRUE))
+			return LW_FAILURE;
+		break;
+	case POLYGONTYPE:
+	{
+		const LWPOLY *poly = (const LWPOLY *)geom;
+		g->type = DATA__GEOMETRY__TYPE__POLYGON;
+		if (poly->nrings != 1)
+		{
+			for (i = 0; i < poly->nrings; i++)
+				enc->lengths[enc->nlengths++] = geobuf_ring_length(poly->rings[i]);
+		}
+		for (i = 0; i < poly->nrings; i++)
+		{
+			if (!geobuf_line(enc, poly->rings[i], LW_TRUE))
+				return LW_FAILURE;
+		}
+		break;
+	}
+	case MULTIPOINTTYPE:
+	{
+		/* One line through all of the points */
+		const LWMPOINT *mpoint = (const LWMPOINT *)geom;
+		g->type = DATA__GEOMETRY__TYPE__MULTIPOINT;
+		for (i = 0; i < mpoint->ngeoms; i++)
+		{
+			if (!lwpoint_is_empty(mpoint->geoms[i]) && !geobuf_points(enc, mpoint->geoms[i]->point, 1, prev))
+				return LW_FAILURE;
+		}
+		break;
+	}
+	case MULTILINETYPE:
+	{
+		const LWMLINE *mline = (const LWMLINE *)geom;
+		g->type = DATA__GEOMETRY__TYPE__MULTILINESTRING;
+		if (mline->ngeoms != 1)
+		{
+			for (i = 0; i < mline->ngeoms; i++)
+				enc->lengths[enc->nlengths++] = mline->geoms[i]->points->npoints;
+		}
+		for (i = 0; i < mline->ngeoms; i++)
+		{
+			if (!geobuf_line(enc, mline->geoms[i]->points, LW_FALSE))
+				return LW_FAILURE;
+		}
+		break;
+	}
+	case MULTIPOLYGONTYPE:
+	{
+		const LWMPOLY *mpoly = (const LWMPOLY *)geom;
+		g->type = DATA__GEOMETRY__TYPE__MULTIPOLYGON;
+		if (mpoly->ngeoms != 1 || mpoly->geoms[0]->nrings != 1)
+		{
+			enc->lengths[enc->nlengths++] = mpoly->ngeoms;
+			for (i = 0; i < mpoly->ngeoms; i++)
+			{
+				const LWPOLY *poly = mpoly->geoms[i];
+				enc->lengths[enc->nlengths++] = poly->nrings;
+				for (j = 0; j < poly->nrings; j++)
+					enc->lengths[enc->nlengths++] = geobuf_ring_length(poly->rings[j]);
+			}
+		}
+		for (i = 0; i < mpoly->ngeoms; i++)
+		{
+			for (j = 0; j < mpoly->geoms[i]->nrings; j++)
+			{
+				if (!geobuf_line(enc, mpoly->geoms[i]->rings[j], LW_TRUE))
+					return LW_FAILURE;
+			}
+		}
+		break;
+	}
+	case COLLECTIONTYPE:
+	case TINTYPE:
+		return geobuf_collection(enc, (const LWCOLLECTION *)geom, g);
+	default:
+		lwerror("lwgeom_to_geobuf: '%s' geometry type not supported", lwtype_name(geom->type));
+		return LW_FAILURE;
+	}
+
+	if (enc->ncoords > coords)
+	{
+		g->n_coords = enc->ncoords - coords;
+		g->coords = enc->coords + coords;
+	}
+	if (enc->nlengths > lengths)
+	{
+		g->n_lengths = enc->nlengths - lengths;
+		g->lengths = enc->lengths + lengths;
+	}
+	return LW_SUCCESS;
+}
+
+/* Encode a geometry over the arrays of enc, which it resets */
+static int
+geobuf_encode(GEOBUF_ENC *enc, const LWGEOM *geom, Data__Geometry *g)
+{
+	size_t nlengths = 0, ngeoms = 0;
+
+	geobuf_count_parts(geom, &nlengths, &ngeoms);
+	geobuf_reserve((void **)&enc->coords, &enc->maxcoords,
+		       (size_t)lwgeom_count_vertices(geom) * enc->dims, sizeof(int64_t));
+	geobuf_reserve((void **)&enc->lengths, &enc->maxlengths, nlengths, sizeof(uint32_t));
+	if (ngeoms > enc->maxgeoms)
+	{
+		size_t maxgeoms = enc->maxgeoms;
+		geobuf_reserve((void **)&enc->geoms, &enc->maxgeoms, ngeoms, sizeof(Data__Geometry));
+		geobuf_reserve((void **)&enc->pgeoms, &maxgeoms, ngeoms, sizeof(Data__Geometry *));
+	}
+	enc->ncoords = enc->nlengths = enc->ngeoms = 0;
+	return geobuf_geometry(enc, geom, g);
+}
+
+/**
+ * Takes a GEOMETRY and returns its Geobuf representation, with
+ * coordinates to precision decimal digits.
+ */
+lwvarlena_t *
+lwgeom_to_geobuf(const LWGEOM *geom, int precision)
+{
+	GEOBUF_ENC enc;
+	Data data = DATA__INIT;
+	Data__Geometry g;
+	lwvarlena_t *out = NULL;
+	size_t size;
+
+	geobuf_enc_init(&enc, precision, FLAGS_GET_Z(geom->flags));
+	if (geobuf_encode(&enc, geom, &g))
+	{
+		data.has_dimensions = enc.dims != GEOBUF_DEFAULT_DIMENSIONS;
+		data.dimensions = enc.dims;
+		data.has_precision = enc.precision != GEOBUF_DEFAULT_PRECISION;
+		data.precision = enc.precision;
+		data.data_type_case = DATA__DATA_TYPE_GEOMETRY;
+		data.geometry = &g;
+
+		size = data__get_packed_size(&data);
+		out = lwalloc(LWVARHDRSZ + size);
+		LWSIZE_SET(out->size, LWVARHDRSZ + size);
+		data__pack(&data, (uint8_t *)out->data);
+	}
+	geobuf_enc_release(&enc);
+	return out;
+}
+
+/**********************************************************************
+ * FeatureCollection writer
+ */
+
+LWGEOBUF_WRITER *
+lwgeobuf_writer_create(int precision, int has_z)
+{
+	LWGEOBUF_WRITER *w = lwalloc(sizeof(LWGEOBUF_WRITER));
+	memset(w, 0, sizeof(LWGEOBUF_WRITER));
+	geobuf_enc_init(&w->enc, precision, has_z);
+	return w;
+}
+
+/* Index of a key in the collection, added if new */
+static uint32_t
+geobuf_writer_key(LWGEOBUF_WRITER *w, const char *key, uint32_t hint)
+{
+	size_t i;
+
+	/* Features mostly list the same keys in the same order */
+	if (hint < w->nkeys && strcmp(w->keys[hint], key) == 0)
+		return hint;
+	for (i = 0; i < w->nkeys; i++)
+	{
+		if (strcmp(w->keys[i], key) == 0)
+			return i;
+	}
+	geobuf_reserve((void **)&w->keys, &w->maxkeys, w->nkeys + 1, sizeof(char *));
+	w->keys[w->nkeys] = lwstrdup(key);
+	return w->nkeys++;
+}
+
+/* Value of a property, LW_FAILURE if it has none */
+static int
+geobuf_property_value(const LWPROPERTY *p, Data__Value *v)
+{
+	data__value__init(v);
+	switch (p->type)
+	{
+	case LWPROPERTY_STRING:
+		if (!p->string_value)
+			return LW_FAILURE;
+		v->value_type_case = DATA__VALUE__VALUE_TYPE_STRING_VALUE;
+		v->string_value = (char *)p->string_value;
+		break;
+	case LWPROPERTY_JSON:
+		if (!p->string_value)
+			return LW_FAILURE;
+		v->value_type_case = DATA__VALUE__VALUE_TYPE_JSON_VALUE;
+		v->json_value = (char *)p->string_value;
+		break;
+	case LWPROPERTY_FLOAT:
+	case LWPROPERTY_DOUBLE:
+		v->value_type_case = DATA__VALUE__VALUE_TYPE_DOUBLE_VALUE;
+		v->double_value = p->double_value;
+		break;
+	case LWPROPERTY_INT:
+		if (p->int_value >= 0)
+		{
+			v->value_type_case = DATA__VALUE__VALUE_TYPE_POS_INT_VALUE;
+			v->pos_int_value = (uint64_t)p->int_value;
+		}
+		else
+		{
+			/* Magnitude, without overflowing on INT64_MIN */
+			v->value_type_case = DATA__VALUE__VALUE_TYPE_NEG_INT_VALUE;
+			v->neg_int_value = (uint64_t)(-(p->int_value + 1)) + 1;
+		}
+		break;
+	case LWPROPERTY_BOOL:
+		v->value_type_case = DATA__VALUE__VALUE_TYPE_BOOL_VALUE;
+		v->bool_value = p->int_value != 0;
+		break;
+	default:
+		return LW_FAILURE;
+	}
+	return LW_SUCCESS;
+}
+
+int
+lwgeobuf_writer_feature(LWGEOBUF_WRITER *w, const LWGEOM *geom, const LWPROPERTY *properties, uint32_t nproperties)
+{
+	Data__Feature feature = DATA__FEATURE__INIT;
+	Data__Geometry g;
+	LWCOLLECTION *empty = NULL;
+	size_t nvalues = 0, size;
+	uint32_t i;
+	int rv;
+
+	/* Features need a geometry */
+	if (!geom)
+		geom = (LWGEOM *)(empty = lwcollection_construct_empty(COLLECTIONTYPE, SRID_UNKNOWN, 0, 0));
+	rv = geobuf_encode(&w->enc, geom, &g);
+	if (empty)
+		lwcollection_free(empty);
+	if (!rv)
+		return LW_FAILURE;
+	feature.geometry = &g;
+
+	if (nproperties > w->maxvalues)
+	{
+		size_t maxvalues = w->maxvalues;
+		geobuf_reserve((void **)&w->values, &w->maxvalues, nproperties, sizeof(Data__Value));
+		geobuf_reserve((void **)&w->pvalues, &maxvalues, nproperties, sizeof(Data__Value *));
+	}
+	geobuf_reserve((void **)&w->properties, &w->maxproperties, 2 * (size_t)nproperties, sizeof(uint32_t));
+	for (i = 0; i < nproperties; i++)
+	{
+		if (!properties[i].key || !geobuf_property_value(&properties[i], &w->values[nvalues]))
+			continue;
+		w->pvalues[nvalues] = &w->values[nvalues];
+		w->properties[2 * nvalues] = geobuf_writer_key(w, properties[i].key, i);
+		w->properties[2 * nvalues + 1] = nvalues;
+		nvalues++;
+	}
+	if (nvalues)
+	{
+		feature.n_values = nvalues;
+		feature.values = w->pvalues;
+		feature.n_properties = 2 * nvalues;
+		feature.properties = w->properties;
+	}
+
+	/* Field 1 of the collection, length delimited */
+	size = protobuf_c_message_get_packed_size(&feature.base);
+	geobuf_reserve((void **)&w->body, &w->maxsize, w->size + size + 11, 1);
+	w->body[w->size++] = GEOBUF_TAG(1, 2);
+	w->size += varint_u64_encode_buf(size, w->body + w->size);
+	w->size += protobuf_c_message_pack(&feature.base, w->body + w->size);
+	return LW_SUCCESS;
+}
+
+/**
+ * The keys, the dimensions and the precision come before the collection,
+ * which is why the features are only put behind them here.
+ */
+lwvarlena_t *
+lwgeobuf_writer_finish(LWGEOBUF_WRITER *w)
+{
+	uint8_t *header = NULL;
+	size_t hsize = 0, maxheader = 0;
+	lwvarlena_t *out;
+	size_t i;
+
+	for (i = 0; i < w->nkeys; i++)
+	{
+		size_t len = strlen(w->keys[i]);
+		geobuf_reserve((void **)&header, &maxheader, hsize + len + 11, 1);
+		header[hsize++] = GEOBUF_TAG(1, 2);
+		hsize += varint_u64_encode_buf(len, header + hsize);
+		memcpy(header + hsize, w->keys[i], len);
+		hsize += len;
+	}
+	geobuf_reserve((void **)&header, &maxheader, hsize + 33, 1);
+	if (w->enc.dims != GEOBUF_DEFAULT_DIMENSIONS)
+	{
+		header[hsize++] = GEOBUF_TAG(2, 0);
+		hsize += varint_u32_encode_buf(w->enc.dims, header + hsize);
+	}
+	if (w->enc.precision != GEOBUF_DEFAULT_PRECISION)
+	{
+		header[hsize++] = GEOBUF_TAG(3, 0);
+		hsize += varint_u32_encode_buf(w->enc.precision, header + hsize);
+	}
+	header[hsize++] = GEOBUF_TAG(4, 2);
+	hsize += varint_u64_encode_buf(w->size, header + hsize);
+
+	out = lwalloc(LWVARHDRSZ + hsize + w->size);
+	LWSIZE_SET(out->size, LWVARHDRSZ + hsize + w->size);
+	memcpy(out->data, header, hsize);
+	if (w->size)
+		memcpy(out->data + hsize, w->body, w->size);
+	lwfree(header);
+	return out;
+}
+
+void
+lwgeobuf_writer_free(LWGEOBUF_WRITER *w)
+{
+	size_t i;
+
+	if (!w)
+		return;
+	geobuf_enc_release(&w->enc);
+	for (i = 0; i < w->nkeys; i++)
+		lwfree(w->keys[i]);
+	if (w->keys)
+		lwfree(w->keys);
+	if (w->values)
+		lwfree(w->values);
+	if (w->pvalues)
+		lwfree(w->pvalues);
+	if (w->properties)
+		lwfree(w->properties);
+	if (w->body)
+		lwfree(w->body);
+	lwfree(w);
+}
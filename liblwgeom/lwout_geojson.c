@@ -26,6 +26,8 @@
 
 #include "liblwgeom_internal.h"
 #include "stringbuffer.h"
+#include "ryu/ryu.h"
+#include <math.h>
 #include <string.h>	/* strlen */
 #include <assert.h>
 
@@ -45,31 +47,53 @@ enum {
 
 static void asgeojson_geometry(stringbuffer_t *sb, const LWGEOM *geom, const geojson_opts *opts);
 
+/* Positions have a Z or not, M is left out */
+#define GEOJSON_DIMENSIONS(pa) (FLAGS_GET_Z((pa)->flags) ? 3 : 2)
 
+/* Bytes of a position with a separator, "[x,y,z]," */
+#define GEOJSON_MAX_BYTES_POINT(dimensions, precision) \
+	(2 + (dimensions) * (OUT_MAX_BYTES_DOUBLE_PRECISION(precision) + 1))
 
-static void
-coordinate_to_geojson(stringbuffer_t *sb, const POINTARRAY *pa, uint32_t i, const geojson_opts *opts)
+/*
+* Write the positions [from, to) of a point array straight into a buffer
+* with room for GEOJSON_MAX_BYTES_POINT per point, formatted as
+* lwprint_double does and separated by commas. Returns the end of the output.
+*/
+static char *
+coordinates_to_geojson_buf(const POINTARRAY *pa, uint32_t from, uint32_t to, char *out, int precision)
 {
-	if (!FLAGS_GET_Z(pa->flags))
-	{
-		const POINT2D *pt = getPoint2d_cp(pa, i);
-		stringbuffer_append_char(sb, '[');
-		stringbuffer_append_double(sb, pt->x, opts->precision);
-		stringbuffer_append_char(sb, ',');
-		stringbuffer_append_double(sb, pt->y, opts->precision);
-		stringbuffer_append_char(sb, ']');
-	}
-	else
+	uint32_t stride = FLAGS_NDIMS(pa->flags);
+	uint32_t dimensions = GEOJSON_DIMENSIONS(pa);
+	uint32_t digits = FP_MAX(0, precision);
+	const double *dbl_ptr = (const double *)pa->serialized_pointlist + (size_t)from * stride;
+	uint32_t i, d;
+
+	for (i = from; i < to; i++, dbl_ptr += stride)
 	{
-		const POINT3D *pt = getPoint3d_cp(pa, i);
-		stringbuffer_append_char(sb, '[');
-		stringbuffer_append_double(sb, pt->x, opts->precision);
-		stringbuffer_append_char(sb, ',');
-		stringbuffer_append_double(sb, pt->y, opts->precision);
-		stringbuffer_append_char(sb, ',');
-		stringbuffer_append_double(sb, pt->z, opts->precision);
-		stringbuffer_append_char(sb, ']');
+		*out++ = '[';
+		for (d = 0; d < dimensions; d++)
+		{
+			double ad = fabs(dbl_ptr[d]);
+			if (ad <= OUT_MIN_DOUBLE || ad >= OUT_MAX_DOUBLE)
+				out += d2sexp_buffered_n(dbl_ptr[d], digits, out);
+			else
+				out += d2sfixed_buffered_n(dbl_ptr[d], digits, out);
+			*out++ = ',';
+		}
+		out[-1] = ']';
+		*out++ = ',';
 	}
+
+	/* No separator after the last position */
+	return to > from ? out - 1 : out;
+}
+
+static void
+coordinate_to_geojson(stringbuffer_t *sb, const POINTARRAY *pa, uint32_t i, const geojson_opts *opts)
+{
+	stringbuffer_makeroom(sb, GEOJSON_MAX_BYTES_POINT(GEOJSON_DIMENSIONS(pa), opts->precision));
+	sb->str_end = coordinates_to_geojson_buf(pa, i, i + 1, sb->str_end, opts->precision);
+	*sb->str_end = '\0';
 }
 
 static void
@@ -81,13 +105,12 @@ pointArray_to_geojson(stringbuffer_t *sb, const POINTARRAY *pa, const geojson_op
 		return;
 	}
 
-	stringbuffer_append_char(sb, '[');
-	for (uint32_t i = 0; i < pa->npoints; i++)
-	{
-		if (i) stringbuffer_append_char(sb, ',');
-		coordinate_to_geojson(sb, pa, i, opts);
-	}
-	stringbuffer_append_char(sb, ']');
+	/* One check for the whole array, the positions are written in place */
+	stringbuffer_makeroom(sb, 2 + (size_t)pa->npoints * GEOJSON_MAX_BYTES_POINT(GEOJSON_DIMENSIONS(pa), opts->precision));
+	*sb->str_end++ = '[';
+	sb->str_end = coordinates_to_geojson_buf(pa, 0, pa->npoints, sb->str_end, opts->precision);
+	*sb->str_end++ = ']';
+	*sb->str_end = '\0';
 	return;
 }
 
@@ -371,6 +394,76 @@ asgeojson_geometry(stringbuffer_t *sb, const LWGEOM *geom, const geojson_opts *o
 	}
 }
 
+/* Longest type and "coordinates" members, with the brackets, a comma and a null */
+#define GEOJSON_MAX_BYTES_GEOM 48
+
+/* Bytes of a "%.*f" bounding box value with its comma */
+static size_t
+geojson_bbox_value_size(double d, int precision)
+{
+	return (fabs(d) < OUT_MAX_DOUBLE ? 18 : 312) + FP_MAX(6, precision);
+}
+
+/*
+* Upper bound of the GeoJSON size of a geometry, so that the buffer is
+* allocated once and the point arrays are formatted without growing it.
+*/
+static size_t
+geojson_size(const LWGEOM *geom, const geojson_opts *opts)
+{
+	size_t size = GEOJSON_MAX_BYTES_GEOM;
+	size_t point = GEOJSON_MAX_BYTES_POINT(FLAGS_GET_Z(geom->flags) ? 3 : 2, opts->precision);
+	uint32_t i;
+
+	if (opts->srs)
+		size += 48 + strlen(opts->srs);
+	if (opts->bbox)
+	{
+		size += 10;
+		size += geojson_bbox_value_size(opts->bbox->xmin, opts->precision);
+		size += geojson_bbox_value_size(opts->bbox->ymin, opts->precision);
+		size += geojson_bbox_value_size(opts->bbox->xmax, opts->precision);
+		size += geojson_bbox_value_size(opts->bbox->ymax, opts->precision);
+		if (opts->hasz)
+		{
+			size += geojson_bbox_value_size(opts->bbox->zmin, opts->precision);
+			size += geojson_bbox_value_size(opts->bbox->zmax, opts->precision);
+		}
+	}
+
+	switch (geom->type)
+	{
+	case POINTTYPE:
+	case LINETYPE:
+	case TRIANGLETYPE:
+	{
+		const POINTARRAY *pa = ((const LWLINE *)geom)->points;
+		if (pa)
+			size += 2 + (size_t)pa->npoints * point;
+		break;
+	}
+	case POLYGONTYPE:
+	{
+		const LWPOLY *poly = (const LWPOLY *)geom;
+		for (i = 0; i < poly->nrings; i++)
+			size += 3 + (size_t)poly->rings[i]->npoints * point;
+		break;
+	}
+	default:
+		if (lwtype_is_collection(geom->type))
+		{
+			/* subgeometries don't get boxes or srs */
+			const LWCOLLECTION *col = (const LWCOLLECTION *)geom;
+			geojson_opts subopts = *opts;
+			subopts.bbox = NULL;
+			subopts.srs = NULL;
+			for (i = 0; i < col->ngeoms; i++)
+				size += geojson_size(col->geoms[i], &subopts);
+		}
+	}
+	return size;
+}
+
 /**
  * Takes a GEOMETRY and returns a GeoJson representation
  */
@@ -394,14 +487,132 @@ lwgeom_to_geojson(const LWGEOM *geom, const char *srs, int precision, int has_bb
 		opts.bbox = &static_bbox;
 	}
 
-	/* To avoid taking a copy of the output, we make */
-	/* space for the VARLENA header before starting to */
-	/* serialize the geom */
-	stringbuffer_init_varlena(&sb);
+	/* Room for all of the output, after the varlena header, */
+	/* so that it is written in place in a single pass */
+	stringbuffer_init_with_size(&sb, LWVARHDRSZ + geojson_size(geom, &opts));
+	stringbuffer_append_len(&sb, "\0\0\0\0\0\0\0\0", LWVARHDRSZ);
 	/* Now serialize the geometry */
 	asgeojson_geometry(&sb, geom, &opts);
-	/* Leave the initially allocated buffer in place */
-	/* and write the varlena_t metadata into the slot we */
-	/* left at the start */
-	return stringbuffer_getvarlena(&sb);
+	/* Hand the buffer over with the varlena_t metadata */
+	/* written into the slot we left at the start */
+	return stringbuffer_releasevarlena(&sb);
+}
+
+/*
+* FeatureCollection writer. The output goes through a buffer that is handed
+* to the sink whenever it grows past GEOJSON_WRITER_FLUSH_SIZE, so the
+* collection is never held in memory as a whole.
+*/
+#define GEOJSON_WRITER_FLUSH_SIZE 65536
+
+struct LWGEOJSON_WRITER
+{
+	lwgeojson_sink sink;
+	void *data;
+	stringbuffer_t sb;
+	int precision;
+	int has_bbox;
+	uint64_t nfeatures;
+	int failed;
+};
+
+static int
+lwgeojson_writer_flush(LWGEOJSON_WRITER *writer)
+{
+	size_t size = stringbuffer_getlength(&writer->sb);
+	if (size && !writer->sink(stringbuffer_getstring(&writer->sb), size, writer->data))
+	{
+		writer->failed = LW_TRUE;
+		return LW_FAILURE;
+	}
+	stringbuffer_clear(&writer->sb);
+	return LW_SUCCESS;
+}
+
+LWGEOJSON_WRITER *
+lwgeojson_writer_create(lwgeojson_sink sink, void *data, const char *srs, int precision, int has_bbox)
+{
+	LWGEOJSON_WRITER *writer = lwalloc(sizeof(LWGEOJSON_WRITER));
+	geojson_opts opts;
+
+	memset(writer, 0, sizeof(LWGEOJSON_WRITER));
+	writer->sink = sink;
+	writer->data = data;
+	writer->precision = precision;
+	writer->has_bbox = has_bbox;
+	stringbuffer_init(&writer->sb);
+
+	/* The reference system is given once, for the collection */
+	memset(&opts, 0, sizeof(opts));
+	opts.srs = srs;
+	stringbuffer_append_len(&writer->sb, "{\"type\":\"FeatureCollection\",", 28);
+	asgeojson_srs(&writer->sb, &opts);
+	stringbuffer_append_len(&writer->sb, "\"features\":[", 12);
+	return writer;
+}
+
+int
+lwgeojson_writer_feature(LWGEOJSON_WRITER *writer, const LWGEOM *geom, const char *properties, size_t properties_size)
+{
+	GBOX static_bbox = {0};
+	geojson_opts opts;
+	stringbuffer_t *sb = &writer->sb;
+
+	if (writer->failed)
+		return LW_FAILURE;
+
+	memset(&opts, 0, sizeof(opts));
+	opts.precision = writer->precision;
+	if (geom)
+	{
+		opts.hasz = FLAGS_GET_Z(geom->flags);
+		if (writer->has_bbox)
+		{
+			lwgeom_calculate_gbox_cartesian(geom, &static_bbox);
+			opts.bbox = &static_bbox;
+		}
+		stringbuffer_makeroom(sb, 64 + properties_size + geojson_size(geom, &opts));
+	}
+
+	if (writer->nfeatures++)
+		stringbuffer_append_char(sb, ',');
+	stringbuffer_append_len(sb, "{\"type\":\"Feature\",\"geometry\":", 29);
+	if (geom)
+		asgeojson_geometry(sb, geom, &opts);
+	else
+		stringbuffer_append_len(sb, "null", 4);
+	stringbuffer_append_len(sb, ",\"properties\":", 14);
+	if (properties)
+	{
+		/* Not null terminated */
+		stringbuffer_makeroom(sb, properties_size + 1);
+		memcpy(sb->str_end, properties, properties_size);
+		sb->str_end += properties_size;
+		*sb->str_end = '\0';
+	}
+	else
+		stringbuffer_append_len(sb, "null", 4);
+	stringbuffer_append_char(sb, '}');
+
+	if (stringbuffer_getlength(sb) >= GEOJSON_WRITER_FLUSH_SIZE)
+		return lwgeojson_writer_flush(writer);
+	return LW_SUCCESS;
+}
+
+int
+lwgeojson_writer_finish(LWGEOJSON_WRITER *writer)
+{
+	if (writer->failed)
+		return LW_FAILURE;
+	stringbuffer_append_len(&writer->sb, "]}", 2);
+	return lwgeojson_writer_flush(writer);
+}
+
+void
+lwgeojson_writer_free(LWGEOJSON_WRITER *writer)
+{
+	if (!writer)
+		return;
+	stringbuffer_release(&writer->sb);
+	lwfree(writer);
 }
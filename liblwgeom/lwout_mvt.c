@@ -0,0 +1,1016 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "liblwgeom_internal.h"
+#include "lwgeom_log.h"
+#include "varint.h"
+#include "vector_tile.pb-c.h"
+#include "wagyu/lwgeom_wagyu.h"
+
+/*
+ * Mapbox Vector Tile encoder.
+ *
+ * lwgeom_to_mvt_geom takes a geometry to the integer grid of a tile and
+ * clips it, then lwmvt_layer_add_feature appends its commands and tags
+ * straight to arrays owned by the layer, so that a feature costs no
+ * allocation of its own. The protobuf structures only get their pointers
+ * into those arrays in lwmvt_encode, right before packing.
+ *
+ * The encoder keeps no state of its own outside the layers, but it
+ * allocates and reports errors through lwalloc and lwerror, which use the
+ * LWGEOM_CONTEXT of the calling thread and are not thread-safe otherwise.
+ * A thread building its own layers needs its own context; layers cannot
+ * be built from lwthread workers (see lwthread.h).
+ */
+
+/* Command ids, section 4.3.3 of the specification */
+#define MVT_MOVETO 1
+#define MVT_LINETO 2
+#define MVT_CLOSEPATH 7
+#define MVT_COMMAND(id, count) (((uint32_t)(count) << 3) | (id))
+
+/* Tile coordinates are clipped to this when clip_geom is false, so that
+ * the steps between them still fit the 32 bits of the parameters */
+#define MVT_MAX_COORD 1073741823.0
+
+/* Open addressing index over a dictionary, slots hold position + 1 */
+typedef struct
+{
+	uint32_t *slots;
+	uint32_t size; /* Power of two */
+} MVT_DICT;
+
+struct LWMVT_LAYER
+{
+	char *name;
+	uint32_t extent;
+
+	/* Features, their geometry and tags point nowhere until encoded */
+	VectorTile__Tile__Feature *features;
+	size_t nfeatures;
+	size_t maxfeatures;
+
+	/* Geometry commands and tags of all the features, in order */
+	uint32_t *geometry;
+	size_t ngeometry;
+	size_t maxgeometry;
+	uint32_t *tags;
+	size_t ntags;
+	size_t maxtags;
+
+	char **keys;
+	size_t nkeys;
+	size_t maxkeys;
+	MVT_DICT key_dict;
+
+	VectorTile__Tile__Value *values;
+	size_t nvalues;
+	size_t maxvalues;
+	MVT_DICT value_dict;
+};
+
+
+/**********************************************************************
+ * Geometry preparation
+ */
+
+/* A 2D, linear copy of the geometry, of a single basic type family */
+static LWGEOM *
+mvt_basic_geom(const LWGEOM *geom)
+{
+	LWGEOM *out;
+
+	switch (geom->type)
+	{
+	case CIRCSTRINGTYPE:
+	case COMPOUNDTYPE:
+	case CURVEPOLYTYPE:
+	case MULTICURVETYPE:
+	case MULTISURFACETYPE:
+	{
+		LWGEOM *stroked = lwgeom_stroke(geom, 32);
+		out = mvt_basic_geom(stroked);
+		lwgeom_free(stroked);
+		break;
+	}
+	case POINTTYPE:
+	case LINETYPE:
+	case POLYGONTYPE:
+	case MULTIPOINTTYPE:
+	case MULTILINETYPE:
+	case MULTIPOLYGONTYPE:
+		out = lwgeom_force_2d(geom);
+		break;
+	case COLLECTIONTYPE:
+	{
+		/* Keep the parts of the highest dimension */
+		LWGEOM *stroked = lwgeom_has_arc(geom) ? lwgeom_stroke(geom, 32) : NULL;
+		LWCOLLECTION *col = lwcollection_extract((const LWCOLLECTION *)(stroked ? stroked : geom), 0);
+		out = lwgeom_force_2d((LWGEOM *)col);
+		lwcollection_free(col);
+		if (stroked)
+			lwgeom_free(stroked);
+		break;
+	}
+	default:
+		lwerror("%s: unsupported geometry type %s", __func__, lwtype_name(geom->type));
+		out = NULL;
+	}
+	return out;
+}
+
+/* Only keep the points inside of the box */
+static LWGEOM *
+mvt_clip_points(LWGEOM *geom, const GBOX *box)
+{
+	LWMPOINT *mpoint;
+	uint32_t i, n = 0;
+
+	if (geom->type == POINTTYPE)
+	{
+		POINT2D pt;
+		if (lwgeom_is_empty(geom))
+			return geom;
+		getPoint2d_p(((LWPOINT *)geom)->point, 0, &pt);
+		if (!gbox_contains_point2d(box, &pt))
+		{
+			lwgeom_free(geom);
+			return NULL;
+		}
+		return geom;
+	}
+
+	mpoint = (LWMPOINT *)geom;
+	for (i = 0; i < mpoint->ngeoms; i++)
+	{
+		LWPOINT *point = mpoint->geoms[i];
+		POINT2D pt;
+		if (!lwpoint_is_empty(point))
+		{
+			getPoint2d_p(point->point, 0, &pt);
+			if (gbox_contains_point2d(box, &pt))
+			{
+				mpoint->geoms[n++] = point;
+				continue;
+			}
+		}
+		lwpoint_free(point);
+	}
+	mpoint->ngeoms = n;
+	return geom;
+}
+
+/* Clip the lines to the box, keeping the linear parts only */
+static LWGEOM *
+mvt_clip_lines(LWGEOM *geom, const GBOX *box)
+{
+	LWCOLLECTION *cx, *cy;
+	LWMLINE *out;
+	uint32_t i;
+
+	cx = lwgeom_clip_to_ordinate_range(geom, 'X', box->xmin, box->xmax, 0);
+	lwgeom_free(geom);
+	cy = lwgeom_clip_to_ordinate_range((LWGEOM *)cx, 'Y', box->ymin, box->ymax, 0);
+	lwcollection_free(cx);
+
+	out = lwmline_construct_empty(cy->srid, 0, 0);
+	for (i = 0; i < cy->ngeoms; i++)
+	{
+		LWGEOM *part = cy->geoms[i];
+		if (part->type == LINETYPE && ((LWLINE *)part)->points->npoints > 1)
+			lwmline_add_lwline(out, (LWLINE *)part);
+		else
+			lwgeom_free(part);
+	}
+	lwfree(cy->geoms);
+	lwcollection_release(cy);
+	return (LWGEOM *)out;
+}
+
+/*
+* Transform the geometry from the bounds of the tile to its grid, with
+* the origin at the top left and extent units on each side. Details under
+* half a unit are simplified away, and the parts of the geometry further
+* than buffer units out of the tile are clipped off when clip_geom is set.
+* Polygons always come out valid, as required by the specification.
+* Returns NULL when nothing is left of the geometry.
+*/
+LWGEOM *
+lwgeom_to_mvt_geom(const LWGEOM *geom, const GBOX *bounds, uint32_t extent, uint32_t buffer, int clip_geom)
+{
+	double width, height, half_res;
+	GBOX box, tile_box, clip_box;
+	AFFINE affine;
+	gridspec grid;
+	LWGEOM *g;
+	int type;
+
+	if (!geom || !bounds || !extent)
+	{
+		lwerror("%s: missing geometry, bounds or extent", __func__);
+		return NULL;
+	}
+
+	width = bounds->xmax - bounds->xmin;
+	height = bounds->ymax - bounds->ymin;
+	if (!(width > 0 && height > 0))
+	{
+		lwerror("%s: bounds width and height must be positive", __func__);
+		return NULL;
+	}
+
+	if (lwgeom_is_empty(geom) || lwgeom_calculate_gbox(geom, &box) == LW_FAILURE)
+		return NULL;
+
+	/* Tile space goes from the top left corner, y growing downwards */
+	memset(&affine, 0, sizeof(AFFINE));
+	affine.afac = extent / width;
+	affine.efac = -(extent / height);
+	affine.ifac = 1;
+	affine.xoff = -bounds->xmin * affine.afac;
+	affine.yoff = -bounds->ymax * affine.efac;
+
+	memset(&tile_box, 0, sizeof(GBOX));
+	tile_box.xmin = box.xmin * affine.afac + affine.xoff;
+	tile_box.xmax = box.xmax * affine.afac + affine.xoff;
+	tile_box.ymin = box.ymax * affine.efac + affine.yoff;
+	tile_box.ymax = box.ymin * affine.efac + affine.yoff;
+
+	memset(&clip_box, 0, sizeof(GBOX));
+	if (clip_geom)
+	{
+		clip_box.xmin = clip_box.ymin = -(double)buffer;
+		clip_box.xmax = clip_box.ymax = (double)extent + buffer;
+		if (!gbox_overlaps_2d(&tile_box, &clip_box))
+			return NULL;
+	}
+	else
+	{
+		clip_box.xmin = clip_box.ymin = -MVT_MAX_COORD;
+		clip_box.xmax = clip_box.ymax = MVT_MAX_COORD;
+	}
+
+	/* Areas smaller than half a unit would be gone after snapping */
+	half_res = FP_MIN(width, height) / extent / 2;
+	if (lwgeom_dimension(geom) == 2 && box.xmax - box.xmin < half_res && box.ymax - box.ymin < half_res)
+		return NULL;
+
+	g = mvt_basic_geom(geom);
+	if (!g)
+		return NULL;
+
+	/* There is no place on the grid for NaN or infinite coordinates */
+	if (!lwgeom_isfinite(g))
+	{
+		lwgeom_free(g);
+		return NULL;
+	}
+
+	memset(&grid, 0, sizeof(gridspec));
+	grid.xsize = grid.ysize = 1;
+
+	type = g->type;
+	if (lwgeom_is_empty(g))
+	{
+		/* Nothing to do */
+	}
+	else if (type == POINTTYPE || type == MULTIPOINTTYPE)
+	{
+		lwgeom_affine(g, &affine);
+		lwgeom_grid_in_place(g, &grid);
+		g = mvt_clip_points(g, &clip_box);
+	}
+	else
+	{
+		lwgeom_remove_repeated_points_in_place(g, half_res);
+		lwgeom_simplify_in_place(g, half_res, LW_FALSE);
+		lwgeom_affine(g, &affine);
+
+		if (type == LINETYPE || type == MULTILINETYPE)
+		{
+			/* Only clip when it actually cuts something */
+			lwgeom_calculate_gbox(g, &tile_box);
+			if (!gbox_contains_2d(&clip_box, &tile_box))
+				g = mvt_clip_lines(g, &clip_box);
+			lwgeom_grid_in_place(g, &grid);
+		}
+		else
+		{
+			/* Snap first, wagyu truncates to integers */
+			LWGEOM *valid;
+			lwgeom_grid_in_place(g, &grid);
+			valid = lwgeom_wagyu_clip_by_box(g, &clip_box);
+			lwgeom_free(g);
+			g = valid;
+		}
+	}
+
+	if (g && lwgeom_is_empty(g))
+	{
+		lwgeom_free(g);
+		g = NULL;
+	}
+	if (g)
+		lwgeom_refresh_bbox(g);
+	return g;
+}
+
+
+/**********************************************************************
+ * Dictionaries
+ */
+
+static void
+mvt_reserve(void **mem, size_t *max, size_t needed, size_t elem_size)
+{
+	size_t size = *max ? *max : 16;
+	if (needed <= *max)
+		return;
+	while (size < needed)
+		size *= 2;
+	*mem = lwrealloc(*mem, size * elem_size);
+	*max = size;
+}
+
+static inline uint64_t
+mvt_hash_bytes(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *p = data;
+	size_t i;
+	/* FNV-1a */
+	for (i = 0; i < size; i++)
+		hash = (hash ^ p[i]) * UINT64_C(0x100000001b3);
+	return hash;
+}
+
+#define MVT_HASH_SEED UINT64_C(0xcbf29ce484222325)
+
+static uint64_t
+mvt_hash_key(const char *key)
+{
+	return mvt_hash_bytes(MVT_HASH_SEED, key, strlen(key));
+}
+
+/* Everything but the strings is compared on its bits */
+static uint64_t
+mvt_value_bits(const VectorTile__Tile__Value *v)
+{
+	uint64_t bits = 0;
+	switch (v->test_oneof_case)
+	{
+	case VECTOR_TILE__TILE__VALUE__TEST_ONEOF_FLOAT_VALUE:
+	{
+		uint32_t b;
+		memcpy(&b, &v->float_value, sizeof(b));
+		bits = b;
+		break;
+	}
+	case VECTOR_TILE__TILE__VALUE__TEST_ONEOF_DOUBLE_VALUE:
+		memcpy(&bits, &v->double_value, sizeof(bits));
+		break;
+	case VECTOR_TILE__TILE__VALUE__TEST_ONEOF_INT_VALUE:
+	case VECTOR_TILE__TILE__VALUE__TEST_ONEOF_SINT_VALUE:
+		bits = (uint64_t)v->int_value;
+		break;
+	case VECTOR_TILE__TILE__VALUE__TEST_ONEOF_UINT_VALUE:
+		bits = v->uint_value;
+		break;
+	case VECTOR_TILE__TILE__VALUE__TEST_ONEOF_BOOL_VALUE:
+		bits = v->bool_value ? 1 : 0;
+		break;
+	default:
+		break;
+	}
+	return bits;
+}
+
+static uint64_t
+mvt_hash_value(const VectorTile__Tile__Value *v)
+{
+	uint8_t type = (uint8_t)v->test_oneof_case;
+	uint64_t hash = mvt_hash_bytes(MVT_HASH_SEED, &type, 1);
+	uint64_t bits;
+
+	if (v->test_oneof_case == VECTOR_TILE__TILE__VALUE__TEST_ONEOF_STRING_VALUE)
+		return mvt_hash_bytes(hash, v->string_value, strlen(v->string_value));
+	bits = mvt_value_bits(v);
+	return mvt_hash_bytes(hash, &bits, sizeof(bits));
+}
+
+static int
+mvt_value_equals(const VectorTile__Tile__Value *a, const VectorTile__Tile__Value *b)
+{
+	if (a->test_oneof_case != b->test_oneof_case)
+		return LW_FALSE;
+	if (a->test_oneof_case == VECTOR_TILE__TILE__VALUE__TEST_ONEOF_STRING_VALUE)
+		return strcmp(a->string_value, b->string_value) == 0;
+	return mvt_value_bits(a) == mvt_value_bits(b);
+}
+
+/* Double the index of a dictionary of count entries */
+static void
+mvt_dict_grow(MVT_DICT *dict, const LWMVT_LAYER *layer, int values, size_t count)
+{
+	uint32_t size = dict->size ? dict->size * 2 : 64;
+	uint32_t mask = size - 1;
+	size_t i;
+
+	lwfree(dict->slots);
+	dict->slots = lwalloc(size * sizeof(uint32_t));
+	memset(dict->slots, 0, size * sizeof(uint32_t));
+	dict->size = size;
+
+	for (i = 0; i < count; i++)
+	{
+		uint64_t hash = values ? mvt_hash_value(&layer->values[i]) : mvt_hash_key(layer->keys[i]);
+		uint32_t slot = (uint32_t)hash & mask;
+		while (dict->slots[slot])
+			slot = (slot + 1) & mask;
+		dict->slots[slot] = (uint32_t)i + 1;
+	}
+}
+
+static uint32_t
+mvt_key_index(LWMVT_LAYER *layer, const char *key)
+{
+	MVT_DICT *dict = &layer->key_dict;
+	uint32_t mask, slot;
+	size_t size;
+
+	if (2 * (layer->nkeys + 1) > dict->size)
+		mvt_dict_grow(dict, layer, LW_FALSE, layer->nkeys);
+
+	mask = dict->size - 1;
+	for (slot = (uint32_t)mvt_hash_key(key) & mask; dict->slots[slot]; slot = (slot + 1) & mask)
+	{
+		uint32_t i = dict->slots[slot] - 1;
+		if (strcmp(layer->keys[i], key) == 0)
+			return i;
+	}
+
+	mvt_reserve((void **)&layer->keys, &layer->maxkeys, layer->nkeys + 1, sizeof(char *));
+	size = strlen(key) + 1;
+	layer->keys[layer->nkeys] = lwalloc(size);
+	memcpy(layer->keys[layer->nkeys], key, size);
+	dict->slots[slot] = (uint32_t)++layer->nkeys;
+	return (uint32_t)layer->nkeys - 1;
+}
+
+static uint32_t
+mvt_value_index(LWMVT_LAYER *layer, const VectorTile__Tile__Value *value)
+{
+	MVT_DICT *dict = &layer->value_dict;
+	VectorTile__Tile__Value *v;
+	uint32_t mask, slot;
+
+	if (2 * (layer->nvalues + 1) > dict->size)
+		mvt_dict_grow(dict, layer, LW_TRUE, layer->nvalues);
+
+	mask = dict->size - 1;
+	for (slot = (uint32_t)mvt_hash_value(value) & mask; dict->slots[slot]; slot = (slot + 1) & mask)
+	{
+		uint32_t i = dict->slots[slot] - 1;
+		if (mvt_value_equals(&layer->values[i], value))
+			return i;
+	}
+
+	mvt_reserve((void **)&layer->values, &layer->maxvalues, layer->nvalues + 1, sizeof(VectorTile__Tile__Value));
+	v = &layer->values[layer->nvalues];
+	*v = *value;
+	if (v->test_oneof_case == VECTOR_TILE__TILE__VALUE__TEST_ONEOF_STRING_VALUE)
+	{
+		size_t size = strlen(value->string_value) + 1;
+		v->string_value = lwalloc(size);
+		memcpy(v->string_value, value->string_value, size);
+	}
+	dict->slots[slot] = (uint32_t)++layer->nvalues;
+	return (uint32_t)layer->nvalues - 1;
+}
+
+
+/**********************************************************************
+ * Layers
+ */
+
+LWMVT_LAYER *
+lwmvt_layer_create(const char *name, uint32_t extent)
+{
+	LWMVT_LAYER *layer;
+	size_t size;
+
+	if (!name || !extent)
+	{
+		lwerror("%s: a layer needs a name and an extent", __func__);
+		return NULL;
+	}
+
+	layer = lwalloc(sizeof(LWMVT_LAYER));
+	memset(layer, 0, sizeof(LWMVT_LAYER));
+	size = strlen(name) + 1;
+	layer->name = lwalloc(size);
+	memcpy(layer->name, name, size);
+	layer->extent = extent;
+	return layer;
+}
+
+void
+lwmvt_layer_free(LWMVT_LAYER *layer)
+{
+	size_t i;
+
+	if (!layer)
+		return;
+	for (i = 0; i < layer->nkeys; i++)
+		lwfree(layer->keys[i]);
+	for (i = 0; i < layer->nvalues; i++)
+		if (layer->values[i].test_oneof_case == VECTOR_TILE__TILE__VALUE__TEST_ONEOF_STRING_VALUE)
+			lwfree(layer->values[i].string_value);
+	if (layer->keys)
+		lwfree(layer->keys);
+	if (layer->values)
+		lwfree(layer->values);
+	if (layer->key_dict.slots)
+		lwfree(layer->key_dict.slots);
+	if (layer->value_dict.slots)
+		lwfree(layer->value_dict.slots);
+	if (layer->features)
+		lwfree(layer->features);
+	if (layer->geometry)
+		lwfree(layer->geometry);
+	if (layer->tags)
+		lwfree(layer->tags);
+	lwfree(layer->name);
+	lwfree(layer);
+}
+
+size_t
+lwmvt_layer_nfeatures(const LWMVT_LAYER *layer)
+{
+	return layer->nfeatures;
+}
+
+/* Current position of the pen, carried over from part to part */
+typedef struct
+{
+	int32_t x;
+	int32_t y;
+} MVT_CURSOR;
+
+static inline void
+mvt_point(const POINTARRAY *pa, uint32_t i, int32_t *x, int32_t *y)
+{
+	const POINT2D *pt = getPoint2d_cp(pa, i);
+	*x = (int32_t)lround(pt->x);
+	*y = (int32_t)lround(pt->y);
+}
+
+static inline uint32_t *
+mvt_moveto(uint32_t *out, MVT_CURSOR *c, int32_t x, int32_t y)
+{
+	*out++ = zigzag32(x - c->x);
+	*out++ = zigzag32(y - c->y);
+	c->x = x;
+	c->y = y;
+	return out;
+}
+
+/* MoveTo(count) with every point of the array */
+static uint32_t *
+mvt_encode_points(uint32_t *out, MVT_CURSOR *c, const LWGEOM *geom)
+{
+	uint32_t *command = out++;
+	uint32_t count = 0;
+	int32_t x, y;
+
+	if (geom->type == POINTTYPE)
+	{
+		mvt_point(((LWPOINT *)geom)->point, 0, &x, &y);
+		out = mvt_moveto(out, c, x, y);
+		count = 1;
+	}
+	else
+	{
+		const LWMPOINT *mpoint = (const LWMPOINT *)geom;
+		uint32_t i;
+		for (i = 0; i < mpoint->ngeoms; i++)
+		{
+			if (lwpoint_is_empty(mpoint->geoms[i]))
+				continue;
+			mvt_point(mpoint->geoms[i]->point, 0, &x, &y);
+			out = mvt_moveto(out, c, x, y);
+			count++;
+		}
+	}
+	if (!count)
+		return command;
+	*command = MVT_COMMAND(MVT_MOVETO, count);
+	return out;
+}
+
+/*
+* MoveTo(1) to the first point then LineTo(n) along points [from, to) in
+* the direction step, leaving out the steps that would not move. Returns
+* the start of the part, as if nothing was written, when fewer than
+* min_lineto steps were left.
+*/
+static uint32_t *
+mvt_encode_path(uint32_t *out, MVT_CURSOR *c, const POINTARRAY *pa, int32_t from, int32_t to, int32_t step, uint32_t min_lineto)
+{
+	MVT_CURSOR start = *c;
+	uint32_t *part = out;
+	uint32_t *command;
+	uint32_t count = 0;
+	int32_t i, x, y;
+
+	mvt_point(pa, from, &x, &y);
+	*out++ = MVT_COMMAND(MVT_MOVETO, 1);
+	out = mvt_moveto(out, c, x, y);
+
+	command = out++;
+	for (i = from + step; i != to; i += step)
+	{
+		mvt_point(pa, i, &x, &y);
+		if (x == c->x && y == c->y)
+			continue;
+		out = mvt_moveto(out, c, x, y);
+		count++;
+	}
+
+	if (count < min_lineto)
+	{
+		*c = start;
+		return part;
+	}
+	*command = MVT_COMMAND(MVT_LINETO, count);
+	return out;
+}
+
+/* Twice the area of the ring as it is encoded, positive when clockwise on screen */
+static int64_t
+mvt_ring_area(const POINTARRAY *pa)
+{
+	int64_t area = 0;
+	int32_t x0, y0, x1, y1;
+	uint32_t i;
+
+	mvt_point(pa, 0, &x0, &y0);
+	for (i = 1; i < pa->npoints; i++)
+	{
+		mvt_point(pa, i, &x1, &y1);
+		area += (int64_t)x0 * y1 - (int64_t)x1 * y0;
+		x0 = x1;
+		y0 = y1;
+	}
+	return area;
+}
+
+/*
+* Exterior rings go clockwise and interior rings anticlockwise, in the
+* y-down space of the tile. Rings are written backwards when needed, and
+* the ones that collapsed on the grid are left out, with the interior
+* rings of a collapsed exterior ring.
+*/
+static uint32_t *
+mvt_encode_polygon(uint32_t *out, MVT_CURSOR *c, const LWPOLY *poly)
+{
+	uint32_t r;
+
+	for (r = 0; r < poly->nrings; r++)
+	{
+		const POINTARRAY *pa = poly->rings[r];
+		uint32_t *end;
+		int64_t area;
+
+		if (pa->npoints < 4)
+		{
+			if (r == 0)
+				return out;
+			continue;
+		}
+		area = mvt_ring_area(pa);
+		if (area == 0)
+		{
+			if (r == 0)
+				return out;
+			continue;
+		}
+
+		/* The closing point is implied by ClosePath */
+		if ((area > 0) == (r == 0))
+			end = mvt_encode_path(out, c, pa, 0, pa->npoints - 1, 1, 2);
+		else
+			end = mvt_encode_path(out, c, pa, pa->npoints - 1, 0, -1, 2);
+
+		if (end == out)
+		{
+			if (r == 0)
+				return out;
+			continue;
+		}
+		*end++ = MVT_COMMAND(MVT_CLOSEPATH, 1);
+		out = end;
+	}
+	return out;
+}
+
+/* Room for the commands of nparts parts of npoints points overall */
+static void
+mvt_reserve_parts(LWMVT_LAYER *layer, uint32_t npoints, uint32_t nparts)
+{
+	size_t needed = layer->ngeometry + 4 * (size_t)nparts + 2 * (size_t)npoints;
+	mvt_reserve((void **)&layer->geometry, &layer->maxgeometry, needed, sizeof(uint32_t));
+}
+
+/* Append the commands of the geometry, returns how many were written */
+static size_t
+mvt_encode_geometry(LWMVT_LAYER *layer, const LWGEOM *geom, VectorTile__Tile__GeomType *type)
+{
+	size_t start = layer->ngeometry;
+	MVT_CURSOR c = {0, 0};
+	uint32_t i;
+
+	switch (geom->type)
+	{
+	case POINTTYPE:
+	case MULTIPOINTTYPE:
+		*type = VECTOR_TILE__TILE__GEOM_TYPE__POINT;
+		mvt_reserve_parts(layer, lwgeom_count_vertices(geom), 1);
+		layer->ngeometry = mvt_encode_points(layer->geometry + layer->ngeometry, &c, geom) - layer->geometry;
+		break;
+	case LINETYPE:
+	case MULTILINETYPE:
+	{
+		const LWCOLLECTION *col = (const LWCOLLECTION *)geom;
+		const LWLINE *line = (const LWLINE *)geom;
+		uint32_t ngeoms = geom->type == LINETYPE ? 1 : col->ngeoms;
+		*type = VECTOR_TILE__TILE__GEOM_TYPE__LINESTRING;
+		for (i = 0; i < ngeoms; i++)
+		{
+			if (geom->type == MULTILINETYPE)
+				line = (const LWLINE *)col->geoms[i];
+			if (line->points->npoints < 2)
+				continue;
+			mvt_reserve_parts(layer, line->points->npoints, 1);
+			layer->ngeometry = mvt_encode_path(layer->geometry + layer->ngeometry,
+							   &c,
+							   line->points,
+							   0,
+							   line->points->npoints,
+							   1,
+							   1) -
+					   layer->geometry;
+		}
+		break;
+	}
+	case POLYGONTYPE:
+	case MULTIPOLYGONTYPE:
+	{
+		const LWCOLLECTION *col = (const LWCOLLECTION *)geom;
+		const LWPOLY *poly = (const LWPOLY *)geom;
+		uint32_t ngeoms = geom->type == POLYGONTYPE ? 1 : col->ngeoms;
+		*type = VECTOR_TILE__TILE__GEOM_TYPE__POLYGON;
+		for (i = 0; i < ngeoms; i++)
+		{
+			if (geom->type == MULTIPOLYGONTYPE)
+				poly = (const LWPOLY *)col->geoms[i];
+			mvt_reserve_parts(layer, lwgeom_count_vertices((const LWGEOM *)poly), poly->nrings);
+			layer->ngeometry = mvt_encode_polygon(layer->geometry + layer->ngeometry, &c, poly) - layer->geometry;
+		}
+		break;
+	}
+	default:
+		lwerror("%s: unsupported geometry type %s", __func__, lwtype_name(geom->type));
+		return 0;
+	}
+	return layer->ngeometry - start;
+}
+
+/* Tag value of a property, LW_FAILURE if it has none */
+static int
+mvt_property_value(const LWPROPERTY *p, VectorTile__Tile__Value *v)
+{
+	vector_tile__tile__value__init(v);
+	switch (p->type)
+	{
+	case LWPROPERTY_STRING:
+	case LWPROPERTY_JSON: /* MVT has no JSON values, kept as text */
+		if (!p->string_value)
+			return LW_FAILURE;
+		v->test_oneof_case = VECTOR_TILE__TILE__VALUE__TEST_ONEOF_STRING_VALUE;
+		v->string_value = (char *)p->string_value;
+		break;
+	case LWPROPERTY_FLOAT:
+		v->test_oneof_case = VECTOR_TILE__TILE__VALUE__TEST_ONEOF_FLOAT_VALUE;
+		v->float_value = (float)p->double_value;
+		break;
+	case LWPROPERTY_DOUBLE:
+		v->test_oneof_case = VECTOR_TILE__TILE__VALUE__TEST_ONEOF_DOUBLE_VALUE;
+		v->double_value = p->double_value;
+		break;
+	case LWPROPERTY_INT:
+		/* Like other encoders, uint for positive numbers and sint for the rest */
+		if (p->int_value >= 0)
+		{
+			v->test_oneof_case = VECTOR_TILE__TILE__VALUE__TEST_ONEOF_UINT_VALUE;
+			v->uint_value = (uint64_t)p->int_value;
+		}
+		else
+		{
+			v->test_oneof_case = VECTOR_TILE__TILE__VALUE__TEST_ONEOF_SINT_VALUE;
+			v->sint_value = p->int_value;
+		}
+		break;
+	case LWPROPERTY_BOOL:
+		v->test_oneof_case = VECTOR_TILE__TILE__VALUE__TEST_ONEOF_BOOL_VALUE;
+		v->bool_value = p->int_value != 0;
+		break;
+	default:
+		return LW_FAILURE;
+	}
+	return LW_SUCCESS;
+}
+
+int
+lwmvt_layer_add_feature(LWMVT_LAYER *layer, const LWGEOM *geom, const LWPROPERTY *properties, uint32_t nproperties, const uint64_t *id)
+{
+	VectorTile__Tile__Feature *feature;
+	VectorTile__Tile__GeomType type = VECTOR_TILE__TILE__GEOM_TYPE__UNKNOWN;
+	size_t ngeometry, ntags;
+	uint32_t i;
+
+	if (!geom || lwgeom_is_empty(geom))
+		return LW_FAILURE;
+
+	ngeometry = mvt_encode_geometry(layer, geom, &type);
+	if (!ngeometry)
+		return LW_FAILURE;
+
+	ntags = layer->ntags;
+	mvt_reserve((void **)&layer->tags, &layer->maxtags, ntags + 2 * (size_t)nproperties, sizeof(uint32_t));
+	for (i = 0; i < nproperties; i++)
+	{
+		VectorTile__Tile__Value value;
+		if (!properties[i].key || mvt_property_value(&properties[i], &value) == LW_FAILURE)
+			continue;
+		layer->tags[layer->ntags++] = mvt_key_index(layer, properties[i].key);
+		layer->tags[layer->ntags++] = mvt_value_index(layer, &value);
+	}
+
+	mvt_reserve((void **)&layer->features, &layer->maxfeatures, layer->nfeatures + 1, sizeof(VectorTile__Tile__Feature));
+	feature = &layer->features[layer->nfeatures++];
+	vector_tile__tile__feature__init(feature);
+	if (id)
+	{
+		feature->has_id = LW_TRUE;
+		feature->id = *id;
+	}
+	feature->type = type;
+	feature->n_geometry = ngeometry;
+	feature->n_tags = layer->ntags - ntags;
+	return LW_SUCCESS;
+}
+
+/*
+* Append the features of a layer built on the side, typically on another
+* thread, with their tags moved over to the dictionaries of the layer.
+* The counts of the source are taken first, since it may be the layer
+* itself, whose arrays grow and move as they are appended to.
+*/
+int
+lwmvt_layer_merge(LWMVT_LAYER *layer, const LWMVT_LAYER *from)
+{
+	size_t nkeys = from->nkeys, nvalues = from->nvalues;
+	size_t nfeatures = from->nfeatures, ngeometry = from->ngeometry, ntags = from->ntags;
+	uint32_t *keys, *values;
+	size_t i;
+
+	if (layer->extent != from->extent)
+	{
+		lwerror("%s: layers of extents %u and %u cannot be merged", __func__, layer->extent, from->extent);
+		return LW_FAILURE;
+	}
+	if (!nfeatures)
+		return LW_SUCCESS;
+
+	keys = lwalloc((nkeys + 1) * sizeof(uint32_t));
+	values = lwalloc((nvalues + 1) * sizeof(uint32_t));
+	for (i = 0; i < nkeys; i++)
+		keys[i] = mvt_key_index(layer, from->keys[i]);
+	for (i = 0; i < nvalues; i++)
+		values[i] = mvt_value_index(layer, &from->values[i]);
+
+	mvt_reserve((void **)&layer->features,
+		    &layer->maxfeatures,
+		    layer->nfeatures + nfeatures,
+		    sizeof(VectorTile__Tile__Feature));
+	memcpy(layer->features + layer->nfeatures, from->features, nfeatures * sizeof(VectorTile__Tile__Feature));
+	layer->nfeatures += nfeatures;
+
+	mvt_reserve((void **)&layer->geometry, &layer->maxgeometry, layer->ngeometry + ngeometry, sizeof(uint32_t));
+	memcpy(layer->geometry + layer->ngeometry, from->geometry, ngeometry * sizeof(uint32_t));
+	layer->ngeometry += ngeometry;
+
+	mvt_reserve((void **)&layer->tags, &layer->maxtags, layer->ntags + ntags, sizeof(uint32_t));
+	for (i = 0; i < ntags; i += 2)
+	{
+		layer->tags[layer->ntags++] = keys[from->tags[i]];
+		layer->tags[layer->ntags++] = values[from->tags[i + 1]];
+	}
+
+	lwfree(keys);
+	lwfree(values);
+	return LW_SUCCESS;
+}
+
+
+/**********************************************************************
+ * Tiles
+ */
+
+/*
+* Encode the layers as one tile. Tiles are a list of layers on the wire,
+* so the tiles of separately encoded layers can also just be concatenated.
+*/
+lwvarlena_t *
+lwmvt_encode(LWMVT_LAYER **layers, uint32_t nlayers)
+{
+	VectorTile__Tile tile = VECTOR_TILE__TILE__INIT;
+	VectorTile__Tile__Layer *pb_layers;
+	lwvarlena_t *out;
+	size_t size;
+	uint32_t i;
+
+	pb_layers = lwalloc((nlayers + 1) * sizeof(VectorTile__Tile__Layer));
+	tile.layers = lwalloc((nlayers + 1) * sizeof(VectorTile__Tile__Layer *));
+	tile.n_layers = nlayers;
+
+	for (i = 0; i < nlayers; i++)
+	{
+		LWMVT_LAYER *layer = layers[i];
+		VectorTile__Tile__Layer *pb = &pb_layers[i];
+		uint32_t *geometry = layer->geometry;
+		uint32_t *tags = layer->tags;
+		size_t j;
+
+		vector_tile__tile__layer__init(pb);
+		pb->version = 2;
+		pb->name = layer->name;
+		pb->extent = layer->extent;
+		pb->n_keys = layer->nkeys;
+		pb->keys = layer->keys;
+
+		/* Point the features into the arrays of the layer */
+		pb->n_features = layer->nfeatures;
+		pb->features = lwalloc((layer->nfeatures + 1) * sizeof(VectorTile__Tile__Feature *));
+		for (j = 0; j < layer->nfeatures; j++)
+		{
+			VectorTile__Tile__Feature *feature = &layer->features[j];
+			feature->geometry = geometry;
+			feature->tags = feature->n_tags ? tags : NULL;
+			geometry += feature->n_geometry;
+			tags += feature->n_tags;
+			pb->features[j] = feature;
+		}
+
+		pb->n_values = layer->nvalues;
+		pb->values = lwalloc((layer->nvalues + 1) * sizeof(VectorTile__Tile__Value *));
+		for (j = 0; j < layer->nvalues; j++)
+			pb->values[j] = &layer->values[j];
+
+		tile.layers[i] = pb;
+	}
+
+	size = vector_tile__tile__get_packed_size(&tile);
+	out = lwalloc(LWVARHDRSZ + size);
+	LWSIZE_SET(out->size, LWVARHDRSZ + size);
+	vector_tile__tile__pack(&tile, (uint8_t *)out->data);
+
+	for (i = 0; i < nlayers; i++)
+	{
+		lwfree(pb_layers[i].features);
+		lwfree(pb_layers[i].values);
+	}
+	lwfree(tile.layers);
+	lwfree(pb_layers);
+	return out;
+}
@@ -79,7 +79,7 @@ static size_t sizeof_bbox(TWKB_STATE *ts, int ndims)
 	for ( i = 0; i < ndims; i++ )
 	{
 		size += varint_s64_encode_buf(ts->bbox_min[i], buf);
-		size += varint_s64_encode_buf((ts->bbox_max[i] - ts->bbox_min[i]), buf);
+		size += varint_s64_encode_buf((int64_t)((uint64_t)ts->bbox_max[i] - (uint64_t)ts->bbox_min[i]), buf);
 	}
 	return size;
 }
@@ -87,15 +87,30 @@ static size_t sizeof_bbox(TWKB_STATE *ts, int ndims)
 * Writes the bbox in varints in the form:
 * xmin, xdelta, ymin, ydelta
 */
-static void write_bbox(TWKB_STATE *ts, int ndims)
+static uint8_t *write_bbox(TWKB_STATE *ts, int ndims, uint8_t *p)
 {
 	int i;
 	LWDEBUGF(2, "Entered %s", __func__);
 	for ( i = 0; i < ndims; i++ )
 	{
-		bytebuffer_append_varint(ts->header_buf, ts->bbox_min[i]);
-		bytebuffer_append_varint(ts->header_buf, (ts->bbox_max[i] - ts->bbox_min[i]));
+		p += varint_s64_encode_buf(ts->bbox_min[i], p);
+		p += varint_s64_encode_buf((int64_t)((uint64_t)ts->bbox_max[i] - (uint64_t)ts->bbox_min[i]), p);
 	}
+	return p;
+}
+
+/* Zig-zag varint of a delta, inlined for the coordinate loop */
+static inline uint8_t *
+twkb_put_varint(uint8_t *p, int64_t val)
+{
+	uint64_t q = ((uint64_t)val << 1) ^ (0 - ((uint64_t)val >> 63));
+	while ( q > 0x7f )
+	{
+		*p++ = 0x80 | (uint8_t)q;
+		q >>= 7;
+	}
+	*p++ = (uint8_t)q;
+	return p;
 }
 
 
@@ -107,13 +122,14 @@ static void write_bbox(TWKB_STATE *ts, int ndims)
 static int ptarray_to_twkb_buf(const POINTARRAY *pa, TWKB_GLOBALS *globals, TWKB_STATE *ts, int register_npoints, uint32_t minpoints)
 {
 	uint32_t ndims = FLAGS_NDIMS(pa->flags);
-	uint32_t i, j;
-	bytebuffer_t b;
-	bytebuffer_t *b_p;
-	int64_t nextdelta[MAX_N_DIMS];
-	int npoints = 0;
-	size_t npoints_offset = 0;
+	uint32_t i, j, k, n;
+	bytebuffer_t *b = ts->buf;
+	int64_t quantized[TWKB_BLOCK_POINTS * MAX_N_DIMS];
+	double factor[MAX_N_DIMS];
+	uint32_t npoints = 0;
+	size_t npoints_offset = 0, npoints_size = 0;
 	uint32_t max_points_left = pa->npoints;
+	uint8_t varint[MAX_VARINT_SIZE];
 
 	LWDEBUGF(2, "Entered %s", __func__);
 
@@ -121,109 +137,110 @@ static int ptarray_to_twkb_buf(const POINTARRAY *pa, TWKB_GLOBALS *globals, TWKB
 	if ( pa->npoints == 0 && register_npoints )
 	{
 		LWDEBUGF(4, "Register npoints:%d", pa->npoints);
-		bytebuffer_append_uvarint(ts->geom_buf, pa->npoints);
+		bytebuffer_append_uvarint(b, pa->npoints);
 		return 0;
 	}
 
-	/* If npoints is more than 127 it is unpredictable how many bytes npoints will need */
-	/* Then we have to store the deltas in a temp buffer to later add them after npoints */
-	/* If noints is below 128 we know 1 byte will be needed */
-	/* Then we can make room for that 1 byte at once and write to */
-	/* ordinary buffer */
-	if( pa->npoints > 127 )
+	/* Duplicates are only known once the points are written, so we make */
+	/* room for the npoints of the input, which is the most there can be. */
+	/* We store how far from the beginning of the buffer the value goes, */
+	/* as the buffer may be reallocated */
+	if ( register_npoints )
 	{
-		/* Independent buffer to hold the coordinates, so we can put the npoints */
-		/* into the stream once we know how many points we actually have */
-		bytebuffer_init_with_size(&b, 3 * ndims * pa->npoints);
-		b_p = &b;
+		npoints_size = varint_u32_encode_buf(pa->npoints, varint);
+		npoints_offset = bytebuffer_getlength(b);
+		bytebuffer_makeroom(b, npoints_size);
+		b->writecursor += npoints_size;
 	}
-	else
+
+	for ( j = 0; j < ndims; j++ )
+		factor[j] = globals->factor[j];
+
+	for ( i = 0; i < pa->npoints; i += n )
 	{
-		/* We give an alias to our ordinary buffer */
-		b_p = ts->geom_buf;
-		if ( register_npoints )
+		uint8_t *p;
+		n = pa->npoints - i < TWKB_BLOCK_POINTS ? pa->npoints - i : TWKB_BLOCK_POINTS;
+
+		/* Scale and round a block of coordinates in one go, */
+		/* or right here for a point or a segment */
+		if ( n > 2 )
+			ptarray_quantize(pa, i, n, factor, quantized);
+		else
 		{
-			/* We do not store a pointer to the place where we want the npoints value */
-			/* Instead we store how far from the beginning of the buffer we want the value */
-			/* That is because we otherwise will get in trouble if the buffer is reallocated */
-			npoints_offset = b_p->writecursor - b_p->buf_start;
-
-			/* We just move the cursor 1 step to make room for npoints byte */
-			/* We use the function append_byte even if we have no value yet, */
-			/* since that gives us the check for big enough buffer and moves the cursor */
-			bytebuffer_append_byte(b_p, 0);
+			const double *c = (const double *)getPoint_internal(pa, i);
+			for ( k = 0; k < n * ndims; k += ndims )
+				for ( j = 0; j < ndims; j++ )
+					quantized[k + j] = (int64_t)llround(factor[j] * c[k + j]);
 		}
-	}
 
-	for ( i = 0; i < pa->npoints; i++ )
-	{
-		double *dbl_ptr = (double*)getPoint_internal(pa, i);
-		int64_t diff = 0;
+		bytebuffer_makeroom(b, (size_t)n * ndims * MAX_VARINT_SIZE);
+		p = b->writecursor;
 
-		/* Write this coordinate to the buffer as a varint */
-		for ( j = 0; j < ndims; j++ )
+		for ( k = 0; k < n; k++ )
 		{
+			const int64_t *q = quantized + (size_t)k * ndims;
+			int64_t nextdelta[MAX_N_DIMS];
+			uint64_t diff = 0;
+
 			/* To get the relative coordinate we don't get the distance */
 			/* from the last point but instead the distance from our */
 			/* last accumulated point. This is important to not build up an */
 			/* accumulated error when rounding the coordinates */
-			nextdelta[j] = (int64_t) llround(globals->factor[j] * dbl_ptr[j]) - ts->accum_rels[j];
-			LWDEBUGF(4, "deltavalue: %d, ", nextdelta[j]);
-			diff += llabs(nextdelta[j]);
-		}
-
-		/* Skipping the first point is not allowed */
-		/* If the sum(abs()) of all the deltas was zero, */
-		/* then this was a duplicate point, so we can ignore it */
-		if ( i > 0 && diff == 0 &&  max_points_left > minpoints )
-		{
-			max_points_left--;
-			continue;
-		}
+			for ( j = 0; j < ndims; j++ )
+			{
+				/* Wrapping, for the out of range values of llround */
+				nextdelta[j] = (int64_t)((uint64_t)q[j] - (uint64_t)ts->accum_rels[j]);
+				diff |= (uint64_t)nextdelta[j];
+			}
 
-		/* We really added a point, so... */
-		npoints++;
+			/* Skipping the first point is not allowed */
+			/* If all the deltas were zero, */
+			/* then this was a duplicate point, so we can ignore it */
+			if ( i + k > 0 && diff == 0 &&  max_points_left > minpoints )
+			{
+				max_points_left--;
+				continue;
+			}
 
-		/* Write this vertex to the temporary buffer as varints */
-		for ( j = 0; j < ndims; j++ )
-		{
-			ts->accum_rels[j] += nextdelta[j];
-			bytebuffer_append_varint(b_p, nextdelta[j]);
-		}
+			/* We really added a point, so... */
+			npoints++;
 
-		/* See if this coordinate expands the bounding box */
-		if( globals->variant & TWKB_BBOX )
-		{
+			/* Write this vertex to the buffer as varints */
 			for ( j = 0; j < ndims; j++ )
 			{
-				if( ts->accum_rels[j] > ts->bbox_max[j] )
-					ts->bbox_max[j] = ts->accum_rels[j];
+				ts->accum_rels[j] = q[j];
+				p = twkb_put_varint(p, nextdelta[j]);
+			}
 
-				if( ts->accum_rels[j] < ts->bbox_min[j] )
-					ts->bbox_min[j] = ts->accum_rels[j];
+			/* See if this coordinate expands the bounding box */
+			if( globals->variant & TWKB_BBOX )
+			{
+				for ( j = 0; j < ndims; j++ )
+				{
+					if( ts->accum_rels[j] > ts->bbox_max[j] )
+						ts->bbox_max[j] = ts->accum_rels[j];
+
+					if( ts->accum_rels[j] < ts->bbox_min[j] )
+						ts->bbox_min[j] = ts->accum_rels[j];
+				}
 			}
 		}
-
+		b->writecursor = p;
 	}
 
-	if ( pa->npoints > 127 )
-	{
-		/* Now write the temporary results into the main buffer */
-		/* First the npoints */
-		if ( register_npoints )
-			bytebuffer_append_uvarint(ts->geom_buf, npoints);
-		/* Now the coordinates */
-		bytebuffer_append_bytebuffer(ts->geom_buf, b_p);
-
-		/* Clear our temporary buffer */
-		bytebuffer_destroy_buffer(&b);
-	}
-	else
+	if ( register_npoints )
 	{
-		/* If we didn't use a temp buffer, we just write that npoints value */
-		/* to where it belongs*/
-		if ( register_npoints )
-			varint_u64_encode_buf(npoints, b_p->buf_start + npoints_offset);
+		/* Now we know npoints, write it where it belongs */
+		uint8_t *at = b->buf_start + npoints_offset;
+		size_t size = varint_u32_encode_buf(npoints, varint);
+		memcpy(at, varint, size);
+
+		/* Dropped duplicates can make it shorter than the room we made */
+		if ( size < npoints_size )
+		{
+			memmove(at + size, at + npoints_size, b->writecursor - (at + npoints_size));
+			b->writecursor -= npoints_size - size;
+		}
 	}
 
 	return 0;
@@ -259,7 +276,7 @@ static int
 lwtriangle_to_twkb_buf(const LWTRIANGLE *tri, TWKB_GLOBALS *globals, TWKB_STATE *ts)
 {
 	LWDEBUGF(2, "Entered %s", __func__);
-	bytebuffer_append_uvarint(ts->geom_buf, (uint64_t)1);
+	bytebuffer_append_uvarint(ts->buf, (uint64_t)1);
 
 	/* Set the coordinates (do write npoints) */
 	ptarray_to_twkb_buf(tri->points, globals, ts, 1, 2);
@@ -275,7 +292,7 @@ static int lwpoly_to_twkb_buf(const LWPOLY *poly, TWKB_GLOBALS *globals, TWKB_ST
 	uint32_t i;
 
 	/* Set the number of rings */
-	bytebuffer_append_uvarint(ts->geom_buf, (uint64_t) poly->nrings);
+	bytebuffer_append_uvarint(ts->buf, (uint64_t) poly->nrings);
 
 	for ( i = 0; i < poly->nrings; i++ )
 	{
@@ -309,7 +326,7 @@ static int lwmulti_to_twkb_buf(const LWCOLLECTION *col, TWKB_GLOBALS *globals, T
 	}
 
 	/* Set the number of geometries */
-	bytebuffer_append_uvarint(ts->geom_buf, (uint64_t) (col->ngeoms - nempty));
+	bytebuffer_append_uvarint(ts->buf, (uint64_t) (col->ngeoms - nempty));
 
 	/* We've been handed an idlist, so write it in */
 	if ( ts->idlist )
@@ -320,7 +337,7 @@ static int lwmulti_to_twkb_buf(const LWCOLLECTION *col, TWKB_GLOBALS *globals, T
 			if ( col->type == MULTIPOINTTYPE && lwgeom_is_empty(col->geoms[i]) )
 				continue;
 
-			bytebuffer_append_varint(ts->geom_buf, ts->idlist[i]);
+			bytebuffer_append_varint(ts->buf, ts->idlist[i]);
 		}
 
 		/* Empty it out to nobody else uses it now */
@@ -350,13 +367,13 @@ static int lwcollection_to_twkb_buf(const LWCOLLECTION *col, TWKB_GLOBALS *globa
 	LWDEBUGF(4, "Number of geometries in collection is %d", col->ngeoms);
 
 	/* Set the number of geometries */
-	bytebuffer_append_uvarint(ts->geom_buf, (uint64_t) col->ngeoms);
+	bytebuffer_append_uvarint(ts->buf, (uint64_t) col->ngeoms);
 
 	/* We've been handed an idlist, so write it in */
 	if ( ts->idlist )
 	{
 		for ( i = 0; i < col->ngeoms; i++ )
-			bytebuffer_append_varint(ts->geom_buf, ts->idlist[i]);
+			bytebuffer_append_varint(ts->buf, ts->idlist[i]);
 
 		/* Empty it out to nobody else uses it now */
 		ts->idlist = NULL;
@@ -430,18 +447,18 @@ int lwgeom_write_to_buffer(const LWGEOM *geom, TWKB_GLOBALS *globals, TWKB_STATE
 {
 	int i, is_empty, has_z = 0, has_m = 0, ndims;
 	size_t bbox_size = 0, optional_precision_byte = 0;
+	size_t body_start, body_size, prefix_size = 0, size_size = 0;
 	uint8_t flag = 0, type_prec = 0;
-	bytebuffer_t header_bytebuffer, geom_bytebuffer;
+	uint8_t size_buf[MAX_VARINT_SIZE];
+	bytebuffer_t *b = parent_state->buf;
 
+	/* The geometry goes straight into the output of its parent */
 	TWKB_STATE child_state;
 	memset(&child_state, 0, sizeof(TWKB_STATE));
-	child_state.header_buf = &header_bytebuffer;
-	child_state.geom_buf = &geom_bytebuffer;
+	child_state.buf = b;
+	child_state.merge_bbox = LW_TRUE;
 	child_state.idlist = parent_state->idlist;
 
-	bytebuffer_init_with_size(child_state.header_buf, 16);
-	bytebuffer_init_with_size(child_state.geom_buf, 64);
-
 	/* Read dimensionality from input */
 	ndims = lwgeom_ndims(geom);
 	is_empty = lwgeom_is_empty(geom);
@@ -455,14 +472,14 @@ int lwgeom_write_to_buffer(const LWGEOM *geom, TWKB_GLOBALS *globals, TWKB_STATE
 	optional_precision_byte = (has_z || has_m);
 
 	/* Both X and Y dimension use the same precision */
-	globals->factor[0] = pow(10, globals->prec_xy);
+	globals->factor[0] = globals->factor_xy;
 	globals->factor[1] = globals->factor[0];
 
 	/* Z and M dimensions have their own precisions */
 	if ( has_z )
-		globals->factor[2] = pow(10, globals->prec_z);
+		globals->factor[2] = globals->factor_z;
 	if ( has_m )
-		globals->factor[2 + has_z] = pow(10, globals->prec_m);
+		globals->factor[2 + has_z] = globals->factor_m;
 
 	/* Reset stats */
 	for ( i = 0; i < MAX_N_DIMS; i++ )
@@ -483,7 +500,7 @@ int lwgeom_write_to_buffer(const LWGEOM *geom, TWKB_GLOBALS *globals, TWKB_STATE
 	/* Zig-zag the precision value before encoding it since it is a signed value */
 	TYPE_PREC_SET_PREC(type_prec, zigzag8(globals->prec_xy));
 	/* Write the type and precision byte */
-	bytebuffer_append_byte(child_state.header_buf, type_prec);
+	bytebuffer_append_byte(b, type_prec);
 
 	/* METADATA BYTE */
 	/* Set first bit if we are going to store bboxes */
@@ -497,7 +514,7 @@ int lwgeom_write_to_buffer(const LWGEOM *geom, TWKB_GLOBALS *globals, TWKB_STATE
 	/* Empty? */
 	FIRST_BYTE_SET_EMPTY(flag, is_empty);
 	/* Write the header byte */
-	bytebuffer_append_byte(child_state.header_buf, flag);
+	bytebuffer_append_byte(b, flag);
 
 	/* EXTENDED PRECISION BYTE (OPTIONAL) */
 	/* If needed, write the extended dim byte */
@@ -515,7 +532,7 @@ int lwgeom_write_to_buffer(const LWGEOM *geom, TWKB_GLOBALS *globals, TWKB_STATE
 		HIGHER_DIM_SET_HASM(flag, has_m);
 		HIGHER_DIM_SET_PRECZ(flag, globals->prec_z);
 		HIGHER_DIM_SET_PRECM(flag, globals->prec_m);
-		bytebuffer_append_byte(child_state.header_buf, flag);
+		bytebuffer_append_byte(b, flag);
 	}
 
 	/* It the geometry is empty, we're almost done */
@@ -525,21 +542,19 @@ int lwgeom_write_to_buffer(const LWGEOM *geom, TWKB_GLOBALS *globals, TWKB_STATE
 		/* all following content, which is zero because */
 		/* there is none */
 		if ( globals->variant & TWKB_SIZE )
-			bytebuffer_append_byte(child_state.header_buf, 0);
-
-		bytebuffer_append_bytebuffer(parent_state->geom_buf, child_state.header_buf);
-		bytebuffer_destroy_buffer(child_state.header_buf);
-		bytebuffer_destroy_buffer(child_state.geom_buf);
+			bytebuffer_append_byte(b, 0);
 		return 0;
 	}
 
 	/* Write the TWKB into the output buffer */
+	body_start = bytebuffer_getlength(b);
 	lwgeom_to_twkb_buf(geom, globals, &child_state);
+	body_size = bytebuffer_getlength(b) - body_start;
 
-	/*If we have a header_buf, we know that this function is called inside a collection*/
+	/*If the parent is a geometry, we know that this function is called inside a collection*/
 	/*and then we have to merge the bboxes of the included geometries*/
 	/*and put the result to the parent (the collection)*/
-	if( (globals->variant & TWKB_BBOX) && parent_state->header_buf )
+	if( (globals->variant & TWKB_BBOX) && parent_state->merge_bbox )
 	{
 		LWDEBUG(4,"Merge bboxes");
 		for ( i = 0; i < ndims; i++ )
@@ -559,27 +574,68 @@ int lwgeom_write_to_buffer(const LWGEOM *geom, TWKB_GLOBALS *globals, TWKB_STATE
 		bbox_size = sizeof_bbox(&child_state, ndims);
 	}
 
-	/* Write the size if wanted */
+	/* The size, if wanted, counts what follows it: the bbox and the body */
 	if( globals->variant & TWKB_SIZE )
-	{
-		/* Here we have to add what we know will be written to header */
-		/* buffer after size value is written */
-		size_t size_to_register = bytebuffer_getlength(child_state.geom_buf);
-		size_to_register += bbox_size;
-		bytebuffer_append_uvarint(child_state.header_buf, size_to_register);
-	}
+		size_size = varint_u64_encode_buf(body_size + bbox_size, size_buf);
 
-	if( globals->variant & TWKB_BBOX )
-		write_bbox(&child_state, ndims);
+	/* Size and bbox go between the header and the body, */
+	/* which we only know once the body is written */
+	prefix_size = size_size + bbox_size;
+	if ( prefix_size )
+	{
+		uint8_t *p;
+		bytebuffer_makeroom(b, prefix_size);
+		p = b->buf_start + body_start;
+		memmove(p + prefix_size, p, body_size);
+		b->writecursor += prefix_size;
 
-	bytebuffer_append_bytebuffer(parent_state->geom_buf,child_state.header_buf);
-	bytebuffer_append_bytebuffer(parent_state->geom_buf,child_state.geom_buf);
+		memcpy(p, size_buf, size_size);
+		if( globals->variant & TWKB_BBOX )
+			write_bbox(&child_state, ndims, p + size_size);
+	}
 
-	bytebuffer_destroy_buffer(child_state.header_buf);
-	bytebuffer_destroy_buffer(child_state.geom_buf);
 	return 0;
 }
 
+/* Output of a whole TWKB, written after the varlena header so that */
+/* the buffer can be returned as it is */
+static lwvarlena_t *
+lwgeom_to_twkb_varlena(const LWGEOM *geom, const int64_t *idlist, TWKB_GLOBALS *tg, size_t size)
+{
+	TWKB_STATE ts;
+	bytebuffer_t b;
+	lwvarlena_t *v;
+	size_t twkb_size;
+
+	bytebuffer_init_with_size(&b, size);
+	b.writecursor += LWVARHDRSZ;
+
+	memset(&ts, 0, sizeof(TWKB_STATE));
+	ts.idlist = idlist;
+	ts.buf = &b;
+	ts.merge_bbox = LW_FALSE;
+
+	/* Only the parts of a collection can have other dimensions */
+	tg->factor_xy = pow(10, tg->prec_xy);
+	if ( lwgeom_has_z(geom) || lwgeom_is_collection(geom) )
+		tg->factor_z = pow(10, tg->prec_z);
+	if ( lwgeom_has_m(geom) || lwgeom_is_collection(geom) )
+		tg->factor_m = pow(10, tg->prec_m);
+
+	lwgeom_write_to_buffer(geom, tg, &ts);
+
+	/* Small outputs stay in the static part and get copied out */
+	twkb_size = bytebuffer_getlength(&b);
+	if ( b.buf_start == b.buf_static )
+	{
+		v = lwalloc(twkb_size);
+		memcpy(v, b.buf_start, twkb_size);
+	}
+	else
+		v = lwrealloc(b.buf_start, twkb_size);
+	LWSIZE_SET(v->size, twkb_size);
+	return v;
+}
 
 /**
 * Convert LWGEOM to a char* in TWKB format. Caller is responsible for freeing
@@ -597,10 +653,7 @@ lwgeom_to_twkb_with_idlist(const LWGEOM *geom,
 	LWDEBUGF(2, "variant value %x", variant);
 
 	TWKB_GLOBALS tg;
-	TWKB_STATE ts;
-	bytebuffer_t geom_bytebuffer;
 
-	memset(&ts, 0, sizeof(TWKB_STATE));
 	memset(&tg, 0, sizeof(TWKB_GLOBALS));
 
 	tg.variant = variant;
@@ -621,15 +674,7 @@ lwgeom_to_twkb_with_idlist(const LWGEOM *geom,
 		return NULL;
 	}
 
-	ts.idlist = idlist;
-	ts.header_buf = NULL;
-	ts.geom_buf = &geom_bytebuffer;
-	bytebuffer_init_with_size(ts.geom_buf, 512);
-	lwgeom_write_to_buffer(geom, &tg, &ts);
-
-	lwvarlena_t *v = bytebuffer_get_buffer_varlena(ts.geom_buf);
-	bytebuffer_destroy_buffer(ts.geom_buf);
-	return v;
+	return lwgeom_to_twkb_varlena(geom, idlist, &tg, 512);
 }
 
 lwvarlena_t *
@@ -638,4 +683,65 @@ lwgeom_to_twkb(const LWGEOM *geom, uint8_t variant, int8_t precision_xy, int8_t
 	return lwgeom_to_twkb_with_idlist(geom, NULL, variant, precision_xy, precision_z, precision_m);
 }
 
+/**
+* Convert an array of geometries to one TWKB collection of them in one
+* buffer. Caller is responsible for freeing the returned array.
+*/
+lwvarlena_t *
+lwgeom_to_twkb_batch(const LWGEOM **geoms,
+		     uint32_t ngeoms,
+		     const int64_t *idlist,
+		     uint8_t variant,
+		     int8_t precision_xy,
+		     int8_t precision_z,
+		     int8_t precision_m)
+{
+	TWKB_GLOBALS tg;
+	LWCOLLECTION *col;
+	lwvarlena_t *v;
+	uint8_t type = 0, zm = 0;
+	int32_t srid = SRID_UNKNOWN;
+	size_t size;
+	uint32_t i;
+
+	LWDEBUGF(2, "Entered %s", __func__);
+
+	for ( i = 0; i < ngeoms; i++ )
+	{
+		if ( ! geoms[i] )
+		{
+			lwerror("Cannot convert NULL into TWKB");
+			return NULL;
+		}
+
+		/* Same type everywhere makes a multi, like in the SQL function. */
+		/* Its parts are written with its dimensions, so they must agree */
+		if ( i == 0 )
+		{
+			type = geoms[i]->type;
+			zm = FLAGS_GET_ZM(geoms[i]->flags);
+			srid = geoms[i]->srid;
+		}
+		else if ( type != geoms[i]->type || zm != FLAGS_GET_ZM(geoms[i]->flags) )
+			type = COLLECTIONTYPE;
+	}
 
+	memset(&tg, 0, sizeof(TWKB_GLOBALS));
+	tg.variant = variant;
+	tg.prec_xy = precision_xy;
+	tg.prec_z = precision_z;
+	tg.prec_m = precision_m;
+
+	/* Small features are a few dozen bytes each, the buffer */
+	/* grows from there if they are not */
+	size = 16 + (size_t)ngeoms * 16;
+
+	/* A collection over the array, which stays the caller's */
+	type = ngeoms ? lwtype_get_collectiontype(type) : COLLECTIONTYPE;
+	col = lwcollection_construct(type, srid, NULL, ngeoms, (LWGEOM **)geoms);
+
+	v = lwgeom_to_twkb_varlena(lwcollection_as_lwgeom(col), idlist, &tg, size);
+
+	lwfree(col);
+	return v;
+}
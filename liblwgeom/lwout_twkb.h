@@ -44,6 +44,10 @@
 
 #define MAX_BBOX_SIZE 64
 #define MAX_SIZE_SIZE 8
+#define MAX_VARINT_SIZE 10
+
+/* Points of an array quantized and written at a time */
+#define TWKB_BLOCK_POINTS 64
 
 
 /**
@@ -80,13 +84,16 @@ typedef struct
 	int8_t prec_z;
 	int8_t prec_m;
 	float factor[4]; /*What factor to multiply the coordiinates with to get the requested precision*/
+	float factor_xy; /* 10^precision of every dimension, for factor[] */
+	float factor_z;
+	float factor_m;
 } TWKB_GLOBALS;
 
 typedef struct
 {
 	uint8_t variant;  /*options that change at runtime*/
-	bytebuffer_t *header_buf;
-	bytebuffer_t *geom_buf;
+	bytebuffer_t *buf; /* Output, shared by a geometry and all its parts */
+	int merge_bbox; /* Parts add their bbox to this state */
 	int hasz;
 	int hasm;
 	const int64_t *idlist;
@@ -0,0 +1,212 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include "liblwgeom_internal.h"
+#include "lwcpu.h"
+
+/*
+ * Scaled and rounded coordinates of a point array, for the TWKB deltas.
+ *
+ * The ordinates are one flat stream of doubles, scaled by a vector of
+ * factors that repeats every lcm(ndims, vector width) of them. Rounding
+ * has to match llround, half away from zero: the vectors truncate, and
+ * step away from zero where the dropped fraction, which is exact, is at
+ * least one half. Values are turned into integers by adding 1.5 * 2^52
+ * and reading the low bits of the sum, which holds for magnitudes under
+ * 2^50. Runs with larger values, infinities or NaN, where llround gives
+ * what the platform gives, go through the scalar loop.
+ */
+
+#ifdef LWCPU_X86
+#define LW_TWKB_SIMD 1
+#include <immintrin.h>
+#endif
+
+/* Below this, the vector set up costs more than it saves */
+#define LW_TWKB_SIMD_MIN_POINTS 4
+
+/* Largest magnitude the vectors handle, and the number that converts them */
+#define LW_TWKB_LIMIT 1125899906842624.0 /* 2^50 */
+#define LW_TWKB_MAGIC 6755399441055744.0 /* 1.5 * 2^52 */
+
+/* lcm(ndims, 8) for three dimensions */
+#define LW_TWKB_MAX_PERIOD 24
+
+typedef int (*twkb_quantize_kernel)(const double *c, uint64_t nvals, uint32_t ndims, const double *factor, int64_t *out);
+
+static void
+twkb_quantize_scalar(const double *c, uint64_t from, uint64_t nvals, uint32_t ndims, const double *factor, int64_t *out)
+{
+	uint64_t i;
+	uint32_t d = from % ndims;
+
+	for (i = from; i < nvals; i++)
+	{
+		out[i] = (int64_t)llround(factor[d] * c[i]);
+		if (++d == ndims)
+			d = 0;
+	}
+}
+
+#ifdef LW_TWKB_SIMD
+
+/* Factors of a period of width lane vectors, returns the number of vectors */
+static uint32_t
+twkb_factor_period(uint32_t ndims, uint32_t width, const double *factor, double *pattern)
+{
+	uint32_t period = ndims == 3 ? 3 * width : (width > ndims ? width : ndims);
+	uint32_t k;
+
+	for (k = 0; k < period; k++)
+		pattern[k] = factor[k % ndims];
+	return period / width;
+}
+
+LWCPU_TARGET("sse4.2") static int
+twkb_quantize_sse42(const double *c, uint64_t nvals, uint32_t ndims, const double *factor, int64_t *out)
+{
+	double pattern[LW_TWKB_MAX_PERIOD];
+	const uint32_t nvec = twkb_factor_period(ndims, 2, factor, pattern);
+	const __m128d sign = _mm_set1_pd(-0.0), half = _mm_set1_pd(0.5), one = _mm_set1_pd(1.0);
+	const __m128d limit = _mm_set1_pd(LW_TWKB_LIMIT), magic = _mm_set1_pd(LW_TWKB_MAGIC);
+	__m128d f[3], bad = _mm_setzero_pd();
+	uint64_t i;
+	uint32_t k;
+
+	for (k = 0; k < nvec; k++)
+		f[k] = _mm_loadu_pd(pattern + 2 * k);
+
+	for (i = 0, k = 0; i + 2 <= nvals; i += 2)
+	{
+		__m128d x = _mm_mul_pd(_mm_loadu_pd(c + i), f[k]);
+		__m128d t = _mm_round_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+		__m128d away = _mm_cmpge_pd(_mm_andnot_pd(sign, _mm_sub_pd(x, t)), half);
+		__m128d r = _mm_add_pd(t, _mm_and_pd(away, _mm_or_pd(_mm_and_pd(sign, x), one)));
+		bad = _mm_or_pd(bad, _mm_cmpnlt_pd(_mm_andnot_pd(sign, x), limit));
+		_mm_storeu_si128((__m128i *)(out + i),
+				 _mm_sub_epi64(_mm_castpd_si128(_mm_add_pd(r, magic)), _mm_castpd_si128(magic)));
+		if (++k == nvec)
+			k = 0;
+	}
+	if (_mm_movemask_pd(bad))
+		return LW_TRUE;
+	twkb_quantize_scalar(c, i, nvals, ndims, factor, out);
+	return LW_FALSE;
+}
+
+LWCPU_TARGET("avx2") static int
+twkb_quantize_avx2(const double *c, uint64_t nvals, uint32_t ndims, const double *factor, int64_t *out)
+{
+	double pattern[LW_TWKB_MAX_PERIOD];
+	const uint32_t nvec = twkb_factor_period(ndims, 4, factor, pattern);
+	const __m256d sign = _mm256_set1_pd(-0.0), half = _mm256_set1_pd(0.5), one = _mm256_set1_pd(1.0);
+	const __m256d limit = _mm256_set1_pd(LW_TWKB_LIMIT), magic = _mm256_set1_pd(LW_TWKB_MAGIC);
+	__m256d f[3], bad = _mm256_setzero_pd();
+	uint64_t i;
+	uint32_t k;
+
+	for (k = 0; k < nvec; k++)
+		f[k] = _mm256_loadu_pd(pattern + 4 * k);
+
+	for (i = 0, k = 0; i + 4 <= nvals; i += 4)
+	{
+		__m256d x = _mm256_mul_pd(_mm256_loadu_pd(c + i), f[k]);
+		__m256d t = _mm256_round_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+		__m256d away = _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(x, t)), half, _CMP_GE_OQ);
+		__m256d r = _mm256_add_pd(t, _mm256_and_pd(away, _mm256_or_pd(_mm256_and_pd(sign, x), one)));
+		bad = _mm256_or_pd(bad, _mm256_cmp_pd(_mm256_andnot_pd(sign, x), limit, _CMP_NLT_UQ));
+		_mm256_storeu_si256((__m256i *)(out + i),
+				    _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(r, magic)), _mm256_castpd_si256(magic)));
+		if (++k == nvec)
+			k = 0;
+	}
+	if (_mm256_movemask_pd(bad))
+		return LW_TRUE;
+	twkb_quantize_scalar(c, i, nvals, ndims, factor, out);
+	return LW_FALSE;
+}
+
+LWCPU_TARGET("avx512f,avx512dq") static int
+twkb_quantize_avx512(const double *c, uint64_t nvals, uint32_t ndims, const double *factor, int64_t *out)
+{
+	double pattern[LW_TWKB_MAX_PERIOD];
+	const uint32_t nvec = twkb_factor_period(ndims, 8, factor, pattern);
+	const __m512d sign = _mm512_set1_pd(-0.0), half = _mm512_set1_pd(0.5), one = _mm512_set1_pd(1.0);
+	const __m512d limit = _mm512_set1_pd(LW_TWKB_LIMIT);
+	__m512d f[3];
+	__mmask8 bad = 0;
+	uint64_t i;
+	uint32_t k;
+
+	for (k = 0; k < nvec; k++)
+		f[k] = _mm512_loadu_pd(pattern + 8 * k);
+
+	for (i = 0, k = 0; i + 8 <= nvals; i += 8)
+	{
+		__m512d x = _mm512_mul_pd(_mm512_loadu_pd(c + i), f[k]);
+		__m512d t = _mm512_roundscale_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+		__mmask8 away = _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(x, t)), half, _CMP_GE_OQ);
+		__m512d r = _mm512_mask_add_pd(t, away, t, _mm512_or_pd(_mm512_and_pd(sign, x), one));
+		bad |= _mm512_cmp_pd_mask(_mm512_abs_pd(x), limit, _CMP_NLT_UQ);
+		_mm512_storeu_si512((void *)(out + i), _mm512_cvttpd_epi64(r));
+		if (++k == nvec)
+			k = 0;
+	}
+	if (bad)
+		return LW_TRUE;
+	twkb_quantize_scalar(c, i, nvals, ndims, factor, out);
+	return LW_FALSE;
+}
+
+#endif /* LW_TWKB_SIMD */
+
+/* NULL at the scalar level */
+static lwcpu_function twkb_quantize_dispatch = NULL;
+
+const LWCPU_KERNEL twkb_quantize_kernels = {
+	"twkb_quantize",
+	&twkb_quantize_dispatch,
+#ifdef LW_TWKB_SIMD
+	{[LW_CPU_SSE42] = (lwcpu_function)twkb_quantize_sse42,
+	 [LW_CPU_AVX2] = (lwcpu_function)twkb_quantize_avx2,
+	 [LW_CPU_AVX512] = (lwcpu_function)twkb_quantize_avx512}
+#else
+	{NULL}
+#endif
+};
+
+void
+ptarray_quantize(const POINTARRAY *pa, uint32_t first, uint32_t npoints, const double *factor, int64_t *out)
+{
+	const double *c = (const double *)getPoint_internal(pa, first);
+	uint32_t ndims = FLAGS_NDIMS(pa->flags);
+	uint64_t nvals = (uint64_t)npoints * ndims;
+
+	if (npoints >= LW_TWKB_SIMD_MIN_POINTS)
+	{
+		twkb_quantize_kernel kernel;
+		lwcpu_ensure();
+		kernel = (twkb_quantize_kernel)twkb_quantize_dispatch;
+		if (kernel && !kernel(c, nvals, ndims, factor, out))
+			return;
+	}
+
+	twkb_quantize_scalar(c, 0, nvals, ndims, factor, out);
+}
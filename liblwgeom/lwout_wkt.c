@@ -26,6 +26,7 @@
 #include "liblwgeom_internal.h"
 #include "lwgeom_log.h"
 #include "stringbuffer.h"
+#include "ryu/ryu.h"
 
 static void lwgeom_to_wkt_sb(const LWGEOM *geom, stringbuffer_t *sb, int precision, uint8_t variant);
 
@@ -76,17 +77,38 @@ static void empty_to_wkt_sb(stringbuffer_t *sb)
 	stringbuffer_append_len(sb, "EMPTY", 5);
 }
 
-inline static void
-coordinate_to_wkt_sb(double *coords, stringbuffer_t *sb, uint32_t dimensions, int precision)
+/*
+* Write the ordinates of a point array straight into a buffer with room for
+* OUT_MAX_BYTES_DOUBLE_PRECISION(precision) + 1 bytes per ordinate, formatted as
+* lwprint_double does. Returns the end of the text, not null terminated.
+*/
+static char *
+ptarray_to_wkt_buf(const POINTARRAY *pa, char *out, uint32_t dimensions, int precision)
 {
-	uint32_t d = 0;
-	stringbuffer_append_double(sb, coords[d], precision);
+	const double *dbl_ptr = (const double *)pa->serialized_pointlist;
+	uint32_t stride = FLAGS_NDIMS(pa->flags);
+	uint32_t digits = FP_MAX(0, precision);
+	uint32_t i, d;
 
-	for (d = 1; d < dimensions; d++)
+	if (!pa->npoints)
+		return out;
+
+	for (i = 0; i < pa->npoints; i++, dbl_ptr += stride)
 	{
-		stringbuffer_append_len(sb, " ", 1);
-		stringbuffer_append_double(sb, coords[d], precision);
+		for (d = 0; d < dimensions; d++)
+		{
+			double ad = fabs(dbl_ptr[d]);
+			if (ad <= OUT_MIN_DOUBLE || ad >= OUT_MAX_DOUBLE)
+				out += d2sexp_buffered_n(dbl_ptr[d], digits, out);
+			else
+				out += d2sfixed_buffered_n(dbl_ptr[d], digits, out);
+			*out++ = ' ';
+		}
+		out[-1] = ',';
 	}
+
+	/* No separator after the last ordinate */
+	return out - 1;
 }
 
 /*
@@ -103,30 +125,20 @@ static void ptarray_to_wkt_sb(const POINTARRAY *ptarray, stringbuffer_t *sb, int
 	if ( variant & ( WKT_ISO | WKT_EXTENDED ) )
 		dimensions = FLAGS_NDIMS(ptarray->flags);
 
-	stringbuffer_makeroom(sb, 2 + ((OUT_MAX_BYTES_DOUBLE + 1) * dimensions * ptarray->npoints));
+	/* One check for the whole array, the ordinates are written in place */
+	stringbuffer_makeroom(sb, 3 + ((OUT_MAX_BYTES_DOUBLE_PRECISION(precision) + 1) * dimensions * ptarray->npoints));
+
 	/* Opening paren? */
 	if ( ! (variant & WKT_NO_PARENS) )
-		stringbuffer_append_len(sb, "(", 1);
+		*(sb->str_end++) = '(';
 
 	/* Digits and commas */
-	if (ptarray->npoints)
-	{
-		uint32_t i = 0;
-
-		double *dbl_ptr = (double *)getPoint_internal(ptarray, i);
-		coordinate_to_wkt_sb(dbl_ptr, sb, dimensions, precision);
-
-		for (i = 1; i < ptarray->npoints; i++)
-		{
-			stringbuffer_append_len(sb, ",", 1);
-			dbl_ptr = (double *)getPoint_internal(ptarray, i);
-			coordinate_to_wkt_sb(dbl_ptr, sb, dimensions, precision);
-		}
-	}
+	sb->str_end = ptarray_to_wkt_buf(ptarray, sb->str_end, dimensions, precision);
 
 	/* Closing paren? */
 	if ( ! (variant & WKT_NO_PARENS) )
-		stringbuffer_append_len(sb, ")", 1);
+		*(sb->str_end++) = ')';
+	*(sb->str_end) = '\0';
 }
 
 /*
@@ -672,20 +684,85 @@ static void lwgeom_to_wkt_sb(const LWGEOM *geom, stringbuffer_t *sb, int precisi
 	}
 }
 
-// 2024.1.3 we removed this function's static keywords in order to export this function
-stringbuffer_t *
-lwgeom_to_wkt_internal(const LWGEOM *geom, uint8_t variant, int precision)
+/* Longest type name with its qualifiers, EMPTY, parens and a comma */
+#define WKT_MAX_BYTES_GEOM 32
+
+/*
+* Upper bound of the WKT size of a geometry, so that the buffer is allocated
+* once and the point arrays are formatted without growing it.
+*/
+static size_t
+lwgeom_to_wkt_size(const LWGEOM *geom, int precision, uint8_t variant)
 {
-	stringbuffer_t *sb;
-	if ( geom == NULL )
-		return NULL;
-	sb = stringbuffer_create();
+	size_t size = WKT_MAX_BYTES_GEOM;
+	size_t ordinate = OUT_MAX_BYTES_DOUBLE_PRECISION(precision) + 1;
+	size_t dimensions = (variant & (WKT_ISO | WKT_EXTENDED)) ? FLAGS_NDIMS(geom->flags) : 2;
+	uint32_t i;
+
+	switch (geom->type)
+	{
+	case POINTTYPE:
+	case LINETYPE:
+	case CIRCSTRINGTYPE:
+	case TRIANGLETYPE:
+	{
+		const POINTARRAY *pa = ((const LWLINE *)geom)->points;
+		if (pa)
+			size += pa->npoints * dimensions * ordinate;
+		break;
+	}
+	case POLYGONTYPE:
+	{
+		const LWPOLY *poly = (const LWPOLY *)geom;
+		for (i = 0; i < poly->nrings; i++)
+			size += 3 + poly->rings[i]->npoints * dimensions * ordinate;
+		break;
+	}
+	case CURVEPOLYTYPE:
+	{
+		const LWCURVEPOLY *cpoly = (const LWCURVEPOLY *)geom;
+		for (i = 0; i < cpoly->nrings; i++)
+			size += lwgeom_to_wkt_size(cpoly->rings[i], precision, variant);
+		break;
+	}
+	default:
+	{
+		const LWCOLLECTION *col = (const LWCOLLECTION *)geom;
+		if (lwtype_is_collection(geom->type))
+			for (i = 0; i < col->ngeoms; i++)
+				size += lwgeom_to_wkt_size(col->geoms[i], precision, variant);
+	}
+	}
+	return size;
+}
+
+/*
+* Write the geometry into a buffer created with room for all of it. The
+* "SRID=-2147483648;" prefix is not counted by lwgeom_to_wkt_size.
+*/
+static stringbuffer_t *
+lwgeom_to_wkt_sized_sb(const LWGEOM *geom, int precision, uint8_t variant, size_t header)
+{
+	stringbuffer_t *sb = stringbuffer_create_with_size(header + 18 + lwgeom_to_wkt_size(geom, precision, variant));
+	if ( header )
+		stringbuffer_append_len(sb, "\0\0\0\0\0\0\0\0", header);
 	/* Extended mode starts with an "SRID=" section for geoms that have one */
 	if ( (variant & WKT_EXTENDED) && lwgeom_has_srid(geom) )
 	{
 		stringbuffer_aprintf(sb, "SRID=%d;", geom->srid);
 	}
 	lwgeom_to_wkt_sb(geom, sb, precision, variant);
+	return sb;
+}
+
+// 2024.1.3 we removed this function's static keywords in order to export this function
+stringbuffer_t *
+lwgeom_to_wkt_internal(const LWGEOM *geom, uint8_t variant, int precision)
+{
+	stringbuffer_t *sb;
+	if ( geom == NULL )
+		return NULL;
+	sb = lwgeom_to_wkt_sized_sb(geom, precision, variant, 0);
 	if ( stringbuffer_getstring(sb) == NULL )
 	{
 		lwerror("Uh oh");
@@ -711,9 +788,9 @@ lwgeom_to_wkt(const LWGEOM *geom, uint8_t variant, int precision, size_t *size_o
 	stringbuffer_t *sb = lwgeom_to_wkt_internal(geom, variant, precision);
 	if (!sb)
 		return NULL;
-	char *str = stringbuffer_getstringcopy(sb);
 	if ( size_out )
 		*size_out = stringbuffer_getlength(sb) + 1;
+	char *str = stringbuffer_releasestring(sb);
 	stringbuffer_destroy(sb);
 	return str;
 }
@@ -721,10 +798,10 @@ lwgeom_to_wkt(const LWGEOM *geom, uint8_t variant, int precision, size_t *size_o
 lwvarlena_t *
 lwgeom_to_wkt_varlena(const LWGEOM *geom, uint8_t variant, int precision)
 {
-	stringbuffer_t *sb = lwgeom_to_wkt_internal(geom, variant, precision);
-	if (!sb)
+	if ( geom == NULL )
 		return NULL;
-	lwvarlena_t *output = stringbuffer_getvarlenacopy(sb);
+	stringbuffer_t *sb = lwgeom_to_wkt_sized_sb(geom, precision, variant, LWVARHDRSZ);
+	lwvarlena_t *output = stringbuffer_releasevarlena(sb);
 	stringbuffer_destroy(sb);
 	return output;
 }
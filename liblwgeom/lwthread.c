@@ -0,0 +1,142 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include "lwthread.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/* Beyond this, the threads mostly fight over memory bandwidth */
+#define LWTHREAD_MAX 64
+
+typedef struct
+{
+	lwthread_worker fn;
+	void *arg;
+	uint32_t worker;
+} LWTHREAD_TASK;
+
+uint32_t
+lwthread_ncpu(void)
+{
+	/* sysconf reads /sys on Linux, far too slow for every call */
+	static uint32_t ncpu = 0;
+	long n;
+
+	if (ncpu)
+		return ncpu;
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	n = (long)info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+	n = 1;
+#endif
+	if (n < 1)
+		n = 1;
+	if (n > LWTHREAD_MAX)
+		n = LWTHREAD_MAX;
+	ncpu = (uint32_t)n;
+	return ncpu;
+}
+
+uint32_t
+lwthread_count(uint32_t requested, size_t work_items, size_t min_items_per_thread)
+{
+	size_t n = requested ? requested : lwthread_ncpu();
+
+	if (min_items_per_thread && n > work_items / min_items_per_thread)
+		n = work_items / min_items_per_thread;
+	if (n > LWTHREAD_MAX)
+		n = LWTHREAD_MAX;
+	return n ? (uint32_t)n : 1;
+}
+
+#ifdef _WIN32
+static unsigned __stdcall
+lwthread_main(void *data)
+{
+	LWTHREAD_TASK *task = data;
+	task->fn(task->arg, task->worker);
+	return 0;
+}
+#else
+static void *
+lwthread_main(void *data)
+{
+	LWTHREAD_TASK *task = data;
+	task->fn(task->arg, task->worker);
+	return NULL;
+}
+#endif
+
+void
+lwthread_run(uint32_t nworkers, lwthread_worker fn, void *arg)
+{
+	LWTHREAD_TASK tasks[LWTHREAD_MAX];
+	uint8_t started[LWTHREAD_MAX];
+#ifdef _WIN32
+	HANDLE threads[LWTHREAD_MAX];
+#else
+	pthread_t threads[LWTHREAD_MAX];
+#endif
+	uint32_t i;
+
+	if (nworkers > LWTHREAD_MAX)
+		nworkers = LWTHREAD_MAX;
+
+	for (i = 1; i < nworkers; i++)
+	{
+		tasks[i].fn = fn;
+		tasks[i].arg = arg;
+		tasks[i].worker = i;
+#ifdef _WIN32
+		threads[i] = (HANDLE)_beginthreadex(NULL, 0, lwthread_main, &tasks[i], 0, NULL);
+		started[i] = threads[i] != 0;
+#else
+		started[i] = pthread_create(&threads[i], NULL, lwthread_main, &tasks[i]) == 0;
+#endif
+	}
+
+	if (nworkers)
+		fn(arg, 0);
+
+	for (i = 1; i < nworkers; i++)
+	{
+		if (!started[i])
+		{
+			fn(arg, i);
+			continue;
+		}
+#ifdef _WIN32
+		WaitForSingleObject(threads[i], INFINITE);
+		CloseHandle(threads[i]);
+#else
+		pthread_join(threads[i], NULL);
+#endif
+	}
+}
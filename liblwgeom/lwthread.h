@@ -0,0 +1,51 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#ifndef _LWTHREAD_H
+#define _LWTHREAD_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Minimal fork/join helper for the parallel algorithms.
+ *
+ * Workers must not call back into lwalloc, lwerror or anything else that
+ * goes through lwcontext(): the context belongs to the calling thread.
+ * They record their outcome in their own argument slot and the caller
+ * reports it once everything has been joined.
+ */
+
+typedef void (*lwthread_worker)(void *arg, uint32_t worker);
+
+/* Number of online processors, at least 1 */
+uint32_t lwthread_ncpu(void);
+
+/* Clamp a requested thread count (0 meaning one per processor) */
+uint32_t lwthread_count(uint32_t requested, size_t work_items, size_t min_items_per_thread);
+
+/*
+ * Run fn(arg, i) for every i in [0, nworkers) and wait for all of them.
+ * Worker 0 runs on the calling thread. Workers that cannot be started are
+ * run on the calling thread too, so every one of them always runs.
+ */
+void lwthread_run(uint32_t nworkers, lwthread_worker fn, void *arg);
+
+#endif /* _LWTHREAD_H */
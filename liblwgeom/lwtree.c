@@ -25,6 +25,7 @@
 #include "liblwgeom_internal.h"
 #include "lwgeom_log.h"
 #include "lwtree.h"
+#include "lwcache.h"
 #include "measures.h"
 
 static inline int
@@ -1038,7 +1039,7 @@ distance(double x1, double y1, double x2, double y2)
 * The closest any two objects in two nodes can be is the smallest
 * distance between the nodes themselves.
 */
-static inline double
+double
 rect_node_min_distance(const RECT_NODE *n1, const RECT_NODE *n2)
 {
 	int   left = n1->xmin > n2->xmax;
@@ -1382,3 +1383,231 @@ double rect_tree_distance_tree(RECT_NODE *n1, RECT_NODE *n2, double threshold)
 	// *p2 = state.p2;
 	return distance;
 }
+
+static int
+rect_tree_dwithin_tree_recursive(RECT_NODE *n1, RECT_NODE *n2, RECT_TREE_DISTANCE_STATE *state)
+{
+	int i;
+
+	/* Unlike a distance search, only pairs within the threshold matter */
+	if (rect_node_min_distance(n1, n2) > state->threshold)
+		return LW_FALSE;
+
+	if (rect_node_is_leaf(n1) && rect_node_is_leaf(n2))
+		return rect_leaf_node_distance(&n1->l, &n2->l, state) <= state->threshold;
+
+	/* Open the larger node first */
+	if (rect_node_is_leaf(n1) ||
+	    (!rect_node_is_leaf(n2) &&
+	     (n2->xmax - n2->xmin) + (n2->ymax - n2->ymin) > (n1->xmax - n1->xmin) + (n1->ymax - n1->ymin)))
+	{
+		for (i = 0; i < n2->i.num_nodes; i++)
+			if (rect_tree_dwithin_tree_recursive(n1, n2->i.nodes[i], state))
+				return LW_TRUE;
+	}
+	else
+	{
+		for (i = 0; i < n1->i.num_nodes; i++)
+			if (rect_tree_dwithin_tree_recursive(n1->i.nodes[i], n2, state))
+				return LW_TRUE;
+	}
+	return LW_FALSE;
+}
+
+/*
+* Does area contain a vertex of any leaf of node? When no edges are within
+* the distance, every component of node is either wholly inside or wholly
+* outside of area, so one vertex per leaf covers all the components, not
+* only the first one as rect_tree_get_point does.
+*/
+static int
+rect_tree_area_contains_any_point(RECT_NODE *area, const RECT_NODE *node)
+{
+	int i;
+
+	if (!rect_node_intersects(area, node))
+		return LW_FALSE;
+
+	if (rect_node_is_leaf(node))
+	{
+		int n = node->l.seg_type == RECT_NODE_SEG_CIRCULAR ? 2 * node->l.seg_num : node->l.seg_num;
+		return rect_tree_contains_point(area, getPoint2d_cp(node->l.pa, n));
+	}
+
+	for (i = 0; i < node->i.num_nodes; i++)
+		if (rect_tree_area_contains_any_point(area, node->i.nodes[i]))
+			return LW_TRUE;
+	return LW_FALSE;
+}
+
+int
+rect_tree_dwithin_tree(RECT_NODE *n1, RECT_NODE *n2, double distance)
+{
+	RECT_TREE_DISTANCE_STATE state;
+
+	/* Containment, as in rect_tree_distance_tree */
+	if (rect_tree_is_area(n1) &&
+		rect_tree_contains_point(n1, rect_tree_get_point(n2)))
+	{
+		return LW_TRUE;
+	}
+
+	if (rect_tree_is_area(n2) &&
+		rect_tree_contains_point(n2, rect_tree_get_point(n1)))
+	{
+		return LW_TRUE;
+	}
+
+	state.threshold = distance;
+	state.min_dist = FLT_MAX;
+	state.max_dist = FLT_MAX;
+	if (rect_tree_dwithin_tree_recursive(n1, n2, &state))
+		return LW_TRUE;
+
+	/* Other components of a multi geometry may still be inside the area */
+	if (rect_tree_is_area(n1) && rect_tree_area_contains_any_point(n1, n2))
+		return LW_TRUE;
+	if (rect_tree_is_area(n2) && rect_tree_area_contains_any_point(n2, n1))
+		return LW_TRUE;
+	return LW_FALSE;
+}
+
+/*
+* Cross-call cache of rect trees, one per LWGEOM_CONTEXT (see lwcache.h).
+*
+* Trees point into the point arrays of their geometry, so they are built
+* on the deep copy owned by the cache entry; callers can free their own
+* copy as soon as the call returns. Entries are built in a heap scope, so
+* an active arena does not reclaim them.
+*/
+
+struct RECT_TREE_CACHE
+{
+	LWCACHE cache;
+};
+
+static void
+rect_tree_cache_release(void *tree)
+{
+	rect_tree_free(tree);
+}
+
+RECT_NODE *
+rect_tree_cache_get(const LWGEOM *lwgeom)
+{
+	LWGEOM_CONTEXT *ctx = lwcontext();
+	RECT_TREE_CACHE *cache = ctx->rect_tree_cache;
+	LWARENA_SCOPE scope;
+	RECT_NODE *tree;
+	LWGEOM *copy;
+	uint64_t key;
+
+	if (!cache)
+	{
+		cache = lwalloc_heap(sizeof(RECT_TREE_CACHE));
+		lwcache_init(&cache->cache, RECT_TREE_CACHE_ITEMS, rect_tree_cache_release);
+		ctx->rect_tree_cache = cache;
+	}
+
+	if ((tree = lwcache_find(&cache->cache, lwgeom, &key)))
+		return tree;
+
+	lwarena_push(NULL, &scope);
+	copy = lwgeom_clone_deep(lwgeom);
+	tree = rect_tree_from_lwgeom(copy);
+	lwarena_pop(&scope);
+
+	if (!tree)
+	{
+		/* Empty, nothing worth keeping */
+		lwgeom_free(copy);
+		return NULL;
+	}
+	lwcache_add(&cache->cache, key, lwgeom, copy, tree);
+	return tree;
+}
+
+void
+rect_tree_cache_flush(void)
+{
+	RECT_TREE_CACHE *cache = lwcontext()->rect_tree_cache;
+	if (cache)
+		lwcache_flush(&cache->cache);
+}
+
+void
+rect_tree_cache_stats(uint64_t *hits, uint64_t *misses, uint32_t *size)
+{
+	RECT_TREE_CACHE *cache = lwcontext()->rect_tree_cache;
+	lwcache_stats(cache ? &cache->cache : NULL, hits, misses, size);
+}
+
+void
+rect_tree_cache_destroy(void)
+{
+	LWGEOM_CONTEXT *ctx = lwcontext();
+	if (!ctx->rect_tree_cache)
+		return;
+	rect_tree_cache_flush();
+	lwfree_heap(ctx->rect_tree_cache);
+	ctx->rect_tree_cache = NULL;
+}
+
+/*
+* Small inputs (typically the probe points) get a throw-away tree, so
+* they cannot evict the large geometries the cache is meant for.
+*/
+static RECT_NODE *
+rect_tree_cached_or_new(const LWGEOM *lwgeom, int *is_temporary)
+{
+	if (lwgeom_count_vertices(lwgeom) < RECT_TREE_CACHE_MIN_VERTICES)
+	{
+		*is_temporary = LW_TRUE;
+		return rect_tree_from_lwgeom(lwgeom);
+	}
+	*is_temporary = LW_FALSE;
+	return rect_tree_cache_get(lwgeom);
+}
+
+double
+lwgeom_rect_tree_distance(const LWGEOM *lwgeom1, const LWGEOM *lwgeom2, double threshold)
+{
+	int tmp1, tmp2;
+	RECT_NODE *n1, *n2;
+	double distance = FLT_MAX;
+
+	if (lwgeom_is_empty(lwgeom1) || lwgeom_is_empty(lwgeom2))
+		return FLT_MAX;
+
+	n1 = rect_tree_cached_or_new(lwgeom1, &tmp1);
+	n2 = rect_tree_cached_or_new(lwgeom2, &tmp2);
+	if (n1 && n2)
+		distance = rect_tree_distance_tree(n1, n2, threshold);
+	if (tmp1)
+		rect_tree_free(n1);
+	if (tmp2)
+		rect_tree_free(n2);
+	return distance;
+}
+
+int
+lwgeom_rect_tree_intersects(const LWGEOM *lwgeom1, const LWGEOM *lwgeom2)
+{
+	int tmp1, tmp2;
+	RECT_NODE *n1, *n2;
+	int result = LW_FALSE;
+
+	if (lwgeom_is_empty(lwgeom1) || lwgeom_is_empty(lwgeom2))
+		return LW_FALSE;
+
+	n1 = rect_tree_cached_or_new(lwgeom1, &tmp1);
+	n2 = rect_tree_cached_or_new(lwgeom2, &tmp2);
+	/* Boundary contact (shared ends, T-junctions) counts, as in lwgeom_intersects */
+	if (n1 && n2)
+		result = rect_tree_dwithin_tree(n1, n2, 0.0);
+	if (tmp1)
+		rect_tree_free(n1);
+	if (tmp2)
+		rect_tree_free(n2);
+	return result;
+}
@@ -102,6 +102,20 @@ int rect_tree_intersects_tree(RECT_NODE *tree1, RECT_NODE *tree2);
 */
 double rect_tree_distance_tree(RECT_NODE *n1, RECT_NODE *n2, double threshold);
 
+/**
+* LW_TRUE if the two trees are within distance of one another. Cheaper
+* than comparing rect_tree_distance_tree to the distance, since pairs of
+* nodes further apart are pruned at once. A zero distance tests for
+* intersection, touching ends included.
+*/
+int rect_tree_dwithin_tree(RECT_NODE *n1, RECT_NODE *n2, double distance);
+
+/**
+* Smallest distance between the boxes of two nodes, a lower bound of the
+* distance between anything under them.
+*/
+double rect_node_min_distance(const RECT_NODE *n1, const RECT_NODE *n2);
+
 /**
 * Free the rect-tree memory
 */
@@ -112,3 +126,26 @@ RECT_NODE * rect_tree_from_ptarray(const POINTARRAY *pa, int geom_type);
 LWGEOM * rect_tree_to_lwgeom(const RECT_NODE *tree);
 char * rect_tree_to_wkt(const RECT_NODE *node);
 void rect_tree_printf(const RECT_NODE *node, int depth);
+
+/* Geometries with fewer vertices are not worth caching */
+#define RECT_TREE_CACHE_MIN_VERTICES 64
+
+/**
+* Rect tree of geom from the per context LRU cache, built on a private
+* copy of the geometry on a miss. Owned by the cache: do not free it, and
+* do not keep it across other cache calls, which may evict it.
+* NULL for empty geometries.
+*/
+RECT_NODE * rect_tree_cache_get(const LWGEOM *geom);
+void rect_tree_cache_flush(void);
+void rect_tree_cache_stats(uint64_t *hits, uint64_t *misses, uint32_t *size);
+void rect_tree_cache_destroy(void);
+
+/**
+* Cartesian distance and intersects test through cached rect trees:
+* inputs with at least RECT_TREE_CACHE_MIN_VERTICES vertices keep their
+* tree between calls, smaller ones get a temporary tree. Geometries that
+* only touch intersect, as with lwgeom_intersects.
+*/
+double lwgeom_rect_tree_distance(const LWGEOM *geom1, const LWGEOM *geom2, double threshold);
+int lwgeom_rect_tree_intersects(const LWGEOM *geom1, const LWGEOM *geom2);
@@ -109,6 +109,38 @@ UF_union(UNIONFIND* uf, uint32_t i, uint32_t j)
 	uf->num_clusters--;
 }
 
+void
+UF_normalize(UNIONFIND* uf)
+{
+	uint32_t* lowest = lwalloc(uf->N * sizeof(uint32_t));
+	uint32_t i;
+
+	/* Going up, the first component seen of a cluster is its lowest one */
+	for (i = 0; i < uf->N; i++)
+		lowest[i] = uf->N;
+	for (i = 0; i < uf->N; i++)
+	{
+		uint32_t root = UF_find(uf, i);
+		if (lowest[root] == uf->N)
+			lowest[root] = i;
+	}
+
+	/* Every component points straight to its root now */
+	for (i = 0; i < uf->N; i++)
+	{
+		uint32_t root = uf->clusters[i];
+		if (root == i && lowest[i] != i)
+		{
+			uf->cluster_sizes[lowest[i]] = uf->cluster_sizes[i];
+			uf->cluster_sizes[i] = 0;
+		}
+	}
+	for (i = 0; i < uf->N; i++)
+		uf->clusters[i] = lowest[uf->clusters[i]];
+
+	lwfree(lowest);
+}
+
 uint32_t*
 UF_ordered_by_cluster(UNIONFIND* uf)
 {
@@ -51,6 +51,10 @@ uint32_t UF_size(UNIONFIND* uf, uint32_t i);
 /* Merge the clusters that contain the two specified component ids */
 void UF_union(UNIONFIND* uf, uint32_t i, uint32_t j);
 
+/* Make the lowest component id of every cluster its root, so that the
+ * cluster ids only depend on the clusters, not on the order of the unions */
+void UF_normalize(UNIONFIND* uf);
+
 /* Return an array of component ids, where components that are in the
  * same cluster are contiguous in the array */
 uint32_t* UF_ordered_by_cluster(UNIONFIND* uf);
@@ -180,6 +180,29 @@ lwgeom_set_handlers(lwallocator allocator, lwreallocator reallocator,
 
 }
 
+/**
+ * Per context handlers, for callers that keep one context per thread or
+ * session. They take precedence over the ones of lwgeom_set_handlers,
+ * NULL values fall back to the global handler.
+ */
+void
+lwcontext_set_handlers(LWGEOM_CONTEXT *ctx, lwallocator allocator,
+	lwreallocator reallocator, lwfreeor freeor, lwreporter errorreporter,
+	lwreporter noticereporter) {
+
+	ctx->allocator = allocator;
+	ctx->reallocator = reallocator;
+	ctx->freeor = freeor;
+	ctx->errorreporter = errorreporter;
+	ctx->noticereporter = noticereporter;
+}
+
+void
+lwcontext_set_debuglogger(LWGEOM_CONTEXT *ctx, lwdebuglogger debuglogger) {
+
+	ctx->debuglogger = debuglogger;
+}
+
 void
 lwgeom_set_json_handlers(lwallocator allocator, lwreallocator reallocator,
 	lwfreeor freeor) {
@@ -195,12 +218,16 @@ lwgeom_set_debuglogger(lwdebuglogger debuglogger) {
 void
 lwnotice(const char *fmt, ...)
 {
+	LWGEOM_CONTEXT *ctx = lwcontext();
 	va_list ap;
 
 	va_start(ap, fmt);
 
 	/* Call the supplied function */
-	(*lwnotice_var)(fmt, ap);
+	if (ctx->noticereporter)
+		(*ctx->noticereporter)(fmt, ap);
+	else
+		(*lwnotice_var)(fmt, ap);
 
 	va_end(ap);
 }
@@ -208,12 +235,16 @@ lwnotice(const char *fmt, ...)
 void
 lwerror(const char *fmt, ...)
 {
+	LWGEOM_CONTEXT *ctx = lwcontext();
 	va_list ap;
 
 	va_start(ap, fmt);
 
 	/* Call the supplied function */
-	(*lwerror_var)(fmt, ap);
+	if (ctx->errorreporter)
+		(*ctx->errorreporter)(fmt, ap);
+	else
+		(*lwerror_var)(fmt, ap);
 
 	va_end(ap);
 }
@@ -221,12 +252,16 @@ lwerror(const char *fmt, ...)
 void
 lwdebug(int level, const char *fmt, ...)
 {
+	LWGEOM_CONTEXT *ctx = lwcontext();
 	va_list ap;
 
 	va_start(ap, fmt);
 
 	/* Call the supplied function */
-	(*lwdebug_var)(level, fmt, ap);
+	if (ctx->debuglogger)
+		(*ctx->debuglogger)(level, fmt, ap);
+	else
+		(*lwdebug_var)(level, fmt, ap);
 
 	va_end(ap);
 }
@@ -242,10 +277,38 @@ lwtype_name(uint8_t type)
 	return lwgeomTypeName[(int ) type];
 }
 
+/* Context handlers first, then the global ones */
+static inline void *
+lwalloc_ctx(LWGEOM_CONTEXT *ctx, size_t size)
+{
+	return ctx->allocator ? ctx->allocator(size) : lwalloc_var(size);
+}
+
+static inline void *
+lwrealloc_ctx(LWGEOM_CONTEXT *ctx, void *mem, size_t size)
+{
+	return ctx->reallocator ? ctx->reallocator(mem, size) : lwrealloc_var(mem, size);
+}
+
+static inline void
+lwfree_ctx(LWGEOM_CONTEXT *ctx, void *mem)
+{
+	if (ctx->freeor)
+		ctx->freeor(mem);
+	else
+		lwfree_var(mem);
+}
+
 void *
 lwalloc(size_t size)
 {
-	void *mem = lwalloc_var(size);
+	LWGEOM_CONTEXT *ctx = lwcontext();
+	void *mem;
+
+	if (ctx->arena_scope && ctx->arena_scope->arena)
+		mem = lwarena_alloc(ctx->arena_scope->arena, size);
+	else
+		mem = lwalloc_ctx(ctx, size);
 	LWDEBUGF(5, "lwalloc: %d@%p", size, mem);
 	return mem;
 }
@@ -253,14 +316,44 @@ lwalloc(size_t size)
 void *
 lwrealloc(void *mem, size_t size)
 {
+	LWGEOM_CONTEXT *ctx = lwcontext();
+	LWARENA *arena;
 	LWDEBUGF(5, "lwrealloc: %d@%p", size, mem);
-	return lwrealloc_var(mem, size);
+
+	if (!ctx->arena_scope)
+		return lwrealloc_ctx(ctx, mem, size);
+
+	/* Memory stays with whoever allocated it, heap or arena */
+	arena = mem ? lwarena_owner(mem) : ctx->arena_scope->arena;
+	if (arena)
+		return lwarena_realloc(arena, mem, size);
+	return lwrealloc_ctx(ctx, mem, size);
 }
 
 void
 lwfree(void *mem)
 {
-	lwfree_var(mem);
+	LWGEOM_CONTEXT *ctx = lwcontext();
+	LWARENA *arena;
+
+	if (ctx->arena_scope && (arena = lwarena_owner(mem)))
+	{
+		lwarena_free(arena, mem);
+		return;
+	}
+	lwfree_ctx(ctx, mem);
+}
+
+void *
+lwalloc_heap(size_t size)
+{
+	return lwalloc_ctx(lwcontext(), size);
+}
+
+void
+lwfree_heap(void *mem)
+{
+	lwfree_ctx(lwcontext(), mem);
 }
 
 LWGEOM_CONTEXT*
@@ -90,11 +90,8 @@ ptarray_insert_point(POINTARRAY *pa, const POINT4D *p, uint32_t where)
 	LWDEBUGF(5,"pa = %p; p = %p; where = %d", pa, p, where);
 	LWDEBUGF(5,"pa->npoints = %d; pa->maxpoints = %d", pa->npoints, pa->maxpoints);
 
-	if ( FLAGS_GET_READONLY(pa->flags) )
-	{
-		lwerror("ptarray_insert_point: called on read-only point array");
-		return LW_FAILURE;
-	}
+	/* Referenced ordinates are copied before we grow into them */
+	ptarray_make_writable(pa);
 
 	/* Error on invalid offset value */
 	if ( where > pa->npoints )
@@ -192,11 +189,7 @@ ptarray_append_ptarray(POINTARRAY *pa1, POINTARRAY *pa2, double gap_tolerance)
 
 	if ( ! npoints ) return LW_SUCCESS; /* nothing more to do */
 
-	if( FLAGS_GET_READONLY(pa1->flags) )
-	{
-		lwerror("ptarray_append_ptarray: target pointarray is read-only");
-		return LW_FAILURE;
-	}
+	ptarray_make_writable(pa1);
 
 	if( FLAGS_GET_ZM(pa1->flags) != FLAGS_GET_ZM(pa2->flags) )
 	{
@@ -264,6 +257,8 @@ ptarray_remove_point(POINTARRAY *pa, uint32_t where)
 		return LW_FAILURE;
 	}
 
+	ptarray_make_writable(pa);
+
 	/* If the point is any but the last, we need to copy the data back one point */
 	if (where < pa->npoints - 1)
 		memmove(getPoint_internal(pa, where),
@@ -292,6 +287,32 @@ POINTARRAY* ptarray_construct_reference_data(char hasz, char hasm, uint32_t npoi
 	return pa;
 }
 
+/**
+* Make sure a #POINTARRAY owns its ordinates before they are written to.
+* Read-only arrays built on top of someone else's buffer (see
+* ptarray_construct_reference_data) get a private copy of the ordinates
+* and lose the read-only flag, so in-place edits never reach the shared
+* buffer. Arrays that already own their memory are left untouched.
+*/
+void
+ptarray_make_writable(POINTARRAY *pa)
+{
+	size_t size;
+	uint8_t *ptlist = NULL;
+
+	if (!pa || !FLAGS_GET_READONLY(pa->flags))
+		return;
+
+	size = ptarray_point_size(pa) * pa->npoints;
+	if (size)
+	{
+		ptlist = lwalloc(size);
+		memcpy(ptlist, pa->serialized_pointlist, size);
+	}
+	pa->serialized_pointlist = ptlist;
+	pa->maxpoints = pa->npoints;
+	FLAGS_SET_READONLY(pa->flags, 0);
+}
 
 POINTARRAY*
 ptarray_construct_copy_data(char hasz, char hasm, uint32_t npoints, const uint8_t *ptlist)
@@ -332,6 +353,7 @@ ptarray_reverse_in_place(POINTARRAY *pa)
 {
 	if (!pa->npoints)
 		return;
+	ptarray_make_writable(pa);
 	uint32_t i;
 	uint32_t last = pa->npoints - 1;
 	uint32_t mid = pa->npoints / 2;
@@ -1500,6 +1522,7 @@ ptarray_longitude_shift(POINTARRAY *pa)
 	uint32_t i;
 	double x;
 
+	ptarray_make_writable(pa);
 	for (i=0; i<pa->npoints; i++)
 	{
 		memcpy(&x, getPoint_internal(pa, i), sizeof(double));
@@ -1547,6 +1570,8 @@ ptarray_remove_repeated_points_in_place(POINTARRAY *pa, double tolerance, uint32
 	/* No-op on short inputs */
 	if ( n_points <= min_points ) return;
 
+	ptarray_make_writable(pa);
+
 	last = getPoint2d_cp(pa, 0);
 	void *p_to = ((char *)last) + pt_size;
 	for (i = 1; i < n_points; i++)
@@ -1716,6 +1741,8 @@ ptarray_simplify_in_place(POINTARRAY *pa, double tolerance, uint32_t minpts)
 	if (pa->npoints < 3 || pa->npoints <= minpts)
 		return;
 
+	ptarray_make_writable(pa);
+
 	if (tolerance == 0 && minpts <= 2)
 	{
 		ptarray_simplify_in_place_tolerance0(pa);
@@ -1889,6 +1916,7 @@ ptarray_length(const POINTARRAY *pts)
 void
 ptarray_affine(POINTARRAY *pa, const AFFINE *a)
 {
+	ptarray_make_writable(pa);
 	if (FLAGS_GET_Z(pa->flags))
 	{
 		for (uint32_t i = 0; i < pa->npoints; i++)
@@ -2097,6 +2125,7 @@ ptarray_grid_in_place(POINTARRAY *pa, const gridspec *grid)
 	uint32_t has_z = FLAGS_GET_Z(pa->flags);
 	uint32_t has_m = FLAGS_GET_M(pa->flags);
 
+	ptarray_make_writable(pa);
 	for (uint32_t i = 0; i < pa->npoints; i++)
 	{
 		/* Look straight into the abyss */
@@ -2236,6 +2265,7 @@ ptarray_scroll_in_place(POINTARRAY *pa, const POINT4D *pt)
 	);
 
 	/* Copy the resulting pointarray back to source one */
+	ptarray_make_writable(pa);
 	memcpy(
 		getPoint_internal(pa, 0),
 		getPoint_internal(tmp, 0),
@@ -35,13 +35,13 @@ stringbuffer_create(void)
 	return stringbuffer_create_with_size(STRINGBUFFER_STARTSIZE);
 }
 
-static void
+void
 stringbuffer_init_with_size(stringbuffer_t *s, size_t size)
 {
 	s->str_start = lwalloc(size);
 	s->str_end = s->str_start;
 	s->capacity = size;
-	memset(s->str_start, 0, size);
+	s->str_start[0] = '\0';
 }
 
 void
@@ -158,6 +158,40 @@ stringbuffer_getvarlenacopy(stringbuffer_t *s)
 	return output;
 }
 
+/**
+* Returns the internal string without copying it, trimmed when that
+* gives back more than a small buffer, and leaves the stringbuffer_t
+* empty. Caller is responsible for freeing the return value.
+*/
+char*
+stringbuffer_releasestring(stringbuffer_t *s)
+{
+	size_t size = (s->str_end - s->str_start) + 1;
+	char *str = s->str_start;
+	if ( s->capacity - size > STRINGBUFFER_STARTSIZE )
+		str = lwrealloc(str, size);
+	s->str_start = s->str_end = NULL;
+	s->capacity = 0;
+	return str;
+}
+
+/**
+* Same as stringbuffer_releasestring, for a buffer that starts with
+* LWVARHDRSZ bytes of header (see stringbuffer_init_varlena).
+*/
+lwvarlena_t *
+stringbuffer_releasevarlena(stringbuffer_t *s)
+{
+	size_t size = (s->str_end - s->str_start);
+	lwvarlena_t *output = (lwvarlena_t *)(s->str_start);
+	if ( s->capacity - size > STRINGBUFFER_STARTSIZE )
+		output = lwrealloc(output, size);
+	LWSIZE_SET(output->size, size);
+	s->str_start = s->str_end = NULL;
+	s->capacity = 0;
+	return output;
+}
+
 /**
 * Returns the length of the current string, not including the
 * null terminator (same behavior as strlen()).
@@ -47,6 +47,7 @@ stringbuffer_t;
 extern stringbuffer_t *stringbuffer_create_with_size(size_t size);
 extern stringbuffer_t *stringbuffer_create(void);
 extern void stringbuffer_init(stringbuffer_t *s);
+extern void stringbuffer_init_with_size(stringbuffer_t *s, size_t size);
 extern void stringbuffer_init_varlena(stringbuffer_t *s);
 extern void stringbuffer_release(stringbuffer_t *s);
 extern void stringbuffer_destroy(stringbuffer_t *sb);
@@ -58,6 +59,8 @@ extern const char *stringbuffer_getstring(stringbuffer_t *sb);
 extern char *stringbuffer_getstringcopy(stringbuffer_t *sb);
 extern lwvarlena_t *stringbuffer_getvarlenacopy(stringbuffer_t *s);
 extern lwvarlena_t * stringbuffer_getvarlena(stringbuffer_t *s);
+extern char *stringbuffer_releasestring(stringbuffer_t *s);
+extern lwvarlena_t *stringbuffer_releasevarlena(stringbuffer_t *s);
 extern int stringbuffer_getlength(stringbuffer_t *sb);
 extern char stringbuffer_lastchar(stringbuffer_t *s);
 extern int stringbuffer_trim_trailing_white(stringbuffer_t *s);